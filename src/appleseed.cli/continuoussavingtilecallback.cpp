@@ -34,12 +34,18 @@
 #include "progresstilecallback.h"
 
 // appleseed.renderer headers.
+#include "renderer/api/aov.h"
 #include "renderer/api/frame.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/image/canvasproperties.h"
 #include "foundation/image/image.h"
 #include "foundation/image/imageattributes.h"
+#include "foundation/image/progressiveexrimagefilewriter.h"
+#include "foundation/image/tile.h"
 #include "foundation/platform/thread.h"
+#include "foundation/utility/log.h"
 
 // Boost headers.
 #include "boost/filesystem/operations.hpp"
@@ -51,6 +57,7 @@
 // Standard headers.
 #include <cstddef>
 #include <ctime>
+#include <vector>
 
 using namespace foundation;
 using namespace renderer;
@@ -67,13 +74,25 @@ namespace cli {
 
 namespace
 {
+    //
+    // When streaming, tiles of the main image and of the AOV images are appended
+    // to a single multi-layer OpenEXR file as soon as they are rendered. Otherwise
+    // the whole main image is written again after each tile.
+    //
+
     class ContinuousSavingTileCallback
       : public ProgressTileCallback
     {
       public:
-        ContinuousSavingTileCallback(const string& output_path, Logger& logger)
+        ContinuousSavingTileCallback(
+            const string&   output_path,
+            const bool      stream_tiles,
+            Logger&         logger)
           : ProgressTileCallback(logger)
           , m_output_path(output_path)
+          , m_stream_tiles(stream_tiles)
+          , m_streaming_failed(false)
+          , m_streamed_tile_count(0)
         {
             boost::mt19937 rng(static_cast<uint32_t>(time(0)));
             const uuids::uuid u = uuids::basic_random_generator<boost::mt19937>(&rng)();
@@ -83,20 +102,143 @@ namespace
             m_tmp_output_path = m_output_path.parent_path() / tmp_filename;
         }
 
+        virtual void post_render_tile(
+            const Frame*    frame,
+            const size_t    tile_x,
+            const size_t    tile_y) APPLESEED_OVERRIDE
+        {
+            // Tiles are converted and written concurrently, the writer serializes file accesses.
+            if (m_stream_tiles)
+                stream_tile(frame, tile_x, tile_y);
+
+            ProgressTileCallback::post_render_tile(frame, tile_x, tile_y);
+        }
+
       private:
-        boost::mutex        m_mutex;
-        bf::path            m_output_path;
-        bf::path            m_tmp_output_path;
+        boost::mutex                    m_mutex;
+        bf::path                        m_output_path;
+        bf::path                        m_tmp_output_path;
+        const bool                      m_stream_tiles;
+        ProgressiveEXRImageFileWriter   m_writer;
+        bool                            m_streaming_failed;
+        size_t                          m_streamed_tile_count;
 
         virtual void do_post_render_tile(
             const Frame*    frame,
             const size_t    tile_x,
             const size_t    tile_y) APPLESEED_OVERRIDE
         {
-            boost::mutex::scoped_lock lock(m_mutex);
             ProgressTileCallback::do_post_render_tile(frame, tile_x, tile_y);
-            frame->write_main_image(m_tmp_output_path.string().c_str());
-            bf::rename(m_tmp_output_path, m_output_path);
+
+            if (!m_stream_tiles)
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                frame->write_main_image(m_tmp_output_path.string().c_str());
+                bf::rename(m_tmp_output_path, m_output_path);
+            }
+        }
+
+        void stream_tile(
+            const Frame*    frame,
+            const size_t    tile_x,
+            const size_t    tile_y)
+        {
+            if (!open_file(*frame))
+                return;
+
+            // Convert the tile of the main image to the output color space.
+            Tile tile(frame->image().tile(tile_x, tile_y));
+            frame->transform_to_output_color_space(tile);
+
+            // Note: AOVs are always in the linear color space.
+            const ImageStack& aov_images = frame->aov_images();
+            vector<const Tile*> layer_tiles;
+            layer_tiles.push_back(&tile);
+            for (size_t i = 0; i < aov_images.size(); ++i)
+                layer_tiles.push_back(&aov_images.get_image(i).tile(tile_x, tile_y));
+
+            try
+            {
+                m_writer.write_tile(tile_x, tile_y, &layer_tiles[0]);
+            }
+            catch (const ExceptionIOError&)
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                fail("failed to write tile to %s: i/o error.");
+                return;
+            }
+
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            // Publish the file once all tiles have been written.
+            if (++m_streamed_tile_count == frame->image().properties().m_tile_count)
+            {
+                try
+                {
+                    m_writer.close();
+                    bf::rename(m_tmp_output_path, m_output_path);
+                }
+                catch (const ExceptionIOError&)
+                {
+                    fail("failed to close %s: i/o error.");
+                }
+            }
+        }
+
+        bool open_file(const Frame& frame)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            if (m_streaming_failed)
+                return false;
+
+            if (m_writer.is_open())
+                return true;
+
+            // The file is already complete.
+            if (m_streamed_tile_count > 0)
+                return false;
+
+            const ImageStack& aov_images = frame.aov_images();
+
+            vector<const char*> layer_names;
+            vector<CanvasProperties> layer_props;
+
+            layer_names.push_back("");
+            layer_props.push_back(frame.image().properties());
+
+            for (size_t i = 0; i < aov_images.size(); ++i)
+            {
+                layer_names.push_back(aov_images.get_name(i));
+                layer_props.push_back(aov_images.get_image(i).properties());
+            }
+
+            try
+            {
+                m_writer.open(
+                    m_tmp_output_path.string().c_str(),
+                    layer_names.size(),
+                    &layer_names[0],
+                    &layer_props[0],
+                    ImageAttributes::create_default_attributes());
+            }
+            catch (const ExceptionIOError&)
+            {
+                fail("failed to open %s for writing: i/o error.");
+                return false;
+            }
+
+            return true;
+        }
+
+        // Must be called with m_mutex locked.
+        void fail(const char* message)
+        {
+            if (!m_streaming_failed)
+            {
+                LOG_ERROR(m_logger, message, m_tmp_output_path.string().c_str());
+                m_streaming_failed = true;
+            }
         }
     };
 }
@@ -108,8 +250,9 @@ namespace
 
 ContinuousSavingTileCallbackFactory::ContinuousSavingTileCallbackFactory(
     const string&   output_path,
+    const bool      stream_tiles,
     Logger&         logger)
-  : m_callback(new ContinuousSavingTileCallback(output_path, logger))
+  : m_callback(new ContinuousSavingTileCallback(output_path, stream_tiles, logger))
 {
 }
 
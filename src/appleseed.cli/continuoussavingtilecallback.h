@@ -46,12 +46,20 @@ namespace foundation    { class Logger; }
 namespace appleseed {
 namespace cli {
 
+//
+// A tile callback that keeps the output file on disk up-to-date while rendering.
+// If stream_tiles is true, tiles are streamed to a single multi-layer OpenEXR file
+// holding the main image and the AOV images; this requires each tile to be rendered
+// exactly once.
+//
+
 class ContinuousSavingTileCallbackFactory
   : public renderer::ITileCallbackFactory
 {
   public:
     ContinuousSavingTileCallbackFactory(
         const std::string&  output_path,
+        const bool          stream_tiles,
         foundation::Logger& logger);
 
     virtual void release() APPLESEED_OVERRIDE;
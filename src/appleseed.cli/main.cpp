@@ -511,6 +511,15 @@ namespace
         return value == "progressive";
     }
 
+    // Return true if tiles can be streamed to the output file as they are rendered.
+    bool can_stream_tiles(const string& output_path, const ParamArray& params)
+    {
+        return
+            lower_case(bf::path(output_path).extension().string()) == ".exr" &&
+            !is_progressive_render(params) &&
+            params.get_optional<size_t>("passes", 1) == 1;
+    }
+
     bool render(const string& project_filename)
     {
         // Load the project.
@@ -546,6 +555,7 @@ namespace
             tile_callback_factory.reset(
                 new ContinuousSavingTileCallbackFactory(
                     g_cl.m_output.value().c_str(),
+                    can_stream_tiles(g_cl.m_output.value(), params),
                     g_logger));
         }
         else if (project->get_display() == 0)
@@ -612,8 +622,7 @@ namespace
         if (g_cl.m_output.is_set() && !g_cl.m_continuous_saving.is_set())
         {
             LOG_INFO(g_logger, "writing frame to disk...");
-            project->get_frame()->write_main_image(g_cl.m_output.value().c_str());
-            project->get_frame()->write_aov_images(g_cl.m_output.value().c_str());
+            project->get_frame()->write_main_and_aov_images(g_cl.m_output.value().c_str());
         }
         else
         {
@@ -624,10 +633,10 @@ namespace
             if (!output_filename.empty())
             {
                 LOG_INFO(g_logger, "writing frame to disk...");
-                frame->write_main_image(output_filename.c_str());
 
                 if (frame->get_parameters().get_optional<bool>("output_aovs", false))
-                    frame->write_aov_images(output_filename.c_str());
+                    frame->write_main_and_aov_images(output_filename.c_str());
+                else frame->write_main_image(output_filename.c_str());
             }
         }
 
@@ -706,8 +715,7 @@ namespace
         if (g_cl.m_output.is_set())
         {
             const char* file_path = g_cl.m_output.value().c_str();
-            project->get_frame()->write_main_image(file_path);
-            project->get_frame()->write_aov_images(file_path);
+            project->get_frame()->write_main_and_aov_images(file_path);
         }
 
         // Print benchmark results.
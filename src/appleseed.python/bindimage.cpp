@@ -29,6 +29,8 @@
 
 // appleseed.python headers.
 #include "pyseed.h" // has to be first, to avoid redefinition warnings
+#include "bufferprotocol.h"
+#include "gillocks.h"
 
 // appleseed.renderer headers.
 #include "renderer/kernel/aov/imagestack.h"
@@ -65,24 +67,20 @@ namespace
 
     void copy_tile_data_to_py_buffer(const Tile& tile, bpy::object& buffer)
     {
-        void* array = 0;
-        Py_ssize_t len;
+        const ScopedPyBuffer dest(buffer, true);
 
-        const int success = PyObject_AsWriteBuffer(buffer.ptr(), &array, &len);
-
-        if (success != 0)
-            bpy::throw_error_already_set();
-
-        if (static_cast<size_t>(len) < tile.get_size())
+        if (dest.get_size() < tile.get_size())
         {
             PyErr_SetString(PyExc_IndexError, "Buffer size is smaller than data size");
             bpy::throw_error_already_set();
         }
 
+        const ScopedGILUnlock unlock_gil;
+
         std::copy(
             tile.get_storage(),
             tile.get_storage() + tile.get_size(),
-            reinterpret_cast<uint8*>(array));
+            static_cast<uint8*>(dest.get_storage()));
     }
 
     bpy::list blender_tile_data(const Tile& tile)
@@ -109,6 +107,44 @@ namespace
         return pixels;
     }
 
+    // Copy the pixels of the whole image, in scanline order, to a Python buffer.
+    void copy_image_data_to_py_buffer(const Image& image, bpy::object& buffer)
+    {
+        const CanvasProperties& props = image.properties();
+        const ScopedPyBuffer dest(buffer, true);
+
+        if (dest.get_size() < props.m_pixel_count * props.m_pixel_size)
+        {
+            PyErr_SetString(PyExc_IndexError, "Buffer size is smaller than data size");
+            bpy::throw_error_already_set();
+        }
+
+        const ScopedGILUnlock unlock_gil;
+
+        uint8* dest_storage = static_cast<uint8*>(dest.get_storage());
+        const size_t dest_row_size = props.m_canvas_width * props.m_pixel_size;
+
+        for (size_t tile_y = 0; tile_y < props.m_tile_count_y; ++tile_y)
+        {
+            for (size_t tile_x = 0; tile_x < props.m_tile_count_x; ++tile_x)
+            {
+                const Tile& tile = image.tile(tile_x, tile_y);
+                const size_t tile_row_size = tile.get_width() * props.m_pixel_size;
+
+                for (size_t y = 0, height = tile.get_height(); y < height; ++y)
+                {
+                    const uint8* src = tile.get_storage() + y * tile_row_size;
+                    std::copy(
+                        src,
+                        src + tile_row_size,
+                        dest_storage
+                            + (tile_y * props.m_tile_height + y) * dest_row_size
+                            + tile_x * props.m_tile_width * props.m_pixel_size);
+                }
+            }
+        }
+    }
+
     Image* copy_image(const Image* source)
     {
         return new Image(*source);
@@ -178,6 +214,7 @@ void bind_image()
         .def("__deepcopy__", copy_image, bpy::return_value_policy<bpy::manage_new_object>())
         .def("properties", &Image::properties, bpy::return_value_policy<bpy::reference_existing_object>())
         .def("tile", image_get_tile, bpy::return_value_policy<bpy::reference_existing_object>())
+        .def("copy_data_to", copy_image_data_to_py_buffer)
         ;
 
     const Image& (ImageStack::*image_stack_get_image)(const size_t) const = &ImageStack::get_image;
@@ -30,16 +30,20 @@
 // appleseed.python headers.
 #include "pyseed.h" // has to be first, to avoid redefinition warnings
 #include "bindentitycontainers.h"
+#include "bufferprotocol.h"
 #include "dict2dict.h"
+#include "gillocks.h"
 
 // appleseed.renderer headers.
 #include "renderer/api/object.h"
 
 // appleseed.foundation headers.
+#include "foundation/platform/types.h"
 #include "foundation/utility/searchpaths.h"
 
 // Standard headers.
 #include <cstddef>
+#include <memory>
 #include <string>
 
 namespace bpy = boost::python;
@@ -74,6 +78,162 @@ namespace
         object->get_triangle(index) = triangle;
     }
 
+    void set_vertices(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer vertices(buffer, false);
+        vertices.check_floats("MeshObject.set_vertices()", 3);
+
+        const ScopedGILUnlock unlock_gil;
+
+        const size_t vertex_count = vertices.get_element_count() / 3;
+
+        // Existing vertex poses would not match the new vertices.
+        object->clear_vertex_poses();
+        object->clear_vertices();
+        object->reserve_vertices(vertex_count);
+
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            object->push_vertex(
+                GVector3(
+                    vertices.get<GScalar>(i * 3 + 0),
+                    vertices.get<GScalar>(i * 3 + 1),
+                    vertices.get<GScalar>(i * 3 + 2)));
+        }
+    }
+
+    void set_tex_coords(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer tex_coords(buffer, false);
+        tex_coords.check_floats("MeshObject.set_tex_coords()", 2);
+
+        const ScopedGILUnlock unlock_gil;
+
+        const size_t tex_coords_count = tex_coords.get_element_count() / 2;
+
+        object->clear_tex_coords();
+        object->reserve_tex_coords(tex_coords_count);
+
+        for (size_t i = 0; i < tex_coords_count; ++i)
+        {
+            object->push_tex_coords(
+                GVector2(
+                    tex_coords.get<GScalar>(i * 2 + 0),
+                    tex_coords.get<GScalar>(i * 2 + 1)));
+        }
+    }
+
+    // Optional buffers of the same size as the vertex index buffer.
+    const ScopedPyBuffer* acquire_index_buffer(
+        const bpy::object&      buffer,
+        const char*             name,
+        const size_t            expected_count)
+    {
+        if (buffer.is_none())
+            return 0;
+
+        std::auto_ptr<ScopedPyBuffer> indices(new ScopedPyBuffer(buffer, false));
+        indices->check_integers(name, 1);
+
+        if (indices->get_element_count() != expected_count)
+        {
+            PyErr_Format(
+                PyExc_ValueError,
+                "%s: buffer must contain %d indices",
+                name,
+                static_cast<int>(expected_count));
+            bpy::throw_error_already_set();
+        }
+
+        return indices.release();
+    }
+
+    void set_triangles(
+        MeshObject*             object,
+        const bpy::object&      vertex_index_buffer,
+        const bpy::object&      material_index_buffer,
+        const bpy::object&      normal_index_buffer,
+        const bpy::object&      tex_coords_index_buffer)
+    {
+        const ScopedPyBuffer vertex_indices(vertex_index_buffer, false);
+        vertex_indices.check_integers("MeshObject.set_triangles()", 3);
+
+        const size_t triangle_count = vertex_indices.get_element_count() / 3;
+
+        const std::auto_ptr<const ScopedPyBuffer> material_indices(
+            acquire_index_buffer(material_index_buffer, "MeshObject.set_triangles(): material indices", triangle_count));
+        const std::auto_ptr<const ScopedPyBuffer> normal_indices(
+            acquire_index_buffer(normal_index_buffer, "MeshObject.set_triangles(): normal indices", triangle_count * 3));
+        const std::auto_ptr<const ScopedPyBuffer> tex_coords_indices(
+            acquire_index_buffer(tex_coords_index_buffer, "MeshObject.set_triangles(): texture coordinates indices", triangle_count * 3));
+
+        const ScopedGILUnlock unlock_gil;
+
+        object->clear_triangles();
+        object->reserve_triangles(triangle_count);
+
+        for (size_t i = 0; i < triangle_count; ++i)
+        {
+            Triangle triangle(
+                vertex_indices.get<uint32>(i * 3 + 0),
+                vertex_indices.get<uint32>(i * 3 + 1),
+                vertex_indices.get<uint32>(i * 3 + 2),
+                material_indices.get() ? material_indices->get<uint32>(i) : 0);
+
+            if (normal_indices.get())
+            {
+                triangle.m_n0 = normal_indices->get<uint32>(i * 3 + 0);
+                triangle.m_n1 = normal_indices->get<uint32>(i * 3 + 1);
+                triangle.m_n2 = normal_indices->get<uint32>(i * 3 + 2);
+            }
+
+            if (tex_coords_indices.get())
+            {
+                triangle.m_a0 = tex_coords_indices->get<uint32>(i * 3 + 0);
+                triangle.m_a1 = tex_coords_indices->get<uint32>(i * 3 + 1);
+                triangle.m_a2 = tex_coords_indices->get<uint32>(i * 3 + 2);
+            }
+
+            object->push_triangle(triangle);
+        }
+    }
+
+    void set_vertex_poses(
+        MeshObject*             object,
+        const size_t            motion_segment_index,
+        const bpy::object&      buffer)
+    {
+        if (motion_segment_index >= object->get_motion_segment_count())
+        {
+            PyErr_SetString(PyExc_IndexError, "MeshObject.set_vertex_poses(): invalid motion segment index");
+            bpy::throw_error_already_set();
+        }
+
+        const ScopedPyBuffer vertices(buffer, false);
+        vertices.check_floats("MeshObject.set_vertex_poses()", 3);
+
+        const size_t vertex_count = object->get_vertex_count();
+
+        if (vertices.get_element_count() != vertex_count * 3)
+        {
+            PyErr_SetString(PyExc_ValueError, "MeshObject.set_vertex_poses(): buffer size does not match vertex count");
+            bpy::throw_error_already_set();
+        }
+
+        const ScopedGILUnlock unlock_gil;
+
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            object->set_vertex_pose(
+                i,
+                motion_segment_index,
+                GVector3(
+                    vertices.get<GScalar>(i * 3 + 0),
+                    vertices.get<GScalar>(i * 3 + 1),
+                    vertices.get<GScalar>(i * 3 + 2)));
+        }
+    }
+
     bpy::list read_mesh_objects(
         const bpy::list&    search_paths,
         const string&       base_object_name,
@@ -159,6 +319,7 @@ void bind_mesh_object()
         .def("push_vertex", &MeshObject::push_vertex)
         .def("get_vertex_count", &MeshObject::get_vertex_count)
         .def("get_vertex", &MeshObject::get_vertex, bpy::return_value_policy<bpy::reference_existing_object>())
+        .def("set_vertices", set_vertices)
 
         .def("reserve_vertex_normals", &MeshObject::reserve_vertex_normals)
         .def("push_vertex_normal", &MeshObject::push_vertex_normal)
@@ -169,18 +330,25 @@ void bind_mesh_object()
         .def("push_tex_coords", &MeshObject::push_tex_coords)
         .def("get_tex_coords_count", &MeshObject::get_tex_coords_count)
         .def("get_tex_coords", &MeshObject::get_tex_coords)
+        .def("set_tex_coords", set_tex_coords)
 
         .def("reserve_triangles", &MeshObject::reserve_triangles)
         .def("push_triangle", &MeshObject::push_triangle)
         .def("get_triangle_count", &MeshObject::get_triangle_count)
         .def("get_triangle", get_triangle, bpy::return_value_policy<bpy::reference_existing_object>())
         .def("set_triangle", set_triangle)
+        .def("set_triangles", set_triangles,
+            (bpy::arg("vertex_indices"),
+             bpy::arg("material_indices") = bpy::object(),
+             bpy::arg("normal_indices") = bpy::object(),
+             bpy::arg("tex_coords_indices") = bpy::object()))
 
         .def("set_motion_segment_count", &MeshObject::set_motion_segment_count)
         .def("get_motion_segment_count", &MeshObject::get_motion_segment_count)
 
         .def("set_vertex_pose", &MeshObject::set_vertex_pose)
         .def("get_vertex_pose", &MeshObject::get_vertex_pose)
+        .def("set_vertex_poses", set_vertex_poses)
         .def("clear_vertex_poses", &MeshObject::clear_vertex_poses)
 
         .def("set_vertex_normal_pose", &MeshObject::set_vertex_normal_pose)
@@ -95,6 +95,12 @@ namespace
         void default_post_render(const Frame* frame)
         {
         }
+
+        virtual void post_render_tiles(const Frame* frame, const size_t tile_count, const size_t tile_indices[]) APPLESEED_OVERRIDE
+        {
+            // Partial updates are presented to Python as whole frame updates.
+            post_render(frame);
+        }
     };
 }
 
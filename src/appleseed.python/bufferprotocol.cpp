@@ -0,0 +1,150 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "bufferprotocol.h"
+
+namespace bpy = boost::python;
+
+namespace
+{
+    ScopedPyBuffer::ElementType parse_element_type(const char* format, const Py_ssize_t item_size)
+    {
+        // A missing format means unsigned bytes.
+        if (format == 0)
+            return ScopedPyBuffer::ElementTypeUnknown;
+
+        // Native and standard byte orders are the same on all platforms we support.
+        if (*format == '@' || *format == '=' || *format == '<')
+            ++format;
+
+        if (format[0] == '\0' || format[1] != '\0')
+            return ScopedPyBuffer::ElementTypeUnknown;
+
+        switch (format[0])
+        {
+          case 'i':
+          case 'l':
+          case 'q':
+            return
+                item_size == 4 ? ScopedPyBuffer::ElementTypeInt32 :
+                item_size == 8 ? ScopedPyBuffer::ElementTypeInt64 :
+                ScopedPyBuffer::ElementTypeUnknown;
+
+          case 'I':
+          case 'L':
+          case 'Q':
+            return
+                item_size == 4 ? ScopedPyBuffer::ElementTypeUInt32 :
+                item_size == 8 ? ScopedPyBuffer::ElementTypeUInt64 :
+                ScopedPyBuffer::ElementTypeUnknown;
+
+          case 'f':
+            return item_size == 4 ? ScopedPyBuffer::ElementTypeFloat : ScopedPyBuffer::ElementTypeUnknown;
+
+          case 'd':
+            return item_size == 8 ? ScopedPyBuffer::ElementTypeDouble : ScopedPyBuffer::ElementTypeUnknown;
+
+          default:
+            return ScopedPyBuffer::ElementTypeUnknown;
+        }
+    }
+
+    bool is_integer(const ScopedPyBuffer::ElementType type)
+    {
+        return
+            type == ScopedPyBuffer::ElementTypeInt32 ||
+            type == ScopedPyBuffer::ElementTypeUInt32 ||
+            type == ScopedPyBuffer::ElementTypeInt64 ||
+            type == ScopedPyBuffer::ElementTypeUInt64;
+    }
+
+    bool is_float(const ScopedPyBuffer::ElementType type)
+    {
+        return
+            type == ScopedPyBuffer::ElementTypeFloat ||
+            type == ScopedPyBuffer::ElementTypeDouble;
+    }
+}
+
+ScopedPyBuffer::ScopedPyBuffer(
+    const bpy::object&  object,
+    const bool          writable)
+{
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+
+    if (writable)
+        flags |= PyBUF_WRITABLE;
+
+    if (PyObject_GetBuffer(object.ptr(), &m_buffer, flags) != 0)
+        bpy::throw_error_already_set();
+
+    m_element_type = parse_element_type(m_buffer.format, m_buffer.itemsize);
+}
+
+ScopedPyBuffer::~ScopedPyBuffer()
+{
+    PyBuffer_Release(&m_buffer);
+}
+
+void ScopedPyBuffer::check_integers(const char* name, const size_t component_count) const
+{
+    if (!is_integer(m_element_type))
+    {
+        PyErr_Format(PyExc_TypeError, "%s: expected a buffer of 32-bit or 64-bit integers", name);
+        bpy::throw_error_already_set();
+    }
+
+    if (get_element_count() % component_count != 0)
+    {
+        PyErr_Format(
+            PyExc_ValueError,
+            "%s: buffer size must be a multiple of %d",
+            name,
+            static_cast<int>(component_count));
+        bpy::throw_error_already_set();
+    }
+}
+
+void ScopedPyBuffer::check_floats(const char* name, const size_t component_count) const
+{
+    if (!is_float(m_element_type))
+    {
+        PyErr_Format(PyExc_TypeError, "%s: expected a buffer of 32-bit or 64-bit floats", name);
+        bpy::throw_error_already_set();
+    }
+
+    if (get_element_count() % component_count != 0)
+    {
+        PyErr_Format(
+            PyExc_ValueError,
+            "%s: buffer size must be a multiple of %d",
+            name,
+            static_cast<int>(component_count));
+        bpy::throw_error_already_set();
+    }
+}
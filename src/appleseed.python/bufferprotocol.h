@@ -0,0 +1,145 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_PYTHON_BUFFERPROTOCOL_H
+#define APPLESEED_PYTHON_BUFFERPROTOCOL_H
+
+// appleseed.python headers.
+#include "pyseed.h" // has to be first, to avoid redefinition warnings
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/otherwise.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+//
+// This class acquires a C-contiguous view of a Python object implementing the buffer
+// protocol (NumPy arrays, bytearrays, memoryviews...) on construction and releases it
+// on destruction. A Python exception is raised if the object does not support the
+// requested access.
+//
+// Once constructed, the view can be read or written without holding the GIL.
+//
+
+class ScopedPyBuffer
+  : public foundation::NonCopyable
+{
+  public:
+    enum ElementType
+    {
+        ElementTypeUnknown,
+        ElementTypeInt32,
+        ElementTypeUInt32,
+        ElementTypeInt64,
+        ElementTypeUInt64,
+        ElementTypeFloat,
+        ElementTypeDouble
+    };
+
+    // Constructor.
+    ScopedPyBuffer(
+        const boost::python::object&    object,
+        const bool                      writable);
+
+    // Destructor.
+    ~ScopedPyBuffer();
+
+    // Return the size in bytes of the buffer.
+    size_t get_size() const;
+
+    // Return the number of elements in the buffer.
+    size_t get_element_count() const;
+
+    // Return the type of the elements of the buffer.
+    ElementType get_element_type() const;
+
+    // Direct access to the buffer.
+    void* get_storage() const;
+
+    // Raise a Python exception unless elements are integers, or floating-point
+    // numbers, and their count is a multiple of a given number of components.
+    void check_integers(const char* name, const size_t component_count) const;
+    void check_floats(const char* name, const size_t component_count) const;
+
+    // Read an element and convert it to a given type.
+    template <typename T>
+    T get(const size_t index) const;
+
+  private:
+    Py_buffer                           m_buffer;
+    ElementType                         m_element_type;
+};
+
+
+//
+// ScopedPyBuffer class implementation.
+//
+
+inline size_t ScopedPyBuffer::get_size() const
+{
+    return static_cast<size_t>(m_buffer.len);
+}
+
+inline size_t ScopedPyBuffer::get_element_count() const
+{
+    return static_cast<size_t>(m_buffer.len / m_buffer.itemsize);
+}
+
+inline ScopedPyBuffer::ElementType ScopedPyBuffer::get_element_type() const
+{
+    return m_element_type;
+}
+
+inline void* ScopedPyBuffer::get_storage() const
+{
+    return m_buffer.buf;
+}
+
+template <typename T>
+inline T ScopedPyBuffer::get(const size_t index) const
+{
+    assert(index < get_element_count());
+
+    switch (m_element_type)
+    {
+      case ElementTypeInt32:  return static_cast<T>(static_cast<const foundation::int32*>(m_buffer.buf)[index]);
+      case ElementTypeUInt32: return static_cast<T>(static_cast<const foundation::uint32*>(m_buffer.buf)[index]);
+      case ElementTypeInt64:  return static_cast<T>(static_cast<const foundation::int64*>(m_buffer.buf)[index]);
+      case ElementTypeUInt64: return static_cast<T>(static_cast<const foundation::uint64*>(m_buffer.buf)[index]);
+      case ElementTypeFloat:  return static_cast<T>(static_cast<const float*>(m_buffer.buf)[index]);
+      case ElementTypeDouble: return static_cast<T>(static_cast<const double*>(m_buffer.buf)[index]);
+      assert_otherwise;
+    }
+
+    return T(0);
+}
+
+#endif  // !APPLESEED_PYTHON_BUFFERPROTOCOL_H
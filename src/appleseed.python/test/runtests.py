@@ -32,5 +32,6 @@ from testbasis import *
 from testdict2dict import *
 from testentitymap import *
 from testentityvector import *
+from testmeshobject import *
 
 unittest.TestProgram(testRunner=unittest.TextTestRunner())
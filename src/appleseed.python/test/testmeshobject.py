@@ -0,0 +1,103 @@
+
+#
+# This source file is part of appleseed.
+# Visit http://appleseedhq.net/ for additional information and resources.
+#
+# This software is released under the MIT license.
+#
+# Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+import array
+import unittest
+import appleseed as asr
+
+
+class TestMeshObject(unittest.TestCase):
+    """
+    Bulk mesh import tests.
+    """
+
+    def setUp(self):
+        self.mesh = asr.MeshObject("mesh", {})
+
+    def test_set_vertices(self):
+        self.mesh.push_vertex(asr.Vector3f(7.0, 7.0, 7.0))
+        self.mesh.set_vertices(array.array('f', [0.0, 1.0, 2.0, 3.0, 4.0, 5.0]))
+
+        self.assertEqual(self.mesh.get_vertex_count(), 2)
+        self.assertEqual(self.mesh.get_vertex(1), asr.Vector3f(3.0, 4.0, 5.0))
+
+    def test_set_vertices_from_doubles(self):
+        self.mesh.set_vertices(array.array('d', [0.0, 1.0, 2.0]))
+
+        self.assertEqual(self.mesh.get_vertex(0), asr.Vector3f(0.0, 1.0, 2.0))
+
+    def test_set_vertices_rejects_incomplete_vertices(self):
+        with self.assertRaises(ValueError):
+            self.mesh.set_vertices(array.array('f', [0.0, 1.0]))
+
+    def test_set_vertices_rejects_integers(self):
+        with self.assertRaises(TypeError):
+            self.mesh.set_vertices(array.array('i', [0, 1, 2]))
+
+    def test_set_tex_coords(self):
+        self.mesh.set_tex_coords(array.array('f', [0.0, 0.5, 1.0, 0.25]))
+
+        self.assertEqual(self.mesh.get_tex_coords_count(), 2)
+        self.assertEqual(self.mesh.get_tex_coords(1), asr.Vector2f(1.0, 0.25))
+
+    def test_set_triangles(self):
+        self.mesh.set_triangles(
+            array.array('I', [0, 1, 2, 2, 1, 3]),
+            material_indices=array.array('i', [0, 1]),
+            tex_coords_indices=array.array('q', [4, 5, 6, 7, 8, 9]))
+
+        self.assertEqual(self.mesh.get_triangle_count(), 2)
+
+        triangle = self.mesh.get_triangle(1)
+        self.assertEqual((triangle.v0, triangle.v1, triangle.v2), (2, 1, 3))
+        self.assertEqual((triangle.a0, triangle.a1, triangle.a2), (7, 8, 9))
+        self.assertEqual(triangle.pa, 1)
+
+    def test_set_triangles_rejects_mismatched_material_indices(self):
+        with self.assertRaises(ValueError):
+            self.mesh.set_triangles(array.array('I', [0, 1, 2]), array.array('I', [0, 0]))
+
+    def test_set_vertex_poses(self):
+        self.mesh.set_vertices(array.array('f', [0.0, 0.0, 0.0, 1.0, 1.0, 1.0]))
+        self.mesh.set_motion_segment_count(1)
+        self.mesh.set_vertex_poses(0, array.array('f', [0.0, 1.0, 0.0, 1.0, 2.0, 1.0]))
+
+        self.assertEqual(self.mesh.get_vertex_pose(1, 0), asr.Vector3f(1.0, 2.0, 1.0))
+
+    def test_set_vertex_poses_rejects_mismatched_vertex_count(self):
+        self.mesh.set_vertices(array.array('f', [0.0, 0.0, 0.0]))
+        self.mesh.set_motion_segment_count(1)
+
+        with self.assertRaises(ValueError):
+            self.mesh.set_vertex_poses(0, array.array('f', [0.0, 0.0, 0.0, 1.0, 1.0, 1.0]))
+
+    def tearDown(self):
+        pass
+
+if __name__ == "__main__":
+    unittest.main()
@@ -102,6 +102,16 @@ namespace
             emit signal_update();
         }
 
+        virtual void post_render_tiles(
+            const Frame*    frame,
+            const size_t    tile_count,
+            const size_t    tile_indices[]) APPLESEED_OVERRIDE
+        {
+            assert(m_render_widget);
+            m_render_widget->blit_tiles(*frame, tile_count, tile_indices);
+            emit signal_update();
+        }
+
       signals:
         void signal_update();
 
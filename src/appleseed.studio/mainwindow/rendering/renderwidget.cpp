@@ -227,6 +227,26 @@ void RenderWidget::blit_tile(
     blit_tile_no_lock(frame, tile_x, tile_y);
 }
 
+void RenderWidget::blit_tiles(
+    const Frame&    frame,
+    const size_t    tile_count,
+    const size_t    tile_indices[])
+{
+    QMutexLocker locker(&m_mutex);
+
+    const CanvasProperties& frame_props = frame.image().properties();
+
+    allocate_working_storage(frame_props);
+
+    for (size_t i = 0; i < tile_count; ++i)
+    {
+        blit_tile_no_lock(
+            frame,
+            tile_indices[i] % frame_props.m_tile_count_x,
+            tile_indices[i] / frame_props.m_tile_count_x);
+    }
+}
+
 void RenderWidget::blit_frame(const Frame& frame)
 {
     QMutexLocker locker(&m_mutex);
@@ -93,6 +93,12 @@ class RenderWidget
         const size_t            tile_x,
         const size_t            tile_y);
 
+    // Thread-safe.
+    void blit_tiles(
+        const renderer::Frame&  frame,
+        const size_t            tile_count,
+        const size_t            tile_indices[]);
+
     // Thread-safe.
     void blit_frame(const renderer::Frame& frame);
 
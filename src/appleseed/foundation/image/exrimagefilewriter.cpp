@@ -26,14 +26,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 //
-
 // Interface header.
 #include "exrimagefilewriter.h"
 
 // appleseed.foundation headers.
 #include "foundation/core/exceptions/exceptionioerror.h"
 #include "foundation/image/canvasproperties.h"
-#include "foundation/image/exceptionunsupportedimageformat.h"
 #include "foundation/image/exrutils.h"
 #include "foundation/image/icanvas.h"
 #include "foundation/image/pixel.h"
@@ -43,8 +41,6 @@
 #include "foundation/platform/exrheaderguards.h"
 BEGIN_EXR_INCLUDES
 #include "OpenEXR/IexBaseExc.h"
-#include "OpenEXR/ImathBox.h"
-#include "OpenEXR/ImathVec.h"
 #include "OpenEXR/ImfChannelList.h"
 #include "OpenEXR/ImfFrameBuffer.h"
 #include "OpenEXR/ImfHeader.h"
@@ -55,10 +51,10 @@ END_EXR_INCLUDES
 
 // Standard headers.
 #include <cassert>
-#include <cstddef>
+#include <cstring>
+#include <vector>
 
 using namespace Iex;
-using namespace Imath;
 using namespace Imf;
 using namespace std;
 
@@ -69,35 +65,32 @@ namespace foundation
 // EXRImageFileWriter class implementation.
 //
 
-namespace
+void EXRImageFileWriter::write(
+    const char*             filename,
+    const ICanvas&          image,
+    const ImageAttributes&  image_attributes)
 {
-    const char* ChannelName[] = { "R", "G", "B", "A" };
+    const char* layer_name = "";
+    const ICanvas* layer = &image;
+
+    write(filename, 1, &layer_name, &layer, image_attributes);
 }
 
 void EXRImageFileWriter::write(
     const char*             filename,
-    const ICanvas&          image,
+    const size_t            layer_count,
+    const char* const*      layer_names,
+    const ICanvas* const*   layers,
     const ImageAttributes&  image_attributes)
 {
+    assert(layer_count > 0);
+
     initialize_openexr();
 
     try
     {
-        // Retrieve canvas properties.
-        const CanvasProperties& props = image.properties();
-
-        // todo: lift this limitation.
-        assert(props.m_channel_count <= 4);
-
-        // Figure out the pixel type, based on the pixel format of the image.
-        PixelType pixel_type = FLOAT;
-        switch (props.m_pixel_format)
-        {
-          case PixelFormatUInt32: pixel_type = UINT; break;
-          case PixelFormatHalf: pixel_type = HALF; break;
-          case PixelFormatFloat: pixel_type = FLOAT; break;
-          default: throw ExceptionUnsupportedImageFormat();
-        }
+        // All layers share the canvas and tile dimensions of the first one.
+        const CanvasProperties& props = layers[0]->properties();
 
         // Construct TileDescription object.
         const TileDescription tile_desc(
@@ -107,8 +100,18 @@ void EXRImageFileWriter::write(
 
         // Construct ChannelList object.
         ChannelList channels;
-        for (size_t c = 0; c < props.m_channel_count; ++c)
-            channels.insert(ChannelName[c], Channel(pixel_type));
+        vector<PixelType> pixel_types(layer_count);
+        for (size_t i = 0; i < layer_count; ++i)
+        {
+            const CanvasProperties& layer_props = layers[i]->properties();
+            assert(layer_props.m_canvas_width == props.m_canvas_width);
+            assert(layer_props.m_canvas_height == props.m_canvas_height);
+            assert(layer_props.m_tile_width == props.m_tile_width);
+            assert(layer_props.m_tile_height == props.m_tile_height);
+
+            pixel_types[i] = get_exr_pixel_type(layer_props.m_pixel_format);
+            insert_channels(layer_names[i], layer_props.m_channel_count, pixel_types[i], channels);
+        }
 
         // Construct Header object.
         Header header(
@@ -123,39 +126,58 @@ void EXRImageFileWriter::write(
         // Create the output file.
         TiledOutputFile file(filename, header);
 
-        // Write tiles.
-        for (size_t y = 0; y < props.m_tile_count_y; ++y)
+        // Buffers holding one row of tiles of each layer.
+        vector<vector<char> > row_buffers(layer_count);
+        for (size_t i = 0; i < layer_count; ++i)
+            row_buffers[i].resize(layers[i]->properties().m_pixel_size * props.m_canvas_width * props.m_tile_height);
+
+        // Write rows of tiles. OpenEXR compresses the tiles of a row in parallel.
+        for (size_t ty = 0; ty < props.m_tile_count_y; ++ty)
         {
-            for (size_t x = 0; x < props.m_tile_count_x; ++x)
+            const size_t origin_y = ty * props.m_tile_height;
+
+            // Construct FrameBuffer object.
+            FrameBuffer framebuffer;
+            for (size_t i = 0; i < layer_count; ++i)
             {
-                const int ix              = static_cast<int>(x);
-                const int iy              = static_cast<int>(y);
-                const Box2i range         = file.dataWindowForTile(ix, iy);
-                const Tile& tile          = image.tile(x, y);
-                const size_t channel_size = Pixel::size(tile.get_pixel_format());
-                const size_t stride_x     = channel_size * props.m_channel_count;
-                const size_t stride_y     = stride_x * tile.get_width();
-                const size_t tile_origin  = range.min.x * stride_x + range.min.y * stride_y;
-                const char* tile_base     = reinterpret_cast<const char*>(tile.pixel(0, 0)) - tile_origin;
-
-                // Construct FrameBuffer object.
-                FrameBuffer framebuffer;
-                for (size_t c = 0; c < props.m_channel_count; ++c)
+                const CanvasProperties& layer_props = layers[i]->properties();
+                const size_t stride_x = layer_props.m_pixel_size;
+                const size_t stride_y = stride_x * props.m_canvas_width;
+                char* row_buffer = &row_buffers[i][0];
+
+                // Gather the tiles of this row into a contiguous buffer.
+                for (size_t tx = 0; tx < props.m_tile_count_x; ++tx)
                 {
-                    const char* base = tile_base + c * channel_size;
-                    framebuffer.insert(
-                        ChannelName[c],
-                        Slice(
-                            pixel_type,
-                            const_cast<char*>(base),
-                            stride_x,
-                            stride_y));
+                    const Tile& tile = layers[i]->tile(tx, ty);
+                    const size_t tile_row_size = tile.get_width() * stride_x;
+                    const size_t offset_x = tx * props.m_tile_width * stride_x;
+
+                    for (size_t y = 0; y < tile.get_height(); ++y)
+                    {
+                        memcpy(
+                            row_buffer + y * stride_y + offset_x,
+                            tile.pixel(0, y),
+                            tile_row_size);
+                    }
                 }
 
-                // Write tile.
-                file.setFrameBuffer(framebuffer);
-                file.writeTile(ix, iy);
+                insert_slices(
+                    layer_names[i],
+                    layer_props.m_channel_count,
+                    pixel_types[i],
+                    row_buffer - origin_y * stride_y,
+                    stride_x,
+                    stride_y,
+                    framebuffer);
             }
+
+            // Write the row of tiles.
+            file.setFrameBuffer(framebuffer);
+            file.writeTiles(
+                0,
+                static_cast<int>(props.m_tile_count_x - 1),
+                static_cast<int>(ty),
+                static_cast<int>(ty));
         }
     }
     catch (const BaseExc& e)
@@ -37,6 +37,9 @@
 // appleseed.main headers.
 #include "main/dllsymbol.h"
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
 namespace foundation    { class ICanvas; }
 
@@ -57,6 +60,12 @@ namespace foundation
 //
 // Reference: openexr/ImfStandardAttributes.h
 //
+// Images are written one row of tiles at a time so that OpenEXR can compress
+// the tiles of a row in parallel. Several images can be written as the layers
+// of a single multi-channel file: the channels of a layer named "diffuse" are
+// stored as "diffuse.R", "diffuse.G", etc. while the channels of a layer with
+// an empty name are stored as "R", "G", etc.
+//
 
 class APPLESEED_DLLSYMBOL EXRImageFileWriter
   : public IImageFileWriter
@@ -67,6 +76,15 @@ class APPLESEED_DLLSYMBOL EXRImageFileWriter
         const char*             filename,
         const ICanvas&          image,
         const ImageAttributes&  image_attributes = ImageAttributes());
+
+    // Write multiple images as the layers of a single OpenEXR image file.
+    // All images must have the same canvas and tile dimensions.
+    void write(
+        const char*             filename,
+        const size_t            layer_count,
+        const char* const*      layer_names,
+        const ICanvas* const*   layers,
+        const ImageAttributes&  image_attributes = ImageAttributes());
 };
 
 }       // namespace foundation
@@ -31,6 +31,7 @@
 #include "exrutils.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/exceptionunsupportedimageformat.h"
 #include "foundation/image/imageattributes.h"
 #include "foundation/platform/system.h"
 #include "foundation/utility/containers/dictionary.h"
@@ -40,12 +41,14 @@
 // OpenEXR headers.
 #include "foundation/platform/exrheaderguards.h"
 BEGIN_EXR_INCLUDES
+#include "OpenEXR/ImfChannelList.h"
 #include "OpenEXR/ImfStandardAttributes.h"
 #include "OpenEXR/ImfStringAttribute.h"
 #include "OpenEXR/ImfThreading.h"
 END_EXR_INCLUDES
 
 // Standard headers.
+#include <cassert>
 #include <string>
 
 using namespace Imf;
@@ -98,4 +101,66 @@ void add_attributes(
     }
 }
 
+PixelType get_exr_pixel_type(const PixelFormat pixel_format)
+{
+    switch (pixel_format)
+    {
+      case PixelFormatUInt32: return UINT;
+      case PixelFormatHalf: return HALF;
+      case PixelFormatFloat: return FLOAT;
+      default: throw ExceptionUnsupportedImageFormat();
+    }
+}
+
+string get_exr_channel_name(
+    const char*             layer_name,
+    const size_t            channel_index)
+{
+    static const char* ChannelName[] = { "R", "G", "B", "A" };
+
+    const string channel_name =
+        channel_index < 4
+            ? ChannelName[channel_index]
+            : "C" + to_string(channel_index);
+
+    return
+        layer_name == 0 || layer_name[0] == '\0'
+            ? channel_name
+            : string(layer_name) + "." + channel_name;
+}
+
+void insert_channels(
+    const char*             layer_name,
+    const size_t            channel_count,
+    const PixelType         pixel_type,
+    ChannelList&            channels)
+{
+    for (size_t c = 0; c < channel_count; ++c)
+        channels.insert(get_exr_channel_name(layer_name, c), Channel(pixel_type));
+}
+
+void insert_slices(
+    const char*             layer_name,
+    const size_t            channel_count,
+    const PixelType         pixel_type,
+    const char*             base,
+    const size_t            stride_x,
+    const size_t            stride_y,
+    FrameBuffer&            framebuffer)
+{
+    const size_t channel_size = pixel_type == HALF ? 2 : 4;
+    assert(stride_x >= channel_count * channel_size);
+
+    for (size_t c = 0; c < channel_count; ++c)
+    {
+        framebuffer.insert(
+            get_exr_channel_name(layer_name, c),
+            Slice(
+                pixel_type,
+                const_cast<char*>(base + c * channel_size),
+                stride_x,
+                stride_y));
+    }
+}
+
 }   // namespace foundation
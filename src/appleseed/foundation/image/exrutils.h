@@ -30,12 +30,21 @@
 #ifndef APPLESEED_FOUNDATION_IMAGE_EXRUTILS_H
 #define APPLESEED_FOUNDATION_IMAGE_EXRUTILS_H
 
+// appleseed.foundation headers.
+#include "foundation/image/pixel.h"
+
 // OpenEXR headers.
 #include "foundation/platform/exrheaderguards.h"
 BEGIN_EXR_INCLUDES
+#include "OpenEXR/ImfFrameBuffer.h"
 #include "OpenEXR/ImfHeader.h"
+#include "OpenEXR/ImfPixelType.h"
 END_EXR_INCLUDES
 
+// Standard headers.
+#include <cstddef>
+#include <string>
+
 // Forward declarations.
 namespace foundation    { class ImageAttributes; }
 
@@ -50,6 +59,34 @@ void add_attributes(
     const ImageAttributes&  image_attributes,
     Imf::Header&            header);
 
+// Return the OpenEXR pixel type of a given pixel format.
+// Throws a foundation::ExceptionUnsupportedImageFormat exception if there is none.
+Imf::PixelType get_exr_pixel_type(const PixelFormat pixel_format);
+
+// Return the name of a channel of a layer, e.g. "R" for the first channel of the
+// unnamed layer or "diffuse.G" for the second channel of the "diffuse" layer.
+std::string get_exr_channel_name(
+    const char*             layer_name,
+    const size_t            channel_index);
+
+// Add the channels of a layer to an OpenEXR ChannelList object.
+void insert_channels(
+    const char*             layer_name,
+    const size_t            channel_count,
+    const Imf::PixelType    pixel_type,
+    Imf::ChannelList&       channels);
+
+// Add to an OpenEXR FrameBuffer object the slices of the channels of a layer
+// whose pixels are interleaved. base is the address of pixel (0, 0) of the file.
+void insert_slices(
+    const char*             layer_name,
+    const size_t            channel_count,
+    const Imf::PixelType    pixel_type,
+    const char*             base,
+    const size_t            stride_x,
+    const size_t            stride_y,
+    Imf::FrameBuffer&       framebuffer);
+
 }       // namespace foundation
 
 #endif  // !APPLESEED_FOUNDATION_IMAGE_EXRUTILS_H
@@ -32,6 +32,9 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/scalar.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
 #include "foundation/platform/types.h"
 #include "foundation/utility/otherwise.h"
 
@@ -551,9 +554,36 @@ inline void Pixel::convert_to_format<float>(
     {
       case PixelFormatUInt8:                // lossy float -> uint8
         {
-            // todo: optimize this case using SSE?
             uint8* typed_dest = reinterpret_cast<uint8*>(dest);
-            for (const float* it = src_begin; it < src_end; it += src_stride)
+            const float* it = src_begin;
+
+#ifdef APPLESEED_USE_SSE
+            // Convert contiguous runs of 16 values at a time.
+            if (src_stride == 1 && dest_stride == 1)
+            {
+                const __m128 scale = _mm_set1_ps(256.0f);
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 max_value = _mm_set1_ps(255.0f);
+
+                for (; it + 16 <= src_end; it += 16, typed_dest += 16)
+                {
+                    const __m128i i0 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(it +  0), scale), zero), max_value));
+                    const __m128i i1 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(it +  4), scale), zero), max_value));
+                    const __m128i i2 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(it +  8), scale), zero), max_value));
+                    const __m128i i3 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(it + 12), scale), zero), max_value));
+
+                    // Values are in [0, 255], saturating packs are exact.
+                    const __m128i packed =
+                        _mm_packus_epi16(
+                            _mm_packs_epi32(i0, i1),
+                            _mm_packs_epi32(i2, i3));
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(typed_dest), packed);
+                }
+            }
+#endif
+
+            for (; it < src_end; it += src_stride)
             {
                 const float val = clamp(*it * 256.0f, 0.0f, 255.0f);
                 *typed_dest = truncate<uint8>(val);
@@ -0,0 +1,243 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Interface header.
+#include "progressiveexrimagefilewriter.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/exrutils.h"
+#include "foundation/image/tile.h"
+#include "foundation/platform/thread.h"
+
+// OpenEXR headers.
+#include "foundation/platform/exrheaderguards.h"
+BEGIN_EXR_INCLUDES
+#include "OpenEXR/IexBaseExc.h"
+#include "OpenEXR/ImathBox.h"
+#include "OpenEXR/ImfChannelList.h"
+#include "OpenEXR/ImfFrameBuffer.h"
+#include "OpenEXR/ImfHeader.h"
+#include "OpenEXR/ImfLineOrder.h"
+#include "OpenEXR/ImfPixelType.h"
+#include "OpenEXR/ImfTileDescription.h"
+#include "OpenEXR/ImfTiledOutputFile.h"
+END_EXR_INCLUDES
+
+// Standard headers.
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Iex;
+using namespace Imath;
+using namespace Imf;
+using namespace std;
+
+namespace foundation
+{
+
+//
+// ProgressiveEXRImageFileWriter class implementation.
+//
+
+struct ProgressiveEXRImageFileWriter::Impl
+{
+    mutable boost::mutex        m_mutex;
+    auto_ptr<TiledOutputFile>   m_file;
+    vector<string>              m_layer_names;
+    vector<size_t>              m_channel_counts;
+    vector<PixelType>           m_pixel_types;
+    size_t                      m_written_tile_count;
+};
+
+ProgressiveEXRImageFileWriter::ProgressiveEXRImageFileWriter()
+  : impl(new Impl())
+{
+    impl->m_written_tile_count = 0;
+}
+
+ProgressiveEXRImageFileWriter::~ProgressiveEXRImageFileWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const ExceptionIOError&)
+    {
+        // Destructors must not throw.
+    }
+
+    delete impl;
+}
+
+void ProgressiveEXRImageFileWriter::open(
+    const char*                 filename,
+    const size_t                layer_count,
+    const char* const*          layer_names,
+    const CanvasProperties*     layer_props,
+    const ImageAttributes&      image_attributes)
+{
+    assert(filename);
+    assert(layer_count > 0);
+    assert(!is_open());
+
+    initialize_openexr();
+
+    try
+    {
+        // All layers share the canvas and tile dimensions of the first one.
+        const CanvasProperties& props = layer_props[0];
+
+        // Construct TileDescription object.
+        const TileDescription tile_desc(
+            static_cast<unsigned int>(props.m_tile_width),
+            static_cast<unsigned int>(props.m_tile_height),
+            ONE_LEVEL);
+
+        // Construct ChannelList object.
+        ChannelList channels;
+        impl->m_layer_names.clear();
+        impl->m_channel_counts.clear();
+        impl->m_pixel_types.clear();
+        for (size_t i = 0; i < layer_count; ++i)
+        {
+            assert(layer_props[i].m_canvas_width == props.m_canvas_width);
+            assert(layer_props[i].m_canvas_height == props.m_canvas_height);
+            assert(layer_props[i].m_tile_width == props.m_tile_width);
+            assert(layer_props[i].m_tile_height == props.m_tile_height);
+
+            const PixelType pixel_type = get_exr_pixel_type(layer_props[i].m_pixel_format);
+            insert_channels(layer_names[i], layer_props[i].m_channel_count, pixel_type, channels);
+
+            impl->m_layer_names.push_back(layer_names[i]);
+            impl->m_channel_counts.push_back(layer_props[i].m_channel_count);
+            impl->m_pixel_types.push_back(pixel_type);
+        }
+
+        // Construct Header object. Tiles are stored in the order they are written.
+        Header header(
+            static_cast<int>(props.m_canvas_width),
+            static_cast<int>(props.m_canvas_height));
+        header.setTileDescription(tile_desc);
+        header.channels() = channels;
+        header.lineOrder() = RANDOM_Y;
+
+        // Add image attributes to the Header object.
+        add_attributes(image_attributes, header);
+
+        // Create the output file.
+        impl->m_file.reset(new TiledOutputFile(filename, header));
+        impl->m_written_tile_count = 0;
+    }
+    catch (const BaseExc& e)
+    {
+        // I/O error.
+        throw ExceptionIOError(e.what());
+    }
+}
+
+bool ProgressiveEXRImageFileWriter::is_open() const
+{
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+    return impl->m_file.get() != 0;
+}
+
+void ProgressiveEXRImageFileWriter::write_tile(
+    const size_t                tile_x,
+    const size_t                tile_y,
+    const Tile* const*          layer_tiles)
+{
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+
+    assert(impl->m_file.get());
+
+    try
+    {
+        const int ix = static_cast<int>(tile_x);
+        const int iy = static_cast<int>(tile_y);
+        const Box2i range = impl->m_file->dataWindowForTile(ix, iy);
+
+        // Construct FrameBuffer object.
+        FrameBuffer framebuffer;
+        for (size_t i = 0, e = impl->m_layer_names.size(); i < e; ++i)
+        {
+            const Tile& tile = *layer_tiles[i];
+            const size_t stride_x = impl->m_channel_counts[i] * Pixel::size(tile.get_pixel_format());
+            const size_t stride_y = stride_x * tile.get_width();
+            const size_t tile_origin = range.min.x * stride_x + range.min.y * stride_y;
+
+            insert_slices(
+                impl->m_layer_names[i].c_str(),
+                impl->m_channel_counts[i],
+                impl->m_pixel_types[i],
+                reinterpret_cast<const char*>(tile.pixel(0, 0)) - tile_origin,
+                stride_x,
+                stride_y,
+                framebuffer);
+        }
+
+        // Write tile.
+        impl->m_file->setFrameBuffer(framebuffer);
+        impl->m_file->writeTile(ix, iy);
+
+        ++impl->m_written_tile_count;
+    }
+    catch (const BaseExc& e)
+    {
+        // I/O error.
+        throw ExceptionIOError(e.what());
+    }
+}
+
+size_t ProgressiveEXRImageFileWriter::get_written_tile_count() const
+{
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+    return impl->m_written_tile_count;
+}
+
+void ProgressiveEXRImageFileWriter::close()
+{
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+
+    try
+    {
+        // The file is finalized when the TiledOutputFile object is destroyed.
+        impl->m_file.reset();
+    }
+    catch (const BaseExc& e)
+    {
+        // I/O error.
+        throw ExceptionIOError(e.what());
+    }
+}
+
+}   // namespace foundation
@@ -0,0 +1,99 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_FOUNDATION_IMAGE_PROGRESSIVEEXRIMAGEFILEWRITER_H
+#define APPLESEED_FOUNDATION_IMAGE_PROGRESSIVEEXRIMAGEFILEWRITER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/imageattributes.h"
+
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
+// Standard headers.
+#include <cstddef>
+
+// Forward declarations.
+namespace foundation    { class CanvasProperties; }
+namespace foundation    { class Tile; }
+
+namespace foundation
+{
+
+//
+// OpenEXR image file writer allowing to write tiles as soon as they are available.
+//
+// Layers follow the same conventions as with foundation::EXRImageFileWriter.
+// Tiles may be written in any order and from multiple threads. Each tile must
+// be written exactly once; the file is incomplete until it is closed.
+//
+
+class APPLESEED_DLLSYMBOL ProgressiveEXRImageFileWriter
+  : public NonCopyable
+{
+  public:
+    // Constructor.
+    ProgressiveEXRImageFileWriter();
+
+    // Destructor, closes the file if it is still open.
+    ~ProgressiveEXRImageFileWriter();
+
+    // Create an OpenEXR image file and prepare it for writing tiles.
+    // All layers must have the same canvas and tile dimensions.
+    void open(
+        const char*                 filename,
+        const size_t                layer_count,
+        const char* const*          layer_names,
+        const CanvasProperties*     layer_props,
+        const ImageAttributes&      image_attributes = ImageAttributes());
+
+    // Return true if a file is open.
+    bool is_open() const;
+
+    // Write a given tile of all layers. This method is thread-safe.
+    void write_tile(
+        const size_t                tile_x,
+        const size_t                tile_y,
+        const Tile* const*          layer_tiles);
+
+    // Return the number of tiles written so far.
+    size_t get_written_tile_count() const;
+
+    // Close the file.
+    void close();
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_IMAGE_PROGRESSIVEEXRIMAGEFILEWRITER_H
@@ -0,0 +1,361 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/bvh/bvh_intersector.h"
+#include "foundation/math/bvh/bvh_statistics.h"
+#include "foundation/math/ray.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// BVH packet intersector.
+//
+// Traverses a BVH with a packet of up to PacketSize rays at once. Each node is fetched
+// once for the whole packet and tested against all the rays that are still active in
+// this branch of the hierarchy; rays are kept in SoA layout during traversal so that
+// bounding box tests vectorize well. Best suited to coherent rays such as camera rays.
+//
+// The Visitor class must conform to the following prototype:
+//
+//      class Visitor
+//        : public foundation::NonCopyable
+//      {
+//        public:
+//          // Visit a leaf with the rays whose bit is set in 'active_mask'.
+//          // Return the mask of rays for which traversal should continue.
+//          // 'distances[i]' should be set to the distance to the closest hit so far
+//          // for each active ray i.
+//          size_t visit(
+//              const NodeType&             node,
+//              const RayType               rays[],
+//              const RayInfoType           ray_infos[],
+//              const size_t                active_mask,
+//              ValueType                   distances[]
+//      #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+//              , TraversalStatistics&      stats
+//      #endif
+//              );
+//      };
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t PacketSize,
+    size_t StackSize = 64
+>
+class PacketIntersector
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+    typedef Ray RayType;
+    typedef RayInfo<ValueType, AABBType::Dimension> RayInfoType;
+
+    static const size_t Dimension = AABBType::Dimension;
+
+    // Return a mask with the bits of the first 'ray_count' rays set.
+    static size_t make_mask(const size_t ray_count);
+
+    // Intersect a packet of rays with a given BVH without motion.
+    // Rays whose bit is not set in 'active_mask' are ignored.
+    void intersect_no_motion(
+        const Tree&             tree,
+        const RayType           rays[],
+        const RayInfoType       ray_infos[],
+        const size_t            active_mask,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+  private:
+    struct RayPacket
+    {
+        ValueType   m_org[Dimension][PacketSize];
+        ValueType   m_rcp_dir[Dimension][PacketSize];
+        bool        m_positive_dir[Dimension][PacketSize];
+        ValueType   m_tmin[PacketSize];
+        ValueType   m_tmax[PacketSize];
+    };
+
+    struct StackEntry
+    {
+        const NodeType* m_node;
+        size_t          m_mask;
+    };
+
+    // Intersect a bounding box with the rays of a packet, return the mask of rays that hit it.
+    static size_t intersect_bbox(
+        const RayPacket&        packet,
+        const AABBType&         bbox,
+        const size_t            mask,
+        ValueType               tmin[PacketSize]);
+};
+
+
+//
+// PacketIntersector class implementation.
+//
+
+template <typename Tree, typename Visitor, typename Ray, size_t PacketSize, size_t StackSize>
+inline size_t PacketIntersector<Tree, Visitor, Ray, PacketSize, StackSize>::make_mask(const size_t ray_count)
+{
+    assert(ray_count <= PacketSize);
+    return ray_count < sizeof(size_t) * 8 ? (size_t(1) << ray_count) - 1 : ~size_t(0);
+}
+
+template <typename Tree, typename Visitor, typename Ray, size_t PacketSize, size_t StackSize>
+inline size_t PacketIntersector<Tree, Visitor, Ray, PacketSize, StackSize>::intersect_bbox(
+    const RayPacket&            packet,
+    const AABBType&             bbox,
+    const size_t                mask,
+    ValueType                   tmin[PacketSize])
+{
+    size_t hits = 0;
+
+    for (size_t i = 0; i < PacketSize; ++i)
+    {
+        ValueType lo = packet.m_tmin[i];
+        ValueType hi = packet.m_tmax[i];
+
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            const ValueType near_plane = packet.m_positive_dir[d][i] ? bbox.min[d] : bbox.max[d];
+            const ValueType far_plane = packet.m_positive_dir[d][i] ? bbox.max[d] : bbox.min[d];
+            const ValueType t_near = (near_plane - packet.m_org[d][i]) * packet.m_rcp_dir[d][i];
+            const ValueType t_far = (far_plane - packet.m_org[d][i]) * packet.m_rcp_dir[d][i];
+            lo = t_near > lo ? t_near : lo;
+            hi = t_far < hi ? t_far : hi;
+        }
+
+        tmin[i] = lo;
+
+        if (lo <= hi)
+            hits |= size_t(1) << i;
+    }
+
+    return hits & mask;
+}
+
+template <typename Tree, typename Visitor, typename Ray, size_t PacketSize, size_t StackSize>
+void PacketIntersector<Tree, Visitor, Ray, PacketSize, StackSize>::intersect_no_motion(
+    const Tree&                 tree,
+    const RayType               rays[],
+    const RayInfoType           ray_infos[],
+    const size_t                active_mask,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    // Make sure the tree was built.
+    assert(!tree.m_nodes.empty());
+
+    // Load the rays in SoA layout. Inactive rays are given an empty interval.
+    RayPacket packet;
+    for (size_t i = 0; i < PacketSize; ++i)
+    {
+        if (active_mask & (size_t(1) << i))
+        {
+            for (size_t d = 0; d < Dimension; ++d)
+            {
+                packet.m_org[d][i] = rays[i].m_org[d];
+                packet.m_rcp_dir[d][i] = ray_infos[i].m_rcp_dir[d];
+                packet.m_positive_dir[d][i] = ray_infos[i].m_sgn_dir[d] != 0;
+            }
+
+            packet.m_tmin[i] = rays[i].m_tmin;
+            packet.m_tmax[i] = rays[i].m_tmax;
+        }
+        else
+        {
+            for (size_t d = 0; d < Dimension; ++d)
+            {
+                packet.m_org[d][i] = ValueType(0.0);
+                packet.m_rcp_dir[d][i] = ValueType(1.0);
+                packet.m_positive_dir[d][i] = true;
+            }
+
+            packet.m_tmin[i] = ValueType(1.0);
+            packet.m_tmax[i] = ValueType(0.0);
+        }
+    }
+
+    // Node stack.
+    StackEntry stack[StackSize];
+    StackEntry* stack_ptr = stack;
+
+    // Current node and rays active in the current branch.
+    const NodeType* node_ptr = &tree.m_nodes[0];
+    size_t node_mask = active_mask;
+
+    // Rays for which traversal hasn't been terminated by the visitor.
+    size_t alive_mask = active_mask;
+
+    // Initialize traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(++stats.m_traversal_count);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_nodes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_leaves = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t intersected_bboxes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t discarded_nodes = 0);
+
+    // Traverse the tree and intersect leaf nodes.
+    while (node_mask != 0)
+    {
+        // Fetch the node.
+        FOUNDATION_BVH_TRAVERSAL_STATS(++visited_nodes);
+
+        if (node_ptr->is_interior())
+        {
+            FOUNDATION_BVH_TRAVERSAL_STATS(intersected_bboxes += 2);
+
+            // Intersect both child bounding boxes with all active rays.
+            ValueType tmin_left[PacketSize];
+            ValueType tmin_right[PacketSize];
+            const size_t left_mask = intersect_bbox(packet, node_ptr->get_left_bbox(), node_mask, tmin_left);
+            const size_t right_mask = intersect_bbox(packet, node_ptr->get_right_bbox(), node_mask, tmin_right);
+
+            const NodeType* left_ptr = &tree.m_nodes[node_ptr->get_child_node_index()];
+
+            if (left_mask != 0 && right_mask != 0)
+            {
+                // Visit first the child node that is closer for most rays hitting both children.
+                const size_t both_mask = left_mask & right_mask;
+                size_t both_count = 0;
+                size_t left_first_count = 0;
+                for (size_t i = 0; i < PacketSize; ++i)
+                {
+                    if (both_mask & (size_t(1) << i))
+                    {
+                        ++both_count;
+                        if (tmin_left[i] <= tmin_right[i])
+                            ++left_first_count;
+                    }
+                }
+
+                // Push the far child node to the stack, continue with the near child node.
+                assert(stack_ptr < stack + StackSize);
+                if (2 * left_first_count >= both_count)
+                {
+                    stack_ptr->m_node = left_ptr + 1;
+                    stack_ptr->m_mask = right_mask;
+                    node_ptr = left_ptr;
+                    node_mask = left_mask;
+                }
+                else
+                {
+                    stack_ptr->m_node = left_ptr;
+                    stack_ptr->m_mask = left_mask;
+                    node_ptr = left_ptr + 1;
+                    node_mask = right_mask;
+                }
+                ++stack_ptr;
+                continue;
+            }
+
+            if (left_mask != 0 || right_mask != 0)
+            {
+                // Continue with the left or right child node.
+                FOUNDATION_BVH_TRAVERSAL_STATS(++discarded_nodes);
+                node_ptr = left_mask != 0 ? left_ptr : left_ptr + 1;
+                node_mask = left_mask | right_mask;
+                continue;
+            }
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += 2);
+        }
+        else
+        {
+            // Visit the leaf.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_leaves);
+            ValueType distances[PacketSize];
+            const size_t proceed_mask =
+                visitor.visit(
+                    *node_ptr,
+                    rays,
+                    ray_infos,
+                    node_mask,
+                    distances
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+
+            // Terminate traversal for the rays the visitor decided so.
+            alive_mask &= ~(node_mask & ~proceed_mask);
+
+            // Keep track of the distance to the closest intersection.
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                if ((node_mask & proceed_mask) & (size_t(1) << i))
+                {
+                    assert(distances[i] >= ValueType(0.0));
+                    if (packet.m_tmax[i] > distances[i])
+                        packet.m_tmax[i] = distances[i];
+                }
+            }
+        }
+
+        // Pop the next node with live rays from the stack.
+        node_mask = 0;
+        while (stack_ptr > stack && node_mask == 0)
+        {
+            --stack_ptr;
+            node_ptr = stack_ptr->m_node;
+            node_mask = stack_ptr->m_mask & alive_mask;
+        }
+    }
+
+    // Store traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_nodes.insert(visited_nodes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_leaves.insert(visited_leaves));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_bboxes.insert(intersected_bboxes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_discarded_nodes.insert(discarded_nodes));
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
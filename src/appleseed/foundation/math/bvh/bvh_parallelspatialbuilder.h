@@ -0,0 +1,503 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELSPATIALBUILDER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELSPATIALBUILDER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class Logger; }
+
+namespace foundation {
+namespace bvh {
+
+//
+// Multithreaded variant of foundation::bvh::SpatialBuilder.
+//
+// The top of the tree is built on the calling thread, with the splitting planes of
+// large leaves searched in all dimensions in parallel. Once there are enough leaves
+// to keep all threads busy, each one is turned into a subtree by a separate job and
+// the subtrees are stitched back together. Split decisions only depend on the items
+// of a leaf, so the resulting tree is the same as the one of the sequential builder
+// up to the order of the nodes in memory.
+//
+// In addition to the prototype documented in bvh_spatialbuilder.h, the Partitioner
+// class must conform to the following prototype:
+//
+//      class Partitioner
+//        : public foundation::NonCopyable
+//      {
+//        public:
+//          // Per-thread scratch memory.
+//          struct Workspace;
+//
+//          // Prepare a workspace for use with split().
+//          void init_workspace(Workspace& workspace) const;
+//
+//          // Thread-safe variant of split().
+//          bool split(
+//              LeafType&           leaf,
+//              const AABBType&     leaf_bbox,
+//              LeafType&           left_leaf,
+//              AABBType&           left_leaf_bbox,
+//              LeafType&           right_leaf,
+//              AABBType&           right_leaf_bbox,
+//              Workspace&          workspace,
+//              JobQueue*           job_queue) const;
+//
+//          // Accumulate the statistics of a workspace.
+//          void merge_workspace(const Workspace& workspace);
+//      };
+//
+
+template <typename Tree, typename Partitioner>
+class ParallelSpatialBuilder
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::NodeVectorType NodeVectorType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename Partitioner::LeafType LeafType;
+    typedef typename Partitioner::Workspace WorkspaceType;
+
+    // Number of subtrees per thread, for load balancing.
+    static const size_t SubtreesPerThread = 4;
+
+    // Leaves with less items than this are never split on the calling thread.
+    static const size_t MinSubtreeSize = 1024;
+
+    // Constructor.
+    ParallelSpatialBuilder(
+        Logger&             logger,
+        const size_t        thread_count);
+
+    // Build a tree.
+    template <typename Timer>
+    void build(
+        Tree&               tree,
+        Partitioner&        partitioner,
+        LeafType*           root_leaf,
+        const AABBType&     root_leaf_bbox);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+    // Return the number of threads used during construction.
+    size_t get_thread_count() const;
+
+    // Return the number of subtrees built in parallel during the last construction.
+    size_t get_subtree_count() const;
+
+  private:
+    typedef std::vector<const LeafType*> LeafVector;
+
+    struct PendingLeaf
+    {
+        LeafType*           m_leaf;
+        AABBType            m_bbox;
+        size_t              m_node_index;
+    };
+
+    struct Subtree
+    {
+        NodeVectorType      m_nodes;
+        LeafVector          m_leaves;
+    };
+
+    class SubtreeJob;
+
+    Logger&                 m_logger;
+    const size_t            m_thread_count;
+    double                  m_build_time;
+    size_t                  m_subtree_count;
+
+    // Recursively subdivide a subtree.
+    static void subdivide_recurse(
+        NodeVectorType&     nodes,
+        const Partitioner&  partitioner,
+        WorkspaceType&      workspace,
+        LeafVector&         leaves,
+        LeafType*           leaf,
+        const AABBType&     leaf_bbox,
+        const size_t        leaf_node_index);
+};
+
+
+//
+// ParallelSpatialBuilder class implementation.
+//
+
+template <typename Tree, typename Partitioner>
+class ParallelSpatialBuilder<Tree, Partitioner>::SubtreeJob
+  : public IJob
+{
+  public:
+    SubtreeJob(
+        const Partitioner&              partitioner,
+        std::vector<WorkspaceType>&     workspaces,
+        const PendingLeaf&              pending_leaf,
+        Subtree&                        subtree)
+      : m_partitioner(partitioner)
+      , m_workspaces(workspaces)
+      , m_pending_leaf(pending_leaf)
+      , m_subtree(subtree)
+    {
+    }
+
+    virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+    {
+        assert(thread_index < m_workspaces.size());
+
+        m_subtree.m_nodes.push_back(NodeType());
+
+        subdivide_recurse(
+            m_subtree.m_nodes,
+            m_partitioner,
+            m_workspaces[thread_index],
+            m_subtree.m_leaves,
+            m_pending_leaf.m_leaf,
+            m_pending_leaf.m_bbox,
+            0);
+    }
+
+  private:
+    const Partitioner&                  m_partitioner;
+    std::vector<WorkspaceType>&         m_workspaces;
+    const PendingLeaf                   m_pending_leaf;
+    Subtree&                            m_subtree;
+};
+
+template <typename Tree, typename Partitioner>
+ParallelSpatialBuilder<Tree, Partitioner>::ParallelSpatialBuilder(
+    Logger&                 logger,
+    const size_t            thread_count)
+  : m_logger(logger)
+  , m_thread_count(std::max<size_t>(thread_count, 1))
+  , m_build_time(0.0)
+  , m_subtree_count(0)
+{
+}
+
+template <typename Tree, typename Partitioner>
+template <typename Timer>
+void ParallelSpatialBuilder<Tree, Partitioner>::build(
+    Tree&                   tree,
+    Partitioner&            partitioner,
+    LeafType*               root_leaf,
+    const AABBType&         root_leaf_bbox)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    // Clear the tree.
+    tree.m_nodes.clear();
+
+    // Create the root node of the tree.
+    tree.m_nodes.push_back(NodeType());
+
+    // Start the worker threads.
+    JobQueue job_queue;
+    JobManager job_manager(
+        m_logger,
+        job_queue,
+        m_thread_count,
+        JobManager::KeepRunningOnEmptyQueue);
+    job_manager.start();
+
+    // One workspace per worker thread, plus one for the calling thread.
+    std::vector<WorkspaceType> workspaces(m_thread_count + 1);
+    for (size_t i = 0; i < workspaces.size(); ++i)
+        partitioner.init_workspace(workspaces[i]);
+
+    // Split the largest leaves on the calling thread until there are enough of them.
+    LeafVector leaves;
+    std::vector<PendingLeaf> pending_leaves;
+    const PendingLeaf root_pending_leaf = { root_leaf, root_leaf_bbox, 0 };
+    pending_leaves.push_back(root_pending_leaf);
+    const size_t max_subtree_count = m_thread_count > 1 ? m_thread_count * SubtreesPerThread : 1;
+    while (!pending_leaves.empty() && pending_leaves.size() < max_subtree_count)
+    {
+        size_t largest = 0;
+        for (size_t i = 1; i < pending_leaves.size(); ++i)
+        {
+            if (pending_leaves[largest].m_leaf->size() < pending_leaves[i].m_leaf->size())
+                largest = i;
+        }
+
+        if (pending_leaves[largest].m_leaf->size() < MinSubtreeSize)
+            break;
+
+        const PendingLeaf pending_leaf = pending_leaves[largest];
+        pending_leaves.erase(pending_leaves.begin() + largest);
+
+        // Try to split the leaf.
+        LeafType* left_leaf = new LeafType();
+        LeafType* right_leaf = new LeafType();
+        AABBType left_leaf_bbox, right_leaf_bbox;
+        const bool split =
+            partitioner.split(
+                *pending_leaf.m_leaf,
+                pending_leaf.m_bbox,
+                *left_leaf,
+                left_leaf_bbox,
+                *right_leaf,
+                right_leaf_bbox,
+                workspaces[m_thread_count],
+                &job_queue);
+
+        if (split)
+        {
+            // Get rid of the current leaf.
+            delete pending_leaf.m_leaf;
+
+            // Compute the indices of the child nodes.
+            const size_t left_node_index = tree.m_nodes.size();
+            const size_t right_node_index = left_node_index + 1;
+
+            // Turn the current node into an interior node.
+            NodeType& node = tree.m_nodes[pending_leaf.m_node_index];
+            node.make_interior();
+            node.set_left_bbox(left_leaf_bbox);
+            node.set_right_bbox(right_leaf_bbox);
+            node.set_child_node_index(left_node_index);
+
+            // Create the child nodes.
+            tree.m_nodes.push_back(NodeType());
+            tree.m_nodes.push_back(NodeType());
+
+            const PendingLeaf left_pending_leaf = { left_leaf, left_leaf_bbox, left_node_index };
+            const PendingLeaf right_pending_leaf = { right_leaf, right_leaf_bbox, right_node_index };
+            pending_leaves.push_back(left_pending_leaf);
+            pending_leaves.push_back(right_pending_leaf);
+        }
+        else
+        {
+            // Get rid of the child nodes.
+            delete left_leaf;
+            delete right_leaf;
+
+            // Turn the current node into a leaf node.
+            NodeType& node = tree.m_nodes[pending_leaf.m_node_index];
+            node.make_leaf();
+            node.set_item_index(leaves.size());
+            node.set_item_count(pending_leaf.m_leaf->size());
+            leaves.push_back(pending_leaf.m_leaf);
+        }
+    }
+
+    // Build the subtrees in parallel, largest first.
+    m_subtree_count = pending_leaves.size();
+    std::vector<Subtree> subtrees(m_subtree_count);
+    std::vector<std::pair<size_t, size_t> > schedule(m_subtree_count);
+    for (size_t i = 0; i < m_subtree_count; ++i)
+        schedule[i] = std::make_pair(pending_leaves[i].m_leaf->size(), i);
+    std::sort(schedule.rbegin(), schedule.rend());
+    for (size_t i = 0; i < m_subtree_count; ++i)
+    {
+        const size_t subtree_index = schedule[i].second;
+        job_queue.schedule(
+            new SubtreeJob(
+                partitioner,
+                workspaces,
+                pending_leaves[subtree_index],
+                subtrees[subtree_index]));
+    }
+    job_queue.wait_until_completion();
+
+    // Stitch the subtrees into the tree.
+    for (size_t i = 0; i < m_subtree_count; ++i)
+    {
+        Subtree& subtree = subtrees[i];
+
+        // Node k > 0 of the subtree goes to index node_base + k, the root replaces the pending node.
+        const size_t node_base = tree.m_nodes.size() - 1;
+        const size_t leaf_base = leaves.size();
+
+        for (size_t k = 0; k < subtree.m_nodes.size(); ++k)
+        {
+            NodeType node = subtree.m_nodes[k];
+
+            if (node.is_interior())
+                node.set_child_node_index(node_base + node.get_child_node_index());
+            else node.set_item_index(leaf_base + node.get_item_index());
+
+            if (k == 0)
+                tree.m_nodes[pending_leaves[i].m_node_index] = node;
+            else tree.m_nodes.push_back(node);
+        }
+
+        leaves.insert(leaves.end(), subtree.m_leaves.begin(), subtree.m_leaves.end());
+
+        // Release memory early.
+        NodeVectorType().swap(subtree.m_nodes);
+        LeafVector().swap(subtree.m_leaves);
+    }
+
+    // Collect split statistics.
+    for (size_t i = 0; i < workspaces.size(); ++i)
+        partitioner.merge_workspace(workspaces[i]);
+
+    // Store the leaves.
+    const size_t node_count = tree.m_nodes.size();
+    for (size_t i = 0; i < node_count; ++i)
+    {
+        NodeType& node = tree.m_nodes[i];
+        if (node.is_leaf())
+        {
+            const LeafType* leaf = leaves[node.get_item_index()];
+            node.set_item_index(partitioner.store(*leaf));
+            delete leaf;
+        }
+    }
+
+    // Measure and save construction time.
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename Tree, typename Partitioner>
+inline double ParallelSpatialBuilder<Tree, Partitioner>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename Tree, typename Partitioner>
+inline size_t ParallelSpatialBuilder<Tree, Partitioner>::get_thread_count() const
+{
+    return m_thread_count;
+}
+
+template <typename Tree, typename Partitioner>
+inline size_t ParallelSpatialBuilder<Tree, Partitioner>::get_subtree_count() const
+{
+    return m_subtree_count;
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelSpatialBuilder<Tree, Partitioner>::subdivide_recurse(
+    NodeVectorType&         nodes,
+    const Partitioner&      partitioner,
+    WorkspaceType&          workspace,
+    LeafVector&             leaves,
+    LeafType*               leaf,
+    const AABBType&         leaf_bbox,
+    const size_t            leaf_node_index)
+{
+    assert(leaf_node_index < nodes.size());
+
+    // Try to split the leaf.
+    LeafType* left_leaf = new LeafType();
+    LeafType* right_leaf = new LeafType();
+    AABBType left_leaf_bbox, right_leaf_bbox;
+    const bool split =
+        partitioner.split(
+            *leaf,
+            leaf_bbox,
+            *left_leaf,
+            left_leaf_bbox,
+            *right_leaf,
+            right_leaf_bbox,
+            workspace,
+            0);
+
+    if (split)
+    {
+        // Get rid of the current leaf.
+        delete leaf;
+
+        // Compute the indices of the child nodes.
+        const size_t left_node_index = nodes.size();
+        const size_t right_node_index = left_node_index + 1;
+
+        // Turn the current node into an interior node.
+        NodeType& node = nodes[leaf_node_index];
+        node.make_interior();
+        node.set_left_bbox(left_leaf_bbox);
+        node.set_right_bbox(right_leaf_bbox);
+        node.set_child_node_index(left_node_index);
+
+        // Create the child nodes.
+        nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
+
+        // Recurse into the left subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            workspace,
+            leaves,
+            left_leaf,
+            left_leaf_bbox,
+            left_node_index);
+
+        // Recurse into the right subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            workspace,
+            leaves,
+            right_leaf,
+            right_leaf_bbox,
+            right_node_index);
+    }
+    else
+    {
+        // Get rid of the child nodes.
+        delete left_leaf;
+        delete right_leaf;
+
+        // Turn the current node into a leaf node.
+        NodeType& node = nodes[leaf_node_index];
+        node.make_leaf();
+        node.set_item_index(leaves.size());
+        node.set_item_count(leaf->size());
+        leaves.push_back(leaf);
+    }
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELSPATIALBUILDER_H
@@ -36,7 +36,10 @@
 #include "foundation/math/bvh/bvh_bboxsortpredicate.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/split.h"
+#include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
 
 // Standard headers.
 #include <algorithm>
@@ -74,6 +77,9 @@ namespace bvh {
 //              const AABBType&     bbox) const;
 //      };
 //
+// The const methods of the ItemHandler class may be called concurrently when leaves are
+// split from multiple threads, each thread using its own SBVHPartitioner::Workspace.
+//
 
 // When defined, additional costly correctness checks are enabled (only in Debug).
 #undef FOUNDATION_SBVH_DEEPCHECK
@@ -98,6 +104,32 @@ class SBVHPartitioner
         }
     };
 
+  private:
+    struct Bin
+    {
+        AABBType    m_bin_bbox;         // bbox of this bin
+        AABBType    m_left_bbox;        // bbox of all the bins to the left of this one
+        size_t      m_entry_counter;    // number of items that begin in this bin
+        size_t      m_exit_counter;     // number of items that end in this bin
+    };
+
+  public:
+    // Scratch memory and split counters. Leaves may be split concurrently
+    // as long as each thread uses its own workspace.
+    struct Workspace
+    {
+        std::vector<ValueType>      m_left_areas[Dimension];
+        std::vector<Bin>            m_bins[Dimension];
+        std::vector<uint8>          m_tags;
+        size_t                      m_spatial_split_count;
+        size_t                      m_object_split_count;
+
+        Workspace();
+    };
+
+    // Leaves with at least that many items are binned in all dimensions in parallel.
+    static const size_t ParallelBinningThreshold = 64 * 1024;
+
     // Constructor.
     SBVHPartitioner(
         ItemHandler&                item_handler,
@@ -122,6 +154,24 @@ class SBVHPartitioner
         LeafType&                   right_leaf,
         AABBType&                   right_leaf_bbox);
 
+    // Prepare a workspace for use with the thread-safe variant of split().
+    void init_workspace(Workspace& workspace) const;
+
+    // Thread-safe variant of split(). If a job queue is provided, the splitting
+    // planes of large leaves are searched in all dimensions in parallel.
+    bool split(
+        LeafType&                   leaf,
+        const AABBType&             leaf_bbox,
+        LeafType&                   left_leaf,
+        AABBType&                   left_leaf_bbox,
+        LeafType&                   right_leaf,
+        AABBType&                   right_leaf_bbox,
+        Workspace&                  workspace,
+        JobQueue*                   job_queue = 0) const;
+
+    // Accumulate the split counters of a workspace.
+    void merge_workspace(const Workspace& workspace);
+
     // Store a leaf. Return the index of the first stored item.
     size_t store(const LeafType& leaf);
 
@@ -135,14 +185,18 @@ class SBVHPartitioner
   private:
     typedef Split<ValueType> SplitType;
 
-    struct Bin
+    // Best split found in a single dimension.
+    struct SplitCandidate
     {
-        AABBType    m_bin_bbox;         // bbox of this bin
-        AABBType    m_left_bbox;        // bbox of all the bins to the left of this one
-        size_t      m_entry_counter;    // number of items that begin in this bin
-        size_t      m_exit_counter;     // number of items that end in this bin
+        ValueType                   m_cost;
+        size_t                      m_pivot;
+        SplitType                   m_split;
+        AABBType                    m_left_bbox;
+        AABBType                    m_right_bbox;
     };
 
+    class FindSplitJob;
+
     ItemHandler&                    m_item_handler;
     const AABBVectorType&           m_bboxes;
     const size_t                    m_max_leaf_size;
@@ -152,38 +206,39 @@ class SBVHPartitioner
     const ValueType                 m_item_intersection_cost;
 
     ValueType                       m_root_bbox_rcp_sa;
-    std::vector<AABBType>           m_left_bboxes;
-    std::vector<Bin>                m_bins;
-    std::vector<uint8>              m_tags;
+    Workspace                       m_workspace;
     std::vector<size_t>             m_final_indices;
 
-    size_t                          m_spatial_split_count;
-    size_t                          m_object_split_count;
-
     void compute_root_bbox_surface_area();
 
     ValueType compute_final_split_cost(
         const AABBType&             bbox,
         const double                cost) const;
 
-    // Find the best object split for a given set of items.
+    // Find the best object and spatial splits in all dimensions.
+    void find_splits(
+        const bool                  spatial,
+        const LeafType&             leaf,
+        const AABBType&             leaf_bbox,
+        Workspace&                  workspace,
+        JobQueue*                   job_queue,
+        SplitCandidate              candidates[]) const;
+
+    // Find the best object split for a given set of items in a given dimension.
     void find_object_split(
-        LeafType&                   leaf,
+        const LeafType&             leaf,
         const AABBType&             leaf_bbox,
-        AABBType&                   left_leaf_bbox,
-        AABBType&                   right_leaf_bbox,
-        size_t&                     best_split_dim,
-        size_t&                     best_split_pivot,
-        ValueType&                  best_split_cost);
+        const size_t                dim,
+        Workspace&                  workspace,
+        SplitCandidate&             candidate) const;
 
-    // Find the best spatial split for a given set of items.
+    // Find the best spatial split for a given set of items in a given dimension.
     void find_spatial_split(
         const LeafType&             leaf,
         const AABBType&             leaf_bbox,
-        AABBType&                   left_leaf_bbox,
-        AABBType&                   right_leaf_bbox,
-        SplitType&                  best_split,
-        ValueType&                  best_split_cost);
+        const size_t                dim,
+        Workspace&                  workspace,
+        SplitCandidate&             candidate) const;
 
     // Sort a set of items into two subsets according to a given object split.
     void object_sort(
@@ -193,7 +248,8 @@ class SBVHPartitioner
         const AABBType&             left_leaf_bbox,
         const AABBType&             right_leaf_bbox,
         LeafType&                   left_leaf,
-        LeafType&                   right_leaf);
+        LeafType&                   right_leaf,
+        Workspace&                  workspace) const;
 
     // Sort a set of items into two subsets according to a given spatial split.
     void spatial_sort(
@@ -210,6 +266,13 @@ class SBVHPartitioner
 // SBVHPartitioner class implementation.
 //
 
+template <typename ItemHandler, typename AABBVector>
+SBVHPartitioner<ItemHandler, AABBVector>::Workspace::Workspace()
+  : m_spatial_split_count(0)
+  , m_object_split_count(0)
+{
+}
+
 template <typename ItemHandler, typename AABBVector>
 SBVHPartitioner<ItemHandler, AABBVector>::SBVHPartitioner(
     ItemHandler&                    item_handler,
@@ -225,13 +288,9 @@ SBVHPartitioner<ItemHandler, AABBVector>::SBVHPartitioner(
   , m_rcp_bin_count(ValueType(1.0) / bin_count)
   , m_interior_node_traversal_cost(interior_node_traversal_cost)
   , m_item_intersection_cost(item_intersection_cost)
-  , m_left_bboxes(bboxes.size() > 1 ? bboxes.size() - 1 : 0)
-  , m_bins(bin_count)
-  , m_tags(bboxes.size())
-  , m_spatial_split_count(0)
-  , m_object_split_count(0)
 {
     compute_root_bbox_surface_area();
+    init_workspace(m_workspace);
 }
 
 template <typename ItemHandler, typename AABBVector>
@@ -274,13 +333,44 @@ typename AABBVector::value_type SBVHPartitioner<ItemHandler, AABBVector>::comput
 }
 
 template <typename ItemHandler, typename AABBVector>
-bool SBVHPartitioner<ItemHandler, AABBVector>::split(
+inline bool SBVHPartitioner<ItemHandler, AABBVector>::split(
     LeafType&                       leaf,
     const AABBType&                 leaf_bbox,
     LeafType&                       left_leaf,
     AABBType&                       left_leaf_bbox,
     LeafType&                       right_leaf,
     AABBType&                       right_leaf_bbox)
+{
+    return
+        split(
+            leaf,
+            leaf_bbox,
+            left_leaf,
+            left_leaf_bbox,
+            right_leaf,
+            right_leaf_bbox,
+            m_workspace);
+}
+
+template <typename ItemHandler, typename AABBVector>
+void SBVHPartitioner<ItemHandler, AABBVector>::init_workspace(Workspace& workspace) const
+{
+    for (size_t d = 0; d < Dimension; ++d)
+        workspace.m_bins[d].resize(m_bin_count);
+
+    workspace.m_tags.resize(m_bboxes.size());
+}
+
+template <typename ItemHandler, typename AABBVector>
+bool SBVHPartitioner<ItemHandler, AABBVector>::split(
+    LeafType&                       leaf,
+    const AABBType&                 leaf_bbox,
+    LeafType&                       left_leaf,
+    AABBType&                       left_leaf_bbox,
+    LeafType&                       right_leaf,
+    AABBType&                       right_leaf_bbox,
+    Workspace&                      workspace,
+    JobQueue*                       job_queue) const
 {
     assert(!leaf_bbox.is_valid() || leaf_bbox.rank() >= Dimension - 1);
 
@@ -298,20 +388,37 @@ bool SBVHPartitioner<ItemHandler, AABBVector>::split(
     if (leaf.m_indices[0].size() < 2)
         return false;
 
+    // Small leaves are not worth the synchronization overhead.
+    if (leaf.size() < ParallelBinningThreshold)
+        job_queue = 0;
+
+    SplitCandidate candidates[Dimension];
+
     // Find the best object split.
-    AABBType object_split_left_bbox;
-    AABBType object_split_right_bbox;
-    size_t object_split_dim;
-    size_t object_split_pivot;
+    find_splits(false, leaf, leaf_bbox, workspace, job_queue, candidates);
+    size_t object_split_dim = 0;
     ValueType object_split_cost = std::numeric_limits<ValueType>::max();
-    find_object_split(
-        leaf,
-        leaf_bbox,
-        object_split_left_bbox,
-        object_split_right_bbox,
-        object_split_dim,
-        object_split_pivot,
-        object_split_cost);
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        if (object_split_cost > candidates[d].m_cost)
+        {
+            object_split_cost = candidates[d].m_cost;
+            object_split_dim = d;
+        }
+    }
+    const size_t object_split_pivot = candidates[object_split_dim].m_pivot;
+    const AABBType object_split_right_bbox = candidates[object_split_dim].m_right_bbox;
+    object_split_cost = compute_final_split_cost(leaf_bbox, object_split_cost);
+
+    // Compute the left bounding box of the best object split.
+    AABBType object_split_left_bbox;
+    object_split_left_bbox.invalidate();
+    if (object_split_cost < std::numeric_limits<ValueType>::max())
+    {
+        const std::vector<size_t>& indices = leaf.m_indices[object_split_dim];
+        for (size_t i = 0; i < object_split_pivot; ++i)
+            object_split_left_bbox.insert(AABBType::intersect(m_bboxes[indices[i]], leaf_bbox));
+    }
 
     // Don't try to find a spatial split if the object split is good enough.
     bool do_find_spatial_split = true;
@@ -338,13 +445,24 @@ bool SBVHPartitioner<ItemHandler, AABBVector>::split(
     ValueType spatial_split_cost = std::numeric_limits<ValueType>::max();
     if (do_find_spatial_split)
     {
-        find_spatial_split(
-            leaf,
-            leaf_bbox,
-            spatial_split_left_bbox,
-            spatial_split_right_bbox,
-            spatial_split,
-            spatial_split_cost);
+        find_splits(true, leaf, leaf_bbox, workspace, job_queue, candidates);
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            if (spatial_split_cost > candidates[d].m_cost)
+            {
+                spatial_split_cost = candidates[d].m_cost;
+                spatial_split = candidates[d].m_split;
+                spatial_split_left_bbox = candidates[d].m_left_bbox;
+                spatial_split_right_bbox = candidates[d].m_right_bbox;
+            }
+        }
+        spatial_split_cost = compute_final_split_cost(leaf_bbox, spatial_split_cost);
+
+        if (spatial_split_cost < std::numeric_limits<ValueType>::max())
+        {
+            // In the case of a spatial split, the bounding boxes of the child nodes must be disjoint.
+            assert(AABBType::intersect(spatial_split_left_bbox, spatial_split_right_bbox).rank() < Dimension);
+        }
     }
 
     // Compute the cost of keeping the leaf unsplit.
@@ -368,8 +486,9 @@ bool SBVHPartitioner<ItemHandler, AABBVector>::split(
             left_leaf_bbox,
             right_leaf_bbox,
             left_leaf,
-            right_leaf);
-        ++m_object_split_count;
+            right_leaf,
+            workspace);
+        ++workspace.m_object_split_count;
         return true;
     }
     else
@@ -384,11 +503,18 @@ bool SBVHPartitioner<ItemHandler, AABBVector>::split(
             right_leaf_bbox,
             left_leaf,
             right_leaf);
-        ++m_spatial_split_count;
+        ++workspace.m_spatial_split_count;
         return true;
     }
 }
 
+template <typename ItemHandler, typename AABBVector>
+inline void SBVHPartitioner<ItemHandler, AABBVector>::merge_workspace(const Workspace& workspace)
+{
+    m_workspace.m_spatial_split_count += workspace.m_spatial_split_count;
+    m_workspace.m_object_split_count += workspace.m_object_split_count;
+}
+
 template <typename ItemHandler, typename AABBVector>
 void SBVHPartitioner<ItemHandler, AABBVector>::compute_root_bbox_surface_area()
 {
@@ -426,198 +552,258 @@ inline typename AABBVector::value_type::ValueType SBVHPartitioner<ItemHandler, A
 }
 
 template <typename ItemHandler, typename AABBVector>
-void SBVHPartitioner<ItemHandler, AABBVector>::find_object_split(
-    LeafType&                       leaf,
-    const AABBType&                 leaf_bbox,
-    AABBType&                       left_leaf_bbox,
-    AABBType&                       right_leaf_bbox,
-    size_t&                         best_split_dim,
-    size_t&                         best_split_pivot,
-    ValueType&                      best_split_cost)
+class SBVHPartitioner<ItemHandler, AABBVector>::FindSplitJob
+  : public IJob
 {
-    for (size_t d = 0; d < Dimension; ++d)
+  public:
+    FindSplitJob(
+        const SBVHPartitioner&      partitioner,
+        const bool                  spatial,
+        const LeafType&             leaf,
+        const AABBType&             leaf_bbox,
+        const size_t                dim,
+        Workspace&                  workspace,
+        SplitCandidate&             candidate)
+      : m_partitioner(partitioner)
+      , m_spatial(spatial)
+      , m_leaf(leaf)
+      , m_leaf_bbox(leaf_bbox)
+      , m_dim(dim)
+      , m_workspace(workspace)
+      , m_candidate(candidate)
     {
-        const std::vector<size_t>& indices = leaf.m_indices[d];
-        const size_t item_count = indices.size();
+    }
+
+    virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+    {
+        if (m_spatial)
+            m_partitioner.find_spatial_split(m_leaf, m_leaf_bbox, m_dim, m_workspace, m_candidate);
+        else m_partitioner.find_object_split(m_leaf, m_leaf_bbox, m_dim, m_workspace, m_candidate);
+    }
 
-        AABBType bbox_accumulator;
+  private:
+    const SBVHPartitioner&          m_partitioner;
+    const bool                      m_spatial;
+    const LeafType&                 m_leaf;
+    const AABBType                  m_leaf_bbox;
+    const size_t                    m_dim;
+    Workspace&                      m_workspace;
+    SplitCandidate&                 m_candidate;
+};
 
-        // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
-        bbox_accumulator.invalidate();
-        for (size_t i = 0; i < item_count - 1; ++i)
+template <typename ItemHandler, typename AABBVector>
+void SBVHPartitioner<ItemHandler, AABBVector>::find_splits(
+    const bool                      spatial,
+    const LeafType&                 leaf,
+    const AABBType&                 leaf_bbox,
+    Workspace&                      workspace,
+    JobQueue*                       job_queue,
+    SplitCandidate                  candidates[]) const
+{
+    if (job_queue)
+    {
+        // Each dimension uses its own scratch memory and can be processed independently.
+        for (size_t d = 0; d < Dimension; ++d)
         {
-            const size_t item_index = indices[i];
-            const AABBType& item_bbox = m_bboxes[item_index];
-            const AABBType clipped_item_bbox = AABBType::intersect(item_bbox, leaf_bbox);
-            assert(clipped_item_bbox.is_valid());
-            bbox_accumulator.insert(clipped_item_bbox);
-            m_left_bboxes[i] = bbox_accumulator;
+            job_queue->schedule(
+                new FindSplitJob(*this, spatial, leaf, leaf_bbox, d, workspace, candidates[d]));
         }
 
-        // Right-to-left sweep to accumulate bounding boxes, compute their surface area find the best partition.
-        bbox_accumulator.invalidate();
-        for (size_t i = item_count - 1; i > 0; --i)
+        job_queue->wait_until_completion();
+    }
+    else
+    {
+        for (size_t d = 0; d < Dimension; ++d)
         {
-            // Compute right bounding box.
-            const size_t item_index = indices[i];
-            const AABBType& item_bbox = m_bboxes[item_index];
-            const AABBType clipped_item_bbox = AABBType::intersect(item_bbox, leaf_bbox);
-            assert(clipped_item_bbox.is_valid());
-            bbox_accumulator.insert(clipped_item_bbox);
-
-            // Compute the cost of this partition.
-            const ValueType left_cost = half_surface_area(m_left_bboxes[i - 1]) * i;
-            const ValueType right_cost = half_surface_area(bbox_accumulator) * (item_count - i);
-            const ValueType split_cost = left_cost + right_cost;
-
-            // Keep track of the partition with the lowest cost.
-            if (best_split_cost > split_cost)
-            {
-                best_split_cost = split_cost;
-                best_split_dim = d;
-                best_split_pivot = i;
-                left_leaf_bbox = m_left_bboxes[i - 1];
-                right_leaf_bbox = bbox_accumulator;
-            }
+            if (spatial)
+                find_spatial_split(leaf, leaf_bbox, d, workspace, candidates[d]);
+            else find_object_split(leaf, leaf_bbox, d, workspace, candidates[d]);
         }
     }
-
-    best_split_cost = compute_final_split_cost(leaf_bbox, best_split_cost);
 }
 
 template <typename ItemHandler, typename AABBVector>
-void SBVHPartitioner<ItemHandler, AABBVector>::find_spatial_split(
+void SBVHPartitioner<ItemHandler, AABBVector>::find_object_split(
     const LeafType&                 leaf,
     const AABBType&                 leaf_bbox,
-    AABBType&                       left_leaf_bbox,
-    AABBType&                       right_leaf_bbox,
-    SplitType&                      best_split,
-    ValueType&                      best_split_cost)
+    const size_t                    dim,
+    Workspace&                      workspace,
+    SplitCandidate&                 candidate) const
 {
-    for (size_t d = 0; d < Dimension; ++d)
-    {
-        const std::vector<size_t>& indices = leaf.m_indices[d];
-        const size_t item_count = indices.size();
+    const std::vector<size_t>& indices = leaf.m_indices[dim];
+    const size_t item_count = indices.size();
 
-        // Compute the extent of the leaf in the splitting dimension.
-        const ValueType bbox_min = leaf_bbox.min[d];
-        const ValueType bbox_max = leaf_bbox.max[d];
-        const ValueType bbox_extent = bbox_max - bbox_min;
-        const ValueType rcp_bin_size = m_bin_count / bbox_extent;
+    std::vector<ValueType>& left_areas = workspace.m_left_areas[dim];
+    if (left_areas.size() < item_count - 1)
+        left_areas.resize(item_count - 1);
 
-        // This node is flat in this dimension.
-        if (bbox_extent == ValueType(0.0))
-            continue;
+    candidate.m_cost = std::numeric_limits<ValueType>::max();
 
-        // Clear the bins.
-        for (size_t i = 0; i < m_bin_count; ++i)
-        {
-            Bin& bin = m_bins[i];
-            bin.m_bin_bbox.invalidate();
-            bin.m_entry_counter = 0;
-            bin.m_exit_counter = 0;
-        }
+    AABBType bbox_accumulator;
 
-        // Push the items through the bins.
-        for (size_t i = 0; i < item_count; ++i)
-        {
-            // Compute the extent of this item in the splitting dimension.
-            const size_t item_index = indices[i];
-            const AABBType& item_bbox = m_bboxes[item_index];
-            const ValueType item_bbox_min = item_bbox.min[d];
-            const ValueType item_bbox_max = item_bbox.max[d];
-            assert(item_bbox_min <= bbox_max && item_bbox_max >= bbox_min);
-
-            // Find the range of bins covered by this item.
-            const size_t begin_bin =
-                item_bbox_min > bbox_min
-                    ? std::min<size_t>(truncate<size_t>((item_bbox_min - bbox_min) * rcp_bin_size), m_bin_count - 1)
-                    : 0;
-            const size_t end_bin =
-                std::min<size_t>(truncate<size_t>((item_bbox_max - bbox_min) * rcp_bin_size), m_bin_count - 1);
-            assert(begin_bin < m_bin_count);
-            assert(end_bin < m_bin_count);
-            assert(begin_bin <= end_bin);
-
-            // Update the bins that this item overlaps.
-            for (size_t b = begin_bin; b <= end_bin; ++b)
-            {
-                // Compute the bounds of this bin.
-                const ValueType bin_min = lerp(bbox_min, bbox_max, (b + 0) * m_rcp_bin_count);
-                const ValueType bin_max = lerp(bbox_min, bbox_max, (b + 1) * m_rcp_bin_count);
-
-                // Clip the item against the bin boundaries.
-                const AABBType item_clipped_bbox =
-                    m_item_handler.clip(
-                        item_index,
-                        d,
-                        bin_min,
-                        bin_max);
-                assert(item_clipped_bbox.is_valid());
-
-                // Grow the bounding box associated with this bin.
-                m_bins[b].m_bin_bbox.insert(item_clipped_bbox);
-            }
+    // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
+    bbox_accumulator.invalidate();
+    for (size_t i = 0; i < item_count - 1; ++i)
+    {
+        const size_t item_index = indices[i];
+        const AABBType& item_bbox = m_bboxes[item_index];
+        const AABBType clipped_item_bbox = AABBType::intersect(item_bbox, leaf_bbox);
+        assert(clipped_item_bbox.is_valid());
+        bbox_accumulator.insert(clipped_item_bbox);
+        left_areas[i] = half_surface_area(bbox_accumulator);
+    }
 
-            // Update the enter/leave counters.
-            ++m_bins[begin_bin].m_entry_counter;
-            ++m_bins[end_bin].m_exit_counter;
-        }
+    // Right-to-left sweep to accumulate bounding boxes, compute their surface area find the best partition.
+    bbox_accumulator.invalidate();
+    for (size_t i = item_count - 1; i > 0; --i)
+    {
+        // Compute right bounding box.
+        const size_t item_index = indices[i];
+        const AABBType& item_bbox = m_bboxes[item_index];
+        const AABBType clipped_item_bbox = AABBType::intersect(item_bbox, leaf_bbox);
+        assert(clipped_item_bbox.is_valid());
+        bbox_accumulator.insert(clipped_item_bbox);
 
-        AABBType bbox_accumulator;
+        // Compute the cost of this partition.
+        const ValueType left_cost = left_areas[i - 1] * i;
+        const ValueType right_cost = half_surface_area(bbox_accumulator) * (item_count - i);
+        const ValueType split_cost = left_cost + right_cost;
 
-        // Left-to-right sweep to compute the left bounding boxes.
-        bbox_accumulator = m_bins[0].m_bin_bbox;
-        for (size_t i = 1; i < m_bin_count; ++i)
+        // Keep track of the partition with the lowest cost.
+        if (candidate.m_cost > split_cost)
         {
-            Bin& bin = m_bins[i];
-            bin.m_left_bbox = bbox_accumulator;
-            bbox_accumulator.insert(bin.m_bin_bbox);
+            candidate.m_cost = split_cost;
+            candidate.m_pivot = i;
+            candidate.m_right_bbox = bbox_accumulator;
         }
+    }
+}
 
-        // Right-to-left sweep to compute the right bounding boxes and find the best split.
-        size_t left_item_count = item_count;
-        size_t right_item_count = 0;
-        bbox_accumulator.invalidate();
-        for (size_t i = m_bin_count - 1; i > 0; --i)
-        {
-            const Bin& bin = m_bins[i];
+template <typename ItemHandler, typename AABBVector>
+void SBVHPartitioner<ItemHandler, AABBVector>::find_spatial_split(
+    const LeafType&                 leaf,
+    const AABBType&                 leaf_bbox,
+    const size_t                    dim,
+    Workspace&                      workspace,
+    SplitCandidate&                 candidate) const
+{
+    const std::vector<size_t>& indices = leaf.m_indices[dim];
+    const size_t item_count = indices.size();
 
-            // Compute the right bounding box.
-            bbox_accumulator.insert(bin.m_bin_bbox);
+    candidate.m_cost = std::numeric_limits<ValueType>::max();
 
-            // We need to have items on both the left and right sides.
-            if (!bin.m_left_bbox.is_valid() || !bbox_accumulator.is_valid())
-                continue;
+    // Compute the extent of the leaf in the splitting dimension.
+    const ValueType bbox_min = leaf_bbox.min[dim];
+    const ValueType bbox_max = leaf_bbox.max[dim];
+    const ValueType bbox_extent = bbox_max - bbox_min;
+    const ValueType rcp_bin_size = m_bin_count / bbox_extent;
 
-            // Update the item counters.
-            assert(left_item_count >= bin.m_entry_counter);
-            left_item_count -= bin.m_entry_counter;
-            right_item_count += bin.m_exit_counter;
+    // This node is flat in this dimension.
+    if (bbox_extent == ValueType(0.0))
+        return;
 
-            // Compute the cost of this split.
-            const ValueType left_cost = half_surface_area(bin.m_left_bbox) * left_item_count;
-            const ValueType right_cost = half_surface_area(bbox_accumulator) * right_item_count;
-            const ValueType split_cost = left_cost + right_cost;
+    std::vector<Bin>& bins = workspace.m_bins[dim];
 
-            // Keep track of the partition with the lowest cost.
-            if (best_split_cost > split_cost)
-            {
-                best_split_cost = split_cost;
-                best_split.m_dimension = d;
-                best_split.m_abscissa = bbox_accumulator.min[d];
-                left_leaf_bbox = bin.m_left_bbox;
-                right_leaf_bbox = bbox_accumulator;
-            }
+    // Clear the bins.
+    for (size_t i = 0; i < m_bin_count; ++i)
+    {
+        Bin& bin = bins[i];
+        bin.m_bin_bbox.invalidate();
+        bin.m_entry_counter = 0;
+        bin.m_exit_counter = 0;
+    }
+
+    // Push the items through the bins.
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        // Compute the extent of this item in the splitting dimension.
+        const size_t item_index = indices[i];
+        const AABBType& item_bbox = m_bboxes[item_index];
+        const ValueType item_bbox_min = item_bbox.min[dim];
+        const ValueType item_bbox_max = item_bbox.max[dim];
+        assert(item_bbox_min <= bbox_max && item_bbox_max >= bbox_min);
+
+        // Find the range of bins covered by this item.
+        const size_t begin_bin =
+            item_bbox_min > bbox_min
+                ? std::min<size_t>(truncate<size_t>((item_bbox_min - bbox_min) * rcp_bin_size), m_bin_count - 1)
+                : 0;
+        const size_t end_bin =
+            std::min<size_t>(truncate<size_t>((item_bbox_max - bbox_min) * rcp_bin_size), m_bin_count - 1);
+        assert(begin_bin < m_bin_count);
+        assert(end_bin < m_bin_count);
+        assert(begin_bin <= end_bin);
+
+        // Update the bins that this item overlaps.
+        for (size_t b = begin_bin; b <= end_bin; ++b)
+        {
+            // Compute the bounds of this bin.
+            const ValueType bin_min = lerp(bbox_min, bbox_max, (b + 0) * m_rcp_bin_count);
+            const ValueType bin_max = lerp(bbox_min, bbox_max, (b + 1) * m_rcp_bin_count);
+
+            // Clip the item against the bin boundaries.
+            const AABBType item_clipped_bbox =
+                m_item_handler.clip(
+                    item_index,
+                    dim,
+                    bin_min,
+                    bin_max);
+            assert(item_clipped_bbox.is_valid());
+
+            // Grow the bounding box associated with this bin.
+            bins[b].m_bin_bbox.insert(item_clipped_bbox);
         }
+
+        // Update the enter/leave counters.
+        ++bins[begin_bin].m_entry_counter;
+        ++bins[end_bin].m_exit_counter;
     }
 
-    best_split_cost = compute_final_split_cost(leaf_bbox, best_split_cost);
+    AABBType bbox_accumulator;
 
-    if (best_split_cost < std::numeric_limits<ValueType>::max())
+    // Left-to-right sweep to compute the left bounding boxes.
+    bbox_accumulator = bins[0].m_bin_bbox;
+    for (size_t i = 1; i < m_bin_count; ++i)
     {
-        // In the case of a spatial split, the bounding boxes of the child nodes must be disjoint.
-        assert(AABBType::intersect(left_leaf_bbox, right_leaf_bbox).rank() < Dimension);
+        Bin& bin = bins[i];
+        bin.m_left_bbox = bbox_accumulator;
+        bbox_accumulator.insert(bin.m_bin_bbox);
+    }
+
+    // Right-to-left sweep to compute the right bounding boxes and find the best split.
+    size_t left_item_count = item_count;
+    size_t right_item_count = 0;
+    bbox_accumulator.invalidate();
+    for (size_t i = m_bin_count - 1; i > 0; --i)
+    {
+        const Bin& bin = bins[i];
+
+        // Compute the right bounding box.
+        bbox_accumulator.insert(bin.m_bin_bbox);
+
+        // We need to have items on both the left and right sides.
+        if (!bin.m_left_bbox.is_valid() || !bbox_accumulator.is_valid())
+            continue;
+
+        // Update the item counters.
+        assert(left_item_count >= bin.m_entry_counter);
+        left_item_count -= bin.m_entry_counter;
+        right_item_count += bin.m_exit_counter;
+
+        // Compute the cost of this split.
+        const ValueType left_cost = half_surface_area(bin.m_left_bbox) * left_item_count;
+        const ValueType right_cost = half_surface_area(bbox_accumulator) * right_item_count;
+        const ValueType split_cost = left_cost + right_cost;
+
+        // Keep track of the partition with the lowest cost.
+        if (candidate.m_cost > split_cost)
+        {
+            candidate.m_cost = split_cost;
+            candidate.m_split.m_dimension = dim;
+            candidate.m_split.m_abscissa = bbox_accumulator.min[dim];
+            candidate.m_left_bbox = bin.m_left_bbox;
+            candidate.m_right_bbox = bbox_accumulator;
+        }
     }
 }
 
@@ -629,18 +815,20 @@ void SBVHPartitioner<ItemHandler, AABBVector>::object_sort(
     const AABBType&                 left_leaf_bbox,
     const AABBType&                 right_leaf_bbox,
     LeafType&                       left_leaf,
-    LeafType&                       right_leaf)
+    LeafType&                       right_leaf,
+    Workspace&                      workspace) const
 {
+    std::vector<uint8>& tags = workspace.m_tags;
     const std::vector<size_t>& split_indices = leaf.m_indices[split_dim];
     const size_t size = split_indices.size();
 
     enum { Left = 0, Right = 1 };
 
     for (size_t i = 0; i < split_pivot; ++i)
-        m_tags[split_indices[i]] = Left;
+        tags[split_indices[i]] = Left;
 
     for (size_t i = split_pivot; i < size; ++i)
-        m_tags[split_indices[i]] = Right;
+        tags[split_indices[i]] = Right;
 
     for (size_t d = 0; d < Dimension; ++d)
     {
@@ -680,7 +868,7 @@ void SBVHPartitioner<ItemHandler, AABBVector>::object_sort(
             {
                 const size_t item_index = leaf.m_indices[d][i];
 
-                if (m_tags[item_index] == Left)
+                if (tags[item_index] == Left)
                 {
                     assert(left < split_pivot);
                     left_leaf.m_indices[d][left++] = item_index;
@@ -796,13 +984,13 @@ inline const std::vector<size_t>& SBVHPartitioner<ItemHandler, AABBVector>::get_
 template <typename ItemHandler, typename AABBVector>
 inline size_t SBVHPartitioner<ItemHandler, AABBVector>::get_spatial_split_count() const
 {
-    return m_spatial_split_count;
+    return m_workspace.m_spatial_split_count;
 }
 
 template <typename ItemHandler, typename AABBVector>
 inline size_t SBVHPartitioner<ItemHandler, AABBVector>::get_object_split_count() const
 {
-    return m_object_split_count;
+    return m_workspace.m_object_split_count;
 }
 
 }       // namespace bvh
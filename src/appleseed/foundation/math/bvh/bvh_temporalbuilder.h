@@ -0,0 +1,848 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_TEMPORALBUILDER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_TEMPORALBUILDER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh/bvh_tree.h"
+#include "foundation/math/scalar.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Spatio-temporal BVH builder, for items moving during the shutter interval.
+//
+// In addition to regular object splits, a node can be split in time: both child nodes
+// then reference all the items of the node, the left one over the first half of the
+// node's time interval and the right one over the second half. Since each subtree
+// only needs to bound its items over its own time interval, bounding boxes stay tight
+// even when items move a lot. Time intervals are dyadic: a node at time split depth d
+// covers [k / 2^d, (k + 1) / 2^d] for some integer k.
+//
+// Split costs are evaluated with the surface area heuristic, using the surface area
+// of the bounding boxes of the nodes averaged over their time interval, as seen by
+// the intersectors which linearly interpolate motion bounding boxes.
+//
+// Motion bounding boxes are computed by the builder. The motion bounding boxes of a
+// subtree are keyed at the times of all the poses of its items and at the bounds of
+// its time interval; keys outside of the time interval of the subtree are empty boxes
+// so that the intersectors never enter the subtree at these times.
+//
+// Motion segment counts of items are expected to follow the conventions of the rest
+// of the library: for a given tree, segment counts of different items must divide each
+// other (see TriangleTree::compute_motion_bboxes()).
+//
+// The ItemHandler class must conform to the following prototype:
+//
+//      class ItemHandler
+//        : public foundation::NonCopyable
+//      {
+//        public:
+//          // Return the number of items.
+//          size_t size() const;
+//
+//          // Return the number of motion segments of an item, 0 if the item is static.
+//          size_t get_motion_segment_count(const size_t item_index) const;
+//
+//          // Return the bounding box of an item at a given time in [0, 1].
+//          AABBType compute_bbox(const size_t item_index, const ValueType time) const;
+//      };
+//
+
+template <typename Tree, typename ItemHandler>
+class TemporalBuilder
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    // Constructor.
+    TemporalBuilder(
+        const size_t            max_leaf_size = 1,
+        const size_t            bin_count = 64,
+        const size_t            max_time_split_depth = 2,
+        const ValueType         interior_node_traversal_cost = ValueType(1.0),
+        const ValueType         item_intersection_cost = ValueType(1.0));
+
+    // Build a tree.
+    template <typename Timer>
+    void build(
+        Tree&                   tree,
+        const ItemHandler&      handler);
+
+    // Return the items ordering. Items referenced by several leaves appear several times.
+    const std::vector<size_t>& get_item_ordering() const;
+
+    // Return the number of object and time splits.
+    size_t get_object_split_count() const;
+    size_t get_time_split_count() const;
+
+    // Return the construction time.
+    double get_build_time() const;
+
+  private:
+    static const size_t Dimension = AABBType::Dimension;
+
+    typedef std::vector<size_t> IndexVector;
+    typedef std::vector<AABBType> AABBVector;
+
+    // The time interval [m_index / 2^m_depth, (m_index + 1) / 2^m_depth].
+    struct TimeInterval
+    {
+        size_t                  m_index;
+        size_t                  m_depth;
+
+        TimeInterval(const size_t index, const size_t depth);
+
+        TimeInterval get_left_half() const;
+        TimeInterval get_right_half() const;
+
+        // Return the time key / key_count, key_count being a multiple of 2^m_depth.
+        ValueType get_time(const size_t key, const size_t key_count) const;
+
+        // Return true if the time key / key_count belongs to the interval.
+        bool contains(const size_t key, const size_t key_count) const;
+    };
+
+    const size_t                m_max_leaf_size;
+    const size_t                m_bin_count;
+    const size_t                m_max_time_split_depth;
+    const ValueType             m_interior_node_traversal_cost;
+    const ValueType             m_item_intersection_cost;
+
+    AABBVector                  m_bin_keys;
+    std::vector<size_t>         m_bin_counts;
+    std::vector<ValueType>      m_left_areas;
+    std::vector<size_t>         m_left_counts;
+    IndexVector                 m_item_ordering;
+    size_t                      m_object_split_count;
+    size_t                      m_time_split_count;
+    double                      m_build_time;
+
+    // Recursively subdivide the tree. Return the motion bounding boxes of the subtree.
+    AABBVector subdivide_recurse(
+        Tree&                   tree,
+        const ItemHandler&      handler,
+        const size_t            node_index,
+        IndexVector&            items,
+        const TimeInterval&     interval);
+
+    // Find the best object split. Return its cost, or the largest value if no split was found.
+    ValueType find_object_split(
+        const AABBVector&       item_keys,
+        const size_t            key_count,
+        const AABBVector&       centroids,
+        const AABBType&         centroid_bbox,
+        size_t&                 split_dim,
+        size_t&                 split_bin);
+
+    // Compute the cost of splitting the items in two halves.
+    static ValueType compute_median_split_cost(
+        const AABBVector&       item_keys,
+        const size_t            key_count);
+
+    // Compute the cost of a time split.
+    static ValueType compute_time_split_cost(
+        const ItemHandler&      handler,
+        const IndexVector&      items,
+        const TimeInterval&     interval,
+        const size_t            motion_segment_count);
+
+    size_t compute_bin_index(
+        const AABBType&         centroid,
+        const size_t            dim,
+        const AABBType&         centroid_bbox) const;
+
+    // Compute the bounding boxes of an item at key_count evenly spaced times of an interval.
+    static void compute_item_keys(
+        const ItemHandler&      handler,
+        const size_t            item_index,
+        const TimeInterval&     interval,
+        const size_t            key_count,
+        AABBType                keys[]);
+
+    // Compute the surface area of linearly interpolated bounding boxes, averaged over time.
+    static ValueType compute_motion_area(
+        const AABBType          keys[],
+        const size_t            key_count);
+
+    // Return the number of motion bounding boxes (minus one) of a subtree.
+    static size_t compute_motion_bbox_count(
+        const size_t            motion_segment_count,
+        const TimeInterval&     interval);
+
+    // Evaluate the motion bounding boxes of a subtree at the time key / key_count.
+    static AABBType evaluate(
+        const AABBVector&       keys,
+        const TimeInterval&     interval,
+        const size_t            key,
+        const size_t            key_count);
+
+    // Store the motion bounding boxes of a child node.
+    static void store_child_bboxes(
+        Tree&                   tree,
+        const AABBVector&       keys,
+        AABBType&               bbox,
+        size_t&                 bbox_index);
+};
+
+
+//
+// TemporalBuilder class implementation.
+//
+
+template <typename Tree, typename ItemHandler>
+TemporalBuilder<Tree, ItemHandler>::TemporalBuilder(
+    const size_t                max_leaf_size,
+    const size_t                bin_count,
+    const size_t                max_time_split_depth,
+    const ValueType             interior_node_traversal_cost,
+    const ValueType             item_intersection_cost)
+  : m_max_leaf_size(std::max<size_t>(max_leaf_size, 1))
+  , m_bin_count(std::max<size_t>(bin_count, 2))
+  , m_max_time_split_depth(max_time_split_depth)
+  , m_interior_node_traversal_cost(interior_node_traversal_cost)
+  , m_item_intersection_cost(item_intersection_cost)
+  , m_bin_counts(m_bin_count)
+  , m_left_areas(m_bin_count)
+  , m_left_counts(m_bin_count)
+  , m_object_split_count(0)
+  , m_time_split_count(0)
+  , m_build_time(0.0)
+{
+}
+
+template <typename Tree, typename ItemHandler>
+template <typename Timer>
+void TemporalBuilder<Tree, ItemHandler>::build(
+    Tree&                       tree,
+    const ItemHandler&          handler)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    // Clear the tree.
+    tree.m_nodes.clear();
+    tree.m_node_bboxes.clear();
+
+    m_item_ordering.clear();
+    m_object_split_count = 0;
+    m_time_split_count = 0;
+
+    // Create the root node of the tree.
+    tree.m_nodes.push_back(NodeType());
+
+    // The root node references all items over the whole shutter interval.
+    const size_t size = handler.size();
+    IndexVector items(size);
+    for (size_t i = 0; i < size; ++i)
+        items[i] = i;
+
+    // Recursively subdivide the tree.
+    subdivide_recurse(
+        tree,
+        handler,
+        0,                      // node index
+        items,
+        TimeInterval(0, 0));
+
+    // Measure and save construction time.
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename Tree, typename ItemHandler>
+inline const std::vector<size_t>& TemporalBuilder<Tree, ItemHandler>::get_item_ordering() const
+{
+    return m_item_ordering;
+}
+
+template <typename Tree, typename ItemHandler>
+inline size_t TemporalBuilder<Tree, ItemHandler>::get_object_split_count() const
+{
+    return m_object_split_count;
+}
+
+template <typename Tree, typename ItemHandler>
+inline size_t TemporalBuilder<Tree, ItemHandler>::get_time_split_count() const
+{
+    return m_time_split_count;
+}
+
+template <typename Tree, typename ItemHandler>
+inline double TemporalBuilder<Tree, ItemHandler>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::AABBVector TemporalBuilder<Tree, ItemHandler>::subdivide_recurse(
+    Tree&                       tree,
+    const ItemHandler&          handler,
+    const size_t                node_index,
+    IndexVector&                items,
+    const TimeInterval&         interval)
+{
+    assert(node_index < tree.m_nodes.size());
+
+    const size_t count = items.size();
+
+    size_t motion_segment_count = 0;
+    for (size_t i = 0; i < count; ++i)
+        motion_segment_count = std::max(motion_segment_count, handler.get_motion_segment_count(items[i]));
+
+    // Compute the bounding boxes of the items at the poses falling in the time interval of the node.
+    // Since these bounding boxes include the poses of all items, their union is the bounding box
+    // of the items over the whole time interval.
+    const size_t key_count = motion_segment_count + 1;
+    AABBVector item_keys(count * key_count);
+    AABBVector node_keys(key_count);
+    AABBVector centroids(count);
+    AABBType bbox, centroid_bbox;
+    bbox.invalidate();
+    centroid_bbox.invalidate();
+    for (size_t k = 0; k < key_count; ++k)
+        node_keys[k].invalidate();
+    for (size_t i = 0; i < count; ++i)
+    {
+        AABBType* keys = &item_keys[i * key_count];
+        compute_item_keys(handler, items[i], interval, key_count, keys);
+
+        AABBType item_bbox;
+        item_bbox.invalidate();
+        for (size_t k = 0; k < key_count; ++k)
+        {
+            item_bbox.insert(keys[k]);
+            node_keys[k].insert(keys[k]);
+        }
+
+        bbox.insert(item_bbox);
+        centroids[i] = AABBType(item_bbox.center(), item_bbox.center());
+        centroid_bbox.insert(centroids[i]);
+    }
+
+    enum SplitType { LeafSplit, ObjectSplit, MedianSplit, TimeSplit };
+    SplitType split_type = LeafSplit;
+    size_t split_dim = 0;
+    size_t split_bin = 0;
+
+    // Don't split leaves containing less than a predefined number of items or only degenerate items.
+    const ValueType area = count > 0 ? compute_motion_area(&node_keys[0], key_count) : ValueType(0.0);
+    if (count > m_max_leaf_size && bbox.rank() >= Dimension - 1 && area > ValueType(0.0))
+    {
+        const ValueType rcp_area = ValueType(1.0) / area;
+        ValueType best_cost = count * m_item_intersection_cost;
+
+        // Object split.
+        ValueType object_split_cost =
+            find_object_split(item_keys, key_count, centroids, centroid_bbox, split_dim, split_bin);
+        SplitType object_split_type = ObjectSplit;
+        if (object_split_cost == std::numeric_limits<ValueType>::max())
+        {
+            // All centroids coincide: fall back to splitting the items in two halves.
+            object_split_cost = compute_median_split_cost(item_keys, key_count);
+            object_split_type = MedianSplit;
+        }
+        object_split_cost =
+            m_interior_node_traversal_cost +
+            object_split_cost * rcp_area * m_item_intersection_cost;
+        if (best_cost > object_split_cost)
+        {
+            best_cost = object_split_cost;
+            split_type = object_split_type;
+        }
+
+        // Time split.
+        if (motion_segment_count > 0 && interval.m_depth < m_max_time_split_depth)
+        {
+            const ValueType time_split_cost =
+                m_interior_node_traversal_cost +
+                compute_time_split_cost(handler, items, interval, motion_segment_count)
+                    * rcp_area * m_item_intersection_cost;
+            if (best_cost > time_split_cost)
+            {
+                best_cost = time_split_cost;
+                split_type = TimeSplit;
+            }
+        }
+    }
+
+    // Keys are no longer needed.
+    AABBVector().swap(item_keys);
+
+    if (split_type == LeafSplit)
+    {
+        // Turn the current node into a leaf node.
+        NodeType& node = tree.m_nodes[node_index];
+        node.make_leaf();
+        node.set_item_index(m_item_ordering.size());
+        node.set_item_count(count);
+        m_item_ordering.insert(m_item_ordering.end(), items.begin(), items.end());
+
+        // Compute the motion bounding boxes of the leaf.
+        const size_t bbox_count = compute_motion_bbox_count(motion_segment_count, interval);
+        AABBVector keys(bbox_count + 1);
+        if (bbox_count == 0)
+            keys[0] = bbox;
+        else
+        {
+            for (size_t k = 0; k <= bbox_count; ++k)
+            {
+                keys[k].invalidate();
+
+                if (interval.contains(k, bbox_count))
+                {
+                    const ValueType time = static_cast<ValueType>(k) / bbox_count;
+                    for (size_t i = 0; i < count; ++i)
+                        keys[k].insert(handler.compute_bbox(items[i], time));
+                }
+            }
+        }
+
+        return keys;
+    }
+
+    // Partition the items.
+    IndexVector left_items, right_items;
+    TimeInterval left_interval = interval, right_interval = interval;
+    if (split_type == TimeSplit)
+    {
+        left_items = items;
+        right_items.swap(items);
+        left_interval = interval.get_left_half();
+        right_interval = interval.get_right_half();
+        ++m_time_split_count;
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool left =
+                split_type == ObjectSplit
+                    ? compute_bin_index(centroids[i], split_dim, centroid_bbox) <= split_bin
+                    : i < count / 2;
+            (left ? left_items : right_items).push_back(items[i]);
+        }
+        IndexVector().swap(items);
+        ++m_object_split_count;
+    }
+
+    // Centroids are no longer needed.
+    AABBVector().swap(centroids);
+
+    // Compute the indices of the child nodes.
+    const size_t left_node_index = tree.m_nodes.size();
+    const size_t right_node_index = left_node_index + 1;
+
+    // Turn the current node into an interior node.
+    tree.m_nodes[node_index].make_interior();
+    tree.m_nodes[node_index].set_child_node_index(left_node_index);
+
+    // Create the child nodes.
+    tree.m_nodes.push_back(NodeType());
+    tree.m_nodes.push_back(NodeType());
+
+    // Recurse into the child subtrees.
+    const AABBVector left_keys =
+        subdivide_recurse(tree, handler, left_node_index, left_items, left_interval);
+    const AABBVector right_keys =
+        subdivide_recurse(tree, handler, right_node_index, right_items, right_interval);
+
+    // Store the bounding boxes of the child nodes.
+    AABBType left_bbox, right_bbox;
+    size_t left_bbox_index, right_bbox_index;
+    store_child_bboxes(tree, left_keys, left_bbox, left_bbox_index);
+    store_child_bboxes(tree, right_keys, right_bbox, right_bbox_index);
+    NodeType& node = tree.m_nodes[node_index];
+    node.set_left_bbox(left_bbox);
+    node.set_left_bbox_index(left_bbox_index);
+    node.set_left_bbox_count(left_keys.size());
+    node.set_right_bbox(right_bbox);
+    node.set_right_bbox_index(right_bbox_index);
+    node.set_right_bbox_count(right_keys.size());
+
+    // Compute the motion bounding boxes of this subtree from the ones of the child subtrees.
+    const size_t bbox_count = compute_motion_bbox_count(motion_segment_count, interval);
+    AABBVector keys(bbox_count + 1);
+    for (size_t k = 0; k <= bbox_count; ++k)
+    {
+        keys[k] = evaluate(left_keys, left_interval, k, bbox_count);
+        keys[k].insert(evaluate(right_keys, right_interval, k, bbox_count));
+    }
+
+    return keys;
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::ValueType TemporalBuilder<Tree, ItemHandler>::find_object_split(
+    const AABBVector&           item_keys,
+    const size_t                key_count,
+    const AABBVector&           centroids,
+    const AABBType&             centroid_bbox,
+    size_t&                     split_dim,
+    size_t&                     split_bin)
+{
+    const size_t count = centroids.size();
+
+    m_bin_keys.resize(m_bin_count * key_count);
+
+    AABBVector accumulator(key_count);
+
+    ValueType best_cost = std::numeric_limits<ValueType>::max();
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        if (centroid_bbox.extent(d) <= ValueType(0.0))
+            continue;
+
+        // Bin the items.
+        for (size_t b = 0; b < m_bin_count * key_count; ++b)
+            m_bin_keys[b].invalidate();
+        for (size_t b = 0; b < m_bin_count; ++b)
+            m_bin_counts[b] = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const size_t b = compute_bin_index(centroids[i], d, centroid_bbox);
+            for (size_t k = 0; k < key_count; ++k)
+                m_bin_keys[b * key_count + k].insert(item_keys[i * key_count + k]);
+            ++m_bin_counts[b];
+        }
+
+        // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
+        for (size_t k = 0; k < key_count; ++k)
+            accumulator[k].invalidate();
+        size_t count_accumulator = 0;
+        for (size_t b = 0; b < m_bin_count - 1; ++b)
+        {
+            for (size_t k = 0; k < key_count; ++k)
+                accumulator[k].insert(m_bin_keys[b * key_count + k]);
+            count_accumulator += m_bin_counts[b];
+            m_left_areas[b] =
+                count_accumulator > 0
+                    ? compute_motion_area(&accumulator[0], key_count)
+                    : ValueType(0.0);
+            m_left_counts[b] = count_accumulator;
+        }
+
+        // Right-to-left sweep to accumulate bounding boxes and find the best partition.
+        for (size_t k = 0; k < key_count; ++k)
+            accumulator[k].invalidate();
+        count_accumulator = 0;
+        for (size_t b = m_bin_count - 1; b > 0; --b)
+        {
+            for (size_t k = 0; k < key_count; ++k)
+                accumulator[k].insert(m_bin_keys[b * key_count + k]);
+            count_accumulator += m_bin_counts[b];
+
+            if (count_accumulator == 0 || m_left_counts[b - 1] == 0)
+                continue;
+
+            const ValueType cost =
+                  m_left_areas[b - 1] * m_left_counts[b - 1]
+                + compute_motion_area(&accumulator[0], key_count) * count_accumulator;
+
+            if (best_cost > cost)
+            {
+                best_cost = cost;
+                split_dim = d;
+                split_bin = b - 1;
+            }
+        }
+    }
+
+    return best_cost;
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::ValueType TemporalBuilder<Tree, ItemHandler>::compute_median_split_cost(
+    const AABBVector&           item_keys,
+    const size_t                key_count)
+{
+    const size_t count = item_keys.size() / key_count;
+    const size_t left_count = count / 2;
+
+    AABBVector left_keys(key_count), right_keys(key_count);
+    for (size_t k = 0; k < key_count; ++k)
+    {
+        left_keys[k].invalidate();
+        right_keys[k].invalidate();
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        AABBVector& keys = i < left_count ? left_keys : right_keys;
+        for (size_t k = 0; k < key_count; ++k)
+            keys[k].insert(item_keys[i * key_count + k]);
+    }
+
+    return
+          compute_motion_area(&left_keys[0], key_count) * left_count
+        + compute_motion_area(&right_keys[0], key_count) * (count - left_count);
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::ValueType TemporalBuilder<Tree, ItemHandler>::compute_time_split_cost(
+    const ItemHandler&          handler,
+    const IndexVector&          items,
+    const TimeInterval&         interval,
+    const size_t                motion_segment_count)
+{
+    const TimeInterval left_interval = interval.get_left_half();
+    const TimeInterval right_interval = interval.get_right_half();
+    const size_t key_count = motion_segment_count + 1;
+
+    AABBVector left_keys(key_count), right_keys(key_count), item_keys(key_count);
+    for (size_t k = 0; k < key_count; ++k)
+    {
+        left_keys[k].invalidate();
+        right_keys[k].invalidate();
+    }
+
+    for (size_t i = 0, e = items.size(); i < e; ++i)
+    {
+        compute_item_keys(handler, items[i], left_interval, key_count, &item_keys[0]);
+        for (size_t k = 0; k < key_count; ++k)
+            left_keys[k].insert(item_keys[k]);
+
+        compute_item_keys(handler, items[i], right_interval, key_count, &item_keys[0]);
+        for (size_t k = 0; k < key_count; ++k)
+            right_keys[k].insert(item_keys[k]);
+    }
+
+    // Each child node is only visited by the rays whose time falls in its half of the interval.
+    return
+        (compute_motion_area(&left_keys[0], key_count) + compute_motion_area(&right_keys[0], key_count))
+            * ValueType(0.5) * static_cast<ValueType>(items.size());
+}
+
+template <typename Tree, typename ItemHandler>
+inline size_t TemporalBuilder<Tree, ItemHandler>::compute_bin_index(
+    const AABBType&             centroid,
+    const size_t                dim,
+    const AABBType&             centroid_bbox) const
+{
+    const ValueType x =
+        (centroid.min[dim] - centroid_bbox.min[dim]) * m_bin_count / centroid_bbox.extent(dim);
+
+    return std::min(truncate<size_t>(x), m_bin_count - 1);
+}
+
+template <typename Tree, typename ItemHandler>
+void TemporalBuilder<Tree, ItemHandler>::compute_item_keys(
+    const ItemHandler&          handler,
+    const size_t                item_index,
+    const TimeInterval&         interval,
+    const size_t                key_count,
+    AABBType                    keys[])
+{
+    if (key_count == 1)
+    {
+        // The item is static, any time value will do.
+        keys[0] = handler.compute_bbox(item_index, interval.get_time(interval.m_index, size_t(1) << interval.m_depth));
+        return;
+    }
+
+    const size_t segment_count = key_count - 1;
+    const size_t base_key = interval.m_index * segment_count;
+    const size_t total_key_count = segment_count << interval.m_depth;
+
+    for (size_t k = 0; k < key_count; ++k)
+        keys[k] = handler.compute_bbox(item_index, interval.get_time(base_key + k, total_key_count));
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::ValueType TemporalBuilder<Tree, ItemHandler>::compute_motion_area(
+    const AABBType              keys[],
+    const size_t                key_count)
+{
+    if (key_count == 1)
+        return half_surface_area(keys[0]);
+
+    // The surface area of a linearly interpolated bounding box is a quadratic function
+    // of time, hence Simpson's rule gives the exact average over each motion segment.
+    ValueType area = ValueType(0.0);
+    ValueType next_area = half_surface_area(keys[0]);
+
+    for (size_t k = 0; k < key_count - 1; ++k)
+    {
+        const ValueType prev_area = next_area;
+        next_area = half_surface_area(keys[k + 1]);
+
+        const AABBType mid(
+            ValueType(0.5) * (keys[k].min + keys[k + 1].min),
+            ValueType(0.5) * (keys[k].max + keys[k + 1].max));
+
+        area += prev_area + ValueType(4.0) * half_surface_area(mid) + next_area;
+    }
+
+    return area / (ValueType(6.0) * (key_count - 1));
+}
+
+template <typename Tree, typename ItemHandler>
+inline size_t TemporalBuilder<Tree, ItemHandler>::compute_motion_bbox_count(
+    const size_t                motion_segment_count,
+    const TimeInterval&         interval)
+{
+    // Keys must fall on the poses of the items and on the bounds of the time interval.
+    const size_t interval_count = size_t(1) << interval.m_depth;
+
+    return
+        motion_segment_count > 0 ? motion_segment_count * interval_count :
+        interval.m_depth > 0 ? interval_count :
+        0;
+}
+
+template <typename Tree, typename ItemHandler>
+typename TemporalBuilder<Tree, ItemHandler>::AABBType TemporalBuilder<Tree, ItemHandler>::evaluate(
+    const AABBVector&           keys,
+    const TimeInterval&         interval,
+    const size_t                key,
+    const size_t                key_count)
+{
+    const size_t child_key_count = keys.size() - 1;
+
+    if (child_key_count == 0)
+        return keys[0];
+
+    assert(key_count > 0);
+
+    if (!interval.contains(key, key_count))
+    {
+        AABBType bbox;
+        bbox.invalidate();
+        return bbox;
+    }
+
+    // Use integer arithmetic to locate the key exactly.
+    const size_t x = key * child_key_count;
+    const size_t prev_key = x / key_count;
+    const size_t remainder = x % key_count;
+
+    if (remainder == 0)
+        return keys[prev_key];
+
+    // Both keys belong to the time interval of the subtree.
+    assert(prev_key < child_key_count);
+    return
+        lerp(
+            keys[prev_key],
+            keys[prev_key + 1],
+            static_cast<ValueType>(remainder) / key_count);
+}
+
+template <typename Tree, typename ItemHandler>
+void TemporalBuilder<Tree, ItemHandler>::store_child_bboxes(
+    Tree&                       tree,
+    const AABBVector&           keys,
+    AABBType&                   bbox,
+    size_t&                     bbox_index)
+{
+    bbox.invalidate();
+    for (size_t k = 0, e = keys.size(); k < e; ++k)
+        bbox.insert(keys[k]);
+
+    bbox_index = 0;
+
+    if (keys.size() > 1)
+    {
+        bbox_index = tree.m_node_bboxes.size();
+
+        for (size_t k = 0, e = keys.size(); k < e; ++k)
+            tree.m_node_bboxes.push_back(swizzle_motion_bbox(keys[k]));
+    }
+}
+
+
+//
+// TemporalBuilder::TimeInterval class implementation.
+//
+
+template <typename Tree, typename ItemHandler>
+inline TemporalBuilder<Tree, ItemHandler>::TimeInterval::TimeInterval(
+    const size_t                index,
+    const size_t                depth)
+  : m_index(index)
+  , m_depth(depth)
+{
+}
+
+template <typename Tree, typename ItemHandler>
+inline typename TemporalBuilder<Tree, ItemHandler>::TimeInterval
+TemporalBuilder<Tree, ItemHandler>::TimeInterval::get_left_half() const
+{
+    return TimeInterval(m_index * 2, m_depth + 1);
+}
+
+template <typename Tree, typename ItemHandler>
+inline typename TemporalBuilder<Tree, ItemHandler>::TimeInterval
+TemporalBuilder<Tree, ItemHandler>::TimeInterval::get_right_half() const
+{
+    return TimeInterval(m_index * 2 + 1, m_depth + 1);
+}
+
+template <typename Tree, typename ItemHandler>
+inline typename TemporalBuilder<Tree, ItemHandler>::ValueType
+TemporalBuilder<Tree, ItemHandler>::TimeInterval::get_time(
+    const size_t                key,
+    const size_t                key_count) const
+{
+    assert(key_count % (size_t(1) << m_depth) == 0);
+    assert(contains(key, key_count));
+
+    return static_cast<ValueType>(key) / key_count;
+}
+
+template <typename Tree, typename ItemHandler>
+inline bool TemporalBuilder<Tree, ItemHandler>::TimeInterval::contains(
+    const size_t                key,
+    const size_t                key_count) const
+{
+    // key / key_count in [m_index / 2^m_depth, (m_index + 1) / 2^m_depth].
+    const size_t x = key << m_depth;
+    return x >= m_index * key_count && x <= (m_index + 1) * key_count;
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_TEMPORALBUILDER_H
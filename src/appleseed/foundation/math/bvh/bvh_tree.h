@@ -32,6 +32,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
 
 // Standard headers.
 #include <cstddef>
@@ -70,12 +71,21 @@ class Tree
     template <typename Tree, typename Partitioner>
     friend class SpatialBuilder;
 
+    template <typename Tree, typename Partitioner>
+    friend class ParallelSpatialBuilder;
+
+    template <typename Tree, typename ItemHandler>
+    friend class TemporalBuilder;
+
     template <typename Tree>
     friend class TreeStatistics;
 
     template <typename Tree, typename Visitor, typename Ray, size_t StackSize, size_t N>
     friend class Intersector;
 
+    template <typename Tree, typename Visitor, typename Ray, size_t PacketSize, size_t StackSize>
+    friend class PacketIntersector;
+
     typedef typename NodeType::AABBType AABBType;
     typedef std::vector<AABBType> AABBVector;
 
@@ -84,6 +94,26 @@ class Tree
 };
 
 
+//
+// Convert a bounding box to the layout expected by the intersectors in the motion
+// bounding boxes of a tree.
+//
+// When SSE is enabled, if the bounding box is seen as a flat array of scalars,
+// the bounding box is converted from
+//
+//   min.x  min.y  min.z  max.x  max.y  max.z
+//
+// to
+//
+//   min.x  max.x  min.y  max.y  min.z  max.z
+//
+// The function has no effect when SSE is disabled.
+//
+
+template <typename T, size_t N>
+AABB<T, N> swizzle_motion_bbox(const AABB<T, N>& bbox);
+
+
 //
 // Tree class implementation.
 //
@@ -109,6 +139,38 @@ size_t Tree<NodeVector>::get_memory_size() const
         + m_nodes.capacity() * sizeof(NodeType);
 }
 
+
+//
+// swizzle_motion_bbox() function implementation.
+//
+
+#ifdef APPLESEED_USE_SSE
+
+template <typename T, size_t N>
+inline AABB<T, N> swizzle_motion_bbox(const AABB<T, N>& bbox)
+{
+    AABB<T, N> result;
+    T* flat_result = &result[0][0];
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        flat_result[i * 2 + 0] = bbox[0][i];
+        flat_result[i * 2 + 1] = bbox[1][i];
+    }
+
+    return result;
+}
+
+#else
+
+template <typename T, size_t N>
+inline AABB<T, N> swizzle_motion_bbox(const AABB<T, N>& bbox)
+{
+    return bbox;
+}
+
+#endif
+
 }       // namespace bvh
 }       // namespace foundation
 
@@ -0,0 +1,209 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEBUILDER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEBUILDER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Wide BVH builder.
+//
+// Collapses the binary hierarchy of a foundation::bvh::WideTree (built by any of the
+// binary builders) into wide nodes. Each wide node is formed by repeatedly opening
+// the interior child with the largest surface area until all child slots are used.
+//
+
+template <typename Tree>
+class WideBuilder
+  : public NonCopyable
+{
+  public:
+    // Constructor.
+    WideBuilder();
+
+    // Build the wide hierarchy of a tree whose binary hierarchy was already built.
+    template <typename Timer>
+    void build(Tree& tree);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+  private:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::WideNodeType WideNodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    static const size_t Width = WideNodeType::Width;
+
+    double m_build_time;
+
+    // Recursively collapse the binary tree.
+    void collapse_recurse(
+        Tree&           tree,
+        const size_t    wide_node_index,
+        const size_t    node_index);
+};
+
+
+//
+// WideBuilder class implementation.
+//
+
+template <typename Tree>
+WideBuilder<Tree>::WideBuilder()
+  : m_build_time(0.0)
+{
+}
+
+template <typename Tree>
+template <typename Timer>
+void WideBuilder<Tree>::build(Tree& tree)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    // Clear the wide hierarchy.
+    tree.m_wide_nodes.clear();
+
+    // A tree reduced to a single leaf doesn't need a wide hierarchy.
+    if (!tree.m_nodes.empty() && tree.m_nodes[0].is_interior())
+    {
+        // Each wide node replaces at least Width - 1 binary interior nodes.
+        const size_t interior_node_count_guess = tree.m_nodes.size() / 2;
+        tree.m_wide_nodes.reserve(interior_node_count_guess / (Width - 1) + 1);
+
+        // Create the root node and recursively collapse the tree.
+        tree.m_wide_nodes.push_back(WideNodeType());
+        collapse_recurse(tree, 0, 0);
+    }
+
+    // Measure and save construction time.
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename Tree>
+inline double WideBuilder<Tree>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename Tree>
+void WideBuilder<Tree>::collapse_recurse(
+    Tree&               tree,
+    const size_t        wide_node_index,
+    const size_t        node_index)
+{
+    const NodeType& node = tree.m_nodes[node_index];
+    assert(node.is_interior());
+
+    // Start with the two children of the binary node.
+    AABBType child_bboxes[Width];
+    size_t child_indices[Width];
+    child_bboxes[0] = node.get_left_bbox();
+    child_bboxes[1] = node.get_right_bbox();
+    child_indices[0] = node.get_child_node_index();
+    child_indices[1] = node.get_child_node_index() + 1;
+    size_t child_count = 2;
+
+    // Open the interior child with the largest surface area until all slots are used.
+    while (child_count < Width)
+    {
+        size_t best_child = Width;
+        ValueType best_area = ValueType(-1.0);
+
+        for (size_t i = 0; i < child_count; ++i)
+        {
+            if (tree.m_nodes[child_indices[i]].is_leaf())
+                continue;
+
+            const ValueType area = half_surface_area(child_bboxes[i]);
+            if (best_area < area)
+            {
+                best_area = area;
+                best_child = i;
+            }
+        }
+
+        if (best_child == Width)
+            break;
+
+        const NodeType& opened = tree.m_nodes[child_indices[best_child]];
+        const size_t opened_child_index = opened.get_child_node_index();
+
+        child_bboxes[child_count] = opened.get_right_bbox();
+        child_indices[child_count] = opened_child_index + 1;
+        ++child_count;
+
+        child_bboxes[best_child] = opened.get_left_bbox();
+        child_indices[best_child] = opened_child_index;
+    }
+
+    // Store the children into the wide node, creating new wide nodes for interior children.
+    size_t wide_child_indices[Width];
+
+    for (size_t i = 0; i < child_count; ++i)
+    {
+        if (tree.m_nodes[child_indices[i]].is_leaf())
+        {
+            tree.m_wide_nodes[wide_node_index].add_leaf_child(child_bboxes[i], child_indices[i]);
+            wide_child_indices[i] = ~size_t(0);
+        }
+        else
+        {
+            wide_child_indices[i] = tree.m_wide_nodes.size();
+            tree.m_wide_nodes.push_back(WideNodeType());
+            tree.m_wide_nodes[wide_node_index].add_interior_child(child_bboxes[i], wide_child_indices[i]);
+        }
+    }
+
+    // Recurse into interior children.
+    for (size_t i = 0; i < child_count; ++i)
+    {
+        if (wide_child_indices[i] != ~size_t(0))
+            collapse_recurse(tree, wide_child_indices[i], child_indices[i]);
+    }
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEBUILDER_H
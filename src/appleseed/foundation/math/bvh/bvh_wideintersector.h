@@ -0,0 +1,607 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/bvh/bvh_intersector.h"
+#include "foundation/math/bvh/bvh_statistics.h"
+#include "foundation/math/bvh/bvh_widenode.h"
+#include "foundation/math/ray.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// Boost headers.
+#include "boost/static_assert.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Intersection of a ray with all the child bounding boxes of a wide node at once.
+//
+// The generic implementation is written so that the compiler can vectorize it;
+// SSE and AVX versions are provided for the common double and single precision cases.
+//
+
+template <typename T, size_t Width>
+struct WideNodeBBoxTester
+{
+    T       m_org[3];
+    T       m_rcp_dir[3];
+    bool    m_positive_dir[3];
+    T       m_ray_tmin;
+
+    template <typename Ray, typename RayInfo>
+    WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info);
+
+    // Return a bitmask of the children hit by the ray; entry distances are stored in 'tmin'.
+    template <typename WideNodeType>
+    size_t intersect(
+        const WideNodeType& node,
+        const T             ray_tmax,
+        T                   tmin[Width]) const;
+};
+
+template <typename T, size_t Width>
+template <typename Ray, typename RayInfo>
+inline WideNodeBBoxTester<T, Width>::WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info)
+  : m_ray_tmin(static_cast<T>(ray.m_tmin))
+{
+    for (size_t d = 0; d < 3; ++d)
+    {
+        m_org[d] = static_cast<T>(ray.m_org[d]);
+        m_rcp_dir[d] = static_cast<T>(ray_info.m_rcp_dir[d]);
+        m_positive_dir[d] = ray_info.m_sgn_dir[d] != 0;
+    }
+}
+
+template <typename T, size_t Width>
+template <typename WideNodeType>
+inline size_t WideNodeBBoxTester<T, Width>::intersect(
+    const WideNodeType&     node,
+    const T                 ray_tmax,
+    T                       tmin[Width]) const
+{
+    T tmax[Width];
+
+    for (size_t i = 0; i < Width; ++i)
+    {
+        tmin[i] = m_ray_tmin;
+        tmax[i] = ray_tmax;
+    }
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        const T* near_planes = m_positive_dir[d] ? node.m_bbox_min[d] : node.m_bbox_max[d];
+        const T* far_planes = m_positive_dir[d] ? node.m_bbox_max[d] : node.m_bbox_min[d];
+
+        for (size_t i = 0; i < Width; ++i)
+        {
+            const T t0 = (near_planes[i] - m_org[d]) * m_rcp_dir[d];
+            const T t1 = (far_planes[i] - m_org[d]) * m_rcp_dir[d];
+            tmin[i] = t0 > tmin[i] ? t0 : tmin[i];
+            tmax[i] = t1 < tmax[i] ? t1 : tmax[i];
+        }
+    }
+
+    size_t hits = 0;
+
+    for (size_t i = 0; i < Width; ++i)
+    {
+        if (tmin[i] <= tmax[i] && tmin[i] < ray_tmax)
+            hits |= size_t(1) << i;
+    }
+
+    return hits & ((size_t(1) << node.m_child_count) - 1);
+}
+
+#ifdef APPLESEED_USE_SSE
+
+#ifdef APPLESEED_USE_AVX
+
+template <>
+struct WideNodeBBoxTester<double, 4>
+{
+    __m256d m_org[3];
+    __m256d m_rcp_dir[3];
+    bool    m_positive_dir[3];
+    __m256d m_ray_tmin;
+
+    template <typename Ray, typename RayInfo>
+    WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info)
+      : m_ray_tmin(_mm256_set1_pd(ray.m_tmin))
+    {
+        for (size_t d = 0; d < 3; ++d)
+        {
+            m_org[d] = _mm256_set1_pd(ray.m_org[d]);
+            m_rcp_dir[d] = _mm256_set1_pd(ray_info.m_rcp_dir[d]);
+            m_positive_dir[d] = ray_info.m_sgn_dir[d] != 0;
+        }
+    }
+
+    template <typename WideNodeType>
+    size_t intersect(
+        const WideNodeType& node,
+        const double        ray_tmax,
+        double              tmin[4]) const
+    {
+        const __m256d mray_tmax = _mm256_set1_pd(ray_tmax);
+
+        __m256d lo = m_ray_tmin;
+        __m256d hi = mray_tmax;
+
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const double* near_planes = m_positive_dir[d] ? node.m_bbox_min[d] : node.m_bbox_max[d];
+            const double* far_planes = m_positive_dir[d] ? node.m_bbox_max[d] : node.m_bbox_min[d];
+            lo = _mm256_max_pd(lo, _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(near_planes), m_org[d]), m_rcp_dir[d]));
+            hi = _mm256_min_pd(hi, _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(far_planes), m_org[d]), m_rcp_dir[d]));
+        }
+
+        _mm256_storeu_pd(tmin, lo);
+
+        const int hits =
+            _mm256_movemask_pd(
+                _mm256_and_pd(
+                    _mm256_cmp_pd(lo, hi, _CMP_LE_OQ),
+                    _mm256_cmp_pd(lo, mray_tmax, _CMP_LT_OQ)));
+
+        return static_cast<size_t>(hits) & ((size_t(1) << node.m_child_count) - 1);
+    }
+};
+
+template <>
+struct WideNodeBBoxTester<float, 8>
+{
+    __m256  m_org[3];
+    __m256  m_rcp_dir[3];
+    bool    m_positive_dir[3];
+    __m256  m_ray_tmin;
+
+    template <typename Ray, typename RayInfo>
+    WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info)
+      : m_ray_tmin(_mm256_set1_ps(static_cast<float>(ray.m_tmin)))
+    {
+        for (size_t d = 0; d < 3; ++d)
+        {
+            m_org[d] = _mm256_set1_ps(static_cast<float>(ray.m_org[d]));
+            m_rcp_dir[d] = _mm256_set1_ps(static_cast<float>(ray_info.m_rcp_dir[d]));
+            m_positive_dir[d] = ray_info.m_sgn_dir[d] != 0;
+        }
+    }
+
+    template <typename WideNodeType>
+    size_t intersect(
+        const WideNodeType& node,
+        const float         ray_tmax,
+        float               tmin[8]) const
+    {
+        const __m256 mray_tmax = _mm256_set1_ps(ray_tmax);
+
+        __m256 lo = m_ray_tmin;
+        __m256 hi = mray_tmax;
+
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const float* near_planes = m_positive_dir[d] ? node.m_bbox_min[d] : node.m_bbox_max[d];
+            const float* far_planes = m_positive_dir[d] ? node.m_bbox_max[d] : node.m_bbox_min[d];
+            lo = _mm256_max_ps(lo, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_planes), m_org[d]), m_rcp_dir[d]));
+            hi = _mm256_min_ps(hi, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_planes), m_org[d]), m_rcp_dir[d]));
+        }
+
+        _mm256_storeu_ps(tmin, lo);
+
+        const int hits =
+            _mm256_movemask_ps(
+                _mm256_and_ps(
+                    _mm256_cmp_ps(lo, hi, _CMP_LE_OQ),
+                    _mm256_cmp_ps(lo, mray_tmax, _CMP_LT_OQ)));
+
+        return static_cast<size_t>(hits) & ((size_t(1) << node.m_child_count) - 1);
+    }
+};
+
+#else
+
+template <>
+struct WideNodeBBoxTester<double, 4>
+{
+    __m128d m_org[3];
+    __m128d m_rcp_dir[3];
+    bool    m_positive_dir[3];
+    __m128d m_ray_tmin;
+
+    template <typename Ray, typename RayInfo>
+    WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info)
+      : m_ray_tmin(_mm_set1_pd(ray.m_tmin))
+    {
+        for (size_t d = 0; d < 3; ++d)
+        {
+            m_org[d] = _mm_set1_pd(ray.m_org[d]);
+            m_rcp_dir[d] = _mm_set1_pd(ray_info.m_rcp_dir[d]);
+            m_positive_dir[d] = ray_info.m_sgn_dir[d] != 0;
+        }
+    }
+
+    template <typename WideNodeType>
+    size_t intersect(
+        const WideNodeType& node,
+        const double        ray_tmax,
+        double              tmin[4]) const
+    {
+        const __m128d mray_tmax = _mm_set1_pd(ray_tmax);
+
+        __m128d lo01 = m_ray_tmin, lo23 = m_ray_tmin;
+        __m128d hi01 = mray_tmax, hi23 = mray_tmax;
+
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const double* near_planes = m_positive_dir[d] ? node.m_bbox_min[d] : node.m_bbox_max[d];
+            const double* far_planes = m_positive_dir[d] ? node.m_bbox_max[d] : node.m_bbox_min[d];
+            lo01 = _mm_max_pd(lo01, _mm_mul_pd(_mm_sub_pd(_mm_load_pd(near_planes + 0), m_org[d]), m_rcp_dir[d]));
+            lo23 = _mm_max_pd(lo23, _mm_mul_pd(_mm_sub_pd(_mm_load_pd(near_planes + 2), m_org[d]), m_rcp_dir[d]));
+            hi01 = _mm_min_pd(hi01, _mm_mul_pd(_mm_sub_pd(_mm_load_pd(far_planes + 0), m_org[d]), m_rcp_dir[d]));
+            hi23 = _mm_min_pd(hi23, _mm_mul_pd(_mm_sub_pd(_mm_load_pd(far_planes + 2), m_org[d]), m_rcp_dir[d]));
+        }
+
+        _mm_storeu_pd(tmin + 0, lo01);
+        _mm_storeu_pd(tmin + 2, lo23);
+
+        const int hits01 = _mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(lo01, hi01), _mm_cmplt_pd(lo01, mray_tmax)));
+        const int hits23 = _mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(lo23, hi23), _mm_cmplt_pd(lo23, mray_tmax)));
+
+        return static_cast<size_t>(hits01 | (hits23 << 2)) & ((size_t(1) << node.m_child_count) - 1);
+    }
+};
+
+#endif  // APPLESEED_USE_AVX
+
+template <>
+struct WideNodeBBoxTester<float, 4>
+{
+    __m128  m_org[3];
+    __m128  m_rcp_dir[3];
+    bool    m_positive_dir[3];
+    __m128  m_ray_tmin;
+
+    template <typename Ray, typename RayInfo>
+    WideNodeBBoxTester(const Ray& ray, const RayInfo& ray_info)
+      : m_ray_tmin(_mm_set1_ps(static_cast<float>(ray.m_tmin)))
+    {
+        for (size_t d = 0; d < 3; ++d)
+        {
+            m_org[d] = _mm_set1_ps(static_cast<float>(ray.m_org[d]));
+            m_rcp_dir[d] = _mm_set1_ps(static_cast<float>(ray_info.m_rcp_dir[d]));
+            m_positive_dir[d] = ray_info.m_sgn_dir[d] != 0;
+        }
+    }
+
+    template <typename WideNodeType>
+    size_t intersect(
+        const WideNodeType& node,
+        const float         ray_tmax,
+        float               tmin[4]) const
+    {
+        const __m128 mray_tmax = _mm_set1_ps(ray_tmax);
+
+        __m128 lo = m_ray_tmin;
+        __m128 hi = mray_tmax;
+
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const float* near_planes = m_positive_dir[d] ? node.m_bbox_min[d] : node.m_bbox_max[d];
+            const float* far_planes = m_positive_dir[d] ? node.m_bbox_max[d] : node.m_bbox_min[d];
+            lo = _mm_max_ps(lo, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_planes), m_org[d]), m_rcp_dir[d]));
+            hi = _mm_min_ps(hi, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_planes), m_org[d]), m_rcp_dir[d]));
+        }
+
+        _mm_storeu_ps(tmin, lo);
+
+        const int hits = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(lo, hi), _mm_cmplt_ps(lo, mray_tmax)));
+
+        return static_cast<size_t>(hits) & ((size_t(1) << node.m_child_count) - 1);
+    }
+};
+
+#endif  // APPLESEED_USE_SSE
+
+
+//
+// Wide BVH intersector.
+//
+// Traverses the wide hierarchy of a foundation::bvh::WideTree and visits the leaf nodes
+// of its binary hierarchy. Children of a node are visited in front-to-back order and
+// stacked children are culled when they are farther than the closest hit found so far.
+//
+// Motion blur is not supported by the wide hierarchy: intersect_motion() traverses the
+// binary hierarchy with foundation::bvh::Intersector.
+//
+// The Visitor class must conform to the prototype documented in bvh_intersector.h.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize = 64,
+    size_t N = Tree::NodeType::AABBType::Dimension
+>
+class WideIntersector
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::WideNodeType WideNodeType;
+    typedef typename NodeType::AABBType::ValueType ValueType;
+    typedef Ray RayType;
+    typedef RayInfo<ValueType, NodeType::AABBType::Dimension> RayInfoType;
+
+    // Intersect a ray with a given BVH without motion.
+    void intersect_no_motion(
+        const Tree&             tree,
+        const RayType&          ray,
+        const RayInfoType&      ray_info,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+    // Intersect a ray with a given BVH with motion.
+    void intersect_motion(
+        const Tree&             tree,
+        const RayType&          ray,
+        const RayInfoType&      ray_info,
+        const ValueType         ray_time,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+  private:
+    static const size_t Width = WideNodeType::Width;
+
+    BOOST_STATIC_ASSERT(N == 3);
+
+    typedef Intersector<Tree, Visitor, Ray, StackSize, N> BinaryIntersectorType;
+};
+
+
+//
+// WideIntersector class implementation.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize,
+    size_t N
+>
+void WideIntersector<Tree, Visitor, Ray, StackSize, N>::intersect_no_motion(
+    const Tree&                 tree,
+    const RayType&              ray,
+    const RayInfoType&          ray_info,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    // Make sure the tree was built.
+    assert(!tree.m_nodes.empty());
+
+    // Trees reduced to a single leaf don't have a wide hierarchy.
+    if (tree.m_wide_nodes.empty())
+    {
+        BinaryIntersectorType intersector;
+        intersector.intersect_no_motion(
+            tree,
+            ray,
+            ray_info,
+            visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , stats
+#endif
+            );
+        return;
+    }
+
+    // Precompute ray data used to test child bounding boxes.
+    const WideNodeBBoxTester<ValueType, Width> tester(ray, ray_info);
+
+    // Node stack. Each wide node can push up to Width - 1 children.
+    uint32 stack_refs[StackSize * (Width - 1)];
+    ValueType stack_distances[StackSize * (Width - 1)];
+    size_t stack_size = 0;
+
+    // Current node.
+    uint32 node_ref = 0;
+
+    // Initialize traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(++stats.m_traversal_count);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_nodes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_leaves = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t intersected_bboxes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t discarded_nodes = 0);
+
+    // Traverse the tree and intersect leaf nodes.
+    ValueType ray_tmax = static_cast<ValueType>(ray.m_tmax);
+    while (true)
+    {
+        // Fetch the node.
+        FOUNDATION_BVH_TRAVERSAL_STATS(++visited_nodes);
+
+        if (!WideNodeType::is_leaf_ref(node_ref))
+        {
+            const WideNodeType& node = tree.m_wide_nodes[node_ref];
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(intersected_bboxes += node.get_child_count());
+
+            // Intersect all child bounding boxes at once.
+            APPLESEED_SIMD8_ALIGN ValueType tmin[Width];
+            const size_t hits = tester.intersect(node, ray_tmax, tmin);
+
+            if (hits != 0)
+            {
+                // Gather the children that were hit.
+                uint32 hit_refs[Width];
+                ValueType hit_distances[Width];
+                size_t hit_count = 0;
+
+                for (size_t i = 0; i < Width; ++i)
+                {
+                    if (hits & (size_t(1) << i))
+                    {
+                        // Insertion sort by decreasing distance.
+                        size_t j = hit_count++;
+                        while (j > 0 && hit_distances[j - 1] < tmin[i])
+                        {
+                            hit_refs[j] = hit_refs[j - 1];
+                            hit_distances[j] = hit_distances[j - 1];
+                            --j;
+                        }
+                        hit_refs[j] = node.m_children[i];
+                        hit_distances[j] = tmin[i];
+                    }
+                }
+
+                FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += node.get_child_count() - hit_count);
+
+                // Push the far children to the stack, continue with the nearest child.
+                assert(stack_size + hit_count - 1 <= StackSize * (Width - 1));
+                for (size_t i = 0; i < hit_count - 1; ++i)
+                {
+                    stack_refs[stack_size] = hit_refs[i];
+                    stack_distances[stack_size] = hit_distances[i];
+                    ++stack_size;
+                }
+
+                node_ref = hit_refs[hit_count - 1];
+                continue;
+            }
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += node.get_child_count());
+        }
+        else
+        {
+            // Visit the leaf.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_leaves);
+            ValueType distance;
+#ifndef NDEBUG
+            distance = ValueType(-1.0);
+#endif
+            const bool proceed =
+                visitor.visit(
+                    tree.m_nodes[WideNodeType::get_ref_index(node_ref)],
+                    ray,
+                    ray_info,
+                    distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+            assert(!proceed || distance >= ValueType(0.0));
+
+            // Terminate traversal if the visitor decided so.
+            if (!proceed)
+                break;
+
+            // Keep track of the distance to the closest intersection.
+            if (ray_tmax > distance)
+                ray_tmax = distance;
+        }
+
+        // Discard stacked nodes that are beyond the closest intersection found so far.
+        while (stack_size > 0 && !(stack_distances[stack_size - 1] < ray_tmax))
+        {
+            FOUNDATION_BVH_TRAVERSAL_STATS(++discarded_nodes);
+            --stack_size;
+        }
+
+        // Terminate traversal if the node stack is empty.
+        if (stack_size == 0)
+            break;
+
+        // Pop the top node from the stack.
+        node_ref = stack_refs[--stack_size];
+    }
+
+    // Store traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_nodes.insert(visited_nodes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_leaves.insert(visited_leaves));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_bboxes.insert(intersected_bboxes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_discarded_nodes.insert(discarded_nodes));
+}
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize,
+    size_t N
+>
+inline void WideIntersector<Tree, Visitor, Ray, StackSize, N>::intersect_motion(
+    const Tree&                 tree,
+    const RayType&              ray,
+    const RayInfoType&          ray_info,
+    const ValueType             ray_time,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    BinaryIntersectorType intersector;
+    intersector.intersect_motion(
+        tree,
+        ray,
+        ray_info,
+        ray_time,
+        visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , stats
+#endif
+        );
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
@@ -0,0 +1,231 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
+
+// appleseed.foundation headers.
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+
+// Boost headers.
+#include "boost/static_assert.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Interior node of a wide (N-ary) BVH.
+//
+// A wide node stores the bounding boxes of up to Width children in SoA form so that
+// all of them can be tested against a ray at once. Children are either other wide
+// nodes or leaf nodes of the underlying binary BVH; child slots are filled from the
+// first one, the remaining slots are empty.
+//
+
+template <typename AABB, size_t W>
+class APPLESEED_ALIGN(64) WideNode
+{
+  public:
+    typedef AABB AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    static const size_t Width = W;
+    static const size_t Dimension = AABBType::Dimension;
+
+    BOOST_STATIC_ASSERT(Width >= 2 && Width <= 8);
+
+    // Constructor, creates a node without children.
+    WideNode();
+
+    // Remove all children.
+    void clear();
+
+    // Return the number of non-empty child slots.
+    size_t get_child_count() const;
+
+    // Append a child to this node. 'index' is the index of a wide node for interior
+    // children or the index of a binary node for leaf children.
+    void add_interior_child(const AABBType& bbox, const size_t index);
+    void add_leaf_child(const AABBType& bbox, const size_t index);
+
+    // Return whether a given child is a leaf node.
+    bool is_leaf_child(const size_t slot) const;
+
+    // Return the index of a given child (see add_interior_child() and add_leaf_child()).
+    size_t get_child_index(const size_t slot) const;
+
+    // Return the bounding box of a given child.
+    AABBType get_child_bbox(const size_t slot) const;
+
+    // Return the raw child reference of a given slot (leaf flag in the most significant bit).
+    uint32 get_child_ref(const size_t slot) const;
+
+    // Child reference encoding.
+    static const uint32 LeafFlag = 0x80000000UL;
+    static bool is_leaf_ref(const uint32 ref);
+    static size_t get_ref_index(const uint32 ref);
+
+  private:
+    template <typename Tree, typename Visitor, typename Ray, size_t StackSize, size_t N>
+    friend class WideIntersector;
+
+    template <typename T, size_t Width2>
+    friend struct WideNodeBBoxTester;
+
+    APPLESEED_SIMD8_ALIGN ValueType m_bbox_min[Dimension][Width];
+    APPLESEED_SIMD8_ALIGN ValueType m_bbox_max[Dimension][Width];
+
+    uint32                          m_children[Width];
+    uint32                          m_child_count;
+
+    void add_child(const AABBType& bbox, const uint32 ref);
+};
+
+
+//
+// WideNode class implementation.
+//
+
+template <typename AABB, size_t W>
+inline WideNode<AABB, W>::WideNode()
+{
+    clear();
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::clear()
+{
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        for (size_t i = 0; i < Width; ++i)
+        {
+            m_bbox_min[d][i] = ValueType(0.0);
+            m_bbox_max[d][i] = ValueType(0.0);
+        }
+    }
+
+    for (size_t i = 0; i < Width; ++i)
+        m_children[i] = ~uint32(0);
+
+    m_child_count = 0;
+}
+
+template <typename AABB, size_t W>
+inline size_t WideNode<AABB, W>::get_child_count() const
+{
+    return static_cast<size_t>(m_child_count);
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::add_interior_child(const AABBType& bbox, const size_t index)
+{
+    assert(index < LeafFlag);
+    add_child(bbox, static_cast<uint32>(index));
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::add_leaf_child(const AABBType& bbox, const size_t index)
+{
+    assert(index < LeafFlag);
+    add_child(bbox, static_cast<uint32>(index) | LeafFlag);
+}
+
+template <typename AABB, size_t W>
+inline bool WideNode<AABB, W>::is_leaf_child(const size_t slot) const
+{
+    assert(slot < m_child_count);
+    return is_leaf_ref(m_children[slot]);
+}
+
+template <typename AABB, size_t W>
+inline size_t WideNode<AABB, W>::get_child_index(const size_t slot) const
+{
+    assert(slot < m_child_count);
+    return get_ref_index(m_children[slot]);
+}
+
+template <typename AABB, size_t W>
+inline AABB WideNode<AABB, W>::get_child_bbox(const size_t slot) const
+{
+    assert(slot < m_child_count);
+
+    AABBType bbox;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        bbox.min[d] = m_bbox_min[d][slot];
+        bbox.max[d] = m_bbox_max[d][slot];
+    }
+
+    return bbox;
+}
+
+template <typename AABB, size_t W>
+inline uint32 WideNode<AABB, W>::get_child_ref(const size_t slot) const
+{
+    assert(slot < m_child_count);
+    return m_children[slot];
+}
+
+template <typename AABB, size_t W>
+inline bool WideNode<AABB, W>::is_leaf_ref(const uint32 ref)
+{
+    return (ref & LeafFlag) != 0;
+}
+
+template <typename AABB, size_t W>
+inline size_t WideNode<AABB, W>::get_ref_index(const uint32 ref)
+{
+    return static_cast<size_t>(ref & ~LeafFlag);
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::add_child(const AABBType& bbox, const uint32 ref)
+{
+    assert(m_child_count < Width);
+
+    const size_t slot = m_child_count++;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        m_bbox_min[d][slot] = bbox.min[d];
+        m_bbox_max[d][slot] = bbox.max[d];
+    }
+
+    m_children[slot] = ref;
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
@@ -0,0 +1,134 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
+
+// appleseed.foundation headers.
+#include "foundation/math/bvh/bvh_tree.h"
+#include "foundation/math/bvh/bvh_widenode.h"
+#include "foundation/utility/alignedallocator.h"
+#include "foundation/utility/alignedvector.h"
+
+// Standard headers.
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Wide Bounding Volume Hierarchy.
+//
+// A wide tree is a regular binary tree augmented with a collapsed hierarchy
+// of wide nodes (see foundation::bvh::WideBuilder). The binary hierarchy is
+// built with any of the existing builders; leaves of the wide hierarchy are
+// the leaf nodes of the binary hierarchy so that leaf visitors work unchanged.
+//
+
+template <typename NodeVector, size_t Width>
+class WideTree
+  : public Tree<NodeVector>
+{
+  public:
+    typedef Tree<NodeVector> BaseTreeType;
+    typedef WideTree<NodeVector, Width> TreeType;
+    typedef typename BaseTreeType::NodeType NodeType;
+    typedef typename BaseTreeType::AllocatorType AllocatorType;
+    typedef WideNode<typename NodeType::AABBType, Width> WideNodeType;
+    typedef AlignedVector<WideNodeType> WideNodeVectorType;
+
+    // Constructor.
+    explicit WideTree(const AllocatorType& allocator = AllocatorType());
+
+    // Clear the tree.
+    void clear();
+
+    // Return true if the wide hierarchy was built.
+    bool has_wide_nodes() const;
+
+    // Return the number of wide nodes.
+    size_t get_wide_node_count() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+  protected:
+    template <typename Tree>
+    friend class WideBuilder;
+
+    template <typename Tree, typename Visitor, typename Ray, size_t StackSize, size_t N>
+    friend class WideIntersector;
+
+    WideNodeVectorType m_wide_nodes;
+};
+
+
+//
+// WideTree class implementation.
+//
+
+template <typename NodeVector, size_t Width>
+WideTree<NodeVector, Width>::WideTree(const AllocatorType& allocator)
+  : BaseTreeType(allocator)
+  , m_wide_nodes(typename WideNodeVectorType::allocator_type(64))
+{
+}
+
+template <typename NodeVector, size_t Width>
+void WideTree<NodeVector, Width>::clear()
+{
+    BaseTreeType::clear();
+    m_wide_nodes.clear();
+}
+
+template <typename NodeVector, size_t Width>
+inline bool WideTree<NodeVector, Width>::has_wide_nodes() const
+{
+    return !m_wide_nodes.empty();
+}
+
+template <typename NodeVector, size_t Width>
+inline size_t WideTree<NodeVector, Width>::get_wide_node_count() const
+{
+    return m_wide_nodes.size();
+}
+
+template <typename NodeVector, size_t Width>
+size_t WideTree<NodeVector, Width>::get_memory_size() const
+{
+    return
+          BaseTreeType::get_memory_size()
+        - sizeof(BaseTreeType)
+        + sizeof(*this)
+        + m_wide_nodes.capacity() * sizeof(WideNodeType);
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
@@ -0,0 +1,584 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
+#define APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
+
+// appleseed.foundation headers.
+#include "foundation/math/ray.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace foundation
+{
+
+//
+// Woop-Benthin-Wald watertight ray-triangle intersection test.
+//
+// The ray is transformed into a space where it goes along the +Z axis; edge
+// functions are then evaluated in 2D, which guarantees that rays never slip
+// between adjacent triangles sharing an edge or a vertex.
+//
+// Reference:
+//
+//   http://jcgt.org/published/0002/01/05/paper.pdf
+//
+
+template <typename T>
+struct TriangleWTRayInfo
+{
+    // Types.
+    typedef T ValueType;
+    typedef Ray<T, 3> RayType;
+
+    // Permutation of the axes such that the dominant direction axis is kz.
+    size_t      m_kx;
+    size_t      m_ky;
+    size_t      m_kz;
+
+    // Shear and scale coefficients.
+    ValueType   m_sx;
+    ValueType   m_sy;
+    ValueType   m_sz;
+
+    // Constructors.
+    TriangleWTRayInfo();                            // leave all fields uninitialized
+    explicit TriangleWTRayInfo(const RayType& ray); // initialize with a ray
+};
+
+template <typename T>
+struct TriangleWT
+{
+    // Types.
+    typedef T ValueType;
+    typedef Vector<T, 3> VectorType;
+    typedef Ray<T, 3> RayType;
+    typedef TriangleWTRayInfo<T> RayInfoType;
+
+    // Vertices.
+    VectorType  m_v0;
+    VectorType  m_v1;
+    VectorType  m_v2;
+
+    // Constructors.
+    TriangleWT();
+    TriangleWT(
+        const VectorType&   v0,
+        const VectorType&   v1,
+        const VectorType&   v2);
+
+    // Construct a triangle from another triangle of a different type.
+    template <typename U>
+    TriangleWT(const TriangleWT<U>& rhs);
+
+    bool intersect(
+        const RayType&      ray,
+        const RayInfoType&  ray_info,
+        ValueType&          t,
+        ValueType&          u,
+        ValueType&          v) const;
+
+    bool intersect(
+        const RayType&      ray,
+        ValueType&          t,
+        ValueType&          u,
+        ValueType&          v) const;
+
+    bool intersect(
+        const RayType&      ray,
+        const RayInfoType&  ray_info) const;
+
+    bool intersect(const RayType& ray) const;
+};
+
+//
+// A packet of N single-precision triangles stored in SoA layout, intersected
+// all at once against a single ray. Specializations using SSE (N = 4) and AVX
+// (N = 8) are provided when the corresponding instruction sets are enabled.
+//
+// Unused slots must be filled with degenerate triangles (for instance all
+// vertices at the origin): they never report an intersection.
+//
+
+template <size_t N>
+struct TriangleWTPacket
+{
+    // Types.
+    typedef float ValueType;
+    typedef Vector<float, 3> VectorType;
+    typedef Ray<float, 3> RayType;
+    typedef TriangleWTRayInfo<float> RayInfoType;
+
+    // Width of the packet.
+    static const size_t Width = N;
+
+    // Vertices, one array per vertex and per dimension.
+    float m_v0[3][N];
+    float m_v1[3][N];
+    float m_v2[3][N];
+
+    // Set the i'th triangle of the packet.
+    void set(
+        const size_t        i,
+        const VectorType&   v0,
+        const VectorType&   v1,
+        const VectorType&   v2);
+
+    // Clear the i'th slot of the packet.
+    void clear(const size_t i);
+
+    // Retrieve the vertices of the i'th triangle of the packet.
+    void get(
+        const size_t        i,
+        VectorType&         v0,
+        VectorType&         v1,
+        VectorType&         v2) const;
+
+    // Intersect the ray with all triangles of the packet. Return a bit mask of
+    // the triangles that are hit; the distances and barycentric coordinates of
+    // the hits are returned in t[], u[] and v[] (other slots are undefined).
+    uint32 intersect(
+        const RayType&      ray,
+        const RayInfoType&  ray_info,
+        float               t[N],
+        float               u[N],
+        float               v[N]) const;
+};
+
+
+//
+// TriangleWTRayInfo class implementation.
+//
+
+template <typename T>
+inline TriangleWTRayInfo<T>::TriangleWTRayInfo()
+{
+}
+
+template <typename T>
+inline TriangleWTRayInfo<T>::TriangleWTRayInfo(const RayType& ray)
+{
+    m_kz = max_abs_index(ray.m_dir);
+    m_kx = m_kz == 2 ? 0 : m_kz + 1;
+    m_ky = m_kx == 2 ? 0 : m_kx + 1;
+
+    // Preserve the winding of the triangles.
+    if (ray.m_dir[m_kz] < T(0.0))
+        std::swap(m_kx, m_ky);
+
+    m_sz = T(1.0) / ray.m_dir[m_kz];
+    m_sx = ray.m_dir[m_kx] * m_sz;
+    m_sy = ray.m_dir[m_ky] * m_sz;
+}
+
+
+//
+// TriangleWT class implementation.
+//
+
+template <typename T>
+inline TriangleWT<T>::TriangleWT()
+{
+}
+
+template <typename T>
+inline TriangleWT<T>::TriangleWT(
+    const VectorType&       v0,
+    const VectorType&       v1,
+    const VectorType&       v2)
+  : m_v0(v0)
+  , m_v1(v1)
+  , m_v2(v2)
+{
+}
+
+template <typename T>
+template <typename U>
+APPLESEED_FORCE_INLINE TriangleWT<T>::TriangleWT(const TriangleWT<U>& rhs)
+  : m_v0(VectorType(rhs.m_v0))
+  , m_v1(VectorType(rhs.m_v1))
+  , m_v2(VectorType(rhs.m_v2))
+{
+}
+
+template <typename T>
+APPLESEED_FORCE_INLINE bool TriangleWT<T>::intersect(
+    const RayType&          ray,
+    const RayInfoType&      ray_info,
+    ValueType&              t,
+    ValueType&              u,
+    ValueType&              v) const
+{
+    const size_t kx = ray_info.m_kx;
+    const size_t ky = ray_info.m_ky;
+    const size_t kz = ray_info.m_kz;
+
+    // Vertices relative to the ray origin.
+    const VectorType a = m_v0 - ray.m_org;
+    const VectorType b = m_v1 - ray.m_org;
+    const VectorType c = m_v2 - ray.m_org;
+
+    // Shear the vertices.
+    const ValueType ax = a[kx] - ray_info.m_sx * a[kz];
+    const ValueType ay = a[ky] - ray_info.m_sy * a[kz];
+    const ValueType bx = b[kx] - ray_info.m_sx * b[kz];
+    const ValueType by = b[ky] - ray_info.m_sy * b[kz];
+    const ValueType cx = c[kx] - ray_info.m_sx * c[kz];
+    const ValueType cy = c[ky] - ray_info.m_sy * c[kz];
+
+    // Compute scaled barycentric coordinates.
+    const ValueType w0 = cx * by - cy * bx;
+    const ValueType w1 = ax * cy - ay * cx;
+    const ValueType w2 = bx * ay - by * ax;
+
+    // The ray misses the triangle if the edge functions have different signs.
+    if ((w0 < ValueType(0.0) || w1 < ValueType(0.0) || w2 < ValueType(0.0)) &&
+        (w0 > ValueType(0.0) || w1 > ValueType(0.0) || w2 > ValueType(0.0)))
+        return false;
+
+    // Calculate determinant; the ray is parallel to the triangle if it's zero.
+    const ValueType det = w0 + w1 + w2;
+    if (det == ValueType(0.0))
+        return false;
+
+    // Calculate the scaled hit distance and test bounds.
+    t =
+          w0 * (ray_info.m_sz * a[kz])
+        + w1 * (ray_info.m_sz * b[kz])
+        + w2 * (ray_info.m_sz * c[kz]);
+
+    if (det > ValueType(0.0))
+    {
+        if (t >= ray.m_tmax * det || t < ray.m_tmin * det)
+            return false;
+    }
+    else
+    {
+        if (t <= ray.m_tmax * det || t > ray.m_tmin * det)
+            return false;
+    }
+
+    // Scale parameters.
+    const ValueType rcp_det = ValueType(1.0) / det;
+    t *= rcp_det;
+    u = w1 * rcp_det;
+    v = w2 * rcp_det;
+
+    // Ray intersects triangle.
+    return true;
+}
+
+template <typename T>
+APPLESEED_FORCE_INLINE bool TriangleWT<T>::intersect(
+    const RayType&          ray,
+    ValueType&              t,
+    ValueType&              u,
+    ValueType&              v) const
+{
+    return intersect(ray, RayInfoType(ray), t, u, v);
+}
+
+template <typename T>
+APPLESEED_FORCE_INLINE bool TriangleWT<T>::intersect(
+    const RayType&          ray,
+    const RayInfoType&      ray_info) const
+{
+    ValueType t, u, v;
+    return intersect(ray, ray_info, t, u, v);
+}
+
+template <typename T>
+APPLESEED_FORCE_INLINE bool TriangleWT<T>::intersect(const RayType& ray) const
+{
+    ValueType t, u, v;
+    return intersect(ray, RayInfoType(ray), t, u, v);
+}
+
+
+//
+// TriangleWTPacket class implementation.
+//
+
+template <size_t N>
+inline void TriangleWTPacket<N>::set(
+    const size_t            i,
+    const VectorType&       v0,
+    const VectorType&       v1,
+    const VectorType&       v2)
+{
+    assert(i < N);
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        m_v0[d][i] = v0[d];
+        m_v1[d][i] = v1[d];
+        m_v2[d][i] = v2[d];
+    }
+}
+
+template <size_t N>
+inline void TriangleWTPacket<N>::clear(const size_t i)
+{
+    assert(i < N);
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        m_v0[d][i] = 0.0f;
+        m_v1[d][i] = 0.0f;
+        m_v2[d][i] = 0.0f;
+    }
+}
+
+template <size_t N>
+inline void TriangleWTPacket<N>::get(
+    const size_t            i,
+    VectorType&             v0,
+    VectorType&             v1,
+    VectorType&             v2) const
+{
+    assert(i < N);
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        v0[d] = m_v0[d][i];
+        v1[d] = m_v1[d][i];
+        v2[d] = m_v2[d][i];
+    }
+}
+
+template <size_t N>
+inline uint32 TriangleWTPacket<N>::intersect(
+    const RayType&          ray,
+    const RayInfoType&      ray_info,
+    float                   t[N],
+    float                   u[N],
+    float                   v[N]) const
+{
+    uint32 hits = 0;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        VectorType v0, v1, v2;
+        get(i, v0, v1, v2);
+
+        if (TriangleWT<float>(v0, v1, v2).intersect(ray, ray_info, t[i], u[i], v[i]))
+            hits |= uint32(1) << i;
+    }
+
+    return hits;
+}
+
+#ifdef APPLESEED_USE_SSE
+
+template <>
+inline uint32 TriangleWTPacket<4>::intersect(
+    const RayType&          ray,
+    const RayInfoType&      ray_info,
+    float                   t[4],
+    float                   u[4],
+    float                   v[4]) const
+{
+    const size_t kx = ray_info.m_kx;
+    const size_t ky = ray_info.m_ky;
+    const size_t kz = ray_info.m_kz;
+
+    const __m128 ox = _mm_set1_ps(ray.m_org[kx]);
+    const __m128 oy = _mm_set1_ps(ray.m_org[ky]);
+    const __m128 oz = _mm_set1_ps(ray.m_org[kz]);
+    const __m128 sx = _mm_set1_ps(ray_info.m_sx);
+    const __m128 sy = _mm_set1_ps(ray_info.m_sy);
+    const __m128 sz = _mm_set1_ps(ray_info.m_sz);
+
+    // Vertices relative to the ray origin.
+    const __m128 az = _mm_sub_ps(_mm_loadu_ps(m_v0[kz]), oz);
+    const __m128 bz = _mm_sub_ps(_mm_loadu_ps(m_v1[kz]), oz);
+    const __m128 cz = _mm_sub_ps(_mm_loadu_ps(m_v2[kz]), oz);
+
+    // Shear the vertices.
+    const __m128 ax = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v0[kx]), ox), _mm_mul_ps(sx, az));
+    const __m128 ay = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v0[ky]), oy), _mm_mul_ps(sy, az));
+    const __m128 bx = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v1[kx]), ox), _mm_mul_ps(sx, bz));
+    const __m128 by = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v1[ky]), oy), _mm_mul_ps(sy, bz));
+    const __m128 cx = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v2[kx]), ox), _mm_mul_ps(sx, cz));
+    const __m128 cy = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(m_v2[ky]), oy), _mm_mul_ps(sy, cz));
+
+    // Compute scaled barycentric coordinates.
+    const __m128 w0 = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+    const __m128 w1 = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+    const __m128 w2 = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+    // Reject triangles whose edge functions have different signs.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 any_negative =
+        _mm_or_ps(
+            _mm_or_ps(_mm_cmplt_ps(w0, zero), _mm_cmplt_ps(w1, zero)),
+            _mm_cmplt_ps(w2, zero));
+    const __m128 any_positive =
+        _mm_or_ps(
+            _mm_or_ps(_mm_cmpgt_ps(w0, zero), _mm_cmpgt_ps(w1, zero)),
+            _mm_cmpgt_ps(w2, zero));
+    __m128 mask = _mm_andnot_ps(_mm_and_ps(any_negative, any_positive), _mm_cmpeq_ps(w0, w0));
+
+    // Reject triangles parallel to the ray.
+    const __m128 det = _mm_add_ps(_mm_add_ps(w0, w1), w2);
+    mask = _mm_and_ps(mask, _mm_cmpneq_ps(det, zero));
+
+    // Calculate the scaled hit distance with the sign of the determinant removed.
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 det_sign = _mm_and_ps(det, sign_mask);
+    const __m128 abs_det = _mm_xor_ps(det, det_sign);
+    const __m128 scaled_t =
+        _mm_xor_ps(
+            _mm_mul_ps(
+                sz,
+                _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(w0, az), _mm_mul_ps(w1, bz)),
+                    _mm_mul_ps(w2, cz))),
+            det_sign);
+
+    // Test bounds.
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(scaled_t, _mm_mul_ps(_mm_set1_ps(ray.m_tmin), abs_det)));
+    mask = _mm_and_ps(mask, _mm_cmplt_ps(scaled_t, _mm_mul_ps(_mm_set1_ps(ray.m_tmax), abs_det)));
+
+    const int hits = _mm_movemask_ps(mask);
+
+    if (hits != 0)
+    {
+        // Scale parameters.
+        const __m128 rcp_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        _mm_storeu_ps(t, _mm_div_ps(scaled_t, abs_det));
+        _mm_storeu_ps(u, _mm_mul_ps(w1, rcp_det));
+        _mm_storeu_ps(v, _mm_mul_ps(w2, rcp_det));
+    }
+
+    return static_cast<uint32>(hits);
+}
+
+#ifdef APPLESEED_USE_AVX
+
+template <>
+inline uint32 TriangleWTPacket<8>::intersect(
+    const RayType&          ray,
+    const RayInfoType&      ray_info,
+    float                   t[8],
+    float                   u[8],
+    float                   v[8]) const
+{
+    const size_t kx = ray_info.m_kx;
+    const size_t ky = ray_info.m_ky;
+    const size_t kz = ray_info.m_kz;
+
+    const __m256 ox = _mm256_set1_ps(ray.m_org[kx]);
+    const __m256 oy = _mm256_set1_ps(ray.m_org[ky]);
+    const __m256 oz = _mm256_set1_ps(ray.m_org[kz]);
+    const __m256 sx = _mm256_set1_ps(ray_info.m_sx);
+    const __m256 sy = _mm256_set1_ps(ray_info.m_sy);
+    const __m256 sz = _mm256_set1_ps(ray_info.m_sz);
+
+    // Vertices relative to the ray origin.
+    const __m256 az = _mm256_sub_ps(_mm256_loadu_ps(m_v0[kz]), oz);
+    const __m256 bz = _mm256_sub_ps(_mm256_loadu_ps(m_v1[kz]), oz);
+    const __m256 cz = _mm256_sub_ps(_mm256_loadu_ps(m_v2[kz]), oz);
+
+    // Shear the vertices.
+    const __m256 ax = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v0[kx]), ox), _mm256_mul_ps(sx, az));
+    const __m256 ay = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v0[ky]), oy), _mm256_mul_ps(sy, az));
+    const __m256 bx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v1[kx]), ox), _mm256_mul_ps(sx, bz));
+    const __m256 by = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v1[ky]), oy), _mm256_mul_ps(sy, bz));
+    const __m256 cx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v2[kx]), ox), _mm256_mul_ps(sx, cz));
+    const __m256 cy = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(m_v2[ky]), oy), _mm256_mul_ps(sy, cz));
+
+    // Compute scaled barycentric coordinates.
+    const __m256 w0 = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+    const __m256 w1 = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+    const __m256 w2 = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+
+    // Reject triangles whose edge functions have different signs.
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 any_negative =
+        _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(w0, zero, _CMP_LT_OQ), _mm256_cmp_ps(w1, zero, _CMP_LT_OQ)),
+            _mm256_cmp_ps(w2, zero, _CMP_LT_OQ));
+    const __m256 any_positive =
+        _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(w0, zero, _CMP_GT_OQ), _mm256_cmp_ps(w1, zero, _CMP_GT_OQ)),
+            _mm256_cmp_ps(w2, zero, _CMP_GT_OQ));
+    __m256 mask = _mm256_andnot_ps(_mm256_and_ps(any_negative, any_positive), _mm256_cmp_ps(w0, w0, _CMP_EQ_OQ));
+
+    // Reject triangles parallel to the ray.
+    const __m256 det = _mm256_add_ps(_mm256_add_ps(w0, w1), w2);
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+
+    // Calculate the scaled hit distance with the sign of the determinant removed.
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 det_sign = _mm256_and_ps(det, sign_mask);
+    const __m256 abs_det = _mm256_xor_ps(det, det_sign);
+    const __m256 scaled_t =
+        _mm256_xor_ps(
+            _mm256_mul_ps(
+                sz,
+                _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(w0, az), _mm256_mul_ps(w1, bz)),
+                    _mm256_mul_ps(w2, cz))),
+            det_sign);
+
+    // Test bounds.
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(scaled_t, _mm256_mul_ps(_mm256_set1_ps(ray.m_tmin), abs_det), _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(scaled_t, _mm256_mul_ps(_mm256_set1_ps(ray.m_tmax), abs_det), _CMP_LT_OQ));
+
+    const int hits = _mm256_movemask_ps(mask);
+
+    if (hits != 0)
+    {
+        // Scale parameters.
+        const __m256 rcp_det = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+        _mm256_storeu_ps(t, _mm256_div_ps(scaled_t, abs_det));
+        _mm256_storeu_ps(u, _mm256_mul_ps(w1, rcp_det));
+        _mm256_storeu_ps(v, _mm256_mul_ps(w2, rcp_det));
+    }
+
+    return static_cast<uint32>(hits);
+}
+
+#endif  // APPLESEED_USE_AVX
+
+#endif  // APPLESEED_USE_SSE
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
@@ -79,14 +79,16 @@ class Builder
     double get_build_time() const;
 
   private:
+    template <typename, size_t> friend class ParallelBuilder;
+
     typedef typename TreeType::NodeType NodeType;
     typedef AABB<T, N> BboxType;
     typedef Split<T> SplitType;
+    typedef std::vector<VectorType> PointVector;
+    typedef std::vector<NodeType> NodeVector;
 
     struct PartitionPredicate
     {
-        typedef std::vector<VectorType> PointVector;
-
         const PointVector&          m_points;
         const SplitType             m_split;
 
@@ -101,14 +103,20 @@ class Builder
     TreeType&   m_tree;
     double      m_build_time;
 
-    void partition(
+    // Recursively build the subtree of a given node for the points [begin, end).
+    static void partition(
+        NodeVector&                 nodes,
+        const PointVector&          points,
+        size_t                      indices[],
         const size_t                parent_node_index,
         const size_t                begin,
-        const size_t                end) const;
+        const size_t                end);
 
-    BboxType compute_bbox(
+    static BboxType compute_bbox(
+        const PointVector&          points,
+        const size_t                indices[],
         const size_t                begin,
-        const size_t                end) const;
+        const size_t                end);
 };
 
 typedef Builder<float, 2>  Builder2f;
@@ -168,7 +176,13 @@ void Builder<T, N>::build_move_points(
     m_tree.m_nodes.reserve(count * 2 + 1);
     m_tree.m_nodes.push_back(NodeType());
 
-    partition(0, 0, count);
+    partition(
+        m_tree.m_nodes,
+        m_tree.m_points,
+        count > 0 ? &m_tree.m_indices[0] : 0,
+        0,
+        0,
+        count);
 
     if (count > 0)
     {
@@ -209,31 +223,34 @@ inline bool Builder<T, N>::PartitionPredicate::operator()(
 
 template <typename T, size_t N>
 void Builder<T, N>::partition(
+    NodeVector&                 nodes,
+    const PointVector&          points,
+    size_t                      indices[],
     const size_t                parent_node_index,
     const size_t                begin,
-    const size_t                end) const
+    const size_t                end)
 {
     const size_t count = end - begin;
 
     if (count <= 1)
     {
-        NodeType& parent_node = m_tree.m_nodes[parent_node_index];
+        NodeType& parent_node = nodes[parent_node_index];
         parent_node.make_leaf();
         parent_node.set_point_index(begin);
         parent_node.set_point_count(count);
     }
     else
     {
-        const BboxType bbox = compute_bbox(begin, end);
+        const BboxType bbox = compute_bbox(points, indices, begin, end);
         SplitType split = SplitType::middle(bbox);
 
         const size_t* bound =
             std::partition(
-                &m_tree.m_indices[0] + begin,
-                &m_tree.m_indices[0] + end,
-                PartitionPredicate(m_tree.m_points, split));
+                indices + begin,
+                indices + end,
+                PartitionPredicate(points, split));
 
-        size_t pivot = bound - &m_tree.m_indices[0];
+        size_t pivot = bound - indices;
         assert(pivot >= begin);
         assert(pivot <= end);
 
@@ -244,13 +261,13 @@ void Builder<T, N>::partition(
         if (pivot == begin || pivot == end)
             pivot = (begin + end) / 2;
 
-        const size_t left_node_index = m_tree.m_nodes.size();
+        const size_t left_node_index = nodes.size();
         const size_t right_node_index = left_node_index + 1;
 
-        m_tree.m_nodes.push_back(NodeType());
-        m_tree.m_nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
 
-        NodeType& parent_node = m_tree.m_nodes[parent_node_index];
+        NodeType& parent_node = nodes[parent_node_index];
         parent_node.make_interior();
         parent_node.set_split_dim(split.m_dimension);
         parent_node.set_split_abs(split.m_abscissa);
@@ -258,24 +275,23 @@ void Builder<T, N>::partition(
         parent_node.set_point_index(begin);
         parent_node.set_point_count(count);
 
-        partition(left_node_index, begin, pivot);
-        partition(right_node_index, pivot, end);
+        partition(nodes, points, indices, left_node_index, begin, pivot);
+        partition(nodes, points, indices, right_node_index, pivot, end);
     }
 }
 
 template <typename T, size_t N>
 inline typename Builder<T, N>::BboxType Builder<T, N>::compute_bbox(
+    const PointVector&          points,
+    const size_t                indices[],
     const size_t                begin,
-    const size_t                end) const
+    const size_t                end)
 {
     BboxType bbox;
     bbox.invalidate();
 
     for (size_t i = begin; i < end; ++i)
-    {
-        const size_t index = m_tree.m_indices[i];
-        bbox.insert(m_tree.m_points[index]);
-    }
+        bbox.insert(points[indices[i]]);
 
     return bbox;
 }
@@ -0,0 +1,563 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_FOUNDATION_MATH_KNN_KNN_PARALLELBUILDER_H
+#define APPLESEED_FOUNDATION_MATH_KNN_KNN_PARALLELBUILDER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/knn/knn_builder.h"
+#include "foundation/math/knn/knn_node.h"
+#include "foundation/math/knn/knn_tree.h"
+#include "foundation/math/split.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/otherwise.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace foundation {
+namespace knn {
+
+//
+// Multithreaded variant of foundation::knn::Builder.
+//
+// The top of the tree is built on the calling thread, but the bounding box computation
+// and the partitioning of the points of each top node are split into chunks processed
+// in parallel. Once there are enough nodes to keep all threads busy, each one is turned
+// into a subtree by a separate job and the subtrees are stitched back together. Split
+// decisions only depend on the points of a node, so the resulting tree is the same as
+// the one of the sequential builder up to the order of the nodes and of the points
+// within the leaves.
+//
+// The jobs are executed by the worker threads serving the job queue passed to the
+// constructor; they must be running during construction.
+//
+
+template <typename T, size_t N>
+class ParallelBuilder
+  : public NonCopyable
+{
+  public:
+    typedef T ValueType;
+    static const size_t Dimension = N;
+
+    typedef Vector<T, N> VectorType;
+    typedef Tree<T, N> TreeType;
+
+    // Number of subtrees built in parallel.
+    static const size_t MaxSubtreeCount = 64;
+
+    // Nodes with less points than this are never split on the calling thread.
+    static const size_t MinSubtreeSize = 16 * 1024;
+
+    // Minimum number of points processed by a single job of a parallel pass.
+    static const size_t MinChunkSize = 16 * 1024;
+
+    // Constructor.
+    ParallelBuilder(
+        TreeType&                   tree,
+        JobQueue&                   job_queue);
+
+    // Build a tree for a given set of points.
+    template <typename Timer>
+    void build(
+        const VectorType            points[],
+        const size_t                count);
+
+    // Like build() but the points will be moved into the tree rather than copied.
+    template <typename Timer>
+    void build_move_points(
+        std::vector<VectorType>&    points);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+    // Return the number of subtrees built in parallel during the last construction.
+    size_t get_subtree_count() const;
+
+  private:
+    typedef Builder<T, N> BuilderType;
+    typedef typename TreeType::NodeType NodeType;
+    typedef typename BuilderType::BboxType BboxType;
+    typedef typename BuilderType::SplitType SplitType;
+    typedef typename BuilderType::NodeVector NodeVector;
+
+    enum Pass
+    {
+        ComputeBboxPass,                    // compute the bounding box of the points of a chunk
+        CountPass,                          // count the points of a chunk on the left of the split
+        ScatterPass,                        // partition the points of a chunk into m_temp_indices
+        CopyPass,                           // copy a chunk of m_temp_indices back into the tree
+        ReorderPass                         // copy a chunk of points into m_temp_points, in tree order
+    };
+
+    struct PendingNode
+    {
+        size_t                      m_node_index;
+        size_t                      m_begin;
+        size_t                      m_end;
+
+        size_t size() const { return m_end - m_begin; }
+    };
+
+    class ChunkJob;
+    class SubtreeJob;
+
+    TreeType&                       m_tree;
+    JobQueue&                       m_job_queue;
+    double                          m_build_time;
+    size_t                          m_subtree_count;
+
+    // State of the current parallel pass.
+    size_t                          m_begin;
+    size_t                          m_end;
+    size_t                          m_chunk_count;
+    SplitType                       m_split;
+    std::vector<BboxType>           m_chunk_bboxes;
+    std::vector<size_t>             m_chunk_left_counts;
+    std::vector<size_t>             m_chunk_left_offsets;
+    std::vector<size_t>             m_chunk_right_offsets;
+    std::vector<size_t>             m_temp_indices;
+    std::vector<VectorType>         m_temp_points;
+
+    // Run a pass over the items [begin, end) in parallel.
+    void run_parallel_pass(
+        const Pass                  pass,
+        const size_t                begin,
+        const size_t                end);
+
+    // Process one chunk of the current pass.
+    void run_chunk(
+        const Pass                  pass,
+        const size_t                chunk_index);
+
+    // Partition the points of a node in parallel. Return the pivot.
+    size_t parallel_partition(
+        const size_t                begin,
+        const size_t                end);
+
+    void get_chunk_bounds(
+        const size_t                chunk_index,
+        size_t&                     chunk_begin,
+        size_t&                     chunk_end) const;
+};
+
+typedef ParallelBuilder<float, 2>  ParallelBuilder2f;
+typedef ParallelBuilder<double, 2> ParallelBuilder2d;
+typedef ParallelBuilder<float, 3>  ParallelBuilder3f;
+typedef ParallelBuilder<double, 3> ParallelBuilder3d;
+
+
+//
+// Implementation.
+//
+
+template <typename T, size_t N>
+class ParallelBuilder<T, N>::ChunkJob
+  : public IJob
+{
+  public:
+    ChunkJob(
+        ParallelBuilder&            builder,
+        const Pass                  pass,
+        const size_t                chunk_index)
+      : m_builder(builder)
+      , m_pass(pass)
+      , m_chunk_index(chunk_index)
+    {
+    }
+
+    virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+    {
+        m_builder.run_chunk(m_pass, m_chunk_index);
+    }
+
+  private:
+    ParallelBuilder&                m_builder;
+    const Pass                      m_pass;
+    const size_t                    m_chunk_index;
+};
+
+template <typename T, size_t N>
+class ParallelBuilder<T, N>::SubtreeJob
+  : public IJob
+{
+  public:
+    SubtreeJob(
+        TreeType&                   tree,
+        const PendingNode&          pending_node,
+        NodeVector&                 subtree_nodes)
+      : m_tree(tree)
+      , m_pending_node(pending_node)
+      , m_subtree_nodes(subtree_nodes)
+    {
+    }
+
+    virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+    {
+        // Subtrees partition disjoint ranges of the tree's index array.
+        m_subtree_nodes.reserve(m_pending_node.size() * 2 + 1);
+        m_subtree_nodes.push_back(NodeType());
+
+        BuilderType::partition(
+            m_subtree_nodes,
+            m_tree.m_points,
+            m_tree.m_indices.empty() ? 0 : &m_tree.m_indices[0],
+            0,
+            m_pending_node.m_begin,
+            m_pending_node.m_end);
+    }
+
+  private:
+    TreeType&                       m_tree;
+    const PendingNode               m_pending_node;
+    NodeVector&                     m_subtree_nodes;
+};
+
+template <typename T, size_t N>
+inline ParallelBuilder<T, N>::ParallelBuilder(
+    TreeType&                       tree,
+    JobQueue&                       job_queue)
+  : m_tree(tree)
+  , m_job_queue(job_queue)
+  , m_build_time(0.0)
+  , m_subtree_count(0)
+{
+}
+
+template <typename T, size_t N>
+template <typename Timer>
+void ParallelBuilder<T, N>::build(
+    const VectorType                points[],
+    const size_t                    count)
+{
+    std::vector<VectorType> vec(count);
+
+    if (count > 0)
+    {
+        assert(points);
+        std::memcpy(&vec[0], points, count * sizeof(VectorType));
+    }
+
+    build_move_points<Timer>(vec);
+}
+
+template <typename T, size_t N>
+template <typename Timer>
+void ParallelBuilder<T, N>::build_move_points(
+    std::vector<VectorType>&        points)
+{
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    const size_t count = points.size();
+
+    m_tree.m_points.swap(points);
+    m_tree.m_indices.resize(count);
+    m_tree.m_nodes.clear();
+
+    for (size_t i = 0; i < count; ++i)
+        m_tree.m_indices[i] = i;
+
+    m_tree.m_nodes.reserve(count * 2 + 1);
+    m_tree.m_nodes.push_back(NodeType());
+
+    // Split the largest nodes on the calling thread until there are enough of them.
+    std::vector<PendingNode> pending_nodes;
+    const PendingNode root_pending_node = { 0, 0, count };
+    pending_nodes.push_back(root_pending_node);
+    m_temp_indices.resize(count);
+    while (pending_nodes.size() < MaxSubtreeCount)
+    {
+        size_t largest = 0;
+        for (size_t i = 1; i < pending_nodes.size(); ++i)
+        {
+            if (pending_nodes[largest].size() < pending_nodes[i].size())
+                largest = i;
+        }
+
+        const PendingNode pending_node = pending_nodes[largest];
+        if (pending_node.size() < MinSubtreeSize)
+            break;
+
+        const size_t pivot = parallel_partition(pending_node.m_begin, pending_node.m_end);
+
+        const size_t left_node_index = m_tree.m_nodes.size();
+        const size_t right_node_index = left_node_index + 1;
+
+        m_tree.m_nodes.push_back(NodeType());
+        m_tree.m_nodes.push_back(NodeType());
+
+        NodeType& node = m_tree.m_nodes[pending_node.m_node_index];
+        node.make_interior();
+        node.set_split_dim(m_split.m_dimension);
+        node.set_split_abs(m_split.m_abscissa);
+        node.set_child_node_index(left_node_index);
+        node.set_point_index(pending_node.m_begin);
+        node.set_point_count(pending_node.size());
+
+        const PendingNode left_pending_node = { left_node_index, pending_node.m_begin, pivot };
+        const PendingNode right_pending_node = { right_node_index, pivot, pending_node.m_end };
+        pending_nodes[largest] = left_pending_node;
+        pending_nodes.push_back(right_pending_node);
+    }
+    std::vector<size_t>().swap(m_temp_indices);
+
+    // Build the subtrees in parallel, largest first.
+    m_subtree_count = pending_nodes.size();
+    std::vector<NodeVector> subtrees(m_subtree_count);
+    std::vector<std::pair<size_t, size_t> > schedule(m_subtree_count);
+    for (size_t i = 0; i < m_subtree_count; ++i)
+        schedule[i] = std::make_pair(pending_nodes[i].size(), i);
+    std::sort(schedule.rbegin(), schedule.rend());
+    for (size_t i = 0; i < m_subtree_count; ++i)
+    {
+        const size_t subtree_index = schedule[i].second;
+        m_job_queue.schedule(
+            new SubtreeJob(
+                m_tree,
+                pending_nodes[subtree_index],
+                subtrees[subtree_index]));
+    }
+    m_job_queue.wait_until_completion();
+
+    // Stitch the subtrees into the tree.
+    for (size_t i = 0; i < m_subtree_count; ++i)
+    {
+        NodeVector& subtree = subtrees[i];
+
+        // Node k > 0 of the subtree goes to index node_base + k, the root replaces the pending node.
+        const size_t node_base = m_tree.m_nodes.size() - 1;
+
+        for (size_t k = 0; k < subtree.size(); ++k)
+        {
+            NodeType node = subtree[k];
+
+            if (node.is_interior())
+                node.set_child_node_index(node_base + node.get_child_node_index());
+
+            if (k == 0)
+                m_tree.m_nodes[pending_nodes[i].m_node_index] = node;
+            else m_tree.m_nodes.push_back(node);
+        }
+
+        // Release memory early.
+        NodeVector().swap(subtree);
+    }
+
+    // Store the points in tree order.
+    if (count > 0)
+    {
+        m_temp_points.resize(count);
+        run_parallel_pass(ReorderPass, 0, count);
+        m_tree.m_points.swap(m_temp_points);
+        std::vector<VectorType>().swap(m_temp_points);
+    }
+
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename T, size_t N>
+inline double ParallelBuilder<T, N>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename T, size_t N>
+inline size_t ParallelBuilder<T, N>::get_subtree_count() const
+{
+    return m_subtree_count;
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::run_parallel_pass(
+    const Pass                      pass,
+    const size_t                    begin,
+    const size_t                    end)
+{
+    m_begin = begin;
+    m_end = end;
+    m_chunk_count = std::max<size_t>((end - begin) / MinChunkSize, 1);
+
+    for (size_t i = 0; i < m_chunk_count; ++i)
+        m_job_queue.schedule(new ChunkJob(*this, pass, i));
+
+    m_job_queue.wait_until_completion();
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::run_chunk(
+    const Pass                      pass,
+    const size_t                    chunk_index)
+{
+    size_t chunk_begin, chunk_end;
+    get_chunk_bounds(chunk_index, chunk_begin, chunk_end);
+
+    const std::vector<VectorType>& points = m_tree.m_points;
+    const size_t* APPLESEED_RESTRICT indices = &m_tree.m_indices[0];
+
+    switch (pass)
+    {
+      case ComputeBboxPass:
+        m_chunk_bboxes[chunk_index] =
+            BuilderType::compute_bbox(points, indices, chunk_begin, chunk_end);
+        break;
+
+      case CountPass:
+        {
+            const typename BuilderType::PartitionPredicate pred(points, m_split);
+            size_t left_count = 0;
+
+            for (size_t i = chunk_begin; i < chunk_end; ++i)
+            {
+                if (pred(indices[i]))
+                    ++left_count;
+            }
+
+            m_chunk_left_counts[chunk_index] = left_count;
+        }
+        break;
+
+      case ScatterPass:
+        {
+            const typename BuilderType::PartitionPredicate pred(points, m_split);
+            size_t left = m_chunk_left_offsets[chunk_index];
+            size_t right = m_chunk_right_offsets[chunk_index];
+
+            for (size_t i = chunk_begin; i < chunk_end; ++i)
+            {
+                const size_t index = indices[i];
+
+                if (pred(index))
+                    m_temp_indices[left++] = index;
+                else m_temp_indices[right++] = index;
+            }
+        }
+        break;
+
+      case CopyPass:
+        std::copy(
+            m_temp_indices.begin() + chunk_begin,
+            m_temp_indices.begin() + chunk_end,
+            m_tree.m_indices.begin() + chunk_begin);
+        break;
+
+      case ReorderPass:
+        for (size_t i = chunk_begin; i < chunk_end; ++i)
+            m_temp_points[i] = points[indices[i]];
+        break;
+
+      assert_otherwise;
+    }
+}
+
+template <typename T, size_t N>
+size_t ParallelBuilder<T, N>::parallel_partition(
+    const size_t                    begin,
+    const size_t                    end)
+{
+    const size_t max_chunk_count = std::max<size_t>((end - begin) / MinChunkSize, 1);
+
+    // Compute the bounding box of the points and choose a split.
+    m_chunk_bboxes.resize(max_chunk_count);
+    run_parallel_pass(ComputeBboxPass, begin, end);
+
+    BboxType bbox;
+    bbox.invalidate();
+    for (size_t i = 0; i < m_chunk_count; ++i)
+        bbox.insert(m_chunk_bboxes[i]);
+
+    m_split = SplitType::middle(bbox);
+
+    // Count the points on each side of the split in each chunk.
+    m_chunk_left_counts.resize(max_chunk_count);
+    run_parallel_pass(CountPass, begin, end);
+
+    // Compute where each chunk must write its points.
+    size_t total_left_count = 0;
+    for (size_t i = 0; i < m_chunk_count; ++i)
+        total_left_count += m_chunk_left_counts[i];
+
+    m_chunk_left_offsets.resize(max_chunk_count);
+    m_chunk_right_offsets.resize(max_chunk_count);
+
+    size_t left_offset = begin;
+    size_t right_offset = begin + total_left_count;
+    for (size_t i = 0; i < m_chunk_count; ++i)
+    {
+        size_t chunk_begin, chunk_end;
+        get_chunk_bounds(i, chunk_begin, chunk_end);
+
+        m_chunk_left_offsets[i] = left_offset;
+        m_chunk_right_offsets[i] = right_offset;
+
+        left_offset += m_chunk_left_counts[i];
+        right_offset += (chunk_end - chunk_begin) - m_chunk_left_counts[i];
+    }
+
+    // Partition the points.
+    run_parallel_pass(ScatterPass, begin, end);
+    run_parallel_pass(CopyPass, begin, end);
+
+    // Handle coincident points like the sequential builder.
+    size_t pivot = begin + total_left_count;
+    if (pivot == begin || pivot == end)
+        pivot = (begin + end) / 2;
+
+    return pivot;
+}
+
+template <typename T, size_t N>
+inline void ParallelBuilder<T, N>::get_chunk_bounds(
+    const size_t                    chunk_index,
+    size_t&                         chunk_begin,
+    size_t&                         chunk_end) const
+{
+    const size_t count = m_end - m_begin;
+
+    chunk_begin = m_begin + (chunk_index * count) / m_chunk_count;
+    chunk_end = m_begin + ((chunk_index + 1) * count) / m_chunk_count;
+}
+
+}       // namespace knn
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_KNN_KNN_PARALLELBUILDER_H
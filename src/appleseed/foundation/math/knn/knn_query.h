@@ -32,6 +32,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
 #include "foundation/math/distance.h"
 #include "foundation/math/fp.h"
 #include "foundation/math/knn/knn_answer.h"
@@ -40,11 +41,15 @@
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <limits>
+#include <utility>
+#include <vector>
 
 // Enable or disable k-nn query statistics.
 #undef FOUNDATION_KNN_ENABLE_QUERY_STATS
@@ -92,8 +97,35 @@ class Query
         const ValueType     query_max_square_distance) const;
 #endif
 
+    // Run a batch of queries. Queries are run in the Morton order of the query points
+    // such that consecutive queries touch the same parts of the tree. After each query,
+    // visitor(query_index, answer) is invoked, where query_index is the index of the
+    // query point in query_points.
+    template <typename Visitor>
+    void run_batch(
+        const VectorType    query_points[],
+        const size_t        query_count,
+        Visitor&            visitor) const;
+
+    template <typename Visitor>
+    void run_batch(
+        const VectorType    query_points[],
+        const size_t        query_count,
+        const ValueType     query_max_square_distance,
+        Visitor&            visitor) const;
+
   private:
     typedef typename TreeType::NodeType NodeType;
+    typedef std::vector<std::pair<uint64, size_t> > MortonOrder;
+
+    // Number of bits per dimension of Morton codes.
+    static const size_t MortonBits = 63 / N;
+
+    // Sort query points in Morton order.
+    static void compute_morton_order(
+        const VectorType    query_points[],
+        const size_t        query_count,
+        MortonOrder&        order);
 
     struct NodeEntry
     {
@@ -489,6 +521,88 @@ inline void Query<T, N>::run(
 
 #endif
 
+template <typename T, size_t N>
+template <typename Visitor>
+inline void Query<T, N>::run_batch(
+    const VectorType        query_points[],
+    const size_t            query_count,
+    Visitor&                visitor) const
+{
+    run_batch(
+        query_points,
+        query_count,
+        std::numeric_limits<ValueType>::max(),
+        visitor);
+}
+
+template <typename T, size_t N>
+template <typename Visitor>
+void Query<T, N>::run_batch(
+    const VectorType        query_points[],
+    const size_t            query_count,
+    const ValueType         query_max_square_distance,
+    Visitor&                visitor) const
+{
+    MortonOrder order;
+    compute_morton_order(query_points, query_count, order);
+
+    for (size_t i = 0; i < query_count; ++i)
+    {
+        const size_t query_index = order[i].second;
+
+        run(query_points[query_index], query_max_square_distance);
+
+        visitor(query_index, m_answer);
+    }
+}
+
+template <typename T, size_t N>
+void Query<T, N>::compute_morton_order(
+    const VectorType        query_points[],
+    const size_t            query_count,
+    MortonOrder&            order)
+{
+    order.resize(query_count);
+
+    if (query_count == 0)
+        return;
+
+    // Compute the bounding box of the query points.
+    AABB<T, N> bbox;
+    bbox.invalidate();
+    for (size_t i = 0; i < query_count; ++i)
+        bbox.insert(query_points[i]);
+
+    // Compute the scaling factors from the bounding box to the integer grid.
+    const ValueType max_coord = static_cast<ValueType>((uint64(1) << MortonBits) - 1);
+    const VectorType extent = bbox.extent();
+    VectorType scale;
+    for (size_t d = 0; d < N; ++d)
+        scale[d] = extent[d] > ValueType(0.0) ? max_coord / extent[d] : ValueType(0.0);
+
+    // Compute the Morton code of each query point.
+    for (size_t i = 0; i < query_count; ++i)
+    {
+        uint64 coords[N];
+        for (size_t d = 0; d < N; ++d)
+        {
+            const ValueType x = (query_points[i][d] - bbox.min[d]) * scale[d];
+            coords[d] = static_cast<uint64>(std::min(std::max(x, ValueType(0.0)), max_coord));
+        }
+
+        uint64 code = 0;
+        for (size_t b = 0; b < MortonBits; ++b)
+        {
+            for (size_t d = 0; d < N; ++d)
+                code |= ((coords[d] >> b) & 1) << (b * N + d);
+        }
+
+        order[i] = std::make_pair(code, i);
+    }
+
+    std::sort(order.begin(), order.end());
+}
+
 }       // namespace knn
 }       // namespace foundation
 
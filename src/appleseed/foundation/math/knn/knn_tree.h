@@ -73,6 +73,7 @@ class Tree
 
   private:
     template <typename, size_t> friend class Builder;
+    template <typename, size_t> friend class ParallelBuilder;
     template <typename, size_t> friend class Query;
     template <typename> friend class TreeStatistics;
 
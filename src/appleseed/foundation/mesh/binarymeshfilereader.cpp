@@ -35,23 +35,34 @@
 #include "foundation/core/exceptions/exceptionioerror.h"
 #include "foundation/math/vector.h"
 #include "foundation/mesh/imeshbuilder.h"
+#include "foundation/platform/memorymappedfile.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/bufferedfile.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/log/logger.h"
 #include "foundation/utility/memory.h"
 
+// lz4 headers.
+#include "lz4.h"
+
 // Standard headers.
+#include <algorithm>
+#include <cassert>
 #include <cstring>
+#include <deque>
+#include <list>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
 namespace foundation
 {
 
-//
-// BinaryMeshFileReader class implementation.
-//
-
 namespace
 {
     struct ExceptionEOF : public Exception {};
@@ -76,35 +87,529 @@ namespace
     {
         checked_read(file, &object, sizeof(T));
     }
+
+    // Sequential reads from a range of memory.
+    class MemoryReaderAdapter
+      : public ReaderAdapter
+    {
+      public:
+        MemoryReaderAdapter(const char* begin, const char* end)
+          : m_cursor(begin)
+          , m_end(end)
+        {
+        }
+
+        using ReaderAdapter::read;
+
+        virtual size_t read(
+            void*           outbuf,
+            const size_t    size) APPLESEED_OVERRIDE
+        {
+            const size_t bytes_read = min(size, static_cast<size_t>(m_end - m_cursor));
+            memcpy(outbuf, m_cursor, bytes_read);
+            m_cursor += bytes_read;
+            return bytes_read;
+        }
+
+        const char* get_position() const
+        {
+            return m_cursor;
+        }
+
+        void skip(const size_t size)
+        {
+            m_cursor += min(size, static_cast<size_t>(m_end - m_cursor));
+        }
+
+      private:
+        const char*         m_cursor;
+        const char*         m_end;
+    };
+
+    // An LZ4-compressed block, as written by foundation::LZ4CompressedWriterAdapter.
+    struct LZ4Block
+    {
+        const char*         m_compressed_data;
+        size_t              m_compressed_size;
+        char*               m_data;
+        size_t              m_size;
+        bool                m_success;
+    };
+
+    class DecompressLZ4BlockJob
+      : public IJob
+    {
+      public:
+        explicit DecompressLZ4BlockJob(LZ4Block& block)
+          : m_block(block)
+        {
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            const int size =
+                LZ4_decompress_safe(
+                    m_block.m_compressed_data,
+                    m_block.m_data,
+                    static_cast<int>(m_block.m_compressed_size),
+                    static_cast<int>(m_block.m_size));
+
+            m_block.m_success = size == static_cast<int>(m_block.m_size);
+        }
+
+      private:
+        LZ4Block&           m_block;
+    };
+
+    // Decompress a set of independent LZ4 blocks, in parallel.
+    void decompress_lz4_blocks(
+        vector<LZ4Block>&   blocks,
+        const size_t        thread_count)
+    {
+        if (thread_count > 1 && blocks.size() > 1)
+        {
+            Logger logger;
+            JobQueue job_queue;
+            JobManager job_manager(
+                logger,
+                job_queue,
+                min(thread_count, blocks.size()));
+
+            for (size_t i = 0; i < blocks.size(); ++i)
+                job_queue.schedule(new DecompressLZ4BlockJob(blocks[i]));
+
+            job_manager.start();
+            job_queue.wait_until_completion();
+        }
+        else
+        {
+            for (size_t i = 0; i < blocks.size(); ++i)
+                DecompressLZ4BlockJob(blocks[i]).execute(0);
+        }
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (!blocks[i].m_success)
+                throw ExceptionIOError("corrupted binarymesh file");
+        }
+    }
+
+    // Decompress all the blocks of an LZ4-compressed stream, in parallel.
+    void decompress_lz4_stream(
+        const char*         begin,
+        const char*         end,
+        const size_t        thread_count,
+        vector<char>&       output)
+    {
+        // Locate the blocks and compute their position in the decompressed stream.
+        vector<LZ4Block> blocks;
+        MemoryReaderAdapter reader(begin, end);
+        size_t output_size = 0;
+
+        while (true)
+        {
+            uint64 size;
+            if (reader.read(size) == 0)
+                break;
+
+            uint64 compressed_size;
+            checked_read(reader, compressed_size);
+
+            if (compressed_size > static_cast<uint64>(end - reader.get_position()))
+                throw ExceptionIOError();
+
+            LZ4Block block;
+            block.m_compressed_data = reader.get_position();
+            block.m_compressed_size = static_cast<size_t>(compressed_size);
+            block.m_data = 0;
+            block.m_size = static_cast<size_t>(size);
+            block.m_success = false;
+            blocks.push_back(block);
+
+            output_size += block.m_size;
+
+            reader.skip(block.m_compressed_size);
+        }
+
+        output.resize(output_size);
+
+        size_t offset = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            blocks[i].m_data = output.empty() ? 0 : &output[offset];
+            offset += blocks[i].m_size;
+        }
+
+        decompress_lz4_blocks(blocks, thread_count);
+    }
+
+    void read_and_check_signature(ReaderAdapter& reader)
+    {
+        static const char ExpectedSig[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
+
+        char signature[sizeof(ExpectedSig)];
+        checked_read(reader, signature, sizeof(signature));
+
+        if (memcmp(signature, ExpectedSig, sizeof(ExpectedSig)))
+            throw ExceptionIOError("invalid binarymesh format signature");
+    }
+
+    string read_string(ReaderAdapter& reader)
+    {
+        uint16 length;
+        checked_read(reader, length);
+
+        string s;
+        s.resize(length);
+        checked_read(reader, &s[0], length);
+
+        return s;
+    }
+
+    void check_block_size(const uint64 size, const uint64 expected_size)
+    {
+        if (size != expected_size)
+            throw ExceptionIOError("corrupted binarymesh file");
+    }
+}
+
+
+//
+// MappedBinaryMeshFile class implementation.
+//
+
+struct MappedBinaryMeshFile::Impl
+{
+    // Storage for the strings referenced by a mesh.
+    struct MeshStrings
+    {
+        string                  m_name;
+        vector<string>          m_material_slots;
+        vector<const char*>     m_material_slot_pointers;
+    };
+
+    MemoryMappedFile            m_file;
+    vector<Mesh>                m_meshes;
+    deque<MeshStrings>          m_strings;
+    list<vector<char> >         m_decompressed_blocks;
+
+    void clear()
+    {
+        m_file.close();
+        m_meshes.clear();
+        m_strings.clear();
+        m_decompressed_blocks.clear();
+    }
+
+    void parse(const size_t thread_count)
+    {
+        const char* file_begin = m_file.begin();
+        const char* file_end = m_file.end();
+
+        MemoryReaderAdapter header_reader(file_begin, file_end);
+        read_and_check_signature(header_reader);
+
+        uint16 version;
+        checked_read(header_reader, version);
+
+        if (version != 4)
+            throw ExceptionIOError("not an indexed binarymesh file");
+
+        // The offset of the table of contents is stored in the last 8 bytes of the file.
+        const uint64 file_size = static_cast<uint64>(file_end - file_begin);
+        if (file_size < sizeof(uint64) + static_cast<uint64>(header_reader.get_position() - file_begin))
+            throw ExceptionIOError("corrupted binarymesh file");
+
+        uint64 toc_offset;
+        memcpy(&toc_offset, file_end - sizeof(uint64), sizeof(uint64));
+
+        if (toc_offset > file_size - sizeof(uint64))
+            throw ExceptionIOError("corrupted binarymesh file");
+
+        MemoryReaderAdapter reader(file_begin + toc_offset, file_end - sizeof(uint64));
+
+        uint32 mesh_count;
+        checked_read(reader, mesh_count);
+
+        vector<LZ4Block> compressed_blocks;
+        vector<pair<const char*, size_t> > material_slot_blocks;
+
+        for (uint32 m = 0; m < mesh_count; ++m)
+        {
+            m_strings.push_back(MeshStrings());
+            MeshStrings& strings = m_strings.back();
+            strings.m_name = read_string(reader);
+
+            Mesh mesh;
+            memset(&mesh, 0, sizeof(Mesh));
+            mesh.m_name = strings.m_name.c_str();
+
+            uint32 vertex_count, vertex_normal_count, tex_coords_count, face_count, face_vertex_count;
+            uint16 material_slot_count, block_count;
+            checked_read(reader, vertex_count);
+            checked_read(reader, vertex_normal_count);
+            checked_read(reader, tex_coords_count);
+            checked_read(reader, material_slot_count);
+            checked_read(reader, face_count);
+            checked_read(reader, face_vertex_count);
+            checked_read(reader, block_count);
+
+            mesh.m_vertex_count = vertex_count;
+            mesh.m_vertex_normal_count = vertex_normal_count;
+            mesh.m_tex_coords_count = tex_coords_count;
+            mesh.m_material_slot_count = material_slot_count;
+            mesh.m_face_count = face_count;
+            mesh.m_face_vertex_count = face_vertex_count;
+
+            pair<const char*, size_t> material_slot_block(static_cast<const char*>(0), 0);
+
+            for (uint16 b = 0; b < block_count; ++b)
+            {
+                uint16 type, compression;
+                uint64 offset, stored_size, size;
+                checked_read(reader, type);
+                checked_read(reader, compression);
+                checked_read(reader, offset);
+                checked_read(reader, stored_size);
+                checked_read(reader, size);
+
+                // Blocks are stored before the table of contents.
+                if (offset > toc_offset || stored_size > toc_offset - offset)
+                    throw ExceptionIOError("corrupted binarymesh file");
+
+                const char* data;
+
+                switch (compression)
+                {
+                  case Uncompressed:
+                    check_block_size(stored_size, size);
+                    if (offset % BlockAlignment != 0)
+                        throw ExceptionIOError("corrupted binarymesh file");
+                    data = file_begin + offset;
+                    break;
+
+                  case LZ4Compressed:
+                    {
+                        m_decompressed_blocks.push_back(vector<char>(static_cast<size_t>(size)));
+                        vector<char>& buffer = m_decompressed_blocks.back();
+
+                        LZ4Block block;
+                        block.m_compressed_data = file_begin + offset;
+                        block.m_compressed_size = static_cast<size_t>(stored_size);
+                        block.m_data = buffer.empty() ? 0 : &buffer[0];
+                        block.m_size = buffer.size();
+                        block.m_success = false;
+                        compressed_blocks.push_back(block);
+
+                        data = block.m_data;
+                    }
+                    break;
+
+                  default:
+                    throw ExceptionIOError("unknown binarymesh block compression");
+                }
+
+                switch (type)
+                {
+                  case VertexBlock:
+                    check_block_size(size, uint64(vertex_count) * 3 * sizeof(float));
+                    mesh.m_vertices = reinterpret_cast<const float*>(data);
+                    break;
+
+                  case VertexNormalBlock:
+                    check_block_size(size, uint64(vertex_normal_count) * 3 * sizeof(float));
+                    mesh.m_vertex_normals = reinterpret_cast<const float*>(data);
+                    break;
+
+                  case TexCoordsBlock:
+                    check_block_size(size, uint64(tex_coords_count) * 2 * sizeof(float));
+                    mesh.m_tex_coords = reinterpret_cast<const float*>(data);
+                    break;
+
+                  case MaterialSlotBlock:
+                    material_slot_block = make_pair(data, static_cast<size_t>(size));
+                    break;
+
+                  case FaceSizeBlock:
+                    check_block_size(size, uint64(face_count) * sizeof(uint16));
+                    mesh.m_face_sizes = reinterpret_cast<const uint16*>(data);
+                    break;
+
+                  case FaceVertexBlock:
+                    check_block_size(size, uint64(face_vertex_count) * sizeof(uint32));
+                    mesh.m_face_vertices = reinterpret_cast<const uint32*>(data);
+                    break;
+
+                  case FaceVertexNormalBlock:
+                    check_block_size(size, uint64(face_vertex_count) * sizeof(uint32));
+                    mesh.m_face_vertex_normals = reinterpret_cast<const uint32*>(data);
+                    break;
+
+                  case FaceTexCoordsBlock:
+                    check_block_size(size, uint64(face_vertex_count) * sizeof(uint32));
+                    mesh.m_face_tex_coords = reinterpret_cast<const uint32*>(data);
+                    break;
+
+                  case FaceMaterialBlock:
+                    check_block_size(size, uint64(face_count) * sizeof(uint16));
+                    mesh.m_face_materials = reinterpret_cast<const uint16*>(data);
+                    break;
+
+                  default:
+                    // Ignore unknown blocks.
+                    break;
+                }
+            }
+
+            // Check that all mandatory blocks are present.
+            if ((vertex_count > 0 && mesh.m_vertices == 0) ||
+                (vertex_normal_count > 0 && mesh.m_vertex_normals == 0) ||
+                (tex_coords_count > 0 && mesh.m_tex_coords == 0) ||
+                (material_slot_count > 0 && material_slot_block.first == 0) ||
+                (face_count > 0 && (mesh.m_face_vertices == 0 || mesh.m_face_materials == 0)))
+                throw ExceptionIOError("corrupted binarymesh file");
+
+            m_meshes.push_back(mesh);
+            material_slot_blocks.push_back(material_slot_block);
+        }
+
+        decompress_lz4_blocks(compressed_blocks, thread_count);
+
+        // Complete the meshes now that all blocks are available.
+        for (size_t m = 0; m < m_meshes.size(); ++m)
+        {
+            Mesh& mesh = m_meshes[m];
+            MeshStrings& strings = m_strings[m];
+
+            if (mesh.m_material_slot_count > 0)
+            {
+                const char* begin = material_slot_blocks[m].first;
+                MemoryReaderAdapter slot_reader(begin, begin + material_slot_blocks[m].second);
+
+                try
+                {
+                    for (size_t i = 0; i < mesh.m_material_slot_count; ++i)
+                        strings.m_material_slots.push_back(read_string(slot_reader));
+                }
+                catch (const ExceptionEOF&)
+                {
+                    throw ExceptionIOError("corrupted binarymesh file");
+                }
+
+                for (size_t i = 0; i < mesh.m_material_slot_count; ++i)
+                    strings.m_material_slot_pointers.push_back(strings.m_material_slots[i].c_str());
+
+                mesh.m_material_slots = &strings.m_material_slot_pointers[0];
+            }
+
+            size_t face_vertex_count = mesh.m_face_count * 3;
+
+            if (mesh.m_face_sizes)
+            {
+                face_vertex_count = 0;
+                for (size_t i = 0; i < mesh.m_face_count; ++i)
+                    face_vertex_count += mesh.m_face_sizes[i];
+            }
+
+            if (face_vertex_count != mesh.m_face_vertex_count)
+                throw ExceptionIOError("corrupted binarymesh file");
+        }
+    }
+};
+
+MappedBinaryMeshFile::MappedBinaryMeshFile()
+  : impl(new Impl())
+{
+}
+
+MappedBinaryMeshFile::~MappedBinaryMeshFile()
+{
+    delete impl;
 }
 
-BinaryMeshFileReader::BinaryMeshFileReader(const string& filename)
+void MappedBinaryMeshFile::open(
+    const string&   filename,
+    const size_t    thread_count)
+{
+    impl->clear();
+
+    if (!impl->m_file.open(filename.c_str()))
+        throw ExceptionIOError();
+
+    try
+    {
+        impl->parse(thread_count);
+    }
+    catch (const ExceptionEOF&)
+    {
+        impl->clear();
+        throw ExceptionIOError();
+    }
+    catch (...)
+    {
+        impl->clear();
+        throw;
+    }
+}
+
+void MappedBinaryMeshFile::close()
+{
+    impl->clear();
+}
+
+bool MappedBinaryMeshFile::is_open() const
+{
+    return impl->m_file.is_open();
+}
+
+size_t MappedBinaryMeshFile::get_mesh_count() const
+{
+    return impl->m_meshes.size();
+}
+
+const MappedBinaryMeshFile::Mesh& MappedBinaryMeshFile::get_mesh(const size_t index) const
+{
+    assert(index < impl->m_meshes.size());
+    return impl->m_meshes[index];
+}
+
+
+//
+// BinaryMeshFileReader class implementation.
+//
+
+BinaryMeshFileReader::BinaryMeshFileReader(
+    const string&   filename,
+    const size_t    thread_count)
   : m_filename(filename)
+  , m_thread_count(thread_count)
 {
 }
 
 void BinaryMeshFileReader::read(IMeshBuilder& builder)
 {
-    BufferedFile file(
-        m_filename.c_str(),
-        BufferedFile::BinaryType,
-        BufferedFile::ReadMode);
-
-    if (!file.is_open())
+    // Map the input file into memory.
+    MemoryMappedFile file;
+    if (!file.open(m_filename.c_str()))
         throw ExceptionIOError();
 
-    read_and_check_signature(file);
+    MemoryReaderAdapter file_reader(file.begin(), file.end());
+
+    read_and_check_signature(file_reader);
 
     uint16 version;
-    checked_read(file, version);
+    checked_read(file_reader, version);
 
-    auto_ptr<ReaderAdapter> reader;
+    vector<char> decompressed;
 
     switch (version)
     {
       // Uncompressed.
       case 1:
-        reader.reset(new PassthroughReaderAdapter(file));
+        {
+            MemoryReaderAdapter reader(file_reader.get_position(), file.end());
+            read_meshes(reader, builder);
+        }
         break;
 
       // LZO-compressed.
@@ -115,38 +620,30 @@ void BinaryMeshFileReader::read(IMeshBuilder& builder)
 
       // LZ4-compressed.
       case 3:
-        reader.reset(new LZ4CompressedReaderAdapter(file));
+        {
+            decompress_lz4_stream(file_reader.get_position(), file.end(), m_thread_count, decompressed);
+
+            const char* begin = decompressed.empty() ? 0 : &decompressed[0];
+            MemoryReaderAdapter reader(begin, begin + decompressed.size());
+            read_meshes(reader, builder);
+        }
+        break;
+
+      // Indexed, optionally with LZ4-compressed blocks.
+      case 4:
+        {
+            file.close();
+
+            MappedBinaryMeshFile mapped_file;
+            mapped_file.open(m_filename, m_thread_count);
+            read_meshes(mapped_file, builder);
+        }
         break;
 
       // Unknown format.
       default:
         throw ExceptionIOError("unknown binarymesh format version");
     }
-
-    read_meshes(*reader.get(), builder);
-}
-
-void BinaryMeshFileReader::read_and_check_signature(BufferedFile& file)
-{
-    static const char ExpectedSig[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
-
-    char signature[sizeof(ExpectedSig)];
-    checked_read(file, signature, sizeof(signature));
-
-    if (memcmp(signature, ExpectedSig, sizeof(ExpectedSig)))
-        throw ExceptionIOError("invalid binarymesh format signature");
-}
-
-string BinaryMeshFileReader::read_string(ReaderAdapter& reader)
-{
-    uint16 length;
-    checked_read(reader, length);
-
-    string s;
-    s.resize(length);
-    checked_read(reader, &s[0], length);
-
-    return s;
 }
 
 void BinaryMeshFileReader::read_meshes(ReaderAdapter& reader, IMeshBuilder& builder)
@@ -185,6 +682,58 @@ void BinaryMeshFileReader::read_meshes(ReaderAdapter& reader, IMeshBuilder& buil
     }
 }
 
+void BinaryMeshFileReader::read_meshes(const MappedBinaryMeshFile& file, IMeshBuilder& builder)
+{
+    for (size_t m = 0; m < file.get_mesh_count(); ++m)
+    {
+        const MappedBinaryMeshFile::Mesh& mesh = file.get_mesh(m);
+
+        builder.begin_mesh(mesh.m_name);
+
+        for (size_t i = 0; i < mesh.m_vertex_count; ++i)
+            builder.push_vertex(Vector3d(Vector3f(&mesh.m_vertices[i * 3])));
+
+        for (size_t i = 0; i < mesh.m_vertex_normal_count; ++i)
+            builder.push_vertex_normal(Vector3d(Vector3f(&mesh.m_vertex_normals[i * 3])));
+
+        for (size_t i = 0; i < mesh.m_tex_coords_count; ++i)
+            builder.push_tex_coords(Vector2d(Vector2f(&mesh.m_tex_coords[i * 2])));
+
+        for (size_t i = 0; i < mesh.m_material_slot_count; ++i)
+            builder.push_material_slot(mesh.m_material_slots[i]);
+
+        size_t face_vertex_index = 0;
+
+        for (size_t i = 0; i < mesh.m_face_count; ++i)
+        {
+            const size_t count = mesh.m_face_sizes ? mesh.m_face_sizes[i] : 3;
+
+            ensure_minimum_size(m_vertices, count);
+            ensure_minimum_size(m_vertex_normals, count);
+            ensure_minimum_size(m_tex_coords, count);
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                const size_t k = face_vertex_index + j;
+                m_vertices[j] = mesh.m_face_vertices[k];
+                m_vertex_normals[j] = mesh.m_face_vertex_normals ? mesh.m_face_vertex_normals[k] : ~uint32(0);
+                m_tex_coords[j] = mesh.m_face_tex_coords ? mesh.m_face_tex_coords[k] : ~uint32(0);
+            }
+
+            face_vertex_index += count;
+
+            builder.begin_face(count);
+            builder.set_face_vertices(&m_vertices[0]);
+            builder.set_face_vertex_normals(&m_vertex_normals[0]);
+            builder.set_face_vertex_tex_coords(&m_tex_coords[0]);
+            builder.set_face_material(mesh.m_face_materials[i]);
+            builder.end_face();
+        }
+
+        builder.end_mesh();
+    }
+}
+
 void BinaryMeshFileReader::read_vertices(ReaderAdapter& reader, IMeshBuilder& builder)
 {
     uint32 count;
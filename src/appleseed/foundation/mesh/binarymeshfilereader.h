@@ -31,8 +31,10 @@
 #define APPLESEED_FOUNDATION_MESH_BINARYMESHFILEREADER_H
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/mesh/imeshfilereader.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
 
 // Standard headers.
 #include <cstddef>
@@ -40,13 +42,94 @@
 #include <vector>
 
 // Forward declarations.
-namespace foundation    { class BufferedFile; }
 namespace foundation    { class IMeshBuilder; }
 namespace foundation    { class ReaderAdapter; }
 
 namespace foundation
 {
 
+//
+// Direct access to the meshes of an indexed (version 4) BinaryMesh file.
+//
+// Uncompressed blocks are used in place from the memory-mapped file;
+// compressed blocks are decompressed once, when the file is opened.
+// All pointers remain valid until the file is closed.
+//
+
+class MappedBinaryMeshFile
+  : public NonCopyable
+{
+  public:
+    // Block types. Blocks of unknown types are ignored.
+    enum BlockType
+    {
+        VertexBlock             = 1,    // 3 floats per vertex
+        VertexNormalBlock       = 2,    // 3 floats per vertex normal
+        TexCoordsBlock          = 3,    // 2 floats per texture coordinate
+        MaterialSlotBlock       = 4,    // length-prefixed material slot names
+        FaceSizeBlock           = 5,    // uint16 per face, omitted if all faces are triangles
+        FaceVertexBlock         = 6,    // uint32 per face vertex
+        FaceVertexNormalBlock   = 7,    // uint32 per face vertex, omitted if unused
+        FaceTexCoordsBlock      = 8,    // uint32 per face vertex, omitted if unused
+        FaceMaterialBlock       = 9     // uint16 per face
+    };
+
+    enum Compression
+    {
+        Uncompressed            = 0,
+        LZ4Compressed           = 1
+    };
+
+    enum { BlockAlignment = 64 };
+
+    struct Mesh
+    {
+        const char*             m_name;
+        size_t                  m_vertex_count;
+        const float*            m_vertices;
+        size_t                  m_vertex_normal_count;
+        const float*            m_vertex_normals;
+        size_t                  m_tex_coords_count;
+        const float*            m_tex_coords;
+        size_t                  m_material_slot_count;
+        const char* const*      m_material_slots;
+        size_t                  m_face_count;
+        size_t                  m_face_vertex_count;
+        const uint16*           m_face_sizes;               // 0 if all faces are triangles
+        const uint32*           m_face_vertices;
+        const uint32*           m_face_vertex_normals;      // 0 if unused
+        const uint32*           m_face_tex_coords;          // 0 if unused
+        const uint16*           m_face_materials;
+    };
+
+    // Constructor.
+    MappedBinaryMeshFile();
+
+    // Destructor.
+    ~MappedBinaryMeshFile();
+
+    // Open a version 4 BinaryMesh file. Compressed blocks are decompressed
+    // using thread_count threads. Throws foundation::ExceptionIOError on failure.
+    void open(
+        const std::string&      filename,
+        const size_t            thread_count = 1);
+
+    // Close the file.
+    void close();
+
+    // Return true if the file is open.
+    bool is_open() const;
+
+    // Access the meshes of the file.
+    size_t get_mesh_count() const;
+    const Mesh& get_mesh(const size_t index) const;
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
+
+
 //
 // Read for a simple binary mesh file format.
 //
@@ -55,22 +138,23 @@ class BinaryMeshFileReader
   : public IMeshFileReader
 {
   public:
-    // Constructor.
-    explicit BinaryMeshFileReader(const std::string& filename);
+    // Constructor. Compressed files are decompressed using thread_count threads.
+    explicit BinaryMeshFileReader(
+        const std::string&  filename,
+        const size_t        thread_count = 1);
 
     // Read a mesh.
     virtual void read(IMeshBuilder& builder) APPLESEED_OVERRIDE;
 
   private:
     const std::string       m_filename;
+    const size_t            m_thread_count;
     std::vector<size_t>     m_vertices;
     std::vector<size_t>     m_vertex_normals;
     std::vector<size_t>     m_tex_coords;
 
-    static void read_and_check_signature(BufferedFile& file);
-
-    static std::string read_string(ReaderAdapter& reader);
     void read_meshes(ReaderAdapter& reader, IMeshBuilder& builder);
+    void read_meshes(const MappedBinaryMeshFile& file, IMeshBuilder& builder);
     void read_vertices(ReaderAdapter& reader, IMeshBuilder& builder);
     void read_vertex_normals(ReaderAdapter& reader, IMeshBuilder& builder);
     void read_texture_coordinates(ReaderAdapter& reader, IMeshBuilder& builder);
@@ -33,10 +33,15 @@
 // appleseed.foundation headers.
 #include "foundation/core/exceptions/exceptionioerror.h"
 #include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilereader.h"
 #include "foundation/mesh/imeshwalker.h"
-#include "foundation/platform/types.h"
+#include "foundation/utility/memory.h"
+
+// lz4 headers.
+#include "lz4.h"
 
 // Standard headers.
+#include <cassert>
 #include <cstring>
 
 using namespace std;
@@ -64,12 +69,25 @@ namespace
     {
         checked_write(file, &object, sizeof(T));
     }
+
+    // Blocks larger than this are never compressed.
+    const size_t MaxCompressedBlockSize = 1024 * 1024 * 1024;
 }
 
-BinaryMeshFileWriter::BinaryMeshFileWriter(const string& filename)
+BinaryMeshFileWriter::BinaryMeshFileWriter(
+    const string&   filename,
+    const Format    format)
   : m_filename(filename)
+  , m_format(format)
   , m_writer(m_file, 256 * 1024)
+  , m_offset(0)
+{
+}
+
+BinaryMeshFileWriter::~BinaryMeshFileWriter()
 {
+    if (m_format != LZ4Stream && m_file.is_open())
+        write_table_of_contents();
 }
 
 void BinaryMeshFileWriter::write(const IMeshWalker& walker)
@@ -88,7 +106,9 @@ void BinaryMeshFileWriter::write(const IMeshWalker& walker)
         write_version();
     }
 
-    write_mesh(walker);
+    if (m_format == LZ4Stream)
+        write_mesh(walker);
+    else write_indexed_mesh(walker);
 }
 
 void BinaryMeshFileWriter::write_signature()
@@ -96,13 +116,225 @@ void BinaryMeshFileWriter::write_signature()
     static const char Signature[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
 
     checked_write(m_file, Signature, sizeof(Signature));
+    m_offset += sizeof(Signature);
 }
 
 void BinaryMeshFileWriter::write_version()
 {
-    const uint16 Version = 3;
+    const uint16 Version = m_format == LZ4Stream ? 3 : 4;
 
     checked_write(m_file, Version);
+    m_offset += sizeof(Version);
+}
+
+void BinaryMeshFileWriter::write_indexed_mesh(const IMeshWalker& walker)
+{
+    m_indexed_meshes.push_back(IndexedMesh());
+    IndexedMesh& mesh = m_indexed_meshes.back();
+
+    mesh.m_name = walker.get_name();
+    mesh.m_vertex_count = static_cast<uint32>(walker.get_vertex_count());
+    mesh.m_vertex_normal_count = static_cast<uint32>(walker.get_vertex_normal_count());
+    mesh.m_tex_coords_count = static_cast<uint32>(walker.get_tex_coords_count());
+    mesh.m_material_slot_count = static_cast<uint16>(walker.get_material_slot_count());
+    mesh.m_face_count = static_cast<uint32>(walker.get_face_count());
+    mesh.m_face_vertex_count = 0;
+
+    // Vertices.
+    {
+        vector<float> vertices(mesh.m_vertex_count * 3);
+        for (uint32 i = 0; i < mesh.m_vertex_count; ++i)
+        {
+            const Vector3f v(walker.get_vertex(i));
+            vertices[i * 3 + 0] = v[0];
+            vertices[i * 3 + 1] = v[1];
+            vertices[i * 3 + 2] = v[2];
+        }
+        write_block(mesh, MappedBinaryMeshFile::VertexBlock, vertices.empty() ? 0 : &vertices[0], vertices.size() * sizeof(float));
+    }
+
+    // Vertex normals.
+    if (mesh.m_vertex_normal_count > 0)
+    {
+        vector<float> normals(mesh.m_vertex_normal_count * 3);
+        for (uint32 i = 0; i < mesh.m_vertex_normal_count; ++i)
+        {
+            const Vector3f n(walker.get_vertex_normal(i));
+            normals[i * 3 + 0] = n[0];
+            normals[i * 3 + 1] = n[1];
+            normals[i * 3 + 2] = n[2];
+        }
+        write_block(mesh, MappedBinaryMeshFile::VertexNormalBlock, &normals[0], normals.size() * sizeof(float));
+    }
+
+    // Texture coordinates.
+    if (mesh.m_tex_coords_count > 0)
+    {
+        vector<float> tex_coords(mesh.m_tex_coords_count * 2);
+        for (uint32 i = 0; i < mesh.m_tex_coords_count; ++i)
+        {
+            const Vector2f uv(walker.get_tex_coords(i));
+            tex_coords[i * 2 + 0] = uv[0];
+            tex_coords[i * 2 + 1] = uv[1];
+        }
+        write_block(mesh, MappedBinaryMeshFile::TexCoordsBlock, &tex_coords[0], tex_coords.size() * sizeof(float));
+    }
+
+    // Material slots.
+    if (mesh.m_material_slot_count > 0)
+    {
+        vector<char> slots;
+        for (uint16 i = 0; i < mesh.m_material_slot_count; ++i)
+        {
+            const char* name = walker.get_material_slot(i);
+            const uint16 length = static_cast<uint16>(strlen(name));
+            const char* length_bytes = reinterpret_cast<const char*>(&length);
+            slots.insert(slots.end(), length_bytes, length_bytes + sizeof(length));
+            slots.insert(slots.end(), name, name + length);
+        }
+        write_block(mesh, MappedBinaryMeshFile::MaterialSlotBlock, &slots[0], slots.size());
+    }
+
+    // Faces.
+    vector<uint16> face_sizes(mesh.m_face_count);
+    vector<uint16> face_materials(mesh.m_face_count);
+    vector<uint32> face_vertices;
+    vector<uint32> face_vertex_normals;
+    vector<uint32> face_tex_coords;
+    bool all_triangles = true;
+    bool has_face_vertex_normals = false;
+    bool has_face_tex_coords = false;
+
+    for (uint32 i = 0; i < mesh.m_face_count; ++i)
+    {
+        const uint16 count = static_cast<uint16>(walker.get_face_vertex_count(i));
+
+        face_sizes[i] = count;
+        face_materials[i] = static_cast<uint16>(walker.get_face_material(i));
+        all_triangles = all_triangles && count == 3;
+
+        for (uint16 j = 0; j < count; ++j)
+        {
+            const uint32 normal = static_cast<uint32>(walker.get_face_vertex_normal(i, j));
+            const uint32 tex_coords = static_cast<uint32>(walker.get_face_tex_coords(i, j));
+
+            face_vertices.push_back(static_cast<uint32>(walker.get_face_vertex(i, j)));
+            face_vertex_normals.push_back(normal);
+            face_tex_coords.push_back(tex_coords);
+
+            has_face_vertex_normals = has_face_vertex_normals || normal != ~uint32(0);
+            has_face_tex_coords = has_face_tex_coords || tex_coords != ~uint32(0);
+        }
+    }
+
+    mesh.m_face_vertex_count = static_cast<uint32>(face_vertices.size());
+
+    if (mesh.m_face_count > 0)
+    {
+        if (!all_triangles)
+            write_block(mesh, MappedBinaryMeshFile::FaceSizeBlock, &face_sizes[0], face_sizes.size() * sizeof(uint16));
+
+        write_block(mesh, MappedBinaryMeshFile::FaceVertexBlock, &face_vertices[0], face_vertices.size() * sizeof(uint32));
+
+        if (has_face_vertex_normals)
+            write_block(mesh, MappedBinaryMeshFile::FaceVertexNormalBlock, &face_vertex_normals[0], face_vertex_normals.size() * sizeof(uint32));
+
+        if (has_face_tex_coords)
+            write_block(mesh, MappedBinaryMeshFile::FaceTexCoordsBlock, &face_tex_coords[0], face_tex_coords.size() * sizeof(uint32));
+
+        write_block(mesh, MappedBinaryMeshFile::FaceMaterialBlock, &face_materials[0], face_materials.size() * sizeof(uint16));
+    }
+}
+
+void BinaryMeshFileWriter::write_block(
+    IndexedMesh&    mesh,
+    const uint16    type,
+    const void*     data,
+    const size_t    size)
+{
+    write_padding(MappedBinaryMeshFile::BlockAlignment);
+
+    Block block;
+    block.m_type = type;
+    block.m_compression = MappedBinaryMeshFile::Uncompressed;
+    block.m_offset = m_offset;
+    block.m_stored_size = size;
+    block.m_size = size;
+
+    const void* stored_data = data;
+
+    if (m_format == IndexedLZ4 && size > 0 && size <= MaxCompressedBlockSize)
+    {
+        const int max_compressed_size = LZ4_compressBound(static_cast<int>(size));
+        ensure_minimum_size(m_compressed_block, static_cast<size_t>(max_compressed_size));
+
+        const int compressed_size =
+            LZ4_compress(
+                static_cast<const char*>(data),
+                &m_compressed_block[0],
+                static_cast<int>(size));
+
+        // Only keep the compressed block if compression actually helps.
+        if (compressed_size > 0 && static_cast<size_t>(compressed_size) < size)
+        {
+            block.m_compression = MappedBinaryMeshFile::LZ4Compressed;
+            block.m_stored_size = static_cast<uint64>(compressed_size);
+            stored_data = &m_compressed_block[0];
+        }
+    }
+
+    checked_write(m_file, stored_data, static_cast<size_t>(block.m_stored_size));
+    m_offset += block.m_stored_size;
+
+    mesh.m_blocks.push_back(block);
+}
+
+void BinaryMeshFileWriter::write_padding(const size_t alignment)
+{
+    static const char Zeros[MappedBinaryMeshFile::BlockAlignment] = { 0 };
+
+    assert(alignment <= sizeof(Zeros));
+
+    const size_t padding = static_cast<size_t>((alignment - m_offset % alignment) % alignment);
+
+    checked_write(m_file, Zeros, padding);
+    m_offset += padding;
+}
+
+void BinaryMeshFileWriter::write_table_of_contents()
+{
+    write_padding(8);
+
+    const uint64 toc_offset = m_offset;
+
+    m_file.write(static_cast<uint32>(m_indexed_meshes.size()));
+
+    for (size_t i = 0; i < m_indexed_meshes.size(); ++i)
+    {
+        const IndexedMesh& mesh = m_indexed_meshes[i];
+
+        m_file.write(static_cast<uint16>(mesh.m_name.size()));
+        m_file.write(mesh.m_name.c_str(), mesh.m_name.size());
+        m_file.write(mesh.m_vertex_count);
+        m_file.write(mesh.m_vertex_normal_count);
+        m_file.write(mesh.m_tex_coords_count);
+        m_file.write(mesh.m_material_slot_count);
+        m_file.write(mesh.m_face_count);
+        m_file.write(mesh.m_face_vertex_count);
+        m_file.write(static_cast<uint16>(mesh.m_blocks.size()));
+
+        for (size_t j = 0; j < mesh.m_blocks.size(); ++j)
+        {
+            const Block& block = mesh.m_blocks[j];
+            m_file.write(block.m_type);
+            m_file.write(block.m_compression);
+            m_file.write(block.m_offset);
+            m_file.write(block.m_stored_size);
+            m_file.write(block.m_size);
+        }
+    }
+
+    m_file.write(toc_offset);
 }
 
 void BinaryMeshFileWriter::write_string(const char* s)
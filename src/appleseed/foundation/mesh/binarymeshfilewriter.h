@@ -33,11 +33,13 @@
 // appleseed.foundation headers.
 #include "foundation/mesh/imeshfilewriter.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/bufferedfile.h"
 
 // Standard headers.
 #include <cstddef>
 #include <string>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class IMeshWalker; }
@@ -53,20 +55,66 @@ class BinaryMeshFileWriter
   : public IMeshFileWriter
 {
   public:
+    enum Format
+    {
+        LZ4Stream,                  // version 3: a single LZ4-compressed stream
+        Indexed,                    // version 4: table of contents and uncompressed, memory-mappable blocks
+        IndexedLZ4                  // version 4: table of contents and independently LZ4-compressed blocks
+    };
+
     // Constructor.
-    explicit BinaryMeshFileWriter(const std::string& filename);
+    explicit BinaryMeshFileWriter(
+        const std::string&          filename,
+        const Format                format = LZ4Stream);
+
+    // Destructor.
+    ~BinaryMeshFileWriter();
 
     // Write a mesh.
     virtual void write(const IMeshWalker& walker) APPLESEED_OVERRIDE;
 
   private:
-    const std::string           m_filename;
-    BufferedFile                m_file;
-    LZ4CompressedWriterAdapter  m_writer;
+    struct Block
+    {
+        uint16                      m_type;
+        uint16                      m_compression;
+        uint64                      m_offset;
+        uint64                      m_stored_size;
+        uint64                      m_size;
+    };
+
+    struct IndexedMesh
+    {
+        std::string                 m_name;
+        uint32                      m_vertex_count;
+        uint32                      m_vertex_normal_count;
+        uint32                      m_tex_coords_count;
+        uint16                      m_material_slot_count;
+        uint32                      m_face_count;
+        uint32                      m_face_vertex_count;
+        std::vector<Block>          m_blocks;
+    };
+
+    const std::string               m_filename;
+    const Format                    m_format;
+    BufferedFile                    m_file;
+    LZ4CompressedWriterAdapter      m_writer;
+    uint64                          m_offset;
+    std::vector<IndexedMesh>        m_indexed_meshes;
+    std::vector<char>               m_compressed_block;
 
     void write_signature();
     void write_version();
 
+    void write_indexed_mesh(const IMeshWalker& walker);
+    void write_block(
+        IndexedMesh&                mesh,
+        const uint16                type,
+        const void*                 data,
+        const size_t                size);
+    void write_padding(const size_t alignment);
+    void write_table_of_contents();
+
     void write_string(const char* s);
     void write_mesh(const IMeshWalker& walker);
     void write_vertices(const IMeshWalker& walker);
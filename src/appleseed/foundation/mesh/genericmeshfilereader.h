@@ -36,6 +36,9 @@
 // appleseed.main headers.
 #include "main/dllsymbol.h"
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
 namespace foundation    { class IMeshBuilder; }
 
@@ -60,6 +63,10 @@ class APPLESEED_DLLSYMBOL GenericMeshFileReader
     int get_obj_options() const;
     void set_obj_options(const int obj_options);
 
+    // Get/set the number of threads used to parse large mesh files.
+    size_t get_thread_count() const;
+    void set_thread_count(const size_t thread_count);
+
     // Read a mesh.
     virtual void read(IMeshBuilder& builder);
 
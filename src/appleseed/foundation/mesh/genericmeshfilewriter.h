@@ -31,6 +31,7 @@
 #define APPLESEED_FOUNDATION_MESH_GENERICMESHFILEWRITER_H
 
 // appleseed.foundation headers.
+#include "foundation/mesh/binarymeshfilewriter.h"
 #include "foundation/mesh/imeshfilewriter.h"
 #include "foundation/platform/compiler.h"
 
@@ -51,8 +52,10 @@ class APPLESEED_DLLSYMBOL GenericMeshFileWriter
   : public IMeshFileWriter
 {
   public:
-    // Constructor.
-    explicit GenericMeshFileWriter(const char* filename);
+    // Constructor. The format is only used when writing BinaryMesh files.
+    explicit GenericMeshFileWriter(
+        const char*                         filename,
+        const BinaryMeshFileWriter::Format  binarymesh_format = BinaryMeshFileWriter::LZ4Stream);
 
     // Destructor.
     virtual ~GenericMeshFileWriter();
@@ -35,11 +35,23 @@
 #include "foundation/math/vector.h"
 #include "foundation/mesh/imeshbuilder.h"
 #include "foundation/mesh/objmeshfilelexer.h"
+#include "foundation/platform/memorymappedfile.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/log/logger.h"
 #include "foundation/utility/memory.h"
+#include "foundation/utility/otherwise.h"
 
 // Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cctype>
 #include <cstring>
 #include <map>
+#include <memory>
+#include <new>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -51,282 +63,798 @@ namespace foundation
 //
 // OBJMeshFileReader class implementation.
 //
+// The file is mapped into memory and cut into chunks of whole lines. Chunks are
+// parsed in parallel, in waves of one chunk per thread, into lists of vertices
+// and statements. The statements of each wave are then passed to the mesh builder
+// in file order, on the calling thread.
+//
+// Face indices may be relative to the number of vertices defined so far, so a
+// quick first pass counts the vertices defined in each chunk before parsing.
+//
 
 namespace
 {
     const size_t Undefined = ~0;
-}
 
-struct OBJMeshFileReader::Impl
-{
-    const int               m_options;
-    IMeshBuilder&           m_builder;
-    OBJMeshFileLexer        m_lexer;
+    // Chunks are never smaller than this, except for the last one.
+    const size_t MinChunkSize = 1024 * 1024;
 
-    // Current state.
-    bool                    m_inside_mesh_def;              // currently inside a mesh definition?
-    string                  m_current_mesh_name;            // name of the current mesh
-    map<string, size_t>     m_material_slots;               // material slots for the current mesh
-    size_t                  m_current_material_slot_index;  // index of the current material slot
+    // A range of lines of the file, parsed independently of the other ranges.
+    struct Chunk
+    {
+        enum StatementType
+        {
+            FaceStatement,                                  // indices are in m_indices
+            ObjectGroupStatement,                           // name is in m_names
+            UseMaterialStatement                            // name is in m_names
+        };
 
-    // Features defined in the file.
-    vector<Vector3d>        m_vertices;
-    vector<Vector2d>        m_tex_coords;
-    vector<Vector3d>        m_normals;
+        struct Statement
+        {
+            StatementType   m_type;
+            size_t          m_vertex_count;                 // face statements only
+            bool            m_has_tex_coords;               // face statements only
+            bool            m_has_normals;                  // face statements only
+        };
 
-    // Mappings between internal indices and mesh indices.
-    vector<size_t>          m_vertex_index_mapping;
-    vector<size_t>          m_tex_coord_index_mapping;
-    vector<size_t>          m_normal_index_mapping;
+        enum Error
+        {
+            NoError,
+            ParseError,
+            InvalidFaceDef,
+            OutOfMemory
+        };
+
+        // Input.
+        const char*         m_begin;
+        const char*         m_end;
+
+        // Results of the counting pass.
+        size_t              m_line_count;
+        size_t              m_vertex_count;
+        size_t              m_tex_coord_count;
+        size_t              m_normal_count;
+
+        // Number of lines and features defined before the chunk.
+        size_t              m_first_line;
+        size_t              m_vertex_base;
+        size_t              m_tex_coord_base;
+        size_t              m_normal_base;
+
+        // Results of the parsing pass.
+        vector<Vector3d>    m_vertices;
+        vector<Vector2d>    m_tex_coords;
+        vector<Vector3d>    m_normals;
+        vector<Statement>   m_statements;
+        vector<size_t>      m_indices;                      // face vertex, texture coordinates and normal indices
+        vector<string>      m_names;
+        Error               m_error;
+        size_t              m_error_line;
+
+        // Release the results of the parsing pass.
+        void clear()
+        {
+            clear_release_memory(m_vertices);
+            clear_release_memory(m_tex_coords);
+            clear_release_memory(m_normals);
+            clear_release_memory(m_statements);
+            clear_release_memory(m_indices);
+            clear_release_memory(m_names);
+        }
+    };
+
+    // Cut a range of characters into chunks of whole lines of roughly equal size.
+    void split_into_chunks(
+        const char*         begin,
+        const char*         end,
+        const size_t        chunk_count,
+        vector<Chunk>&      chunks)
+    {
+        const size_t size = static_cast<size_t>(end - begin);
+        const char* chunk_begin = begin;
 
-    // Temporary vectors for collecting indices while parsing face statements.
-    vector<size_t>          m_face_vertex_indices;
-    vector<size_t>          m_face_tex_coord_indices;
-    vector<size_t>          m_face_normal_indices;
+        for (size_t i = 1; i <= chunk_count && chunk_begin < end; ++i)
+        {
+            const char* chunk_end = begin + size * i / chunk_count;
 
-    // Constructor.
-    Impl(
-        const int           options,
-        IMeshBuilder&       builder)
-      : m_options(options)
-      , m_builder(builder)
-      , m_lexer(
-            (options & FavorSpeedOverPrecision)
-                ? OBJMeshFileLexer::Fast
-                : OBJMeshFileLexer::Precise)
-      , m_inside_mesh_def(false)
-      , m_current_material_slot_index(0)
-    {
+            if (chunk_end < chunk_begin)
+                chunk_end = chunk_begin;
+
+            // Extend the chunk to the end of the line.
+            if (i < chunk_count)
+            {
+                const char* newline =
+                    static_cast<const char*>(
+                        memchr(chunk_end, '\n', static_cast<size_t>(end - chunk_end)));
+                chunk_end = newline == 0 ? end : newline + 1;
+            }
+            else chunk_end = end;
+
+            Chunk chunk;
+            chunk.m_begin = chunk_begin;
+            chunk.m_end = chunk_end;
+            chunk.m_error = Chunk::NoError;
+            chunk.m_error_line = 0;
+            chunks.push_back(chunk);
+
+            chunk_begin = chunk_end;
+        }
+
+        // Always produce at least one chunk, even for empty files.
+        if (chunks.empty())
+        {
+            Chunk chunk;
+            chunk.m_begin = chunk.m_end = begin;
+            chunk.m_error = Chunk::NoError;
+            chunk.m_error_line = 0;
+            chunks.push_back(chunk);
+        }
     }
 
-    // Close the input file and throw an ExceptionParseError exception.
-    void parse_error()
+    // Count the lines, vertices, texture coordinates and normals of a chunk,
+    // recognizing keywords exactly like the parser does.
+    void count_chunk(Chunk& chunk)
     {
-        const size_t line_number = m_lexer.get_line_number();
+        size_t line_count = 0;
+        size_t vertex_count = 0;
+        size_t tex_coord_count = 0;
+        size_t normal_count = 0;
 
-        m_lexer.close();
+        const char* p = chunk.m_begin;
+        const char* end = chunk.m_end;
+
+        while (p < end)
+        {
+            const char* line_end = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (line_end == 0)
+                line_end = end;
+            else ++line_count;
+
+            // Skip leading blanks.
+            while (p < line_end && isspace(static_cast<unsigned char>(*p)))
+                ++p;
+
+            // Extract the keyword.
+            const char* keyword = p;
+            while (p < line_end && !isspace(static_cast<unsigned char>(*p)))
+                ++p;
+
+            const size_t keyword_length = static_cast<size_t>(p - keyword);
+
+            if (keyword_length == 1 && keyword[0] == 'v')
+                ++vertex_count;
+            else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 't')
+                ++tex_coord_count;
+            else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+                ++normal_count;
+
+            p = line_end + 1;
+        }
 
-        throw ExceptionParseError(line_number);
+        chunk.m_line_count = line_count;
+        chunk.m_vertex_count = vertex_count;
+        chunk.m_tex_coord_count = tex_coord_count;
+        chunk.m_normal_count = normal_count;
     }
 
-    void parse_file()
+    // Parse the statements of a chunk.
+    class ChunkParser
     {
-        while (true)
+      public:
+        ChunkParser(
+            const int       options,
+            Chunk&          chunk)
+          : m_options(options)
+          , m_chunk(chunk)
+          , m_lexer(
+                (options & OBJMeshFileReader::FavorSpeedOverPrecision)
+                    ? OBJMeshFileLexer::Fast
+                    : OBJMeshFileLexer::Precise)
         {
-            m_lexer.eat_blanks();
-
-            // Handle end of file.
-            if (m_lexer.is_eof())
-                break;
+        }
 
-            // Handle empty lines.
-            if (m_lexer.is_eol())
+        void parse()
+        {
+            try
             {
-                m_lexer.accept_newline();
-                continue;
+                m_lexer.open(m_chunk.m_begin, m_chunk.m_end, m_chunk.m_first_line);
+                parse_chunk();
+                m_lexer.close();
+            }
+            catch (const OBJMeshFileReader::ExceptionInvalidFaceDef& e)
+            {
+                m_chunk.m_error = Chunk::InvalidFaceDef;
+                m_chunk.m_error_line = e.m_line;
+            }
+            catch (const OBJMeshFileReader::ExceptionParseError& e)
+            {
+                m_chunk.m_error = Chunk::ParseError;
+                m_chunk.m_error_line = e.m_line;
+            }
+            catch (const bad_alloc&)
+            {
+                m_chunk.m_error = Chunk::OutOfMemory;
             }
+        }
 
-            const char* keyword;
-            size_t keyword_length;
+      private:
+        const int           m_options;
+        Chunk&              m_chunk;
+        OBJMeshFileLexer    m_lexer;
 
-            m_lexer.accept_string(&keyword, &keyword_length);
+        // Temporary vectors for collecting indices while parsing face statements.
+        vector<size_t>      m_face_vertex_indices;
+        vector<size_t>      m_face_tex_coord_indices;
+        vector<size_t>      m_face_normal_indices;
 
-            if (keyword_length == 1)
+        // Stop parsing and throw an ExceptionParseError exception.
+        void parse_error()
+        {
+            const size_t line_number = m_lexer.get_line_number();
+
+            m_lexer.close();
+
+            throw OBJMeshFileReader::ExceptionParseError(line_number);
+        }
+
+        void parse_chunk()
+        {
+            while (true)
             {
-                switch (keyword[0])
-                {
-                  case 'f':
-                    parse_f_statement();
-                    break;
+                m_lexer.eat_blanks();
 
-                  case 'g':
-                  case 'o':
-                    parse_o_g_statement();
+                // Handle end of chunk.
+                if (m_lexer.is_eof())
                     break;
 
-                  case 'v':
-                    parse_v_statement();
-                    break;
+                // Handle empty lines.
+                if (m_lexer.is_eol())
+                {
+                    m_lexer.accept_newline();
+                    continue;
+                }
 
-                  default:
+                const char* keyword;
+                size_t keyword_length;
+
+                m_lexer.accept_string(&keyword, &keyword_length);
+
+                if (keyword_length == 1)
+                {
+                    switch (keyword[0])
+                    {
+                      case 'f':
+                        parse_f_statement();
+                        break;
+
+                      case 'g':
+                      case 'o':
+                        parse_named_statement(Chunk::ObjectGroupStatement);
+                        break;
+
+                      case 'v':
+                        parse_v_statement();
+                        break;
+
+                      default:
+                        // Ignore unknown or unhandled statements.
+                        m_lexer.eat_line();
+                        continue;
+                    }
+                }
+                else if (keyword_length == 2)
+                {
+                    switch (keyword[0] * 256 + keyword[1])
+                    {
+                      case 'v' * 256 + 'n':
+                        parse_vn_statement();
+                        break;
+
+                      case 'v' * 256 + 't':
+                        parse_vt_statement();
+                        break;
+
+                      default:
+                        // Ignore unknown or unhandled statements.
+                        m_lexer.eat_line();
+                        continue;
+                    }
+                }
+                else if (strncmp(keyword, "usemtl", keyword_length) == 0)
+                {
+                    parse_named_statement(Chunk::UseMaterialStatement);
+                }
+                else
+                {
                     // Ignore unknown or unhandled statements.
                     m_lexer.eat_line();
                     continue;
                 }
+
+                m_lexer.eat_blanks();
+                m_lexer.accept_newline();
             }
-            else if (keyword_length == 2)
+        }
+
+        void parse_f_statement()
+        {
+            clear_keep_memory(m_face_vertex_indices);
+            clear_keep_memory(m_face_tex_coord_indices);
+            clear_keep_memory(m_face_normal_indices);
+
+            const size_t vertex_count = m_chunk.m_vertex_base + m_chunk.m_vertices.size();
+            const size_t tex_coord_count = m_chunk.m_tex_coord_base + m_chunk.m_tex_coords.size();
+            const size_t normal_count = m_chunk.m_normal_base + m_chunk.m_normals.size();
+
+            while (true)
             {
-                switch (keyword[0] * 256 + keyword[1])
-                {
-                  case 'v' * 256 + 'n':
-                    parse_vn_statement();
-                    break;
+                m_lexer.eat_blanks();
 
-                  case 'v' * 256 + 't':
-                    parse_vt_statement();
+                if (m_lexer.is_eol())
                     break;
 
-                  default:
-                    // Ignore unknown or unhandled statements.
-                    m_lexer.eat_line();
-                    continue;
+                //
+                // Recognized (epsilon)
+                // Accept n
+                //
+
+                {
+                    const long n = m_lexer.accept_long();
+                    const size_t v = fix_index(n, vertex_count);
+                    m_face_vertex_indices.push_back(v);
+                }
+
+                //
+                // Recognized n
+                // Accept (epsilon), /
+                //
+
+                {
+                    const unsigned char c = m_lexer.get_char();
+                    if (m_lexer.is_space(c))
+                        continue;
+                    else if (c == '/')
+                        m_lexer.next_char();
+                    else parse_error();
+                }
+
+                //
+                // Recognized n/
+                // Accept /, n
+                //
+
+                {
+                    const unsigned char c = m_lexer.get_char();
+                    if (c == '/')
+                    {
+                        m_lexer.next_char();
+                        goto skip;
+                    }
+                    else
+                    {
+                        const long n = m_lexer.accept_long();
+                        const size_t vt = fix_index(n, tex_coord_count);
+                        m_face_tex_coord_indices.push_back(vt);
+                    }
+                }
+
+                //
+                // Recognized n/n
+                // Accept (epsilon), /
+                //
+
+                {
+                    const unsigned char c = m_lexer.get_char();
+                    if (m_lexer.is_space(c))
+                        continue;
+                    else if (c == '/')
+                        m_lexer.next_char();
+                    else parse_error();
+                }
+
+              skip:
+
+                //
+                // Recognized n//, n/n/
+                // Accept (epsilon), n
+                //
+
+                {
+                    const unsigned char c = m_lexer.get_char();
+                    if (m_lexer.is_space(c))
+                        continue;
+                    else
+                    {
+                        const long n = m_lexer.accept_long();
+                        const size_t vn = fix_index(n, normal_count);
+                        m_face_normal_indices.push_back(vn);
+                    }
                 }
             }
-            else if (strncmp(keyword, "usemtl", keyword_length) == 0)
+
+            // Check whether the face is well-formed.
+            const size_t vc = m_face_vertex_indices.size();
+            const size_t tc = m_face_tex_coord_indices.size();
+            const size_t nc = m_face_normal_indices.size();
+            const bool well_formed =
+                    vc >= 3
+                && (tc == 0 || tc == vc)
+                && (nc == 0 || nc == vc);
+
+            if (well_formed)
             {
-                parse_usemtl_statement();
+                // The face is well-formed, record it.
+                Chunk::Statement statement;
+                statement.m_type = Chunk::FaceStatement;
+                statement.m_vertex_count = vc;
+                statement.m_has_tex_coords = tc > 0;
+                statement.m_has_normals = nc > 0;
+                m_chunk.m_statements.push_back(statement);
+
+                m_chunk.m_indices.insert(m_chunk.m_indices.end(), m_face_vertex_indices.begin(), m_face_vertex_indices.end());
+                m_chunk.m_indices.insert(m_chunk.m_indices.end(), m_face_tex_coord_indices.begin(), m_face_tex_coord_indices.end());
+                m_chunk.m_indices.insert(m_chunk.m_indices.end(), m_face_normal_indices.begin(), m_face_normal_indices.end());
             }
             else
             {
-                // Ignore unknown or unhandled statements.
-                m_lexer.eat_line();
-                continue;
+                // The face is ill-formed, ignore it or abort parsing.
+                if (m_options & OBJMeshFileReader::StopOnInvalidFaceDef)
+                    throw OBJMeshFileReader::ExceptionInvalidFaceDef(m_lexer.get_line_number());
             }
-
-            m_lexer.eat_blanks();
-            m_lexer.accept_newline();
         }
 
-        // End the definition of the last object.
-        if (m_inside_mesh_def)
-            m_builder.end_mesh();
-    }
+        // Convert 1-based indices (including negative indices) to 0-based indices.
+        size_t fix_index(const long index, const size_t count)
+        {
+            if (index > 0)
+            {
+                const size_t i = static_cast<size_t>(index);
+                if (i > count)
+                    parse_error();
+                return i - 1;
+            }
+            else if (index < 0)
+            {
+                const size_t i = static_cast<size_t>(-index);
+                if (i > count)
+                    parse_error();
+                return count - i;
+            }
+            else
+            {
+                parse_error();
+                return 0;       // keep the compiler happy
+            }
+        }
 
-    void parse_f_statement()
-    {
-        clear_keep_memory(m_face_vertex_indices);
-        clear_keep_memory(m_face_tex_coord_indices);
-        clear_keep_memory(m_face_normal_indices);
+        void parse_named_statement(const Chunk::StatementType type)
+        {
+            Chunk::Statement statement;
+            statement.m_type = type;
+            statement.m_vertex_count = 0;
+            statement.m_has_tex_coords = false;
+            statement.m_has_normals = false;
+            m_chunk.m_statements.push_back(statement);
+
+            m_chunk.m_names.push_back(parse_compound_identifier());
+        }
 
-        while (true)
+        string parse_compound_identifier()
         {
+            string identifier;
+
             m_lexer.eat_blanks();
 
-            if (m_lexer.is_eol())
-                break;
+            while (!m_lexer.is_eol())
+            {
+                const char* token;
+                size_t token_length;
 
-            //
-            // Recognized (epsilon)
-            // Accept n
-            //
+                m_lexer.accept_string(&token, &token_length);
+                m_lexer.eat_blanks();
 
-            {
-                const long n = m_lexer.accept_long();
-                const size_t v = fix_index(n, m_vertices.size());
-                m_face_vertex_indices.push_back(v);
+                if (!identifier.empty())
+                    identifier += ' ';
+
+                identifier.append(token, token_length);
             }
 
-            //
-            // Recognized n
-            // Accept (epsilon), /
-            //
+            return identifier;
+        }
 
-            {
-                const unsigned char c = m_lexer.get_char();
-                if (m_lexer.is_space(c))
-                    continue;
-                else if (c == '/')
-                    m_lexer.next_char();
-                else parse_error();
-            }
+        void parse_v_statement()
+        {
+            Vector3d v;
 
-            //
-            // Recognized n/
-            // Accept /, n
-            //
+            m_lexer.eat_blanks();
+            v.x = m_lexer.accept_double();
 
-            {
-                const unsigned char c = m_lexer.get_char();
-                if (c == '/')
-                {
-                    m_lexer.next_char();
-                    goto skip;
-                }
-                else
-                {
-                    const long n = m_lexer.accept_long();
-                    const size_t vt = fix_index(n, m_tex_coords.size());
-                    m_face_tex_coord_indices.push_back(vt);
-                }
-            }
+            m_lexer.eat_blanks();
+            v.y = m_lexer.accept_double();
 
-            //
-            // Recognized n/n
-            // Accept (epsilon), /
-            //
+            m_lexer.eat_blanks();
+            v.z = m_lexer.accept_double();
 
-            {
-                const unsigned char c = m_lexer.get_char();
-                if (m_lexer.is_space(c))
-                    continue;
-                else if (c == '/')
-                    m_lexer.next_char();
-                else parse_error();
-            }
+            m_lexer.eat_blanks();
+
+            if (!m_lexer.is_eol())
+                m_lexer.accept_double();
+
+            m_chunk.m_vertices.push_back(v);
+        }
+
+        void parse_vt_statement()
+        {
+            Vector2d v;
+
+            m_lexer.eat_blanks();
+            v.x = m_lexer.accept_double();
+
+            m_lexer.eat_blanks();
+            v.y = m_lexer.accept_double();
+
+            m_lexer.eat_blanks();
+
+            if (!m_lexer.is_eol())
+                m_lexer.accept_double();
+
+            m_chunk.m_tex_coords.push_back(v);
+        }
+
+        void parse_vn_statement()
+        {
+            Vector3d n;
+
+            m_lexer.eat_blanks();
+            n.x = m_lexer.accept_double();
+
+            m_lexer.eat_blanks();
+            n.y = m_lexer.accept_double();
+
+            m_lexer.eat_blanks();
+            n.z = m_lexer.accept_double();
 
-          skip:
+            m_chunk.m_normals.push_back(n);
+        }
+    };
 
-            //
-            // Recognized n//, n/n/
-            // Accept (epsilon), n
-            //
+    class ChunkJob
+      : public IJob
+    {
+      public:
+        enum Pass
+        {
+            CountingPass,
+            ParsingPass
+        };
+
+        ChunkJob(
+            const Pass      pass,
+            const int       options,
+            Chunk&          chunk)
+          : m_pass(pass)
+          , m_options(options)
+          , m_chunk(chunk)
+        {
+        }
 
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            if (m_pass == CountingPass)
+                count_chunk(m_chunk);
+            else
             {
-                const unsigned char c = m_lexer.get_char();
-                if (m_lexer.is_space(c))
-                    continue;
-                else
-                {
-                    const long n = m_lexer.accept_long();
-                    const size_t vn = fix_index(n, m_normals.size());
-                    m_face_normal_indices.push_back(vn);
-                }
+                ChunkParser parser(m_options, m_chunk);
+                parser.parse();
             }
         }
 
-        // Check whether the face is well-formed.
-        const size_t vc = m_face_vertex_indices.size();
-        const size_t tc = m_face_tex_coord_indices.size();
-        const size_t nc = m_face_normal_indices.size();
-        const bool well_formed =
-                vc >= 3
-            && (tc == 0 || tc == vc)
-            && (nc == 0 || nc == vc);
+      private:
+        const Pass          m_pass;
+        const int           m_options;
+        Chunk&              m_chunk;
+    };
 
-        if (well_formed)
+    // Run one pass over a range of chunks, in parallel if a job queue is provided.
+    void run_pass(
+        JobQueue*           job_queue,
+        const ChunkJob::Pass pass,
+        const int           options,
+        Chunk*              chunks,
+        const size_t        chunk_count)
+    {
+        if (job_queue && chunk_count > 1)
         {
-            // The face is well-formed, insert it into the mesh.
-            insert_face_into_mesh();
+            for (size_t i = 0; i < chunk_count; ++i)
+                job_queue->schedule(new ChunkJob(pass, options, chunks[i]));
+
+            job_queue->wait_until_completion();
         }
         else
         {
-            // The face is ill-formed, ignore it or abort parsing.
-            if (m_options & StopOnInvalidFaceDef)
-                throw ExceptionInvalidFaceDef(m_lexer.get_line_number());
+            for (size_t i = 0; i < chunk_count; ++i)
+            {
+                ChunkJob job(pass, options, chunks[i]);
+                job.execute(0);
+            }
         }
     }
+}
+
+struct OBJMeshFileReader::Impl
+{
+    IMeshBuilder&           m_builder;
+
+    // Current state.
+    bool                    m_inside_mesh_def;              // currently inside a mesh definition?
+    string                  m_current_mesh_name;            // name of the current mesh
+    map<string, size_t>     m_material_slots;               // material slots for the current mesh
+    size_t                  m_current_material_slot_index;  // index of the current material slot
+
+    // Features defined in the chunks parsed so far.
+    vector<Vector3d>        m_vertices;
+    vector<Vector2d>        m_tex_coords;
+    vector<Vector3d>        m_normals;
 
-    // Convert 1-based indices (including negative indices) to 0-based indices.
-    size_t fix_index(const long index, const size_t count)
+    // Mappings between internal indices and mesh indices.
+    vector<size_t>          m_vertex_index_mapping;
+    vector<size_t>          m_tex_coord_index_mapping;
+    vector<size_t>          m_normal_index_mapping;
+
+    // Temporary vectors for collecting the indices of the current face.
+    vector<size_t>          m_face_vertex_indices;
+    vector<size_t>          m_face_tex_coord_indices;
+    vector<size_t>          m_face_normal_indices;
+
+    // Constructor.
+    explicit Impl(IMeshBuilder& builder)
+      : m_builder(builder)
+      , m_inside_mesh_def(false)
+      , m_current_material_slot_index(0)
     {
-        if (index > 0)
+    }
+
+    void parse_file(
+        const char*         begin,
+        const char*         end,
+        const int           options,
+        const size_t        thread_count)
+    {
+        // Cut the file into chunks.
+        const size_t size = static_cast<size_t>(end - begin);
+        const size_t chunk_count = thread_count > 1 ? max<size_t>(size / MinChunkSize, 1) : 1;
+        vector<Chunk> chunks;
+        split_into_chunks(begin, end, chunk_count, chunks);
+
+        // Start worker threads if more than one chunk needs to be parsed.
+        Logger logger;
+        JobQueue job_queue;
+        auto_ptr<JobManager> job_manager;
+        if (chunks.size() > 1)
         {
-            const size_t i = static_cast<size_t>(index);
-            if (i > count)
-                parse_error();
-            return i - 1;
+            job_manager.reset(
+                new JobManager(
+                    logger,
+                    job_queue,
+                    min(thread_count, chunks.size()),
+                    JobManager::KeepRunningOnEmptyQueue));
+            job_manager->start();
         }
-        else if (index < 0)
+        JobQueue* parallel_queue = job_manager.get() ? &job_queue : 0;
+
+        // Count features and lines in all chunks.
+        run_pass(parallel_queue, ChunkJob::CountingPass, options, &chunks[0], chunks.size());
+
+        size_t line = 0, vertex = 0, tex_coord = 0, normal = 0;
+        for (size_t i = 0; i < chunks.size(); ++i)
         {
-            const size_t i = static_cast<size_t>(-index);
-            if (i > count)
-                parse_error();
-            return count - i;
+            Chunk& chunk = chunks[i];
+            chunk.m_first_line = line;
+            chunk.m_vertex_base = vertex;
+            chunk.m_tex_coord_base = tex_coord;
+            chunk.m_normal_base = normal;
+            line += chunk.m_line_count;
+            vertex += chunk.m_vertex_count;
+            tex_coord += chunk.m_tex_coord_count;
+            normal += chunk.m_normal_count;
         }
-        else
+
+        m_vertices.reserve(vertex);
+        m_tex_coords.reserve(tex_coord);
+        m_normals.reserve(normal);
+
+        // Parse chunks in waves of one chunk per thread, and pass their statements to the builder.
+        const size_t wave_size = max<size_t>(thread_count, 1);
+        for (size_t wave_begin = 0; wave_begin < chunks.size(); wave_begin += wave_size)
         {
-            parse_error();
-            return 0;       // keep the compiler happy
+            const size_t wave_end = min(wave_begin + wave_size, chunks.size());
+
+            run_pass(parallel_queue, ChunkJob::ParsingPass, options, &chunks[wave_begin], wave_end - wave_begin);
+
+            for (size_t i = wave_begin; i < wave_end; ++i)
+            {
+                Chunk& chunk = chunks[i];
+
+                switch (chunk.m_error)
+                {
+                  case Chunk::ParseError:
+                    throw ExceptionParseError(chunk.m_error_line);
+
+                  case Chunk::InvalidFaceDef:
+                    throw ExceptionInvalidFaceDef(chunk.m_error_line);
+
+                  case Chunk::OutOfMemory:
+                    throw bad_alloc();
+
+                  default:
+                    break;
+                }
+
+                assert(chunk.m_vertices.size() == chunk.m_vertex_count);
+                assert(chunk.m_tex_coords.size() == chunk.m_tex_coord_count);
+                assert(chunk.m_normals.size() == chunk.m_normal_count);
+
+                m_vertices.insert(m_vertices.end(), chunk.m_vertices.begin(), chunk.m_vertices.end());
+                m_tex_coords.insert(m_tex_coords.end(), chunk.m_tex_coords.begin(), chunk.m_tex_coords.end());
+                m_normals.insert(m_normals.end(), chunk.m_normals.begin(), chunk.m_normals.end());
+
+                insert_chunk_into_mesh(chunk);
+
+                chunk.clear();
+            }
+        }
+
+        // End the definition of the last object.
+        if (m_inside_mesh_def)
+            m_builder.end_mesh();
+    }
+
+    void insert_chunk_into_mesh(const Chunk& chunk)
+    {
+        const size_t* indices = chunk.m_indices.empty() ? 0 : &chunk.m_indices[0];
+        size_t name_index = 0;
+
+        for (size_t i = 0, e = chunk.m_statements.size(); i < e; ++i)
+        {
+            const Chunk::Statement& statement = chunk.m_statements[i];
+
+            switch (statement.m_type)
+            {
+              case Chunk::FaceStatement:
+                {
+                    const size_t n = statement.m_vertex_count;
+
+                    m_face_vertex_indices.assign(indices, indices + n);
+                    indices += n;
+
+                    if (statement.m_has_tex_coords)
+                    {
+                        m_face_tex_coord_indices.assign(indices, indices + n);
+                        indices += n;
+                    }
+                    else clear_keep_memory(m_face_tex_coord_indices);
+
+                    if (statement.m_has_normals)
+                    {
+                        m_face_normal_indices.assign(indices, indices + n);
+                        indices += n;
+                    }
+                    else clear_keep_memory(m_face_normal_indices);
+
+                    insert_face_into_mesh();
+                }
+                break;
+
+              case Chunk::ObjectGroupStatement:
+                begin_object_or_group(chunk.m_names[name_index++]);
+                break;
+
+              case Chunk::UseMaterialStatement:
+                use_material(chunk.m_names[name_index++]);
+                break;
+
+              assert_otherwise;
+            }
         }
     }
 
@@ -417,11 +945,8 @@ struct OBJMeshFileReader::Impl
             indices[i] = mapping[indices[i]];
     }
 
-    void parse_o_g_statement()
+    void begin_object_or_group(const string& upcoming_mesh_name)
     {
-        // Retrieve the name of the upcoming mesh.
-        const string upcoming_mesh_name = parse_compound_identifier();
-
         // Start a new mesh only if the name of the object or group actually changes.
         if (upcoming_mesh_name != m_current_mesh_name)
         {
@@ -440,92 +965,11 @@ struct OBJMeshFileReader::Impl
         }
     }
 
-    string parse_compound_identifier()
-    {
-        string identifier;
-
-        m_lexer.eat_blanks();
-
-        while (!m_lexer.is_eol())
-        {
-            const char* token;
-            size_t token_length;
-
-            m_lexer.accept_string(&token, &token_length);
-            m_lexer.eat_blanks();
-
-            if (!identifier.empty())
-                identifier += ' ';
-
-            identifier.append(token, token_length);
-        }
-
-        return identifier;
-    }
-
-    void parse_v_statement()
-    {
-        Vector3d v;
-
-        m_lexer.eat_blanks();
-        v.x = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-        v.y = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-        v.z = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-
-        if (!m_lexer.is_eol())
-            m_lexer.accept_double();
-
-        m_vertices.push_back(v);
-    }
-
-    void parse_vt_statement()
-    {
-        Vector2d v;
-
-        m_lexer.eat_blanks();
-        v.x = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-        v.y = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-
-        if (!m_lexer.is_eol())
-            m_lexer.accept_double();
-
-        m_tex_coords.push_back(v);
-    }
-
-    void parse_vn_statement()
-    {
-        Vector3d n;
-
-        m_lexer.eat_blanks();
-        n.x = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-        n.y = m_lexer.accept_double();
-
-        m_lexer.eat_blanks();
-        n.z = m_lexer.accept_double();
-
-        m_normals.push_back(n);
-    }
-
-    void parse_usemtl_statement()
+    void use_material(const string& material_slot_name)
     {
         // Begin a mesh definition if we're not already inside one.
         ensure_mesh_def();
 
-        // Retrieve the name of the material slot.
-        const string material_slot_name = parse_compound_identifier();
-
         // Check whether this material slot has already been defined for this mesh.
         const map<string, size_t>::const_iterator& it =
             m_material_slots.find(material_slot_name);
@@ -560,25 +1004,24 @@ struct OBJMeshFileReader::Impl
 
 OBJMeshFileReader::OBJMeshFileReader(
     const string&   filename,
-    const int       options)
+    const int       options,
+    const size_t    thread_count)
   : m_filename(filename)
   , m_options(options)
+  , m_thread_count(thread_count)
 {
 }
 
 void OBJMeshFileReader::read(IMeshBuilder& builder)
 {
-    Impl impl(m_options, builder);
-
-    // Open the input file.
-    if (!impl.m_lexer.open(m_filename))
+    // Map the input file into memory.
+    MemoryMappedFile file;
+    if (!file.open(m_filename.c_str()))
         throw ExceptionIOError();
 
     // Parse the file.
-    impl.parse_file();
-
-    // Close the input file.
-    impl.m_lexer.close();
+    Impl impl(builder);
+    impl.parse_file(file.begin(), file.end(), m_options, m_thread_count);
 }
 
 }   // namespace foundation
@@ -86,10 +86,11 @@ class OBJMeshFileReader
         StopOnInvalidFaceDef    = 1 << 1        // stop parsing on invalid face definitions
     };
 
-    // Constructor.
+    // Constructor. Large files are parsed in parallel using thread_count threads.
     OBJMeshFileReader(
         const std::string&  filename,
-        const int           options = Default);
+        const int           options = Default,
+        const size_t        thread_count = 1);
 
     // Read a mesh.
     virtual void read(IMeshBuilder& builder) APPLESEED_OVERRIDE;
@@ -99,6 +100,7 @@ class OBJMeshFileReader
 
     const std::string       m_filename;
     const int               m_options;
+    const size_t            m_thread_count;
 };
 
 }       // namespace foundation
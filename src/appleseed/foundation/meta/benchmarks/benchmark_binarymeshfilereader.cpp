@@ -0,0 +1,199 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilereader.h"
+#include "foundation/mesh/binarymeshfilewriter.h"
+#include "foundation/mesh/imeshwalker.h"
+#include "foundation/mesh/meshbuilderbase.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/benchmark.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+
+using namespace foundation;
+using namespace std;
+
+BENCHMARK_SUITE(Foundation_Mesh_BinaryMeshFileReader)
+{
+    // A regular grid of triangles with one normal and one texture coordinate per vertex.
+    class GridMeshWalker
+      : public IMeshWalker
+    {
+      public:
+        explicit GridMeshWalker(const size_t resolution)
+          : m_resolution(resolution)
+        {
+        }
+
+        virtual const char* get_name() const APPLESEED_OVERRIDE
+        {
+            return "grid";
+        }
+
+        virtual size_t get_vertex_count() const APPLESEED_OVERRIDE
+        {
+            return (m_resolution + 1) * (m_resolution + 1);
+        }
+
+        virtual Vector3d get_vertex(const size_t i) const APPLESEED_OVERRIDE
+        {
+            const Vector2d uv = get_tex_coords(i);
+            return Vector3d(uv[0], 0.0, uv[1]);
+        }
+
+        virtual size_t get_vertex_normal_count() const APPLESEED_OVERRIDE
+        {
+            return get_vertex_count();
+        }
+
+        virtual Vector3d get_vertex_normal(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return Vector3d(0.0, 1.0, 0.0);
+        }
+
+        virtual size_t get_tex_coords_count() const APPLESEED_OVERRIDE
+        {
+            return get_vertex_count();
+        }
+
+        virtual Vector2d get_tex_coords(const size_t i) const APPLESEED_OVERRIDE
+        {
+            const double rcp_resolution = 1.0 / m_resolution;
+            return
+                Vector2d(
+                    (i % (m_resolution + 1)) * rcp_resolution,
+                    (i / (m_resolution + 1)) * rcp_resolution);
+        }
+
+        virtual size_t get_material_slot_count() const APPLESEED_OVERRIDE
+        {
+            return 1;
+        }
+
+        virtual const char* get_material_slot(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return "default";
+        }
+
+        virtual size_t get_face_count() const APPLESEED_OVERRIDE
+        {
+            return m_resolution * m_resolution * 2;
+        }
+
+        virtual size_t get_face_vertex_count(const size_t face_index) const APPLESEED_OVERRIDE
+        {
+            return 3;
+        }
+
+        virtual size_t get_face_vertex(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            static const size_t Corners[2][3] = { { 0, 1, 3 }, { 0, 3, 2 } };
+
+            const size_t quad = face_index / 2;
+            const size_t x = quad % m_resolution;
+            const size_t y = quad / m_resolution;
+            const size_t corner = Corners[face_index % 2][vertex_index];
+
+            return (y + corner / 2) * (m_resolution + 1) + x + corner % 2;
+        }
+
+        virtual size_t get_face_vertex_normal(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            return get_face_vertex(face_index, vertex_index);
+        }
+
+        virtual size_t get_face_tex_coords(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            return get_face_vertex(face_index, vertex_index);
+        }
+
+        virtual size_t get_face_material(const size_t face_index) const APPLESEED_OVERRIDE
+        {
+            return 0;
+        }
+
+      private:
+        const size_t m_resolution;
+    };
+
+    struct Fixture
+    {
+        static const size_t GridResolution = 256;
+
+        MeshBuilderBase m_builder;
+
+        Fixture()
+        {
+            const GridMeshWalker walker(GridResolution);
+            write("unit benchmarks/outputs/benchmark_binarymeshfilereader_stream.binarymesh", BinaryMeshFileWriter::LZ4Stream, walker);
+            write("unit benchmarks/outputs/benchmark_binarymeshfilereader_indexed.binarymesh", BinaryMeshFileWriter::Indexed, walker);
+            write("unit benchmarks/outputs/benchmark_binarymeshfilereader_indexedlz4.binarymesh", BinaryMeshFileWriter::IndexedLZ4, walker);
+        }
+
+        static void write(
+            const string&                       filename,
+            const BinaryMeshFileWriter::Format  format,
+            const IMeshWalker&                  walker)
+        {
+            BinaryMeshFileWriter writer(filename, format);
+            writer.write(walker);
+        }
+
+        void read(const string& filename)
+        {
+            BinaryMeshFileReader reader(filename);
+            reader.read(m_builder);
+        }
+    };
+
+    BENCHMARK_CASE_F(Read_LZ4StreamFile, Fixture)
+    {
+        read("unit benchmarks/outputs/benchmark_binarymeshfilereader_stream.binarymesh");
+    }
+
+    BENCHMARK_CASE_F(Read_IndexedFile, Fixture)
+    {
+        read("unit benchmarks/outputs/benchmark_binarymeshfilereader_indexed.binarymesh");
+    }
+
+    BENCHMARK_CASE_F(Read_IndexedLZ4File, Fixture)
+    {
+        read("unit benchmarks/outputs/benchmark_binarymeshfilereader_indexedlz4.binarymesh");
+    }
+
+    // Only map the file and locate the blocks, as a renderer using the geometry in place would.
+    BENCHMARK_CASE_F(Open_IndexedFile, Fixture)
+    {
+        MappedBinaryMeshFile file;
+        file.open("unit benchmarks/outputs/benchmark_binarymeshfilereader_indexed.binarymesh");
+    }
+}
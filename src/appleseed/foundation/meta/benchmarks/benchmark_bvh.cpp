@@ -0,0 +1,441 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh.h"
+#include "foundation/math/intersection/rayaabb.h"
+#include "foundation/math/intersection/raytrianglemt.h"
+#include "foundation/math/ray.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/timers.h"
+#include "foundation/utility/alignedvector.h"
+#include "foundation/utility/benchmark.h"
+
+// Standard headers.
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+BENCHMARK_SUITE(Foundation_Math_BVH)
+{
+    typedef bvh::Node<AABB3d> NodeType;
+    typedef bvh::WideTree<AlignedVector<NodeType>, 4> TreeType;
+    typedef vector<AABB3d> AABBVector;
+
+    struct Visitor
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+        double                  m_hit_distance;
+
+        Visitor(const AABBVector& bboxes, const vector<size_t>& ordering)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_hit_distance(numeric_limits<double>::max())
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const AABB3d& bbox = m_bboxes[m_ordering[node.get_item_index() + i]];
+
+                double tmin;
+                if (intersect(ray, ray_info, bbox, tmin) && tmin < m_hit_distance)
+                    m_hit_distance = tmin;
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    struct Fixture
+    {
+        static const size_t BBoxCount = 20000;
+        static const size_t RayCount = 1000;
+
+        AABBVector          m_bboxes;
+        vector<size_t>      m_ordering;
+        TreeType            m_tree;
+        vector<Ray3d>       m_rays;
+        vector<RayInfo3d>   m_ray_infos;
+        double              m_distance_sum;
+
+        Fixture()
+          : m_distance_sum(0.0)
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < BBoxCount; ++i)
+            {
+                const Vector3d center(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+                const Vector3d extent(rand_double1(rng, 0.01, 0.1));
+                m_bboxes.push_back(AABB3d(center - extent, center + extent));
+            }
+
+            typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+            Partitioner partitioner(m_bboxes, 4);
+            bvh::Builder<TreeType, Partitioner> builder;
+            builder.build<DefaultWallclockTimer>(m_tree, partitioner, m_bboxes.size(), 4);
+            m_ordering = partitioner.get_item_ordering();
+
+            bvh::WideBuilder<TreeType> wide_builder;
+            wide_builder.build<DefaultWallclockTimer>(m_tree);
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                const Vector3d org(
+                    rand_double1(rng, -20.0, 20.0),
+                    rand_double1(rng, -20.0, 20.0),
+                    rand_double1(rng, -20.0, 20.0));
+                const Vector3d target(
+                    rand_double1(rng, -5.0, 5.0),
+                    rand_double1(rng, -5.0, 5.0),
+                    rand_double1(rng, -5.0, 5.0));
+                m_rays.push_back(Ray3d(org, normalize(target - org)));
+                m_ray_infos.push_back(RayInfo3d(m_rays.back()));
+            }
+        }
+    };
+
+    BENCHMARK_CASE_F(IntersectNoMotion_BinaryTraversal, Fixture)
+    {
+        const bvh::Intersector<TreeType, Visitor, Ray3d> intersector;
+
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            Visitor visitor(m_bboxes, m_ordering);
+            intersector.intersect_no_motion(m_tree, m_rays[i], m_ray_infos[i], visitor);
+            m_distance_sum += visitor.m_hit_distance;
+        }
+    }
+
+    BENCHMARK_CASE_F(IntersectNoMotion_WideTraversal, Fixture)
+    {
+        const bvh::WideIntersector<TreeType, Visitor, Ray3d> intersector;
+
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            Visitor visitor(m_bboxes, m_ordering);
+            intersector.intersect_no_motion(m_tree, m_rays[i], m_ray_infos[i], visitor);
+            m_distance_sum += visitor.m_hit_distance;
+        }
+    }
+}
+
+BENCHMARK_SUITE(Foundation_Math_BVH_TemporalBuilder)
+{
+    typedef bvh::Node<AABB3d> NodeType;
+    typedef vector<AABB3d> AABBVector;
+
+    // A triangle mesh with several poses evenly spaced over the shutter interval.
+    struct AnimatedMesh
+    {
+        static const size_t MotionSegmentCount = 1;
+
+        vector<Vector3d>    m_vertices[MotionSegmentCount + 1];
+        vector<size_t>      m_indices;
+
+        size_t size() const
+        {
+            return m_indices.size() / 3;
+        }
+
+        size_t get_motion_segment_count(const size_t item_index) const
+        {
+            return MotionSegmentCount;
+        }
+
+        Vector3d get_vertex(const size_t triangle_index, const size_t i, const double time) const
+        {
+            const size_t vertex_index = m_indices[triangle_index * 3 + i];
+            const double x = time * MotionSegmentCount;
+            const size_t prev_pose = min(truncate<size_t>(x), MotionSegmentCount - 1);
+            return
+                lerp(
+                    m_vertices[prev_pose][vertex_index],
+                    m_vertices[prev_pose + 1][vertex_index],
+                    x - prev_pose);
+        }
+
+        AABB3d compute_bbox(const size_t item_index, const double time) const
+        {
+            AABB3d bbox;
+            bbox.invalidate();
+            bbox.insert(get_vertex(item_index, 0, time));
+            bbox.insert(get_vertex(item_index, 1, time));
+            bbox.insert(get_vertex(item_index, 2, time));
+            return bbox;
+        }
+    };
+
+    struct TreeType
+      : public bvh::Tree<AlignedVector<NodeType> >
+    {
+        // Compute motion bounding boxes at the poses of the mesh, like TriangleTree does.
+        AABBVector compute_motion_bboxes(
+            const AnimatedMesh&     mesh,
+            const vector<size_t>&   ordering,
+            const size_t            node_index)
+        {
+            NodeType& node = m_nodes[node_index];
+            AABBVector bboxes(AnimatedMesh::MotionSegmentCount + 1);
+
+            if (node.is_interior())
+            {
+                const AABBVector left_bboxes = compute_motion_bboxes(mesh, ordering, node.get_child_node_index() + 0);
+                const AABBVector right_bboxes = compute_motion_bboxes(mesh, ordering, node.get_child_node_index() + 1);
+
+                node.set_left_bbox_index(m_node_bboxes.size());
+                node.set_left_bbox_count(left_bboxes.size());
+                for (size_t i = 0; i < left_bboxes.size(); ++i)
+                    m_node_bboxes.push_back(bvh::swizzle_motion_bbox(left_bboxes[i]));
+
+                node.set_right_bbox_index(m_node_bboxes.size());
+                node.set_right_bbox_count(right_bboxes.size());
+                for (size_t i = 0; i < right_bboxes.size(); ++i)
+                    m_node_bboxes.push_back(bvh::swizzle_motion_bbox(right_bboxes[i]));
+
+                for (size_t i = 0; i < bboxes.size(); ++i)
+                {
+                    bboxes[i] = left_bboxes[i];
+                    bboxes[i].insert(right_bboxes[i]);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < bboxes.size(); ++i)
+                {
+                    const double time = static_cast<double>(i) / AnimatedMesh::MotionSegmentCount;
+
+                    bboxes[i].invalidate();
+                    for (size_t j = 0; j < node.get_item_count(); ++j)
+                        bboxes[i].insert(mesh.compute_bbox(ordering[node.get_item_index() + j], time));
+                }
+            }
+
+            return bboxes;
+        }
+    };
+
+    struct Visitor
+    {
+        const AnimatedMesh&     m_mesh;
+        const vector<size_t>&   m_ordering;
+        const double            m_time;
+        double                  m_hit_distance;
+
+        Visitor(const AnimatedMesh& mesh, const vector<size_t>& ordering, const double time)
+          : m_mesh(mesh)
+          , m_ordering(ordering)
+          , m_time(time)
+          , m_hit_distance(numeric_limits<double>::max())
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t triangle_index = m_ordering[node.get_item_index() + i];
+                const TriangleMT<double> triangle(
+                    m_mesh.get_vertex(triangle_index, 0, m_time),
+                    m_mesh.get_vertex(triangle_index, 1, m_time),
+                    m_mesh.get_vertex(triangle_index, 2, m_time));
+
+                double t, u, v;
+                if (triangle.intersect(ray, t, u, v) && t < m_hit_distance)
+                    m_hit_distance = t;
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    template <bool Temporal, size_t MaxTimeSplitDepth>
+    struct Fixture
+    {
+        static const size_t GridSize = 100;
+        static const size_t RayCount = 1000;
+
+        AnimatedMesh        m_mesh;
+        vector<size_t>      m_ordering;
+        TreeType            m_tree;
+        vector<Ray3d>       m_rays;
+        vector<RayInfo3d>   m_ray_infos;
+        vector<double>      m_ray_times;
+        double              m_distance_sum;
+
+        Fixture()
+          : m_distance_sum(0.0)
+        {
+            // A page turning around its left edge during the shutter interval. Poses are
+            // linearly interpolated, so the page folds through itself in the middle.
+            for (size_t p = 0; p <= AnimatedMesh::MotionSegmentCount; ++p)
+            {
+                const double time = static_cast<double>(p) / AnimatedMesh::MotionSegmentCount;
+
+                for (size_t y = 0; y <= GridSize; ++y)
+                {
+                    for (size_t x = 0; x <= GridSize; ++x)
+                    {
+                        const double px = 20.0 * x / GridSize - 10.0;
+                        const double py = 20.0 * y / GridSize - 10.0;
+                        const double angle = time * Pi<double>();
+                        m_mesh.m_vertices[p].push_back(
+                            Vector3d(
+                                -10.0 + (px + 10.0) * cos(angle),
+                                py,
+                                (px + 10.0) * sin(angle)));
+                    }
+                }
+            }
+
+            for (size_t y = 0; y < GridSize; ++y)
+            {
+                for (size_t x = 0; x < GridSize; ++x)
+                {
+                    const size_t v00 = y * (GridSize + 1) + x;
+                    const size_t v10 = v00 + 1;
+                    const size_t v01 = v00 + GridSize + 1;
+                    const size_t v11 = v01 + 1;
+                    m_mesh.m_indices.push_back(v00);
+                    m_mesh.m_indices.push_back(v10);
+                    m_mesh.m_indices.push_back(v11);
+                    m_mesh.m_indices.push_back(v00);
+                    m_mesh.m_indices.push_back(v11);
+                    m_mesh.m_indices.push_back(v01);
+                }
+            }
+
+            if (Temporal)
+            {
+                bvh::TemporalBuilder<TreeType, AnimatedMesh> builder(2, 32, MaxTimeSplitDepth);
+                builder.build<DefaultWallclockTimer>(m_tree, m_mesh);
+                m_ordering = builder.get_item_ordering();
+            }
+            else
+            {
+                // Partition the triangles according to their bounding boxes at the middle
+                // of the shutter interval, then compute motion bounding boxes.
+                AABBVector bboxes;
+                for (size_t i = 0; i < m_mesh.size(); ++i)
+                    bboxes.push_back(m_mesh.compute_bbox(i, 0.5));
+
+                typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+                Partitioner partitioner(bboxes, 2);
+                bvh::Builder<TreeType, Partitioner> builder;
+                builder.build<DefaultWallclockTimer>(m_tree, partitioner, bboxes.size(), 2);
+                m_ordering = partitioner.get_item_ordering();
+
+                m_tree.compute_motion_bboxes(m_mesh, m_ordering, 0);
+            }
+
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                const Vector3d org(
+                    rand_double1(rng, -20.0, 20.0),
+                    rand_double1(rng, -20.0, 20.0),
+                    20.0);
+                const Vector3d target(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    0.0);
+                m_rays.push_back(Ray3d(org, normalize(target - org)));
+                m_ray_infos.push_back(RayInfo3d(m_rays.back()));
+                m_ray_times.push_back(rand_double2(rng));
+            }
+        }
+
+        void intersect_motion()
+        {
+            const bvh::Intersector<TreeType, Visitor, Ray3d> intersector;
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                Visitor visitor(m_mesh, m_ordering, m_ray_times[i]);
+                intersector.intersect_motion(m_tree, m_rays[i], m_ray_infos[i], m_ray_times[i], visitor);
+                m_distance_sum += visitor.m_hit_distance;
+            }
+        }
+    };
+
+    typedef Fixture<false, 0> BVHFixture;
+    typedef Fixture<true, 0> TemporalBVHFixture;
+    typedef Fixture<true, 2> STBVHFixture;
+
+    BENCHMARK_CASE_F(IntersectMotion_AnimatedMesh_BVH, BVHFixture)
+    {
+        intersect_motion();
+    }
+
+    // Without time splits, the builder still accounts for motion when partitioning items.
+    BENCHMARK_CASE_F(IntersectMotion_AnimatedMesh_TemporalBuilderWithoutTimeSplits, TemporalBVHFixture)
+    {
+        intersect_motion();
+    }
+
+    BENCHMARK_CASE_F(IntersectMotion_AnimatedMesh_STBVH, STBVHFixture)
+    {
+        intersect_motion();
+    }
+}
@@ -30,14 +30,17 @@
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/intersection/rayaabb.h"
+#include "foundation/math/intersection/raytrianglehh.h"
 #include "foundation/math/intersection/raytrianglemt.h"
 #include "foundation/math/intersection/raytrianglessk.h"
+#include "foundation/math/intersection/raytrianglewt.h"
 #include "foundation/math/ray.h"
 #include "foundation/math/rng/distribution.h"
 #include "foundation/math/rng/mersennetwister.h"
 #include "foundation/math/sampling/mappings.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/benchmark.h"
 
 // Standard headers.
@@ -248,6 +251,34 @@ namespace
     };
 }
 
+BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleHH)
+{
+    template <typename T, int TargetHitRate>
+    struct Fixture
+      : public RayTriangleFixture<TriangleHH<T>, T, TargetHitRate>
+    {
+    };
+
+    // We need these typedefs because we can't use commas in macro parameters.
+    typedef Fixture<float, 0>       FixtureFloat0;
+    typedef Fixture<float, 33>      FixtureFloat33;
+    typedef Fixture<float, 66>      FixtureFloat66;
+    typedef Fixture<float, 100>     FixtureFloat100;
+    typedef Fixture<double, 0>      FixtureDouble0;
+    typedef Fixture<double, 33>     FixtureDouble33;
+    typedef Fixture<double, 66>     FixtureDouble66;
+    typedef Fixture<double, 100>    FixtureDouble100;
+
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs0Percent, FixtureFloat0) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs33Percents, FixtureFloat33) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs66Percents, FixtureFloat66) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs100Percents, FixtureFloat100) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs0Percent, FixtureDouble0) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs33Percents, FixtureDouble33) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs66Percents, FixtureDouble66) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs100Percents, FixtureDouble100) { payload(); }
+}
+
 BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleMT)
 {
     template <typename T, int TargetHitRate>
@@ -303,3 +334,94 @@ BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleSSK)
     BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs66Percents, FixtureDouble66) { payload(); }
     BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs100Percents, FixtureDouble100) { payload(); }
 };
+
+BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleWT)
+{
+    template <typename T, int TargetHitRate>
+    struct Fixture
+      : public RayTriangleFixture<TriangleWT<T>, T, TargetHitRate>
+    {
+    };
+
+    // We need these typedefs because we can't use commas in macro parameters.
+    typedef Fixture<float, 0>       FixtureFloat0;
+    typedef Fixture<float, 33>      FixtureFloat33;
+    typedef Fixture<float, 66>      FixtureFloat66;
+    typedef Fixture<float, 100>     FixtureFloat100;
+    typedef Fixture<double, 0>      FixtureDouble0;
+    typedef Fixture<double, 33>     FixtureDouble33;
+    typedef Fixture<double, 66>     FixtureDouble66;
+    typedef Fixture<double, 100>    FixtureDouble100;
+
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs0Percent, FixtureFloat0) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs33Percents, FixtureFloat33) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs66Percents, FixtureFloat66) { payload(); }
+    BENCHMARK_CASE_F(Intersect_SinglePrecision_HitRateIs100Percents, FixtureFloat100) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs0Percent, FixtureDouble0) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs33Percents, FixtureDouble33) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs66Percents, FixtureDouble66) { payload(); }
+    BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs100Percents, FixtureDouble100) { payload(); }
+}
+BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleWTPacket)
+{
+    template <size_t N>
+    struct Fixture
+      : public FixtureBase<float>
+    {
+        static const size_t RayCount = 1000;
+
+        TriangleWT<float>           m_triangles[N];
+        TriangleWTPacket<N>         m_packet;
+        RayType                     m_ray[RayCount];
+        TriangleWTRayInfo<float>    m_ray_info[RayCount];
+
+        uint32                      m_hits;
+        float                       m_t[N];
+        float                       m_u[N];
+        float                       m_v[N];
+
+        Fixture()
+          : m_hits(0)
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < N; ++i)
+            {
+                const VectorType v0 = get_random_vector<3>(rng, -1.0f, 1.0f);
+                const VectorType v1 = get_random_vector<3>(rng, -1.0f, 1.0f);
+                const VectorType v2 = get_random_vector<3>(rng, -1.0f, 1.0f);
+                m_triangles[i] = TriangleWT<float>(v0, v1, v2);
+                m_packet.set(i, v0, v1, v2);
+            }
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                get_random_ray(rng, 10.0f, m_ray[i]);
+                m_ray_info[i] = TriangleWTRayInfo<float>(m_ray[i]);
+            }
+        }
+
+        APPLESEED_FORCE_INLINE void one_by_one_payload()
+        {
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                for (size_t j = 0; j < N; ++j)
+                {
+                    if (m_triangles[j].intersect(m_ray[i], m_ray_info[i], m_t[j], m_u[j], m_v[j]))
+                        m_hits ^= uint32(1) << j;
+                }
+            }
+        }
+
+        APPLESEED_FORCE_INLINE void packet_payload()
+        {
+            for (size_t i = 0; i < RayCount; ++i)
+                m_hits ^= m_packet.intersect(m_ray[i], m_ray_info[i], m_t, m_u, m_v);
+        }
+    };
+
+    BENCHMARK_CASE_F(Intersect_FourTrianglesOneByOne, Fixture<4>) { one_by_one_payload(); }
+    BENCHMARK_CASE_F(Intersect_FourTrianglesPacket, Fixture<4>) { packet_payload(); }
+    BENCHMARK_CASE_F(Intersect_EightTrianglesOneByOne, Fixture<8>) { one_by_one_payload(); }
+    BENCHMARK_CASE_F(Intersect_EightTrianglesPacket, Fixture<8>) { packet_payload(); }
+}
@@ -48,6 +48,31 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
         }
     };
 
+    // A job that recursively splits itself into two child jobs until it reaches a given depth.
+    class SplittingJob
+      : public IJob
+    {
+      public:
+        SplittingJob(JobQueue& job_queue, const size_t depth)
+          : m_job_queue(job_queue)
+          , m_depth(depth)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            if (m_depth > 0)
+            {
+                m_job_queue.schedule(new SplittingJob(m_job_queue, m_depth - 1), true, thread_index);
+                m_job_queue.schedule(new SplittingJob(m_job_queue, m_depth - 1), true, thread_index);
+            }
+        }
+
+      private:
+        JobQueue&       m_job_queue;
+        const size_t    m_depth;
+    };
+
     template <size_t ThreadCount>
     struct Fixture
     {
@@ -71,6 +96,29 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
 
             m_job_queue.wait_until_completion();
         }
+
+        void tiny_jobs_payload(const bool use_affinity)
+        {
+            const size_t JobCount = 4096;
+            EmptyJob jobs[JobCount];
+
+            for (size_t i = 0; i < JobCount; ++i)
+            {
+                m_job_queue.schedule(
+                    &jobs[i],
+                    false,
+                    use_affinity ? (i * ThreadCount) / JobCount : JobQueue::NoAffinity);
+            }
+
+            m_job_queue.wait_until_completion();
+        }
+
+        void splitting_jobs_payload()
+        {
+            // 2^13 - 1 jobs in total.
+            m_job_queue.schedule(new SplittingJob(m_job_queue, 12));
+            m_job_queue.wait_until_completion();
+        }
     };
 
     BENCHMARK_CASE_F(SingleThreadedJobExecution, Fixture<1>)
@@ -82,4 +130,34 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
     {
         payload();
     }
+
+    BENCHMARK_CASE_F(TinyJobs_SharedQueue_SingleThreaded, Fixture<1>)
+    {
+        tiny_jobs_payload(false);
+    }
+
+    BENCHMARK_CASE_F(TinyJobs_SharedQueue_QuadThreaded, Fixture<4>)
+    {
+        tiny_jobs_payload(false);
+    }
+
+    BENCHMARK_CASE_F(TinyJobs_WorkerQueues_SingleThreaded, Fixture<1>)
+    {
+        tiny_jobs_payload(true);
+    }
+
+    BENCHMARK_CASE_F(TinyJobs_WorkerQueues_QuadThreaded, Fixture<4>)
+    {
+        tiny_jobs_payload(true);
+    }
+
+    BENCHMARK_CASE_F(SplittingJobs_SingleThreaded, Fixture<1>)
+    {
+        splitting_jobs_payload();
+    }
+
+    BENCHMARK_CASE_F(SplittingJobs_QuadThreaded, Fixture<4>)
+    {
+        splitting_jobs_payload();
+    }
 }
@@ -38,6 +38,7 @@
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/benchmark.h"
 #include "foundation/utility/bufferedfile.h"
+#include "foundation/utility/job.h"
 #include "foundation/utility/log.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
@@ -282,3 +283,184 @@ BENCHMARK_SUITE(Foundation_Math_Knn_Query)
     BENCHMARK_CASE_F(PhotonMap_K100, PhotonMapFixture<100>)  { run_queries(); }
     BENCHMARK_CASE_F(PhotonMap_K500, PhotonMapFixture<500>)  { run_queries(); }
 }
+
+BENCHMARK_SUITE(Foundation_Math_Knn_Builder)
+{
+    const size_t PointCount = 256 * 1024;
+
+    struct FixtureBase
+    {
+        vector<Vector3f>    m_points;
+        knn::Tree3f         m_tree;
+
+        FixtureBase()
+          : m_points(PointCount)
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < PointCount; ++i)
+                m_points[i] = rand_vector1<Vector3f>(rng);
+        }
+    };
+
+    struct SequentialFixture
+      : public FixtureBase
+    {
+        void build()
+        {
+            knn::Builder3f builder(m_tree);
+            builder.build<DefaultWallclockTimer>(&m_points[0], m_points.size());
+        }
+    };
+
+    template <size_t ThreadCount>
+    struct ParallelFixture
+      : public FixtureBase
+    {
+        Logger              m_logger;
+        JobQueue            m_job_queue;
+        JobManager          m_job_manager;
+
+        ParallelFixture()
+          : m_job_manager(m_logger, m_job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue)
+        {
+            m_job_manager.start();
+        }
+
+        void build()
+        {
+            knn::ParallelBuilder3f builder(m_tree, m_job_queue);
+            builder.build<DefaultWallclockTimer>(&m_points[0], m_points.size());
+        }
+    };
+
+    BENCHMARK_CASE_F(Sequential, SequentialFixture)             { build(); }
+    BENCHMARK_CASE_F(Parallel_1Thread, ParallelFixture<1>)      { build(); }
+    BENCHMARK_CASE_F(Parallel_2Threads, ParallelFixture<2>)     { build(); }
+    BENCHMARK_CASE_F(Parallel_4Threads, ParallelFixture<4>)     { build(); }
+    BENCHMARK_CASE_F(Parallel_8Threads, ParallelFixture<8>)     { build(); }
+}
+
+BENCHMARK_SUITE(Foundation_Math_Knn_BatchQuery)
+{
+    const size_t PointCount = 256 * 1024;
+    const size_t QueryCount = 16 * 1024;
+    const size_t AnswerSize = 20;
+
+    struct AccumulateAnswerSize
+    {
+        size_t m_accumulator;
+
+        AccumulateAnswerSize()
+          : m_accumulator(0)
+        {
+        }
+
+        void operator()(const size_t query_index, const knn::Answer<float>& answer)
+        {
+            m_accumulator += answer.size();
+        }
+    };
+
+    class QueryJob
+      : public IJob
+    {
+      public:
+        QueryJob(
+            const knn::Tree3f&      tree,
+            const Vector3f          query_points[],
+            const size_t            query_count,
+            size_t&                 result)
+          : m_tree(tree)
+          , m_query_points(query_points)
+          , m_query_count(query_count)
+          , m_result(result)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            knn::Answer<float> answer(AnswerSize);
+            knn::Query3f query(m_tree, answer);
+
+            AccumulateAnswerSize visitor;
+            query.run_batch(m_query_points, m_query_count, visitor);
+
+            m_result = visitor.m_accumulator;
+        }
+
+      private:
+        const knn::Tree3f&          m_tree;
+        const Vector3f*             m_query_points;
+        const size_t                m_query_count;
+        size_t&                     m_result;
+    };
+
+    template <size_t ThreadCount>
+    struct Fixture
+    {
+        Logger              m_logger;
+        JobQueue            m_job_queue;
+        JobManager          m_job_manager;
+        knn::Tree3f         m_tree;
+        vector<Vector3f>    m_query_points;
+        size_t              m_results[ThreadCount];
+
+        Fixture()
+          : m_job_manager(m_logger, m_job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue)
+          , m_query_points(QueryCount)
+        {
+            MersenneTwister rng;
+
+            vector<Vector3f> points(PointCount);
+            for (size_t i = 0; i < PointCount; ++i)
+                points[i] = rand_vector1<Vector3f>(rng);
+
+            knn::Builder3f builder(m_tree);
+            builder.build_move_points<DefaultWallclockTimer>(points);
+
+            for (size_t i = 0; i < QueryCount; ++i)
+                m_query_points[i] = rand_vector1<Vector3f>(rng);
+
+            m_job_manager.start();
+        }
+
+        void run_individual_queries()
+        {
+            knn::Answer<float> answer(AnswerSize);
+            knn::Query3f query(m_tree, answer);
+
+            m_results[0] = 0;
+
+            for (size_t i = 0; i < QueryCount; ++i)
+            {
+                query.run(m_query_points[i]);
+                m_results[0] += answer.size();
+            }
+        }
+
+        void run_batch_queries()
+        {
+            for (size_t i = 0; i < ThreadCount; ++i)
+            {
+                const size_t begin = (i * QueryCount) / ThreadCount;
+                const size_t end = ((i + 1) * QueryCount) / ThreadCount;
+
+                m_job_queue.schedule(
+                    new QueryJob(
+                        m_tree,
+                        &m_query_points[begin],
+                        end - begin,
+                        m_results[i]));
+            }
+
+            m_job_queue.wait_until_completion();
+        }
+    };
+
+    BENCHMARK_CASE_F(IndividualQueries_1Thread, Fixture<1>)     { run_individual_queries(); }
+    BENCHMARK_CASE_F(BatchQueries_1Thread, Fixture<1>)          { run_batch_queries(); }
+    BENCHMARK_CASE_F(BatchQueries_2Threads, Fixture<2>)         { run_batch_queries(); }
+    BENCHMARK_CASE_F(BatchQueries_4Threads, Fixture<4>)         { run_batch_queries(); }
+    BENCHMARK_CASE_F(BatchQueries_8Threads, Fixture<8>)         { run_batch_queries(); }
+}
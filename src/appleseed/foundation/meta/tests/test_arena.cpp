@@ -0,0 +1,115 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// appleseed.foundation headers.
+#include "foundation/utility/arena.h"
+#include "foundation/utility/memory.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Utility_Arena)
+{
+    TEST_CASE(InitialStateIsCorrect)
+    {
+        auto_ptr<Arena> arena(new Arena());
+
+        EXPECT_EQ(0, arena->get_high_water_mark());
+        EXPECT_EQ(1, arena->get_block_count());
+    }
+
+    TEST_CASE(Allocate_ReturnsAlignedMemory)
+    {
+        auto_ptr<Arena> arena(new Arena());
+
+        for (size_t i = 1; i < 64; ++i)
+            EXPECT_TRUE(is_aligned(arena->allocate(i), 16));
+    }
+
+    TEST_CASE(Allocate_InlineStorageExhausted_ChainsHeapBlock)
+    {
+        auto_ptr<Arena> arena(new Arena());
+        const size_t Size = 1024;
+
+        for (size_t i = 0; i < 512; ++i)
+        {
+            void* ptr = arena->allocate(Size);
+            memset(ptr, 0, Size);
+            EXPECT_TRUE(is_aligned(ptr, 16));
+        }
+
+        EXPECT_EQ(2, arena->get_block_count());
+        EXPECT_EQ(512 * Size, arena->get_high_water_mark());
+    }
+
+    TEST_CASE(Allocate_LargerThanBlockSize_Succeeds)
+    {
+        auto_ptr<Arena> arena(new Arena());
+        const size_t Size = 1024 * 1024;
+
+        void* ptr = arena->allocate(Size);
+        memset(ptr, 0, Size);
+
+        EXPECT_EQ(2, arena->get_block_count());
+        EXPECT_TRUE(arena->get_capacity() >= Size);
+    }
+
+    TEST_CASE(Clear_RetainsHeapBlocks)
+    {
+        auto_ptr<Arena> arena(new Arena());
+
+        for (size_t pass = 0; pass < 3; ++pass)
+        {
+            arena->clear();
+
+            for (size_t i = 0; i < 512; ++i)
+                arena->allocate(1024);
+        }
+
+        EXPECT_EQ(2, arena->get_block_count());
+    }
+
+    TEST_CASE(Clear_KeepsHighWaterMark)
+    {
+        auto_ptr<Arena> arena(new Arena());
+
+        arena->allocate(4096);
+        arena->clear();
+        arena->allocate(16);
+        arena->clear();
+
+        EXPECT_EQ(4096, arena->get_high_water_mark());
+    }
+}
@@ -0,0 +1,444 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilereader.h"
+#include "foundation/mesh/binarymeshfilewriter.h"
+#include "foundation/mesh/imeshbuilder.h"
+#include "foundation/mesh/imeshwalker.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Mesh_BinaryMeshFileReader)
+{
+    const uint32 NoIndex = ~uint32(0);
+
+    struct Face
+    {
+        vector<uint32>      m_vertices;
+        vector<uint32>      m_vertex_normals;
+        vector<uint32>      m_tex_coords;
+        uint32              m_material;
+
+        bool operator==(const Face& rhs) const
+        {
+            return
+                m_vertices == rhs.m_vertices &&
+                m_vertex_normals == rhs.m_vertex_normals &&
+                m_tex_coords == rhs.m_tex_coords &&
+                m_material == rhs.m_material;
+        }
+    };
+
+    struct Mesh
+    {
+        string              m_name;
+        vector<Vector3d>    m_vertices;
+        vector<Vector3d>    m_vertex_normals;
+        vector<Vector2d>    m_tex_coords;
+        vector<string>      m_material_slots;
+        vector<Face>        m_faces;
+
+        bool operator==(const Mesh& rhs) const
+        {
+            return
+                m_name == rhs.m_name &&
+                m_vertices == rhs.m_vertices &&
+                m_vertex_normals == rhs.m_vertex_normals &&
+                m_tex_coords == rhs.m_tex_coords &&
+                m_material_slots == rhs.m_material_slots &&
+                m_faces == rhs.m_faces;
+        }
+    };
+
+    struct MeshBuilder
+      : public IMeshBuilder
+    {
+        vector<Mesh> m_meshes;
+
+        virtual void begin_mesh(const char* name) APPLESEED_OVERRIDE
+        {
+            m_meshes.push_back(Mesh());
+            m_meshes.back().m_name = name;
+        }
+
+        virtual size_t push_vertex(const Vector3d& v) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_vertices.push_back(v);
+            return m_meshes.back().m_vertices.size() - 1;
+        }
+
+        virtual size_t push_vertex_normal(const Vector3d& v) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_vertex_normals.push_back(v);
+            return m_meshes.back().m_vertex_normals.size() - 1;
+        }
+
+        virtual size_t push_tex_coords(const Vector2d& v) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_tex_coords.push_back(v);
+            return m_meshes.back().m_tex_coords.size() - 1;
+        }
+
+        virtual size_t push_material_slot(const char* name) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_material_slots.push_back(name);
+            return m_meshes.back().m_material_slots.size() - 1;
+        }
+
+        virtual void begin_face(const size_t vertex_count) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.push_back(Face());
+
+            Face& face = m_meshes.back().m_faces.back();
+            face.m_vertices.resize(vertex_count);
+            face.m_vertex_normals.resize(vertex_count);
+            face.m_tex_coords.resize(vertex_count);
+            face.m_material = NoIndex;
+        }
+
+        virtual void set_face_vertices(const size_t vertices[]) APPLESEED_OVERRIDE
+        {
+            Face& face = m_meshes.back().m_faces.back();
+            for (size_t i = 0; i < face.m_vertices.size(); ++i)
+                face.m_vertices[i] = static_cast<uint32>(vertices[i]);
+        }
+
+        virtual void set_face_vertex_normals(const size_t vertex_normals[]) APPLESEED_OVERRIDE
+        {
+            Face& face = m_meshes.back().m_faces.back();
+            for (size_t i = 0; i < face.m_vertex_normals.size(); ++i)
+                face.m_vertex_normals[i] = static_cast<uint32>(vertex_normals[i]);
+        }
+
+        virtual void set_face_vertex_tex_coords(const size_t tex_coords[]) APPLESEED_OVERRIDE
+        {
+            Face& face = m_meshes.back().m_faces.back();
+            for (size_t i = 0; i < face.m_tex_coords.size(); ++i)
+                face.m_tex_coords[i] = static_cast<uint32>(tex_coords[i]);
+        }
+
+        virtual void set_face_material(const size_t material) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.back().m_material = static_cast<uint32>(material);
+        }
+
+        virtual void end_face() APPLESEED_OVERRIDE
+        {
+        }
+
+        virtual void end_mesh() APPLESEED_OVERRIDE
+        {
+        }
+    };
+
+    struct MeshWalker
+      : public IMeshWalker
+    {
+        const Mesh& m_mesh;
+
+        explicit MeshWalker(const Mesh& mesh)
+          : m_mesh(mesh)
+        {
+        }
+
+        virtual const char* get_name() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_name.c_str();
+        }
+
+        virtual size_t get_vertex_count() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_vertices.size();
+        }
+
+        virtual Vector3d get_vertex(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_vertices[i];
+        }
+
+        virtual size_t get_vertex_normal_count() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_vertex_normals.size();
+        }
+
+        virtual Vector3d get_vertex_normal(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_vertex_normals[i];
+        }
+
+        virtual size_t get_tex_coords_count() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_tex_coords.size();
+        }
+
+        virtual Vector2d get_tex_coords(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_tex_coords[i];
+        }
+
+        virtual size_t get_material_slot_count() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_material_slots.size();
+        }
+
+        virtual const char* get_material_slot(const size_t i) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_material_slots[i].c_str();
+        }
+
+        virtual size_t get_face_count() const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces.size();
+        }
+
+        virtual size_t get_face_vertex_count(const size_t face_index) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces[face_index].m_vertices.size();
+        }
+
+        virtual size_t get_face_vertex(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces[face_index].m_vertices[vertex_index];
+        }
+
+        virtual size_t get_face_vertex_normal(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces[face_index].m_vertex_normals[vertex_index];
+        }
+
+        virtual size_t get_face_tex_coords(const size_t face_index, const size_t vertex_index) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces[face_index].m_tex_coords[vertex_index];
+        }
+
+        virtual size_t get_face_material(const size_t face_index) const APPLESEED_OVERRIDE
+        {
+            return m_mesh.m_faces[face_index].m_material;
+        }
+    };
+
+    Face make_face(
+        const uint32    v0,
+        const uint32    v1,
+        const uint32    v2,
+        const bool      with_attributes,
+        const uint32    material)
+    {
+        Face face;
+        face.m_vertices.push_back(v0);
+        face.m_vertices.push_back(v1);
+        face.m_vertices.push_back(v2);
+        face.m_vertex_normals.assign(3, with_attributes ? 0 : NoIndex);
+        face.m_tex_coords.push_back(with_attributes ? 0 : NoIndex);
+        face.m_tex_coords.push_back(with_attributes ? 1 : NoIndex);
+        face.m_tex_coords.push_back(with_attributes ? 2 : NoIndex);
+        face.m_material = material;
+        return face;
+    }
+
+    // A mesh made of a quad and a triangle, with normals, texture coordinates and materials.
+    Mesh create_polygon_mesh()
+    {
+        Mesh mesh;
+        mesh.m_name = "polygons";
+
+        mesh.m_vertices.push_back(Vector3d(0.0, 0.0, 0.0));
+        mesh.m_vertices.push_back(Vector3d(1.0, 0.0, 0.0));
+        mesh.m_vertices.push_back(Vector3d(1.0, 1.0, 0.0));
+        mesh.m_vertices.push_back(Vector3d(0.0, 1.0, 0.0));
+        mesh.m_vertices.push_back(Vector3d(0.5, 2.0, 0.25));
+        mesh.m_vertex_normals.push_back(Vector3d(0.0, 0.0, 1.0));
+        mesh.m_tex_coords.push_back(Vector2d(0.0, 0.0));
+        mesh.m_tex_coords.push_back(Vector2d(1.0, 0.0));
+        mesh.m_tex_coords.push_back(Vector2d(1.0, 1.0));
+        mesh.m_tex_coords.push_back(Vector2d(0.0, 1.0));
+        mesh.m_material_slots.push_back("front");
+        mesh.m_material_slots.push_back("back");
+
+        Face quad = make_face(0, 1, 2, true, 0);
+        quad.m_vertices.push_back(3);
+        quad.m_vertex_normals.push_back(0);
+        quad.m_tex_coords.push_back(3);
+        mesh.m_faces.push_back(quad);
+
+        mesh.m_faces.push_back(make_face(3, 2, 4, true, 1));
+
+        return mesh;
+    }
+
+    // A mesh made of triangles only, without attributes.
+    Mesh create_triangle_mesh()
+    {
+        Mesh mesh;
+        mesh.m_name = "triangles";
+
+        for (size_t i = 0; i < 200; ++i)
+            mesh.m_vertices.push_back(Vector3d(static_cast<double>(i), 0.5, -1.0));
+
+        for (uint32 i = 0; i + 2 < 200; ++i)
+            mesh.m_faces.push_back(make_face(i, i + 1, i + 2, false, 0));
+
+        return mesh;
+    }
+
+    vector<Mesh> write_and_read(
+        const string&                       filename,
+        const BinaryMeshFileWriter::Format  format,
+        const size_t                        thread_count = 1)
+    {
+        const Mesh polygon_mesh = create_polygon_mesh();
+        const Mesh triangle_mesh = create_triangle_mesh();
+
+        {
+            BinaryMeshFileWriter writer(filename, format);
+            writer.write(MeshWalker(polygon_mesh));
+            writer.write(MeshWalker(triangle_mesh));
+        }
+
+        MeshBuilder builder;
+        BinaryMeshFileReader reader(filename, thread_count);
+        reader.read(builder);
+
+        return builder.m_meshes;
+    }
+
+    TEST_CASE(Read_LZ4StreamFile_ReturnsWrittenMeshes)
+    {
+        const vector<Mesh> meshes =
+            write_and_read(
+                "unit tests/outputs/test_binarymeshfilereader_stream.binarymesh",
+                BinaryMeshFileWriter::LZ4Stream);
+
+        ASSERT_EQ(2, meshes.size());
+        EXPECT_TRUE(meshes[0] == create_polygon_mesh());
+        EXPECT_TRUE(meshes[1] == create_triangle_mesh());
+    }
+
+    TEST_CASE(Read_IndexedFile_ReturnsWrittenMeshes)
+    {
+        const vector<Mesh> meshes =
+            write_and_read(
+                "unit tests/outputs/test_binarymeshfilereader_indexed.binarymesh",
+                BinaryMeshFileWriter::Indexed);
+
+        ASSERT_EQ(2, meshes.size());
+        EXPECT_TRUE(meshes[0] == create_polygon_mesh());
+        EXPECT_TRUE(meshes[1] == create_triangle_mesh());
+    }
+
+    TEST_CASE(Read_IndexedLZ4FileWithMultipleThreads_ReturnsWrittenMeshes)
+    {
+        const vector<Mesh> meshes =
+            write_and_read(
+                "unit tests/outputs/test_binarymeshfilereader_indexedlz4.binarymesh",
+                BinaryMeshFileWriter::IndexedLZ4,
+                4);
+
+        ASSERT_EQ(2, meshes.size());
+        EXPECT_TRUE(meshes[0] == create_polygon_mesh());
+        EXPECT_TRUE(meshes[1] == create_triangle_mesh());
+    }
+
+    TEST_CASE(Open_IndexedFile_BlocksAreUsedInPlace)
+    {
+        const string Filename = "unit tests/outputs/test_binarymeshfilereader_mapped.binarymesh";
+
+        {
+            BinaryMeshFileWriter writer(Filename, BinaryMeshFileWriter::Indexed);
+            writer.write(MeshWalker(create_polygon_mesh()));
+            writer.write(MeshWalker(create_triangle_mesh()));
+        }
+
+        MappedBinaryMeshFile file;
+        file.open(Filename);
+
+        ASSERT_EQ(2, file.get_mesh_count());
+
+        const MappedBinaryMeshFile::Mesh& polygons = file.get_mesh(0);
+        EXPECT_EQ("polygons", string(polygons.m_name));
+        EXPECT_EQ(5, polygons.m_vertex_count);
+        EXPECT_EQ(0, reinterpret_cast<size_t>(polygons.m_vertices) % MappedBinaryMeshFile::BlockAlignment);
+        EXPECT_EQ(0.25f, polygons.m_vertices[4 * 3 + 2]);
+        EXPECT_EQ("back", string(polygons.m_material_slots[1]));
+        EXPECT_EQ(7, polygons.m_face_vertex_count);
+        ASSERT_NEQ(0, polygons.m_face_sizes);
+        EXPECT_EQ(4, polygons.m_face_sizes[0]);
+
+        const MappedBinaryMeshFile::Mesh& triangles = file.get_mesh(1);
+        EXPECT_EQ(0, triangles.m_face_sizes);
+        EXPECT_EQ(0, triangles.m_face_vertex_normals);
+        EXPECT_EQ(0, triangles.m_face_tex_coords);
+        EXPECT_EQ(0, reinterpret_cast<size_t>(triangles.m_face_vertices) % MappedBinaryMeshFile::BlockAlignment);
+        EXPECT_EQ(199, triangles.m_face_vertices[197 * 3 + 2]);
+    }
+
+    TEST_CASE(Open_TruncatedIndexedFile_ThrowsIOError)
+    {
+        const string Filename = "unit tests/outputs/test_binarymeshfilereader_truncated.binarymesh";
+
+        {
+            BinaryMeshFileWriter writer(Filename, BinaryMeshFileWriter::Indexed);
+            writer.write(MeshWalker(create_triangle_mesh()));
+        }
+
+        vector<char> contents;
+
+        {
+            ifstream input(Filename.c_str(), ios::binary);
+            contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+        }
+
+        {
+            ofstream output(Filename.c_str(), ios::binary);
+            output.write(&contents[0], contents.size() - 16);
+        }
+
+        MappedBinaryMeshFile file;
+
+        EXPECT_EXCEPTION(ExceptionIOError,
+        {
+            file.open(Filename);
+        });
+
+        EXPECT_FALSE(file.is_open());
+    }
+}
@@ -30,14 +30,21 @@
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
+#include "foundation/math/intersection/rayaabb.h"
 #include "foundation/math/ray.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/timers.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
+#include <limits>
 #include <vector>
 
 using namespace foundation;
@@ -119,6 +126,336 @@ TEST_SUITE(Foundation_Math_BVH_SpatialBuilder)
     }
 }
 
+TEST_SUITE(Foundation_Math_BVH_ParallelSpatialBuilder)
+{
+    typedef AlignedVector<bvh::Node<AABB3d> > NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    struct Tree
+      : public bvh::Tree<NodeVector>
+    {
+        const NodeVector& get_nodes() const
+        {
+            return m_nodes;
+        }
+    };
+
+    struct ItemHandler
+    {
+        const AABBVector& m_bboxes;
+
+        explicit ItemHandler(const AABBVector& bboxes)
+          : m_bboxes(bboxes)
+        {
+        }
+
+        double get_bbox_grow_eps() const
+        {
+            return 1.0e-9;
+        }
+
+        AABB3d clip(
+            const size_t    item_index,
+            const size_t    dimension,
+            const double    slab_min,
+            const double    slab_max) const
+        {
+            AABB3d bbox = m_bboxes[item_index];
+            bbox.min[dimension] = max(bbox.min[dimension], slab_min);
+            bbox.max[dimension] = min(bbox.max[dimension], slab_max);
+            return bbox;
+        }
+
+        bool intersect(
+            const size_t    item_index,
+            const AABB3d&   bbox) const
+        {
+            return AABB3d::overlap(m_bboxes[item_index], bbox);
+        }
+    };
+
+    typedef bvh::SBVHPartitioner<ItemHandler, AABBVector> Partitioner;
+
+    struct Fixture
+    {
+        AABBVector          m_bboxes;
+
+        Fixture()
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < 5000; ++i)
+            {
+                const Vector3d center(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+                const Vector3d extent(rand_double1(rng, 0.01, 1.0));
+                m_bboxes.push_back(AABB3d(center - extent, center + extent));
+            }
+        }
+
+        // Return the sorted list of the sorted item sets of all leaves.
+        static vector<vector<size_t> > collect_leaves(
+            const Tree&                 tree,
+            const Partitioner&          partitioner)
+        {
+            const vector<size_t>& ordering = partitioner.get_item_ordering();
+            vector<vector<size_t> > leaves;
+
+            for (size_t i = 0; i < tree.get_nodes().size(); ++i)
+            {
+                const bvh::Node<AABB3d>& node = tree.get_nodes()[i];
+
+                if (node.is_leaf())
+                {
+                    vector<size_t> items(
+                        ordering.begin() + node.get_item_index(),
+                        ordering.begin() + node.get_item_index() + node.get_item_count());
+                    sort(items.begin(), items.end());
+                    leaves.push_back(items);
+                }
+            }
+
+            sort(leaves.begin(), leaves.end());
+
+            return leaves;
+        }
+    };
+
+    TEST_CASE_F(Build_GivenFourThreads_ProducesSameTreeAsSpatialBuilder, Fixture)
+    {
+        ItemHandler item_handler(m_bboxes);
+
+        Tree sequential_tree;
+        Partitioner sequential_partitioner(item_handler, m_bboxes, 4, 32);
+        Partitioner::LeafType* sequential_root_leaf = sequential_partitioner.create_root_leaf();
+        bvh::SpatialBuilder<Tree, Partitioner> sequential_builder;
+        sequential_builder.build<DefaultWallclockTimer>(
+            sequential_tree,
+            sequential_partitioner,
+            sequential_root_leaf,
+            sequential_partitioner.compute_leaf_bbox(*sequential_root_leaf));
+
+        Tree parallel_tree;
+        Partitioner parallel_partitioner(item_handler, m_bboxes, 4, 32);
+        Partitioner::LeafType* parallel_root_leaf = parallel_partitioner.create_root_leaf();
+        Logger logger;
+        bvh::ParallelSpatialBuilder<Tree, Partitioner> parallel_builder(logger, 4);
+        parallel_builder.build<DefaultWallclockTimer>(
+            parallel_tree,
+            parallel_partitioner,
+            parallel_root_leaf,
+            parallel_partitioner.compute_leaf_bbox(*parallel_root_leaf));
+
+        EXPECT_LT(parallel_builder.get_subtree_count(), 1);
+        EXPECT_EQ(sequential_tree.get_nodes().size(), parallel_tree.get_nodes().size());
+        EXPECT_EQ(sequential_partitioner.get_object_split_count(), parallel_partitioner.get_object_split_count());
+        EXPECT_EQ(sequential_partitioner.get_spatial_split_count(), parallel_partitioner.get_spatial_split_count());
+        EXPECT_TRUE(
+            collect_leaves(sequential_tree, sequential_partitioner) ==
+            collect_leaves(parallel_tree, parallel_partitioner));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_TemporalBuilder)
+{
+    typedef AABB3d AABBType;
+    typedef bvh::Node<AABBType> NodeType;
+    typedef bvh::Tree<AlignedVector<NodeType> > TreeType;
+
+    // Boxes moving linearly over the shutter interval.
+    struct ItemHandler
+    {
+        vector<AABBType>    m_begin_bboxes;
+        vector<Vector3d>    m_motions;
+
+        size_t size() const
+        {
+            return m_begin_bboxes.size();
+        }
+
+        size_t get_motion_segment_count(const size_t item_index) const
+        {
+            return m_motions[item_index] == Vector3d(0.0) ? 0 : 1;
+        }
+
+        AABBType compute_bbox(const size_t item_index, const double time) const
+        {
+            const Vector3d offset = time * m_motions[item_index];
+            const AABBType& bbox = m_begin_bboxes[item_index];
+            return AABBType(bbox.min + offset, bbox.max + offset);
+        }
+    };
+
+    typedef bvh::TemporalBuilder<TreeType, ItemHandler> Builder;
+
+    struct Visitor
+    {
+        const ItemHandler&      m_handler;
+        const vector<size_t>&   m_ordering;
+        const double            m_time;
+        size_t                  m_hit_item;
+        double                  m_hit_distance;
+
+        Visitor(const ItemHandler& handler, const vector<size_t>& ordering, const double time)
+          : m_handler(handler)
+          , m_ordering(ordering)
+          , m_time(time)
+          , m_hit_item(~size_t(0))
+          , m_hit_distance(numeric_limits<double>::max())
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t item = m_ordering[node.get_item_index() + i];
+
+                double tmin;
+                if (intersect(ray, ray_info, m_handler.compute_bbox(item, m_time), tmin) && tmin < m_hit_distance)
+                {
+                    m_hit_item = item;
+                    m_hit_distance = tmin;
+                }
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    struct Fixture
+    {
+        ItemHandler         m_handler;
+        TreeType            m_tree;
+
+        void create_items(const double max_motion)
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < 500; ++i)
+            {
+                const Vector3d center(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+                const Vector3d extent(rand_double1(rng, 0.01, 0.5));
+                m_handler.m_begin_bboxes.push_back(AABBType(center - extent, center + extent));
+                m_handler.m_motions.push_back(
+                    Vector3d(
+                        rand_double1(rng, -max_motion, max_motion),
+                        rand_double1(rng, -max_motion, max_motion),
+                        rand_double1(rng, -max_motion, max_motion)));
+            }
+        }
+
+        // Count the rays for which the tree and a brute force search disagree on the closest item.
+        size_t count_mismatches(const vector<size_t>& ordering) const
+        {
+            MersenneTwister rng;
+            size_t mismatches = 0;
+
+            for (size_t r = 0; r < 1000; ++r)
+            {
+                const Vector3d org(
+                    rand_double1(rng, -20.0, 20.0),
+                    rand_double1(rng, -20.0, 20.0),
+                    rand_double1(rng, -20.0, 20.0));
+                const Vector3d target(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+                const Ray3d ray(org, normalize(target - org));
+                const RayInfo3d ray_info(ray);
+                const double time = rand_double2(rng);
+
+                Visitor visitor(m_handler, ordering, time);
+                bvh::Intersector<TreeType, Visitor, Ray3d> intersector;
+                intersector.intersect_motion(m_tree, ray, ray_info, time, visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_stats
+#endif
+                    );
+
+                size_t expected_item = ~size_t(0);
+                double expected_distance = numeric_limits<double>::max();
+                for (size_t i = 0; i < m_handler.size(); ++i)
+                {
+                    double tmin;
+                    if (intersect(ray, ray_info, m_handler.compute_bbox(i, time), tmin) && tmin < expected_distance)
+                    {
+                        expected_item = i;
+                        expected_distance = tmin;
+                    }
+                }
+
+                if (visitor.m_hit_item != expected_item)
+                    ++mismatches;
+            }
+
+            return mismatches;
+        }
+
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        mutable bvh::TraversalStatistics m_stats;
+#endif
+    };
+
+    TEST_CASE_F(Build_GivenStaticItems_PerformsNoTimeSplit, Fixture)
+    {
+        create_items(0.0);
+
+        Builder builder(2, 16, 2);
+        builder.build<DefaultWallclockTimer>(m_tree, m_handler);
+
+        EXPECT_EQ(0, builder.get_time_split_count());
+        EXPECT_EQ(m_handler.size(), builder.get_item_ordering().size());
+        EXPECT_EQ(0, count_mismatches(builder.get_item_ordering()));
+    }
+
+    TEST_CASE_F(Build_GivenLargeMotion_PerformsTimeSplits, Fixture)
+    {
+        create_items(10.0);
+
+        Builder builder(2, 16, 2);
+        builder.build<DefaultWallclockTimer>(m_tree, m_handler);
+
+        EXPECT_GT(0, builder.get_time_split_count());
+        EXPECT_GT(m_handler.size(), builder.get_item_ordering().size());
+    }
+
+    TEST_CASE_F(IntersectMotion_GivenTimeSplits_MatchesBruteForce, Fixture)
+    {
+        create_items(10.0);
+
+        Builder builder(2, 16, 2);
+        builder.build<DefaultWallclockTimer>(m_tree, m_handler);
+
+        EXPECT_EQ(0, count_mismatches(builder.get_item_ordering()));
+    }
+
+    TEST_CASE_F(IntersectMotion_GivenNoTimeSplitAllowed_MatchesBruteForce, Fixture)
+    {
+        create_items(10.0);
+
+        Builder builder(2, 16, 0);
+        builder.build<DefaultWallclockTimer>(m_tree, m_handler);
+
+        EXPECT_EQ(0, builder.get_time_split_count());
+        EXPECT_EQ(0, count_mismatches(builder.get_item_ordering()));
+    }
+}
+
 TEST_SUITE(Foundation_Math_BVH_Intersector_2D)
 {
     typedef bvh::Node<AABB2d> NodeType;
@@ -148,3 +485,424 @@ TEST_SUITE(Foundation_Math_BVH_Intersector_2D)
         > intersector;
     }
 }
+
+TEST_SUITE(Foundation_Math_BVH_WideNode)
+{
+    TEST_CASE(TestStorageAndRetrievalOfChildren)
+    {
+        static const AABB3d FirstBBox(Vector3d(1.0, 2.0, 3.0), Vector3d(4.0, 5.0, 6.0));
+        static const AABB3d SecondBBox(Vector3d(7.0, 8.0, 9.0), Vector3d(10.0, 11.0, 12.0));
+
+        bvh::WideNode<AABB3d, 4> node;
+
+        node.add_interior_child(FirstBBox, 12);
+        node.add_leaf_child(SecondBBox, 34);
+
+        ASSERT_EQ(2, node.get_child_count());
+        EXPECT_EQ(FirstBBox, node.get_child_bbox(0));
+        EXPECT_FALSE(node.is_leaf_child(0));
+        EXPECT_EQ(12, node.get_child_index(0));
+        EXPECT_EQ(SecondBBox, node.get_child_bbox(1));
+        EXPECT_TRUE(node.is_leaf_child(1));
+        EXPECT_EQ(34, node.get_child_index(1));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_WideIntersector)
+{
+    template <typename T, size_t Width>
+    struct Fixture
+    {
+        typedef AABB<T, 3> AABBType;
+        typedef Vector<T, 3> VectorType;
+        typedef Ray<T, 3> RayType;
+        typedef RayInfo<T, 3> RayInfoType;
+        typedef bvh::Node<AABBType> NodeType;
+        typedef bvh::WideTree<AlignedVector<NodeType>, Width> TreeType;
+        typedef vector<AABBType> AABBVector;
+
+        struct Visitor
+        {
+            const AABBVector&       m_bboxes;
+            const vector<size_t>&   m_ordering;
+            size_t                  m_hit_item;
+            T                       m_hit_distance;
+
+            Visitor(const AABBVector& bboxes, const vector<size_t>& ordering)
+              : m_bboxes(bboxes)
+              , m_ordering(ordering)
+              , m_hit_item(~size_t(0))
+              , m_hit_distance(numeric_limits<T>::max())
+            {
+            }
+
+            bool visit(
+                const NodeType&             node,
+                const RayType&              ray,
+                const RayInfoType&          ray_info,
+                T&                          distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , bvh::TraversalStatistics& stats
+#endif
+                )
+            {
+                for (size_t i = 0; i < node.get_item_count(); ++i)
+                {
+                    const size_t item = m_ordering[node.get_item_index() + i];
+
+                    T tmin;
+                    if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                    {
+                        m_hit_item = item;
+                        m_hit_distance = tmin;
+                    }
+                }
+
+                distance = m_hit_distance;
+                return true;
+            }
+        };
+
+        AABBVector          m_bboxes;
+        TreeType            m_tree;
+        vector<size_t>      m_ordering;
+
+        Fixture()
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < 500; ++i)
+            {
+                const VectorType center(
+                    static_cast<T>(rand_double1(rng, -10.0, 10.0)),
+                    static_cast<T>(rand_double1(rng, -10.0, 10.0)),
+                    static_cast<T>(rand_double1(rng, -10.0, 10.0)));
+                const VectorType extent(static_cast<T>(rand_double1(rng, 0.01, 0.5)));
+                m_bboxes.push_back(AABBType(center - extent, center + extent));
+            }
+
+            typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+            Partitioner partitioner(m_bboxes, 2);
+            bvh::Builder<TreeType, Partitioner> builder;
+            builder.template build<DefaultWallclockTimer>(m_tree, partitioner, m_bboxes.size(), 2);
+            m_ordering = partitioner.get_item_ordering();
+
+            bvh::WideBuilder<TreeType> wide_builder;
+            wide_builder.template build<DefaultWallclockTimer>(m_tree);
+        }
+
+        size_t count_mismatches() const
+        {
+            MersenneTwister rng;
+            size_t mismatches = 0;
+
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                const VectorType org(
+                    static_cast<T>(rand_double1(rng, -20.0, 20.0)),
+                    static_cast<T>(rand_double1(rng, -20.0, 20.0)),
+                    static_cast<T>(rand_double1(rng, -20.0, 20.0)));
+                const VectorType target(
+                    static_cast<T>(rand_double1(rng, -5.0, 5.0)),
+                    static_cast<T>(rand_double1(rng, -5.0, 5.0)),
+                    static_cast<T>(rand_double1(rng, -5.0, 5.0)));
+                const RayType ray(org, normalize(target - org));
+                const RayInfoType ray_info(ray);
+
+                Visitor binary_visitor(m_bboxes, m_ordering);
+                bvh::Intersector<TreeType, Visitor, RayType> binary_intersector;
+                binary_intersector.intersect_no_motion(m_tree, ray, ray_info, binary_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_stats
+#endif
+                    );
+
+                Visitor wide_visitor(m_bboxes, m_ordering);
+                bvh::WideIntersector<TreeType, Visitor, RayType> wide_intersector;
+                wide_intersector.intersect_no_motion(m_tree, ray, ray_info, wide_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_stats
+#endif
+                    );
+
+                if (binary_visitor.m_hit_item != wide_visitor.m_hit_item)
+                    ++mismatches;
+            }
+
+            return mismatches;
+        }
+
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        mutable bvh::TraversalStatistics m_stats;
+#endif
+    };
+
+    // We need these typedefs because we can't use commas in macro parameters.
+    typedef Fixture<double, 4> FixtureDouble4;
+    typedef Fixture<float, 4> FixtureFloat4;
+    typedef Fixture<float, 8> FixtureFloat8;
+
+    TEST_CASE_F(WideBuilder_CollapsesBinaryTree, FixtureDouble4)
+    {
+        EXPECT_TRUE(m_tree.has_wide_nodes());
+        EXPECT_LT(m_bboxes.size() / 2, m_tree.get_wide_node_count());
+    }
+
+    TEST_CASE_F(IntersectNoMotion_DoublePrecision4Wide_MatchesBinaryTraversal, FixtureDouble4)
+    {
+        EXPECT_EQ(0, count_mismatches());
+    }
+
+    TEST_CASE_F(IntersectNoMotion_SinglePrecision4Wide_MatchesBinaryTraversal, FixtureFloat4)
+    {
+        EXPECT_EQ(0, count_mismatches());
+    }
+
+    TEST_CASE_F(IntersectNoMotion_SinglePrecision8Wide_MatchesBinaryTraversal, FixtureFloat8)
+    {
+        EXPECT_EQ(0, count_mismatches());
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_PacketIntersector)
+{
+    typedef AABB3d AABBType;
+    typedef bvh::Node<AABBType> NodeType;
+    typedef bvh::Tree<AlignedVector<NodeType> > TreeType;
+    typedef vector<AABBType> AABBVector;
+
+    const size_t PacketSize = 8;
+
+    struct Visitor
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+        size_t                  m_hit_item;
+        double                  m_hit_distance;
+
+        Visitor(const AABBVector& bboxes, const vector<size_t>& ordering)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_hit_item(~size_t(0))
+          , m_hit_distance(numeric_limits<double>::max())
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t item = m_ordering[node.get_item_index() + i];
+
+                double tmin;
+                if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                {
+                    m_hit_item = item;
+                    m_hit_distance = tmin;
+                }
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    struct PacketVisitor
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+        const bool              m_stop_at_first_hit;
+        size_t                  m_hit_items[PacketSize];
+        double                  m_hit_distances[PacketSize];
+
+        PacketVisitor(
+            const AABBVector&       bboxes,
+            const vector<size_t>&   ordering,
+            const bool              stop_at_first_hit)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_stop_at_first_hit(stop_at_first_hit)
+        {
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                m_hit_items[i] = ~size_t(0);
+                m_hit_distances[i] = numeric_limits<double>::max();
+            }
+        }
+
+        size_t visit(
+            const NodeType&             node,
+            const Ray3d                 rays[],
+            const RayInfo3d             ray_infos[],
+            const size_t                active_mask,
+            double                      distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            size_t proceed_mask = active_mask;
+
+            for (size_t r = 0; r < PacketSize; ++r)
+            {
+                if (!(active_mask & (size_t(1) << r)))
+                    continue;
+
+                for (size_t i = 0; i < node.get_item_count(); ++i)
+                {
+                    const size_t item = m_ordering[node.get_item_index() + i];
+
+                    double tmin;
+                    if (intersect(rays[r], ray_infos[r], m_bboxes[item], tmin) && tmin < m_hit_distances[r])
+                    {
+                        m_hit_items[r] = item;
+                        m_hit_distances[r] = tmin;
+                    }
+                }
+
+                distances[r] = m_hit_distances[r];
+
+                if (m_stop_at_first_hit && m_hit_items[r] != ~size_t(0))
+                    proceed_mask &= ~(size_t(1) << r);
+            }
+
+            return proceed_mask;
+        }
+    };
+
+    struct Fixture
+    {
+        AABBVector          m_bboxes;
+        TreeType            m_tree;
+        vector<size_t>      m_ordering;
+
+        Fixture()
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < 500; ++i)
+            {
+                const Vector3d center(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+                const Vector3d extent(rand_double1(rng, 0.01, 0.5));
+                m_bboxes.push_back(AABBType(center - extent, center + extent));
+            }
+
+            typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+            Partitioner partitioner(m_bboxes, 2);
+            bvh::Builder<TreeType, Partitioner> builder;
+            builder.build<DefaultWallclockTimer>(m_tree, partitioner, m_bboxes.size(), 2);
+            m_ordering = partitioner.get_item_ordering();
+        }
+
+        // Generate a packet of coherent rays.
+        static void make_packet(MersenneTwister& rng, Ray3d rays[], RayInfo3d ray_infos[])
+        {
+            const Vector3d org(
+                rand_double1(rng, -20.0, 20.0),
+                rand_double1(rng, -20.0, 20.0),
+                rand_double1(rng, -20.0, 20.0));
+            const Vector3d target(
+                rand_double1(rng, -5.0, 5.0),
+                rand_double1(rng, -5.0, 5.0),
+                rand_double1(rng, -5.0, 5.0));
+
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                const Vector3d jitter(
+                    rand_double1(rng, -1.0, 1.0),
+                    rand_double1(rng, -1.0, 1.0),
+                    rand_double1(rng, -1.0, 1.0));
+                rays[i] = Ray3d(org, normalize(target + jitter - org));
+                ray_infos[i] = RayInfo3d(rays[i]);
+            }
+        }
+
+        size_t count_mismatches(const size_t active_mask, const bool stop_at_first_hit) const
+        {
+            MersenneTwister rng;
+            size_t mismatches = 0;
+
+            for (size_t p = 0; p < 200; ++p)
+            {
+                Ray3d rays[PacketSize];
+                RayInfo3d ray_infos[PacketSize];
+                make_packet(rng, rays, ray_infos);
+
+                PacketVisitor packet_visitor(m_bboxes, m_ordering, stop_at_first_hit);
+                bvh::PacketIntersector<TreeType, PacketVisitor, Ray3d, PacketSize> packet_intersector;
+                packet_intersector.intersect_no_motion(m_tree, rays, ray_infos, active_mask, packet_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_stats
+#endif
+                    );
+
+                for (size_t i = 0; i < PacketSize; ++i)
+                {
+                    if (!(active_mask & (size_t(1) << i)))
+                    {
+                        if (packet_visitor.m_hit_items[i] != ~size_t(0))
+                            ++mismatches;
+                        continue;
+                    }
+
+                    Visitor visitor(m_bboxes, m_ordering);
+                    bvh::Intersector<TreeType, Visitor, Ray3d> intersector;
+                    intersector.intersect_no_motion(m_tree, rays[i], ray_infos[i], visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                        , m_stats
+#endif
+                        );
+
+                    const bool match =
+                        stop_at_first_hit
+                            ? (visitor.m_hit_item == ~size_t(0)) == (packet_visitor.m_hit_items[i] == ~size_t(0))
+                            : visitor.m_hit_item == packet_visitor.m_hit_items[i];
+
+                    if (!match)
+                        ++mismatches;
+                }
+            }
+
+            return mismatches;
+        }
+
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        mutable bvh::TraversalStatistics m_stats;
+#endif
+    };
+
+    TEST_CASE(MakeMask_ReturnsMaskOfFirstRays)
+    {
+        typedef bvh::PacketIntersector<TreeType, PacketVisitor, Ray3d, PacketSize> PacketIntersectorType;
+
+        EXPECT_EQ(0, PacketIntersectorType::make_mask(0));
+        EXPECT_EQ(0x7, PacketIntersectorType::make_mask(3));
+        EXPECT_EQ(0xFF, PacketIntersectorType::make_mask(8));
+    }
+
+    TEST_CASE_F(IntersectNoMotion_GivenFullPacket_MatchesSingleRayTraversal, Fixture)
+    {
+        EXPECT_EQ(0, count_mismatches(0xFF, false));
+    }
+
+    TEST_CASE_F(IntersectNoMotion_GivenPartialPacket_IgnoresInactiveRays, Fixture)
+    {
+        EXPECT_EQ(0, count_mismatches(0x5A, false));
+    }
+
+    TEST_CASE_F(IntersectNoMotion_GivenVisitorTerminatingRays_MatchesSingleRayHits, Fixture)
+    {
+        EXPECT_EQ(0, count_mismatches(0xFF, true));
+    }
+}
@@ -189,6 +189,37 @@ TEST_SUITE(Foundation_Utility_Cache_LRUCache)
         cache.get(9);   // flushes 6, cache contains 9
         ASSERT_EQ(9000, element_swapper.m_memory_size);
     }
+
+    struct IsOddKey
+    {
+        bool operator()(const Key key, const Element element) const
+        {
+            return key % 2 == 1;
+        }
+    };
+
+    TEST_CASE(RemoveIf_UnloadsAndRemovesMatchingElements)
+    {
+        KeyHasher key_hasher;
+        ElementSwapperTrackingSize element_swapper;
+        LRUCache<Key, KeyHasher, Element, ElementSwapperTrackingSize> cache(key_hasher, element_swapper);
+
+        cache.get(1);
+        cache.get(2);
+        cache.get(3);
+
+        cache.remove_if(IsOddKey());
+
+        EXPECT_EQ(2000, element_swapper.m_memory_size);
+        EXPECT_EQ(3, cache.get_miss_count());
+
+        cache.get(2);   // still in the cache
+        EXPECT_EQ(1, cache.get_hit_count());
+
+        cache.get(3);   // reloaded
+        EXPECT_EQ(4, cache.get_miss_count());
+        EXPECT_EQ(5000, element_swapper.m_memory_size);
+    }
 }
 
 TEST_SUITE(Foundation_Utility_Cache_DualStageCache)
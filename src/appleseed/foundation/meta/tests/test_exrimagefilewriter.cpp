@@ -28,11 +28,14 @@
 //
 
 // appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
 #include "foundation/image/color.h"
 #include "foundation/image/exrimagefilewriter.h"
 #include "foundation/image/genericprogressiveimagefilereader.h"
+#include "foundation/image/icanvas.h"
 #include "foundation/image/image.h"
 #include "foundation/image/pixel.h"
+#include "foundation/image/progressiveexrimagefilewriter.h"
 #include "foundation/image/tile.h"
 #include "foundation/utility/iostreamop.h"
 #include "foundation/utility/test.h"
@@ -73,4 +76,65 @@ TEST_SUITE(Foundation_Image_EXRImageFileWriter)
             EXPECT_EQ(Reference, c);
         }
     }
+
+    TEST_CASE(CorrectlyWriteMultipleLayers)
+    {
+        static const char* LayerFilename = "unit tests/outputs/test_exrimagefilewriter_layers.exr";
+
+        // Use a canvas that is not a multiple of the tile size.
+        Image main_image(40, 40, 32, 32, 4, PixelFormatFloat);
+        main_image.clear(Reference);
+
+        Image aov_image(40, 40, 32, 32, 3, PixelFormatHalf);
+        aov_image.clear(Color3f(0.5f));
+
+        const char* layer_names[] = { "", "diffuse" };
+        const ICanvas* layers[] = { &main_image, &aov_image };
+
+        EXRImageFileWriter writer;
+        writer.write(LayerFilename, 2, layer_names, layers);
+
+        GenericProgressiveImageFileReader reader;
+        reader.open(LayerFilename);
+
+        CanvasProperties props;
+        reader.read_canvas_properties(props);
+        EXPECT_EQ(40, props.m_canvas_width);
+        EXPECT_EQ(40, props.m_canvas_height);
+        EXPECT_EQ(7, props.m_channel_count);
+    }
+
+    TEST_CASE(ProgressiveWriter_CorrectlyWritesTilesInAnyOrder)
+    {
+        static const char* ProgressiveFilename = "unit tests/outputs/test_exrimagefilewriter_progressive.exr";
+
+        Image image(64, 64, 32, 32, 4, PixelFormatFloat);
+        image.clear(Reference);
+
+        const char* layer_name = "";
+        const CanvasProperties& props = image.properties();
+
+        ProgressiveEXRImageFileWriter writer;
+        writer.open(ProgressiveFilename, 1, &layer_name, &props);
+
+        for (size_t i = props.m_tile_count; i > 0; --i)
+        {
+            const size_t tile_x = (i - 1) % props.m_tile_count_x;
+            const size_t tile_y = (i - 1) / props.m_tile_count_x;
+            const Tile* tile = &image.tile(tile_x, tile_y);
+            writer.write_tile(tile_x, tile_y, &tile);
+        }
+
+        EXPECT_EQ(props.m_tile_count, writer.get_written_tile_count());
+
+        writer.close();
+
+        GenericProgressiveImageFileReader reader;
+        reader.open(ProgressiveFilename);
+        auto_ptr<Tile> tile(reader.read_tile(1, 1));
+
+        Color4b c;
+        tile->get_pixel(0, c);
+        EXPECT_EQ(Reference, c);
+    }
 }
@@ -30,10 +30,18 @@
 // appleseed.foundation headers.
 #include "foundation/math/intersection/raytrianglemt.h"
 #include "foundation/math/intersection/raytrianglessk.h"
+#include "foundation/math/intersection/raytrianglewt.h"
 #include "foundation/math/ray.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/test.h"
 
+// Standard headers.
+#include <cstddef>
+
 using namespace foundation;
 
 namespace
@@ -166,3 +174,189 @@ TEST_SUITE(Foundation_Math_Intersection_RayTriangleSSK)
         EXPECT_FEQ(0.5, v);
     }
 }
+
+TEST_SUITE(Foundation_Math_Intersection_RayTriangleWT)
+{
+    typedef RayTriangleFixture<TriangleWT<double> > Fixture;
+
+    TEST_CASE_F(Intersect_GivenRayWithTMinEqualToHitDistance_ReturnsTrue, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 1.0, 10.0);
+
+        const bool hit = m_triangle.intersect(ray);
+
+        ASSERT_TRUE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMaxEqualToHitDistance_ReturnsFalse, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 0.0, 1.0);
+
+        const bool hit = m_triangle.intersect(ray);
+
+        ASSERT_FALSE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMinEqualToHitDistance_ReturnsHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 1.0, 10.0);
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_TRUE(hit);
+        EXPECT_FEQ(1.0, t);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMaxEqualToHitDistance_ReturnsNoHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 0.0, 1.0);
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_FALSE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayHittingDiagonalOfQuad_ReturnsHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(0.0, 1.0, 0.0), Vector3d(0.0, -1.0, 0.0));
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_TRUE(hit);
+        EXPECT_FEQ(1.0, t);
+        EXPECT_FEQ(0.0, u);
+        EXPECT_FEQ(0.5, v);
+    }
+
+    TEST_CASE(Intersect_GivenRaysHittingSharedEdge_ReportsAtLeastOneHit)
+    {
+        const TriangleWT<float> triangle1(
+            Vector3f(0.1f, 0.0f, 0.3f),
+            Vector3f(-0.7f, 0.0f, 0.9f),
+            Vector3f(0.3f, 0.0f, -0.7f));
+        const TriangleWT<float> triangle2(
+            Vector3f(0.3f, 0.0f, -0.7f),
+            Vector3f(-0.7f, 0.0f, 0.9f),
+            Vector3f(-0.9f, 0.0f, -0.5f));
+
+        MersenneTwister rng;
+        size_t miss_count = 0;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            // Pick a point on the shared edge.
+            const float s = rand_float1(rng);
+            const Vector3f target = (1.0f - s) * Vector3f(-0.7f, 0.0f, 0.9f) + s * Vector3f(0.3f, 0.0f, -0.7f);
+            const Vector3f org(rand_float1(rng, -1.0f, 1.0f), 1.0f, rand_float1(rng, -1.0f, 1.0f));
+            const Ray3f ray(org, target - org);
+
+            if (!triangle1.intersect(ray) && !triangle2.intersect(ray))
+                ++miss_count;
+        }
+
+        EXPECT_EQ(0, miss_count);
+    }
+}
+
+namespace
+{
+    // Return the number of packet intersection results that differ from single triangle tests.
+    template <size_t N>
+    size_t count_packet_mismatches()
+    {
+        MersenneTwister rng;
+        size_t mismatch_count = 0;
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            TriangleWT<float> triangles[N];
+            TriangleWTPacket<N> packet;
+
+            for (size_t j = 0; j < N; ++j)
+            {
+                Vector3f v[3];
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    v[k] =
+                        Vector3f(
+                            rand_float1(rng, -1.0f, 1.0f),
+                            rand_float1(rng, -1.0f, 1.0f),
+                            rand_float1(rng, -1.0f, 1.0f));
+                }
+
+                triangles[j] = TriangleWT<float>(v[0], v[1], v[2]);
+                packet.set(j, v[0], v[1], v[2]);
+            }
+
+            const Vector3f org(
+                rand_float1(rng, -2.0f, 2.0f),
+                rand_float1(rng, -2.0f, 2.0f),
+                rand_float1(rng, -2.0f, 2.0f));
+            const Vector3f target(
+                rand_float1(rng, -0.5f, 0.5f),
+                rand_float1(rng, -0.5f, 0.5f),
+                rand_float1(rng, -0.5f, 0.5f));
+            const Ray3f ray(org, target - org);
+            const TriangleWTRayInfo<float> ray_info(ray);
+
+            float t[N], u[N], v[N];
+            const uint32 hits = packet.intersect(ray, ray_info, t, u, v);
+
+            for (size_t j = 0; j < N; ++j)
+            {
+                float expected_t, expected_u, expected_v;
+                const bool expected_hit = triangles[j].intersect(ray, ray_info, expected_t, expected_u, expected_v);
+
+                const bool hit = (hits & (uint32(1) << j)) != 0;
+
+                if (hit != expected_hit)
+                    ++mismatch_count;
+                else if (hit &&
+                         (!feq(expected_t, t[j], 1.0e-4f) ||
+                          !feq(expected_u, u[j], 1.0e-4f) ||
+                          !feq(expected_v, v[j], 1.0e-4f)))
+                    ++mismatch_count;
+            }
+        }
+
+        return mismatch_count;
+    }
+}
+
+TEST_SUITE(Foundation_Math_Intersection_RayTriangleWTPacket)
+{
+    TEST_CASE(Intersect_GivenEmptySlot_ReturnsNoHit)
+    {
+        TriangleWTPacket<4> packet;
+        packet.set(0, Vector3f(0.5f, 0.0f, 0.5f), Vector3f(-0.5f, 0.0f, 0.5f), Vector3f(-0.5f, 0.0f, -0.5f));
+        packet.clear(1);
+        packet.clear(2);
+        packet.clear(3);
+
+        const Ray3f ray(Vector3f(-0.2f, 1.0f, 0.2f), Vector3f(0.0f, -1.0f, 0.0f));
+
+        float t[4], u[4], v[4];
+        const uint32 hits = packet.intersect(ray, TriangleWTRayInfo<float>(ray), t, u, v);
+
+        ASSERT_EQ(1, hits);
+        EXPECT_FEQ(1.0f, t[0]);
+    }
+
+    TEST_CASE(Intersect_Width3_MatchesSingleTriangleTests)
+    {
+        EXPECT_EQ(0, count_packet_mismatches<3>());
+    }
+
+    TEST_CASE(Intersect_Width4_MatchesSingleTriangleTests)
+    {
+        EXPECT_EQ(0, count_packet_mismatches<4>());
+    }
+
+    TEST_CASE(Intersect_Width8_MatchesSingleTriangleTests)
+    {
+        EXPECT_EQ(0, count_packet_mismatches<8>());
+    }
+}
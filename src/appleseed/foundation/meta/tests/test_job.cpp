@@ -374,6 +374,77 @@ TEST_SUITE(Foundation_Utility_Job_JobManager)
 
         EXPECT_EQ(1, execution_count);
     }
+
+    TEST_CASE_F(JobManagerExecutesJobsScheduledWithAffinity, FixtureJobManager)
+    {
+        volatile uint32 execution_count = 0;
+
+        for (size_t i = 0; i < 8; ++i)
+        {
+            job_queue.schedule(
+                new JobNotifyingAboutExecution(&execution_count),
+                true,
+                i);
+        }
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(8, execution_count);
+    }
+
+    class JobSplittingIntoSubJobs
+      : public IJob
+    {
+      public:
+        JobSplittingIntoSubJobs(
+            JobQueue&           job_queue,
+            const size_t        depth,
+            volatile uint32*    execution_count)
+          : m_job_queue(job_queue)
+          , m_depth(depth)
+          , m_execution_count(execution_count)
+        {
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            atomic_inc(m_execution_count);
+
+            if (m_depth > 0)
+            {
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    m_job_queue.schedule(
+                        new JobSplittingIntoSubJobs(m_job_queue, m_depth - 1, m_execution_count),
+                        true,
+                        thread_index);
+                }
+            }
+        }
+
+      private:
+        JobQueue&           m_job_queue;
+        const size_t        m_depth;
+        volatile uint32*    m_execution_count;
+    };
+
+    TEST_CASE(JobManagerExecutesSubJobsScheduledOnWorkerQueues)
+    {
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 4);
+        volatile uint32 execution_count = 0;
+
+        job_queue.schedule(
+            new JobSplittingIntoSubJobs(job_queue, 8, &execution_count));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(511, execution_count);
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+    }
 }
 
 TEST_SUITE(Foundation_Utility_Job_WorkerThread)
@@ -37,6 +37,9 @@
 #include "foundation/math/vector.h"
 #include "foundation/platform/timers.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
@@ -143,6 +146,87 @@ TEST_SUITE(Foundation_Math_Knn_Builder)
     }
 }
 
+TEST_SUITE(Foundation_Math_Knn_ParallelBuilder)
+{
+    struct Fixture
+    {
+        Logger      m_logger;
+        JobQueue    m_job_queue;
+        JobManager  m_job_manager;
+
+        Fixture()
+          : m_job_manager(m_logger, m_job_queue, 4, JobManager::KeepRunningOnEmptyQueue)
+        {
+            m_job_manager.start();
+        }
+    };
+
+    TEST_CASE_F(Build_GivenZeroPoint_BuildsEmptyTree, Fixture)
+    {
+        knn::Tree3d tree;
+
+        knn::ParallelBuilder3d builder(tree, m_job_queue);
+        builder.build<DefaultWallclockTimer>(0, 0);
+
+        EXPECT_TRUE(tree.empty());
+    }
+
+    TEST_CASE_F(Build_GivenManyPoints_ReturnsSameQueryResultsAsSequentialBuilder, Fixture)
+    {
+        const size_t PointCount = 100000;
+        const size_t QueryCount = 200;
+        const size_t AnswerSize = 20;
+
+        MersenneTwister rng;
+
+        vector<Vector3d> points(PointCount);
+        for (size_t i = 0; i < PointCount; ++i)
+            points[i] = rand_vector1<Vector3d>(rng);
+
+        knn::Tree3d ref_tree;
+        knn::Builder3d ref_builder(ref_tree);
+        ref_builder.build<DefaultWallclockTimer>(&points[0], PointCount);
+
+        knn::Tree3d tree;
+        knn::ParallelBuilder3d builder(tree, m_job_queue);
+        builder.build<DefaultWallclockTimer>(&points[0], PointCount);
+
+        EXPECT_GT(1, builder.get_subtree_count());
+
+        knn::Answer<double> ref_answer(AnswerSize);
+        knn::Query3d ref_query(ref_tree, ref_answer);
+
+        knn::Answer<double> answer(AnswerSize);
+        knn::Query3d query(tree, answer);
+
+        bool match = true;
+
+        for (size_t i = 0; i < QueryCount; ++i)
+        {
+            const Vector3d q = rand_vector1<Vector3d>(rng);
+
+            ref_query.run(q);
+            ref_answer.sort();
+
+            query.run(q);
+            answer.sort();
+
+            if (answer.size() != ref_answer.size())
+                match = false;
+            else
+            {
+                for (size_t j = 0; j < answer.size(); ++j)
+                {
+                    if (tree.remap(answer.get(j).m_index) != ref_tree.remap(ref_answer.get(j).m_index))
+                        match = false;
+                }
+            }
+        }
+
+        EXPECT_TRUE(match);
+    }
+}
+
 TEST_SUITE(Foundation_Math_Knn_Answer)
 {
     TEST_CASE(Size_AfterZeroInsertion_ReturnsZero)
@@ -443,4 +527,59 @@ TEST_SUITE(Foundation_Math_Knn_Query)
 
         EXPECT_TRUE(do_results_match_naive_algorithm(points, AnswerSize, QueryCount, rng));
     }
+
+    struct RecordNearestNeighbor
+    {
+        const knn::Tree3d&          m_tree;
+        vector<size_t>&             m_nearest;
+
+        RecordNearestNeighbor(
+            const knn::Tree3d&      tree,
+            vector<size_t>&         nearest)
+          : m_tree(tree)
+          , m_nearest(nearest)
+        {
+        }
+
+        void operator()(const size_t query_index, knn::Answer<double>& answer) const
+        {
+            answer.sort();
+            m_nearest[query_index] = m_tree.remap(answer.get(0).m_index);
+        }
+    };
+
+    TEST_CASE(RunBatch_ReturnsSameResultsAsIndividualQueries)
+    {
+        const size_t PointCount = 1000;
+        const size_t QueryCount = 200;
+        const size_t AnswerSize = 5;
+
+        MersenneTwister rng;
+
+        vector<Vector3d> points;
+        generate_random_points(rng, points, PointCount);
+
+        knn::Tree3d tree;
+        knn::Builder3d builder(tree);
+        builder.build<DefaultWallclockTimer>(&points[0], PointCount);
+
+        vector<Vector3d> query_points(QueryCount);
+        for (size_t i = 0; i < QueryCount; ++i)
+            query_points[i] = rand_vector1<Vector3d>(rng);
+
+        knn::Answer<double> answer(AnswerSize);
+        knn::Query3d query(tree, answer);
+
+        vector<size_t> nearest(QueryCount, ~size_t(0));
+        RecordNearestNeighbor visitor(tree, nearest);
+        query.run_batch(&query_points[0], QueryCount, visitor);
+
+        for (size_t i = 0; i < QueryCount; ++i)
+        {
+            query.run(query_points[i]);
+            answer.sort();
+
+            EXPECT_EQ(tree.remap(answer.get(0).m_index), nearest[i]);
+        }
+    }
 }
@@ -36,6 +36,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -44,7 +45,22 @@ using namespace std;
 
 TEST_SUITE(Foundation_Mesh_OBJMeshFileReader)
 {
-    struct Face {};
+    struct Face
+    {
+        vector<size_t>      m_vertices;
+        vector<size_t>      m_vertex_normals;
+        vector<size_t>      m_tex_coords;
+        size_t              m_material;
+
+        bool operator==(const Face& rhs) const
+        {
+            return
+                m_vertices == rhs.m_vertices &&
+                m_vertex_normals == rhs.m_vertex_normals &&
+                m_tex_coords == rhs.m_tex_coords &&
+                m_material == rhs.m_material;
+        }
+    };
 
     struct Mesh
     {
@@ -52,7 +68,19 @@ TEST_SUITE(Foundation_Mesh_OBJMeshFileReader)
         vector<Vector3d>    m_vertices;
         vector<Vector3d>    m_vertex_normals;
         vector<Vector2d>    m_tex_coords;
+        vector<string>      m_material_slots;
         vector<Face>        m_faces;
+
+        bool operator==(const Mesh& rhs) const
+        {
+            return
+                m_name == rhs.m_name &&
+                m_vertices == rhs.m_vertices &&
+                m_vertex_normals == rhs.m_vertex_normals &&
+                m_tex_coords == rhs.m_tex_coords &&
+                m_material_slots == rhs.m_material_slots &&
+                m_faces == rhs.m_faces;
+        }
     };
 
     struct MeshBuilder
@@ -84,10 +112,40 @@ TEST_SUITE(Foundation_Mesh_OBJMeshFileReader)
             return m_meshes.back().m_tex_coords.size() - 1;
         }
 
+        virtual size_t push_material_slot(const char* name) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_material_slots.push_back(name);
+            return m_meshes.back().m_material_slots.size() - 1;
+        }
+
         virtual void begin_face(const size_t vertex_count) APPLESEED_OVERRIDE
         {
             m_meshes.back().m_faces.push_back(Face());
+            m_vertex_count = vertex_count;
+        }
+
+        virtual void set_face_vertices(const size_t vertices[]) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.back().m_vertices.assign(vertices, vertices + m_vertex_count);
+        }
+
+        virtual void set_face_vertex_normals(const size_t vertex_normals[]) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.back().m_vertex_normals.assign(vertex_normals, vertex_normals + m_vertex_count);
+        }
+
+        virtual void set_face_vertex_tex_coords(const size_t tex_coords[]) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.back().m_tex_coords.assign(tex_coords, tex_coords + m_vertex_count);
+        }
+
+        virtual void set_face_material(const size_t material) APPLESEED_OVERRIDE
+        {
+            m_meshes.back().m_faces.back().m_material = material;
         }
+
+      private:
+        size_t              m_vertex_count;
     };
 
     TEST_CASE(ReadCubeMeshFile)
@@ -121,4 +179,111 @@ TEST_SUITE(Foundation_Mesh_OBJMeshFileReader)
         EXPECT_EQ(4, mesh.m_tex_coords.size());
         EXPECT_EQ(1, mesh.m_faces.size());
     }
+
+    // Write a mesh file of a few megabytes with several objects, several materials and negative indices.
+    void write_large_mesh_file(const char* filename)
+    {
+        const size_t GridSize = 100;
+        const size_t VertexCount = (GridSize + 1) * (GridSize + 1);
+
+        ofstream file(filename);
+
+        for (size_t m = 0; m < 3; ++m)
+        {
+            file << "o object" << m << "\n";
+
+            for (size_t y = 0; y <= GridSize; ++y)
+            {
+                for (size_t x = 0; x <= GridSize; ++x)
+                {
+                    file << "v " << x << " " << y << " " << m << "\n";
+                    file << "vt " << x * 0.01 << " " << y * 0.01 << "\n";
+                    file << "vn 0 " << m << " 1\n";
+                }
+            }
+
+            for (size_t y = 0; y < GridSize; ++y)
+            {
+                file << "usemtl material" << y % 2 << "\n";
+
+                for (size_t x = 0; x < GridSize; ++x)
+                {
+                    const size_t base = m * VertexCount;
+                    const size_t i0 = base + y * (GridSize + 1) + x + 1;
+                    const size_t i1 = i0 + 1;
+                    const size_t i2 = i0 + GridSize + 1;
+                    const size_t i3 = i2 + 1;
+
+                    if (m == 1)
+                    {
+                        // Relative indices.
+                        const long end = static_cast<long>(base + VertexCount) + 1;
+                        file << "f "
+                             << static_cast<long>(i0) - end << "/" << static_cast<long>(i0) - end << "/" << static_cast<long>(i0) - end << " "
+                             << static_cast<long>(i1) - end << "/" << static_cast<long>(i1) - end << "/" << static_cast<long>(i1) - end << " "
+                             << static_cast<long>(i3) - end << "/" << static_cast<long>(i3) - end << "/" << static_cast<long>(i3) - end << "\n";
+                    }
+                    else
+                    {
+                        file << "f " << i0 << "/" << i0 << "/" << i0 << " "
+                                     << i1 << "/" << i1 << "/" << i1 << " "
+                                     << i3 << "/" << i3 << "/" << i3 << "\n";
+                    }
+
+                    file << "f " << i0 << "//" << i0 << " " << i3 << "//" << i3 << " " << i2 << "//" << i2 << "\n";
+                }
+            }
+        }
+    }
+
+    TEST_CASE(Read_LargeMeshFileWithMultipleThreads_MatchesSingleThreadedRead)
+    {
+        const char* Filename = "unit tests/outputs/test_objmeshfilereader_large.obj";
+        write_large_mesh_file(Filename);
+
+        MeshBuilder expected;
+        OBJMeshFileReader(Filename, OBJMeshFileReader::Default, 1).read(expected);
+
+        MeshBuilder builder;
+        OBJMeshFileReader(Filename, OBJMeshFileReader::Default, 4).read(builder);
+
+        ASSERT_EQ(3, expected.m_meshes.size());
+        EXPECT_EQ(2 * 100 * 100, expected.m_meshes[1].m_faces.size());
+        EXPECT_EQ(2, expected.m_meshes[1].m_material_slots.size());
+        EXPECT_TRUE(expected.m_meshes == builder.m_meshes);
+    }
+
+    TEST_CASE(Read_ParseErrorWithMultipleThreads_ReportsLineNumber)
+    {
+        const char* Filename = "unit tests/outputs/test_objmeshfilereader_parseerror.obj";
+        write_large_mesh_file(Filename);
+
+        {
+            ofstream file(Filename, ios_base::app);
+            file << "f 1 2 3\n";
+            file << "f 1 2 x\n";
+        }
+
+        size_t line_count = 0;
+        {
+            ifstream file(Filename);
+            string line;
+            while (getline(file, line))
+                ++line_count;
+        }
+
+        size_t error_line = 0;
+
+        try
+        {
+            MeshBuilder builder;
+            OBJMeshFileReader(Filename, OBJMeshFileReader::Default, 4).read(builder);
+        }
+        catch (const OBJMeshFileReader::ExceptionParseError& e)
+        {
+            error_line = e.m_line;
+        }
+
+        EXPECT_EQ(line_count, error_line);
+    }
 }
@@ -29,6 +29,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/image/pixel.h"
+#include "foundation/math/scalar.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/test.h"
 
@@ -38,6 +39,9 @@ BEGIN_EXR_INCLUDES
 #include "OpenEXR/half.h"
 END_EXR_INCLUDES
 
+// Standard headers.
+#include <cstddef>
+
 using namespace foundation;
 
 TEST_SUITE(Foundation_Image_Pixel)
@@ -72,6 +76,25 @@ TEST_SUITE(Foundation_Image_Pixel)
         EXPECT_EQ(4294967295UL, output);
     }
 
+    TEST_CASE(ConvertToFormat_FloatToUInt8_MatchesScalarConversion)
+    {
+        // Enough values to exercise both the vectorized loop and the remainder.
+        float input[37];
+        for (size_t i = 0; i < 37; ++i)
+            input[i] = -0.25f + i * (1.5f / 36);
+
+        uint8 output[37];
+        Pixel::convert_to_format(
+            input, input + 37,
+            1,
+            PixelFormatUInt8,
+            output,
+            1);
+
+        for (size_t i = 0; i < 37; ++i)
+            EXPECT_EQ(truncate<uint8>(clamp(input[i] * 256.0f, 0.0f, 255.0f)), output[i]);
+    }
+
     TEST_CASE(ConvertFromFormat_HalfToUInt32)
     {
         const half input = 1.0f;
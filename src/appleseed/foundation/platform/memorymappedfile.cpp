@@ -0,0 +1,222 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "memorymappedfile.h"
+
+// Platform headers.
+#if defined _WIN32
+#include "foundation/platform/windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace foundation
+{
+
+//
+// MemoryMappedFile class implementation.
+//
+
+namespace
+{
+    const char EmptyFile[1] = { 0 };
+}
+
+struct MemoryMappedFile::Impl
+{
+    const char*     m_data;
+    size_t          m_size;
+    bool            m_is_mapped;    // false for empty files, which cannot be mapped
+};
+
+MemoryMappedFile::MemoryMappedFile()
+  : impl(new Impl())
+{
+    impl->m_data = 0;
+    impl->m_size = 0;
+    impl->m_is_mapped = false;
+}
+
+MemoryMappedFile::MemoryMappedFile(const char* path)
+  : impl(new Impl())
+{
+    impl->m_data = 0;
+    impl->m_size = 0;
+    impl->m_is_mapped = false;
+
+    open(path);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    close();
+
+    delete impl;
+}
+
+#if defined _WIN32
+
+bool MemoryMappedFile::open(const char* path)
+{
+    close();
+
+    const HANDLE file =
+        CreateFileA(
+            path,
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            0,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            0);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        impl->m_data = EmptyFile;
+        return true;
+    }
+
+    const HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+
+    if (mapping == 0)
+        return false;
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (data == 0)
+        return false;
+
+    impl->m_data = static_cast<const char*>(data);
+    impl->m_size = static_cast<size_t>(file_size.QuadPart);
+    impl->m_is_mapped = true;
+
+    return true;
+}
+
+void MemoryMappedFile::close()
+{
+    if (impl->m_is_mapped)
+        UnmapViewOfFile(impl->m_data);
+
+    impl->m_data = 0;
+    impl->m_size = 0;
+    impl->m_is_mapped = false;
+}
+
+#else
+
+bool MemoryMappedFile::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+
+    if (fd == -1)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (file_stat.st_size == 0)
+    {
+        ::close(fd);
+        impl->m_data = EmptyFile;
+        return true;
+    }
+
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    // Files are mostly read from beginning to end.
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    impl->m_data = static_cast<const char*>(data);
+    impl->m_size = size;
+    impl->m_is_mapped = true;
+
+    return true;
+}
+
+void MemoryMappedFile::close()
+{
+    if (impl->m_is_mapped)
+        munmap(const_cast<char*>(impl->m_data), impl->m_size);
+
+    impl->m_data = 0;
+    impl->m_size = 0;
+    impl->m_is_mapped = false;
+}
+
+#endif
+
+bool MemoryMappedFile::is_open() const
+{
+    return impl->m_data != 0;
+}
+
+const char* MemoryMappedFile::begin() const
+{
+    return impl->m_data;
+}
+
+const char* MemoryMappedFile::end() const
+{
+    return impl->m_data + impl->m_size;
+}
+
+size_t MemoryMappedFile::size() const
+{
+    return impl->m_size;
+}
+
+}   // namespace foundation
@@ -0,0 +1,151 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Interface header.
+#include "arena.h"
+
+// Standard headers.
+#include <algorithm>
+#include <new>
+
+using namespace std;
+
+namespace foundation
+{
+
+//
+// Arena class implementation.
+//
+
+Arena::Arena()
+  : m_begin(m_storage)
+  , m_end(m_storage + InlineBlockSize)
+  , m_current(m_storage)
+  , m_current_block(0)
+  , m_first_block(0)
+  , m_previous_blocks_usage(0)
+  , m_high_water_mark(0)
+{
+}
+
+Arena::~Arena()
+{
+    HeapBlock* block = m_first_block;
+
+    while (block)
+    {
+        HeapBlock* next = block->m_next;
+        aligned_free(block);
+        block = next;
+    }
+}
+
+size_t Arena::get_high_water_mark() const
+{
+    return max(m_high_water_mark, get_current_usage());
+}
+
+size_t Arena::get_block_count() const
+{
+    size_t count = 1;
+
+    for (const HeapBlock* block = m_first_block; block; block = block->m_next)
+        ++count;
+
+    return count;
+}
+
+size_t Arena::get_capacity() const
+{
+    size_t capacity = InlineBlockSize;
+
+    for (const HeapBlock* block = m_first_block; block; block = block->m_next)
+        capacity += block->m_size;
+
+    return capacity;
+}
+
+void* Arena::allocate_slow(const size_t size)
+{
+    // The remainder of the current block is lost.
+    m_previous_blocks_usage += static_cast<size_t>(m_end - m_begin);
+
+    // Move on to the next retained block that is large enough, if any.
+    HeapBlock* link = m_current_block;
+    HeapBlock* block = m_current_block ? m_current_block->m_next : m_first_block;
+
+    while (block && block->m_size < size)
+    {
+        link = block;
+        block = block->m_next;
+    }
+
+    // Otherwise allocate a new block and insert it after the current block.
+    if (block == 0)
+    {
+        const size_t block_size = max<size_t>(HeapBlockSize, align(size, 16));
+
+        block = static_cast<HeapBlock*>(aligned_malloc(align(sizeof(HeapBlock), 16) + block_size, 16));
+        if (block == 0)
+            throw bad_alloc();
+
+        block->m_size = block_size;
+
+        if (link)
+        {
+            block->m_next = link->m_next;
+            link->m_next = block;
+        }
+        else
+        {
+            block->m_next = m_first_block;
+            m_first_block = block;
+        }
+    }
+
+    m_current_block = block;
+    m_begin = get_storage(block);
+    m_end = m_begin + block->m_size;
+    m_current = m_begin;
+
+    void* ptr = m_current;
+    m_current += align(size, 16);
+
+    assert(m_current <= m_end);
+    assert(is_aligned(ptr, 16));
+
+    return ptr;
+}
+
+uint8* Arena::get_storage(HeapBlock* block)
+{
+    return reinterpret_cast<uint8*>(block) + align(sizeof(HeapBlock), 16);
+}
+
+}   // namespace foundation
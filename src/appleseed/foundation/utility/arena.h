@@ -31,11 +31,14 @@
 #define APPLESEED_FOUNDATION_UTILITY_ARENA_H
 
 // appleseed.foundation headers.
-#include "foundation/core/exceptions/exception.h"
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/memory.h"
 
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
 // Standard headers.
 #include <cassert>
 #include <cstddef>
@@ -46,25 +49,65 @@ namespace foundation
 //
 // An arena is a temporary heap providing extremely cheap memory allocation.
 //
+// Allocations are first served from an inline block of storage. When it is
+// exhausted, the arena chains additional blocks allocated on the heap. These
+// blocks are kept when the arena is cleared, so that an arena reaches a steady
+// state where it no longer allocates memory from the heap. Arenas are not
+// thread-safe: each thread is expected to own its arenas (and their blocks).
+//
 
-class Arena
+class APPLESEED_DLLSYMBOL Arena
+  : public NonCopyable
 {
   public:
+    // Constructor.
     Arena();
 
+    // Destructor. Releases all heap blocks.
+    ~Arena();
+
+    // Release all allocations. Heap blocks are retained for later reuse.
     void clear();
 
+    // Allocate a 16-byte aligned block of memory.
     void* allocate(const size_t size);
 
     template <typename T> T* allocate();
     template <typename T> T* allocate_noinit();
 
-  private:
-    enum { ArenaSize = 256 * 1024 };    // bytes
+    // Return the highest number of bytes ever in use between two calls to clear().
+    size_t get_high_water_mark() const;
+
+    // Return the number of storage blocks, including the inline one.
+    size_t get_block_count() const;
 
-    APPLESEED_SIMD4_ALIGN uint8 m_storage[ArenaSize];
-    const uint8*                m_end;
+    // Return the total size in bytes of all storage blocks.
+    size_t get_capacity() const;
+
+  private:
+    enum { InlineBlockSize = 256 * 1024 };      // bytes
+    enum { HeapBlockSize = 256 * 1024 };        // bytes
+
+    struct HeapBlock
+    {
+        HeapBlock*  m_next;
+        size_t      m_size;                     // size of the storage following the header, in bytes
+    };
+
+    APPLESEED_SIMD4_ALIGN uint8 m_storage[InlineBlockSize];
+    uint8*                      m_begin;        // beginning of the current block
+    const uint8*                m_end;          // end of the current block
     uint8*                      m_current;
+    HeapBlock*                  m_current_block;// current heap block, or 0 if in the inline block
+    HeapBlock*                  m_first_block;  // chain of heap blocks
+    size_t                      m_previous_blocks_usage;
+    size_t                      m_high_water_mark;
+
+    size_t get_current_usage() const;
+
+    void* allocate_slow(const size_t size);
+
+    static uint8* get_storage(HeapBlock* block);
 };
 
 
@@ -72,21 +115,23 @@ class Arena
 // Arena class implementation.
 //
 
-inline Arena::Arena()
-  : m_end(m_storage + ArenaSize)
-  , m_current(m_storage)
-{
-}
-
 inline void Arena::clear()
 {
+    const size_t usage = get_current_usage();
+    if (m_high_water_mark < usage)
+        m_high_water_mark = usage;
+
+    m_begin = m_storage;
+    m_end = m_storage + InlineBlockSize;
     m_current = m_storage;
+    m_current_block = 0;
+    m_previous_blocks_usage = 0;
 }
 
 inline void* Arena::allocate(const size_t size)
 {
     if (m_current + size > m_end)
-        throw Exception("out of arena memory");
+        return allocate_slow(size);
 
     void* ptr = m_current;
     m_current += align(size, 16);
@@ -112,6 +157,11 @@ inline T* Arena::allocate_noinit()
     return static_cast<T*>(allocate(sizeof(T)));
 }
 
+inline size_t Arena::get_current_usage() const
+{
+    return m_previous_blocks_usage + static_cast<size_t>(m_current - m_begin);
+}
+
 }       // namespace foundation
 
 #endif  // !APPLESEED_FOUNDATION_UTILITY_ARENA_H
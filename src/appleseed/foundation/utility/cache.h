@@ -473,6 +473,11 @@ class LRUCache
     // Get an element from the cache.
     ElementType& get(const KeyType& key);
 
+    // Unload and remove the elements for which predicate(key, element) returns true.
+    // Elements that the swapper fails to unload are kept in the cache.
+    template <typename Predicate>
+    void remove_if(const Predicate& predicate);
+
     // Return the size (in bytes) of this object in memory.
     size_t get_memory_size() const;
 
@@ -968,6 +973,25 @@ get(const KeyType& key)
     }
 }
 
+FOUNDATION_LRUCACHE_TEMPLATE_DEF(template <typename Predicate> void)
+remove_if(const Predicate& predicate)
+{
+    QueueIterator i = m_queue.begin();
+
+    while (i != m_queue.end())
+    {
+        if (predicate(i->m_key, i->m_element) &&
+            m_element_swapper.unload(i->m_key, i->m_element))
+        {
+            // Remove this element from the index and from the queue.
+            m_index.erase(i->m_key);
+            i = m_queue.erase(i);
+            --m_queue_size;
+        }
+        else ++i;
+    }
+}
+
 FOUNDATION_LRUCACHE_TEMPLATE_DEF(inline size_t)
 get_memory_size() const
 {
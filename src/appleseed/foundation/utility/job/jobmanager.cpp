@@ -81,6 +81,8 @@ JobManager::JobManager(
     const int           flags)
   : impl(new Impl(logger, job_queue, thread_count, flags))
 {
+    // Give each worker thread its own queue of scheduled jobs.
+    job_queue.reserve_worker_queues(thread_count);
 }
 
 JobManager::~JobManager()
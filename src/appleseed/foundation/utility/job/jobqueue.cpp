@@ -33,15 +33,16 @@
 // appleseed.foundation headers.
 #include "foundation/platform/thread.h"
 #include "foundation/utility/foreach.h"
-#include "foundation/utility/iterators.h"
 #include "foundation/utility/job/abortswitch.h"
 #include "foundation/utility/job/ijob.h"
 
 // Boost headers.
+#include "boost/atomic/atomic.hpp"
 #include "boost/thread/condition_variable.hpp"
 
 // Standard headers.
 #include <cassert>
+#include <vector>
 
 using namespace std;
 
@@ -51,23 +52,98 @@ namespace foundation
 //
 // JobQueue class implementation.
 //
+// Each queue (the shared one and the per-worker ones) is protected by its own
+// spinlock. The mutex and the condition variable are only used to put idle
+// worker threads to sleep and to wait for completion: scheduling and retiring
+// jobs only touch them when some thread is actually waiting.
+//
 
 struct JobQueue::Impl
 {
+    struct LockedJobList
+      : public NonCopyable
+    {
+        Spinlock                    m_spinlock;
+        JobList                     m_jobs;
+    };
+
+    typedef vector<LockedJobList*> WorkerQueueVector;
+
+    // Scheduled jobs.
+    LockedJobList                   m_shared_queue;
+    WorkerQueueVector               m_worker_queues;
+
+    // Number of scheduled jobs, and number of scheduled and running jobs.
+    boost::atomic<size_t>           m_scheduled_count;
+    boost::atomic<size_t>           m_total_count;
+
+    // Synchronization of idle worker threads and of waits for completion.
     mutable boost::mutex            m_mutex;
     boost::condition_variable_any   m_event;
-    JobList                         m_scheduled_jobs;
-    JobList                         m_running_jobs;
+    boost::atomic<size_t>           m_waiter_count;
+
+    Impl()
+      : m_scheduled_count(0)
+      , m_total_count(0)
+      , m_waiter_count(0)
+    {
+    }
+
+    ~Impl()
+    {
+        for (size_t i = 0; i < m_worker_queues.size(); ++i)
+            delete m_worker_queues[i];
+    }
 
-    static void delete_jobs(JobList& list)
+    static size_t delete_jobs(LockedJobList& list)
     {
-        for (each<JobList> i = list; i; ++i)
+        Spinlock::ScopedLock lock(list.m_spinlock);
+
+        for (each<JobList> i = list.m_jobs; i; ++i)
         {
             if (i->m_owned)
                 delete i->m_job;
         }
 
-        list.clear();
+        const size_t count = list.m_jobs.size();
+        list.m_jobs.clear();
+
+        return count;
+    }
+
+    static bool pop_front(LockedJobList& list, JobInfo& job_info)
+    {
+        Spinlock::ScopedLock lock(list.m_spinlock);
+
+        if (list.m_jobs.empty())
+            return false;
+
+        job_info = list.m_jobs.front();
+        list.m_jobs.pop_front();
+
+        return true;
+    }
+
+    static bool pop_back(LockedJobList& list, JobInfo& job_info)
+    {
+        Spinlock::ScopedLock lock(list.m_spinlock);
+
+        if (list.m_jobs.empty())
+            return false;
+
+        job_info = list.m_jobs.back();
+        list.m_jobs.pop_back();
+
+        return true;
+    }
+
+    void signal_waiters()
+    {
+        if (m_waiter_count > 0)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_event.notify_all();
+        }
     }
 };
 
@@ -81,135 +157,188 @@ JobQueue::~JobQueue()
     // We assume that worker threads are not running, so we don't lock.
 
     // At this point, no job must be running.
-    assert(impl->m_running_jobs.empty());
+    assert(impl->m_total_count == impl->m_scheduled_count);
 
     // Delete all scheduled jobs that the queue owns.
-    Impl::delete_jobs(impl->m_scheduled_jobs);
+    clear_scheduled_jobs();
 
     delete impl;
 }
 
 void JobQueue::clear_scheduled_jobs()
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    size_t deleted_count = Impl::delete_jobs(impl->m_shared_queue);
 
-    impl->delete_jobs(impl->m_scheduled_jobs);
+    for (size_t i = 0; i < impl->m_worker_queues.size(); ++i)
+        deleted_count += Impl::delete_jobs(*impl->m_worker_queues[i]);
 
-    // Notify worker threads that all scheduled jobs are gone.
-    impl->m_event.notify_all();
+    impl->m_scheduled_count -= deleted_count;
+    impl->m_total_count -= deleted_count;
+
+    // Notify waiting threads that all scheduled jobs are gone.
+    impl->signal_waiters();
 }
 
 bool JobQueue::has_scheduled_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_scheduled_jobs.empty();
+    return get_scheduled_job_count() > 0;
 }
 
 bool JobQueue::has_running_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_running_jobs.empty();
+    return get_running_job_count() > 0;
 }
 
 bool JobQueue::has_scheduled_or_running_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty();
+    return get_total_job_count() > 0;
 }
 
 size_t JobQueue::get_scheduled_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return impl->m_scheduled_jobs.size();
+    return impl->m_scheduled_count;
 }
 
 size_t JobQueue::get_running_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    // Read the total count last: a job is removed from the scheduled count
+    // before it is removed from the total count.
+    const size_t scheduled_count = impl->m_scheduled_count;
+    const size_t total_count = impl->m_total_count;
 
-    return impl->m_running_jobs.size();
+    return total_count > scheduled_count ? total_count - scheduled_count : 0;
 }
 
 size_t JobQueue::get_total_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return impl->m_scheduled_jobs.size() + impl->m_running_jobs.size();
+    return impl->m_total_count;
 }
 
-void JobQueue::schedule(IJob* job, const bool transfer_ownership)
+void JobQueue::schedule(
+    IJob*           job,
+    const bool      transfer_ownership,
+    const size_t    affinity)
 {
     assert(job);
 
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    const size_t worker_queue_count = impl->m_worker_queues.size();
 
-    impl->m_scheduled_jobs.push_back(JobInfo(job, transfer_ownership));
+    Impl::LockedJobList& queue =
+        affinity == NoAffinity || worker_queue_count == 0
+            ? impl->m_shared_queue
+            : *impl->m_worker_queues[affinity % worker_queue_count];
 
-    // Notify worker threads that a new scheduled job is available.
-    impl->m_event.notify_all();
+    // Count the job before it becomes visible to worker threads.
+    ++impl->m_total_count;
+    ++impl->m_scheduled_count;
+
+    {
+        Spinlock::ScopedLock lock(queue.m_spinlock);
+        queue.m_jobs.push_back(JobInfo(job, transfer_ownership));
+    }
+
+    // Notify idle worker threads that a new scheduled job is available.
+    impl->signal_waiters();
 }
 
 void JobQueue::wait_until_completion()
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
+    ++impl->m_waiter_count;
+
     // Wait until there is no more scheduled or running jobs.
-    while (!impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty())
+    while (impl->m_total_count > 0)
         impl->m_event.wait(lock);
+
+    --impl->m_waiter_count;
 }
 
-JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job()
+void JobQueue::reserve_worker_queues(const size_t worker_count)
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return acquire_scheduled_job_unlocked();
+    while (impl->m_worker_queues.size() < worker_count)
+        impl->m_worker_queues.push_back(new Impl::LockedJobList());
 }
 
-JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(AbortSwitch& abort_switch)
+JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job(const size_t worker_index)
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    JobInfo job_info(0, false);
 
-    // Wait for a scheduled job to be available.
-    while (!abort_switch.is_aborted() && impl->m_scheduled_jobs.empty())    // order matters
-        impl->m_event.wait(lock);
+    // Don't bother looking into the queues if there is no scheduled job.
+    if (impl->m_scheduled_count == 0)
+        return RunningJobInfo(job_info, NoAffinity);
+
+    const size_t worker_queue_count = impl->m_worker_queues.size();
+    const size_t self =
+        worker_index < worker_queue_count ? worker_index : NoAffinity;
+
+    size_t source = NoAffinity;
 
-    return acquire_scheduled_job_unlocked();
+    // First, look into the worker's own queue, oldest job first.
+    if (self != NoAffinity && Impl::pop_front(*impl->m_worker_queues[self], job_info))
+        source = self;
+
+    // Then, look into the shared queue.
+    else if (Impl::pop_front(impl->m_shared_queue, job_info))
+        source = NoAffinity;
+
+    // Finally, steal the most recently scheduled job of another worker.
+    else
+    {
+        const size_t first = self == NoAffinity ? 0 : self + 1;
+
+        for (size_t i = 0; i < worker_queue_count; ++i)
+        {
+            const size_t victim = (first + i) % worker_queue_count;
+
+            if (victim != self && Impl::pop_back(*impl->m_worker_queues[victim], job_info))
+            {
+                source = victim;
+                break;
+            }
+        }
+    }
+
+    // The job stays in the total count until it is retired.
+    if (job_info.m_job)
+        --impl->m_scheduled_count;
+
+    return RunningJobInfo(job_info, source);
 }
 
-JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job_unlocked()
+JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(
+    const size_t    worker_index,
+    AbortSwitch&    abort_switch)
 {
-    // Bail out if there is no scheduled job.
-    if (impl->m_scheduled_jobs.empty())
-        return RunningJobInfo(JobInfo(0, false), impl->m_running_jobs.end());
+    while (true)
+    {
+        const RunningJobInfo running_job_info = acquire_scheduled_job(worker_index);
 
-    // Move the next scheduled job to the end of the queue of running jobs.
-    const JobInfo job_info = impl->m_scheduled_jobs.front();
-    impl->m_scheduled_jobs.pop_front();
-    impl->m_running_jobs.push_back(job_info);
+        if (running_job_info.first.m_job || abort_switch.is_aborted())
+            return running_job_info;
 
-    // Notify worker threads that a job has moved from the scheduled to the running state.
-    impl->m_event.notify_all();
+        boost::mutex::scoped_lock lock(impl->m_mutex);
+
+        // Announce that we are about to sleep, then check again for scheduled jobs:
+        // a thread scheduling a job either sees us waiting, or we see its job.
+        ++impl->m_waiter_count;
 
-    return RunningJobInfo(job_info, pred(impl->m_running_jobs.end()));
+        if (!abort_switch.is_aborted() && impl->m_scheduled_count == 0)     // order matters
+            impl->m_event.wait(lock);
+
+        --impl->m_waiter_count;
+    }
 }
 
 void JobQueue::retire_running_job(const RunningJobInfo& running_job_info)
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    // Remove the job from the running list.
-    impl->m_running_jobs.erase(running_job_info.second);
-
     // Delete the job.
     if (running_job_info.first.m_owned)
         delete running_job_info.first.m_job;
 
-    // Notify worker threads that a scheduled job was retired.
-    impl->m_event.notify_all();
+    // Notify threads waiting for completion when the last job was retired.
+    if (--impl->m_total_count == 0)
+        impl->signal_waiters();
 }
 
 void JobQueue::signal_event()
@@ -67,11 +67,23 @@ namespace foundation
 //   - scheduled: the job was inserted into the job queue, but hasn't yet been executed
 //   - running: the job is currently being executed
 //
+// Scheduled jobs live either in a shared FIFO queue or in one of the per-worker
+// queues. Each worker first drains its own queue, then the shared queue, and
+// finally steals jobs from the far end of the other workers' queues. A job may
+// be given an affinity hint (typically the index of a worker thread) to have it
+// land in a specific worker queue: jobs spawning child jobs can pass the thread
+// index they are executing on to keep the children local to the worker, and
+// spatially coherent jobs (e.g. neighbouring tiles) can be grouped on the same
+// worker to improve cache locality.
+//
 
 class APPLESEED_DLLSYMBOL JobQueue
   : public NonCopyable
 {
   public:
+    // Value of the affinity hint for jobs that may run on any worker thread.
+    static const size_t NoAffinity = ~size_t(0);
+
     // Constructor.
     JobQueue();
 
@@ -100,13 +112,19 @@ class APPLESEED_DLLSYMBOL JobQueue
     size_t get_total_job_count() const;
 
     // Schedule a job for execution. Ownership of the job is transfered
-    // to the job queue if and only if transfer_ownership is true.
-    void schedule(IJob* job, const bool transfer_ownership = true);
+    // to the job queue if and only if transfer_ownership is true. Unless
+    // affinity is NoAffinity, the job is preferably executed by worker
+    // thread (affinity modulo the number of worker queues).
+    void schedule(
+        IJob*           job,
+        const bool      transfer_ownership = true,
+        const size_t    affinity = NoAffinity);
 
     // Wait until all scheduled and running jobs are completed.
     void wait_until_completion();
 
   private:
+    friend class JobManager;
     friend class WorkerThread;
 
     struct Impl;
@@ -121,7 +139,7 @@ class APPLESEED_DLLSYMBOL JobQueue
     struct JobInfo
     {
         IJob*       m_job;
-        const bool  m_owned;
+        bool        m_owned;
 
         JobInfo(IJob* job, const bool owned)
           : m_job(job)
@@ -132,16 +150,23 @@ class APPLESEED_DLLSYMBOL JobQueue
 
     typedef std::list<JobInfo, PoolAllocator<JobInfo, 64> > JobList;
 
-    typedef std::pair<JobInfo, JobList::iterator> RunningJobInfo;
+    // A running job and the index of the worker queue it was taken from
+    // (NoAffinity if it was taken from the shared queue).
+    typedef std::pair<JobInfo, size_t> RunningJobInfo;
 
-    // Acquire a scheduled job and change its state from 'scheduled' to 'running'.
-    RunningJobInfo acquire_scheduled_job();
+    // Make sure there are at least worker_count worker queues.
+    // Must not be called while jobs are being scheduled or executed.
+    void reserve_worker_queues(const size_t worker_count);
 
-    // Wait for a scheduled job to be available.
-    RunningJobInfo wait_for_scheduled_job(AbortSwitch& abort_switch);
+    // Acquire a scheduled job on behalf of a given worker thread (or on behalf
+    // of no particular worker if worker_index is NoAffinity), and change its
+    // state from 'scheduled' to 'running'.
+    RunningJobInfo acquire_scheduled_job(const size_t worker_index = NoAffinity);
 
-    // Acquire a scheduled job without any locking.
-    RunningJobInfo acquire_scheduled_job_unlocked();
+    // Wait for a scheduled job to be available.
+    RunningJobInfo wait_for_scheduled_job(
+        const size_t    worker_index,
+        AbortSwitch&    abort_switch);
 
     // Retire a running job. The job is deleted if it is owned by the queue.
     void retire_running_job(const RunningJobInfo& running_job_info);
@@ -148,7 +148,7 @@ void WorkerThread::run()
 
         // Acquire a job.
         const JobQueue::RunningJobInfo running_job_info =
-            m_job_queue.wait_for_scheduled_job(m_abort_switch);
+            m_job_queue.wait_for_scheduled_job(m_index, m_abort_switch);
 
         // Handle the case where the job queue is empty.
         if (running_job_info.first.m_job == 0)
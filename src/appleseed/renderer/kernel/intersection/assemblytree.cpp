@@ -757,19 +757,11 @@ bool AssemblyLeafVisitor::visit(
         }
 
         // Keep track of the closest hit.
-        if (local_shading_point.hit() && local_shading_point.m_ray.m_tmax < m_shading_point.m_ray.m_tmax)
-        {
-            m_shading_point.m_ray.m_tmax = local_shading_point.m_ray.m_tmax;
-            m_shading_point.m_primitive_type = local_shading_point.m_primitive_type;
-            m_shading_point.m_bary = local_shading_point.m_bary;
-            m_shading_point.m_assembly_instance = item.m_assembly_instance;
-            m_shading_point.m_assembly_instance_transform = assembly_instance_transform;
-            m_shading_point.m_assembly_instance_transform_seq = assembly_instance_transform_seq;
-            m_shading_point.m_object_instance_index = local_shading_point.m_object_instance_index;
-            m_shading_point.m_region_index = local_shading_point.m_region_index;
-            m_shading_point.m_primitive_index = local_shading_point.m_primitive_index;
-            m_shading_point.m_triangle_support_plane = local_shading_point.m_triangle_support_plane;
-        }
+        keep_closest_hit(
+            m_shading_point,
+            local_shading_point,
+            item,
+            assembly_instance_transform);
     }
 
     // Continue traversal.
@@ -777,6 +769,223 @@ bool AssemblyLeafVisitor::visit(
     return true;
 }
 
+void AssemblyLeafVisitor::keep_closest_hit(
+    ShadingPoint&                       shading_point,
+    const ShadingPoint&                 local_shading_point,
+    const AssemblyTree::Item&           item,
+    const Transformd&                   assembly_instance_transform)
+{
+    if (local_shading_point.hit() && local_shading_point.m_ray.m_tmax < shading_point.m_ray.m_tmax)
+    {
+        shading_point.m_ray.m_tmax = local_shading_point.m_ray.m_tmax;
+        shading_point.m_primitive_type = local_shading_point.m_primitive_type;
+        shading_point.m_bary = local_shading_point.m_bary;
+        shading_point.m_assembly_instance = item.m_assembly_instance;
+        shading_point.m_assembly_instance_transform = assembly_instance_transform;
+        shading_point.m_assembly_instance_transform_seq = &item.m_transform_sequence;
+        shading_point.m_object_instance_index = local_shading_point.m_object_instance_index;
+        shading_point.m_region_index = local_shading_point.m_region_index;
+        shading_point.m_primitive_index = local_shading_point.m_primitive_index;
+        shading_point.m_triangle_support_plane = local_shading_point.m_triangle_support_plane;
+    }
+}
+
+
+//
+// AssemblyLeafPacketVisitor class implementation.
+//
+
+size_t AssemblyLeafPacketVisitor::visit(
+    const AssemblyTree::NodeType&       node,
+    const ShadingRay                    rays[],
+    const ShadingRay::RayInfoType       ray_infos[],
+    const size_t                        active_mask,
+    double                              distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&         stats
+#endif
+    )
+{
+    // Retrieve the assembly instances for this leaf.
+    const size_t assembly_instance_count = node.get_item_count();
+    const AssemblyTree::Item* items =
+        assembly_instance_count <= AssemblyTree::NodeType::MaxUserDataSize / sizeof(AssemblyTree::Item)
+            ? &node.get_user_data<AssemblyTree::Item>()     // items are stored in the leaf node
+            : &m_tree.m_items[node.get_item_index()];       // items are stored in the tree
+
+    bool packet_traceable = true;
+
+    for (size_t i = 0; i < assembly_instance_count; ++i)
+    {
+        if (!is_packet_traceable(items[i]))
+        {
+            packet_traceable = false;
+            break;
+        }
+    }
+
+    if (packet_traceable)
+    {
+        for (size_t i = 0; i < assembly_instance_count; ++i)
+        {
+            const AssemblyTree::Item& item = items[i];
+            const uint32 vis_flags = item.m_assembly_instance->get_vis_flags();
+
+            // Only keep the rays for which this assembly instance is visible.
+            size_t item_mask = 0;
+            for (size_t j = 0; j < RayPacketSize; ++j)
+            {
+                if ((active_mask & (size_t(1) << j)) && (vis_flags & m_shading_points[j]->m_ray.m_flags))
+                    item_mask |= size_t(1) << j;
+            }
+
+            if (item_mask == 0)
+                continue;
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+            intersect_triangle_tree(item, item_mask);
+        }
+    }
+    else
+    {
+        // Fall back to intersecting the rays one by one.
+        for (size_t j = 0; j < RayPacketSize; ++j)
+        {
+            if (!(active_mask & (size_t(1) << j)))
+                continue;
+
+            AssemblyLeafVisitor visitor(
+                *m_shading_points[j],
+                m_tree,
+                m_region_tree_cache,
+                m_triangle_tree_cache,
+                m_curve_tree_cache,
+                0
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+                , m_curve_tree_stats
+#endif
+                );
+
+            visitor.visit(
+                node,
+                m_shading_points[j]->m_ray,
+                ray_infos[j],
+                distances[j]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+        }
+    }
+
+    // Continue traversal.
+    for (size_t j = 0; j < RayPacketSize; ++j)
+    {
+        if (active_mask & (size_t(1) << j))
+            distances[j] = m_shading_points[j]->m_ray.m_tmax;
+    }
+
+    return active_mask;
+}
+
+bool AssemblyLeafPacketVisitor::is_packet_traceable(const AssemblyTree::Item& item) const
+{
+    if (item.m_assembly->is_flushable())
+        return false;
+
+    const CurveTree* curve_tree =
+        m_curve_tree_cache.access(
+            item.m_assembly_uid,
+            m_tree.m_curve_trees);
+
+    if (curve_tree)
+        return false;
+
+    const TriangleTree* triangle_tree =
+        m_triangle_tree_cache.access(
+            item.m_assembly_uid,
+            m_tree.m_triangle_trees);
+
+    return triangle_tree == 0 || triangle_tree->get_moving_triangle_count() == 0;
+}
+
+void AssemblyLeafPacketVisitor::intersect_triangle_tree(
+    const AssemblyTree::Item&           item,
+    const size_t                        mask)
+{
+    // Retrieve the triangle tree of this assembly.
+    const TriangleTree* triangle_tree =
+        m_triangle_tree_cache.access(
+            item.m_assembly_uid,
+            m_tree.m_triangle_trees);
+
+    if (triangle_tree == 0)
+        return;
+
+    ShadingPoint local_shading_points[RayPacketSize];
+    ShadingPoint* local_shading_point_ptrs[RayPacketSize];
+    Ray3d local_rays[RayPacketSize];
+    RayInfo3d local_ray_infos[RayPacketSize];
+    Transformd scratch[RayPacketSize];
+    const Transformd* assembly_instance_transforms[RayPacketSize];
+
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        local_shading_point_ptrs[i] = &local_shading_points[i];
+
+        if (!(mask & (size_t(1) << i)))
+            continue;
+
+        const ShadingRay& ray = m_shading_points[i]->m_ray;
+
+        // Evaluate the transformation of the assembly instance.
+        assembly_instance_transforms[i] =
+            &item.m_transform_sequence.evaluate(ray.m_time.m_absolute, scratch[i]);
+
+        // Transform the ray to assembly instance space.
+        ShadingRay& local_ray = local_shading_points[i].m_ray;
+        compute_assembly_instance_ray(
+            *item.m_assembly_instance,
+            *assembly_instance_transforms[i],
+            0,
+            ray,
+            local_ray);
+
+        local_rays[i] = local_ray;
+        local_ray_infos[i] = RayInfo3d(local_ray);
+    }
+
+    // Check the intersection between the packet and the triangle tree.
+    TriangleTreePacketIntersector intersector;
+    TriangleLeafPacketVisitor visitor(*triangle_tree, local_shading_point_ptrs, mask);
+    intersector.intersect_no_motion(
+        *triangle_tree,
+        local_rays,
+        local_ray_infos,
+        mask,
+        visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , m_triangle_tree_stats
+#endif
+        );
+    visitor.read_hit_triangle_data();
+
+    // Keep track of the closest hits.
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (mask & (size_t(1) << i))
+        {
+            AssemblyLeafVisitor::keep_closest_hit(
+                *m_shading_points[i],
+                local_shading_points[i],
+                item,
+                *assembly_instance_transforms[i]);
+        }
+    }
+}
+
 
 //
 // AssemblyLeafProbeVisitor class implementation.
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/intersection/curvetree.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/intersection/probevisitorbase.h"
 #include "renderer/kernel/intersection/regiontree.h"
 #include "renderer/kernel/intersection/treerepository.h"
@@ -45,6 +46,7 @@
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
+#include "foundation/math/transform.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/uid.h"
 #include "foundation/utility/version.h"
@@ -88,6 +90,7 @@ class AssemblyTree
     size_t get_memory_size() const;
 
   private:
+    friend class AssemblyLeafPacketVisitor;
     friend class AssemblyLeafVisitor;
     friend class AssemblyLeafProbeVisitor;
     friend class Intersector;
@@ -191,6 +194,13 @@ class AssemblyLeafVisitor
 #endif
         );
 
+    // Record the hit found in the space of a given assembly instance if it is the closest so far.
+    static void keep_closest_hit(
+        ShadingPoint&                               shading_point,
+        const ShadingPoint&                         local_shading_point,
+        const AssemblyTree::Item&                   item,
+        const foundation::Transformd&               assembly_instance_transform);
+
   private:
     ShadingPoint&                                   m_shading_point;
     const AssemblyTree&                             m_tree;
@@ -205,6 +215,64 @@ class AssemblyLeafVisitor
 };
 
 
+//
+// Assembly leaf visitor for packets of rays, used during packet tree intersection.
+//
+// Assembly instances whose geometry is a static triangle tree are intersected with
+// the whole packet at once; all other assembly instances (flushable assemblies,
+// curves, moving triangles) are intersected one ray at a time.
+//
+
+class AssemblyLeafPacketVisitor
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    AssemblyLeafPacketVisitor(
+        ShadingPoint* const                         shading_points[],
+        const AssemblyTree&                         tree,
+        RegionTreeAccessCache&                      region_tree_cache,
+        TriangleTreeAccessCache&                    triangle_tree_cache,
+        CurveTreeAccessCache&                       curve_tree_cache
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     triangle_tree_stats
+        , foundation::bvh::TraversalStatistics&     curve_tree_stats
+#endif
+        );
+
+    // Visit a leaf.
+    size_t visit(
+        const AssemblyTree::NodeType&               node,
+        const ShadingRay                            rays[],
+        const ShadingRay::RayInfoType               ray_infos[],
+        const size_t                                active_mask,
+        double                                      distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     stats
+#endif
+        );
+
+  private:
+    ShadingPoint* const*                            m_shading_points;
+    const AssemblyTree&                             m_tree;
+    RegionTreeAccessCache&                          m_region_tree_cache;
+    TriangleTreeAccessCache&                        m_triangle_tree_cache;
+    CurveTreeAccessCache&                           m_curve_tree_cache;
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    foundation::bvh::TraversalStatistics&           m_triangle_tree_stats;
+    foundation::bvh::TraversalStatistics&           m_curve_tree_stats;
+#endif
+
+    // Return true if a given assembly instance can be intersected with the whole packet.
+    bool is_packet_traceable(const AssemblyTree::Item& item) const;
+
+    // Intersect the rays set in 'mask' with a static triangle tree.
+    void intersect_triangle_tree(
+        const AssemblyTree::Item&                   item,
+        const size_t                                mask);
+};
+
+
 //
 // Assembly leaf visitor for probe rays, only return boolean answers
 // (whether an intersection was found or not).
@@ -267,6 +335,13 @@ typedef foundation::bvh::Intersector<
     ShadingRay
 > AssemblyTreeProbeIntersector;
 
+typedef foundation::bvh::PacketIntersector<
+    AssemblyTree,
+    AssemblyLeafPacketVisitor,
+    ShadingRay,
+    RayPacketSize
+> AssemblyTreePacketIntersector;
+
 
 //
 // AssemblyLeafVisitor class implementation.
@@ -298,6 +373,34 @@ inline AssemblyLeafVisitor::AssemblyLeafVisitor(
 }
 
 
+//
+// AssemblyLeafPacketVisitor class implementation.
+//
+
+inline AssemblyLeafPacketVisitor::AssemblyLeafPacketVisitor(
+    ShadingPoint* const                             shading_points[],
+    const AssemblyTree&                             tree,
+    RegionTreeAccessCache&                          region_tree_cache,
+    TriangleTreeAccessCache&                        triangle_tree_cache,
+    CurveTreeAccessCache&                           curve_tree_cache
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , foundation::bvh::TraversalStatistics&         triangle_tree_stats
+    , foundation::bvh::TraversalStatistics&         curve_tree_stats
+#endif
+    )
+  : m_shading_points(shading_points)
+  , m_tree(tree)
+  , m_region_tree_cache(region_tree_cache)
+  , m_triangle_tree_cache(triangle_tree_cache)
+  , m_curve_tree_cache(curve_tree_cache)
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+  , m_triangle_tree_stats(triangle_tree_stats)
+  , m_curve_tree_stats(curve_tree_stats)
+#endif
+{
+}
+
+
 //
 // AssemblyLeafProbeVisitor class implementation.
 //
@@ -31,6 +31,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/intersection/treecache.h"
 #include "renderer/modeling/object/curveobject.h"
 #include "renderer/modeling/object/object.h"
 #include "renderer/modeling/scene/assembly.h"
@@ -96,11 +97,49 @@ CurveTree::CurveTree(const Arguments& arguments)
     Stopwatch<DefaultWallclockTimer> stopwatch;
     stopwatch.start();
 
-    // Build the tree.
     Statistics statistics;
-    if (algorithm == "bvh")
-        build_bvh(params, time, statistics);
-    else throw ExceptionNotImplemented();
+
+    // Look the tree up in the disk cache.
+    TreeCache cache("curve tree", sizeof(NodeType), params);
+    bool loaded_from_cache = false;
+    if (cache.is_enabled())
+    {
+        hash_curves(cache);
+        loaded_from_cache = cache.load() && load_from_cache(cache);
+    }
+
+    if (loaded_from_cache)
+    {
+        RENDERER_LOG_INFO(
+            "loaded curve tree #" FMT_UNIQUE_ID " (%s %s) from %s.",
+            m_arguments.m_curve_tree_uid,
+            pretty_uint(m_curve_keys.size()).c_str(),
+            plural(m_curve_keys.size(), "curve").c_str(),
+            cache.get_path().c_str());
+        cache.insert_statistics(statistics, true, stopwatch.measure().get_seconds());
+    }
+    else
+    {
+        // Build the tree.
+        if (algorithm == "bvh")
+            build_bvh(params, time, statistics);
+        else throw ExceptionNotImplemented();
+
+        // Save the tree to the disk cache.
+        if (cache.is_enabled())
+        {
+            cache.insert_statistics(statistics, false, 0.0);
+            store_to_cache(cache, stopwatch.measure().get_seconds());
+        }
+    }
+
+#ifdef RENDERER_CURVE_TREE_WIDE_BVH
+    // Collapse the binary tree into a wide tree.
+    bvh::WideBuilder<CurveTree> wide_builder;
+    wide_builder.build<DefaultWallclockTimer>(*this);
+    statistics.insert("wide nodes", static_cast<uint64>(get_wide_node_count()));
+    statistics.insert_time("collapse time", wide_builder.get_build_time());
+#endif
 
     // Print curve tree statistics.
     statistics.insert_size("nodes alignment", alignment(&m_nodes[0]));
@@ -176,6 +215,72 @@ void CurveTree::collect_curves(vector<GAABB3>& curve_bboxes)
     }
 }
 
+void CurveTree::hash_curves(TreeCache& cache)
+{
+    vector<GAABB3> curve_bboxes;
+    collect_curves(curve_bboxes);
+
+    cache.hash(&m_arguments.m_bbox, sizeof(m_arguments.m_bbox));
+    cache.hash_vector(m_curves1);
+    cache.hash_vector(m_curves3);
+    cache.hash_vector(m_curve_keys);
+
+    clear_release_memory(m_curves1);
+    clear_release_memory(m_curves3);
+    clear_release_memory(m_curve_keys);
+}
+
+namespace
+{
+    // Blocks of a cached curve tree.
+    enum CurveTreeCacheBlock
+    {
+        NodesBlock,
+        NodeBBoxesBlock,
+        Curves1Block,
+        Curves3Block,
+        CurveKeysBlock
+    };
+}
+
+bool CurveTree::load_from_cache(const TreeCache& cache)
+{
+    if (cache.read_vector(NodesBlock, m_nodes) &&
+        cache.read_vector(NodeBBoxesBlock, m_node_bboxes) &&
+        cache.read_vector(Curves1Block, m_curves1) &&
+        cache.read_vector(Curves3Block, m_curves3) &&
+        cache.read_vector(CurveKeysBlock, m_curve_keys) &&
+        !m_nodes.empty())
+        return true;
+
+    RENDERER_LOG_WARNING("ignoring invalid curve tree cache file %s.", cache.get_path().c_str());
+
+    m_nodes.clear();
+    clear_release_memory(m_node_bboxes);
+    clear_release_memory(m_curves1);
+    clear_release_memory(m_curves3);
+    clear_release_memory(m_curve_keys);
+
+    return false;
+}
+
+void CurveTree::store_to_cache(TreeCache& cache, const double build_time) const
+{
+    cache.add_vector(m_nodes);
+    cache.add_vector(m_node_bboxes);
+    cache.add_vector(m_curves1);
+    cache.add_vector(m_curves3);
+    cache.add_vector(m_curve_keys);
+
+    if (cache.store(build_time))
+    {
+        RENDERER_LOG_DEBUG(
+            "saved curve tree #" FMT_UNIQUE_ID " to %s.",
+            m_arguments.m_curve_tree_uid,
+            cache.get_path().c_str());
+    }
+}
+
 void CurveTree::build_bvh(
     const ParamArray&       params,
     const double            time,
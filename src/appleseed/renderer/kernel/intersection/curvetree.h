@@ -57,6 +57,7 @@ namespace foundation    { class Statistics; }
 namespace renderer      { class Assembly; }
 namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
+namespace renderer      { class TreeCache; }
 
 namespace renderer
 {
@@ -66,11 +67,20 @@ namespace renderer
 //
 
 class CurveTree
+#ifdef RENDERER_CURVE_TREE_WIDE_BVH
+  : public foundation::bvh::WideTree<
+               foundation::AlignedVector<
+                   foundation::bvh::Node<GAABB3>
+               >,
+               CurveTreeWideNodeWidth
+           >
+#else
   : public foundation::bvh::Tree<
                foundation::AlignedVector<
                    foundation::bvh::Node<GAABB3>
                >
            >
+#endif
 {
   public:
     // Construction arguments.
@@ -111,6 +121,15 @@ class CurveTree
 
     void collect_curves(std::vector<GAABB3>& curve_bboxes);
 
+    // Fold the input geometry of the tree into the key of a disk cache.
+    void hash_curves(TreeCache& cache);
+
+    bool load_from_cache(const TreeCache& cache);
+
+    void store_to_cache(
+        TreeCache&                              cache,
+        const double                            build_time) const;
+
     void build_bvh(
         const ParamArray&                       params,
         const double                            time,
@@ -235,6 +254,24 @@ class CurveLeafProbeVisitor
 // Curve tree intersectors.
 //
 
+#ifdef RENDERER_CURVE_TREE_WIDE_BVH
+
+typedef foundation::bvh::WideIntersector<
+    CurveTree,
+    CurveLeafVisitor,
+    GRay3,
+    CurveTreeStackSize
+> CurveTreeIntersector;
+
+typedef foundation::bvh::WideIntersector<
+    CurveTree,
+    CurveLeafProbeVisitor,
+    GRay3,
+    CurveTreeStackSize
+> CurveTreeProbeIntersector;
+
+#else
+
 typedef foundation::bvh::Intersector<
     CurveTree,
     CurveLeafVisitor,
@@ -249,6 +286,8 @@ typedef foundation::bvh::Intersector<
     CurveTreeStackSize
 > CurveTreeProbeIntersector;
 
+#endif
+
 
 //
 // CurveLeafVisitor class implementation.
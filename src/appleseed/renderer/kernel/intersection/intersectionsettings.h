@@ -36,6 +36,7 @@
 // appleseed.foundation headers.
 #include "foundation/math/beziercurve.h"
 #include "foundation/math/intersection/raytrianglemt.h"
+#include "foundation/math/intersection/raytrianglewt.h"
 #include "foundation/math/matrix.h"
 
 // Standard headers.
@@ -87,8 +88,26 @@ typedef foundation::TriangleMT<GScalar> GTriangleType;
 typedef foundation::TriangleMT<double> TriangleType;
 typedef foundation::TriangleMTSupportPlane<double> TriangleSupportPlaneType;
 
+// Define this symbol to store the static triangles of triangle tree leaves in packets
+// of single-precision triangles intersected all at once with a watertight algorithm.
+#undef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+// Number of triangles per packet (8 is only vectorized with AVX).
+#ifdef APPLESEED_USE_AVX
+const size_t TriangleTreePacketWidth = 8;
+#else
+const size_t TriangleTreePacketWidth = 4;
+#endif
+
+// Triangle packet format used for storage and intersection.
+typedef foundation::TriangleWTPacket<TriangleTreePacketWidth> TrianglePacketType;
+
 // Maximum number of triangles per leaf.
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+const size_t TriangleTreeDefaultMaxLeafSize = TriangleTreePacketWidth;
+#else
 const size_t TriangleTreeDefaultMaxLeafSize = 2;
+#endif
 
 // Relative cost of traversing an interior node.
 const GScalar TriangleTreeDefaultInteriorNodeTraversalCost(1.0);
@@ -99,6 +118,11 @@ const GScalar TriangleTreeDefaultTriangleIntersectionCost(1.0);
 // Number of bins used during SBVH construction.
 const size_t TriangleTreeDefaultBinCount = 256;
 
+// Maximum number of nested time splits in triangle trees containing moving triangles.
+// Each level of time splits halves the time interval covered by the nodes below it.
+// Set to 0 to build a regular BVH with motion bounding boxes instead.
+const size_t TriangleTreeDefaultMaxTimeSplitDepth = 2;
+
 // Define this symbol to enable reordering the nodes of triangle trees for better
 // locality of reference. Requires a lot of temporary memory for minimal results.
 #undef RENDERER_TRIANGLE_TREE_REORDER_NODES
@@ -106,6 +130,13 @@ const size_t TriangleTreeDefaultBinCount = 256;
 // Depth of a subtree in the van Emde Boas node layout.
 const size_t TriangleTreeSubtreeDepth = 3;
 
+// Define this symbol to collapse triangle trees into wide trees whose nodes test all
+// their child bounding boxes at once. Only applies to rays without motion blur.
+#undef RENDERER_TRIANGLE_TREE_WIDE_BVH
+
+// Maximum number of children of a node of a wide triangle tree.
+const size_t TriangleTreeWideNodeWidth = 4;
+
 // Size of the triangle tree access cache.
 const size_t TriangleTreeAccessCacheLines = 128;
 const size_t TriangleTreeAccessCacheWays = 2;
@@ -138,6 +169,13 @@ const GScalar CurveTreeDefaultInteriorNodeTraversalCost(1.0);
 // Relative cost of intersecting a curve.
 const GScalar CurveTreeDefaultCurveIntersectionCost(1.0);
 
+// Define this symbol to collapse curve trees into wide trees whose nodes test all
+// their child bounding boxes at once. Only applies to rays without motion blur.
+#undef RENDERER_CURVE_TREE_WIDE_BVH
+
+// Maximum number of children of a node of a wide curve tree (8 is only vectorized with AVX).
+const size_t CurveTreeWideNodeWidth = 4;
+
 // Size of the curve tree access cache.
 const size_t CurveTreeAccessCacheLines = 128;
 const size_t CurveTreeAccessCacheWays = 2;
@@ -146,6 +184,14 @@ const size_t CurveTreeAccessCacheWays = 2;
 const size_t CurveTreeStackSize = 64;
 
 
+//
+// Packet tracing settings.
+//
+
+// Maximum number of rays traced together by renderer::Intersector::trace_packet().
+const size_t RayPacketSize = 8;
+
+
 //
 // Miscellaneous settings.
 //
@@ -47,6 +47,7 @@
 #include "foundation/utility/string.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <memory>
@@ -67,6 +68,7 @@ Intersector::Intersector(
   , m_report_self_intersections(report_self_intersections)
   , m_shading_ray_count(0)
   , m_probe_ray_count(0)
+  , m_shading_ray_packet_count(0)
 {
 }
 
@@ -299,6 +301,84 @@ bool Intersector::trace(
     return shading_point.hit();
 }
 
+void Intersector::trace_packet(
+    const ShadingRay                rays[],
+    ShadingPoint                    shading_points[],
+    const size_t                    ray_count) const
+{
+    assert(ray_count > 0);
+    assert(ray_count <= RayPacketSize);
+
+    // Update ray casting statistics.
+    m_shading_ray_count += ray_count;
+    ++m_shading_ray_packet_count;
+
+    ShadingPoint* shading_point_ptrs[RayPacketSize];
+    ShadingRay::RayInfoType ray_infos[RayPacketSize];
+
+    for (size_t i = 0; i < ray_count; ++i)
+    {
+        assert(is_normalized(rays[i].m_dir));
+
+        ShadingPoint& shading_point = shading_points[i];
+        assert(shading_point.m_scene == 0);
+        assert(shading_point.hit() == false);
+
+        // Initialize the shading point.
+        shading_point.m_region_kit_cache = &m_region_kit_cache;
+        shading_point.m_tess_cache = &m_tess_cache;
+        shading_point.m_texture_cache = &m_texture_cache;
+        shading_point.m_scene = &m_trace_context.get_scene();
+        shading_point.m_ray = rays[i];
+
+        // Compute ray info once for the entire traversal.
+        ray_infos[i] = ShadingRay::RayInfoType(shading_point.m_ray);
+
+        shading_point_ptrs[i] = &shading_point;
+    }
+
+    // Retrieve assembly tree.
+    const AssemblyTree& assembly_tree = m_trace_context.get_assembly_tree();
+
+    // Check the intersection between the packet and the assembly tree.
+    AssemblyTreePacketIntersector intersector;
+    AssemblyLeafPacketVisitor visitor(
+        shading_point_ptrs,
+        assembly_tree,
+        m_region_tree_cache,
+        m_triangle_tree_cache,
+        m_curve_tree_cache
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , m_triangle_tree_traversal_stats
+        , m_curve_tree_traversal_stats
+#endif
+        );
+    intersector.intersect_no_motion(
+        assembly_tree,
+        rays,
+        ray_infos,
+        AssemblyTreePacketIntersector::make_mask(ray_count),
+        visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , m_assembly_tree_traversal_stats
+#endif
+        );
+}
+
+void Intersector::trace_stream(
+    const ShadingRay                rays[],
+    ShadingPoint                    shading_points[],
+    const size_t                    ray_count) const
+{
+    for (size_t i = 0; i < ray_count; i += RayPacketSize)
+    {
+        trace_packet(
+            rays + i,
+            shading_points + i,
+            min(ray_count - i, RayPacketSize));
+    }
+}
+
 bool Intersector::trace_probe(
     const ShadingRay&               ray,
     const ShadingPoint*             parent_shading_point) const
@@ -442,6 +522,7 @@ StatisticsVector Intersector::get_statistics() const
                 "probe rays",
                 m_probe_ray_count,
                 total_ray_count)));
+    intersection_stats.insert("shading ray packets", m_shading_ray_packet_count);
 
     StatisticsVector vec;
 
@@ -98,6 +98,19 @@ class Intersector
         ShadingPoint&                   shading_point,
         const ShadingPoint*             parent_shading_point = 0) const;
 
+    // Trace a packet of up to RayPacketSize coherent world space rays through the scene.
+    // The rays must not originate from a previous intersection (e.g. camera rays).
+    void trace_packet(
+        const ShadingRay                rays[],
+        ShadingPoint                    shading_points[],
+        const size_t                    ray_count) const;
+
+    // Trace any number of coherent world space rays through the scene, in packets.
+    void trace_stream(
+        const ShadingRay                rays[],
+        ShadingPoint                    shading_points[],
+        const size_t                    ray_count) const;
+
     // Trace a world space probe ray through the scene.
     bool trace_probe(
         const ShadingRay&               ray,
@@ -136,6 +149,7 @@ class Intersector
     // Intersection statistics.
     mutable foundation::uint64                      m_shading_ray_count;
     mutable foundation::uint64                      m_probe_ray_count;
+    mutable foundation::uint64                      m_shading_ray_packet_count;
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
     mutable foundation::bvh::TraversalStatistics    m_assembly_tree_traversal_stats;
     mutable foundation::bvh::TraversalStatistics    m_triangle_tree_traversal_stats;
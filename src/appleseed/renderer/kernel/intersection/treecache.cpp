@@ -0,0 +1,340 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "treecache.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/foreach.h"
+#include "foundation/utility/siphash.h"
+#include "foundation/utility/statistics.h"
+
+// Boost headers.
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+// Standard headers.
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace foundation;
+using namespace std;
+namespace bf = boost::filesystem;
+
+namespace renderer
+{
+
+//
+// TreeCache class implementation.
+//
+
+namespace
+{
+    // Increment this number whenever the layout of a cached tree changes.
+    const uint32 TreeCacheFormatVersion = 1;
+
+    const char TreeCacheSignature[8] = { 'A', 'S', 'T', 'R', 'E', 'E', 'C', 'F' };
+
+    const size_t TreeCacheBlockAlignment = 16;
+
+    struct FileHeader
+    {
+        char    m_signature[8];
+        uint32  m_version;
+        uint32  m_block_count;
+        uint64  m_key;
+        double  m_build_time;
+    };
+
+    uint64 align_offset(const uint64 offset)
+    {
+        return (offset + TreeCacheBlockAlignment - 1) & ~static_cast<uint64>(TreeCacheBlockAlignment - 1);
+    }
+
+    bool is_key_parameter(const char* name)
+    {
+        // These parameters have no effect on the structure of the tree.
+        return
+            strcmp(name, "cache_directory") != 0 &&
+            strcmp(name, "build_threads") != 0;
+    }
+}
+
+TreeCache::TreeCache(
+    const char*         tree_kind,
+    const size_t        node_size,
+    const ParamArray&   params)
+  : m_tree_kind(tree_kind)
+  , m_directory(params.get_optional<string>("cache_directory", ""))
+  , m_build_time(0.0)
+{
+    // Trees cached by a build with a different format, data layout or byte order must not be reused.
+    const uint32 layout[] =
+    {
+        TreeCacheFormatVersion,
+        0x01020304,
+        static_cast<uint32>(sizeof(void*)),
+        static_cast<uint32>(sizeof(size_t)),
+        static_cast<uint32>(sizeof(GScalar)),
+        static_cast<uint32>(node_size),
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+        1
+#else
+        0
+#endif
+    };
+    m_key = siphash24(layout, sizeof(layout));
+    hash(m_tree_kind.c_str(), m_tree_kind.size());
+
+    // Fold the construction parameters into the key. They are sorted by name.
+    for (const_each<StringDictionary> i = params.strings(); i; ++i)
+    {
+        if (is_key_parameter(i->key()))
+        {
+            hash(i->key(), strlen(i->key()) + 1);
+            hash(i->value(), strlen(i->value()) + 1);
+        }
+    }
+}
+
+bool TreeCache::is_enabled() const
+{
+    return !m_directory.empty();
+}
+
+void TreeCache::hash(const void* data, const size_t size)
+{
+    m_key = siphash24(m_key, siphash24(data, size));
+}
+
+uint64 TreeCache::get_key() const
+{
+    return m_key;
+}
+
+string TreeCache::get_path() const
+{
+    string filename = m_tree_kind;
+    replace(filename.begin(), filename.end(), ' ', '_');
+
+    stringstream sstr;
+    sstr << filename << '_' << hex << setw(16) << setfill('0') << m_key << ".bin";
+
+    return (bf::path(m_directory) / sstr.str()).string();
+}
+
+void TreeCache::add_block(const void* data, const size_t size)
+{
+    m_pending_blocks.push_back(make_pair(data, size));
+}
+
+bool TreeCache::store(const double build_time)
+{
+    assert(is_enabled());
+
+    const bf::path path(get_path());
+    bf::path temp_path;
+
+    try
+    {
+        bf::create_directories(path.parent_path());
+
+        // Write to a temporary file first so that concurrent renders never see a partial file.
+        temp_path = path;
+        temp_path += bf::unique_path(".%%%%-%%%%-%%%%.tmp");
+
+        ofstream file(temp_path.string().c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+        if (!file.is_open())
+        {
+            RENDERER_LOG_WARNING("could not write %s cache file %s.", m_tree_kind.c_str(), temp_path.string().c_str());
+            return false;
+        }
+
+        FileHeader header;
+        memcpy(header.m_signature, TreeCacheSignature, sizeof(header.m_signature));
+        header.m_version = TreeCacheFormatVersion;
+        header.m_block_count = static_cast<uint32>(m_pending_blocks.size());
+        header.m_key = m_key;
+        header.m_build_time = build_time;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Write the block table.
+        uint64 offset = align_offset(sizeof(FileHeader) + m_pending_blocks.size() * sizeof(Block));
+        for (size_t i = 0; i < m_pending_blocks.size(); ++i)
+        {
+            Block block;
+            block.m_offset = offset;
+            block.m_size = m_pending_blocks[i].second;
+            file.write(reinterpret_cast<const char*>(&block), sizeof(block));
+            offset = align_offset(offset + block.m_size);
+        }
+
+        // Write the blocks.
+        const char Padding[TreeCacheBlockAlignment] = { 0 };
+        for (size_t i = 0; i < m_pending_blocks.size(); ++i)
+        {
+            const uint64 position = static_cast<uint64>(file.tellp());
+            file.write(Padding, static_cast<streamsize>(align_offset(position) - position));
+            file.write(
+                static_cast<const char*>(m_pending_blocks[i].first),
+                static_cast<streamsize>(m_pending_blocks[i].second));
+        }
+
+        file.close();
+
+        if (file.fail())
+        {
+            RENDERER_LOG_WARNING("could not write %s cache file %s.", m_tree_kind.c_str(), temp_path.string().c_str());
+            bf::remove(temp_path);
+            return false;
+        }
+
+        bf::rename(temp_path, path);
+    }
+    catch (const std::exception& e)     // needs namespace qualification
+    {
+        RENDERER_LOG_WARNING(
+            "could not write %s cache file %s: %s.",
+            m_tree_kind.c_str(),
+            path.string().c_str(),
+            e.what());
+
+        boost::system::error_code ec;
+        if (!temp_path.empty())
+            bf::remove(temp_path, ec);
+
+        return false;
+    }
+
+    m_pending_blocks.clear();
+
+    return true;
+}
+
+bool TreeCache::load()
+{
+    assert(is_enabled());
+
+    m_file.close();
+    m_blocks.clear();
+
+    const string path = get_path();
+
+    if (!bf::exists(path) || !m_file.open(path.c_str()))
+        return false;
+
+    const char* begin = m_file.begin();
+    const uint64 file_size = m_file.size();
+
+    bool valid = false;
+
+    if (file_size >= sizeof(FileHeader))
+    {
+        FileHeader header;
+        memcpy(&header, begin, sizeof(header));
+
+        if (memcmp(header.m_signature, TreeCacheSignature, sizeof(header.m_signature)) == 0 &&
+            header.m_version == TreeCacheFormatVersion &&
+            header.m_key == m_key &&
+            header.m_block_count <= (file_size - sizeof(FileHeader)) / sizeof(Block))
+        {
+            m_blocks.resize(header.m_block_count);
+            if (!m_blocks.empty())
+                memcpy(&m_blocks[0], begin + sizeof(FileHeader), m_blocks.size() * sizeof(Block));
+
+            m_build_time = header.m_build_time;
+
+            valid = true;
+            for (size_t i = 0; i < m_blocks.size(); ++i)
+            {
+                if (m_blocks[i].m_offset > file_size ||
+                    m_blocks[i].m_size > file_size - m_blocks[i].m_offset)
+                {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!valid)
+    {
+        RENDERER_LOG_WARNING("ignoring invalid %s cache file %s.", m_tree_kind.c_str(), path.c_str());
+        m_file.close();
+        m_blocks.clear();
+    }
+
+    return valid;
+}
+
+double TreeCache::get_build_time() const
+{
+    return m_build_time;
+}
+
+size_t TreeCache::get_block_size(const size_t index) const
+{
+    return index < m_blocks.size() ? static_cast<size_t>(m_blocks[index].m_size) : 0;
+}
+
+bool TreeCache::read_block(const size_t index, void* data, const size_t size) const
+{
+    if (index >= m_blocks.size() || m_blocks[index].m_size != size)
+        return false;
+
+    if (size > 0)
+        memcpy(data, m_file.begin() + m_blocks[index].m_offset, size);
+
+    return true;
+}
+
+void TreeCache::insert_statistics(
+    Statistics&         statistics,
+    const bool          hit,
+    const double        load_time) const
+{
+    statistics.insert("cache", string(hit ? "hit" : "miss"));
+
+    if (hit)
+    {
+        statistics.insert_time("cache load time", load_time);
+        statistics.insert_time("time saved", max(m_build_time - load_time, 0.0));
+    }
+}
+
+}   // namespace renderer
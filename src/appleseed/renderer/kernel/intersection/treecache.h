@@ -0,0 +1,171 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_RENDERER_KERNEL_INTERSECTION_TREECACHE_H
+#define APPLESEED_RENDERER_KERNEL_INTERSECTION_TREECACHE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/memorymappedfile.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class Statistics; }
+namespace renderer      { class ParamArray; }
+
+namespace renderer
+{
+
+//
+// A persistent, on-disk cache of acceleration structures.
+//
+// The cache is enabled by setting the cache_directory parameter of an assembly's
+// acceleration_structure parameters. Each tree is stored in its own file, named
+// after a key computed from the tree's input geometry (as collected for the build)
+// and from the parameters that affect the build. Any change to the geometry, the
+// instance transforms or the build parameters therefore yields a new key, while
+// stale or damaged files are simply ignored and rebuilt.
+//
+// A cache file is a flat sequence of 16-byte aligned blocks, one per tree vector.
+// Files are memory-mapped and their blocks are copied directly into the vectors
+// of the tree being loaded.
+//
+
+class TreeCache
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. The tree kind ("triangle tree", "curve tree", etc.) and the size
+    // of the tree's nodes are part of the key.
+    TreeCache(
+        const char*                     tree_kind,
+        const size_t                    node_size,
+        const ParamArray&               params);
+
+    // Return true if a cache directory was set.
+    bool is_enabled() const;
+
+    // Fold data into the key of the tree.
+    void hash(const void* data, const size_t size);
+    template <typename Vector> void hash_vector(const Vector& vec);
+
+    // Return the key of the tree.
+    foundation::uint64 get_key() const;
+
+    // Return the path to the cache file of the tree.
+    std::string get_path() const;
+
+    // Add a block to be written by store().
+    void add_block(const void* data, const size_t size);
+    template <typename Vector> void add_vector(const Vector& vec);
+
+    // Write all added blocks to the cache file, along with the time it took to build the tree.
+    // Return true on success. Failures are reported as warnings.
+    bool store(const double build_time);
+
+    // Open the cache file of the tree. Return true if the file exists and is valid.
+    bool load();
+
+    // Return the time it took to build the tree loaded by load().
+    double get_build_time() const;
+
+    // Copy a block of the loaded file into a vector.
+    // Return false if the size of the block is not a multiple of the vector's item size.
+    bool read_block(const size_t index, void* data, const size_t size) const;
+    template <typename Vector> bool read_vector(const size_t index, Vector& vec) const;
+
+    // Record cache statistics: whether the tree was found in the cache and how much time was saved.
+    void insert_statistics(
+        foundation::Statistics&         statistics,
+        const bool                      hit,
+        const double                    load_time) const;
+
+  private:
+    struct Block
+    {
+        foundation::uint64              m_offset;
+        foundation::uint64              m_size;
+    };
+
+    const std::string                   m_tree_kind;
+    std::string                         m_directory;
+    foundation::uint64                  m_key;
+
+    std::vector<std::pair<const void*, size_t> > m_pending_blocks;
+
+    foundation::MemoryMappedFile        m_file;
+    std::vector<Block>                  m_blocks;
+    double                              m_build_time;
+
+    size_t get_block_size(const size_t index) const;
+};
+
+
+//
+// TreeCache class implementation.
+//
+
+template <typename Vector>
+inline void TreeCache::hash_vector(const Vector& vec)
+{
+    hash(
+        vec.empty() ? 0 : &vec[0],
+        vec.size() * sizeof(typename Vector::value_type));
+}
+
+template <typename Vector>
+inline void TreeCache::add_vector(const Vector& vec)
+{
+    add_block(
+        vec.empty() ? 0 : &vec[0],
+        vec.size() * sizeof(typename Vector::value_type));
+}
+
+template <typename Vector>
+bool TreeCache::read_vector(const size_t index, Vector& vec) const
+{
+    const size_t ItemSize = sizeof(typename Vector::value_type);
+    const size_t size = get_block_size(index);
+
+    if (size % ItemSize != 0)
+        return false;
+
+    vec.resize(size / ItemSize);
+
+    return read_block(index, vec.empty() ? 0 : &vec[0], size);
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_INTERSECTION_TREECACHE_H
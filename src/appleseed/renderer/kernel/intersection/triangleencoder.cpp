@@ -44,6 +44,127 @@ using namespace std;
 namespace renderer
 {
 
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+size_t TriangleEncoder::compute_size(
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    const vector<size_t>&               triangle_indices,
+    const size_t                        item_begin,
+    const size_t                        item_count)
+{
+    size_t size = 0;
+    size_t static_count = 0;
+
+    size += sizeof(uint32);             // packet count
+    size += sizeof(uint32);             // moving triangle count
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+        if (vertex_info.m_motion_segment_count == 0)
+            ++static_count;
+        else
+        {
+            size += sizeof(uint32);     // item offset
+            size += sizeof(uint32);     // visibility flags
+            size += sizeof(uint32);     // motion segment count
+            size += (vertex_info.m_motion_segment_count + 1) * 3 * sizeof(GVector3);
+        }
+    }
+
+    const size_t packet_count = (static_count + TriangleTreePacketWidth - 1) / TriangleTreePacketWidth;
+    size += packet_count * sizeof(TrianglePacketRecord);
+
+    return size;
+}
+
+void TriangleEncoder::encode(
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    const vector<GVector3>&             triangle_vertices,
+    const vector<size_t>&               triangle_indices,
+    const size_t                        item_begin,
+    const size_t                        item_count,
+    MemoryWriter&                       writer)
+{
+    typedef TrianglePacketType::VectorType VectorType;
+
+    size_t static_count = 0;
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        if (triangle_vertex_infos[triangle_index].m_motion_segment_count == 0)
+            ++static_count;
+    }
+
+    // Write static triangles, grouped into packets.
+
+    const size_t packet_count = (static_count + TriangleTreePacketWidth - 1) / TriangleTreePacketWidth;
+    writer.write(static_cast<uint32>(packet_count));
+
+    TrianglePacketRecord record;
+    size_t slot = 0;
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+        if (vertex_info.m_motion_segment_count > 0)
+            continue;
+
+        record.m_packet.set(
+            slot,
+            VectorType(triangle_vertices[vertex_info.m_vertex_index + 0]),
+            VectorType(triangle_vertices[vertex_info.m_vertex_index + 1]),
+            VectorType(triangle_vertices[vertex_info.m_vertex_index + 2]));
+        record.m_vis_flags[slot] = vertex_info.m_vis_flags;
+        record.m_item_offsets[slot] = static_cast<uint32>(i);
+
+        if (++slot == TriangleTreePacketWidth)
+        {
+            writer.write(record);
+            slot = 0;
+        }
+    }
+
+    if (slot > 0)
+    {
+        for (; slot < TriangleTreePacketWidth; ++slot)
+        {
+            record.m_packet.clear(slot);
+            record.m_vis_flags[slot] = 0;
+            record.m_item_offsets[slot] = 0;
+        }
+
+        writer.write(record);
+    }
+
+    // Write moving triangles.
+
+    writer.write(static_cast<uint32>(item_count - static_count));
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+        if (vertex_info.m_motion_segment_count == 0)
+            continue;
+
+        writer.write(static_cast<uint32>(i));
+        writer.write(vertex_info.m_vis_flags);
+        writer.write(static_cast<uint32>(vertex_info.m_motion_segment_count));
+        writer.write(
+            &triangle_vertices[vertex_info.m_vertex_index],
+            (vertex_info.m_motion_segment_count + 1) * 3 * sizeof(GVector3));
+    }
+}
+
+#else
+
 size_t TriangleEncoder::compute_size(
     const vector<TriangleVertexInfo>&   triangle_vertex_infos,
     const vector<size_t>&               triangle_indices,
@@ -101,4 +222,6 @@ void TriangleEncoder::encode(
     }
 }
 
+#endif
+
 }   // namespace renderer
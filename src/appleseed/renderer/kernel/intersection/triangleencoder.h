@@ -32,6 +32,10 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
 
 // Standard headers.
 #include <cstddef>
@@ -44,6 +48,28 @@ namespace renderer      { class TriangleVertexInfo; }
 namespace renderer
 {
 
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+//
+// With RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS defined, leaves are encoded as:
+//
+//   uint32                     number of packets
+//   TrianglePacketRecord[]     static triangles, in item order
+//   uint32                     number of moving triangles
+//   (moving triangles)         uint32 item offset, then the regular encoding
+//
+// Unused slots of the last packet have null visibility flags.
+//
+
+struct TrianglePacketRecord
+{
+    TrianglePacketType  m_packet;
+    foundation::uint32  m_vis_flags[TriangleTreePacketWidth];
+    foundation::uint32  m_item_offsets[TriangleTreePacketWidth];
+};
+
+#endif
+
 class TriangleEncoder
 {
   public:
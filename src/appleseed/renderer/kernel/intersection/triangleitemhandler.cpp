@@ -35,11 +35,13 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/intersection/aabbtriangle.h"
+#include "foundation/math/scalar.h"
 #ifdef APPLESEED_USE_SSE
 #include "foundation/platform/sse.h"
 #endif
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <limits>
 
@@ -355,4 +357,59 @@ Vector3d TriangleItemHandler::segment_plane_intersection(
     return result;
 }
 
+
+//
+// TriangleMotionItemHandler class implementation.
+//
+
+TriangleMotionItemHandler::TriangleMotionItemHandler(
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    const vector<GVector3>&             triangle_vertices)
+  : m_triangle_vertex_infos(triangle_vertex_infos)
+  , m_triangle_vertices(triangle_vertices)
+{
+}
+
+size_t TriangleMotionItemHandler::size() const
+{
+    return m_triangle_vertex_infos.size();
+}
+
+size_t TriangleMotionItemHandler::get_motion_segment_count(const size_t item_index) const
+{
+    return m_triangle_vertex_infos[item_index].m_motion_segment_count;
+}
+
+AABB3d TriangleMotionItemHandler::compute_bbox(
+    const size_t                        item_index,
+    const double                        time) const
+{
+    const TriangleVertexInfo& vertex_info = m_triangle_vertex_infos[item_index];
+    const GVector3* vertices = &m_triangle_vertices[vertex_info.m_vertex_index];
+
+    AABB3d bbox;
+    bbox.invalidate();
+
+    if (vertex_info.m_motion_segment_count == 0)
+    {
+        bbox.insert(Vector3d(vertices[0]));
+        bbox.insert(Vector3d(vertices[1]));
+        bbox.insert(Vector3d(vertices[2]));
+        return bbox;
+    }
+
+    // Linearly interpolate between the two poses surrounding the time value.
+    const double x = time * vertex_info.m_motion_segment_count;
+    const size_t prev_pose_index =
+        min(truncate<size_t>(x), vertex_info.m_motion_segment_count - 1);
+    const double k = x - prev_pose_index;
+    const GVector3* prev_vertices = vertices + prev_pose_index * 3;
+    const GVector3* next_vertices = prev_vertices + 3;
+
+    for (size_t i = 0; i < 3; ++i)
+        bbox.insert(lerp(Vector3d(prev_vertices[i]), Vector3d(next_vertices[i]), k));
+
+    return bbox;
+}
+
 }   // namespace renderer
@@ -79,6 +79,31 @@ class TriangleItemHandler
         const double                            x);
 };
 
+
+//
+// Item handler for the spatio-temporal BVH builder.
+//
+
+class TriangleMotionItemHandler
+{
+  public:
+    TriangleMotionItemHandler(
+        const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
+        const std::vector<GVector3>&            triangle_vertices);
+
+    size_t size() const;
+
+    size_t get_motion_segment_count(const size_t item_index) const;
+
+    foundation::AABB3d compute_bbox(
+        const size_t                            item_index,
+        const double                            time) const;
+
+  private:
+    const std::vector<TriangleVertexInfo>&      m_triangle_vertex_infos;
+    const std::vector<GVector3>&                m_triangle_vertices;
+};
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_INTERSECTION_TRIANGLEITEMHANDLER_H
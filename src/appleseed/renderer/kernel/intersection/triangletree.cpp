@@ -33,6 +33,7 @@
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
 #include "renderer/kernel/intersection/intersectionfilter.h"
+#include "renderer/kernel/intersection/treecache.h"
 #include "renderer/kernel/intersection/triangleencoder.h"
 #include "renderer/kernel/intersection/triangleitemhandler.h"
 #include "renderer/kernel/intersection/trianglevertexinfo.h"
@@ -61,11 +62,13 @@
 #include "foundation/math/transform.h"
 #include "foundation/math/treeoptimizer.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
 #include "foundation/platform/system.h"
 #include "foundation/platform/timers.h"
 #include "foundation/utility/alignedallocator.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/foreach.h"
+#include "foundation/utility/job.h"
 #include "foundation/utility/makevector.h"
 #include "foundation/utility/memory.h"
 #include "foundation/utility/statistics.h"
@@ -75,6 +78,7 @@
 // Standard headers.
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <set>
 #include <string>
 
@@ -391,6 +395,63 @@ namespace
             }
         }
     }
+
+    bool has_moving_triangles(const TriangleTree::Arguments& arguments)
+    {
+        const size_t region_count = arguments.m_regions.size();
+
+        for (size_t i = 0; i < region_count; ++i)
+        {
+            const RegionInfo& region_info = arguments.m_regions[i];
+
+            const ObjectInstance* object_instance =
+                arguments.m_assembly.object_instances().get_by_index(
+                    region_info.get_object_instance_index());
+            assert(object_instance);
+
+            Access<RegionKit> region_kit(&object_instance->get_object().get_region_kit());
+            const IRegion* region = (*region_kit)[region_info.get_region_index()];
+            Access<StaticTriangleTess> tess(&region->get_static_triangle_tess());
+
+            if (tess->get_motion_segment_count() > 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    void hash_triangles(
+        const TriangleTree::Arguments&  arguments,
+        const double                    time,
+        const bool                      save_memory,
+        TreeCache&                      cache)
+    {
+        vector<TriangleKey> triangle_keys;
+        vector<TriangleVertexInfo> triangle_vertex_infos;
+        vector<GVector3> triangle_vertices;
+        collect_triangles<GAABB3>(
+            arguments,
+            time,
+            save_memory,
+            &triangle_keys,
+            &triangle_vertex_infos,
+            &triangle_vertices,
+            0);
+
+        // Vertex infos contain padding, only hash the fields that are not implied by the vertices.
+        vector<uint32> triangle_flags;
+        triangle_flags.reserve(triangle_vertex_infos.size() * 2);
+        for (size_t i = 0; i < triangle_vertex_infos.size(); ++i)
+        {
+            triangle_flags.push_back(static_cast<uint32>(triangle_vertex_infos[i].m_motion_segment_count));
+            triangle_flags.push_back(triangle_vertex_infos[i].m_vis_flags);
+        }
+
+        cache.hash(&arguments.m_bbox, sizeof(arguments.m_bbox));
+        cache.hash_vector(triangle_keys);
+        cache.hash_vector(triangle_flags);
+        cache.hash_vector(triangle_vertices);
+    }
 }
 
 TriangleTree::Arguments::Arguments(
@@ -415,25 +476,72 @@ TriangleTree::TriangleTree(const Arguments& arguments)
     const MessageContext message_context(
         format("while building triangle tree for assembly \"{0}\"", m_arguments.m_assembly.get_path()));
     const ParamArray& params = m_arguments.m_assembly.get_parameters().child("acceleration_structure");
+    const bool has_explicit_algorithm = params.strings().exist("algorithm");
     const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "sbvh"), message_context);
     const double time = params.get_optional<double>("time", 0.5);
     const bool save_memory = params.get_optional<bool>("save_temporary_memory", false);
+    const size_t max_time_split_depth = params.get_optional<size_t>("max_time_split_depth", TriangleTreeDefaultMaxTimeSplitDepth);
 
     // Start stopwatch.
     Stopwatch<DefaultWallclockTimer> stopwatch;
     stopwatch.start();
 
-    // Build the tree.
     Statistics statistics;
-    if (algorithm == "bvh")
-        build_bvh(params, time, save_memory, statistics);
-    else build_sbvh(params, time, save_memory, statistics);
+
+    // Look the tree up in the disk cache.
+    TreeCache cache("triangle tree", sizeof(NodeType), params);
+    bool loaded_from_cache = false;
+    if (cache.is_enabled())
+    {
+        hash_triangles(m_arguments, time, save_memory, cache);
+        loaded_from_cache = cache.load() && load_from_cache(cache);
+    }
+
+    if (loaded_from_cache)
+    {
+        RENDERER_LOG_INFO(
+            "loaded triangle tree #" FMT_UNIQUE_ID " (%s %s, %s %s) from %s.",
+            m_arguments.m_triangle_tree_uid,
+            pretty_uint(m_static_triangle_count).c_str(),
+            plural(m_static_triangle_count, "static triangle").c_str(),
+            pretty_uint(m_moving_triangle_count).c_str(),
+            plural(m_moving_triangle_count, "moving triangle").c_str(),
+            cache.get_path().c_str());
+        cache.insert_statistics(statistics, true, stopwatch.measure().get_seconds());
+    }
+    else
+    {
+        // Build the tree. Deforming geometry gets a spatio-temporal BVH,
+        // unless a specific algorithm was requested.
+        if (!has_explicit_algorithm &&
+            max_time_split_depth > 0 &&
+            has_moving_triangles(m_arguments))
+            build_stbvh(params, time, save_memory, statistics);
+        else if (algorithm == "bvh")
+            build_bvh(params, time, save_memory, statistics);
+        else build_sbvh(params, time, save_memory, statistics);
 
 #ifdef RENDERER_TRIANGLE_TREE_REORDER_NODES
-    // Optimize the tree layout in memory.
-    TreeOptimizer<NodeVectorType> tree_optimizer(m_nodes);
-    tree_optimizer.optimize_node_layout(TriangleTreeSubtreeDepth);
-    assert(m_nodes.size() == m_nodes.capacity());
+        // Optimize the tree layout in memory.
+        TreeOptimizer<NodeVectorType> tree_optimizer(m_nodes);
+        tree_optimizer.optimize_node_layout(TriangleTreeSubtreeDepth);
+        assert(m_nodes.size() == m_nodes.capacity());
+#endif
+
+        // Save the tree to the disk cache.
+        if (cache.is_enabled())
+        {
+            cache.insert_statistics(statistics, false, 0.0);
+            store_to_cache(cache, stopwatch.measure().get_seconds());
+        }
+    }
+
+#ifdef RENDERER_TRIANGLE_TREE_WIDE_BVH
+    // Collapse the binary tree into a wide tree.
+    bvh::WideBuilder<TriangleTree> wide_builder;
+    wide_builder.build<DefaultWallclockTimer>(*this);
+    statistics.insert("wide nodes", static_cast<uint64>(get_wide_node_count()));
+    statistics.insert_time("collapse time", wide_builder.get_build_time());
 #endif
 
     // Print triangle tree statistics.
@@ -472,6 +580,68 @@ size_t TriangleTree::get_memory_size() const
         + m_leaf_data.capacity() * sizeof(uint8);
 }
 
+namespace
+{
+    // Blocks of a cached triangle tree.
+    enum TriangleTreeCacheBlock
+    {
+        NodesBlock,
+        NodeBBoxesBlock,
+        TriangleCountsBlock,
+        TriangleKeysBlock,
+        LeafDataBlock
+    };
+}
+
+bool TriangleTree::load_from_cache(const TreeCache& cache)
+{
+    uint64 triangle_counts[2];
+
+    if (cache.read_vector(NodesBlock, m_nodes) &&
+        cache.read_vector(NodeBBoxesBlock, m_node_bboxes) &&
+        cache.read_block(TriangleCountsBlock, triangle_counts, sizeof(triangle_counts)) &&
+        cache.read_vector(TriangleKeysBlock, m_triangle_keys) &&
+        cache.read_vector(LeafDataBlock, m_leaf_data) &&
+        !m_nodes.empty())
+    {
+        m_static_triangle_count = static_cast<size_t>(triangle_counts[0]);
+        m_moving_triangle_count = static_cast<size_t>(triangle_counts[1]);
+        return true;
+    }
+
+    RENDERER_LOG_WARNING("ignoring invalid triangle tree cache file %s.", cache.get_path().c_str());
+
+    m_nodes.clear();
+    clear_release_memory(m_node_bboxes);
+    clear_release_memory(m_triangle_keys);
+    clear_release_memory(m_leaf_data);
+
+    return false;
+}
+
+void TriangleTree::store_to_cache(TreeCache& cache, const double build_time) const
+{
+    const uint64 triangle_counts[2] =
+    {
+        static_cast<uint64>(m_static_triangle_count),
+        static_cast<uint64>(m_moving_triangle_count)
+    };
+
+    cache.add_vector(m_nodes);
+    cache.add_vector(m_node_bboxes);
+    cache.add_block(triangle_counts, sizeof(triangle_counts));
+    cache.add_vector(m_triangle_keys);
+    cache.add_vector(m_leaf_data);
+
+    if (cache.store(build_time))
+    {
+        RENDERER_LOG_DEBUG(
+            "saved triangle tree #" FMT_UNIQUE_ID " to %s.",
+            m_arguments.m_triangle_tree_uid,
+            cache.get_path().c_str());
+    }
+}
+
 namespace
 {
     template <typename Vector>
@@ -505,6 +675,14 @@ namespace
 
         return count;
     }
+
+    size_t get_build_thread_count(const ParamArray& params)
+    {
+        const size_t thread_count =
+            params.get_optional<size_t>("build_threads", System::get_logical_cpu_core_count());
+
+        return max<size_t>(thread_count, 1);
+    }
 }
 
 void TriangleTree::build_bvh(
@@ -553,6 +731,7 @@ void TriangleTree::build_bvh(
     const size_t max_leaf_size = params.get_optional<size_t>("max_leaf_size", TriangleTreeDefaultMaxLeafSize);
     const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
     const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
+    const size_t thread_count = get_build_thread_count(params);
 
     // Create the partitioner.
     typedef bvh::SAHPartitioner<vector<GAABB3> > Partitioner;
@@ -602,6 +781,7 @@ void TriangleTree::build_bvh(
         triangle_vertex_infos,
         triangle_vertices,
         triangle_keys,
+        thread_count,
         statistics);
 
     const double storing_time = stopwatch.measure().get_seconds();
@@ -659,6 +839,7 @@ void TriangleTree::build_sbvh(
     const size_t bin_count = params.get_optional<size_t>("bin_count", TriangleTreeDefaultBinCount);
     const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
     const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
+    const size_t thread_count = get_build_thread_count(params);
 
     // Create the partitioner.
     typedef bvh::SBVHPartitioner<TriangleItemHandler, vector<AABB3d> > Partitioner;
@@ -679,8 +860,8 @@ void TriangleTree::build_sbvh(
     const AABB3d root_leaf_bbox = partitioner.compute_leaf_bbox(*root_leaf);
 
     // Build the tree.
-    typedef bvh::SpatialBuilder<TriangleTree, Partitioner> Builder;
-    Builder builder;
+    typedef bvh::ParallelSpatialBuilder<TriangleTree, Partitioner> Builder;
+    Builder builder(global_logger(), thread_count);
     builder.build<DefaultWallclockTimer>(
         *this,
         partitioner,
@@ -696,6 +877,8 @@ void TriangleTree::build_sbvh(
         "splits",
         "spatial " + pretty_uint(spatial_splits) + " (" + pretty_percent(spatial_splits, total_splits) + ")  "
         "object " + pretty_uint(object_splits) + " (" + pretty_percent(object_splits, total_splits) + ")");
+    statistics.insert("build threads", static_cast<uint64>(builder.get_thread_count()));
+    statistics.insert("subtrees", static_cast<uint64>(builder.get_subtree_count()));
 
     stopwatch.start();
 
@@ -715,6 +898,7 @@ void TriangleTree::build_sbvh(
         triangle_vertex_infos,
         triangle_vertices,
         triangle_keys,
+        thread_count,
         statistics);
 
     const double storing_time = stopwatch.measure().get_seconds();
@@ -724,49 +908,95 @@ void TriangleTree::build_sbvh(
     statistics.insert_time("store time", storing_time);
 }
 
-namespace
+void TriangleTree::build_stbvh(
+    const ParamArray&   params,
+    const double        time,
+    const bool          save_memory,
+    Statistics&         statistics)
 {
-#ifdef APPLESEED_USE_SSE
+    Stopwatch<DefaultWallclockTimer> stopwatch;
 
-    //
-    // If the bounding box is seen as a flat array of scalars, the swizzle()
-    // function converts the bounding box from
-    //
-    //   min.x  min.y  min.z  max.x  max.y  max.z
-    //
-    // to
-    //
-    //   min.x  max.x  min.y  max.y  min.z  max.z
-    //
+    // Collect triangles intersecting the bounding box of this tree.
+    RENDERER_LOG_INFO(
+        "collecting geometry for triangle tree #" FMT_UNIQUE_ID " from assembly \"%s\" (%s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        m_arguments.m_assembly.get_path().c_str(),
+        pretty_uint(m_arguments.m_regions.size()).c_str(),
+        plural(m_arguments.m_regions.size(), "region").c_str());
+    vector<TriangleKey> triangle_keys;
+    vector<TriangleVertexInfo> triangle_vertex_infos;
+    vector<GVector3> triangle_vertices;
+    stopwatch.start();
+    collect_triangles<GAABB3>(
+        m_arguments,
+        time,
+        save_memory,
+        &triangle_keys,
+        &triangle_vertex_infos,
+        &triangle_vertices,
+        0);
+    const double collection_time = stopwatch.measure().get_seconds();
 
-    template <typename T, size_t N>
-    AABB<T, N> swizzle(const AABB<T, N>& bbox)
-    {
-        AABB<T, N> result;
-        T* flat_result = &result[0][0];
+    // Store the number of static and moving triangles.
+    m_static_triangle_count = count_static_triangles(triangle_vertex_infos);
+    m_moving_triangle_count = triangle_vertex_infos.size() - m_static_triangle_count;
 
-        for (size_t i = 0; i < N; ++i)
-        {
-            flat_result[i * 2 + 0] = bbox[0][i];
-            flat_result[i * 2 + 1] = bbox[1][i];
-        }
+    // Print statistics about the input geometry.
+    RENDERER_LOG_INFO(
+        "building triangle tree #" FMT_UNIQUE_ID " (stbvh, %s %s, %s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        pretty_uint(m_static_triangle_count).c_str(),
+        plural(m_static_triangle_count, "static triangle").c_str(),
+        pretty_uint(m_moving_triangle_count).c_str(),
+        plural(m_moving_triangle_count, "moving triangle").c_str());
 
-        return result;
-    }
+    // Retrieving the builder parameters.
+    const size_t max_leaf_size = params.get_optional<size_t>("max_leaf_size", TriangleTreeDefaultMaxLeafSize);
+    const size_t bin_count = params.get_optional<size_t>("bin_count", TriangleTreeDefaultBinCount);
+    const size_t max_time_split_depth = params.get_optional<size_t>("max_time_split_depth", TriangleTreeDefaultMaxTimeSplitDepth);
+    const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
+    const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
+    const size_t thread_count = get_build_thread_count(params);
 
-#else
+    // Build the tree. The builder also computes the motion bounding boxes of the nodes.
+    TriangleMotionItemHandler triangle_handler(
+        triangle_vertex_infos,
+        triangle_vertices);
+    typedef bvh::TemporalBuilder<TriangleTree, TriangleMotionItemHandler> Builder;
+    Builder builder(
+        max_leaf_size,
+        bin_count,
+        max_time_split_depth,
+        interior_node_traversal_cost,
+        triangle_intersection_cost);
+    builder.build<DefaultWallclockTimer>(*this, triangle_handler);
+    statistics.merge(bvh::TreeStatistics<TriangleTree>(*this, AABB3d(m_arguments.m_bbox)));
 
-    //
-    // The swizzle() function has no effect when SSE is disabled.
-    //
+    // Add splits statistics.
+    const size_t time_splits = builder.get_time_split_count();
+    const size_t object_splits = builder.get_object_split_count();
+    const size_t total_splits = time_splits + object_splits;
+    statistics.insert(
+        "splits",
+        "time " + pretty_uint(time_splits) + " (" + pretty_percent(time_splits, total_splits) + ")  "
+        "object " + pretty_uint(object_splits) + " (" + pretty_percent(object_splits, total_splits) + ")");
 
-    template <typename T, size_t N>
-    AABB<T, N> swizzle(const AABB<T, N>& bbox)
-    {
-        return bbox;
-    }
+    stopwatch.start();
 
-#endif
+    // Store triangles and triangle keys into the tree.
+    store_triangles(
+        builder.get_item_ordering(),
+        triangle_vertex_infos,
+        triangle_vertices,
+        triangle_keys,
+        thread_count,
+        statistics);
+
+    const double storing_time = stopwatch.measure().get_seconds();
+
+    statistics.insert_time("collection time", collection_time);
+    statistics.insert_time("partition time", builder.get_build_time());
+    statistics.insert_time("store time", storing_time);
 }
 
 vector<GAABB3> TriangleTree::compute_motion_bboxes(
@@ -801,7 +1031,7 @@ vector<GAABB3> TriangleTree::compute_motion_bboxes(
             node.set_left_bbox_index(m_node_bboxes.size());
 
             for (vector<GAABB3>::const_iterator i = left_bboxes.begin(); i != left_bboxes.end(); ++i)
-                m_node_bboxes.push_back(swizzle(AABB3d(*i)));
+                m_node_bboxes.push_back(bvh::swizzle_motion_bbox(AABB3d(*i)));
         }
 
         if (right_bboxes.size() > 1)
@@ -809,7 +1039,7 @@ vector<GAABB3> TriangleTree::compute_motion_bboxes(
             node.set_right_bbox_index(m_node_bboxes.size());
 
             for (vector<GAABB3>::const_iterator i = right_bboxes.begin(); i != right_bboxes.end(); ++i)
-                m_node_bboxes.push_back(swizzle(AABB3d(*i)));
+                m_node_bboxes.push_back(bvh::swizzle_motion_bbox(AABB3d(*i)));
         }
 
         const size_t bbox_count = max(left_bboxes.size(), right_bboxes.size());
@@ -892,23 +1122,153 @@ vector<GAABB3> TriangleTree::compute_motion_bboxes(
     }
 }
 
+namespace
+{
+    //
+    // Encode the triangles of a contiguous range of nodes.
+    //
+
+    class StoreTrianglesJob
+      : public IJob
+    {
+      public:
+        StoreTrianglesJob(
+            TriangleTree::NodeType*             nodes,
+            const size_t                        node_begin,
+            const size_t                        node_end,
+            const size_t                        key_begin,
+            const size_t                        leaf_data_begin,
+            const vector<size_t>&               triangle_indices,
+            const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+            const vector<GVector3>&             triangle_vertices,
+            const vector<TriangleKey>&          triangle_keys,
+            TriangleKey*                        stored_triangle_keys,
+            uint8*                              leaf_data)
+          : m_nodes(nodes)
+          , m_node_begin(node_begin)
+          , m_node_end(node_end)
+          , m_key_begin(key_begin)
+          , m_leaf_data_begin(leaf_data_begin)
+          , m_triangle_indices(triangle_indices)
+          , m_triangle_vertex_infos(triangle_vertex_infos)
+          , m_triangle_vertices(triangle_vertices)
+          , m_triangle_keys(triangle_keys)
+          , m_stored_triangle_keys(stored_triangle_keys)
+          , m_leaf_data(leaf_data)
+        {
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            typedef TriangleTree::NodeType NodeType;
+
+            size_t key_index = m_key_begin;
+            MemoryWriter leaf_data_writer(m_leaf_data ? m_leaf_data + m_leaf_data_begin : 0);
+
+            for (size_t i = m_node_begin; i < m_node_end; ++i)
+            {
+                NodeType& node = m_nodes[i];
+
+                if (node.is_leaf())
+                {
+                    const size_t item_begin = node.get_item_index();
+                    const size_t item_count = node.get_item_count();
+
+                    node.set_item_index(key_index);
+
+                    for (size_t j = 0; j < item_count; ++j)
+                    {
+                        const size_t triangle_index = m_triangle_indices[item_begin + j];
+                        m_stored_triangle_keys[key_index++] = m_triangle_keys[triangle_index];
+                    }
+
+                    const size_t leaf_size =
+                        TriangleEncoder::compute_size(
+                            m_triangle_vertex_infos,
+                            m_triangle_indices,
+                            item_begin,
+                            item_count);
+
+                    MemoryWriter user_data_writer(&node.get_user_data<uint8>());
+
+                    if (leaf_size <= NodeType::MaxUserDataSize - sizeof(uint32))
+                    {
+                        user_data_writer.write<uint32>(~0);
+
+                        TriangleEncoder::encode(
+                            m_triangle_vertex_infos,
+                            m_triangle_vertices,
+                            m_triangle_indices,
+                            item_begin,
+                            item_count,
+                            user_data_writer);
+                    }
+                    else
+                    {
+                        user_data_writer.write(
+                            static_cast<uint32>(m_leaf_data_begin + leaf_data_writer.offset()));
+
+                        TriangleEncoder::encode(
+                            m_triangle_vertex_infos,
+                            m_triangle_vertices,
+                            m_triangle_indices,
+                            item_begin,
+                            item_count,
+                            leaf_data_writer);
+                    }
+                }
+            }
+        }
+
+      private:
+        TriangleTree::NodeType*             m_nodes;
+        const size_t                        m_node_begin;
+        const size_t                        m_node_end;
+        const size_t                        m_key_begin;
+        const size_t                        m_leaf_data_begin;
+        const vector<size_t>&               m_triangle_indices;
+        const vector<TriangleVertexInfo>&   m_triangle_vertex_infos;
+        const vector<GVector3>&             m_triangle_vertices;
+        const vector<TriangleKey>&          m_triangle_keys;
+        TriangleKey*                        m_stored_triangle_keys;
+        uint8*                              m_leaf_data;
+    };
+}
+
 void TriangleTree::store_triangles(
     const vector<size_t>&               triangle_indices,
     const vector<TriangleVertexInfo>&   triangle_vertex_infos,
     const vector<GVector3>&             triangle_vertices,
     const vector<TriangleKey>&          triangle_keys,
+    const size_t                        thread_count,
     Statistics&                         statistics)
 {
     const size_t node_count = m_nodes.size();
 
-    // Gather statistics.
+    // Split the nodes into contiguous ranges, several per thread for load balancing.
+    const size_t NodeRangesPerThread = 16;
+    const size_t node_range_size =
+        max<size_t>((node_count + thread_count * NodeRangesPerThread - 1) / (thread_count * NodeRangesPerThread), 1);
+    const size_t node_range_count = (node_count + node_range_size - 1) / node_range_size;
+
+    // Gather statistics and compute where each range of nodes stores its data.
 
     size_t leaf_count = 0;
     size_t fat_leaf_count = 0;
+    size_t key_count = 0;
     size_t leaf_data_size = 0;
 
+    vector<size_t> range_key_begin(node_range_count);
+    vector<size_t> range_leaf_data_begin(node_range_count);
+
     for (size_t i = 0; i < node_count; ++i)
     {
+        if (i % node_range_size == 0)
+        {
+            range_key_begin[i / node_range_size] = key_count;
+            range_leaf_data_begin[i / node_range_size] = leaf_data_size;
+        }
+
         const NodeType& node = m_nodes[i];
 
         if (node.is_leaf())
@@ -918,6 +1278,8 @@ void TriangleTree::store_triangles(
             const size_t item_begin = node.get_item_index();
             const size_t item_count = node.get_item_count();
 
+            key_count += item_count;
+
             const size_t leaf_size =
                 TriangleEncoder::compute_size(
                     triangle_vertex_infos,
@@ -925,7 +1287,7 @@ void TriangleTree::store_triangles(
                     item_begin,
                     item_count);
 
-            if (leaf_size < NodeType::MaxUserDataSize)
+            if (leaf_size <= NodeType::MaxUserDataSize - sizeof(uint32))
                 ++fat_leaf_count;
             else leaf_data_size += leaf_size;
         }
@@ -933,64 +1295,32 @@ void TriangleTree::store_triangles(
 
     // Store triangle keys and triangles.
 
-    m_triangle_keys.reserve(triangle_indices.size());
+    m_triangle_keys.resize(key_count);
     m_leaf_data.resize(leaf_data_size);
 
-    MemoryWriter leaf_data_writer(m_leaf_data.empty() ? 0 : &m_leaf_data[0]);
+    JobQueue job_queue;
+    JobManager job_manager(global_logger(), job_queue, thread_count);
 
-    for (size_t i = 0; i < node_count; ++i)
+    for (size_t i = 0; i < node_range_count; ++i)
     {
-        NodeType& node = m_nodes[i];
-
-        if (node.is_leaf())
-        {
-            const size_t item_begin = node.get_item_index();
-            const size_t item_count = node.get_item_count();
-
-            node.set_item_index(m_triangle_keys.size());
-
-            for (size_t j = 0; j < item_count; ++j)
-            {
-                const size_t triangle_index = triangle_indices[item_begin + j];
-                m_triangle_keys.push_back(triangle_keys[triangle_index]);
-            }
-
-            const size_t leaf_size =
-                TriangleEncoder::compute_size(
-                    triangle_vertex_infos,
-                    triangle_indices,
-                    item_begin,
-                    item_count);
-
-            MemoryWriter user_data_writer(&node.get_user_data<uint8>());
-
-            if (leaf_size <= NodeType::MaxUserDataSize - sizeof(uint32))
-            {
-                user_data_writer.write<uint32>(~0);
-
-                TriangleEncoder::encode(
-                    triangle_vertex_infos,
-                    triangle_vertices,
-                    triangle_indices,
-                    item_begin,
-                    item_count,
-                    user_data_writer);
-            }
-            else
-            {
-                user_data_writer.write(static_cast<uint32>(leaf_data_writer.offset()));
-
-                TriangleEncoder::encode(
-                    triangle_vertex_infos,
-                    triangle_vertices,
-                    triangle_indices,
-                    item_begin,
-                    item_count,
-                    leaf_data_writer);
-            }
-        }
+        job_queue.schedule(
+            new StoreTrianglesJob(
+                &m_nodes[0],
+                i * node_range_size,
+                min(node_count, (i + 1) * node_range_size),
+                range_key_begin[i],
+                range_leaf_data_begin[i],
+                triangle_indices,
+                triangle_vertex_infos,
+                triangle_vertices,
+                triangle_keys,
+                m_triangle_keys.empty() ? 0 : &m_triangle_keys[0],
+                m_leaf_data.empty() ? 0 : &m_leaf_data[0]));
     }
 
+    job_manager.start();
+    job_queue.wait_until_completion();
+
     statistics.insert_percent("fat leaves", fat_leaf_count, leaf_count);
 }
 
@@ -1347,6 +1677,21 @@ namespace
     typedef TriangleReaderImpl<
         sizeof(GTriangleType::ValueType) == sizeof(TriangleType::ValueType)
     > TriangleReader;
+
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+    // Convert a ray to the format used for packet intersection.
+    Ray3f make_packet_ray(const Ray3d& ray)
+    {
+        return
+            Ray3f(
+                Vector3f(ray.m_org),
+                Vector3f(ray.m_dir),
+                static_cast<float>(ray.m_tmin),
+                static_cast<float>(min<double>(ray.m_tmax, numeric_limits<float>::max())));
+    }
+
+#endif
 }
 
 
@@ -1373,6 +1718,79 @@ bool TriangleLeafVisitor::visit(
             : &m_tree.m_leaf_data[leaf_data_index];     // triangles are stored in the tree
     MemoryReader reader(leaf_data);
 
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+    const size_t item_begin = node.get_item_index();
+    const uint32 packet_count = reader.read<uint32>();
+
+    if (packet_count > 0)
+    {
+        Ray3f packet_ray = make_packet_ray(ray);
+        const TrianglePacketType::RayInfoType packet_ray_info(packet_ray);
+
+        // Intersect the static triangles of the leaf, one packet at a time.
+        for (uint32 packet_index = 0; packet_index < packet_count; ++packet_index)
+        {
+            FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+            const TrianglePacketRecord& record = reader.read<TrianglePacketRecord>();
+
+            float t[TriangleTreePacketWidth], u[TriangleTreePacketWidth], v[TriangleTreePacketWidth];
+            const uint32 hits = record.m_packet.intersect(packet_ray, packet_ray_info, t, u, v);
+
+            if (hits == 0)
+                continue;
+
+            // Keep the closest visible hit accepted by intersection filters.
+            for (size_t slot = 0; slot < TriangleTreePacketWidth; ++slot)
+            {
+                if (!(hits & (uint32(1) << slot)))
+                    continue;
+
+                // Check visibility flags.
+                if (!(record.m_vis_flags[slot] & m_shading_point.m_ray.m_flags))
+                    continue;
+
+                // Reject hits farther than the closest hit found so far in this packet.
+                if (t[slot] >= packet_ray.m_tmax)
+                    continue;
+
+                const size_t triangle_index = item_begin + record.m_item_offsets[slot];
+
+                // Optionally filter intersections.
+                if (m_has_intersection_filters)
+                {
+                    const TriangleKey& triangle_key = m_tree.m_triangle_keys[triangle_index];
+                    const IntersectionFilter* filter =
+                        m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
+                    if (filter && !filter->accept(triangle_key, u[slot], v[slot]))
+                        continue;
+                }
+
+                TrianglePacketType::VectorType v0, v1, v2;
+                record.m_packet.get(slot, v0, v1, v2);
+
+                m_interpolated_triangle = GTriangleType(GVector3(v0), GVector3(v1), GVector3(v2));
+                m_hit_triangle = &m_interpolated_triangle;
+                m_hit_triangle_index = triangle_index;
+                packet_ray.m_tmax = t[slot];
+                m_shading_point.m_ray.m_tmax = t[slot];
+                m_shading_point.m_bary[0] = u[slot];
+                m_shading_point.m_bary[1] = v[slot];
+            }
+        }
+    }
+
+    // Sequentially intersect the moving triangles of the leaf.
+    for (uint32 triangle_count = reader.read<uint32>(); triangle_count--; )
+    {
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Retrieve the triangle's index.
+        const size_t triangle_index = item_begin + reader.read<uint32>();
+
+#else
+
     // Sequentially intersect all triangles of the leaf.
     for (size_t triangle_index = node.get_item_index(),
                 triangle_count = node.get_item_count();
@@ -1381,6 +1799,8 @@ bool TriangleLeafVisitor::visit(
     {
         FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
 
+#endif
+
         // Retrieve the triangle's visibility flags.
         const uint32 vis_flags = reader.read<uint32>();
 
@@ -1505,6 +1925,59 @@ void TriangleLeafVisitor::read_hit_triangle_data() const
 }
 
 
+//
+// TriangleLeafPacketVisitor class implementation.
+//
+
+size_t TriangleLeafPacketVisitor::visit(
+    const TriangleTree::NodeType&           node,
+    const Ray3d                             rays[],
+    const RayInfo3d                         ray_infos[],
+    const size_t                            active_mask,
+    double                                  distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&             stats
+#endif
+    )
+{
+    size_t proceed_mask = active_mask;
+
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (!(active_mask & (size_t(1) << i)))
+            continue;
+
+        assert(m_visitors[i]);
+
+        // The shading point's ray carries the distance to the closest hit found so far.
+        const bool proceed =
+            m_visitors[i]->visit(
+                node,
+                m_shading_points[i]->m_ray,
+                ray_infos[i],
+                distances[i]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+
+        if (!proceed)
+            proceed_mask &= ~(size_t(1) << i);
+    }
+
+    return proceed_mask;
+}
+
+void TriangleLeafPacketVisitor::read_hit_triangle_data() const
+{
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (m_visitors[i])
+            m_visitors[i]->read_hit_triangle_data();
+    }
+}
+
+
 //
 // TriangleLeafProbeVisitor class implementation.
 //
@@ -1528,11 +2001,57 @@ bool TriangleLeafProbeVisitor::visit(
             : &m_tree.m_leaf_data[leaf_data_index];     // triangles are stored in the tree
     MemoryReader reader(leaf_data);
 
+#ifdef RENDERER_TRIANGLE_TREE_WATERTIGHT_PACKETS
+
+    const uint32 packet_count = reader.read<uint32>();
+
+    if (packet_count > 0)
+    {
+        const Ray3f packet_ray = make_packet_ray(ray);
+        const TrianglePacketType::RayInfoType packet_ray_info(packet_ray);
+
+        // Intersect the static triangles of the leaf, one packet at a time.
+        for (uint32 packet_index = 0; packet_index < packet_count; ++packet_index)
+        {
+            FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+            const TrianglePacketRecord& record = reader.read<TrianglePacketRecord>();
+
+            float t[TriangleTreePacketWidth], u[TriangleTreePacketWidth], v[TriangleTreePacketWidth];
+            const uint32 hits = record.m_packet.intersect(packet_ray, packet_ray_info, t, u, v);
+
+            if (hits == 0)
+                continue;
+
+            // Check visibility flags.
+            for (size_t slot = 0; slot < TriangleTreePacketWidth; ++slot)
+            {
+                if ((hits & (uint32(1) << slot)) && (record.m_vis_flags[slot] & m_ray_flags))
+                {
+                    m_hit = true;
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Sequentially intersect moving triangles until a hit is found.
+    for (uint32 triangle_count = reader.read<uint32>(); triangle_count--; )
+    {
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Skip the triangle's index.
+        reader += sizeof(uint32);
+
+#else
+
     // Sequentially intersect triangles until a hit is found.
     for (size_t triangle_count = node.get_item_count(); triangle_count--; )
     {
         FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
 
+#endif
+
         // Retrieve the triangle's visibility flags.
         const uint32 vis_flags = reader.read<uint32>();
 
@@ -44,6 +44,7 @@
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
 #include "foundation/math/ray.h"
+#include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/lazy.h"
@@ -54,6 +55,7 @@
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <new>
 #include <vector>
 
 // Forward declarations.
@@ -63,6 +65,7 @@ namespace renderer      { class IntersectionFilter; }
 namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
 namespace renderer      { class ShadingPoint; }
+namespace renderer      { class TreeCache; }
 
 namespace renderer
 {
@@ -75,11 +78,20 @@ typedef std::map<foundation::uint64, IntersectionFilter*> IntersectionFilterRepo
 //
 
 class TriangleTree
+#ifdef RENDERER_TRIANGLE_TREE_WIDE_BVH
+  : public foundation::bvh::WideTree<
+               foundation::AlignedVector<
+                   foundation::bvh::Node<foundation::AABB3d>
+               >,
+               TriangleTreeWideNodeWidth
+           >
+#else
   : public foundation::bvh::Tree<
                foundation::AlignedVector<
                    foundation::bvh::Node<foundation::AABB3d>
                >
            >
+#endif
 {
   public:
     // Construction arguments.
@@ -143,6 +155,18 @@ class TriangleTree
         const bool                              save_memory,
         foundation::Statistics&                 statistics);
 
+    void build_stbvh(
+        const ParamArray&                       params,
+        const double                            time,
+        const bool                              save_memory,
+        foundation::Statistics&                 statistics);
+
+    bool load_from_cache(const TreeCache& cache);
+
+    void store_to_cache(
+        TreeCache&                              cache,
+        const double                            build_time) const;
+
     std::vector<GAABB3> compute_motion_bboxes(
         const std::vector<size_t>&              triangle_indices,
         const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
@@ -154,6 +178,7 @@ class TriangleTree
         const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
         const std::vector<GVector3>&            triangle_vertices,
         const std::vector<TriangleKey>&         triangle_keys,
+        const size_t                            thread_count,
         foundation::Statistics&                 statistics);
 
     void update_intersection_filters();
@@ -239,6 +264,49 @@ class TriangleLeafVisitor
 };
 
 
+//
+// Triangle leaf visitor for packets of rays, used during packet tree intersection.
+// Leaves are fetched once for the whole packet and intersected ray by ray.
+//
+
+class TriangleLeafPacketVisitor
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. Only the shading points of the rays set in 'active_mask' are used.
+    TriangleLeafPacketVisitor(
+        const TriangleTree&                     tree,
+        ShadingPoint* const                     shading_points[],
+        const size_t                            active_mask);
+
+    // Destructor.
+    ~TriangleLeafPacketVisitor();
+
+    // Visit a leaf.
+    size_t visit(
+        const TriangleTree::NodeType&           node,
+        const foundation::Ray3d                 rays[],
+        const foundation::RayInfo3d             ray_infos[],
+        const size_t                            active_mask,
+        double                                  distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& stats
+#endif
+        );
+
+    // Read additional data about the triangles that were hit, if any.
+    void read_hit_triangle_data() const;
+
+  private:
+    const size_t            m_active_mask;
+    ShadingPoint*           m_shading_points[RayPacketSize];
+    TriangleLeafVisitor*    m_visitors[RayPacketSize];
+
+    // Storage for the per-ray visitors.
+    APPLESEED_SIMD4_ALIGN foundation::uint8 m_visitor_storage[RayPacketSize * sizeof(TriangleLeafVisitor)];
+};
+
+
 //
 // Triangle leaf visitor for probe rays, only return boolean answers
 // (whether an intersection was found or not).
@@ -277,6 +345,24 @@ class TriangleLeafProbeVisitor
 // Triangle tree intersectors.
 //
 
+#ifdef RENDERER_TRIANGLE_TREE_WIDE_BVH
+
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleLeafVisitor,
+    foundation::Ray3d,
+    TriangleTreeStackSize
+> TriangleTreeIntersector;
+
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleLeafProbeVisitor,
+    foundation::Ray3d,
+    TriangleTreeStackSize
+> TriangleTreeProbeIntersector;
+
+#else
+
 typedef foundation::bvh::Intersector<
     TriangleTree,
     TriangleLeafVisitor,
@@ -291,6 +377,16 @@ typedef foundation::bvh::Intersector<
     TriangleTreeStackSize
 > TriangleTreeProbeIntersector;
 
+#endif
+
+typedef foundation::bvh::PacketIntersector<
+    TriangleTree,
+    TriangleLeafPacketVisitor,
+    foundation::Ray3d,
+    RayPacketSize,
+    TriangleTreeStackSize
+> TriangleTreePacketIntersector;
+
 
 //
 // TriangleTree class implementation.
@@ -322,6 +418,43 @@ inline TriangleLeafVisitor::TriangleLeafVisitor(
 }
 
 
+//
+// TriangleLeafPacketVisitor class implementation.
+//
+
+inline TriangleLeafPacketVisitor::TriangleLeafPacketVisitor(
+    const TriangleTree&         tree,
+    ShadingPoint* const         shading_points[],
+    const size_t                active_mask)
+  : m_active_mask(active_mask)
+{
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (m_active_mask & (size_t(1) << i))
+        {
+            m_shading_points[i] = shading_points[i];
+            m_visitors[i] =
+                new (m_visitor_storage + i * sizeof(TriangleLeafVisitor))
+                    TriangleLeafVisitor(tree, *shading_points[i]);
+        }
+        else
+        {
+            m_shading_points[i] = 0;
+            m_visitors[i] = 0;
+        }
+    }
+}
+
+inline TriangleLeafPacketVisitor::~TriangleLeafPacketVisitor()
+{
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (m_visitors[i])
+            m_visitors[i]->~TriangleLeafVisitor();
+    }
+}
+
+
 //
 // TriangleLeafProbeVisitor class implementation.
 //
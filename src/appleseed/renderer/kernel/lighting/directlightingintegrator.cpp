@@ -167,6 +167,7 @@ void DirectLightingIntegrator::compute_outgoing_radiance_light_sampling(
         m_light_sampler.sample(
             m_time,
             sampling_context.next2<Vector3f>(),
+            m_point,
             sample);
 
         if (sample.m_triangle)
@@ -222,6 +223,7 @@ void DirectLightingIntegrator::compute_outgoing_radiance_light_sampling_low_vari
             m_light_sampler.sample_emitting_triangles(
                 m_time,
                 sampling_context.next2<Vector3f>(),
+                m_point,
                 sample);
 
             add_emitting_triangle_sample_contribution(
@@ -315,6 +317,7 @@ bool DirectLightingIntegrator::compute_incoming_radiance(
     m_light_sampler.sample(
         m_time,
         sampling_context.next2<Vector3f>(),
+        m_point,
         sample);
 
     if (sample.m_triangle)
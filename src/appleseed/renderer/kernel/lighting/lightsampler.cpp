@@ -34,6 +34,7 @@
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/lighttree.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/kernel/shading/shadingray.h"
 #include "renderer/kernel/tessellation/statictessellation.h"
@@ -55,13 +56,16 @@
 // appleseed.foundation headers.
 #include "foundation/math/sampling/mappings.h"
 #include "foundation/math/scalar.h"
+#include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/foreach.h"
 #include "foundation/utility/lazy.h"
+#include "foundation/utility/makevector.h"
 #include "foundation/utility/string.h"
 
 // Standard headers.
 #include <cassert>
 #include <string>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -133,6 +137,10 @@ LightSampler::LightSampler(const Scene& scene, const ParamArray& params)
     for (size_t i = 0; i < emitting_triangle_count; ++i)
         m_emitting_triangles[i].m_triangle_prob = m_emitting_triangles_cdf[i].second;
 
+    // Build the light tree.
+    if (m_params.m_use_light_tree && m_emitting_triangles_cdf.valid())
+        build_light_tree();
+
    RENDERER_LOG_INFO(
         "found %s %s, %s emitting %s.",
         pretty_int(m_non_physical_light_count).c_str(),
@@ -141,6 +149,47 @@ LightSampler::LightSampler(const Scene& scene, const ParamArray& params)
         plural(m_emitting_triangles.size(), "triangle").c_str());
 }
 
+LightSampler::~LightSampler()
+{
+}
+
+Dictionary LightSampler::get_params_metadata()
+{
+    Dictionary metadata;
+
+    metadata.dictionaries().insert(
+        "algorithm",
+        Dictionary()
+            .insert("type", "enum")
+            .insert("values", "cdf|lighttree")
+            .insert("default", "cdf")
+            .insert("label", "Light Sampler")
+            .insert("help", "Method used to choose emitting triangles")
+            .insert(
+                "options",
+                Dictionary()
+                    .insert(
+                        "cdf",
+                        Dictionary()
+                            .insert("label", "CDF")
+                            .insert("help", "Choose emitting triangles according to their importance only"))
+                    .insert(
+                        "lighttree",
+                        Dictionary()
+                            .insert("label", "Light Tree")
+                            .insert("help", "Choose emitting triangles according to their estimated contribution"))));
+
+    metadata.dictionaries().insert(
+        "enable_importance_sampling",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Importance Sampling")
+            .insert("help", "Weight emitting triangles by their area"));
+
+    return metadata;
+}
+
 void LightSampler::collect_non_physical_lights(
     const AssemblyInstanceContainer&    assembly_instances,
     const TransformSequence&            parent_transform_seq)
@@ -424,6 +473,23 @@ void LightSampler::build_emitting_triangle_hash_table()
     }
 }
 
+void LightSampler::build_light_tree()
+{
+    const size_t emitting_triangle_count = m_emitting_triangles.size();
+
+    vector<float> importances(emitting_triangle_count);
+    for (size_t i = 0; i < emitting_triangle_count; ++i)
+        importances[i] = m_emitting_triangles[i].m_triangle_prob;
+
+    m_light_tree.reset(new LightTree(m_emitting_triangles, importances));
+
+    RENDERER_LOG_INFO(
+        "built light tree with %s %s (depth %s).",
+        pretty_uint(m_light_tree->get_node_count()).c_str(),
+        plural(m_light_tree->get_node_count(), "node").c_str(),
+        pretty_uint(m_light_tree->get_depth()).c_str());
+}
+
 void LightSampler::sample_non_physical_lights(
     const ShadingRay::Time&             time,
     const Vector3f&                     s,
@@ -469,6 +535,34 @@ void LightSampler::sample_emitting_triangles(
     assert(light_sample.m_probability > 0.0f);
 }
 
+void LightSampler::sample_emitting_triangles(
+    const ShadingRay::Time&             time,
+    const Vector3f&                     s,
+    const Vector3d&                     point,
+    LightSample&                        light_sample) const
+{
+    if (m_light_tree.get() == 0)
+    {
+        sample_emitting_triangles(time, s, light_sample);
+        return;
+    }
+
+    const LightTree::ItemProbabilityPair result = m_light_tree->sample(point, s[0]);
+    const size_t emitter_index = result.first;
+    const float emitter_prob = result.second;
+
+    light_sample.m_light = 0;
+    sample_emitting_triangle(
+        time,
+        Vector2f(s[1], s[2]),
+        emitter_index,
+        emitter_prob,
+        light_sample);
+
+    assert(light_sample.m_triangle);
+    assert(light_sample.m_probability > 0.0f);
+}
+
 void LightSampler::sample(
     const ShadingRay::Time&             time,
     const Vector3f&                     s,
@@ -502,6 +596,41 @@ void LightSampler::sample(
     else sample_emitting_triangles(time, s, light_sample);
 }
 
+void LightSampler::sample(
+    const ShadingRay::Time&             time,
+    const Vector3f&                     s,
+    const Vector3d&                     point,
+    LightSample&                        light_sample) const
+{
+    assert(m_non_physical_lights_cdf.valid() || m_emitting_triangles_cdf.valid());
+
+    if (m_non_physical_lights_cdf.valid())
+    {
+        if (m_emitting_triangles_cdf.valid())
+        {
+            if (s[0] < 0.5f)
+            {
+                sample_non_physical_lights(
+                    time,
+                    Vector3f(s[0] * 2.0f, s[1], s[2]),
+                    light_sample);
+            }
+            else
+            {
+                sample_emitting_triangles(
+                    time,
+                    Vector3f((s[0] - 0.5f) * 2.0f, s[1], s[2]),
+                    point,
+                    light_sample);
+            }
+
+            light_sample.m_probability *= 0.5f;
+        }
+        else sample_non_physical_lights(time, s, light_sample);
+    }
+    else sample_emitting_triangles(time, s, point, light_sample);
+}
+
 float LightSampler::evaluate_pdf(const ShadingPoint& shading_point) const
 {
     assert(shading_point.is_triangle_primitive());
@@ -513,6 +642,15 @@ float LightSampler::evaluate_pdf(const ShadingPoint& shading_point) const
         shading_point.get_primitive_index());
 
     const EmittingTriangle* triangle = m_emitting_triangle_hash_table.get(triangle_key);
+
+    if (m_light_tree.get())
+    {
+        const size_t triangle_index = triangle - &m_emitting_triangles[0];
+        const float triangle_prob =
+            m_light_tree->evaluate_pdf(shading_point.get_ray().m_org, triangle_index);
+        return triangle_prob * triangle->m_rcp_area;
+    }
+
     return triangle->m_triangle_prob * triangle->m_rcp_area;
 }
 
@@ -544,7 +682,7 @@ void LightSampler::sample_emitting_triangle(
 {
     // Fetch the emitting triangle.
     const EmittingTriangle& emitting_triangle = m_emitting_triangles[triangle_index];
-    assert(emitting_triangle.m_triangle_prob == triangle_prob);
+    assert(m_light_tree.get() || emitting_triangle.m_triangle_prob == triangle_prob);
 
     // Store a pointer to the emitting triangle.
     light_sample.m_triangle = &emitting_triangle;
@@ -602,6 +740,11 @@ void LightSampler::store_object_area_in_shadergroups(
 
 LightSampler::Parameters::Parameters(const ParamArray& params)
   : m_importance_sampling(params.get_optional<bool>("enable_importance_sampling", false))
+  , m_use_light_tree(
+        params.get_optional<string>(
+            "algorithm",
+            "cdf",
+            make_vector("cdf", "lighttree")) == "lighttree")
 {
 }
 
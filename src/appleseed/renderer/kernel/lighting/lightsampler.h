@@ -48,13 +48,16 @@
 
 // Standard headers.
 #include <cstddef>
+#include <memory>
 #include <vector>
 
 // Forward declarations.
+namespace foundation    { class Dictionary; }
 namespace renderer  { class Assembly; }
 namespace renderer  { class AssemblyInstance; }
 namespace renderer  { class Intersector; }
 namespace renderer  { class Light; }
+namespace renderer  { class LightTree; }
 namespace renderer  { class Material; }
 namespace renderer  { class MaterialArray; }
 namespace renderer  { class ObjectInstance; }
@@ -171,6 +174,11 @@ class LightSample
 // The light sampler collects all the light-emitting entities (non-physical lights, mesh lights)
 // and allows to sample them.
 //
+// Emitting triangles are either sampled in proportion to their importance using a flat CDF
+// (the default), or, when the "algorithm" parameter is set to "lighttree", in proportion to
+// their estimated contribution at the point being lit using a light tree. Samplers without
+// a point to light (photon and light tracing) always use the flat CDF.
+//
 
 class LightSampler
   : public foundation::NonCopyable
@@ -181,6 +189,12 @@ class LightSampler
         const Scene&                        scene,
         const ParamArray&                   params = ParamArray());
 
+    // Destructor.
+    ~LightSampler();
+
+    // Return the metadata of the light sampler parameters.
+    static foundation::Dictionary get_params_metadata();
+
     // Return the number of non-physical lights in the scene.
     size_t get_non_physical_light_count() const;
 
@@ -208,19 +222,36 @@ class LightSampler
         const foundation::Vector3f&         s,
         LightSample&                        light_sample) const;
 
+    // Sample the set of emitting triangles as seen from a given point.
+    void sample_emitting_triangles(
+        const ShadingRay::Time&             time,
+        const foundation::Vector3f&         s,
+        const foundation::Vector3d&         point,
+        LightSample&                        light_sample) const;
+
     // Sample the sets of non-physical lights and emitting triangles.
     void sample(
         const ShadingRay::Time&             time,
         const foundation::Vector3f&         s,
         LightSample&                        light_sample) const;
 
+    // Sample the sets of non-physical lights and emitting triangles as seen from a given point.
+    void sample(
+        const ShadingRay::Time&             time,
+        const foundation::Vector3f&         s,
+        const foundation::Vector3d&         point,
+        LightSample&                        light_sample) const;
+
     // Compute the probability density in area measure of a given light sample.
+    // When the light tree is used, the point the light is seen from is the origin
+    // of the ray that hit the light.
     float evaluate_pdf(const ShadingPoint& shading_point) const;
 
   private:
     struct Parameters
     {
         const bool m_importance_sampling;
+        const bool m_use_light_tree;
 
         explicit Parameters(const ParamArray& params);
     };
@@ -242,6 +273,8 @@ class LightSampler
     EmittingTriangleKeyHasher   m_triangle_key_hasher;
     EmittingTriangleHashTable   m_emitting_triangle_hash_table;
 
+    std::auto_ptr<LightTree>    m_light_tree;
+
     // Recursively collect non-physical lights from a given set of assembly instances.
     void collect_non_physical_lights(
         const AssemblyInstanceContainer&    assembly_instances,
@@ -266,6 +299,9 @@ class LightSampler
     // Build a hash table that allows to find the emitting triangle at a given shading point.
     void build_emitting_triangle_hash_table();
 
+    // Build the light tree over the emitting triangles.
+    void build_light_tree();
+
     // Sample a given non-physical light.
     void sample_non_physical_light(
         const ShadingRay::Time&             time,
@@ -241,7 +241,19 @@ namespace
             stats.insert("path count", m_path_count);
             stats.insert("path length", m_path_length);
 
-            return StatisticsVector::make("light tracing statistics", stats);
+            Population<uint64> arena_high_water_mark;
+            arena_high_water_mark.insert(m_arena.get_high_water_mark());
+            Population<uint64> arena_block_count;
+            arena_block_count.insert(m_arena.get_block_count());
+
+            Statistics arena_stats;
+            arena_stats.insert("high-water mark", arena_high_water_mark, "bytes");
+            arena_stats.insert("blocks", arena_block_count);
+
+            StatisticsVector vec;
+            vec.insert("light tracing statistics", stats);
+            vec.insert("arena statistics", arena_stats);
+            return vec;
         }
 
       private:
@@ -0,0 +1,358 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Interface header.
+#include "lighttree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    const uint32 NoParent = ~uint32(0);
+
+    // Largest float strictly smaller than 1.
+    const float OneMinusEpsilon = 0.99999994f;
+
+    struct CentroidOrder
+    {
+        const size_t m_dim;
+
+        explicit CentroidOrder(const size_t dim)
+          : m_dim(dim)
+        {
+        }
+
+        template <typename Item>
+        bool operator()(const Item& lhs, const Item& rhs) const
+        {
+            return lhs.m_centroid[m_dim] < rhs.m_centroid[m_dim];
+        }
+    };
+
+    float angle_between(const Vector3f& a, const Vector3f& b)
+    {
+        return acos(clamp(dot(a, b), -1.0f, 1.0f));
+    }
+
+    // Compute a cone of directions bounding two given cones.
+    void merge_cones(
+        const Vector3f&     axis_a,
+        const float         theta_a,
+        const Vector3f&     axis_b,
+        const float         theta_b,
+        Vector3f&           axis,
+        float&              theta)
+    {
+        if (theta_a < theta_b)
+        {
+            merge_cones(axis_b, theta_b, axis_a, theta_a, axis, theta);
+            return;
+        }
+
+        const float theta_d = angle_between(axis_a, axis_b);
+
+        // Cone b is contained in cone a.
+        if (min(theta_d + theta_b, Pi<float>()) <= theta_a)
+        {
+            axis = axis_a;
+            theta = theta_a;
+            return;
+        }
+
+        const float theta_o = 0.5f * (theta_a + theta_d + theta_b);
+
+        const Vector3f w = axis_b - dot(axis_a, axis_b) * axis_a;
+        const float w_norm = norm(w);
+
+        // The cones cover the whole sphere or have opposite axes.
+        if (theta_o >= Pi<float>() || w_norm == 0.0f)
+        {
+            axis = axis_a;
+            theta = Pi<float>();
+            return;
+        }
+
+        // Rotate the axis of cone a toward the axis of cone b.
+        const float theta_r = theta_o - theta_a;
+        axis = normalize(cos(theta_r) * axis_a + sin(theta_r) * (w / w_norm));
+        theta = theta_o;
+    }
+}
+
+LightTree::LightTree(
+    const EmittingTriangleVector&   triangles,
+    const vector<float>&            importances)
+  : m_depth(0)
+{
+    assert(triangles.size() == importances.size());
+
+    const size_t triangle_count = triangles.size();
+
+    if (triangle_count == 0)
+        return;
+
+    vector<Item> items(triangle_count);
+
+    for (size_t i = 0; i < triangle_count; ++i)
+    {
+        const EmittingTriangle& triangle = triangles[i];
+        items[i].m_centroid = (triangle.m_v0 + triangle.m_v1 + triangle.m_v2) / 3.0;
+        items[i].m_triangle_index = i;
+    }
+
+    // A binary tree with one triangle per leaf.
+    m_nodes.reserve(2 * triangle_count - 1);
+    m_leaves.resize(triangle_count);
+
+    m_nodes.push_back(Node());
+    m_nodes[0].m_parent = NoParent;
+
+    build_recurse(triangles, importances, items, 0, triangle_count, 0, 1);
+}
+
+LightTree::ItemProbabilityPair LightTree::sample(
+    const Vector3d&                 point,
+    const float                     s) const
+{
+    assert(!empty());
+    assert(s >= 0.0f && s < 1.0f);
+
+    size_t node_index = 0;
+    float u = s;
+    float probability = 1.0f;
+
+    while (!m_nodes[node_index].m_is_leaf)
+    {
+        const Node& node = m_nodes[node_index];
+        const float left_prob = compute_left_probability(node, point);
+
+        // Choose a child and remap the random number to [0, 1).
+        if (u < left_prob)
+        {
+            u /= left_prob;
+            probability *= left_prob;
+            node_index = node.m_index;
+        }
+        else
+        {
+            const float right_prob = 1.0f - left_prob;
+            u = (u - left_prob) / right_prob;
+            probability *= right_prob;
+            node_index = node.m_index + 1;
+        }
+
+        u = min(u, OneMinusEpsilon);
+    }
+
+    return ItemProbabilityPair(m_nodes[node_index].m_index, probability);
+}
+
+float LightTree::evaluate_pdf(
+    const Vector3d&                 point,
+    const size_t                    triangle_index) const
+{
+    assert(triangle_index < m_leaves.size());
+
+    size_t node_index = m_leaves[triangle_index];
+    float probability = 1.0f;
+
+    // Walk up the tree, accumulating the probability of each choice made on the way down.
+    while (m_nodes[node_index].m_parent != NoParent)
+    {
+        const Node& parent = m_nodes[m_nodes[node_index].m_parent];
+        const float left_prob = compute_left_probability(parent, point);
+
+        probability *=
+            node_index == parent.m_index
+                ? left_prob
+                : 1.0f - left_prob;
+
+        node_index = m_nodes[node_index].m_parent;
+    }
+
+    return probability;
+}
+
+void LightTree::build_recurse(
+    const EmittingTriangleVector&   triangles,
+    const vector<float>&            importances,
+    vector<Item>&                   items,
+    const size_t                    begin,
+    const size_t                    end,
+    const size_t                    node_index,
+    const size_t                    depth)
+{
+    assert(end > begin);
+
+    m_depth = max(m_depth, depth);
+
+    if (end - begin == 1)
+    {
+        const size_t triangle_index = items[begin].m_triangle_index;
+        const EmittingTriangle& triangle = triangles[triangle_index];
+
+        Node& node = m_nodes[node_index];
+        node.m_bbox.invalidate();
+        node.m_bbox.insert(triangle.m_v0);
+        node.m_bbox.insert(triangle.m_v1);
+        node.m_bbox.insert(triangle.m_v2);
+        node.m_importance = importances[triangle_index];
+        node.m_index = static_cast<uint32>(triangle_index);
+        node.m_is_leaf = true;
+
+        // The cone of normals must bound both the geometric normal and the shading normals.
+        node.m_axis = Vector3f(triangle.m_geometric_normal);
+        node.m_theta_o =
+            max(
+                angle_between(node.m_axis, Vector3f(triangle.m_n0)),
+                max(
+                    angle_between(node.m_axis, Vector3f(triangle.m_n1)),
+                    angle_between(node.m_axis, Vector3f(triangle.m_n2))));
+
+        // Interpolated normals are only guaranteed to lie in cones narrower than a hemisphere.
+        if (node.m_theta_o >= HalfPi<float>())
+            node.m_theta_o = Pi<float>();
+
+        m_leaves[triangle_index] = static_cast<uint32>(node_index);
+
+        return;
+    }
+
+    // Split the triangles in two halves along the largest dimension of the bounding box of their centroids.
+    AABB3d centroid_bbox;
+    centroid_bbox.invalidate();
+    for (size_t i = begin; i < end; ++i)
+        centroid_bbox.insert(items[i].m_centroid);
+
+    const size_t split_dim = max_index(centroid_bbox.extent());
+    const size_t middle = (begin + end) / 2;
+    nth_element(
+        items.begin() + begin,
+        items.begin() + middle,
+        items.begin() + end,
+        CentroidOrder(split_dim));
+
+    // Children are stored next to each other.
+    const size_t child_index = m_nodes.size();
+    m_nodes.push_back(Node());
+    m_nodes.push_back(Node());
+    m_nodes[child_index].m_parent = static_cast<uint32>(node_index);
+    m_nodes[child_index + 1].m_parent = static_cast<uint32>(node_index);
+
+    build_recurse(triangles, importances, items, begin, middle, child_index, depth + 1);
+    build_recurse(triangles, importances, items, middle, end, child_index + 1, depth + 1);
+
+    const Node& left = m_nodes[child_index];
+    const Node& right = m_nodes[child_index + 1];
+
+    Node& node = m_nodes[node_index];
+    node.m_bbox = left.m_bbox;
+    node.m_bbox.insert(right.m_bbox);
+    node.m_importance = left.m_importance + right.m_importance;
+    node.m_index = static_cast<uint32>(child_index);
+    node.m_is_leaf = false;
+
+    merge_cones(
+        left.m_axis,
+        left.m_theta_o,
+        right.m_axis,
+        right.m_theta_o,
+        node.m_axis,
+        node.m_theta_o);
+}
+
+float LightTree::compute_left_probability(
+    const Node&                     node,
+    const Vector3d&                 point) const
+{
+    assert(!node.m_is_leaf);
+
+    const Node& left = m_nodes[node.m_index];
+    const Node& right = m_nodes[node.m_index + 1];
+
+    const double left_importance = compute_importance(left, point);
+    const double right_importance = compute_importance(right, point);
+    const double total_importance = left_importance + right_importance;
+
+    if (total_importance > 0.0)
+        return static_cast<float>(left_importance / total_importance);
+
+    // Neither child can light the point: fall back to the importances of the children.
+    const float total = left.m_importance + right.m_importance;
+    return total > 0.0f ? left.m_importance / total : 0.5f;
+}
+
+double LightTree::compute_importance(
+    const Node&                     node,
+    const Vector3d&                 point)
+{
+    const Vector3d to_point = point - node.m_bbox.center();
+    const double square_radius = 0.25 * square_norm(node.m_bbox.extent());
+    const double square_distance = square_norm(to_point);
+
+    double cos_theta_prime = 1.0;
+
+    // Bound the angle between the emitting surfaces and the direction to the point.
+    if (square_distance > square_radius && node.m_theta_o < Pi<float>())
+    {
+        const double distance = sqrt(square_distance);
+        const double cos_theta = dot(to_point, Vector3d(node.m_axis)) / distance;
+        const double theta = acos(clamp(cos_theta, -1.0, 1.0));
+        const double theta_u = asin(sqrt(square_radius / square_distance));
+        const double theta_prime = max(theta - node.m_theta_o - theta_u, 0.0);
+
+        // The point is behind all emitting surfaces of this node.
+        if (theta_prime >= HalfPi<double>())
+            return 0.0;
+
+        cos_theta_prime = cos(theta_prime);
+    }
+
+    // Don't let the importance blow up when the point is inside or close to the node.
+    const double clamped_square_distance = max(square_distance, square_radius);
+
+    return
+        clamped_square_distance > 0.0
+            ? node.m_importance * cos_theta_prime / clamped_square_distance
+            : node.m_importance;
+}
+
+}   // namespace renderer
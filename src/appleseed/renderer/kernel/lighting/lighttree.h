@@ -0,0 +1,162 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lightsampler.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A hierarchy of light-emitting triangles allowing to choose a triangle
+// in proportion to its estimated contribution at a given point.
+//
+// Each node bounds the positions and the normals (as a cone of directions)
+// of the triangles below it, and stores their total importance. Traversal
+// goes down the tree by randomly choosing a child in proportion to its
+// importance divided by the square distance to the point, discarding
+// children that face away from the point.
+//
+// Reference:
+//
+//   Importance Sampling of Many Lights with Adaptive Tree Splitting
+//   Alejandro Conty Estevez, Christopher Kulla
+//
+
+class LightTree
+  : public foundation::NonCopyable
+{
+  public:
+    typedef std::vector<EmittingTriangle> EmittingTriangleVector;
+    typedef std::pair<size_t, float> ItemProbabilityPair;
+
+    // Constructor. importances[i] is the (unnormalized) importance of triangles[i].
+    LightTree(
+        const EmittingTriangleVector&   triangles,
+        const std::vector<float>&       importances);
+
+    // Return true if the tree is empty.
+    bool empty() const;
+
+    // Return the number of nodes in the tree.
+    size_t get_node_count() const;
+
+    // Return the depth of the tree.
+    size_t get_depth() const;
+
+    // Choose an emitting triangle as seen from a given point.
+    // Return the index of the triangle and the probability of choosing it.
+    ItemProbabilityPair sample(
+        const foundation::Vector3d&     point,
+        const float                     s) const;
+
+    // Return the probability of choosing a given emitting triangle as seen from a given point.
+    float evaluate_pdf(
+        const foundation::Vector3d&     point,
+        const size_t                    triangle_index) const;
+
+  private:
+    struct Node
+    {
+        foundation::AABB3d              m_bbox;
+        foundation::Vector3f            m_axis;             // axis of the cone of normals, unit-length
+        float                           m_theta_o;          // half angle of the cone of normals
+        float                           m_importance;
+        foundation::uint32              m_parent;
+        foundation::uint32              m_index;            // index of the first child for interior nodes, of the triangle for leaves
+        bool                            m_is_leaf;
+    };
+
+    struct Item
+    {
+        foundation::Vector3d            m_centroid;
+        size_t                          m_triangle_index;
+    };
+
+    std::vector<Node>                   m_nodes;
+    std::vector<foundation::uint32>     m_leaves;           // triangle index -> leaf node index
+    size_t                              m_depth;
+
+    void build_recurse(
+        const EmittingTriangleVector&   triangles,
+        const std::vector<float>&       importances,
+        std::vector<Item>&              items,
+        const size_t                    begin,
+        const size_t                    end,
+        const size_t                    node_index,
+        const size_t                    depth);
+
+    // Return the probability of choosing the left child of a given interior node.
+    float compute_left_probability(
+        const Node&                     node,
+        const foundation::Vector3d&     point) const;
+
+    // Return the importance of a given node as seen from a given point.
+    static double compute_importance(
+        const Node&                     node,
+        const foundation::Vector3d&     point);
+};
+
+
+//
+// LightTree class implementation.
+//
+
+inline bool LightTree::empty() const
+{
+    return m_nodes.empty();
+}
+
+inline size_t LightTree::get_node_count() const
+{
+    return m_nodes.size();
+}
+
+inline size_t LightTree::get_depth() const
+{
+    return m_depth;
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
@@ -522,8 +522,8 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
         // Compute scattered ray differentials.
         if (bsdf_sample.m_incoming.has_derivatives())
         {
-            next_ray.m_rx.m_org = next_ray.m_org + vertex.m_shading_point->get_dpdx();
-            next_ray.m_ry.m_org = next_ray.m_org + vertex.m_shading_point->get_dpdy();
+            next_ray.m_rx.m_org = next_ray.m_org + foundation::Vector3d(vertex.m_shading_point->get_dpdx());
+            next_ray.m_ry.m_org = next_ray.m_org + foundation::Vector3d(vertex.m_shading_point->get_dpdy());
             next_ray.m_rx.m_dir = next_ray.m_dir + foundation::Vector3d(bsdf_sample.m_incoming.get_dx());
             next_ray.m_ry.m_dir = next_ray.m_dir + foundation::Vector3d(bsdf_sample.m_incoming.get_dy());
             next_ray.m_has_differentials = true;
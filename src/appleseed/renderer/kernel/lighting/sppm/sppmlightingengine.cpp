@@ -39,6 +39,7 @@
 #include "renderer/kernel/lighting/sppm/sppmpasscallback.h"
 #include "renderer/kernel/lighting/sppm/sppmphoton.h"
 #include "renderer/kernel/lighting/sppm/sppmphotonmap.h"
+#include "renderer/kernel/rendering/pixelcontext.h"
 #include "renderer/kernel/shading/shadingcontext.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/modeling/bsdf/bsdf.h"
@@ -49,6 +50,7 @@
 #include "renderer/utility/stochasticcast.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/color.h"
 #include "foundation/math/knn.h"
 #include "foundation/math/population.h"
 #include "foundation/math/scalar.h"
@@ -63,7 +65,6 @@
 #include <cstddef>
 
 // Forward declarations.
-namespace renderer  { class PixelContext; }
 namespace renderer  { class TextureCache; }
 
 using namespace foundation;
@@ -147,7 +148,8 @@ namespace
             const ShadingPoint&     shading_point,
             Spectrum&               radiance) APPLESEED_OVERRIDE    // output radiance, in W.sr^-1.m^-2
         {
-            if (m_params.m_view_photons)
+            if (m_params.m_view_photons &&
+                m_params.m_gather_mode == SPPMParameters::PhotonMapGather)
             {
                 view_photons(shading_point, radiance);
                 return;
@@ -160,6 +162,7 @@ namespace
                 sampling_context,
                 shading_context,
                 shading_point.get_scene(),
+                pixel_context.get_pixel_coords(),
                 m_answer,
                 radiance);
 
@@ -208,8 +211,10 @@ namespace
             SamplingContext&            m_sampling_context;
             const ShadingContext&       m_shading_context;
             const EnvironmentEDF*       m_env_edf;
+            const Vector2i&             m_pixel_coords;
             knn::Answer<float>&         m_answer;
             Spectrum&                   m_path_radiance;
+            bool                        m_gathered;         // visible point gather mode: was the pixel estimate already added?
 
             PathVisitor(
                 const SPPMParameters&   params,
@@ -218,6 +223,7 @@ namespace
                 SamplingContext&        sampling_context,
                 const ShadingContext&   shading_context,
                 const Scene&            scene,
+                const Vector2i&         pixel_coords,
                 knn::Answer<float>&     answer,
                 Spectrum&               path_radiance)
               : m_params(params)
@@ -226,8 +232,10 @@ namespace
               , m_sampling_context(sampling_context)
               , m_shading_context(shading_context)
               , m_env_edf(scene.get_environment()->get_environment_edf())
+              , m_pixel_coords(pixel_coords)
               , m_answer(answer)
               , m_path_radiance(path_radiance)
+              , m_gathered(false)
             {
             }
 
@@ -282,8 +290,16 @@ namespace
 
                     if (!vertex.m_bsdf->is_purely_specular())
                     {
-                        // Lighting from photon map.
-                        add_photon_map_lighting_contribution(vertex, vertex_radiance);
+                        if (m_params.m_gather_mode == SPPMParameters::VisiblePointGather)
+                        {
+                            // Lighting from the visible point of the pixel.
+                            add_visible_point_lighting_contribution(vertex_radiance);
+                        }
+                        else
+                        {
+                            // Lighting from photon map.
+                            add_photon_map_lighting_contribution(vertex, vertex_radiance);
+                        }
                     }
                 }
 
@@ -342,6 +358,19 @@ namespace
                 vertex_radiance += dl_radiance;
             }
 
+            void add_visible_point_lighting_contribution(
+                Spectrum&               vertex_radiance)
+            {
+                // The pixel estimate accounts for the first non-specular vertex of the path only.
+                if (m_gathered)
+                    return;
+
+                m_gathered = true;
+
+                const Color3f radiance = m_pass_callback.get_visible_point_radiance(m_pixel_coords);
+                vertex_radiance += Spectrum(radiance, Spectrum::Illuminance);
+            }
+
             void add_photon_map_lighting_contribution(
                 const PathVertex&       vertex,
                 Spectrum&               vertex_radiance)
@@ -671,6 +700,28 @@ Dictionary SPPMLightingEngineFactory::get_params_metadata()
                             .insert("label", "Poly")
                             .insert("help", "Polychromatic photons"))));
 
+    metadata.dictionaries().insert(
+        "gather_mode",
+        Dictionary()
+            .insert("type", "enum")
+            .insert("values", "photon_map|visible_points")
+            .insert("default", "photon_map")
+            .insert("label", "Gather Mode")
+            .insert("help", "Method used to gather photons")
+            .insert(
+                "options",
+                Dictionary()
+                    .insert(
+                        "photon_map",
+                        Dictionary()
+                            .insert("label", "Photon Map")
+                            .insert("help", "Build a photon map and gather photons at every path vertex"))
+                    .insert(
+                        "visible_points",
+                        Dictionary()
+                            .insert("label", "Visible Points")
+                            .insert("help", "Splat photons into per-pixel visible points with per-pixel radius reduction"))));
+
     metadata.dictionaries().insert(
         "dl_type",
         Dictionary()
@@ -93,6 +93,23 @@ namespace
             value == "rt" ? SPPMParameters::RayTraced :
             SPPMParameters::Off;
     }
+
+    SPPMParameters::GatherMode get_gather_mode(
+        const ParamArray&   params,
+        const char*         name,
+        const char*         default_value)
+    {
+        const string value =
+            params.get_optional<string>(
+                name,
+                default_value,
+                make_vector("photon_map", "visible_points"));
+
+        return
+            value == "photon_map"
+                ? SPPMParameters::PhotonMapGather
+                : SPPMParameters::VisiblePointGather;
+    }
 }
 
 SPPMParameters::SPPMParameters(const ParamArray& params)
@@ -110,6 +127,7 @@ SPPMParameters::SPPMParameters(const ParamArray& params)
   , m_path_tracing_rr_min_path_length(fixup_path_length(params.get_optional<size_t>("path_tracing_rr_min_path_length", 6)))
   , m_transparency_threshold(params.get_optional<float>("transparency_threshold", 0.001f))
   , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
+  , m_gather_mode(get_gather_mode(params, "gather_mode", "photon_map"))
   , m_initial_radius_percents(params.get_optional<float>("initial_radius", 0.1f))
   , m_alpha(params.get_optional<float>("alpha", 0.7f))
   , m_max_photons_per_estimate(params.get_optional<size_t>("max_photons_per_estimate", 100))
@@ -152,6 +170,7 @@ void SPPMParameters::print() const
         "sppm path tracing settings:\n"
         "  max bounces                   %s\n"
         "  rr min path length            %s\n"
+        "  gather mode                   %s\n"
         "  initial radius                %s%%\n"
         "  alpha                         %s\n"
         "  max photons per estimate      %s\n"
@@ -159,6 +178,7 @@ void SPPMParameters::print() const
         "  dl light threshold            %s",
         m_path_tracing_max_bounces == ~0 ? "infinite" : pretty_uint(m_path_tracing_max_bounces).c_str(),
         m_path_tracing_rr_min_path_length == ~0 ? "infinite" : pretty_uint(m_path_tracing_rr_min_path_length).c_str(),
+        m_gather_mode == PhotonMapGather ? "photon map" : "visible points",
         pretty_scalar(m_initial_radius_percents, 3).c_str(),
         pretty_scalar(m_alpha, 1).c_str(),
         pretty_uint(m_max_photons_per_estimate).c_str(),
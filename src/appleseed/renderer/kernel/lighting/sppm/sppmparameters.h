@@ -46,6 +46,7 @@ struct SPPMParameters
 {
     enum PhotonType { Monochromatic, Polychromatic };
     enum Mode { RayTraced, SPPM, Off };
+    enum GatherMode { PhotonMapGather, VisiblePointGather };
 
     const SamplingContext::Mode m_sampling_mode;
     const PhotonType            m_photon_type;
@@ -67,6 +68,7 @@ struct SPPMParameters
     const float                 m_transparency_threshold;
     const size_t                m_max_iterations;                       // maximum number of iteration during path tracing
 
+    const GatherMode            m_gather_mode;                          // how photons are gathered at camera path vertices
     const float                 m_initial_radius_percents;              // initial lookup radius as a percentage of the scene diameter
     const float                 m_alpha;                                // radius shrinking control
     const size_t                m_max_photons_per_estimate;             // maximum number of photons per density estimation
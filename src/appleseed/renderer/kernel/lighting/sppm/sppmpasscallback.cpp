@@ -33,9 +33,13 @@
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/lighting/sppm/sppmphotonsplatter.h"
+#include "renderer/modeling/frame/frame.h"
 #include "renderer/modeling/scene/scene.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/image.h"
 #include "foundation/math/hash.h"
 #include "foundation/utility/job/iabortswitch.h"
 #include "foundation/utility/string.h"
@@ -73,6 +77,16 @@ SPPMPassCallback::SPPMPassCallback(
         shading_system,
         params)
   , m_pass_number(0)
+  , m_visible_point_tracer(
+        scene,
+        trace_context,
+        texture_store,
+        oiio_texture_system,
+        shading_system,
+        params)
+  , m_canvas_width(0)
+  , m_canvas_height(0)
+  , m_visible_point_pass_count(0)
 {
     // Compute the initial lookup radius.
     const GAABB3 scene_bbox = scene.compute_bbox();
@@ -94,6 +108,13 @@ void SPPMPassCallback::pre_render(
     JobQueue&               job_queue,
     IAbortSwitch&           abort_switch)
 {
+    if (m_params.m_gather_mode == SPPMParameters::VisiblePointGather)
+    {
+        m_stopwatch.start();
+        trace_visible_point_pass(frame, job_queue, abort_switch);
+        return;
+    }
+
     if (m_initial_lookup_radius > 0.0f)
     {
         RENDERER_LOG_INFO(
@@ -117,7 +138,7 @@ void SPPMPassCallback::pre_render(
         return;
 
     // Build a new photon map.
-    m_photon_map.reset(new SPPMPhotonMap(m_photons));
+    m_photon_map.reset(new SPPMPhotonMap(m_photons, job_queue));
 }
 
 void SPPMPassCallback::post_render(
@@ -125,10 +146,13 @@ void SPPMPassCallback::post_render(
     JobQueue&               job_queue,
     IAbortSwitch&           abort_switch)
 {
-    // Shrink the lookup radius for the next pass.
-    const float k = (m_pass_number + m_params.m_alpha) / (m_pass_number + 1);
-    assert(k <= 1.0);
-    m_lookup_radius *= sqrt(k);
+    if (m_params.m_gather_mode == SPPMParameters::PhotonMapGather)
+    {
+        // Shrink the lookup radius for the next pass.
+        const float k = (m_pass_number + m_params.m_alpha) / (m_pass_number + 1);
+        assert(k <= 1.0);
+        m_lookup_radius *= sqrt(k);
+    }
 
     m_stopwatch.measure();
 
@@ -140,4 +164,99 @@ void SPPMPassCallback::post_render(
     ++m_pass_number;
 }
 
+void SPPMPassCallback::trace_visible_point_pass(
+    const Frame&            frame,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
+{
+    const CanvasProperties& props = frame.image().properties();
+
+    // Initialize per-pixel statistics on the first pass.
+    if (m_pixel_stats.empty())
+    {
+        m_canvas_width = props.m_canvas_width;
+        m_canvas_height = props.m_canvas_height;
+
+        PixelStatistics initial_stats;
+        initial_stats.m_tau.set(0.0f);
+        initial_stats.m_radius = m_initial_lookup_radius;
+        initial_stats.m_photon_count = 0.0f;
+
+        m_pixel_stats.assign(m_canvas_width * m_canvas_height, initial_stats);
+    }
+
+    assert(m_canvas_width == props.m_canvas_width);
+    assert(m_canvas_height == props.m_canvas_height);
+
+    const uint32 pass_hash = hash_uint32(m_pass_number);
+
+    // Create a new set of visible points.
+    m_visible_points.clear_keep_memory();
+    m_visible_point_tracer.trace_visible_points(
+        frame,
+        m_visible_points,
+        pass_hash,
+        job_queue,
+        abort_switch);
+
+    if (abort_switch.is_aborted())
+        return;
+
+    // Visible points gather photons within the current radius of their pixel.
+    for (size_t i = 0, e = m_visible_points.size(); i < e; ++i)
+    {
+        const SPPMVisiblePoint& vp = m_visible_points.m_visible_points[i];
+        m_visible_points.m_square_radii[i] = square(m_pixel_stats[vp.m_pixel_index].m_radius);
+    }
+
+    // Build a hashed grid over the visible points.
+    m_visible_point_grid.build(m_visible_points.m_positions, m_visible_points.m_square_radii);
+
+    RENDERER_LOG_DEBUG(
+        "sppm visible point grid: %s visible points, %s.",
+        pretty_uint(m_visible_point_grid.size()).c_str(),
+        pretty_size(m_visible_point_grid.get_memory_size()).c_str());
+
+    // Trace photons and splat them into the visible points.
+    SPPMPhotonSplatter splatter(
+        frame.get_lighting_conditions(),
+        m_visible_points,
+        m_visible_point_grid);
+    m_photon_tracer.trace_photons(
+        splatter,
+        pass_hash,
+        job_queue,
+        abort_switch);
+
+    if (abort_switch.is_aborted())
+        return;
+
+    update_pixel_statistics();
+}
+
+void SPPMPassCallback::update_pixel_statistics()
+{
+    for (size_t i = 0, e = m_visible_points.size(); i < e; ++i)
+    {
+        const SPPMVisiblePoint& vp = m_visible_points.m_visible_points[i];
+
+        if (vp.m_photon_count == 0)
+            continue;
+
+        PixelStatistics& stats = m_pixel_stats[vp.m_pixel_index];
+
+        // Progressive radius reduction (Hachisuka and Jensen, 2009).
+        const float m = static_cast<float>(vp.m_photon_count);
+        const float n = stats.m_photon_count + m_params.m_alpha * m;
+        const float new_radius = stats.m_radius * sqrt(n / (stats.m_photon_count + m));
+        const float k = square(new_radius / stats.m_radius);
+
+        stats.m_tau = (stats.m_tau + vp.m_flux) * k;
+        stats.m_radius = new_radius;
+        stats.m_photon_count = n;
+    }
+
+    ++m_visible_point_pass_count;
+}
+
 }   // namespace renderer
@@ -35,9 +35,15 @@
 #include "renderer/kernel/lighting/sppm/sppmphoton.h"
 #include "renderer/kernel/lighting/sppm/sppmphotonmap.h"
 #include "renderer/kernel/lighting/sppm/sppmphotontracer.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepoint.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepointgrid.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepointtracer.h"
 #include "renderer/kernel/rendering/ipasscallback.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/timers.h"
 #include "foundation/platform/types.h"
@@ -58,6 +64,7 @@ END_OIIO_INCLUDES
 // Standard headers.
 #include <cstddef>
 #include <memory>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
@@ -74,6 +81,10 @@ namespace renderer
 //
 // This class is responsible for building a new photon map before a pass begins.
 //
+// In visible point gather mode, it instead traces one visible point per pixel,
+// splats the photons of the pass into them and progressively refines per-pixel
+// radiance estimates.
+//
 
 class SPPMPassCallback
   : public IPassCallback
@@ -114,7 +125,17 @@ class SPPMPassCallback
     // Return the current lookup radius.
     float get_lookup_radius() const;
 
+    // Return the current radiance estimate of a given pixel in visible point gather mode.
+    foundation::Color3f get_visible_point_radiance(const foundation::Vector2i& pixel_coords) const;
+
   private:
+    struct PixelStatistics
+    {
+        foundation::Color3f         m_tau;              // accumulated flux, scaled to the current radius
+        float                       m_radius;           // current gathering radius
+        float                       m_photon_count;     // accumulated (fractional) photon count
+    };
+
     const SPPMParameters            m_params;
     SPPMPhotonTracer                m_photon_tracer;
     foundation::uint32              m_pass_number;
@@ -122,6 +143,22 @@ class SPPMPassCallback
     std::auto_ptr<SPPMPhotonMap>    m_photon_map;
     float                           m_initial_lookup_radius;
     float                           m_lookup_radius;
+
+    // Visible point gather mode.
+    SPPMVisiblePointTracer          m_visible_point_tracer;
+    SPPMVisiblePointVector          m_visible_points;
+    SPPMVisiblePointGrid            m_visible_point_grid;
+    std::vector<PixelStatistics>    m_pixel_stats;
+    size_t                          m_canvas_width;
+    size_t                          m_canvas_height;
+    foundation::uint32              m_visible_point_pass_count;
+
+    void trace_visible_point_pass(
+        const Frame&                frame,
+        foundation::JobQueue&       job_queue,
+        foundation::IAbortSwitch&   abort_switch);
+
+    void update_pixel_statistics();
     foundation::Stopwatch<foundation::DefaultWallclockTimer>
                                     m_stopwatch;
 };
@@ -151,6 +188,23 @@ inline float SPPMPassCallback::get_lookup_radius() const
     return m_lookup_radius;
 }
 
+inline foundation::Color3f SPPMPassCallback::get_visible_point_radiance(const foundation::Vector2i& pixel_coords) const
+{
+    if (m_visible_point_pass_count == 0 ||
+        pixel_coords.x < 0 || static_cast<size_t>(pixel_coords.x) >= m_canvas_width ||
+        pixel_coords.y < 0 || static_cast<size_t>(pixel_coords.y) >= m_canvas_height)
+        return foundation::Color3f(0.0f);
+
+    const PixelStatistics& stats = m_pixel_stats[pixel_coords.y * m_canvas_width + pixel_coords.x];
+
+    if (stats.m_radius == 0.0f)
+        return foundation::Color3f(0.0f);
+
+    const float area = foundation::Pi<float>() * foundation::square(stats.m_radius);
+
+    return stats.m_tau / (static_cast<float>(m_visible_point_pass_count) * area);
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPASSCALLBACK_H
@@ -36,6 +36,8 @@
 
 // appleseed.foundation headers.
 #include "foundation/platform/defaulttimers.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
 
@@ -48,7 +50,9 @@ using namespace foundation;
 namespace renderer
 {
 
-SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
+SPPMPhotonMap::SPPMPhotonMap(
+    SPPMPhotonVector&   photons,
+    JobQueue&           job_queue)
 {
     const size_t photon_count = photons.size();
 
@@ -59,11 +63,12 @@ SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
             pretty_uint(photon_count).c_str(),
             photon_count > 1 ? "photons" : "photon");
 
-        knn::Builder3f builder(*this);
+        knn::ParallelBuilder3f builder(*this, job_queue);
         builder.build_move_points<DefaultWallclockTimer>(photons.m_positions);
 
         Statistics statistics;
         statistics.insert_time("build time", builder.get_build_time());
+        statistics.insert<uint64>("subtrees", builder.get_subtree_count());
         statistics.insert_size("size", photons.get_memory_size());
         statistics.merge(knn::TreeStatistics<knn::Tree3f>(*this));
 
@@ -34,7 +34,8 @@
 #include "foundation/math/knn.h"
 
 // Forward declarations.
-namespace renderer  { class SPPMPhotonVector; }
+namespace foundation    { class JobQueue; }
+namespace renderer      { class SPPMPhotonVector; }
 
 namespace renderer
 {
@@ -44,7 +45,10 @@ class SPPMPhotonMap
 {
   public:
     // Constructor, *moves* the photon positions into the map.
-    explicit SPPMPhotonMap(SPPMPhotonVector& photons);
+    // The map is built in parallel by the worker threads of a job queue.
+    SPPMPhotonMap(
+        SPPMPhotonVector&       photons,
+        foundation::JobQueue&   job_queue);
 };
 
 }       // namespace renderer
@@ -0,0 +1,217 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "sppmphotonsplatter.h"
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/scatteringmode.h"
+#include "renderer/kernel/lighting/sppm/sppmphoton.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepoint.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepointgrid.h"
+#include "renderer/modeling/bsdf/bsdf.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/colorspace.h"
+#include "foundation/image/regularspectrum.h"
+#include "foundation/platform/atomic.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    //
+    // Evaluate the diffuse part of the BSDF at a visible point for a given photon.
+    //
+    // Returns false if the photon doesn't belong to the surface of the visible
+    // point, in which case it must not be counted at all.
+    //
+    // The photons store flux but we are computing reflected radiance. The first
+    // step of the flux -> radiance conversion is done here. The conversion will
+    // be completed when doing density estimation.
+    //
+
+    bool evaluate_bsdf(
+        const SPPMVisiblePoint& visible_point,
+        const Vector3f&         incoming,
+        const Vector3f&         photon_geometric_normal,
+        Spectrum&               value)
+    {
+        const Vector3f& normal = visible_point.m_geometric_normal;
+
+        // Reject photons from the opposite hemisphere as they won't contribute.
+        if (dot(normal, incoming) <= 0.0f)
+            return false;
+
+        // Reject photons on a surface with too different an orientation.
+        const float NormalThreshold = 1.0e-3f;
+        if (dot(normal, photon_geometric_normal) < NormalThreshold)
+            return false;
+
+        const float bsdf_prob =
+            visible_point.m_bsdf->evaluate(
+                visible_point.m_bsdf_data,
+                false,                                      // not adjoint
+                true,                                       // multiply by |cos(incoming, normal)|
+                normal,
+                visible_point.m_shading_basis,
+                visible_point.m_outgoing,                   // toward the camera
+                normalize(incoming),                        // toward the light
+                ScatteringMode::Diffuse,
+                value);
+
+        if (bsdf_prob == 0.0f)
+            value.set(0.0f);
+        else value /= abs(dot(incoming, photon_geometric_normal));
+
+        return true;
+    }
+
+    void accumulate(
+        SPPMVisiblePoint&       visible_point,
+        const Color3f&          flux)
+    {
+        atomic_add(&visible_point.m_flux[0], flux[0]);
+        atomic_add(&visible_point.m_flux[1], flux[1]);
+        atomic_add(&visible_point.m_flux[2], flux[2]);
+        atomic_inc(&visible_point.m_photon_count);
+    }
+}
+
+struct SPPMPhotonSplatter::MonoPhotonVisitor
+{
+    const SPPMPhotonSplatter&   m_splatter;
+    const SPPMMonoPhoton&       m_photon;
+
+    MonoPhotonVisitor(
+        const SPPMPhotonSplatter&   splatter,
+        const SPPMMonoPhoton&       photon)
+      : m_splatter(splatter)
+      , m_photon(photon)
+    {
+    }
+
+    void visit(const size_t index)
+    {
+        SPPMVisiblePoint& visible_point = m_splatter.m_visible_points.m_visible_points[index];
+
+        Spectrum bsdf_value;
+        if (!evaluate_bsdf(visible_point, m_photon.m_incoming, m_photon.m_geometric_normal, bsdf_value))
+            return;
+
+        // Make sure the BSDF value is spectral.
+        Spectrum spectral_bsdf_value;
+        Spectrum::upgrade(bsdf_value, spectral_bsdf_value);
+
+        const uint32 wavelength = m_photon.m_flux.m_wavelength;
+        const float amplitude = spectral_bsdf_value[wavelength] * m_photon.m_flux.m_amplitude;
+
+        accumulate(visible_point, amplitude * m_splatter.m_wavelength_colors[wavelength]);
+    }
+};
+
+struct SPPMPhotonSplatter::PolyPhotonVisitor
+{
+    const SPPMPhotonSplatter&   m_splatter;
+    const SPPMPolyPhoton&       m_photon;
+
+    PolyPhotonVisitor(
+        const SPPMPhotonSplatter&   splatter,
+        const SPPMPolyPhoton&       photon)
+      : m_splatter(splatter)
+      , m_photon(photon)
+    {
+    }
+
+    void visit(const size_t index)
+    {
+        SPPMVisiblePoint& visible_point = m_splatter.m_visible_points.m_visible_points[index];
+
+        Spectrum value;
+        if (!evaluate_bsdf(visible_point, m_photon.m_incoming, m_photon.m_geometric_normal, value))
+            return;
+
+        value *= m_photon.m_flux;
+
+        // Make sure the reflected flux is RGB.
+        Spectrum::downgrade(m_splatter.m_lighting_conditions, value, value);
+
+        accumulate(visible_point, Color3f(value[0], value[1], value[2]));
+    }
+};
+
+
+//
+// SPPMPhotonSplatter class implementation.
+//
+
+SPPMPhotonSplatter::SPPMPhotonSplatter(
+    const LightingConditions&   lighting_conditions,
+    SPPMVisiblePointVector&     visible_points,
+    const SPPMVisiblePointGrid& grid)
+  : m_lighting_conditions(lighting_conditions)
+  , m_visible_points(visible_points)
+  , m_grid(grid)
+{
+    for (size_t i = 0; i < Spectrum::Samples; ++i)
+    {
+        RegularSpectrum31f line(0.0f);
+        line[i] = 1.0f;
+
+        m_wavelength_colors[i] =
+            ciexyz_to_linear_rgb(
+                spectrum_to_ciexyz<float>(lighting_conditions, line));
+    }
+}
+
+void SPPMPhotonSplatter::splat(
+    const Vector3f&             position,
+    const SPPMMonoPhoton&       photon)
+{
+    MonoPhotonVisitor visitor(*this, photon);
+    m_grid.query(position, visitor);
+}
+
+void SPPMPhotonSplatter::splat(
+    const Vector3f&             position,
+    const SPPMPolyPhoton&       photon)
+{
+    PolyPhotonVisitor visitor(*this, photon);
+    m_grid.query(position, visitor);
+}
+
+}   // namespace renderer
@@ -0,0 +1,88 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONSPLATTER_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONSPLATTER_H
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/color.h"
+#include "foundation/math/vector.h"
+
+// Forward declarations.
+namespace foundation    { class LightingConditions; }
+namespace renderer      { class SPPMMonoPhoton; }
+namespace renderer      { class SPPMPolyPhoton; }
+namespace renderer      { class SPPMVisiblePointGrid; }
+namespace renderer      { class SPPMVisiblePointVector; }
+
+namespace renderer
+{
+
+//
+// Accumulates the flux of photons into the visible points whose gathering
+// sphere contains them, as photons are traced. Photons are not stored.
+//
+// Flux is accumulated in linear RGB, using the lighting conditions of the
+// frame to convert spectral values, to keep per-pixel statistics small.
+//
+
+class SPPMPhotonSplatter
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. The grid must have been built from the visible points.
+    SPPMPhotonSplatter(
+        const foundation::LightingConditions&   lighting_conditions,
+        SPPMVisiblePointVector&                 visible_points,
+        const SPPMVisiblePointGrid&             grid);
+
+    // Splat a photon into the visible points. These methods are thread-safe.
+    void splat(
+        const foundation::Vector3f&             position,
+        const SPPMMonoPhoton&                   photon);
+    void splat(
+        const foundation::Vector3f&             position,
+        const SPPMPolyPhoton&                   photon);
+
+  private:
+    struct MonoPhotonVisitor;
+    struct PolyPhotonVisitor;
+
+    const foundation::LightingConditions&       m_lighting_conditions;
+    SPPMVisiblePointVector&                     m_visible_points;
+    const SPPMVisiblePointGrid&                 m_grid;
+    foundation::Color3f                         m_wavelength_colors[Spectrum::Samples];   // linear RGB value of a unit spectral line
+};
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONSPLATTER_H
@@ -35,6 +35,7 @@
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/intersection/intersector.h"
 #include "renderer/kernel/lighting/sppm/sppmphoton.h"
+#include "renderer/kernel/lighting/sppm/sppmphotonsplatter.h"
 #include "renderer/kernel/lighting/lightsampler.h"
 #include "renderer/kernel/lighting/pathtracer.h"
 #include "renderer/kernel/lighting/pathvertex.h"
@@ -89,6 +90,7 @@ namespace
 {
     //
     // A path visitor that creates photons at each non-specular bounces.
+    // Photons are either stored or splatted into visible points.
     //
 
     struct PathVisitor
@@ -99,6 +101,7 @@ namespace
         const bool                  m_store_indirect;
         const bool                  m_store_caustics;
         SPPMPhotonVector&           m_photons;
+        SPPMPhotonSplatter*         m_splatter;
 
         PathVisitor(
             const Spectrum&         initial_flux,
@@ -106,13 +109,15 @@ namespace
             const bool              store_direct,
             const bool              store_indirect,
             const bool              store_caustics,
-            SPPMPhotonVector&       photons)
+            SPPMPhotonVector&       photons,
+            SPPMPhotonSplatter*     splatter)
           : m_initial_flux(initial_flux)
           , m_params(params)
           , m_store_direct(store_direct)
           , m_store_indirect(store_indirect)
           , m_store_caustics(store_caustics)
           , m_photons(photons)
+          , m_splatter(splatter)
         {
             if (params.m_photon_type == SPPMParameters::Monochromatic)
                 Spectrum::upgrade(m_initial_flux, m_initial_flux);
@@ -176,7 +181,7 @@ namespace
                         m_initial_flux[wavelength] *
                         Spectrum::Samples *
                         spectral_throughput[wavelength];
-                    m_photons.push_back(Vector3f(vertex.get_point()), photon);
+                    store(Vector3f(vertex.get_point()), photon);
                 }
                 else
                 {
@@ -188,7 +193,7 @@ namespace
                     photon.m_geometric_normal = Vector3f(vertex.get_geometric_normal());
                     photon.m_flux = m_initial_flux;
                     photon.m_flux *= vertex.m_throughput;
-                    m_photons.push_back(Vector3f(vertex.get_point()), photon);
+                    store(Vector3f(vertex.get_point()), photon);
                 }
             }
         }
@@ -196,6 +201,16 @@ namespace
         void on_scatter(const PathVertex& vertex)
         {
         }
+
+        template <typename Photon>
+        void store(
+            const Vector3f&         position,
+            const Photon&           photon)
+        {
+            if (m_splatter)
+                m_splatter->splat(position, photon);
+            else m_photons.push_back(position, photon);
+        }
     };
 
 
@@ -217,6 +232,7 @@ namespace
             OSL::ShadingSystem&     shading_system,
             const SPPMParameters&   params,
             SPPMPhotonVector&       global_photons,
+            SPPMPhotonSplatter*     splatter,
             const size_t            photon_begin,
             const size_t            photon_end,
             const size_t            pass_hash,
@@ -238,6 +254,7 @@ namespace
                 m_params.m_max_iterations,
                 false)
           , m_global_photons(global_photons)
+          , m_splatter(splatter)
           , m_photon_begin(photon_begin)
           , m_photon_end(photon_end)
           , m_pass_hash(pass_hash)
@@ -289,6 +306,7 @@ namespace
         const SPPMParameters        m_params;
         Tracer                      m_tracer;
         SPPMPhotonVector&           m_global_photons;
+        SPPMPhotonSplatter*         m_splatter;
         const size_t                m_photon_begin;
         const size_t                m_photon_end;
         const size_t                m_pass_hash;
@@ -404,7 +422,8 @@ namespace
                 m_params.m_dl_mode == SPPMParameters::SPPM, // store direct lighting photons?
                 cast_indirect_light,
                 m_params.m_enable_caustics,
-                m_local_photons);
+                m_local_photons,
+                m_splatter);
             PathTracer<PathVisitor, true> path_tracer(      // true = adjoint
                 path_visitor,
                 m_params.m_photon_tracing_rr_min_path_length,
@@ -467,7 +486,8 @@ namespace
                 m_params.m_dl_mode == SPPMParameters::SPPM, // store direct lighting photons?
                 cast_indirect_light,
                 m_params.m_enable_caustics,
-                m_local_photons);
+                m_local_photons,
+                m_splatter);
             PathTracer<PathVisitor, true> path_tracer(      // true = adjoint
                 path_visitor,
                 m_params.m_photon_tracing_rr_min_path_length,
@@ -504,6 +524,7 @@ namespace
             OSL::ShadingSystem&     shading_system,
             const SPPMParameters&   params,
             SPPMPhotonVector&       global_photons,
+            SPPMPhotonSplatter*     splatter,
             const size_t            photon_begin,
             const size_t            photon_end,
             const size_t            pass_hash,
@@ -526,6 +547,7 @@ namespace
                 m_params.m_max_iterations,
                 false)
           , m_global_photons(global_photons)
+          , m_splatter(splatter)
           , m_photon_begin(photon_begin)
           , m_photon_end(photon_end)
           , m_pass_hash(pass_hash)
@@ -583,6 +605,7 @@ namespace
         const SPPMParameters        m_params;
         Tracer                      m_tracer;
         SPPMPhotonVector&           m_global_photons;
+        SPPMPhotonSplatter*         m_splatter;
         const size_t                m_photon_begin;
         const size_t                m_photon_end;
         const size_t                m_pass_hash;
@@ -668,7 +691,8 @@ namespace
                 true,
                 cast_indirect_light,
                 m_params.m_enable_caustics,
-                m_local_photons);
+                m_local_photons,
+                m_splatter);
             PathTracer<PathVisitor, true> path_tracer(      // true = adjoint
                 path_visitor,
                 m_params.m_photon_tracing_rr_min_path_length,
@@ -775,6 +799,27 @@ void SPPMPhotonTracer::trace_photons(
     const size_t            pass_hash,
     JobQueue&               job_queue,
     IAbortSwitch&           abort_switch)
+{
+    do_trace_photons(photons, 0, pass_hash, job_queue, abort_switch);
+}
+
+void SPPMPhotonTracer::trace_photons(
+    SPPMPhotonSplatter&     splatter,
+    const size_t            pass_hash,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
+{
+    // No photon is stored when splatting, the vector only collects empty per-job vectors.
+    SPPMPhotonVector photons;
+    do_trace_photons(photons, &splatter, pass_hash, job_queue, abort_switch);
+}
+
+void SPPMPhotonTracer::do_trace_photons(
+    SPPMPhotonVector&       photons,
+    SPPMPhotonSplatter*     splatter,
+    const size_t            pass_hash,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
 {
     // Start stopwatch.
     Stopwatch<DefaultWallclockTimer> stopwatch;
@@ -795,6 +840,7 @@ void SPPMPhotonTracer::trace_photons(
         schedule_light_photon_tracing_jobs(
             photon_targets,
             photons,
+            splatter,
             pass_hash,
             job_queue,
             job_count,
@@ -806,6 +852,7 @@ void SPPMPhotonTracer::trace_photons(
         schedule_environment_photon_tracing_jobs(
             photon_targets,
             photons,
+            splatter,
             pass_hash,
             job_queue,
             job_count,
@@ -825,11 +872,14 @@ void SPPMPhotonTracer::trace_photons(
     statistics.insert("tracing jobs", job_count);
     statistics.insert_time("tracing time", stopwatch.measure().get_seconds());
     statistics.insert("total emitted", m_total_emitted_photon_count);
-    statistics.insert(
-        "total stored",
-        pretty_uint(m_total_stored_photon_count) + " (" +
-        pretty_percent(m_total_stored_photon_count, m_total_emitted_photon_count) +
-        ")");
+    if (splatter == 0)
+    {
+        statistics.insert(
+            "total stored",
+            pretty_uint(m_total_stored_photon_count) + " (" +
+            pretty_percent(m_total_stored_photon_count, m_total_emitted_photon_count) +
+            ")");
+    }
     RENDERER_LOG_DEBUG("%s",
         StatisticsVector::make(
             "sppm photon tracing statistics",
@@ -839,6 +889,7 @@ void SPPMPhotonTracer::trace_photons(
 void SPPMPhotonTracer::schedule_light_photon_tracing_jobs(
     const LightTargetArray& photon_targets,
     SPPMPhotonVector&       photons,
+    SPPMPhotonSplatter*     splatter,
     const size_t            pass_hash,
     JobQueue&               job_queue,
     size_t&                 job_count,
@@ -866,6 +917,7 @@ void SPPMPhotonTracer::schedule_light_photon_tracing_jobs(
                 m_shading_system,
                 m_params,
                 photons,
+                splatter,
                 photon_begin,
                 photon_end,
                 pass_hash,
@@ -879,6 +931,7 @@ void SPPMPhotonTracer::schedule_light_photon_tracing_jobs(
 void SPPMPhotonTracer::schedule_environment_photon_tracing_jobs(
     const LightTargetArray& photon_targets,
     SPPMPhotonVector&       photons,
+    SPPMPhotonSplatter*     splatter,
     const size_t            pass_hash,
     JobQueue&               job_queue,
     size_t&                 job_count,
@@ -906,6 +959,7 @@ void SPPMPhotonTracer::schedule_environment_photon_tracing_jobs(
                 m_shading_system,
                 m_params,
                 photons,
+                splatter,
                 photon_begin,
                 photon_end,
                 pass_hash,
@@ -57,6 +57,7 @@ namespace foundation    { class JobQueue; }
 namespace renderer      { class LightSampler; }
 namespace renderer      { class LightTargetArray; }
 namespace renderer      { class Scene; }
+namespace renderer      { class SPPMPhotonSplatter; }
 namespace renderer      { class SPPMPhotonVector; }
 namespace renderer      { class TextureStore; }
 namespace renderer      { class TraceContext; }
@@ -77,12 +78,20 @@ class SPPMPhotonTracer
         OSL::ShadingSystem&         shading_system,
         const SPPMParameters&       params);
 
+    // Trace photons and store them.
     void trace_photons(
         SPPMPhotonVector&           photons,
         const size_t                pass_hash,
         foundation::JobQueue&       job_queue,
         foundation::IAbortSwitch&   abort_switch);
 
+    // Trace photons and splat them into visible points as they are created.
+    void trace_photons(
+        SPPMPhotonSplatter&         splatter,
+        const size_t                pass_hash,
+        foundation::JobQueue&       job_queue,
+        foundation::IAbortSwitch&   abort_switch);
+
   private:
     const SPPMParameters            m_params;
     const Scene&                    m_scene;
@@ -94,9 +103,17 @@ class SPPMPhotonTracer
     OIIO::TextureSystem&            m_oiio_texture_system;
     OSL::ShadingSystem&             m_shading_system;
 
+    void do_trace_photons(
+        SPPMPhotonVector&           photons,
+        SPPMPhotonSplatter*         splatter,
+        const size_t                pass_hash,
+        foundation::JobQueue&       job_queue,
+        foundation::IAbortSwitch&   abort_switch);
+
     void schedule_light_photon_tracing_jobs(
         const LightTargetArray&     photon_targets,
         SPPMPhotonVector&           photons,
+        SPPMPhotonSplatter*         splatter,
         const size_t                pass_hash,
         foundation::JobQueue&       job_queue,
         size_t&                     job_count,
@@ -106,6 +123,7 @@ class SPPMPhotonTracer
     void schedule_environment_photon_tracing_jobs(
         const LightTargetArray&     photon_targets,
         SPPMPhotonVector&           photons,
+        SPPMPhotonSplatter*         splatter,
         const size_t                pass_hash,
         foundation::JobQueue&       job_queue,
         size_t&                     job_count,
@@ -0,0 +1,87 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "sppmvisiblepoint.h"
+
+// appleseed.foundation headers.
+#include "foundation/utility/memory.h"
+
+using namespace foundation;
+
+namespace renderer
+{
+
+//
+// SPPMVisiblePointVector class implementation.
+//
+
+bool SPPMVisiblePointVector::empty() const
+{
+    return m_positions.empty();
+}
+
+size_t SPPMVisiblePointVector::size() const
+{
+    return m_positions.size();
+}
+
+size_t SPPMVisiblePointVector::get_memory_size() const
+{
+    return
+        m_positions.capacity() * sizeof(Vector3f) +
+        m_square_radii.capacity() * sizeof(float) +
+        m_visible_points.capacity() * sizeof(SPPMVisiblePoint);
+}
+
+void SPPMVisiblePointVector::clear_keep_memory()
+{
+    foundation::clear_keep_memory(m_positions);
+    foundation::clear_keep_memory(m_square_radii);
+    foundation::clear_keep_memory(m_visible_points);
+}
+
+void SPPMVisiblePointVector::push_back(
+    const Vector3f&         position,
+    const SPPMVisiblePoint& visible_point)
+{
+    m_positions.push_back(position);
+    m_square_radii.push_back(0.0f);
+    m_visible_points.push_back(visible_point);
+}
+
+void SPPMVisiblePointVector::append(const SPPMVisiblePointVector& rhs)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    m_positions.insert(m_positions.end(), rhs.m_positions.begin(), rhs.m_positions.end());
+    m_square_radii.insert(m_square_radii.end(), rhs.m_square_radii.begin(), rhs.m_square_radii.end());
+    m_visible_points.insert(m_visible_points.end(), rhs.m_visible_points.begin(), rhs.m_visible_points.end());
+}
+
+}   // namespace renderer
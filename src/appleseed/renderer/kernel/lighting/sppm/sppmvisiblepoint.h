@@ -0,0 +1,99 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINT_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINT_H
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/basis.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/thread.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+// Forward declarations.
+namespace renderer  { class BSDF; }
+
+namespace renderer
+{
+
+//
+// A visible point is the first non-specular vertex of a camera path traced
+// through a given pixel. Photons are gathered at visible points.
+//
+
+class SPPMVisiblePoint
+{
+  public:
+    foundation::Vector3f    m_geometric_normal;     // geometric normal, world space, unit length
+    foundation::Basis3f     m_shading_basis;        // shading basis, world space
+    foundation::Vector3f    m_outgoing;             // outgoing direction (toward the camera), world space, unit length
+    const BSDF*             m_bsdf;
+    const void*             m_bsdf_data;            // BSDF inputs, must outlive the photon tracing pass
+    foundation::uint32      m_pixel_index;          // index of the pixel in the canvas
+
+    // Photon statistics of the current pass, updated atomically during photon tracing.
+    foundation::Color3f     m_flux;                 // reflected flux (in W), not yet divided by the gathering area
+    foundation::uint32      m_photon_count;         // number of photons that fell into the gathering sphere
+};
+
+
+//
+// A vector of visible points.
+//
+
+class SPPMVisiblePointVector
+{
+  public:
+    std::vector<foundation::Vector3f>   m_positions;
+    std::vector<float>                  m_square_radii;
+    std::vector<SPPMVisiblePoint>       m_visible_points;
+    boost::mutex                        m_mutex;
+
+    bool empty() const;
+    size_t size() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+    void clear_keep_memory();
+    void push_back(
+        const foundation::Vector3f&     position,
+        const SPPMVisiblePoint&         visible_point);
+
+    // The only thread-safe method of this class.
+    void append(const SPPMVisiblePointVector& rhs);
+};
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINT_H
@@ -0,0 +1,174 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "sppmvisiblepointgrid.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// SPPMVisiblePointGrid class implementation.
+//
+
+SPPMVisiblePointGrid::SPPMVisiblePointGrid()
+  : m_positions(0)
+  , m_square_radii(0)
+{
+    clear();
+}
+
+void SPPMVisiblePointGrid::clear()
+{
+    m_positions = 0;
+    m_square_radii = 0;
+    m_bbox.invalidate();
+    m_rcp_cell_size = 0.0f;
+    m_resolution = Vector3i(0);
+    m_offsets.assign(2, 0);
+    m_entries.clear();
+}
+
+size_t SPPMVisiblePointGrid::get_memory_size() const
+{
+    return
+        sizeof(*this) +
+        m_offsets.capacity() * sizeof(uint32) +
+        m_entries.capacity() * sizeof(uint32);
+}
+
+void SPPMVisiblePointGrid::build(
+    const vector<Vector3f>&     positions,
+    const vector<float>&        square_radii)
+{
+    assert(positions.size() == square_radii.size());
+
+    clear();
+
+    m_positions = &positions;
+    m_square_radii = &square_radii;
+
+    // Compute the bounding box of all gathering spheres and the largest radius.
+    float max_square_radius = 0.0f;
+    for (size_t i = 0, e = positions.size(); i < e; ++i)
+    {
+        const Vector3f r(sqrt(square_radii[i]));
+        m_bbox.insert(positions[i] - r);
+        m_bbox.insert(positions[i] + r);
+        max_square_radius = max(max_square_radius, square_radii[i]);
+    }
+
+    if (max_square_radius == 0.0f)
+        return;
+
+    // Cells are as large as the largest gathering sphere, such that a sphere
+    // overlaps at most two cells in each dimension in the common case.
+    const float cell_size = sqrt(max_square_radius);
+    m_rcp_cell_size = 1.0f / cell_size;
+
+    const Vector3f extent = m_bbox.extent();
+    for (size_t i = 0; i < 3; ++i)
+        m_resolution[i] = max(1, static_cast<int>(ceil(extent[i] * m_rcp_cell_size)));
+
+    // Count the number of entries in each bucket.
+    const size_t bucket_count = positions.size();
+    m_offsets.assign(bucket_count + 1, 0);
+
+    vector<size_t> buckets;
+    for (size_t i = 0, e = positions.size(); i < e; ++i)
+    {
+        collect_buckets(i, buckets);
+
+        for (size_t j = 0, je = buckets.size(); j < je; ++j)
+            ++m_offsets[buckets[j] + 1];
+    }
+
+    // Turn the counts into offsets.
+    for (size_t i = 1; i <= bucket_count; ++i)
+        m_offsets[i] += m_offsets[i - 1];
+
+    // Fill the buckets.
+    m_entries.resize(m_offsets[bucket_count]);
+    vector<uint32> cursors(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t i = 0, e = positions.size(); i < e; ++i)
+    {
+        collect_buckets(i, buckets);
+
+        for (size_t j = 0, je = buckets.size(); j < je; ++j)
+            m_entries[cursors[buckets[j]]++] = static_cast<uint32>(i);
+    }
+}
+
+void SPPMVisiblePointGrid::collect_buckets(
+    const size_t                index,
+    vector<size_t>&             buckets) const
+{
+    buckets.clear();
+
+    const float square_radius = (*m_square_radii)[index];
+    if (square_radius == 0.0f)
+        return;
+
+    // Compute the range of cells overlapped by the gathering sphere.
+    const Vector3f& position = (*m_positions)[index];
+    const float radius = sqrt(square_radius);
+    Vector3i cell_min, cell_max;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const float lo = (position[i] - radius - m_bbox.min[i]) * m_rcp_cell_size;
+        const float hi = (position[i] + radius - m_bbox.min[i]) * m_rcp_cell_size;
+        cell_min[i] = min(max(static_cast<int>(floor(lo)), 0), m_resolution[i] - 1);
+        cell_max[i] = min(max(static_cast<int>(floor(hi)), 0), m_resolution[i] - 1);
+    }
+
+    // Collect the buckets of these cells, without duplicates: distinct cells
+    // may hash to the same bucket and a visible point must only be visited once.
+    Vector3i cell;
+    for (cell[2] = cell_min[2]; cell[2] <= cell_max[2]; ++cell[2])
+    {
+        for (cell[1] = cell_min[1]; cell[1] <= cell_max[1]; ++cell[1])
+        {
+            for (cell[0] = cell_min[0]; cell[0] <= cell_max[0]; ++cell[0])
+            {
+                const size_t bucket = hash_cell(cell);
+
+                if (find(buckets.begin(), buckets.end(), bucket) == buckets.end())
+                    buckets.push_back(bucket);
+            }
+        }
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,187 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTGRID_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTGRID_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/hash.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A hashed uniform grid over the gathering spheres of a set of visible points.
+//
+// Each sphere is registered in every grid cell it overlaps, so that finding the
+// visible points whose sphere contains a given photon only requires visiting the
+// single cell that contains the photon. Cells are not stored explicitly: their
+// integer coordinates are hashed into a table whose size is proportional to the
+// number of visible points, stored in compressed (offsets + entries) form.
+//
+// Reference:
+//
+//   Physically Based Rendering, Third Edition, section 16.2.5
+//   Matt Pharr, Wenzel Jakob, Greg Humphreys
+//
+
+class SPPMVisiblePointGrid
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor, builds an empty grid.
+    SPPMVisiblePointGrid();
+
+    // Build the grid. The vectors are referenced, not copied, and must
+    // not be modified or destroyed until the grid is rebuilt or cleared.
+    void build(
+        const std::vector<foundation::Vector3f>&    positions,
+        const std::vector<float>&                   square_radii);
+
+    // Remove all visible points from the grid.
+    void clear();
+
+    // Return true if the grid is empty.
+    bool empty() const;
+
+    // Return the number of visible points in the grid.
+    size_t size() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+    // Invoke visitor.visit(index) for every visible point whose gathering
+    // sphere contains a given point. Each visible point is visited at most once.
+    template <typename Visitor>
+    void query(
+        const foundation::Vector3f&                 point,
+        Visitor&                                    visitor) const;
+
+  private:
+    const std::vector<foundation::Vector3f>*        m_positions;
+    const std::vector<float>*                       m_square_radii;
+    foundation::AABB3f                              m_bbox;
+    float                                           m_rcp_cell_size;
+    foundation::Vector3i                            m_resolution;
+    std::vector<foundation::uint32>                 m_offsets;  // bucket i spans [m_offsets[i], m_offsets[i + 1])
+    std::vector<foundation::uint32>                 m_entries;  // visible point indices
+
+    bool compute_cell(
+        const foundation::Vector3f&                 point,
+        foundation::Vector3i&                       cell) const;
+
+    size_t hash_cell(const foundation::Vector3i& cell) const;
+
+    void collect_buckets(
+        const size_t                                index,
+        std::vector<size_t>&                        buckets) const;
+};
+
+
+//
+// SPPMVisiblePointGrid class implementation.
+//
+
+inline bool SPPMVisiblePointGrid::empty() const
+{
+    return m_entries.empty();
+}
+
+inline size_t SPPMVisiblePointGrid::size() const
+{
+    return m_positions ? m_positions->size() : 0;
+}
+
+inline bool SPPMVisiblePointGrid::compute_cell(
+    const foundation::Vector3f&     point,
+    foundation::Vector3i&           cell) const
+{
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const float c = (point[i] - m_bbox.min[i]) * m_rcp_cell_size;
+
+        if (!(c >= 0.0f && c < static_cast<float>(m_resolution[i])))
+            return false;
+
+        cell[i] = std::min(foundation::truncate<int>(c), m_resolution[i] - 1);
+    }
+
+    return true;
+}
+
+inline size_t SPPMVisiblePointGrid::hash_cell(const foundation::Vector3i& cell) const
+{
+    const foundation::uint32 h =
+        foundation::mix_uint32(
+            static_cast<foundation::uint32>(cell[0]),
+            static_cast<foundation::uint32>(cell[1]),
+            static_cast<foundation::uint32>(cell[2]));
+
+    return h % (m_offsets.size() - 1);
+}
+
+template <typename Visitor>
+inline void SPPMVisiblePointGrid::query(
+    const foundation::Vector3f&     point,
+    Visitor&                        visitor) const
+{
+    if (m_entries.empty())
+        return;
+
+    // Points outside the grid can't be in any gathering sphere.
+    foundation::Vector3i cell;
+    if (!compute_cell(point, cell))
+        return;
+
+    const size_t bucket = hash_cell(cell);
+    const foundation::uint32* entries = &m_entries[0];
+    const foundation::Vector3f* positions = &(*m_positions)[0];
+    const float* square_radii = &(*m_square_radii)[0];
+
+    for (foundation::uint32 i = m_offsets[bucket], e = m_offsets[bucket + 1]; i < e; ++i)
+    {
+        // Buckets may be shared by several cells, so check actual distances.
+        const foundation::uint32 index = entries[i];
+        if (foundation::square_norm(positions[index] - point) <= square_radii[index])
+            visitor.visit(index);
+    }
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTGRID_H
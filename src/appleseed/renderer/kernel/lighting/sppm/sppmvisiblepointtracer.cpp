@@ -0,0 +1,410 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Interface header.
+#include "sppmvisiblepointtracer.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/pathtracer.h"
+#include "renderer/kernel/lighting/pathvertex.h"
+#include "renderer/kernel/lighting/scatteringmode.h"
+#include "renderer/kernel/lighting/sppm/sppmvisiblepoint.h"
+#include "renderer/kernel/lighting/tracer.h"
+#include "renderer/kernel/shading/oslshadergroupexec.h"
+#include "renderer/kernel/shading/shadingcontext.h"
+#include "renderer/kernel/shading/shadingpoint.h"
+#include "renderer/kernel/shading/shadingray.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/modeling/bsdf/bsdf.h"
+#include "renderer/modeling/camera/camera.h"
+#include "renderer/modeling/frame/frame.h"
+#include "renderer/modeling/scene/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/image.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/basis.h"
+#include "foundation/math/dual.h"
+#include "foundation/math/hash.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/statistics.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cstddef>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    //
+    // A path visitor that creates a visible point at the first non-specular vertex.
+    //
+
+    struct PathVisitor
+    {
+        const ShadingContext&       m_visible_point_shading_context;
+        const uint32                m_pixel_index;
+        SPPMVisiblePointVector&     m_visible_points;
+        bool                        m_done;
+
+        PathVisitor(
+            const ShadingContext&   visible_point_shading_context,
+            const uint32            pixel_index,
+            SPPMVisiblePointVector& visible_points)
+          : m_visible_point_shading_context(visible_point_shading_context)
+          , m_pixel_index(pixel_index)
+          , m_visible_points(visible_points)
+          , m_done(false)
+        {
+        }
+
+        bool accept_scattering(
+            const ScatteringMode::Mode  prev_mode,
+            const ScatteringMode::Mode  next_mode) const
+        {
+            assert(next_mode != ScatteringMode::None);
+
+            // Only follow specular bounces until the visible point is found.
+            return !m_done;
+        }
+
+        void on_miss(const PathVertex& vertex)
+        {
+        }
+
+        void on_hit(const PathVertex& vertex)
+        {
+            if (m_done)
+                return;
+
+            if (vertex.m_bsdf == 0 || vertex.m_bsdf->is_purely_specular())
+                return;
+
+            m_done = true;
+
+            // The inputs of the BRDF of a subsurface scattering vertex are owned by the
+            // BSSRDF and can't be evaluated again, don't create a visible point there.
+            if (vertex.m_bssrdf)
+                return;
+
+            SPPMVisiblePoint visible_point;
+            visible_point.m_geometric_normal = Vector3f(vertex.get_geometric_normal());
+            visible_point.m_shading_basis = Basis3f(vertex.get_shading_basis());
+            visible_point.m_outgoing = Vector3f(vertex.m_outgoing.get_value());
+            visible_point.m_bsdf = vertex.m_bsdf;
+            visible_point.m_pixel_index = m_pixel_index;
+            visible_point.m_flux.set(0.0f);
+            visible_point.m_photon_count = 0;
+
+            // The inputs of the BSDF of the path vertex live in an arena that is cleared
+            // for every pixel: evaluate them again in the arena of the visible points.
+            visible_point.m_bsdf_data =
+                vertex.m_bsdf->evaluate_inputs(
+                    m_visible_point_shading_context,
+                    *vertex.m_shading_point);
+
+            m_visible_points.push_back(Vector3f(vertex.get_point()), visible_point);
+        }
+
+        void on_scatter(const PathVertex& vertex)
+        {
+        }
+    };
+
+
+    //
+    // A job to trace the camera paths of a band of pixel rows.
+    //
+
+    class VisiblePointTracingJob
+      : public IJob
+    {
+      public:
+        VisiblePointTracingJob(
+            const Scene&            scene,
+            const Frame&            frame,
+            const TraceContext&     trace_context,
+            TextureStore&           texture_store,
+            OIIO::TextureSystem&    oiio_texture_system,
+            OSL::ShadingSystem&     shading_system,
+            const SPPMParameters&   params,
+            Arena&                  visible_point_arena,
+            SPPMVisiblePointVector& global_visible_points,
+            const size_t            row_begin,
+            const size_t            row_end,
+            const size_t            pass_hash,
+            IAbortSwitch&           abort_switch)
+          : m_camera(*scene.get_active_camera())
+          , m_frame(frame)
+          , m_texture_cache(texture_store)
+          , m_intersector(trace_context, m_texture_cache)
+          , m_oiio_texture_system(oiio_texture_system)
+          , m_shadergroup_exec(shading_system, m_arena)
+          , m_params(params)
+          , m_tracer(
+                scene,
+                m_intersector,
+                m_texture_cache,
+                m_shadergroup_exec,
+                m_params.m_transparency_threshold,
+                m_params.m_max_iterations,
+                false)
+          , m_visible_point_arena(visible_point_arena)
+          , m_global_visible_points(global_visible_points)
+          , m_row_begin(row_begin)
+          , m_row_end(row_end)
+          , m_pass_hash(pass_hash)
+          , m_abort_switch(abort_switch)
+        {
+            const CanvasProperties& props = frame.image().properties();
+            m_image_point_dx = Vector2d(1.0 / (4.0 * props.m_canvas_width), 0.0);
+            m_image_point_dy = Vector2d(0.0, -1.0 / (4.0 * props.m_canvas_height));
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            const ShadingContext shading_context(
+                m_intersector,
+                m_tracer,
+                m_texture_cache,
+                m_oiio_texture_system,
+                m_shadergroup_exec,
+                m_arena,
+                thread_index);
+
+            const ShadingContext visible_point_shading_context(
+                m_intersector,
+                m_tracer,
+                m_texture_cache,
+                m_oiio_texture_system,
+                m_shadergroup_exec,
+                m_visible_point_arena,
+                thread_index);
+
+            const uint32 instance = hash_uint32(static_cast<uint32>(m_pass_hash + m_row_begin));
+            SamplingContext::RNGType rng(instance);
+            SamplingContext sampling_context(
+                rng,
+                m_params.m_sampling_mode,
+                2,                          // number of dimensions
+                0,                          // number of samples -- unknown
+                instance);                  // initial instance number
+
+            const CanvasProperties& props = m_frame.image().properties();
+            const AABB2u& crop_window = m_frame.get_crop_window();
+
+            for (size_t y = m_row_begin; y < m_row_end && !m_abort_switch.is_aborted(); ++y)
+            {
+                for (size_t x = crop_window.min.x; x <= crop_window.max.x; ++x)
+                {
+                    m_arena.clear();
+                    trace_visible_point(
+                        shading_context,
+                        visible_point_shading_context,
+                        sampling_context,
+                        x,
+                        y,
+                        static_cast<uint32>(y * props.m_canvas_width + x));
+                }
+            }
+
+            m_global_visible_points.append(m_local_visible_points);
+        }
+
+      private:
+        const Camera&               m_camera;
+        const Frame&                m_frame;
+        TextureCache                m_texture_cache;
+        Intersector                 m_intersector;
+        OIIO::TextureSystem&        m_oiio_texture_system;
+        Arena                       m_arena;
+        OSLShaderGroupExec          m_shadergroup_exec;
+        const SPPMParameters        m_params;
+        Tracer                      m_tracer;
+        Arena&                      m_visible_point_arena;
+        SPPMVisiblePointVector&     m_global_visible_points;
+        const size_t                m_row_begin;
+        const size_t                m_row_end;
+        const size_t                m_pass_hash;
+        IAbortSwitch&               m_abort_switch;
+        SPPMVisiblePointVector      m_local_visible_points;
+        Vector2d                    m_image_point_dx;
+        Vector2d                    m_image_point_dy;
+
+        void trace_visible_point(
+            const ShadingContext&   shading_context,
+            const ShadingContext&   visible_point_shading_context,
+            SamplingContext&        sampling_context,
+            const size_t            x,
+            const size_t            y,
+            const uint32            pixel_index)
+        {
+            // Pick a random position inside the pixel.
+            const Vector2d s = sampling_context.next2<Vector2d>();
+            const Vector2d image_point = m_frame.get_sample_position(x, y, s[0], s[1]);
+
+            // Build the camera ray.
+            ShadingRay ray;
+            m_camera.spawn_ray(
+                sampling_context,
+                Dual2d(image_point, m_image_point_dx, m_image_point_dy),
+                ray);
+
+            // Build the path tracer.
+            PathVisitor path_visitor(
+                visible_point_shading_context,
+                pixel_index,
+                m_local_visible_points);
+            PathTracer<PathVisitor, false> path_tracer(     // false = not adjoint
+                path_visitor,
+                m_params.m_path_tracing_rr_min_path_length,
+                m_params.m_path_tracing_max_bounces,
+                ~0, // max diffuse bounces
+                ~0, // max glossy bounces
+                ~0, // max specular bounces
+                m_params.m_max_iterations);
+
+            // Trace the camera path.
+            path_tracer.trace(
+                sampling_context,
+                shading_context,
+                ray);
+        }
+    };
+}
+
+
+//
+// SPPMVisiblePointTracer class implementation.
+//
+
+SPPMVisiblePointTracer::SPPMVisiblePointTracer(
+    const Scene&            scene,
+    const TraceContext&     trace_context,
+    TextureStore&           texture_store,
+    OIIO::TextureSystem&    oiio_texture_system,
+    OSL::ShadingSystem&     shading_system,
+    const SPPMParameters&   params)
+  : m_params(params)
+  , m_scene(scene)
+  , m_trace_context(trace_context)
+  , m_texture_store(texture_store)
+  , m_oiio_texture_system(oiio_texture_system)
+  , m_shading_system(shading_system)
+{
+}
+
+SPPMVisiblePointTracer::~SPPMVisiblePointTracer()
+{
+    for (size_t i = 0, e = m_arenas.size(); i < e; ++i)
+        delete m_arenas[i];
+}
+
+void SPPMVisiblePointTracer::trace_visible_points(
+    const Frame&            frame,
+    SPPMVisiblePointVector& visible_points,
+    const size_t            pass_hash,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
+{
+    // Start stopwatch.
+    Stopwatch<DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    // The visible points of the previous pass are no longer needed.
+    for (size_t i = 0, e = m_arenas.size(); i < e; ++i)
+        m_arenas[i]->clear();
+
+    const size_t RowsPerJob = 8;
+    const AABB2u& crop_window = frame.get_crop_window();
+
+    RENDERER_LOG_INFO(
+        "tracing sppm visible points for %s %s...",
+        pretty_uint(frame.get_pixel_count()).c_str(),
+        frame.get_pixel_count() > 1 ? "pixels" : "pixel");
+
+    // Schedule visible point tracing jobs.
+    size_t job_count = 0;
+    for (size_t y = crop_window.min.y; y <= crop_window.max.y; y += RowsPerJob)
+    {
+        if (job_count == m_arenas.size())
+            m_arenas.push_back(new Arena());
+
+        job_queue.schedule(
+            new VisiblePointTracingJob(
+                m_scene,
+                frame,
+                m_trace_context,
+                m_texture_store,
+                m_oiio_texture_system,
+                m_shading_system,
+                m_params,
+                *m_arenas[job_count],
+                visible_points,
+                y,
+                min(y + RowsPerJob, static_cast<size_t>(crop_window.max.y) + 1),
+                pass_hash,
+                abort_switch));
+
+        ++job_count;
+    }
+
+    // Wait until the visible point tracing jobs have completed.
+    job_queue.wait_until_completion();
+
+    // Print visible point tracing statistics.
+    size_t arena_memory_size = 0;
+    for (size_t i = 0; i < job_count; ++i)
+        arena_memory_size += m_arenas[i]->get_capacity();
+    Statistics statistics;
+    statistics.insert("tracing jobs", job_count);
+    statistics.insert_time("tracing time", stopwatch.measure().get_seconds());
+    statistics.insert("visible points", visible_points.size());
+    statistics.insert_size("bsdf inputs size", arena_memory_size);
+    RENDERER_LOG_DEBUG("%s",
+        StatisticsVector::make(
+            "sppm visible point tracing statistics",
+            statistics).to_string().c_str());
+}
+
+}   // namespace renderer
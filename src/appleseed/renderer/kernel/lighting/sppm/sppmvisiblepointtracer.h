@@ -0,0 +1,106 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTTRACER_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTTRACER_H
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sppm/sppmparameters.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// OSL headers.
+#include "foundation/platform/oslheaderguards.h"
+BEGIN_OSL_INCLUDES
+#include "OSL/oslexec.h"
+END_OSL_INCLUDES
+
+// OpenImageIO headers.
+#include "foundation/platform/oiioheaderguards.h"
+BEGIN_OIIO_INCLUDES
+#include "OpenImageIO/texture.h"
+END_OIIO_INCLUDES
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class Arena; }
+namespace foundation    { class IAbortSwitch; }
+namespace foundation    { class JobQueue; }
+namespace renderer      { class Frame; }
+namespace renderer      { class Scene; }
+namespace renderer      { class SPPMVisiblePointVector; }
+namespace renderer      { class TextureStore; }
+namespace renderer      { class TraceContext; }
+
+namespace renderer
+{
+
+//
+// Traces one camera path per pixel and creates a visible point at the
+// first non-specular vertex of each path.
+//
+
+class SPPMVisiblePointTracer
+  : public foundation::NonCopyable
+{
+  public:
+    SPPMVisiblePointTracer(
+        const Scene&                scene,
+        const TraceContext&         trace_context,
+        TextureStore&               texture_store,
+        OIIO::TextureSystem&        oiio_texture_system,
+        OSL::ShadingSystem&         shading_system,
+        const SPPMParameters&       params);
+
+    ~SPPMVisiblePointTracer();
+
+    // The BSDF inputs of the visible points remain valid until the next call.
+    void trace_visible_points(
+        const Frame&                frame,
+        SPPMVisiblePointVector&     visible_points,
+        const size_t                pass_hash,
+        foundation::JobQueue&       job_queue,
+        foundation::IAbortSwitch&   abort_switch);
+
+  private:
+    const SPPMParameters            m_params;
+    const Scene&                    m_scene;
+    const TraceContext&             m_trace_context;
+    TextureStore&                   m_texture_store;
+    OIIO::TextureSystem&            m_oiio_texture_system;
+    OSL::ShadingSystem&             m_shading_system;
+    std::vector<foundation::Arena*> m_arenas;           // one per job, hold the BSDF inputs of the visible points
+};
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMVISIBLEPOINTTRACER_H
@@ -37,6 +37,7 @@
 #include "renderer/modeling/project/project.h"
 #include "renderer/modeling/scene/scene.h"
 #include "renderer/modeling/scene/visibilityflags.h"
+#include "renderer/utility/settingsparsing.h"
 
 // appleseed.foundation headers.
 #include "foundation/platform/compiler.h"
@@ -158,6 +159,11 @@ void BaseRenderer::initialize_oiio()
         m_texture_system->invalidate_all(true);
         m_texture_system->attribute("searchpath", new_search_path);
     }
+    else
+    {
+        // Keep the texture cache warm, only forget about the files modified on disk.
+        m_texture_system->invalidate_all(false);
+    }
 }
 
 bool BaseRenderer::initialize_osl(TextureStore& texture_store, IAbortSwitch& abort_switch)
@@ -179,6 +185,7 @@ bool BaseRenderer::initialize_osl(TextureStore& texture_store, IAbortSwitch& abo
     return
         m_project.get_scene()->create_optimized_osl_shader_groups(
             *m_shading_system,
+            get_rendering_thread_count(m_params),
             &abort_switch);
 }
 
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/rendering/pixelcontext.h"
 #include "renderer/kernel/shading/shadingresult.h"
 
 // appleseed.foundation headers.
@@ -71,6 +72,23 @@ namespace
             shading_result.set_aovs_to_transparent_black_linear_rgba();
         }
 
+        virtual void render_samples(
+            SamplingContext     sampling_contexts[],
+            const Vector2i      pixel_coords[],
+            const Vector2d      image_points[],
+            ShadingResult       shading_results[],
+            const size_t        sample_count) APPLESEED_OVERRIDE
+        {
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                render_sample(
+                    sampling_contexts[i],
+                    PixelContext(pixel_coords[i], image_points[i]),
+                    image_points[i],
+                    shading_results[i]);
+            }
+        }
+
         virtual StatisticsVector get_statistics() const APPLESEED_OVERRIDE
         {
             return StatisticsVector();
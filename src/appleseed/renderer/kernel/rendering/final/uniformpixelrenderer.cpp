@@ -34,6 +34,7 @@
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/aov/imagestack.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/aov/spectrumstack.h"
 #include "renderer/kernel/rendering/final/pixelsampler.h"
 #include "renderer/kernel/rendering/isamplerenderer.h"
@@ -51,13 +52,18 @@
 #include "foundation/math/hash.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/memory.h"
 #include "foundation/utility/statistics.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cmath>
+#include <new>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class Tile; }
@@ -75,6 +81,9 @@ namespace
     // Uniform pixel renderer.
     //
 
+    // Maximum number of samples shaded together when sorting by material.
+    const size_t MaxShadingBatchSize = 4096;
+
     class UniformPixelRenderer
       : public PixelRendererBase
     {
@@ -87,7 +96,16 @@ namespace
           , m_sample_renderer(factory->create(thread_index))
           , m_sample_count(m_params.m_samples)
           , m_sqrt_sample_count(round<int>(sqrt(static_cast<double>(m_params.m_samples))))
+          , m_batch_capacity(max(MaxShadingBatchSize, m_sample_count))
+          , m_batch_shading_results(0)
         {
+            if (m_params.m_sort_by_material)
+            {
+                m_batch_shading_results =
+                    static_cast<ShadingResult*>(
+                        aligned_malloc(m_batch_capacity * sizeof(ShadingResult), 16));
+            }
+
             if (!m_params.m_decorrelate)
             {
                 m_pixel_sampler.initialize(m_sqrt_sample_count);
@@ -105,11 +123,27 @@ namespace
             }
         }
 
+        ~UniformPixelRenderer()
+        {
+            aligned_free(m_batch_shading_results);
+        }
+
         virtual void release() APPLESEED_OVERRIDE
         {
             delete this;
         }
 
+        virtual void on_tile_begin(
+            const Frame&                frame,
+            Tile&                       tile,
+            TileStack&                  aov_tiles) APPLESEED_OVERRIDE
+        {
+            PixelRendererBase::on_tile_begin(frame, tile, aov_tiles);
+
+            // Discard the samples left over by an aborted tile.
+            clear_batch();
+        }
+
         virtual void render_pixel(
             const Frame&                frame,
             Tile&                       tile,
@@ -123,52 +157,39 @@ namespace
         {
             const size_t aov_count = frame.aov_images().size();
 
+            if (m_params.m_sort_by_material)
+            {
+                // Samples are shaded in batches, once enough pixels were submitted.
+                SamplingContext sampling_context(make_sampling_context(frame, pass_hash, pi, rng));
+                defer_pixel_samples(frame, pi, pt, sampling_context, framebuffer);
+                return;
+            }
+
             on_pixel_begin();
 
             if (m_params.m_decorrelate)
             {
-                // Create a sampling context.
-                const size_t frame_width = frame.image().properties().m_canvas_width;
-                const size_t instance = hash_uint32(static_cast<uint32>(pass_hash + pi.y * frame_width + pi.x));
-                SamplingContext sampling_context(
-                    rng,
-                    m_params.m_sampling_mode,
-                    2,                          // number of dimensions
-                    0,                          // number of samples -- unknown
-                    instance);                  // initial instance number
+                SamplingContext sampling_context(make_sampling_context(frame, pass_hash, pi, rng));
 
-                for (size_t i = 0; i < m_sample_count; ++i)
+                if (m_params.m_packet_primary_rays)
                 {
-                    // Generate a uniform sample in [0,1)^2.
-                    const Vector2d s =
-                        m_sample_count > 1 || m_params.m_force_aa
-                            ? sampling_context.next2<Vector2d>()
-                            : Vector2d(0.5);
-
-                    // Compute the sample position in NDC.
-                    const Vector2d sample_position = frame.get_sample_position(pi.x + s.x, pi.y + s.y);
-
-                    // Create a pixel context that identifies the pixel and sample currently being rendered.
-                    const PixelContext pixel_context(pi, sample_position);
-
-                    // Render the sample.
-                    ShadingResult shading_result(aov_count);
-                    SamplingContext child_sampling_context(sampling_context);
-                    m_sample_renderer->render_sample(
-                        child_sampling_context,
-                        pixel_context,
-                        sample_position,
-                        shading_result);
-
-                    // Merge the sample into the framebuffer.
-                    if (shading_result.is_valid_linear_rgb())
-                    {
-                        framebuffer.add(
-                            static_cast<float>(pt.x + s.x),
-                            static_cast<float>(pt.y + s.y),
-                            shading_result);
-                    }
-                    else signal_invalid_sample();
+                    render_pixel_packets(
+                        frame,
+                        pi,
+                        pt,
+                        aov_count,
+                        sampling_context,
+                        framebuffer);
+                }
+                else
+                {
+                    render_pixel_samples(
+                        frame,
+                        pi,
+                        pt,
+                        aov_count,
+                        sampling_context,
+                        framebuffer);
                 }
             }
             else
@@ -225,6 +246,57 @@ namespace
             on_pixel_end(pi);
         }
 
+        virtual void flush_pixels(
+            const Frame&                frame,
+            ShadingResultFrameBuffer&   framebuffer) APPLESEED_OVERRIDE
+        {
+            const size_t sample_count = m_batch_sampling_contexts.size();
+
+            if (sample_count == 0)
+                return;
+
+            // Shading results are not copyable, construct them in place.
+            const size_t aov_count = frame.aov_images().size();
+            for (size_t i = 0; i < sample_count; ++i)
+                new (&m_batch_shading_results[i]) ShadingResult(aov_count);
+
+            // Render all the samples of the batch at once.
+            m_sample_renderer->render_samples(
+                &m_batch_sampling_contexts[0],
+                &m_batch_pixel_coords[0],
+                &m_batch_sample_positions[0],
+                m_batch_shading_results,
+                sample_count);
+
+            // Merge the samples into the framebuffer. The samples of a pixel are contiguous.
+            for (size_t i = 0; i < sample_count; )
+            {
+                const Vector2i pi = m_batch_pixel_coords[i];
+
+                on_pixel_begin();
+
+                for (; i < sample_count && m_batch_pixel_coords[i] == pi; ++i)
+                {
+                    const ShadingResult& shading_result = m_batch_shading_results[i];
+
+                    if (shading_result.is_valid_linear_rgb())
+                    {
+                        framebuffer.add(
+                            m_batch_tile_positions[i].x,
+                            m_batch_tile_positions[i].y,
+                            shading_result);
+                    }
+                    else signal_invalid_sample();
+
+                    m_batch_shading_results[i].~ShadingResult();
+                }
+
+                on_pixel_end(pi);
+            }
+
+            clear_batch();
+        }
+
         virtual StatisticsVector get_statistics() const APPLESEED_OVERRIDE
         {
             return m_sample_renderer->get_statistics();
@@ -237,12 +309,16 @@ namespace
             const size_t                    m_samples;
             const bool                      m_force_aa;
             const bool                      m_decorrelate;
+            const bool                      m_packet_primary_rays;
+            const bool                      m_sort_by_material;
 
             explicit Parameters(const ParamArray& params)
               : m_sampling_mode(get_sampling_context_mode(params))
               , m_samples(params.get_required<size_t>("samples", 64))
               , m_force_aa(params.get_optional<bool>("force_antialiasing", false))
               , m_decorrelate(params.get_optional<bool>("decorrelate_pixels", true))
+              , m_packet_primary_rays(params.get_optional<bool>("packet_primary_rays", false))
+              , m_sort_by_material(m_decorrelate && params.get_optional<bool>("sort_by_material", false))
             {
             }
         };
@@ -252,6 +328,180 @@ namespace
         const size_t                        m_sample_count;
         const int                           m_sqrt_sample_count;
         PixelSampler                        m_pixel_sampler;
+
+        // Batch of samples rendered together when packet primary rays are enabled.
+        vector<SamplingContext>             m_batch_sampling_contexts;
+        vector<Vector2i>                    m_batch_pixel_coords;
+        vector<Vector2d>                    m_batch_sample_positions;
+        vector<Vector2d>                    m_batch_samples;
+
+        // Batch of samples deferred until the end of the tile when sorting by material.
+        const size_t                        m_batch_capacity;
+        vector<Vector2f>                    m_batch_tile_positions;
+        ShadingResult*                      m_batch_shading_results;
+
+        SamplingContext make_sampling_context(
+            const Frame&                frame,
+            const size_t                pass_hash,
+            const Vector2i&             pi,
+            SamplingContext::RNGType&   rng) const
+        {
+            const size_t frame_width = frame.image().properties().m_canvas_width;
+            const size_t instance = hash_uint32(static_cast<uint32>(pass_hash + pi.y * frame_width + pi.x));
+
+            return
+                SamplingContext(
+                    rng,
+                    m_params.m_sampling_mode,
+                    2,                          // number of dimensions
+                    0,                          // number of samples -- unknown
+                    instance);                  // initial instance number
+        }
+
+        void clear_batch()
+        {
+            m_batch_sampling_contexts.clear();
+            m_batch_pixel_coords.clear();
+            m_batch_sample_positions.clear();
+            m_batch_tile_positions.clear();
+        }
+
+        void defer_pixel_samples(
+            const Frame&                frame,
+            const Vector2i&             pi,
+            const Vector2i&             pt,
+            SamplingContext&            sampling_context,
+            ShadingResultFrameBuffer&   framebuffer)
+        {
+            // Make room for the samples of this pixel.
+            if (m_batch_sampling_contexts.size() + m_sample_count > m_batch_capacity)
+                flush_pixels(frame, framebuffer);
+
+            for (size_t i = 0; i < m_sample_count; ++i)
+            {
+                // Generate a uniform sample in [0,1)^2.
+                const Vector2d s =
+                    m_sample_count > 1 || m_params.m_force_aa
+                        ? sampling_context.next2<Vector2d>()
+                        : Vector2d(0.5);
+
+                m_batch_sampling_contexts.push_back(sampling_context);
+                m_batch_pixel_coords.push_back(pi);
+                m_batch_sample_positions.push_back(frame.get_sample_position(pi.x + s.x, pi.y + s.y));
+                m_batch_tile_positions.push_back(
+                    Vector2f(
+                        static_cast<float>(pt.x + s.x),
+                        static_cast<float>(pt.y + s.y)));
+            }
+        }
+
+        void render_pixel_samples(
+            const Frame&                frame,
+            const Vector2i&             pi,
+            const Vector2i&             pt,
+            const size_t                aov_count,
+            SamplingContext&            sampling_context,
+            ShadingResultFrameBuffer&   framebuffer)
+        {
+            for (size_t i = 0; i < m_sample_count; ++i)
+            {
+                // Generate a uniform sample in [0,1)^2.
+                const Vector2d s =
+                    m_sample_count > 1 || m_params.m_force_aa
+                        ? sampling_context.next2<Vector2d>()
+                        : Vector2d(0.5);
+
+                // Compute the sample position in NDC.
+                const Vector2d sample_position = frame.get_sample_position(pi.x + s.x, pi.y + s.y);
+
+                // Create a pixel context that identifies the pixel and sample currently being rendered.
+                const PixelContext pixel_context(pi, sample_position);
+
+                // Render the sample.
+                ShadingResult shading_result(aov_count);
+                SamplingContext child_sampling_context(sampling_context);
+                m_sample_renderer->render_sample(
+                    child_sampling_context,
+                    pixel_context,
+                    sample_position,
+                    shading_result);
+
+                // Merge the sample into the framebuffer.
+                if (shading_result.is_valid_linear_rgb())
+                {
+                    framebuffer.add(
+                        static_cast<float>(pt.x + s.x),
+                        static_cast<float>(pt.y + s.y),
+                        shading_result);
+                }
+                else signal_invalid_sample();
+            }
+        }
+
+        void render_pixel_packets(
+            const Frame&                frame,
+            const Vector2i&             pi,
+            const Vector2i&             pt,
+            const size_t                aov_count,
+            SamplingContext&            sampling_context,
+            ShadingResultFrameBuffer&   framebuffer)
+        {
+            for (size_t begin = 0; begin < m_sample_count; begin += RayPacketSize)
+            {
+                const size_t batch_size = min(m_sample_count - begin, RayPacketSize);
+
+                m_batch_sampling_contexts.clear();
+                m_batch_pixel_coords.assign(batch_size, pi);
+                m_batch_sample_positions.clear();
+                m_batch_samples.clear();
+
+                // Shading results are not copyable, construct them in place.
+                APPLESEED_SIMD4_ALIGN uint8 shading_result_storage[RayPacketSize * sizeof(ShadingResult)];
+                ShadingResult* shading_results = reinterpret_cast<ShadingResult*>(shading_result_storage);
+                for (size_t i = 0; i < batch_size; ++i)
+                    new (&shading_results[i]) ShadingResult(aov_count);
+
+                for (size_t i = 0; i < batch_size; ++i)
+                {
+                    // Generate a uniform sample in [0,1)^2.
+                    const Vector2d s =
+                        m_sample_count > 1 || m_params.m_force_aa
+                            ? sampling_context.next2<Vector2d>()
+                            : Vector2d(0.5);
+
+                    // Compute the sample position in NDC.
+                    m_batch_samples.push_back(s);
+                    m_batch_sample_positions.push_back(frame.get_sample_position(pi.x + s.x, pi.y + s.y));
+                    m_batch_sampling_contexts.push_back(sampling_context);
+                }
+
+                // Render the samples.
+                m_sample_renderer->render_samples(
+                    &m_batch_sampling_contexts[0],
+                    &m_batch_pixel_coords[0],
+                    &m_batch_sample_positions[0],
+                    shading_results,
+                    batch_size);
+
+                // Merge the samples into the framebuffer.
+                for (size_t i = 0; i < batch_size; ++i)
+                {
+                    const Vector2d& s = m_batch_samples[i];
+                    const ShadingResult& shading_result = shading_results[i];
+
+                    if (shading_result.is_valid_linear_rgb())
+                    {
+                        framebuffer.add(
+                            static_cast<float>(pt.x + s.x),
+                            static_cast<float>(pt.y + s.y),
+                            shading_result);
+                    }
+                    else signal_invalid_sample();
+
+                    shading_results[i].~ShadingResult();
+                }
+            }
+        }
     };
 }
 
@@ -311,6 +561,26 @@ Dictionary UniformPixelRendererFactory::get_params_metadata()
                 "help",
                 "Avoid correlation patterns at the expense of slightly more sampling noise"));
 
+    metadata.dictionaries().insert(
+        "packet_primary_rays",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Packet Primary Rays")
+            .insert(
+                "help",
+                "Trace the primary rays of each pixel in packets (requires pixel decorrelation)"));
+
+    metadata.dictionaries().insert(
+        "sort_by_material",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Sort By Material")
+            .insert(
+                "help",
+                "Shade the samples of each tile in large batches sorted by material (requires pixel decorrelation)"));
+
     return metadata;
 }
 
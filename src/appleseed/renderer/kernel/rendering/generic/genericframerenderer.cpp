@@ -46,7 +46,6 @@
 #include "foundation/platform/thread.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/containers/dictionary.h"
-#include "foundation/utility/foreach.h"
 #include "foundation/utility/job.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
@@ -312,9 +311,16 @@ namespace
                         tile_jobs,
                         m_abort_switch);
 
-                    // Schedule tile jobs.
-                    for (const_each<TileJobFactory::TileJobVector> i = tile_jobs; i; ++i)
-                        m_job_queue.schedule(*i);
+                    // Schedule tile jobs. Consecutive tiles in the rendering order are
+                    // neighbours in the frame: hand out short runs of tiles to the rendering
+                    // threads in turn, so that each thread works on nearby tiles while the
+                    // frame still fills up in the rendering order. Idle threads will steal
+                    // tiles from the others.
+                    const size_t TileRunLength = 4;
+                    const size_t tile_count = tile_jobs.size();
+                    const size_t thread_count = m_tile_renderers.size();
+                    for (size_t i = 0; i < tile_count; ++i)
+                        m_job_queue.schedule(tile_jobs[i], true, (i / TileRunLength) % thread_count);
 
                     // Wait until tile jobs have effectively stopped.
                     m_job_queue.wait_until_completion();
@@ -35,10 +35,12 @@
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/aov/aovaccumulator.h"
 #include "renderer/kernel/aov/spectrumstack.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/intersection/intersector.h"
 #include "renderer/kernel/intersection/tracecontext.h"
 #include "renderer/kernel/lighting/ilightingengine.h"
 #include "renderer/kernel/lighting/tracer.h"
+#include "renderer/kernel/rendering/pixelcontext.h"
 #include "renderer/kernel/shading/oslshadergroupexec.h"
 #include "renderer/kernel/shading/shadingcontext.h"
 #include "renderer/kernel/shading/shadingengine.h"
@@ -49,6 +51,7 @@
 #include "renderer/kernel/texturing/texturecache.h"
 #include "renderer/modeling/camera/camera.h"
 #include "renderer/modeling/frame/frame.h"
+#include "renderer/modeling/material/material.h"
 #include "renderer/modeling/scene/scene.h"
 
 // appleseed.foundation headers.
@@ -56,6 +59,7 @@
 #include "foundation/image/colorspace.h"
 #include "foundation/image/image.h"
 #include "foundation/image/regularspectrum.h"
+#include "foundation/math/population.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/arena.h"
@@ -63,12 +67,11 @@
 #include "foundation/utility/string.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 #include <string>
-
-// Forward declarations.
-namespace renderer  { class PixelContext; }
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -135,6 +138,8 @@ namespace
                 m_params.m_transparency_threshold,
                 m_params.m_max_iterations)
           , m_aov_accumulators(frame.aovs())
+          , m_batch_hits(0)
+          , m_batch_hit_capacity(0)
         {
             // 1/4 of a pixel, like in Renderman RIS.
             const CanvasProperties& c = frame.image().properties();
@@ -144,6 +149,7 @@ namespace
 
         ~GenericSampleRenderer()
         {
+            delete [] m_batch_hits;
             m_lighting_engine->release();
         }
 
@@ -158,13 +164,6 @@ namespace
             const Vector2d&         image_point,
             ShadingResult&          shading_result) APPLESEED_OVERRIDE
         {
-#ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCES
-
-            const uint64 last_texture_cache_hit_count = m_texture_cache.get_hit_count();
-            const uint64 last_texture_cache_miss_count = m_texture_cache.get_miss_count();
-
-#endif
-
             // Construct a primary ray.
             ShadingRay primary_ray;
             m_scene.get_active_camera()->spawn_ray(
@@ -172,6 +171,279 @@ namespace
                 Dual2d(image_point, m_image_point_dx, m_image_point_dy),
                 primary_ray);
 
+            render_primary_ray(
+                sampling_context,
+                pixel_context,
+                primary_ray,
+                0,
+                shading_result);
+        }
+
+        virtual void render_samples(
+            SamplingContext         sampling_contexts[],
+            const Vector2i          pixel_coords[],
+            const Vector2d          image_points[],
+            ShadingResult           shading_results[],
+            const size_t            sample_count) APPLESEED_OVERRIDE
+        {
+            if (m_params.m_sort_by_material)
+            {
+                render_sorted_samples(
+                    sampling_contexts,
+                    pixel_coords,
+                    image_points,
+                    shading_results,
+                    sample_count);
+                return;
+            }
+
+            if (!m_params.m_packet_primary_rays)
+            {
+                for (size_t i = 0; i < sample_count; ++i)
+                {
+                    render_sample(
+                        sampling_contexts[i],
+                        PixelContext(pixel_coords[i], image_points[i]),
+                        image_points[i],
+                        shading_results[i]);
+                }
+
+                return;
+            }
+
+            for (size_t begin = 0; begin < sample_count; begin += RayPacketSize)
+            {
+                const size_t packet_size = min(sample_count - begin, RayPacketSize);
+
+                // Construct the primary rays.
+                ShadingRay primary_rays[RayPacketSize];
+                for (size_t i = 0; i < packet_size; ++i)
+                {
+                    m_scene.get_active_camera()->spawn_ray(
+                        sampling_contexts[begin + i],
+                        Dual2d(image_points[begin + i], m_image_point_dx, m_image_point_dy),
+                        primary_rays[i]);
+                }
+
+                // Find the first hits of the whole packet at once.
+                ShadingPoint first_hits[RayPacketSize];
+                m_intersector.trace_packet(primary_rays, first_hits, packet_size);
+
+                // Shade the samples one by one.
+                for (size_t i = 0; i < packet_size; ++i)
+                {
+                    render_primary_ray(
+                        sampling_contexts[begin + i],
+                        PixelContext(pixel_coords[begin + i], image_points[begin + i]),
+                        primary_rays[i],
+                        &first_hits[i],
+                        shading_results[begin + i]);
+                }
+            }
+        }
+
+        virtual StatisticsVector get_statistics() const APPLESEED_OVERRIDE
+        {
+            StatisticsVector stats;
+            stats.merge(m_texture_cache.get_statistics());
+            stats.merge(m_intersector.get_statistics());
+            stats.merge(m_lighting_engine->get_statistics());
+
+            Population<uint64> arena_high_water_mark;
+            arena_high_water_mark.insert(m_arena.get_high_water_mark());
+            Population<uint64> arena_block_count;
+            arena_block_count.insert(m_arena.get_block_count());
+
+            Statistics arena_stats;
+            arena_stats.insert("high-water mark", arena_high_water_mark, "bytes");
+            arena_stats.insert("blocks", arena_block_count);
+            stats.insert("arena statistics", arena_stats);
+
+            if (m_params.m_sort_by_material)
+            {
+                Statistics batch_stats;
+                batch_stats.insert("samples per batch", m_batch_sizes);
+                batch_stats.insert("material runs (unsorted)", m_unsorted_material_runs);
+                batch_stats.insert("material runs (sorted)", m_sorted_material_runs);
+                stats.insert("shading batch statistics", batch_stats);
+            }
+
+            return stats;
+        }
+
+      private:
+        struct Parameters
+        {
+            const float     m_transparency_threshold;
+            const size_t    m_max_iterations;
+            const bool      m_report_self_intersections;
+            const bool      m_packet_primary_rays;
+            const bool      m_sort_by_material;
+
+            explicit Parameters(const ParamArray& params)
+              : m_transparency_threshold(params.get_optional<float>("transparency_threshold", 0.001f))
+              , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
+              , m_report_self_intersections(params.get_optional<bool>("report_self_intersections", false))
+              , m_packet_primary_rays(params.get_optional<bool>("packet_primary_rays", false))
+              , m_sort_by_material(params.get_optional<bool>("sort_by_material", false))
+            {
+            }
+        };
+
+        const Parameters            m_params;
+        const Scene&                m_scene;
+        const LightingConditions&   m_lighting_conditions;
+        const float                 m_opacity_threshold;
+        TextureCache                m_texture_cache;
+        ILightingEngine*            m_lighting_engine;
+        ShadingEngine&              m_shading_engine;
+        OIIO::TextureSystem&        m_oiio_texture_system;
+        const size_t                m_thread_index;
+
+        Arena                       m_arena;
+        OSLShaderGroupExec          m_shadergroup_exec;
+        const Intersector           m_intersector;
+        Tracer                      m_tracer;
+        const ShadingContext        m_shading_context;
+
+        Vector2d                    m_image_point_dx;
+        Vector2d                    m_image_point_dy;
+
+        AOVAccumulatorContainer     m_aov_accumulators;
+
+        // Primary rays and first hits of a batch of samples sorted by material.
+        struct ShadingOrderItem
+        {
+            const void*             m_key;
+            size_t                  m_index;
+
+            bool operator<(const ShadingOrderItem& rhs) const
+            {
+                return m_key < rhs.m_key;
+            }
+        };
+
+        vector<ShadingRay>          m_batch_rays;
+        ShadingPoint*               m_batch_hits;       // shading points are not copyable
+        size_t                      m_batch_hit_capacity;
+        vector<ShadingOrderItem>    m_batch_order;
+        Population<uint64>          m_batch_sizes;
+        Population<uint64>          m_unsorted_material_runs;
+        Population<uint64>          m_sorted_material_runs;
+
+        // Return the key by which first hits are grouped before shading: the OSL shader group
+        // of the material if it has one, the material otherwise, and null for misses.
+        static const void* get_shading_key(const ShadingPoint& shading_point)
+        {
+            if (!shading_point.hit())
+                return 0;
+
+            const Material* material = shading_point.get_material();
+
+            if (material == 0)
+                return 0;
+
+            const Material::RenderData& render_data = material->get_render_data();
+
+            return
+                render_data.m_shader_group != 0
+                    ? static_cast<const void*>(render_data.m_shader_group)
+                    : static_cast<const void*>(material);
+        }
+
+        static size_t count_material_runs(const vector<ShadingOrderItem>& items)
+        {
+            size_t runs = items.empty() ? 0 : 1;
+
+            for (size_t i = 1; i < items.size(); ++i)
+            {
+                if (items[i].m_key != items[i - 1].m_key)
+                    ++runs;
+            }
+
+            return runs;
+        }
+
+        // Trace the primary rays of a batch of samples, then shade the first hits grouped by
+        // material so that consecutive shading calls run the same code and touch the same data.
+        void render_sorted_samples(
+            SamplingContext         sampling_contexts[],
+            const Vector2i          pixel_coords[],
+            const Vector2d          image_points[],
+            ShadingResult           shading_results[],
+            const size_t            sample_count)
+        {
+            if (m_batch_hit_capacity < sample_count)
+            {
+                delete [] m_batch_hits;
+                m_batch_hits = new ShadingPoint[sample_count];
+                m_batch_hit_capacity = sample_count;
+            }
+
+            m_batch_rays.resize(sample_count);
+            m_batch_order.resize(sample_count);
+
+            // Construct the primary rays.
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                m_scene.get_active_camera()->spawn_ray(
+                    sampling_contexts[i],
+                    Dual2d(image_points[i], m_image_point_dx, m_image_point_dy),
+                    m_batch_rays[i]);
+                m_batch_hits[i].clear();
+            }
+
+            // Find the first hits of the whole batch.
+            if (m_params.m_packet_primary_rays)
+                m_intersector.trace_stream(&m_batch_rays[0], m_batch_hits, sample_count);
+            else
+            {
+                for (size_t i = 0; i < sample_count; ++i)
+                    m_intersector.trace(m_batch_rays[i], m_batch_hits[i]);
+            }
+
+            // Sort the samples by material. The sort is stable so that samples sharing a
+            // material are shaded in the order of the pixels, which preserves texture locality.
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                m_batch_order[i].m_key = get_shading_key(m_batch_hits[i]);
+                m_batch_order[i].m_index = i;
+            }
+            m_batch_sizes.insert(sample_count);
+            m_unsorted_material_runs.insert(count_material_runs(m_batch_order));
+            stable_sort(m_batch_order.begin(), m_batch_order.end());
+            m_sorted_material_runs.insert(count_material_runs(m_batch_order));
+
+            // Shade the samples.
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                const size_t index = m_batch_order[i].m_index;
+
+                render_primary_ray(
+                    sampling_contexts[index],
+                    PixelContext(pixel_coords[index], image_points[index]),
+                    m_batch_rays[index],
+                    &m_batch_hits[index],
+                    shading_results[index]);
+            }
+        }
+
+        // Trace and shade a primary ray. If 'first_hit' is not null, it must hold the
+        // result of tracing 'primary_ray' and the first trace is skipped.
+        void render_primary_ray(
+            SamplingContext&        sampling_context,
+            const PixelContext&     pixel_context,
+            ShadingRay&             primary_ray,
+            const ShadingPoint*     first_hit,
+            ShadingResult&          shading_result)
+        {
+#ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCES
+
+            const uint64 last_texture_cache_hit_count = m_texture_cache.get_hit_count();
+            const uint64 last_texture_cache_miss_count = m_texture_cache.get_miss_count();
+
+#endif
+
             ShadingPoint shading_points[2];
             size_t shading_point_index = 0;
             const ShadingPoint* shading_point_ptr = 0;
@@ -190,16 +462,24 @@ namespace
 
                 m_arena.clear();
 
-                // Trace the ray.
-                shading_points[shading_point_index].clear();
-                m_intersector.trace(
-                    primary_ray,
-                    shading_points[shading_point_index],
-                    shading_point_ptr);
-
-                // Update the pointers to the shading points.
-                shading_point_ptr = &shading_points[shading_point_index];
-                shading_point_index = 1 - shading_point_index;
+                if (iterations == 1 && first_hit)
+                {
+                    // The ray was already traced.
+                    shading_point_ptr = first_hit;
+                }
+                else
+                {
+                    // Trace the ray.
+                    shading_points[shading_point_index].clear();
+                    m_intersector.trace(
+                        primary_ray,
+                        shading_points[shading_point_index],
+                        shading_point_ptr);
+
+                    // Update the pointers to the shading points.
+                    shading_point_ptr = &shading_points[shading_point_index];
+                    shading_point_index = 1 - shading_point_index;
+                }
 
                 m_aov_accumulators.reset();
 
@@ -295,51 +575,6 @@ namespace
 
 #endif
         }
-
-        virtual StatisticsVector get_statistics() const APPLESEED_OVERRIDE
-        {
-            StatisticsVector stats;
-            stats.merge(m_texture_cache.get_statistics());
-            stats.merge(m_intersector.get_statistics());
-            stats.merge(m_lighting_engine->get_statistics());
-            return stats;
-        }
-
-      private:
-        struct Parameters
-        {
-            const float     m_transparency_threshold;
-            const size_t    m_max_iterations;
-            const bool      m_report_self_intersections;
-
-            explicit Parameters(const ParamArray& params)
-              : m_transparency_threshold(params.get_optional<float>("transparency_threshold", 0.001f))
-              , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
-              , m_report_self_intersections(params.get_optional<bool>("report_self_intersections", false))
-            {
-            }
-        };
-
-        const Parameters            m_params;
-        const Scene&                m_scene;
-        const LightingConditions&   m_lighting_conditions;
-        const float                 m_opacity_threshold;
-        TextureCache                m_texture_cache;
-        ILightingEngine*            m_lighting_engine;
-        ShadingEngine&              m_shading_engine;
-        OIIO::TextureSystem&        m_oiio_texture_system;
-        const size_t                m_thread_index;
-
-        Arena                       m_arena;
-        OSLShaderGroupExec          m_shadergroup_exec;
-        const Intersector           m_intersector;
-        Tracer                      m_tracer;
-        const ShadingContext        m_shading_context;
-
-        Vector2d                    m_image_point_dx;
-        Vector2d                    m_image_point_dy;
-
-        AOVAccumulatorContainer     m_aov_accumulators;
     };
 }
 
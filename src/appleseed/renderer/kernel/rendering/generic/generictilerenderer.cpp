@@ -211,6 +211,9 @@ namespace
                     *framebuffer);
             }
 
+            // Render the pixels that the pixel renderer may have deferred.
+            m_pixel_renderer->flush_pixels(frame, *framebuffer);
+
             // Develop the framebuffer to the tile.
             if (frame.is_premultiplied_alpha())
                 framebuffer->develop_to_tile_premult_alpha(tile, aov_tiles);
@@ -37,13 +37,18 @@
 // appleseed.foundation headers.
 #include "foundation/image/canvasproperties.h"
 #include "foundation/image/color.h"
+#include "foundation/image/filteredtile.h"
 #include "foundation/image/image.h"
 #include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
+#include "foundation/math/fastmath.h"
+#include "foundation/math/scalar.h"
 #include "foundation/utility/job/iabortswitch.h"
 
-// Boost headers.
-#include "boost/chrono/duration.hpp"
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -51,23 +56,55 @@ using namespace std;
 namespace renderer
 {
 
+namespace
+{
+    // Height in pixels of the bands of the buffer.
+    const size_t BandHeight = 16;
+}
+
 GlobalSampleAccumulationBuffer::GlobalSampleAccumulationBuffer(
     const size_t    width,
     const size_t    height,
     const Filter2f& filter)
-  : m_fb(width, height, 3, filter)
+  : m_width(width)
+  , m_height(height)
+  , m_filter(filter)
   , m_filter_rcp_norm_factor(1.0f / compute_normalization_factor(filter))
 {
+    m_sample_count = 0;
+
+    for (size_t y = 0; y < height; y += BandHeight)
+    {
+        Band* band = new Band();
+        band->m_fb = new FilteredTile(width, min(BandHeight, height - y), 3, filter);
+        band->m_fb->clear();
+        band->m_origin_y = y;
+        band->m_dirty = true;
+        band->m_developed_sample_count = 0;
+        m_bands.push_back(band);
+    }
 }
 
-void GlobalSampleAccumulationBuffer::clear()
+GlobalSampleAccumulationBuffer::~GlobalSampleAccumulationBuffer()
 {
-    // Request exclusive access.
-    boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_bands.size(); ++i)
+    {
+        delete m_bands[i]->m_fb;
+        delete m_bands[i];
+    }
+}
 
+void GlobalSampleAccumulationBuffer::clear()
+{
     m_sample_count = 0;
 
-    m_fb.clear();
+    for (size_t i = 0; i < m_bands.size(); ++i)
+    {
+        Band& band = *m_bands[i];
+        Spinlock::ScopedLock lock(band.m_lock);
+        band.m_fb->clear();
+        band.m_dirty = true;
+    }
 }
 
 void GlobalSampleAccumulationBuffer::store_samples(
@@ -75,18 +112,10 @@ void GlobalSampleAccumulationBuffer::store_samples(
     const Sample    samples[],
     IAbortSwitch&   abort_switch)
 {
-    // Request non-exclusive access.
-    boost::shared_lock<boost::shared_mutex> lock(m_mutex, boost::defer_lock);
-    while (true)
-    {
-        if (abort_switch.is_aborted())
-            return;
-        if (lock.try_lock_for(boost::chrono::milliseconds(5)))
-            break;
-    }
-
-    const float fw = static_cast<float>(m_fb.get_width());
-    const float fh = static_cast<float>(m_fb.get_height());
+    const float fw = static_cast<float>(m_width);
+    const float fh = static_cast<float>(m_height);
+    const float yradius = m_filter.get_yradius();
+    const int max_y = static_cast<int>(m_height) - 1;
     size_t counter = 0;
 
     const Sample* sample_end = samples + sample_count;
@@ -98,49 +127,83 @@ void GlobalSampleAccumulationBuffer::store_samples(
         const float fx = s->m_position.x * fw;
         const float fy = s->m_position.y * fh;
 
+        // Find the rows of pixels affected by this sample.
+        const float dy = fy - 0.5f;
+        const int footprint_min_y = max(truncate<int>(fast_ceil(dy - yradius)), 0);
+        const int footprint_max_y = min(truncate<int>(fast_floor(dy + yradius)), max_y);
+        if (footprint_min_y > footprint_max_y)
+            continue;
+
         Color3f value(s->m_color.rgb());
         value *= m_filter_rcp_norm_factor;
 
-        m_fb.add(fx, fy, &value[0]);
+        // Splat the sample into each band it overlaps, one band at a time.
+        const size_t first_band = static_cast<size_t>(footprint_min_y) / BandHeight;
+        const size_t last_band = static_cast<size_t>(footprint_max_y) / BandHeight;
+
+        for (size_t i = first_band; i <= last_band; ++i)
+        {
+            Band& band = *m_bands[i];
+            Spinlock::ScopedLock lock(band.m_lock);
+            band.m_fb->add(fx, fy - band.m_origin_y, &value[0]);
+            band.m_dirty = true;
+        }
     }
 }
 
 void GlobalSampleAccumulationBuffer::develop_to_frame(
     Frame&          frame,
-    IAbortSwitch&   abort_switch)
+    IAbortSwitch&   abort_switch,
+    vector<size_t>* developed_tiles)
 {
-    // Request exclusive access.
-    boost::unique_lock<boost::shared_mutex> lock(m_mutex, boost::defer_lock);
-    while (true)
-    {
-        if (abort_switch.is_aborted())
-            return;
-        if (lock.try_lock_for(boost::chrono::milliseconds(5)))
-            break;
-    }
+    // Only one thread may develop the buffer at a time; storing samples may proceed.
+    boost::mutex::scoped_lock develop_lock(m_develop_mutex);
 
     Image& image = frame.image();
     const CanvasProperties& frame_props = image.properties();
 
-    assert(frame_props.m_canvas_width == m_fb.get_width());
-    assert(frame_props.m_canvas_height == m_fb.get_height());
+    assert(frame_props.m_canvas_width == m_width);
+    assert(frame_props.m_canvas_height == m_height);
     assert(frame_props.m_channel_count == 4);
 
-    const float scale = 1.0f / m_sample_count;
+    const uint64 sample_count = m_sample_count;
+    const float scale = 1.0f / sample_count;
+
+    // Rows of tiles overlapped by the developed bands.
+    vector<bool> developed_rows(frame_props.m_tile_count_y, false);
 
-    for (size_t ty = 0; ty < frame_props.m_tile_count_y; ++ty)
+    for (size_t i = 0; i < m_bands.size(); ++i)
     {
-        for (size_t tx = 0; tx < frame_props.m_tile_count_x; ++tx)
-        {
-            if (abort_switch.is_aborted())
-                return;
+        if (abort_switch.is_aborted())
+            return;
 
-            Tile& tile = image.tile(tx, ty);
+        Band& band = *m_bands[i];
+        Spinlock::ScopedLock lock(band.m_lock);
+
+        // Skip bands whose pixels would not change.
+        if (!band.m_dirty && band.m_developed_sample_count == sample_count)
+            continue;
+
+        develop_band(image, band, scale);
 
-            const size_t x = tx * frame_props.m_tile_width;
-            const size_t y = ty * frame_props.m_tile_height;
+        band.m_dirty = false;
+        band.m_developed_sample_count = sample_count;
 
-            develop_to_tile(tile, x, y, tx, ty, scale);
+        const size_t first_tile_y = band.m_origin_y / frame_props.m_tile_height;
+        const size_t last_tile_y = (band.m_origin_y + band.m_fb->get_height() - 1) / frame_props.m_tile_height;
+        for (size_t ty = first_tile_y; ty <= last_tile_y; ++ty)
+            developed_rows[ty] = true;
+    }
+
+    if (developed_tiles)
+    {
+        for (size_t ty = 0; ty < frame_props.m_tile_count_y; ++ty)
+        {
+            if (developed_rows[ty])
+            {
+                for (size_t tx = 0; tx < frame_props.m_tile_count_x; ++tx)
+                    developed_tiles->push_back(ty * frame_props.m_tile_count_x + tx);
+            }
         }
     }
 }
@@ -150,27 +213,45 @@ void GlobalSampleAccumulationBuffer::increment_sample_count(const uint64 delta_s
     m_sample_count += delta_sample_count;
 }
 
-void GlobalSampleAccumulationBuffer::develop_to_tile(
-    Tile&           tile,
-    const size_t    origin_x,
-    const size_t    origin_y,
-    const size_t    tile_x,
-    const size_t    tile_y,
-    const float     scale) const
+void GlobalSampleAccumulationBuffer::develop_band(
+    Image&          image,
+    const Band&     band,
+    const float     scale)
 {
-    const size_t tile_width = tile.get_width();
-    const size_t tile_height = tile.get_height();
+    const CanvasProperties& frame_props = image.properties();
+    const FilteredTile& fb = *band.m_fb;
+
+    const size_t band_begin_y = band.m_origin_y;
+    const size_t band_end_y = band.m_origin_y + fb.get_height();
 
-    for (size_t y = 0; y < tile_height; ++y)
+    // Visit the tiles of the frame overlapped by the band.
+    const size_t first_tile_y = band_begin_y / frame_props.m_tile_height;
+    const size_t last_tile_y = (band_end_y - 1) / frame_props.m_tile_height;
+
+    for (size_t ty = first_tile_y; ty <= last_tile_y; ++ty)
     {
-        for (size_t x = 0; x < tile_width; ++x)
+        const size_t tile_origin_y = ty * frame_props.m_tile_height;
+
+        for (size_t tx = 0; tx < frame_props.m_tile_count_x; ++tx)
         {
-            const float* ptr = m_fb.pixel(origin_x + x, origin_y + y);
+            Tile& tile = image.tile(tx, ty);
+
+            const size_t tile_origin_x = tx * frame_props.m_tile_width;
+            const size_t begin_y = max(band_begin_y, tile_origin_y);
+            const size_t end_y = min(band_end_y, tile_origin_y + tile.get_height());
+
+            for (size_t y = begin_y; y < end_y; ++y)
+            {
+                for (size_t x = 0; x < tile.get_width(); ++x)
+                {
+                    const float* ptr = fb.pixel(tile_origin_x + x, y - band_begin_y);
 
-            Color4f color(ptr[1], ptr[2], ptr[3], 1.0f);
-            color.rgb() *= scale;
+                    Color4f color(ptr[1], ptr[2], ptr[3], 1.0f);
+                    color.rgb() *= scale;
 
-            tile.set_pixel(x, y, color);
+                    tile.set_pixel(x, y - tile_origin_y, color);
+                }
+            }
         }
     }
 }
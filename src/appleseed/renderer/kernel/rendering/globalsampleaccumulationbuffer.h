@@ -34,7 +34,6 @@
 #include "renderer/kernel/rendering/sampleaccumulationbuffer.h"
 
 // appleseed.foundation headers.
-#include "foundation/image/filteredtile.h"
 #include "foundation/math/filter.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/thread.h"
@@ -42,9 +41,12 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
+namespace foundation    { class FilteredTile; }
 namespace foundation    { class IAbortSwitch; }
+namespace foundation    { class Image; }
 namespace foundation    { class Tile; }
 namespace renderer      { class Frame; }
 namespace renderer      { class Sample; }
@@ -52,6 +54,15 @@ namespace renderer      { class Sample; }
 namespace renderer
 {
 
+//
+// A sample accumulation buffer for samples that may land anywhere in the frame.
+//
+// The buffer is split into horizontal bands of pixels, each with its own lock,
+// so that threads storing samples only contend when they hit the same band.
+// Only the bands that received samples, or whose normalization changed, are
+// developed to the frame.
+//
+
 class GlobalSampleAccumulationBuffer
   : public SampleAccumulationBuffer
 {
@@ -62,6 +73,9 @@ class GlobalSampleAccumulationBuffer
         const size_t                height,
         const foundation::Filter2f& filter);
 
+    // Destructor.
+    ~GlobalSampleAccumulationBuffer();
+
     // Reset the buffer to its initial state. Thread-safe.
     virtual void clear() APPLESEED_OVERRIDE;
 
@@ -74,23 +88,33 @@ class GlobalSampleAccumulationBuffer
     // Develop the buffer to a frame. Thread-safe.
     virtual void develop_to_frame(
         Frame&                      frame,
-        foundation::IAbortSwitch&   abort_switch) APPLESEED_OVERRIDE;
+        foundation::IAbortSwitch&   abort_switch,
+        std::vector<size_t>*        developed_tiles = 0) APPLESEED_OVERRIDE;
 
     // Increment the number of samples used for pixel values renormalization. Thread-safe.
     void increment_sample_count(const foundation::uint64 delta_sample_count);
 
   private:
-    boost::shared_mutex             m_mutex;
-    foundation::FilteredTile        m_fb;
+    struct Band
+    {
+        foundation::Spinlock        m_lock;
+        foundation::FilteredTile*   m_fb;
+        size_t                      m_origin_y;
+        bool                        m_dirty;                    // received samples since last development
+        foundation::uint64          m_developed_sample_count;   // sample count used by last development
+    };
+
+    const size_t                    m_width;
+    const size_t                    m_height;
+    const foundation::Filter2f&     m_filter;
     const float                     m_filter_rcp_norm_factor;
+    std::vector<Band*>              m_bands;
+    boost::mutex                    m_develop_mutex;
 
-    void develop_to_tile(
-        foundation::Tile&           tile,
-        const size_t                origin_x,
-        const size_t                origin_y,
-        const size_t                tile_x,
-        const size_t                tile_y,
-        const float                 scale) const;
+    static void develop_band(
+        foundation::Image&          image,
+        const Band&                 band,
+        const float                 scale);
 };
 
 }       // namespace renderer
@@ -83,6 +83,12 @@ class IPixelRenderer
         SamplingContext::RNGType&   rng,
         ShadingResultFrameBuffer&   framebuffer) = 0;
 
+    // Render the pixels whose rendering was deferred by render_pixel(). This method is
+    // called once all pixels of a tile were submitted, before the framebuffer is developed.
+    virtual void flush_pixels(
+        const Frame&                frame,
+        ShadingResultFrameBuffer&   framebuffer) = 0;
+
     // Retrieve performance statistics.
     virtual foundation::StatisticsVector get_statistics() const = 0;
 };
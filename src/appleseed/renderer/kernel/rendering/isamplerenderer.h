@@ -64,6 +64,17 @@ class ISampleRenderer
         const foundation::Vector2d&     image_point,
         ShadingResult&                  shading_result) = 0;
 
+    // Render a batch of samples. 'pixel_coords' holds the coordinates of the pixel
+    // each sample belongs to; all arrays have 'sample_count' elements. Sample renderers
+    // may take advantage of the coherence of the batch, for instance by tracing the
+    // primary rays together.
+    virtual void render_samples(
+        SamplingContext                 sampling_contexts[],
+        const foundation::Vector2i      pixel_coords[],
+        const foundation::Vector2d      image_points[],
+        ShadingResult                   shading_results[],
+        const size_t                    sample_count) = 0;
+
     // Retrieve performance statistics.
     virtual foundation::StatisticsVector get_statistics() const = 0;
 };
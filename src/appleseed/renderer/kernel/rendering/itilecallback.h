@@ -76,6 +76,14 @@ class APPLESEED_DLLSYMBOL ITileCallback
     // Only whole-frame (progressive) renderers call this method.
     virtual void post_render(
         const Frame*    frame) = 0;
+
+    // This method is called after some tiles of a whole frame are updated. Tiles are
+    // identified by their index tile_y * tile_count_x + tile_x; other tiles are unchanged.
+    // Only whole-frame (progressive) renderers call this method.
+    virtual void post_render_tiles(
+        const Frame*    frame,
+        const size_t    tile_count,
+        const size_t    tile_indices[]) = 0;
 };
 
 
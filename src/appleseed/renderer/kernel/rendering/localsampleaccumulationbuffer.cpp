@@ -43,8 +43,13 @@
 #include "foundation/image/image.h"
 #include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
+#include "foundation/math/fastmath.h"
 #include "foundation/math/scalar.h"
 #include "foundation/platform/atomic.h"
+#include "foundation/platform/compiler.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
 #include "foundation/platform/timers.h"
 #include "foundation/utility/job/iabortswitch.h"
 #include "foundation/utility/stopwatch.h"
@@ -52,6 +57,7 @@
 // Standard headers.
 #include <algorithm>
 #include <cassert>
+#include <vector>
 
 using namespace boost;
 using namespace foundation;
@@ -77,13 +83,111 @@ namespace renderer
 //   pushing samples to and the level that is displayed. As soon as a level contains enough
 //   samples, it becomes the new active level.
 //
+//   The frame is covered by a grid of cells, each with a dirty flag. When a sample is stored,
+//   the cells covered by its footprint in the active level are flagged (or in the new active
+//   level, if it changed while the sample was being stored). Developing the buffer
+//   only updates the tiles of the frame that overlap dirty cells, or all of them if the active
+//   level changed since the last development.
+//
+//   Developing the buffer only requires non-exclusive access, so that rendering threads keep
+//   storing samples in the meantime. A pixel caught in the middle of an update may be slightly
+//   off; its cell is flagged again once the update completes and the pixel is fixed at the
+//   next development.
+//
 
 //#define PRINT_DETAILED_PERF_REPORTS
 
+namespace
+{
+    // Size in pixels of the dirty tracking cells.
+    const size_t CellSize = 32;
+
+    // Number of pixels developed at once by develop_row().
+    const size_t RowChunkSize = 64;
+
+    // Normalize a run of pixels of a level and write them to a tile.
+    template <bool UndoPremultAlpha>
+    void develop_row(
+        Tile&               color_tile,
+        const size_t        dest_index,
+        const FilteredTile& level,
+        const size_t        src_index,
+        const size_t        count)
+    {
+        assert(level.get_channel_count() == 5);
+
+        APPLESEED_SIMD4_ALIGN float values[RowChunkSize * 4];
+
+        for (size_t begin = 0; begin < count; begin += RowChunkSize)
+        {
+            const size_t n = min(count - begin, RowChunkSize);
+            const float* APPLESEED_RESTRICT src = level.pixel(src_index + begin);
+
+#ifdef APPLESEED_USE_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+
+            for (size_t i = 0; i < n; ++i, src += 5)
+            {
+                // Divide by the weight of the pixel, if any.
+                const __m128 weight = _mm_set1_ps(src[0]);
+                const __m128 rcp_weight = _mm_and_ps(_mm_div_ps(one, weight), _mm_cmpneq_ps(weight, zero));
+                __m128 color = _mm_mul_ps(_mm_loadu_ps(src + 1), rcp_weight);
+
+                if (UndoPremultAlpha)
+                {
+                    // Divide RGB by alpha, if any, and leave alpha unchanged.
+                    const __m128 alpha = _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+                    const __m128 rcp_alpha = _mm_and_ps(_mm_div_ps(one, alpha), _mm_cmpneq_ps(alpha, zero));
+                    const __m128 scale = _mm_shuffle_ps(rcp_alpha, _mm_unpackhi_ps(rcp_alpha, one), _MM_SHUFFLE(3, 2, 1, 0));
+                    color = _mm_mul_ps(color, scale);
+                }
+
+                _mm_store_ps(values + i * 4, color);
+            }
+#else
+            for (size_t i = 0; i < n; ++i, src += 5)
+            {
+                const float weight = src[0];
+                const float rcp_weight = weight == 0.0f ? 0.0f : 1.0f / weight;
+                float* APPLESEED_RESTRICT dest = values + i * 4;
+                dest[0] = src[1] * rcp_weight;
+                dest[1] = src[2] * rcp_weight;
+                dest[2] = src[3] * rcp_weight;
+                dest[3] = src[4] * rcp_weight;
+
+                if (UndoPremultAlpha)
+                {
+                    const float rcp_alpha = dest[3] == 0.0f ? 0.0f : 1.0f / dest[3];
+                    dest[0] *= rcp_alpha;
+                    dest[1] *= rcp_alpha;
+                    dest[2] *= rcp_alpha;
+                }
+            }
+#endif
+
+            // Convert the whole run to the pixel format of the tile at once.
+            Pixel::convert_to_format(
+                values,                                     // source begin
+                values + n * 4,                             // source end
+                1,                                          // source stride
+                color_tile.get_pixel_format(),              // destination format
+                color_tile.pixel(dest_index + begin),       // destination
+                1);                                         // destination stride
+        }
+    }
+}
+
 LocalSampleAccumulationBuffer::LocalSampleAccumulationBuffer(
     const size_t        width,
     const size_t        height,
     const Filter2f&     filter)
+  : m_width(width)
+  , m_height(height)
+  , m_filter_xradius(filter.get_xradius())
+  , m_filter_yradius(filter.get_yradius())
+  , m_cell_count_x((width + CellSize - 1) / CellSize)
+  , m_cell_count_y((height + CellSize - 1) / CellSize)
 {
     const size_t MinSize = 32;
 
@@ -103,11 +207,15 @@ LocalSampleAccumulationBuffer::LocalSampleAccumulationBuffer(
 
     m_remaining_pixels = new boost::atomic<int32>[m_levels.size()];
 
+    m_dirty_cells = new boost::atomic<bool>[m_cell_count_x * m_cell_count_y];
+    m_developed_level = static_cast<uint32>(m_levels.size());
+
     clear();
 }
 
 LocalSampleAccumulationBuffer::~LocalSampleAccumulationBuffer()
 {
+    delete[] m_dirty_cells;
     delete[] m_remaining_pixels;
 
     for (size_t i = 0, e = m_levels.size(); i < e; ++i)
@@ -140,6 +248,9 @@ void LocalSampleAccumulationBuffer::clear()
     }
 
     m_active_level = static_cast<uint32>(m_levels.size() - 1);
+
+    for (size_t i = 0, e = m_cell_count_x * m_cell_count_y; i < e; ++i)
+        m_dirty_cells[i] = true;
 }
 
 void LocalSampleAccumulationBuffer::store_samples(
@@ -167,8 +278,9 @@ void LocalSampleAccumulationBuffer::store_samples(
 #endif
 
         // Store samples at every level, starting with the highest resolution level up to the active level.
+        const uint32 stored_level = m_active_level;
         size_t counter = 0;
-        for (uint32 i = 0, e = m_active_level; i <= e; ++i)
+        for (uint32 i = 0; i <= stored_level; ++i)
         {
             FilteredTile* level = m_levels[i];
             const float level_width = static_cast<float>(level->get_width());
@@ -186,6 +298,29 @@ void LocalSampleAccumulationBuffer::store_samples(
                 const float fx = s->m_position.x * level_width;
                 const float fy = s->m_position.y * level_height;
                 level->add(fx, fy, &s->m_color[0]);
+
+                // Only the active level is displayed.
+                if (i == stored_level)
+                    mark_dirty_cells(*level, fx, fy);
+            }
+        }
+
+        // Another thread may have made a finer level active in the meantime, and the frame may
+        // already have been developed from it before our samples were stored there.
+        const uint32 active_level = m_active_level;
+        if (active_level < stored_level)
+        {
+            const FilteredTile& level = *m_levels[active_level];
+            const float level_width = static_cast<float>(level.get_width());
+            const float level_height = static_cast<float>(level.get_height());
+
+            const Sample* sample_end = samples + sample_count;
+            for (const Sample* s = samples; s < sample_end; ++s)
+            {
+                mark_dirty_cells(
+                    level,
+                    s->m_position.x * level_width,
+                    s->m_position.y * level_height);
             }
         }
 
@@ -227,15 +362,19 @@ void LocalSampleAccumulationBuffer::store_samples(
 
 void LocalSampleAccumulationBuffer::develop_to_frame(
     Frame&              frame,
-    IAbortSwitch&       abort_switch)
+    IAbortSwitch&       abort_switch,
+    vector<size_t>*     developed_tiles)
 {
 #ifdef PRINT_DETAILED_PERF_REPORTS
     Stopwatch<DefaultWallclockTimer> sw(0);
     sw.start();
 #endif
 
-    // Request exclusive access.
-    while (!m_lock.try_lock_write())
+    // Only one thread may develop the buffer at a time.
+    boost::mutex::scoped_lock develop_lock(m_develop_mutex);
+
+    // Request non-exclusive access.
+    while (!m_lock.try_lock_read())
     {
         foundation::sleep(5);
         if (abort_switch.is_aborted())
@@ -258,7 +397,16 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
     const AABB2u& crop_window = frame.get_crop_window();
     const bool undo_premultiplied_alpha = !frame.is_premultiplied_alpha();
 
-    const FilteredTile& level = *m_levels[m_active_level];
+    // Fetch and reset the dirty flags. Everything must be developed if the active level changed.
+    const uint32 active_level = m_active_level;
+    const bool develop_all = active_level != m_developed_level;
+    const size_t cell_count = m_cell_count_x * m_cell_count_y;
+    m_developed_cells.resize(cell_count);
+    for (size_t i = 0; i < cell_count; ++i)
+        m_developed_cells[i] = m_dirty_cells[i].exchange(false) || develop_all ? 1 : 0;
+    m_developed_level = active_level;
+
+    const FilteredTile& level = *m_levels[active_level];
 
     for (size_t ty = 0; ty < frame_props.m_tile_count_y; ++ty)
     {
@@ -266,7 +414,9 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
         {
             if (abort_switch.is_aborted())
             {
-                m_lock.unlock_write();
+                // Force a complete development next time.
+                m_developed_level = static_cast<uint32>(m_levels.size());
+                m_lock.unlock_read();
                 return;
             }
 
@@ -279,6 +429,10 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
                 Vector2u(origin_x, origin_y),
                 Vector2u(origin_x + color_tile.get_width() - 1, origin_y + color_tile.get_height() - 1));
 
+            // Skip tiles whose pixels did not change.
+            if (!is_dirty(tile_rect))
+                continue;
+
             const AABB2u rect = AABB2u::intersect(tile_rect, crop_window);
 
             if (undo_premultiplied_alpha)
@@ -303,10 +457,13 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
                     origin_y,
                     rect);
             }
+
+            if (developed_tiles)
+                developed_tiles->push_back(ty * frame_props.m_tile_count_x + tx);
         }
     }
 
-    m_lock.unlock_write();
+    m_lock.unlock_read();
 
 #ifdef PRINT_DETAILED_PERF_REPORTS
     sw.measure();
@@ -315,6 +472,56 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
 #endif
 }
 
+void LocalSampleAccumulationBuffer::mark_dirty_cells(
+    const FilteredTile& level,
+    const float         fx,
+    const float         fy)
+{
+    // Conservative bounds of the frame pixels affected by a sample stored at (fx, fy) in a level.
+    const float sx = static_cast<float>(m_width) / level.get_width();
+    const float sy = static_cast<float>(m_height) / level.get_height();
+    const int min_x = max(truncate<int>(fast_floor((fx - 0.5f - m_filter_xradius) * sx)), 0);
+    const int min_y = max(truncate<int>(fast_floor((fy - 0.5f - m_filter_yradius) * sy)), 0);
+    const int max_x = min(truncate<int>(fast_ceil((fx + 0.5f + m_filter_xradius) * sx)), static_cast<int>(m_width) - 1);
+    const int max_y = min(truncate<int>(fast_ceil((fy + 0.5f + m_filter_yradius) * sy)), static_cast<int>(m_height) - 1);
+
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    const size_t min_cx = static_cast<size_t>(min_x) / CellSize;
+    const size_t min_cy = static_cast<size_t>(min_y) / CellSize;
+    const size_t max_cx = static_cast<size_t>(max_x) / CellSize;
+    const size_t max_cy = static_cast<size_t>(max_y) / CellSize;
+
+    for (size_t cy = min_cy; cy <= max_cy; ++cy)
+    {
+        for (size_t cx = min_cx; cx <= max_cx; ++cx)
+        {
+            // Avoid writing to the shared cache line if the cell is already dirty.
+            boost::atomic<bool>& cell = m_dirty_cells[cy * m_cell_count_x + cx];
+            if (!cell.load(boost::memory_order_relaxed))
+                cell.store(true);
+        }
+    }
+}
+
+bool LocalSampleAccumulationBuffer::is_dirty(const AABB2u& rect) const
+{
+    const size_t max_cx = min(rect.max.x / CellSize, m_cell_count_x - 1);
+    const size_t max_cy = min(rect.max.y / CellSize, m_cell_count_y - 1);
+
+    for (size_t cy = rect.min.y / CellSize; cy <= max_cy; ++cy)
+    {
+        for (size_t cx = rect.min.x / CellSize; cx <= max_cx; ++cx)
+        {
+            if (m_developed_cells[cy * m_cell_count_x + cx])
+                return true;
+        }
+    }
+
+    return false;
+}
+
 void LocalSampleAccumulationBuffer::develop_to_tile_undo_premult_alpha(
     Tile&               color_tile,
     const size_t        image_width,
@@ -328,6 +535,23 @@ void LocalSampleAccumulationBuffer::develop_to_tile_undo_premult_alpha(
         return;
 
     const size_t level_width = level.get_width();
+
+    if (level_width == image_width && level.get_height() == image_height)
+    {
+        // Full resolution level: develop whole rows at once.
+        const size_t count = rect.max.x - rect.min.x + 1;
+        for (size_t iy = rect.min.y; iy <= rect.max.y; ++iy)
+        {
+            develop_row<true>(
+                color_tile,
+                (iy - origin_y) * color_tile.get_width() + rect.min.x - origin_x,
+                level,
+                iy * level_width + rect.min.x,
+                count);
+        }
+        return;
+    }
+
     const size_t m = image_width / level_width;
 
     if (image_width % level_width == 0 && is_pow2(m))
@@ -413,6 +637,23 @@ void LocalSampleAccumulationBuffer::develop_to_tile(
         return;
 
     const size_t level_width = level.get_width();
+
+    if (level_width == image_width && level.get_height() == image_height)
+    {
+        // Full resolution level: develop whole rows at once.
+        const size_t count = rect.max.x - rect.min.x + 1;
+        for (size_t iy = rect.min.y; iy <= rect.max.y; ++iy)
+        {
+            develop_row<false>(
+                color_tile,
+                (iy - origin_y) * color_tile.get_width() + rect.min.x - origin_x,
+                level,
+                iy * level_width + rect.min.x,
+                count);
+        }
+        return;
+    }
+
     const size_t m = image_width / level_width;
 
     if (image_width % level_width == 0 && is_pow2(m))
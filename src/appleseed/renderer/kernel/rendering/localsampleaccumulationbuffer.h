@@ -80,7 +80,8 @@ class LocalSampleAccumulationBuffer
     // Develop the buffer to a frame. Thread-safe.
     virtual void develop_to_frame(
         Frame&                              frame,
-        foundation::IAbortSwitch&           abort_switch) APPLESEED_OVERRIDE;
+        foundation::IAbortSwitch&           abort_switch,
+        std::vector<size_t>*                developed_tiles = 0) APPLESEED_OVERRIDE;
 
     // Exposed for tests and benchmarks.
     static void develop_to_tile_undo_premult_alpha(
@@ -109,6 +110,27 @@ class LocalSampleAccumulationBuffer
     std::vector<foundation::FilteredTile*>  m_levels;
     boost::atomic<foundation::int32>*       m_remaining_pixels;
     boost::atomic<foundation::uint32>       m_active_level;
+
+    // Dirty tracking, in cells of the full resolution frame.
+    const size_t                            m_width;
+    const size_t                            m_height;
+    const float                             m_filter_xradius;
+    const float                             m_filter_yradius;
+    const size_t                            m_cell_count_x;
+    const size_t                            m_cell_count_y;
+    boost::atomic<bool>*                    m_dirty_cells;
+
+    // Development state, protected by m_develop_mutex.
+    boost::mutex                            m_develop_mutex;
+    foundation::uint32                      m_developed_level;
+    std::vector<foundation::uint8>          m_developed_cells;
+
+    void mark_dirty_cells(
+        const foundation::FilteredTile&     level,
+        const float                         fx,
+        const float                         fy);
+
+    bool is_dirty(const foundation::AABB2u& rect) const;
 };
 
 }       // namespace renderer
@@ -45,6 +45,7 @@
 #include "renderer/modeling/scene/scene.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/thread.h"
 #include "foundation/utility/job/iabortswitch.h"
@@ -77,6 +78,7 @@ MasterRenderer::MasterRenderer(
   , m_serial_renderer_controller(0)
   , m_serial_tile_callback_factory(0)
   , m_display(0)
+  , m_texture_store(0)
 {
     if (m_tile_callback_factory == 0)
     {
@@ -100,6 +102,7 @@ MasterRenderer::MasterRenderer(
   , m_serial_tile_callback_factory(
         new SerialTileCallbackFactory(m_serial_renderer_controller))
   , m_display(0)
+  , m_texture_store(0)
 {
     m_renderer_controller = m_serial_renderer_controller;
     m_tile_callback_factory = m_serial_tile_callback_factory;
@@ -110,6 +113,7 @@ MasterRenderer::~MasterRenderer()
     if (m_display)
         m_display->close();
 
+    delete m_texture_store;
     delete m_serial_tile_callback_factory;
     delete m_serial_renderer_controller;
 }
@@ -210,6 +214,25 @@ namespace
       private:
         IRendererController& m_renderer_controller;
     };
+
+    // Unloads the tiles of a texture store that cannot be kept past the end of a render.
+    class TextureStoreRenderScope
+      : public NonCopyable
+    {
+      public:
+        explicit TextureStoreRenderScope(TextureStore& texture_store)
+          : m_texture_store(texture_store)
+        {
+        }
+
+        ~TextureStoreRenderScope()
+        {
+            m_texture_store.on_render_end();
+        }
+
+      private:
+        TextureStore& m_texture_store;
+    };
 }
 
 IRendererController::Status MasterRenderer::initialize_and_render_frame_sequence()
@@ -228,10 +251,9 @@ IRendererController::Status MasterRenderer::initialize_and_render_frame_sequence
     m_project.update_trace_context();
     m_project.get_frame()->print_settings();
 
-    // Create the texture store.
-    TextureStore texture_store(
-        *m_project.get_scene(),
-        m_params.child("texture_store"));
+    // Create or update the texture store.
+    TextureStore& texture_store = prepare_texture_store();
+    TextureStoreRenderScope texture_store_render_scope(texture_store);
 
     if (!initialize_shading_system(texture_store, abort_switch))
         return IRendererController::AbortRendering;
@@ -386,4 +408,29 @@ bool MasterRenderer::bind_scene_entities_inputs() const
     return input_binder.get_error_count() == 0;
 }
 
+TextureStore& MasterRenderer::prepare_texture_store()
+{
+    const ParamArray& params = m_params.child("texture_store");
+
+    // The texture store cannot be resized or resharded, create a new one if its settings changed.
+    if (m_texture_store && m_texture_store_params != params)
+    {
+        delete m_texture_store;
+        m_texture_store = 0;
+    }
+
+    if (m_texture_store == 0)
+    {
+        m_texture_store = new TextureStore(*m_project.get_scene(), params);
+        m_texture_store_params = params;
+    }
+    else
+    {
+        // Unload the tiles of textures that were modified or removed since the last render.
+        m_texture_store->on_render_begin(*m_project.get_scene());
+    }
+
+    return *m_texture_store;
+}
+
 }   // namespace renderer
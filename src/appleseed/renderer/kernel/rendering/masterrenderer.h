@@ -47,6 +47,7 @@ namespace renderer      { class ITileCallbackFactory; }
 namespace renderer      { class Project; }
 namespace renderer      { class RendererComponents; }
 namespace renderer      { class SerialRendererController; }
+namespace renderer      { class TextureStore; }
 
 namespace renderer
 {
@@ -89,6 +90,10 @@ class APPLESEED_DLLSYMBOL MasterRenderer
 
     Display*                        m_display;
 
+    // Texture store kept across renders so that they start with a warm cache.
+    TextureStore*                   m_texture_store;
+    ParamArray                      m_texture_store_params;
+
     // Render frame sequences, each time reinitializing the rendering components.
     bool do_render();
 
@@ -105,6 +110,9 @@ class APPLESEED_DLLSYMBOL MasterRenderer
 
     // Bind all scene entities inputs. Return true on success, false otherwise.
     bool bind_scene_entities_inputs() const;
+
+    // Create the texture store, or update it if it can be reused for this render.
+    TextureStore& prepare_texture_store();
 };
 
 }       // namespace renderer
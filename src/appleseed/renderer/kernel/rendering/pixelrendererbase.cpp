@@ -64,6 +64,12 @@ void PixelRendererBase::on_tile_end(
 {
 }
 
+void PixelRendererBase::flush_pixels(
+    const Frame&                frame,
+    ShadingResultFrameBuffer&   framebuffer)
+{
+}
+
 void PixelRendererBase::on_pixel_begin()
 {
     m_invalid_sample_count = 0;
@@ -43,6 +43,7 @@
 // Forward declarations.
 namespace foundation    { class Tile; }
 namespace renderer      { class Frame; }
+namespace renderer      { class ShadingResultFrameBuffer; }
 namespace renderer      { class TileStack; }
 
 namespace renderer
@@ -71,6 +72,11 @@ class PixelRendererBase
         foundation::Tile&           tile,
         TileStack&                  aov_tiles) APPLESEED_OVERRIDE;
 
+    // Render the pixels whose rendering was deferred by render_pixel().
+    virtual void flush_pixels(
+        const Frame&                frame,
+        ShadingResultFrameBuffer&   framebuffer) APPLESEED_OVERRIDE;
+
   protected:
     void on_pixel_begin();
     void on_pixel_end(const foundation::Vector2i& pi);
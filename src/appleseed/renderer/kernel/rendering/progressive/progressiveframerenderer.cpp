@@ -274,6 +274,7 @@ namespace
                         m_tile_callback.get(),
                         m_params.m_max_sample_count,
                         m_params.m_max_fps,
+                        m_params.m_max_display_overhead,
                         m_display_thread_abort_switch));
                 m_display_thread.reset(
                     new boost::thread(
@@ -344,7 +345,7 @@ namespace
             if (m_display_func.get())
             {
                 // Merge the last samples and display the final frame.
-                m_display_func->develop_and_display();
+                m_display_func->develop_and_display(false);
                 m_display_func.reset();
             }
             else
@@ -367,6 +368,7 @@ namespace
             const size_t    m_thread_count;             // number of rendering threads
             const uint64    m_max_sample_count;         // maximum total number of samples to compute
             const double    m_max_fps;                  // maximum display frequency in frames/second
+            const double    m_max_display_overhead;     // maximum fraction of the time spent developing and displaying the frame
             const bool      m_perf_stats;               // collect and print performance statistics?
             const bool      m_luminance_stats;          // collect and print luminance statistics?
             const string    m_ref_image_path;           // path to the reference image
@@ -375,6 +377,7 @@ namespace
               : m_thread_count(get_rendering_thread_count(params))
               , m_max_sample_count(params.get_optional<uint64>("max_samples", numeric_limits<uint64>::max()))
               , m_max_fps(params.get_optional<double>("max_fps", 30.0))
+              , m_max_display_overhead(params.get_optional<double>("max_display_overhead", 0.2))
               , m_perf_stats(params.get_optional<bool>("performance_statistics", false))
               , m_luminance_stats(params.get_optional<bool>("luminance_statistics", false))
               , m_ref_image_path(params.get_optional<string>("reference_image", ""))
@@ -396,12 +399,14 @@ namespace
                 ITileCallback*              tile_callback,
                 const uint64                max_sample_count,
                 const double                max_fps,
+                const double                max_display_overhead,
                 IAbortSwitch&               abort_switch)
               : m_frame(frame)
               , m_buffer(buffer)
               , m_tile_callback(tile_callback)
               , m_min_sample_count(min<uint64>(max_sample_count, 32 * 32 * 2))
               , m_target_elapsed(1.0 / max_fps)
+              , m_rcp_max_display_overhead(1.0 / clamp(max_display_overhead, 0.01, 1.0))
               , m_abort_switch(abort_switch)
             {
             }
@@ -424,6 +429,9 @@ namespace
                 const double rcp_timer_freq = 1.0 / timer.frequency();
                 uint64 last_time = timer.read();
 
+                // Smoothed time spent developing and displaying the frame.
+                double display_time = 0.0;
+
 #ifdef PRINT_DISPLAY_THREAD_PERFS
                 m_stopwatch.start();
 #endif
@@ -439,8 +447,11 @@ namespace
                                m_buffer.get_sample_count() < m_min_sample_count)
                             yield();
 
-                        // Merge the samples and display the final frame.
-                        develop_and_display();
+                        // Merge the samples and display the tiles that changed.
+                        const uint64 display_begin = timer.read();
+                        develop_and_display(true);
+                        const double t = (timer.read() - display_begin) * rcp_timer_freq;
+                        display_time = display_time == 0.0 ? t : lerp(display_time, t, 0.25);
                     }
 
                     // Compute time elapsed since last call to display().
@@ -448,16 +459,18 @@ namespace
                     const double elapsed = (time - last_time) * rcp_timer_freq;
                     last_time = time;
 
-                    // Limit display rate.
-                    if (elapsed < m_target_elapsed)
+                    // Limit display rate, and lower it further if displaying takes too much of the time.
+                    const double target_elapsed = max(m_target_elapsed, display_time * m_rcp_max_display_overhead);
+                    if (elapsed < target_elapsed)
                     {
-                        const double ms = ceil(1000.0 * (m_target_elapsed - elapsed));
+                        const double ms = ceil(1000.0 * (target_elapsed - elapsed));
                         sleep(truncate<uint32>(ms), m_abort_switch);
                     }
                 }
             }
 
-            void develop_and_display()
+            // Develop the accumulation buffer and present either the tiles that changed or the whole frame.
+            void develop_and_display(const bool changed_tiles_only)
             {
 #ifdef PRINT_DISPLAY_THREAD_PERFS
                 m_stopwatch.measure();
@@ -465,7 +478,8 @@ namespace
 #endif
 
                 // Develop the accumulation buffer to the frame.
-                m_buffer.develop_to_frame(m_frame, m_abort_switch);
+                m_developed_tiles.clear();
+                m_buffer.develop_to_frame(m_frame, m_abort_switch, &m_developed_tiles);
 
 #ifdef PRINT_DISPLAY_THREAD_PERFS
                 m_stopwatch.measure();
@@ -477,7 +491,15 @@ namespace
                     return;
 
                 // Present the frame.
-                m_tile_callback->post_render(&m_frame);
+                if (!changed_tiles_only)
+                    m_tile_callback->post_render(&m_frame);
+                else if (!m_developed_tiles.empty())
+                {
+                    m_tile_callback->post_render_tiles(
+                        &m_frame,
+                        m_developed_tiles.size(),
+                        &m_developed_tiles[0]);
+                }
 
 #ifdef PRINT_DISPLAY_THREAD_PERFS
                 m_stopwatch.measure();
@@ -485,9 +507,11 @@ namespace
 
                 RENDERER_LOG_DEBUG(
                     "display thread:\n"
+                    "  developed tiles               %s\n"
                     "  buffer to frame               %s\n"
                     "  frame to widget               %s\n"
                     "  total                         %s (%s fps)",
+                    pretty_uint(m_developed_tiles.size()).c_str(),
                     pretty_time(t2 - t1).c_str(),
                     pretty_time(t3 - t2).c_str(),
                     pretty_time(t3 - t1).c_str(),
@@ -501,9 +525,11 @@ namespace
             ITileCallback*                      m_tile_callback;
             const uint64                        m_min_sample_count;
             const double                        m_target_elapsed;
+            const double                        m_rcp_max_display_overhead;
             IAbortSwitch&                       m_abort_switch;
             ThreadFlag                          m_pause_flag;
             Stopwatch<DefaultWallclockTimer>    m_stopwatch;
+            vector<size_t>                      m_developed_tiles;
         };
 
         //
@@ -780,6 +806,14 @@ Dictionary ProgressiveFrameRendererFactory::get_params_metadata()
             .insert("label", "Max FPS")
             .insert("help", "Maximum progressive rendering update rate in frames per second"));
 
+    metadata.dictionaries().insert(
+        "max_display_overhead",
+        Dictionary()
+            .insert("type", "float")
+            .insert("default", "0.2")
+            .insert("label", "Max Display Overhead")
+            .insert("help", "Maximum fraction of the time spent updating the display; the update rate is lowered to stay within it"));
+
     metadata.dictionaries().insert(
         "max_samples",
         Dictionary()
@@ -913,9 +913,9 @@ IMPLEMENT_ATTR_GETTER(surface_shader_color)
     {
         const ShadingPoint* shading_point =
             reinterpret_cast<const ShadingPoint*>(sg->renderstate);
-        reinterpret_cast<float*>(val)[0] = shading_point->m_surface_shader_color[0];
-        reinterpret_cast<float*>(val)[1] = shading_point->m_surface_shader_color[1];
-        reinterpret_cast<float*>(val)[2] = shading_point->m_surface_shader_color[2];
+        reinterpret_cast<float*>(val)[0] = shading_point->m_osl.m_surface_shader_color[0];
+        reinterpret_cast<float*>(val)[1] = shading_point->m_osl.m_surface_shader_color[1];
+        reinterpret_cast<float*>(val)[2] = shading_point->m_osl.m_surface_shader_color[2];
 
         if (derivs)
             clear_derivatives(type, val);
@@ -932,7 +932,7 @@ IMPLEMENT_ATTR_GETTER(surface_shader_alpha)
     {
         const ShadingPoint* shading_point =
             reinterpret_cast<const ShadingPoint*>(sg->renderstate);
-        reinterpret_cast<float*>(val)[0] = shading_point->m_surface_shader_alpha;
+        reinterpret_cast<float*>(val)[0] = shading_point->m_osl.m_surface_shader_alpha;
 
         if (derivs)
             clear_derivatives(type, val);
@@ -1016,10 +1016,10 @@ IMPLEMENT_USER_DATA_GETTER(dndu)
         const ShadingPoint* shading_point =
             reinterpret_cast<const ShadingPoint*>(sg->renderstate);
 
-        const Vector3d& dndu = shading_point->get_dndu(0);
-        reinterpret_cast<float*>(val)[0] = static_cast<float>(dndu.x);
-        reinterpret_cast<float*>(val)[1] = static_cast<float>(dndu.y);
-        reinterpret_cast<float*>(val)[2] = static_cast<float>(dndu.z);
+        const Vector3f& dndu = shading_point->get_dndu(0);
+        reinterpret_cast<float*>(val)[0] = dndu.x;
+        reinterpret_cast<float*>(val)[1] = dndu.y;
+        reinterpret_cast<float*>(val)[2] = dndu.z;
 
         if (derivatives)
             clear_derivatives(type, val);
@@ -1037,10 +1037,10 @@ IMPLEMENT_USER_DATA_GETTER(dndv)
         const ShadingPoint* shading_point =
             reinterpret_cast<const ShadingPoint*>(sg->renderstate);
 
-        const Vector3d& dndv = shading_point->get_dndv(0);
-        reinterpret_cast<float*>(val)[0] = static_cast<float>(dndv.x);
-        reinterpret_cast<float*>(val)[1] = static_cast<float>(dndv.y);
-        reinterpret_cast<float*>(val)[2] = static_cast<float>(dndv.z);
+        const Vector3f& dndv = shading_point->get_dndv(0);
+        reinterpret_cast<float*>(val)[0] = dndv.x;
+        reinterpret_cast<float*>(val)[1] = dndv.y;
+        reinterpret_cast<float*>(val)[2] = dndv.z;
 
         if (derivatives)
             clear_derivatives(type, val);
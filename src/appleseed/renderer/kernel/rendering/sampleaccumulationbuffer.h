@@ -37,6 +37,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
@@ -65,10 +66,13 @@ class SampleAccumulationBuffer
         const Sample                samples[],
         foundation::IAbortSwitch&   abort_switch) = 0;
 
-    // Develop the buffer to a frame. Thread-safe.
+    // Develop the buffer to a frame. Only the tiles of the frame that may have changed since
+    // the last development are updated. If developed_tiles is not null, the indices of these
+    // tiles (tile_y * tile_count_x + tile_x) are appended to it. Thread-safe.
     virtual void develop_to_frame(
         Frame&                      frame,
-        foundation::IAbortSwitch&   abort_switch) = 0;
+        foundation::IAbortSwitch&   abort_switch,
+        std::vector<size_t>*        developed_tiles = 0) = 0;
 
   protected:
     boost::atomic<foundation::uint64> m_sample_count;
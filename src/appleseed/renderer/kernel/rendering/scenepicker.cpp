@@ -158,10 +158,10 @@ ScenePicker::PickingResult ScenePicker::pick(const Vector2d& ndc) const
     result.m_point = shading_point.get_point();
     result.m_dpdu = shading_point.get_dpdu(0);
     result.m_dpdv = shading_point.get_dpdv(0);
-    result.m_dndu = shading_point.get_dndu(0);
-    result.m_dndv = shading_point.get_dndv(0);
-    result.m_dpdx = shading_point.get_dpdx();
-    result.m_dpdy = shading_point.get_dpdy();
+    result.m_dndu = Vector3d(shading_point.get_dndu(0));
+    result.m_dndv = Vector3d(shading_point.get_dndv(0));
+    result.m_dpdx = Vector3d(shading_point.get_dpdx());
+    result.m_dpdy = Vector3d(shading_point.get_dpdy());
     result.m_geometric_normal = shading_point.get_geometric_normal();
     result.m_original_shading_normal = shading_point.get_original_shading_normal();
     result.m_side = shading_point.get_side();
@@ -77,6 +77,14 @@ namespace
             m_controller->add_post_render_tile_callback(frame);
         }
 
+        virtual void post_render_tiles(
+            const Frame*    frame,
+            const size_t    tile_count,
+            const size_t    tile_indices[]) APPLESEED_OVERRIDE
+        {
+            m_controller->add_post_render_tile_callback(frame);
+        }
+
       private:
         SerialRendererController* m_controller;
     };
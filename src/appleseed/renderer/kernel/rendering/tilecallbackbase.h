@@ -75,6 +75,16 @@ class TileCallbackBase
         const Frame*    frame) APPLESEED_OVERRIDE
     {
     }
+
+    // This method is called after some tiles of a whole frame are updated.
+    // By default, the whole frame is considered updated.
+    virtual void post_render_tiles(
+        const Frame*    frame,
+        const size_t    tile_count,
+        const size_t    tile_indices[]) APPLESEED_OVERRIDE
+    {
+        post_render(frame);
+    }
 };
 
 }       // namespace renderer
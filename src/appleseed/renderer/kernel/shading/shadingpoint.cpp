@@ -142,9 +142,9 @@ void ShadingPoint::flip_side()
     // Update OSL shader globals.
     if (m_members & HasOSLShaderGlobals)
     {
-        m_shader_globals.N = -m_shader_globals.N;
-        m_shader_globals.Ng = -m_shader_globals.Ng;
-        m_shader_globals.backfacing = 1 - m_shader_globals.backfacing;
+        m_osl.m_shader_globals.N = -m_osl.m_shader_globals.N;
+        m_osl.m_shader_globals.Ng = -m_osl.m_shader_globals.Ng;
+        m_osl.m_shader_globals.backfacing = 1 - m_osl.m_shader_globals.backfacing;
     }
 
 #endif
@@ -491,7 +491,7 @@ void ShadingPoint::compute_world_space_partial_derivatives() const
 
             m_dpdu = basis.get_tangent_u();
             m_dpdv = basis.get_tangent_v();
-            m_dndu = m_dndv = Vector3d(0.0);
+            m_dndu = m_dndv = Vector3f(0.0f);
         }
         else
         {
@@ -509,24 +509,26 @@ void ShadingPoint::compute_world_space_partial_derivatives() const
                 const Vector3d dn0(m_n0 - m_n2);
                 const Vector3d dn1(m_n1 - m_n2);
 
-                m_dndu = (dv1 * dn0 - dv0 * dn1) * rcp_det;
-                m_dndv = (du0 * dn1 - du1 * dn0) * rcp_det;
+                const Vector3d dndu = (dv1 * dn0 - dv0 * dn1) * rcp_det;
+                const Vector3d dndv = (du0 * dn1 - du1 * dn0) * rcp_det;
 
                 // Transform the normal derivatives to world space.
                 const Transformd& obj_instance_transform =
                     m_object_instance->get_transform();
 
                 m_dndu =
-                    m_assembly_instance_transform.normal_to_parent(
-                        obj_instance_transform.normal_to_parent(m_dndu));
+                    Vector3f(
+                        m_assembly_instance_transform.normal_to_parent(
+                            obj_instance_transform.normal_to_parent(dndu)));
 
                 m_dndv =
-                    m_assembly_instance_transform.normal_to_parent(
-                        obj_instance_transform.normal_to_parent(m_dndv));
+                    Vector3f(
+                        m_assembly_instance_transform.normal_to_parent(
+                            obj_instance_transform.normal_to_parent(dndv)));
             }
             else
             {
-                m_dndu = m_dndv = Vector3d(0.0);
+                m_dndu = m_dndv = Vector3f(0.0f);
             }
         }
     }
@@ -546,7 +548,7 @@ void ShadingPoint::compute_world_space_partial_derivatives() const
 
         m_dpdu = normalize(Vector3d(tangent));
         m_dpdv = normalize(cross(sn, m_dpdu));
-        m_dndu = m_dndv = Vector3d(0.0);
+        m_dndu = m_dndv = Vector3f(0.0f);
     }
 }
 
@@ -563,18 +565,18 @@ void ShadingPoint::compute_screen_space_partial_derivatives() const
         if (!intersect(ray.m_rx, p, n, tx) ||
             !intersect(ray.m_ry, p, n, ty))
         {
-            m_dpdx = Vector3d(0.0);
-            m_dpdy = Vector3d(0.0);
+            m_dpdx = Vector3f(0.0f);
+            m_dpdy = Vector3f(0.0f);
             m_duvdx = Vector2f(0.0f);
             m_duvdy = Vector2f(0.0f);
             return;
         }
 
         const Vector3d px = ray.m_rx.point_at(tx);
-        m_dpdx = px - p;
+        m_dpdx = Vector3f(px - p);
 
         const Vector3d py = ray.m_ry.point_at(ty);
-        m_dpdy = py - p;
+        m_dpdy = Vector3f(py - p);
 
         if (get_side() == ObjectInstance::BackSide)
             m_dpdx = -m_dpdx;
@@ -600,11 +602,11 @@ void ShadingPoint::compute_screen_space_partial_derivatives() const
         }
 
         const Vector2f dpdx(
-            static_cast<float>(m_dpdx[axes[max_index][0]]),
-            static_cast<float>(m_dpdx[axes[max_index][1]]));
+            m_dpdx[axes[max_index][0]],
+            m_dpdx[axes[max_index][1]]);
         const Vector2f dpdy(
-            static_cast<float>(m_dpdy[axes[max_index][0]]),
-            static_cast<float>(m_dpdy[axes[max_index][1]]));
+            m_dpdy[axes[max_index][0]],
+            m_dpdy[axes[max_index][1]]);
 
         const float rcp_d = 1.0f / d;
 
@@ -613,6 +615,13 @@ void ShadingPoint::compute_screen_space_partial_derivatives() const
         m_duvdy[0] = (dpdv[1] * dpdy[0] - dpdv[0] * dpdy[1]) * rcp_d;
         m_duvdy[1] = (dpdu[0] * dpdy[1] - dpdu[1] * dpdy[0]) * rcp_d;
     }
+    else
+    {
+        m_dpdx = Vector3f(0.0f);
+        m_dpdy = Vector3f(0.0f);
+        m_duvdx = Vector2f(0.0f);
+        m_duvdy = Vector2f(0.0f);
+    }
 }
 
 void ShadingPoint::compute_normals() const
@@ -860,7 +869,7 @@ void ShadingPoint::compute_world_space_point_velocity() const
         p1 = m_assembly_instance_transform.point_to_parent(p1);
     }
 
-    m_point_velocity = p1 - p0;
+    m_point_velocity = Vector3f(p1 - p0);
 }
 
 void ShadingPoint::compute_alpha() const
@@ -909,105 +918,105 @@ void ShadingPoint::initialize_osl_shader_globals(
         assert(is_normalized(ray.m_dir));
 
         // Surface position and incident ray direction.
-        m_shader_globals.P = Vector3f(get_point());
-        m_shader_globals.I = Vector3f(ray.m_dir);
+        m_osl.m_shader_globals.P = Vector3f(get_point());
+        m_osl.m_shader_globals.I = Vector3f(ray.m_dir);
 
-        m_shader_globals.flipHandedness =
+        m_osl.m_shader_globals.flipHandedness =
             m_assembly_instance_transform_seq->swaps_handedness(m_assembly_instance_transform) !=
             get_object_instance().transform_swaps_handedness() ? 1 : 0;
 
         // Surface position and incident ray direction differentials.
         if (ray.m_has_differentials)
         {
-            m_shader_globals.dPdx = Vector3f(get_dpdx());
-            m_shader_globals.dPdy = Vector3f(get_dpdy());
-            m_shader_globals.dPdz = Vector3f(0.0);
-            m_shader_globals.dIdx = Vector3f(ray.m_rx.m_dir);
-            m_shader_globals.dIdy = Vector3f(ray.m_ry.m_dir);
+            m_osl.m_shader_globals.dPdx = get_dpdx();
+            m_osl.m_shader_globals.dPdy = get_dpdy();
+            m_osl.m_shader_globals.dPdz = Vector3f(0.0);
+            m_osl.m_shader_globals.dIdx = Vector3f(ray.m_rx.m_dir);
+            m_osl.m_shader_globals.dIdy = Vector3f(ray.m_ry.m_dir);
         }
         else
         {
-            m_shader_globals.dPdx = Vector3f(0.0f);
-            m_shader_globals.dPdy = Vector3f(0.0f);
-            m_shader_globals.dPdz = Vector3f(0.0f);
-            m_shader_globals.dIdx = Vector3f(0.0f);
-            m_shader_globals.dIdy = Vector3f(0.0f);
+            m_osl.m_shader_globals.dPdx = Vector3f(0.0f);
+            m_osl.m_shader_globals.dPdy = Vector3f(0.0f);
+            m_osl.m_shader_globals.dPdz = Vector3f(0.0f);
+            m_osl.m_shader_globals.dIdx = Vector3f(0.0f);
+            m_osl.m_shader_globals.dIdy = Vector3f(0.0f);
         }
 
         // Shading and geometric normals and backfacing flag.
-        m_shader_globals.N = Vector3f(get_original_shading_normal());
-        m_shader_globals.Ng = Vector3f(get_geometric_normal());
-        m_shader_globals.backfacing = get_side() == ObjectInstance::FrontSide ? 0 : 1;
+        m_osl.m_shader_globals.N = Vector3f(get_original_shading_normal());
+        m_osl.m_shader_globals.Ng = Vector3f(get_geometric_normal());
+        m_osl.m_shader_globals.backfacing = get_side() == ObjectInstance::FrontSide ? 0 : 1;
 
         // Surface parameters and their differentials.
         const Vector2f& uv = get_uv(0);
-        m_shader_globals.u = uv[0];
-        m_shader_globals.v = uv[1];
+        m_osl.m_shader_globals.u = uv[0];
+        m_osl.m_shader_globals.v = uv[1];
         if (ray.m_has_differentials)
         {
             const Vector2f& duvdx = get_duvdx(0);
             const Vector2f& duvdy = get_duvdy(0);
-            m_shader_globals.dudx = duvdx[0];
-            m_shader_globals.dudy = duvdy[0];
-            m_shader_globals.dvdx = duvdx[1];
-            m_shader_globals.dvdy = duvdy[1];
+            m_osl.m_shader_globals.dudx = duvdx[0];
+            m_osl.m_shader_globals.dudy = duvdy[0];
+            m_osl.m_shader_globals.dvdx = duvdx[1];
+            m_osl.m_shader_globals.dvdy = duvdy[1];
         }
         else
         {
-            m_shader_globals.dudx = 0.0f;
-            m_shader_globals.dudy = 0.0f;
-            m_shader_globals.dvdx = 0.0f;
-            m_shader_globals.dvdy = 0.0f;
+            m_osl.m_shader_globals.dudx = 0.0f;
+            m_osl.m_shader_globals.dudy = 0.0f;
+            m_osl.m_shader_globals.dvdx = 0.0f;
+            m_osl.m_shader_globals.dvdy = 0.0f;
         }
 
         // Surface tangents.
-        m_shader_globals.dPdu = Vector3f(get_dpdu(0));
-        m_shader_globals.dPdv = Vector3f(get_dpdv(0));
+        m_osl.m_shader_globals.dPdu = Vector3f(get_dpdu(0));
+        m_osl.m_shader_globals.dPdv = Vector3f(get_dpdv(0));
 
         // Time and its derivative.
-        m_shader_globals.time = ray.m_time.m_absolute;
-        m_shader_globals.dtime = m_scene->get_active_camera()->get_shutter_open_time_interval();
+        m_osl.m_shader_globals.time = ray.m_time.m_absolute;
+        m_osl.m_shader_globals.dtime = m_scene->get_active_camera()->get_shutter_open_time_interval();
 
         // Velocity vector.
-        m_shader_globals.dPdtime =
+        m_osl.m_shader_globals.dPdtime =
             sg.uses_dPdtime()
-                ? Vector3f(get_world_space_point_velocity())
+                ? get_world_space_point_velocity()
                 : Vector3f(0.0f);
 
         // Point being illuminated and its differentials.
-        m_shader_globals.Ps = Vector3f(0.0f);
-        m_shader_globals.dPsdx = Vector3f(0.0f);
-        m_shader_globals.dPsdy = Vector3f(0.0f);
+        m_osl.m_shader_globals.Ps = Vector3f(0.0f);
+        m_osl.m_shader_globals.dPsdx = Vector3f(0.0f);
+        m_osl.m_shader_globals.dPsdy = Vector3f(0.0f);
 
         // Opaque state pointers.
-        m_shader_globals.renderstate = const_cast<ShadingPoint*>(this);
-        memset(&m_osl_trace_data, 0, sizeof(OSLTraceData));
-        m_shader_globals.tracedata = &m_osl_trace_data;
-        m_shader_globals.objdata = 0;
+        m_osl.m_shader_globals.renderstate = const_cast<ShadingPoint*>(this);
+        memset(&m_osl.m_trace_data, 0, sizeof(OSLTraceData));
+        m_osl.m_shader_globals.tracedata = &m_osl.m_trace_data;
+        m_osl.m_shader_globals.objdata = 0;
 
         // Pointer to the RendererServices object.
-        m_shader_globals.renderer = renderer;
+        m_osl.m_shader_globals.renderer = renderer;
 
         // Transformations.
-        m_obj_transform_info.m_assembly_instance_transform = m_assembly_instance_transform_seq;
-        m_obj_transform_info.m_object_instance_transform = &m_object_instance->get_transform();
-        m_shader_globals.object2common = reinterpret_cast<OSL::TransformationPtr>(&m_obj_transform_info);
-        m_shader_globals.shader2common = 0;
+        m_osl.m_obj_transform_info.m_assembly_instance_transform = m_assembly_instance_transform_seq;
+        m_osl.m_obj_transform_info.m_object_instance_transform = &m_object_instance->get_transform();
+        m_osl.m_shader_globals.object2common = reinterpret_cast<OSL::TransformationPtr>(&m_osl.m_obj_transform_info);
+        m_osl.m_shader_globals.shader2common = 0;
 
         m_members |= HasOSLShaderGlobals;
     }
 
     // Always update the ray type flags.
-    m_shader_globals.raytype = static_cast<int>(ray_flags);
+    m_osl.m_shader_globals.raytype = static_cast<int>(ray_flags);
 
     // Always update the surface area of emissive objects.
-    m_shader_globals.surfacearea =
+    m_osl.m_shader_globals.surfacearea =
         ray_flags == VisibilityFlags::LightRay && sg.has_emission()
             ? sg.get_surface_area(&get_assembly_instance(), &get_object_instance())
             : 0.0f;
 
     // Output closure.
-    m_shader_globals.Ci = 0;
+    m_osl.m_shader_globals.Ci = 0;
 }
 
 
@@ -1146,53 +1155,53 @@ void PoisonImpl<renderer::ShadingPoint>::do_poison(renderer::ShadingPoint& point
     poison(point.m_front_point);
     poison(point.m_back_point);
 
-    poison(point.m_obj_transform_info.m_assembly_instance_transform);
-    poison(point.m_obj_transform_info.m_object_instance_transform);
-
-    poison(point.m_osl_trace_data.m_traced);
-    poison(point.m_osl_trace_data.m_hit);
-    poison(point.m_osl_trace_data.m_hit_distance);
-    poison(point.m_osl_trace_data.m_P);
-    poison(point.m_osl_trace_data.m_N);
-    poison(point.m_osl_trace_data.m_Ng);
-    poison(point.m_osl_trace_data.m_u);
-    poison(point.m_osl_trace_data.m_v);
-
-    poison(point.m_shader_globals.P);
-    poison(point.m_shader_globals.dPdx);
-    poison(point.m_shader_globals.dPdy);
-    poison(point.m_shader_globals.dPdz);
-    poison(point.m_shader_globals.I);
-    poison(point.m_shader_globals.dIdx);
-    poison(point.m_shader_globals.dIdy);
-    poison(point.m_shader_globals.N);
-    poison(point.m_shader_globals.Ng);
-    poison(point.m_shader_globals.u);
-    poison(point.m_shader_globals.dudx);
-    poison(point.m_shader_globals.dudy);
-    poison(point.m_shader_globals.v);
-    poison(point.m_shader_globals.dvdx);
-    poison(point.m_shader_globals.dvdy);
-    poison(point.m_shader_globals.dPdu);
-    poison(point.m_shader_globals.dPdv);
-    poison(point.m_shader_globals.time);
-    poison(point.m_shader_globals.dtime);
-    poison(point.m_shader_globals.dPdtime);
-    poison(point.m_shader_globals.Ps);
-    poison(point.m_shader_globals.dPsdx);
-    poison(point.m_shader_globals.dPsdy);
-    poison(point.m_shader_globals.renderstate);
-    poison(point.m_shader_globals.tracedata);
-    poison(point.m_shader_globals.objdata);
-    poison(point.m_shader_globals.context);
-    poison(point.m_shader_globals.renderer);
-    poison(point.m_shader_globals.object2common);
-    poison(point.m_shader_globals.shader2common);
-    poison(point.m_shader_globals.Ci);
-    poison(point.m_shader_globals.surfacearea);
-    poison(point.m_shader_globals.raytype);
-    poison(point.m_shader_globals.flipHandedness);
-    poison(point.m_shader_globals.backfacing);
+    poison(point.m_osl.m_obj_transform_info.m_assembly_instance_transform);
+    poison(point.m_osl.m_obj_transform_info.m_object_instance_transform);
+
+    poison(point.m_osl.m_trace_data.m_traced);
+    poison(point.m_osl.m_trace_data.m_hit);
+    poison(point.m_osl.m_trace_data.m_hit_distance);
+    poison(point.m_osl.m_trace_data.m_P);
+    poison(point.m_osl.m_trace_data.m_N);
+    poison(point.m_osl.m_trace_data.m_Ng);
+    poison(point.m_osl.m_trace_data.m_u);
+    poison(point.m_osl.m_trace_data.m_v);
+
+    poison(point.m_osl.m_shader_globals.P);
+    poison(point.m_osl.m_shader_globals.dPdx);
+    poison(point.m_osl.m_shader_globals.dPdy);
+    poison(point.m_osl.m_shader_globals.dPdz);
+    poison(point.m_osl.m_shader_globals.I);
+    poison(point.m_osl.m_shader_globals.dIdx);
+    poison(point.m_osl.m_shader_globals.dIdy);
+    poison(point.m_osl.m_shader_globals.N);
+    poison(point.m_osl.m_shader_globals.Ng);
+    poison(point.m_osl.m_shader_globals.u);
+    poison(point.m_osl.m_shader_globals.dudx);
+    poison(point.m_osl.m_shader_globals.dudy);
+    poison(point.m_osl.m_shader_globals.v);
+    poison(point.m_osl.m_shader_globals.dvdx);
+    poison(point.m_osl.m_shader_globals.dvdy);
+    poison(point.m_osl.m_shader_globals.dPdu);
+    poison(point.m_osl.m_shader_globals.dPdv);
+    poison(point.m_osl.m_shader_globals.time);
+    poison(point.m_osl.m_shader_globals.dtime);
+    poison(point.m_osl.m_shader_globals.dPdtime);
+    poison(point.m_osl.m_shader_globals.Ps);
+    poison(point.m_osl.m_shader_globals.dPsdx);
+    poison(point.m_osl.m_shader_globals.dPsdy);
+    poison(point.m_osl.m_shader_globals.renderstate);
+    poison(point.m_osl.m_shader_globals.tracedata);
+    poison(point.m_osl.m_shader_globals.objdata);
+    poison(point.m_osl.m_shader_globals.context);
+    poison(point.m_osl.m_shader_globals.renderer);
+    poison(point.m_osl.m_shader_globals.object2common);
+    poison(point.m_osl.m_shader_globals.shader2common);
+    poison(point.m_osl.m_shader_globals.Ci);
+    poison(point.m_osl.m_shader_globals.surfacearea);
+    poison(point.m_osl.m_shader_globals.raytype);
+    poison(point.m_osl.m_shader_globals.flipHandedness);
+    poison(point.m_osl.m_shader_globals.backfacing);
 }
 
 }   // namespace foundation
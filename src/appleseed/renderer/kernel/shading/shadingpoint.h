@@ -150,12 +150,12 @@ class ShadingPoint
     const foundation::Vector3d& get_dpdv(const size_t uvset) const;
 
     // Return the world space partial derivatives of the intersection normal wrt. a given UV set.
-    const foundation::Vector3d& get_dndu(const size_t uvset) const;
-    const foundation::Vector3d& get_dndv(const size_t uvset) const;
+    const foundation::Vector3f& get_dndu(const size_t uvset) const;
+    const foundation::Vector3f& get_dndv(const size_t uvset) const;
 
     // Return the screen space partial derivatives of the intersection point.
-    const foundation::Vector3d& get_dpdx() const;
-    const foundation::Vector3d& get_dpdy() const;
+    const foundation::Vector3f& get_dpdx() const;
+    const foundation::Vector3f& get_dpdy() const;
 
     // Return the world space geometric normal at the intersection point. The geometric normal
     // always faces the incoming ray, i.e. dot(ray_dir, geometric_normal) is always positive or null.
@@ -187,7 +187,7 @@ class ShadingPoint
     const foundation::Vector3d& get_vertex(const size_t i) const;
 
     // Return the world space point velocity.
-    const foundation::Vector3d& get_world_space_point_velocity() const;
+    const foundation::Vector3f& get_world_space_point_velocity() const;
 
     // Return the material of the side (front or back) that was hit, at the intersection point, or 0 if there is none.
     const Material* get_material() const;
@@ -257,6 +257,7 @@ class ShadingPoint
     };
 
   private:
+    friend class AssemblyLeafPacketVisitor;
     friend class AssemblyLeafProbeVisitor;
     friend class AssemblyLeafVisitor;
     friend class CurveLeafVisitor;
@@ -265,6 +266,7 @@ class ShadingPoint
     friend class RegionLeafVisitor;
     friend class RendererServices;
     friend class ShadingPointBuilder;
+    friend class TriangleLeafPacketVisitor;
     friend class TriangleLeafVisitor;
     friend class foundation::PoisonImpl<ShadingPoint>;
 
@@ -309,6 +311,11 @@ class ShadingPoint
     };
     mutable foundation::uint32          m_members;
 
+    // Small on-demand results, grouped to avoid padding.
+    mutable ObjectInstance::Side        m_side;                         // side of the surface that was hit
+    mutable bool                        m_shade_alpha_cutouts;
+    mutable Alpha                       m_alpha;                        // opacity at intersection point
+
     // Source geometry (derived from primary intersection results).
     mutable const Assembly*             m_assembly;                     // hit assembly
     mutable const ObjectInstance*       m_object_instance;              // hit object instance
@@ -320,39 +327,42 @@ class ShadingPoint
     mutable GVector3                    m_t0, m_t1, m_t2;               // object instance space triangle vertex tangents
 
     // On-demand intersection results (derived from primary intersection results).
+    // Differential quantities are only used for filtering and shading, single precision is enough.
     mutable foundation::Vector2f        m_uv;                           // texture coordinates from UV set #0
     mutable foundation::Vector2f        m_duvdx;                        // screen space partial derivative of the texture coords wrt. X
     mutable foundation::Vector2f        m_duvdy;                        // screen space partial derivative of the texture coords wrt. Y
+    mutable foundation::Vector3f        m_dndu;                         // world space partial derivative of the intersection normal wrt. U
+    mutable foundation::Vector3f        m_dndv;                         // world space partial derivative of the intersection normal wrt. V
+    mutable foundation::Vector3f        m_dpdx;                         // screen space partial derivative of the intersection point wrt. X
+    mutable foundation::Vector3f        m_dpdy;                         // screen space partial derivative of the intersection point wrt. Y
+    mutable foundation::Vector3f        m_point_velocity;               // world space point velocity
     mutable foundation::Vector3d        m_point;                        // world space intersection point
     mutable foundation::Vector3d        m_biased_point;                 // world space intersection point with per-object-instance bias applied
     mutable foundation::Vector3d        m_dpdu;                         // world space partial derivative of the intersection point wrt. U
     mutable foundation::Vector3d        m_dpdv;                         // world space partial derivative of the intersection point wrt. V
-    mutable foundation::Vector3d        m_dndu;                         // world space partial derivative of the intersection normal wrt. U
-    mutable foundation::Vector3d        m_dndv;                         // world space partial derivative of the intersection normal wrt. V
-    mutable foundation::Vector3d        m_dpdx;                         // screen space partial derivative of the intersection point wrt. X
-    mutable foundation::Vector3d        m_dpdy;                         // screen space partial derivative of the intersection point wrt. Y
     mutable foundation::Vector3d        m_geometric_normal;             // world space geometric normal, unit-length
     mutable foundation::Vector3d        m_original_shading_normal;      // original world space shading normal, unit-length
     mutable foundation::Basis3d         m_shading_basis;                // world space orthonormal basis around shading normal
-    mutable ObjectInstance::Side        m_side;                         // side of the surface that was hit
     mutable foundation::Vector3d        m_v0_w, m_v1_w, m_v2_w;         // world space triangle vertices
-    mutable foundation::Vector3d        m_point_velocity;               // world space point velocity
     mutable const Material*             m_material;                     // material at intersection point
     mutable const Material*             m_opposite_material;            // opposite material at intersection point
-    mutable Alpha                       m_alpha;                        // opacity at intersection point
-    mutable bool                        m_shade_alpha_cutouts;
 
     // Data required to avoid self-intersections.
     mutable foundation::Vector3d        m_asm_geo_normal;               // assembly instance space geometric normal to hit triangle
     mutable foundation::Vector3d        m_front_point;                  // hit point refined to front, in assembly instance space
     mutable foundation::Vector3d        m_back_point;                   // hit point refined to back, in assembly instance space
 
-    // OSl-related data.
-    mutable OSLObjectTransformInfo      m_obj_transform_info;
-    mutable OSLTraceData                m_osl_trace_data;
-    mutable OSL::ShaderGlobals          m_shader_globals;
-    mutable foundation::Color3f         m_surface_shader_color;
-    mutable float                       m_surface_shader_alpha;
+    // OSL-related data, only touched when a shader group is executed at the shading point.
+    // Kept last so that it stays out of the cache lines of the data above.
+    struct OSLData
+    {
+        OSLObjectTransformInfo          m_obj_transform_info;
+        OSLTraceData                    m_trace_data;
+        OSL::ShaderGlobals              m_shader_globals;
+        foundation::Color3f             m_surface_shader_color;
+        float                           m_surface_shader_alpha;
+    };
+    mutable OSLData                     m_osl;
 
     // Fetch and cache the source geometry.
     void cache_source_geometry() const;
@@ -614,7 +624,7 @@ inline const foundation::Vector3d& ShadingPoint::get_dpdv(const size_t uvset) co
     return m_dpdv;
 }
 
-inline const foundation::Vector3d& ShadingPoint::get_dndu(const size_t uvset) const
+inline const foundation::Vector3f& ShadingPoint::get_dndu(const size_t uvset) const
 {
     assert(hit());
     assert(uvset == 0);     // todo: support multiple UV sets
@@ -628,7 +638,7 @@ inline const foundation::Vector3d& ShadingPoint::get_dndu(const size_t uvset) co
     return m_dndu;
 }
 
-inline const foundation::Vector3d& ShadingPoint::get_dndv(const size_t uvset) const
+inline const foundation::Vector3f& ShadingPoint::get_dndv(const size_t uvset) const
 {
     assert(hit());
     assert(uvset == 0);     // todo: support multiple UV sets
@@ -642,7 +652,7 @@ inline const foundation::Vector3d& ShadingPoint::get_dndv(const size_t uvset) co
     return m_dndv;
 }
 
-inline const foundation::Vector3d& ShadingPoint::get_dpdx() const
+inline const foundation::Vector3f& ShadingPoint::get_dpdx() const
 {
     assert(hit());
 
@@ -655,7 +665,7 @@ inline const foundation::Vector3d& ShadingPoint::get_dpdx() const
     return m_dpdx;
 }
 
-inline const foundation::Vector3d& ShadingPoint::get_dpdy() const
+inline const foundation::Vector3f& ShadingPoint::get_dpdy() const
 {
     assert(hit());
 
@@ -758,7 +768,7 @@ inline const foundation::Vector3d& ShadingPoint::get_vertex(const size_t i) cons
     return (&m_v0_w)[i];
 }
 
-inline const foundation::Vector3d& ShadingPoint::get_world_space_point_velocity() const
+inline const foundation::Vector3f& ShadingPoint::get_world_space_point_velocity() const
 {
     assert(hit());
 
@@ -880,7 +890,7 @@ inline OSL::ShaderGlobals& ShadingPoint::get_osl_shader_globals() const
 {
     assert(hit());
     assert(m_members & HasOSLShaderGlobals);
-    return m_shader_globals;
+    return m_osl.m_shader_globals;
 }
 
 inline void ShadingPoint::cache_source_geometry() const
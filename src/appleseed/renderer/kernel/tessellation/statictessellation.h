@@ -88,6 +88,7 @@ class StaticTessellation
     size_t push_tex_coords(const GVector2& uv);
     size_t get_tex_coords_count() const;
     GVector2 get_tex_coords(const size_t index) const;
+    void clear_tex_coords();
 
     // Insert and access vertex tangents.
     void reserve_vertex_tangents(const size_t count);
@@ -225,6 +226,16 @@ inline GVector2 StaticTessellation<Primitive>::get_tex_coords(const size_t index
     return uv;
 }
 
+template <typename Primitive>
+void StaticTessellation<Primitive>::clear_tex_coords()
+{
+    if (m_uv_0_cid != foundation::AttributeSet::InvalidChannelID)
+    {
+        m_vertex_attributes.delete_channel(m_uv_0_cid);
+        m_uv_0_cid = foundation::AttributeSet::InvalidChannelID;
+    }
+}
+
 template <typename Primitive>
 inline void StaticTessellation<Primitive>::reserve_vertex_tangents(const size_t count)
 {
@@ -38,9 +38,11 @@
 #include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
 #include "foundation/image/color.h"
 #include "foundation/image/colorspace.h"
 #include "foundation/image/tile.h"
+#include "foundation/platform/defaulttimers.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/foreach.h"
@@ -50,7 +52,9 @@
 
 // Standard headers.
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -65,17 +69,353 @@ namespace renderer
 TextureStore::TextureStore(
     const Scene&        scene,
     const ParamArray&   params)
-  : m_tile_swapper(scene, params)
-  , m_tile_cache(m_tile_key_hasher, m_tile_swapper)
+  : m_memory_size(0)
+{
+    const size_t shard_count = max<size_t>(params.get_optional<size_t>("shard_count", 32), 1);
+
+    m_shards.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+        m_shards.push_back(new TileShard(scene, params, shard_count, m_memory_size));
+
+    DefaultWallclockTimer timer;
+    m_timer_frequency = timer.frequency();
+}
+
+TextureStore::~TextureStore()
+{
+    for (size_t i = 0; i < m_shards.size(); ++i)
+        delete m_shards[i];
+}
+
+TextureStore::TileRecord& TextureStore::acquire(const TileKey& key)
+{
+    TileShard& shard = get_shard(key);
+
+    TileRecord* record;
+    bool must_load = false;
+    EvictedTileVector evicted_tiles;
+
+    {
+        boost::mutex::scoped_lock lock(shard.m_mutex, boost::try_to_lock);
+
+        if (!lock.owns_lock())
+        {
+            // Another thread holds the lock: measure how long we wait for it.
+            DefaultWallclockTimer timer;
+            const uint64 start = timer.read();
+            lock.lock();
+            ++shard.m_contended_count;
+            shard.m_wait_ticks += timer.read() - start;
+        }
+
+        record = &shard.m_tile_cache.get(key);
+        atomic_inc(&record->m_owners);
+
+        if (record->m_state == TileRecord::Unloaded)
+        {
+            record->m_state = TileRecord::Loading;
+            must_load = true;
+        }
+
+        shard.m_tile_swapper.take_evicted_tiles(evicted_tiles);
+    }
+
+    // Unload the tiles evicted from the cache without holding the lock.
+    if (!evicted_tiles.empty())
+        shard.m_tile_swapper.unload_tiles(evicted_tiles);
+
+    while (true)
+    {
+        if (must_load)
+        {
+            load_tile(shard, key, *record);
+            break;
+        }
+
+        const uint32 state = atomic_read(&record->m_state);
+
+        if (state == TileRecord::Loaded)
+            break;
+
+        if (state == TileRecord::Unloaded)
+        {
+            // The thread that was loading this tile failed to do so: try loading it ourselves.
+            boost::mutex::scoped_lock lock(shard.m_mutex);
+            if (record->m_state == TileRecord::Unloaded)
+            {
+                record->m_state = TileRecord::Loading;
+                must_load = true;
+            }
+        }
+        else
+        {
+            // Wait until the thread loading this tile is done.
+            foundation::yield();
+        }
+    }
+
+    return *record;
+}
+
+void TextureStore::load_tile(
+    TileShard&          shard,
+    const TileKey&      key,
+    TileRecord&         record)
+{
+    try
+    {
+        // Load or generate the tile without holding the lock.
+        if (key.get_level() == 0)
+            shard.m_tile_swapper.load_tile(key, record);
+        else generate_tile(shard, key, record);
+    }
+    catch (...)
+    {
+        // Give up ownership of the tile and let waiting threads retry loading it.
+        {
+            boost::mutex::scoped_lock lock(shard.m_mutex);
+            atomic_dec(&record.m_owners);
+            atomic_write(&record.m_state, TileRecord::Unloaded);
+        }
+
+        throw;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(shard.m_mutex);
+        shard.m_tile_swapper.add_loaded_tile(record);
+    }
+
+    // Publish the tile to the threads waiting for it.
+    atomic_write(&record.m_state, TileRecord::Loaded);
+}
+
+void TextureStore::generate_tile(
+    TileShard&          shard,
+    const TileKey&      key,
+    TileRecord&         record)
+{
+    // Fetch the texture.
+    Texture* texture = shard.m_tile_swapper.get_texture(key);
+    assert(texture);
+
+    const size_t level = key.get_level();
+    const CanvasProperties& props = texture->mip_properties(level);
+    const CanvasProperties& finer_props = texture->mip_properties(level - 1);
+
+    // Pixels of the level covered by the tile.
+    const size_t x0 = key.get_tile_x() * props.m_tile_width;
+    const size_t y0 = key.get_tile_y() * props.m_tile_height;
+    const size_t width = min(props.m_tile_width, props.m_canvas_width - x0);
+    const size_t height = min(props.m_tile_height, props.m_canvas_height - y0);
+
+    // Pixels of the finer level covered by the tile. When the finer level has an odd
+    // size, its last row and column are folded into the last row and column of the level.
+    const size_t fx0 = 2 * x0;
+    const size_t fy0 = 2 * y0;
+    const size_t fx1 = x0 + width == props.m_canvas_width ? finer_props.m_canvas_width : 2 * (x0 + width);
+    const size_t fy1 = y0 + height == props.m_canvas_height ? finer_props.m_canvas_height : 2 * (y0 + height);
+
+    const size_t channel_count = props.m_channel_count;
+    assert(channel_count <= 4);
+
+    vector<float> sums(width * height * channel_count, 0.0f);
+    vector<float> weights(width * height, 0.0f);
+    float pixel[4];
+
+    // Accumulate the finer tiles one at a time. They were converted to linear RGB when loaded.
+    for (size_t fty = fy0 / finer_props.m_tile_height; fty <= (fy1 - 1) / finer_props.m_tile_height; ++fty)
+    {
+        for (size_t ftx = fx0 / finer_props.m_tile_width; ftx <= (fx1 - 1) / finer_props.m_tile_width; ++ftx)
+        {
+            TileRecord& finer_record =
+                acquire(TileKey(key.m_assembly_uid, key.m_texture_uid, ftx, fty, level - 1));
+            const Tile& finer_tile = *finer_record.m_tile;
+
+            const size_t origin_x = ftx * finer_props.m_tile_width;
+            const size_t origin_y = fty * finer_props.m_tile_height;
+            const size_t begin_x = max(fx0, origin_x) - origin_x;
+            const size_t begin_y = max(fy0, origin_y) - origin_y;
+            const size_t end_x = min(fx1, origin_x + finer_tile.get_width()) - origin_x;
+            const size_t end_y = min(fy1, origin_y + finer_tile.get_height()) - origin_y;
+
+            for (size_t y = begin_y; y < end_y; ++y)
+            {
+                const size_t dy = min((origin_y + y) / 2, props.m_canvas_height - 1) - y0;
+
+                for (size_t x = begin_x; x < end_x; ++x)
+                {
+                    const size_t dx = min((origin_x + x) / 2, props.m_canvas_width - 1) - x0;
+                    const size_t index = dy * width + dx;
+
+                    finer_tile.get_pixel(x, y, pixel);
+
+                    float* sum = &sums[index * channel_count];
+                    for (size_t c = 0; c < channel_count; ++c)
+                        sum[c] += pixel[c];
+
+                    weights[index] += 1.0f;
+                }
+            }
+
+            release(finer_record);
+        }
+    }
+
+    Tile* tile = new Tile(width, height, channel_count, props.m_pixel_format);
+
+    for (size_t i = 0, e = width * height; i < e; ++i)
+    {
+        const float rcp_weight = 1.0f / weights[i];
+        const float* sum = &sums[i * channel_count];
+
+        for (size_t c = 0; c < channel_count; ++c)
+            pixel[c] = sum[c] * rcp_weight;
+
+        tile->set_pixel(i, pixel);
+    }
+
+    record.m_tile = tile;
+    record.m_texture_version = texture->get_version_id();
+    record.m_texture_stamp = texture->get_content_stamp();
+    record.m_detached = true;   // generated tiles are owned by the store
+}
+
+struct TextureStore::AttachedTilePredicate
+{
+    bool operator()(const TileKey& key, const TileRecord& record) const
+    {
+        return !record.m_detached;
+    }
+};
+
+struct TextureStore::StaleTilePredicate
+{
+    TileSwapper& m_tile_swapper;
+
+    explicit StaleTilePredicate(TileSwapper& tile_swapper)
+      : m_tile_swapper(tile_swapper)
+    {
+    }
+
+    bool operator()(const TileKey& key, const TileRecord& record) const
+    {
+        return m_tile_swapper.is_stale(key, record);
+    }
+};
+
+void TextureStore::on_render_begin(const Scene& scene)
+{
+    size_t kept_memory_size = 0;
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        TileShard& shard = *m_shards[i];
+        EvictedTileVector evicted_tiles;
+
+        {
+            boost::mutex::scoped_lock lock(shard.m_mutex);
+            shard.m_tile_swapper.set_scene(scene);
+            shard.m_tile_cache.remove_if(StaleTilePredicate(shard.m_tile_swapper));
+            shard.m_tile_swapper.take_evicted_tiles(evicted_tiles);
+            kept_memory_size += shard.m_tile_swapper.get_memory_size();
+        }
+
+        shard.m_tile_swapper.unload_tiles(evicted_tiles);
+    }
+
+    if (kept_memory_size > 0)
+    {
+        RENDERER_LOG_DEBUG(
+            "texture store kept %s of tiles from the previous render.",
+            pretty_size(kept_memory_size).c_str());
+    }
+}
+
+void TextureStore::on_render_end()
 {
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        TileShard& shard = *m_shards[i];
+        EvictedTileVector evicted_tiles;
+
+        {
+            boost::mutex::scoped_lock lock(shard.m_mutex);
+            shard.m_tile_cache.remove_if(AttachedTilePredicate());
+            shard.m_tile_swapper.take_evicted_tiles(evicted_tiles);
+        }
+
+        shard.m_tile_swapper.unload_tiles(evicted_tiles);
+    }
 }
 
 StatisticsVector TextureStore::get_statistics() const
 {
-    Statistics stats = make_single_stage_cache_stats(m_tile_cache);
-    stats.insert_size("peak size", m_tile_swapper.get_peak_memory_size());
+    uint64 hit_count = 0;
+    uint64 miss_count = 0;
+    uint64 contended_count = 0;
+    uint64 wait_ticks = 0;
+    size_t peak_memory_size = 0;
+    uint64 loaded_tile_count = 0;
+    uint64 loaded_memory_size = 0;
+
+    StatisticsVector shard_stats;
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        TileShard& shard = *m_shards[i];
+
+        // Counters are updated while holding the lock of the shard.
+        Statistics stats;
+        uint64 shard_contended_count, shard_wait_ticks;
+        size_t shard_peak_memory_size;
+        uint64 shard_loaded_tile_count, shard_loaded_memory_size;
+
+        {
+            boost::mutex::scoped_lock lock(shard.m_mutex);
+            stats = make_single_stage_cache_stats(shard.m_tile_cache);
+            hit_count += shard.m_tile_cache.get_hit_count();
+            miss_count += shard.m_tile_cache.get_miss_count();
+            shard_contended_count = shard.m_contended_count;
+            shard_wait_ticks = shard.m_wait_ticks;
+            shard_peak_memory_size = shard.m_tile_swapper.get_peak_memory_size();
+            shard_loaded_tile_count = shard.m_tile_swapper.get_loaded_tile_count();
+            shard_loaded_memory_size = shard.m_tile_swapper.get_loaded_memory_size();
+        }
+
+        contended_count += shard_contended_count;
+        wait_ticks += shard_wait_ticks;
+        peak_memory_size += shard_peak_memory_size;
+        loaded_tile_count += shard_loaded_tile_count;
+        loaded_memory_size += shard_loaded_memory_size;
+
+        stats.insert("contended acquisitions", shard_contended_count);
+        stats.insert_time("wait time", static_cast<double>(shard_wait_ticks) / m_timer_frequency);
+        stats.insert_size("peak size", shard_peak_memory_size);
+        stats.insert("tiles loaded", shard_loaded_tile_count);
+        stats.insert_size("bytes loaded", shard_loaded_memory_size);
+
+        shard_stats.insert("texture store shard #" + to_string(i) + " statistics", stats);
+    }
 
-    return StatisticsVector::make("texture store statistics", stats);
+    Statistics stats;
+    stats.insert(
+        auto_ptr<cache_impl::CacheStatisticsEntry>(
+            new cache_impl::CacheStatisticsEntry(
+                "performances",
+                hit_count,
+                miss_count)));
+    stats.insert<uint64>("shards", m_shards.size());
+    stats.insert("contended acquisitions", contended_count);
+    stats.insert_time("wait time", static_cast<double>(wait_ticks) / m_timer_frequency);
+    stats.insert_size("peak size", peak_memory_size);
+    stats.insert("tiles loaded", loaded_tile_count);
+    stats.insert_size("bytes loaded", loaded_memory_size);
+
+    StatisticsVector vec = StatisticsVector::make("texture store statistics", stats);
+    vec.merge(shard_stats);
+
+    return vec;
 }
 
 Dictionary TextureStore::get_params_metadata()
@@ -91,10 +431,35 @@ Dictionary TextureStore::get_params_metadata()
             .insert("label", "Texture Cache Size")
             .insert("help", "Texture cache size in bytes"));
 
+    metadata.dictionaries().insert(
+        "shard_count",
+        Dictionary()
+            .insert("type", "int")
+            .insert("default", "32")
+            .insert("label", "Texture Cache Shards")
+            .insert("help", "Number of independently locked parts of the texture cache"));
+
     return metadata;
 }
 
 
+//
+// TextureStore::TileShard class implementation.
+//
+
+TextureStore::TileShard::TileShard(
+    const Scene&                scene,
+    const ParamArray&           params,
+    const size_t                shard_count,
+    boost::atomic<size_t>&      store_memory_size)
+  : m_tile_swapper(scene, params, shard_count, store_memory_size)
+  , m_tile_cache(m_tile_key_hasher, m_tile_swapper)
+  , m_contended_count(0)
+  , m_wait_ticks(0)
+{
+}
+
+
 //
 // TextureStore::TileSwapper class implementation.
 //
@@ -161,40 +526,69 @@ namespace
 }
 
 TextureStore::TileSwapper::TileSwapper(
-    const Scene&        scene,
-    const ParamArray&   params)
-  : m_scene(scene)
-  , m_params(params)
+    const Scene&                scene,
+    const ParamArray&           params,
+    const size_t                shard_count,
+    boost::atomic<size_t>&      store_memory_size)
+  : m_scene(&scene)
+  , m_params(params, shard_count)
+  , m_store_memory_size(store_memory_size)
   , m_memory_size(0)
   , m_peak_memory_size(0)
+  , m_loaded_tile_count(0)
+  , m_loaded_memory_size(0)
+{
+    gather_assemblies(scene.assemblies());
+}
+
+TextureStore::TileSwapper::~TileSwapper()
 {
+    // Unload the tiles evicted when the cache was cleared.
+    unload_tiles(m_evicted_tiles);
+}
+
+void TextureStore::TileSwapper::set_scene(const Scene& scene)
+{
+    m_scene = &scene;
+
+    // Assemblies may have been added, removed or replaced.
+    m_assemblies.clear();
     gather_assemblies(scene.assemblies());
+
+    // Textures may have been modified since the previous render.
+    m_content_stamps.clear();
 }
 
 void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
 {
-    // Fetch the texture container.
-    const TextureContainer& textures =
-        key.m_assembly_uid == UniqueID(~0)
-            ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
+    record.m_tile = 0;
+    record.m_owners = 0;
+    record.m_state = TileRecord::Unloaded;
+    record.m_texture_version = 0;
+    record.m_texture_stamp = 0;
+    record.m_detached = false;
+}
 
+void TextureStore::TileSwapper::load_tile(const TileKey& key, TileRecord& record) const
+{
     // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    Texture* texture = get_texture(key);
+    assert(texture);
 
     if (m_params.m_track_tile_loading)
     {
         RENDERER_LOG_DEBUG(
-            "loading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") "
+            "loading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") of level " FMT_SIZE_T " "
             "from texture \"%s\"...",
             key.get_tile_x(),
             key.get_tile_y(),
+            key.get_level(),
             texture->get_path().c_str());
     }
 
     // Load the tile.
-    record.m_tile = texture->load_tile(key.get_tile_x(), key.get_tile_y());
-    record.m_owners = 0;
+    assert(key.get_level() == 0);
+    Tile* tile = texture->load_tile(key.get_tile_x(), key.get_tile_y());
 
     // Convert the tile to the linear RGB color space.
     switch (texture->get_color_space())
@@ -203,76 +597,155 @@ void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
         break;
 
       case ColorSpaceSRGB:
-        convert_tile_srgb_to_linear_rgb(*record.m_tile);
+        convert_tile_srgb_to_linear_rgb(*tile);
         break;
 
       case ColorSpaceCIEXYZ:
-        convert_tile_ciexyz_to_linear_rgb(*record.m_tile);
+        convert_tile_ciexyz_to_linear_rgb(*tile);
         break;
 
       assert_otherwise;
     }
 
+    record.m_tile = tile;
+    record.m_texture_version = texture->get_version_id();
+    record.m_texture_stamp = texture->get_content_stamp();
+    record.m_detached = texture->has_detached_tiles();
+}
+
+void TextureStore::TileSwapper::add_loaded_tile(const TileRecord& record)
+{
     // Track the amount of memory used by the tile cache.
-    m_memory_size += record.m_tile->get_memory_size();
+    const size_t tile_memory_size = record.m_tile->get_memory_size();
+    m_memory_size += tile_memory_size;
     m_peak_memory_size = max(m_peak_memory_size, m_memory_size);
+    const size_t store_memory_size = m_store_memory_size += tile_memory_size;
+
+    // Track the amount of texture data loaded.
+    ++m_loaded_tile_count;
+    m_loaded_memory_size += tile_memory_size;
 
     if (m_params.m_track_store_size)
     {
-        if (m_memory_size > m_params.m_memory_limit)
+        if (store_memory_size > m_params.m_memory_limit)
         {
             RENDERER_LOG_DEBUG(
-                "texture store size is %s, exceeding capacity %s by %s",
-                pretty_size(m_memory_size).c_str(),
+                "texture store size is %s, exceeding capacity %s by %s (shard size is %s)",
+                pretty_size(store_memory_size).c_str(),
                 pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_memory_size - m_params.m_memory_limit).c_str());
+                pretty_size(store_memory_size - m_params.m_memory_limit).c_str(),
+                pretty_size(m_memory_size).c_str());
         }
         else
         {
             RENDERER_LOG_DEBUG(
-                "texture store size is %s, below capacity %s by %s",
-                pretty_size(m_memory_size).c_str(),
+                "texture store size is %s, below capacity %s by %s (shard size is %s)",
+                pretty_size(store_memory_size).c_str(),
                 pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_params.m_memory_limit - m_memory_size).c_str());
+                pretty_size(m_params.m_memory_limit - store_memory_size).c_str(),
+                pretty_size(m_memory_size).c_str());
         }
     }
 }
 
 bool TextureStore::TileSwapper::unload(const TileKey& key, TileRecord& record)
 {
-    // Cannot unload tiles that are still in use.
+    // Cannot unload tiles that are still in use (this includes tiles being loaded).
     if (atomic_read(&record.m_owners) > 0)
         return false;
 
+    // Tiles that failed to load have nothing to unload.
+    if (record.m_state == TileRecord::Unloaded)
+        return true;
+
+    assert(record.m_state == TileRecord::Loaded);
+
     // Track the amount of memory used by the tile cache.
     const size_t tile_memory_size = record.m_tile->get_memory_size();
     assert(m_memory_size >= tile_memory_size);
     m_memory_size -= tile_memory_size;
+    m_store_memory_size -= tile_memory_size;
 
-    // Fetch the texture container.
-    const TextureContainer& textures =
-        key.m_assembly_uid == UniqueID(~0)
-            ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
+    // The tile will be unloaded once the lock is released.
+    m_evicted_tiles.push_back(make_pair(key, record));
 
-    // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    // Successfully unloaded the tile.
+    return true;
+}
+
+void TextureStore::TileSwapper::take_evicted_tiles(EvictedTileVector& tiles)
+{
+    if (!m_evicted_tiles.empty())
+        tiles.swap(m_evicted_tiles);
+}
 
-    if (m_params.m_track_tile_unloading)
+void TextureStore::TileSwapper::unload_tiles(const EvictedTileVector& tiles) const
+{
+    for (size_t i = 0; i < tiles.size(); ++i)
     {
-        RENDERER_LOG_DEBUG(
-            "unloading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") "
-            "from texture \"%s\"...",
-            key.get_tile_x(),
-            key.get_tile_y(),
-            texture->get_path().c_str());
+        const TileKey& key = tiles[i].first;
+        const TileRecord& record = tiles[i].second;
+
+        // Detached tiles are owned by the store and their texture may no longer exist.
+        if (record.m_detached)
+        {
+            delete record.m_tile;
+            continue;
+        }
+
+        // Fetch the texture.
+        Texture* texture = get_texture(key);
+        assert(texture);
+
+        if (m_params.m_track_tile_unloading)
+        {
+            RENDERER_LOG_DEBUG(
+                "unloading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") of level " FMT_SIZE_T " "
+                "from texture \"%s\"...",
+                key.get_tile_x(),
+                key.get_tile_y(),
+                key.get_level(),
+                texture->get_path().c_str());
+        }
+
+        // Unload the tile. Tiles of other MIP levels are generated, thus detached.
+        assert(key.get_level() == 0);
+        texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
     }
+}
+
+bool TextureStore::TileSwapper::is_stale(const TileKey& key, const TileRecord& record)
+{
+    const Texture* texture = get_texture(key);
 
-    // Unload the tile.
-    texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
+    if (texture == 0 || texture->get_version_id() != record.m_texture_version)
+        return true;
 
-    // Successfully unloaded the tile.
-    return true;
+    // Querying the content stamp may hit the file system, do it once per texture.
+    const TextureKey texture_key(key.m_assembly_uid, key.m_texture_uid);
+    ContentStampMap::const_iterator i = m_content_stamps.find(texture_key);
+    if (i == m_content_stamps.end())
+        i = m_content_stamps.insert(make_pair(texture_key, texture->get_content_stamp())).first;
+
+    return i->second != record.m_texture_stamp;
+}
+
+Texture* TextureStore::TileSwapper::get_texture(const TileKey& key) const
+{
+    // Fetch the texture container.
+    const TextureContainer* textures;
+    if (key.m_assembly_uid == UniqueID(~0))
+        textures = &m_scene->textures();
+    else
+    {
+        const AssemblyMap::const_iterator i = m_assemblies.find(key.m_assembly_uid);
+        if (i == m_assemblies.end())
+            return 0;
+        textures = &i->second->textures();
+    }
+
+    // Fetch the texture.
+    return textures->get_by_uid(key.m_texture_uid);
 }
 
 void TextureStore::TileSwapper::gather_assemblies(const AssemblyContainer& assemblies)
@@ -289,13 +762,17 @@ void TextureStore::TileSwapper::gather_assemblies(const AssemblyContainer& assem
 // TextureStore::TileSwapper::Parameters class implementation.
 //
 
-TextureStore::TileSwapper::Parameters::Parameters(const ParamArray& params)
-  : m_memory_limit(params.get_optional<size_t>("max_size", 256 * 1024 * 1024))
+TextureStore::TileSwapper::Parameters::Parameters(
+    const ParamArray&   params,
+    const size_t        shard_count)
+  : m_memory_limit(max<size_t>(params.get_optional<size_t>("max_size", 256 * 1024 * 1024), 1))
+  , m_shard_memory_limit(max<size_t>(m_memory_limit / shard_count, 1))
   , m_track_tile_loading(params.get_optional<bool>("track_tile_loading", false))
   , m_track_tile_unloading(params.get_optional<bool>("track_tile_unloading", false))
   , m_track_store_size(params.get_optional<bool>("track_store_size", false))
 {
     assert(m_memory_limit > 0);
+    assert(m_shard_memory_limit > 0);
 }
 
 }   // namespace renderer
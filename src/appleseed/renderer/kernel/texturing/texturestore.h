@@ -41,11 +41,17 @@
 #include "foundation/platform/types.h"
 #include "foundation/utility/cache.h"
 #include "foundation/utility/uid.h"
+#include "foundation/utility/version.h"
+
+// Boost headers.
+#include "boost/atomic/atomic.hpp"
 
 // Standard headers.
 #include <cassert>
 #include <cstddef>
 #include <map>
+#include <utility>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class Dictionary; }
@@ -53,6 +59,7 @@ namespace foundation    { class StatisticsVector; }
 namespace foundation    { class Tile; }
 namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
+namespace renderer      { class Texture; }
 
 namespace renderer
 {
@@ -60,6 +67,15 @@ namespace renderer
 //
 // A shared store for texture tiles (the backend of the thread-local texture cache).
 //
+// A store may be kept across renders of a scene that changes in between. Tiles that
+// are detached from their texture (see Texture::has_detached_tiles()) survive the end
+// of a render and are only reloaded if their texture was removed or modified.
+//
+// Only the tiles of MIP level 0 are loaded from textures. A tile of a coarser level
+// is generated when it is first acquired, by box-filtering the tiles of the finer
+// level that it covers, which are themselves acquired from the store. Generated
+// tiles are owned by the store and count against its memory budget.
+//
 
 class TextureStore
   : public foundation::NonCopyable
@@ -71,6 +87,7 @@ class TextureStore
         foundation::UniqueID    m_assembly_uid;
         foundation::UniqueID    m_texture_uid;
         foundation::uint32      m_tile_xy;
+        foundation::uint32      m_level;            // MIP level, 0 is the full resolution level
 
         TileKey();
 
@@ -78,17 +95,14 @@ class TextureStore
             const foundation::UniqueID  assembly_uid,
             const foundation::UniqueID  texture_uid,
             const size_t                tile_x,
-            const size_t                tile_y);
-
-        TileKey(
-            const foundation::UniqueID  assembly_uid,
-            const foundation::UniqueID  texture_uid,
-            const foundation::uint32    tile_xy);
+            const size_t                tile_y,
+            const size_t                level = 0);
 
         TileKey(const TileKey& rhs);
 
         size_t get_tile_x() const;
         size_t get_tile_y() const;
+        size_t get_level() const;
 
         // Return an invalid key.
         static TileKey invalid();
@@ -101,8 +115,19 @@ class TextureStore
 
     struct TileRecord
     {
+        enum State
+        {
+            Unloaded,
+            Loading,
+            Loaded
+        };
+
         foundation::Tile*           m_tile;
         volatile foundation::uint32 m_owners;
+        volatile foundation::uint32 m_state;
+        foundation::VersionID       m_texture_version;  // version ID of the texture when the tile was loaded
+        foundation::uint64          m_texture_stamp;    // content stamp of the texture when the tile was loaded
+        bool                        m_detached;         // true if the tile remains valid once its texture is destroyed
     };
 
     // Constructor.
@@ -110,12 +135,27 @@ class TextureStore
         const Scene&        scene,
         const ParamArray&   params = ParamArray());
 
+    // Destructor.
+    ~TextureStore();
+
     // Acquire an element from the cache. Thread-safe.
+    // Tiles are loaded outside of any lock; threads acquiring a tile that
+    // is being loaded by another thread wait until it becomes available.
+    // Exceptions thrown while loading a tile are propagated to the caller,
+    // and the tile is loaded again by the next thread acquiring it.
     TileRecord& acquire(const TileKey& key);
 
     // Release a previously-acquired element. Thread-safe.
     void release(TileRecord& record) const;
 
+    // Prepare the store for rendering a given scene, possibly modified since the last render.
+    // Unload the tiles of textures that were removed from the scene or whose version changed.
+    void on_render_begin(const Scene& scene);
+
+    // Unload the tiles that cannot be kept until the next render. Must be called while
+    // the textures of the scene still exist. Tiles must no longer be in use.
+    void on_render_end();
+
     // Retrieve performance statistics.
     foundation::StatisticsVector get_statistics() const;
 
@@ -128,45 +168,92 @@ class TextureStore
         size_t operator()(const TileKey& key) const;
     };
 
+    typedef std::vector<std::pair<TileKey, TileRecord> > EvictedTileVector;
+
+    struct AttachedTilePredicate;
+    struct StaleTilePredicate;
+
     class TileSwapper
       : public foundation::NonCopyable
     {
       public:
         // Constructor.
         TileSwapper(
-            const Scene&        scene,
-            const ParamArray&   params);
+            const Scene&                scene,
+            const ParamArray&           params,
+            const size_t                shard_count,
+            boost::atomic<size_t>&      store_memory_size);
 
-        // Load a cache line.
+        // Destructor.
+        ~TileSwapper();
+
+        // Switch to a new version of the scene.
+        void set_scene(const Scene& scene);
+
+        // Create a cache line. The tile itself is loaded later by load_tile().
         void load(const TileKey& key, TileRecord& record);
 
-        // Unload a cache line.
+        // Unload a cache line. The tile is only queued for unloading, see unload_tiles().
         bool unload(const TileKey& key, TileRecord& record);
 
         // Return true if the cache is full, false otherwise.
         bool is_full(const size_t element_count) const;
 
+        // Load the tile of a cache line of MIP level 0. Does not modify the state of the swapper.
+        void load_tile(const TileKey& key, TileRecord& record) const;
+
+        // Account for a tile that was just loaded by load_tile().
+        void add_loaded_tile(const TileRecord& record);
+
+        // Move the tiles queued for unloading to 'tiles'.
+        void take_evicted_tiles(EvictedTileVector& tiles);
+
+        // Unload a list of tiles.
+        void unload_tiles(const EvictedTileVector& tiles) const;
+
+        // Return true if the texture of a tile was removed from the scene or modified.
+        // The content stamp of each texture is only queried once after set_scene().
+        bool is_stale(const TileKey& key, const TileRecord& record);
+
+        // Return the texture of a tile, or 0 if it no longer exists.
+        Texture* get_texture(const TileKey& key) const;
+
+        // Return the current memory size in bytes of the tile cache.
+        size_t get_memory_size() const;
+
         // Return the peak memory size in bytes of the tile cache.
         size_t get_peak_memory_size() const;
 
+        // Return the number of tiles and the total size in bytes of the tiles loaded so far.
+        foundation::uint64 get_loaded_tile_count() const;
+        foundation::uint64 get_loaded_memory_size() const;
+
       private:
         struct Parameters
         {
-            const size_t    m_memory_limit;
+            const size_t    m_memory_limit;             // memory budget of the whole store
+            const size_t    m_shard_memory_limit;       // share of the budget of each shard
             const bool      m_track_tile_loading;
             const bool      m_track_tile_unloading;
             const bool      m_track_store_size;
 
-            explicit Parameters(const ParamArray& params);
+            Parameters(const ParamArray& params, const size_t shard_count);
         };
 
         typedef std::map<foundation::UniqueID, const Assembly*> AssemblyMap;
-
-        const Scene&        m_scene;
-        const Parameters    m_params;
-        size_t              m_memory_size;
-        size_t              m_peak_memory_size;
-        AssemblyMap         m_assemblies;
+        typedef std::pair<foundation::UniqueID, foundation::UniqueID> TextureKey;
+        typedef std::map<TextureKey, foundation::uint64> ContentStampMap;
+
+        const Scene*            m_scene;
+        const Parameters        m_params;
+        boost::atomic<size_t>&  m_store_memory_size;
+        size_t                  m_memory_size;
+        size_t                  m_peak_memory_size;
+        foundation::uint64      m_loaded_tile_count;
+        foundation::uint64      m_loaded_memory_size;
+        AssemblyMap             m_assemblies;
+        EvictedTileVector       m_evicted_tiles;
+        ContentStampMap         m_content_stamps;
 
         void gather_assemblies(const AssemblyContainer& assemblies);
     };
@@ -178,10 +265,42 @@ class TextureStore
         TileSwapper
     > TileCache;
 
-    boost::mutex            m_mutex;
-    TileKeyHasher           m_tile_key_hasher;
-    TileSwapper             m_tile_swapper;
-    TileCache               m_tile_cache;
+    // An independent part of the store, with its own lock and share of the memory budget.
+    struct TileShard
+      : public foundation::NonCopyable
+    {
+        boost::mutex        m_mutex;
+        TileKeyHasher       m_tile_key_hasher;
+        TileSwapper         m_tile_swapper;
+        TileCache           m_tile_cache;
+        foundation::uint64  m_contended_count;     // number of acquisitions that had to wait for the lock
+        foundation::uint64  m_wait_ticks;          // total time spent waiting for the lock
+
+        TileShard(
+            const Scene&                scene,
+            const ParamArray&           params,
+            const size_t                shard_count,
+            boost::atomic<size_t>&      store_memory_size);
+    };
+
+    TileKeyHasher               m_tile_key_hasher;
+    boost::atomic<size_t>       m_memory_size;          // memory used by the tiles of all shards
+    std::vector<TileShard*>     m_shards;
+    foundation::uint64          m_timer_frequency;
+
+    TileShard& get_shard(const TileKey& key);
+
+    // Load the tile of a record in the Loading state and publish it.
+    void load_tile(
+        TileShard&          shard,
+        const TileKey&      key,
+        TileRecord&         record);
+
+    // Generate the tile of a record of a MIP level other than 0 from the tiles of the finer level.
+    void generate_tile(
+        TileShard&          shard,
+        const TileKey&      key,
+        TileRecord&         record);
 };
 
 
@@ -189,14 +308,9 @@ class TextureStore
 // TextureStore class implementation.
 //
 
-inline TextureStore::TileRecord& TextureStore::acquire(const TileKey& key)
+inline TextureStore::TileShard& TextureStore::get_shard(const TileKey& key)
 {
-    boost::mutex::scoped_lock lock(m_mutex);
-
-    TileRecord& record = m_tile_cache.get(key);
-    foundation::atomic_inc(&record.m_owners);
-
-    return record;
+    return *m_shards[m_tile_key_hasher(key) % m_shards.size()];
 }
 
 inline void TextureStore::release(TileRecord& record) const
@@ -218,29 +332,22 @@ inline TextureStore::TileKey::TileKey(
     const foundation::UniqueID  assembly_uid,
     const foundation::UniqueID  texture_uid,
     const size_t                tile_x,
-    const size_t                tile_y)
+    const size_t                tile_y,
+    const size_t                level)
   : m_assembly_uid(assembly_uid)
   , m_texture_uid(texture_uid)
   , m_tile_xy(static_cast<foundation::uint32>((tile_y << 16) | tile_x))
+  , m_level(static_cast<foundation::uint32>(level))
 {
     assert(tile_x < (1UL << 16));
     assert(tile_y < (1UL << 16));
 }
 
-inline TextureStore::TileKey::TileKey(
-    const foundation::UniqueID  assembly_uid,
-    const foundation::UniqueID  texture_uid,
-    const foundation::uint32    tile_xy)
-  : m_assembly_uid(assembly_uid)
-  , m_texture_uid(texture_uid)
-  , m_tile_xy(tile_xy)
-{
-}
-
 inline TextureStore::TileKey::TileKey(const TileKey& rhs)
   : m_assembly_uid(rhs.m_assembly_uid)
   , m_texture_uid(rhs.m_texture_uid)
   , m_tile_xy(rhs.m_tile_xy)
+  , m_level(rhs.m_level)
 {
 }
 
@@ -254,15 +361,26 @@ inline size_t TextureStore::TileKey::get_tile_y() const
     return static_cast<size_t>(m_tile_xy >> 16);
 }
 
+inline size_t TextureStore::TileKey::get_level() const
+{
+    return static_cast<size_t>(m_level);
+}
+
 inline TextureStore::TileKey TextureStore::TileKey::invalid()
 {
-    return TileKey(~0, ~0, ~0);
+    TileKey key;
+    key.m_assembly_uid = ~foundation::UniqueID(0);
+    key.m_texture_uid = ~foundation::UniqueID(0);
+    key.m_tile_xy = ~foundation::uint32(0);
+    key.m_level = ~foundation::uint32(0);
+    return key;
 }
 
 inline bool TextureStore::TileKey::operator==(const TileKey& rhs) const
 {
     return
         m_tile_xy == rhs.m_tile_xy &&
+        m_level == rhs.m_level &&
         m_texture_uid == rhs.m_texture_uid &&
         m_assembly_uid == rhs.m_assembly_uid;
 }
@@ -277,7 +395,9 @@ inline bool TextureStore::TileKey::operator<(const TileKey& rhs) const
     return
         m_assembly_uid == rhs.m_assembly_uid ?
             m_texture_uid == rhs.m_texture_uid ?
-                m_tile_xy < rhs.m_tile_xy :
+                m_level == rhs.m_level ?
+                    m_tile_xy < rhs.m_tile_xy :
+                m_level < rhs.m_level :
             m_texture_uid < rhs.m_texture_uid :
         m_assembly_uid < rhs.m_assembly_uid;
 }
@@ -289,7 +409,11 @@ inline bool TextureStore::TileKey::operator<(const TileKey& rhs) const
 
 inline size_t TextureStore::TileKeyHasher::operator()(const TileKey& key) const
 {
-    return foundation::mix_uint64(key.m_assembly_uid, key.m_texture_uid, key.m_tile_xy);
+    return
+        foundation::mix_uint64(
+            key.m_assembly_uid,
+            key.m_texture_uid,
+            (static_cast<foundation::uint64>(key.m_level) << 32) | key.m_tile_xy);
 }
 
 
@@ -299,7 +423,16 @@ inline size_t TextureStore::TileKeyHasher::operator()(const TileKey& key) const
 
 inline bool TextureStore::TileSwapper::is_full(const size_t element_count) const
 {
-    return m_memory_size >= m_params.m_memory_limit;
+    // A shard may exceed its share of the budget as long as the store as a whole has room,
+    // so that tiles larger than a share (such as untiled images) don't keep being reloaded.
+    return
+        m_memory_size >= m_params.m_shard_memory_limit &&
+        m_store_memory_size >= m_params.m_memory_limit;
+}
+
+inline size_t TextureStore::TileSwapper::get_memory_size() const
+{
+    return m_memory_size;
 }
 
 inline size_t TextureStore::TileSwapper::get_peak_memory_size() const
@@ -307,6 +440,16 @@ inline size_t TextureStore::TileSwapper::get_peak_memory_size() const
     return m_peak_memory_size;
 }
 
+inline foundation::uint64 TextureStore::TileSwapper::get_loaded_tile_count() const
+{
+    return m_loaded_tile_count;
+}
+
+inline foundation::uint64 TextureStore::TileSwapper::get_loaded_memory_size() const
+{
+    return m_loaded_memory_size;
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_TEXTURING_TEXTURESTORE_H
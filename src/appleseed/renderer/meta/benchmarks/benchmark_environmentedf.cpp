@@ -0,0 +1,225 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/tracer.h"
+#include "renderer/kernel/rendering/rendererservices.h"
+#include "renderer/kernel/shading/oslshadergroupexec.h"
+#include "renderer/kernel/shading/shadingcontext.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/entity/onframebeginrecorder.h"
+#include "renderer/modeling/environment/environment.h"
+#include "renderer/modeling/environmentedf/environmentedf.h"
+#include "renderer/modeling/environmentedf/hosekenvironmentedf.h"
+#include "renderer/modeling/environmentedf/preethamenvironmentedf.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/benchmark.h"
+
+// OSL headers.
+#include "foundation/platform/oslheaderguards.h"
+BEGIN_OSL_INCLUDES
+#include "OSL/oslexec.h"
+END_OSL_INCLUDES
+
+// OpenImageIO headers.
+#include "foundation/platform/oiioheaderguards.h"
+BEGIN_OIIO_INCLUDES
+#include "OpenImageIO/texture.h"
+END_OIIO_INCLUDES
+
+// Boost headers.
+#include "boost/bind.hpp"
+#include "boost/shared_ptr.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+BENCHMARK_SUITE(Renderer_Modeling_EnvironmentEDF_SkyModels)
+{
+    template <typename Factory, bool BakeRadianceTable>
+    struct Fixture
+      : public TestFixtureBase
+    {
+        static const size_t DirectionCount = 256;
+
+        EnvironmentEDF*                             m_env_edf;
+        OnFrameBeginRecorder                        m_recorder;
+        auto_ptr<TextureStore>                      m_texture_store;
+        auto_ptr<TextureCache>                      m_texture_cache;
+        boost::shared_ptr<OIIO::TextureSystem>      m_texture_system;
+        auto_ptr<RendererServices>                  m_renderer_services;
+        boost::shared_ptr<OSL::ShadingSystem>       m_shading_system;
+        auto_ptr<Intersector>                       m_intersector;
+        Arena                                       m_arena;
+        auto_ptr<OSLShaderGroupExec>                m_sg_exec;
+        auto_ptr<Tracer>                            m_tracer;
+        auto_ptr<ShadingContext>                    m_shading_context;
+        vector<Vector3f>                            m_directions;
+        vector<Vector2f>                            m_samples;
+        float                                       m_sum;
+
+        Fixture()
+          : m_sum(0.0f)
+        {
+            auto_release_ptr<EnvironmentEDF> env_edf(
+                Factory().create(
+                    "env_edf",
+                    ParamArray()
+                        .insert("sun_theta", 40.0f)
+                        .insert("sun_phi", 30.0f)
+                        .insert("turbidity", 1.0f)
+                        .insert("bake_radiance_table", BakeRadianceTable)));
+            m_env_edf = env_edf.get();
+            m_scene.environment_edfs().insert(env_edf);
+
+            auto_release_ptr<Environment> environment(
+                EnvironmentFactory().create(
+                    "environment",
+                    ParamArray().insert("environment_edf", "env_edf")));
+            m_scene.set_environment(environment);
+
+            bind_inputs();
+
+            m_env_edf->on_frame_begin(m_project, &m_scene, m_recorder);
+
+            m_texture_store.reset(new TextureStore(m_scene));
+            m_texture_cache.reset(new TextureCache(*m_texture_store));
+            m_texture_system.reset(
+                OIIO::TextureSystem::create(),
+                boost::bind(&OIIO::TextureSystem::destroy, _1));
+            m_renderer_services.reset(new RendererServices(m_project, *m_texture_system));
+            m_shading_system.reset(new OSL::ShadingSystem(m_renderer_services.get(), m_texture_system.get()));
+            m_intersector.reset(new Intersector(m_project.get_trace_context(), *m_texture_cache));
+            m_sg_exec.reset(new OSLShaderGroupExec(*m_shading_system, m_arena));
+            m_tracer.reset(new Tracer(m_scene, *m_intersector, *m_texture_cache, *m_sg_exec));
+            m_shading_context.reset(
+                new ShadingContext(
+                    *m_intersector,
+                    *m_tracer,
+                    *m_texture_cache,
+                    *m_texture_system,
+                    *m_sg_exec,
+                    m_arena,
+                    0));
+
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < DirectionCount; ++i)
+            {
+                Vector2f s;
+                s[0] = rand_float2(rng);
+                s[1] = rand_float2(rng);
+                m_samples.push_back(s);
+                m_directions.push_back(sample_hemisphere_uniform(s));
+            }
+        }
+
+        ~Fixture()
+        {
+            m_recorder.on_frame_end(m_project);
+        }
+
+        void evaluate()
+        {
+            for (size_t i = 0; i < DirectionCount; ++i)
+            {
+                Spectrum value(Spectrum::Illuminance);
+                m_env_edf->evaluate(*m_shading_context, m_directions[i], value);
+                m_sum += value[0];
+            }
+        }
+
+        void sample()
+        {
+            for (size_t i = 0; i < DirectionCount; ++i)
+            {
+                Vector3f outgoing;
+                Spectrum value(Spectrum::Illuminance);
+                float probability;
+                m_env_edf->sample(*m_shading_context, m_samples[i], outgoing, value, probability);
+                m_sum += value[0] * probability;
+            }
+        }
+    };
+
+    typedef Fixture<HosekEnvironmentEDFFactory, false> AnalyticHosekFixture;
+    typedef Fixture<HosekEnvironmentEDFFactory, true> BakedHosekFixture;
+    typedef Fixture<PreethamEnvironmentEDFFactory, false> AnalyticPreethamFixture;
+    typedef Fixture<PreethamEnvironmentEDFFactory, true> BakedPreethamFixture;
+
+    BENCHMARK_CASE_F(HosekEnvironmentEDF_Evaluate_Analytic, AnalyticHosekFixture)
+    {
+        evaluate();
+    }
+
+    BENCHMARK_CASE_F(HosekEnvironmentEDF_Evaluate_RadianceTable, BakedHosekFixture)
+    {
+        evaluate();
+    }
+
+    BENCHMARK_CASE_F(HosekEnvironmentEDF_Sample_Analytic, AnalyticHosekFixture)
+    {
+        sample();
+    }
+
+    BENCHMARK_CASE_F(HosekEnvironmentEDF_Sample_RadianceTable, BakedHosekFixture)
+    {
+        sample();
+    }
+
+    BENCHMARK_CASE_F(PreethamEnvironmentEDF_Evaluate_Analytic, AnalyticPreethamFixture)
+    {
+        evaluate();
+    }
+
+    BENCHMARK_CASE_F(PreethamEnvironmentEDF_Evaluate_RadianceTable, BakedPreethamFixture)
+    {
+        evaluate();
+    }
+}
@@ -27,19 +27,34 @@
 //
 
 // appleseed.renderer headers.
+#include "renderer/kernel/rendering/globalsampleaccumulationbuffer.h"
 #include "renderer/kernel/rendering/localsampleaccumulationbuffer.h"
+#include "renderer/kernel/rendering/sample.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/color.h"
 #include "foundation/image/filteredtile.h"
 #include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
 #include "foundation/math/aabb.h"
 #include "foundation/math/filter.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/benchmark.h"
+#include "foundation/utility/job/abortswitch.h"
+
+// Boost headers.
+#include "boost/bind.hpp"
+#include "boost/thread/thread.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
 
 using namespace foundation;
 using namespace renderer;
+using namespace std;
 
 BENCHMARK_SUITE(Renderer_Kernel_Rendering_LocalSampleAccumulationBuffer)
 {
@@ -100,3 +115,60 @@ BENCHMARK_SUITE(Renderer_Kernel_Rendering_LocalSampleAccumulationBuffer)
             m_rect);
     }
 }
+
+BENCHMARK_SUITE(Renderer_Kernel_Rendering_GlobalSampleAccumulationBuffer)
+{
+    const size_t ThreadCount = 4;
+    const size_t SampleCount = 4096;
+
+    struct Fixture
+    {
+        BlackmanHarrisFilter2<float>    m_filter;
+        GlobalSampleAccumulationBuffer  m_buffer;
+        vector<Sample>                  m_samples[ThreadCount];
+        AbortSwitch                     m_abort_switch;
+
+        Fixture()
+          : m_filter(1.5f, 1.5f)
+          , m_buffer(512, 512, m_filter)
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < ThreadCount; ++i)
+            {
+                m_samples[i].resize(SampleCount);
+
+                for (size_t j = 0; j < SampleCount; ++j)
+                {
+                    Sample& sample = m_samples[i][j];
+                    sample.m_position = rand_vector2<Vector2f>(rng);
+                    sample.m_color = Color4f(0.5f, 0.6f, 0.7f, 1.0f);
+                }
+            }
+        }
+
+        void store_samples(const size_t thread_index)
+        {
+            m_buffer.store_samples(
+                SampleCount,
+                &m_samples[thread_index][0],
+                m_abort_switch);
+        }
+    };
+
+    BENCHMARK_CASE_F(StoreSamples_SingleThread, Fixture)
+    {
+        for (size_t i = 0; i < ThreadCount; ++i)
+            store_samples(i);
+    }
+
+    BENCHMARK_CASE_F(StoreSamples_MultipleThreads, Fixture)
+    {
+        boost::thread_group threads;
+
+        for (size_t i = 0; i < ThreadCount; ++i)
+            threads.create_thread(boost::bind(&Fixture::store_samples, this, i));
+
+        threads.join_all();
+    }
+}
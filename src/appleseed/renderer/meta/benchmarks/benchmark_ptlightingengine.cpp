@@ -0,0 +1,241 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/ilightingengine.h"
+#include "renderer/kernel/lighting/lightsampler.h"
+#include "renderer/kernel/lighting/pt/ptlightingengine.h"
+#include "renderer/kernel/lighting/tracer.h"
+#include "renderer/kernel/rendering/pixelcontext.h"
+#include "renderer/kernel/rendering/rendererservices.h"
+#include "renderer/kernel/shading/oslshadergroupexec.h"
+#include "renderer/kernel/shading/shadingcontext.h"
+#include "renderer/kernel/shading/shadingpoint.h"
+#include "renderer/kernel/shading/shadingray.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/camera/camera.h"
+#include "renderer/modeling/entity/onframebeginrecorder.h"
+#include "renderer/modeling/frame/frame.h"
+#include "renderer/modeling/input/inputbinder.h"
+#include "renderer/modeling/project-builtin/cornellboxproject.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/image.h"
+#include "foundation/math/dual.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/benchmark.h"
+
+// OSL headers.
+#include "foundation/platform/oslheaderguards.h"
+BEGIN_OSL_INCLUDES
+#include "OSL/oslexec.h"
+END_OSL_INCLUDES
+
+// OpenImageIO headers.
+#include "foundation/platform/oiioheaderguards.h"
+BEGIN_OIIO_INCLUDES
+#include "OpenImageIO/texture.h"
+END_OIIO_INCLUDES
+
+// Boost headers.
+#include "boost/bind.hpp"
+#include "boost/shared_ptr.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+BENCHMARK_SUITE(Renderer_Kernel_Lighting_PTLightingEngine)
+{
+    // Render a small, fixed block of pixels of the built-in Cornell Box scene
+    // by tracing camera rays and calling the path tracer directly at each hit.
+    // This exercises the full path of ShadingPoint construction, on-demand
+    // attribute computation and shading along every path vertex.
+    template <bool NextEventEstimation>
+    struct Fixture
+    {
+        static const size_t BlockSize = 16;
+
+        auto_release_ptr<Project>                   m_project;
+        Scene*                                      m_scene;
+        Camera*                                     m_camera;
+        OnFrameBeginRecorder                        m_recorder;
+        auto_ptr<TextureStore>                      m_texture_store;
+        auto_ptr<TextureCache>                      m_texture_cache;
+        boost::shared_ptr<OIIO::TextureSystem>      m_texture_system;
+        auto_ptr<RendererServices>                  m_renderer_services;
+        boost::shared_ptr<OSL::ShadingSystem>       m_shading_system;
+        auto_ptr<Intersector>                       m_intersector;
+        Arena                                       m_arena;
+        auto_ptr<OSLShaderGroupExec>                m_sg_exec;
+        auto_ptr<Tracer>                            m_tracer;
+        auto_ptr<LightSampler>                      m_light_sampler;
+        auto_ptr<PTLightingEngineFactory>           m_lighting_engine_factory;
+        ILightingEngine*                            m_lighting_engine;
+        auto_ptr<ShadingContext>                    m_shading_context;
+        size_t                                      m_pass;
+        float                                       m_sum;
+
+        Fixture()
+          : m_project(CornellBoxProjectFactory::create())
+          , m_scene(m_project->get_scene())
+          , m_lighting_engine(0)
+          , m_pass(0)
+          , m_sum(0.0f)
+        {
+            InputBinder input_binder;
+            input_binder.bind(*m_scene);
+
+            m_project->update_trace_context();
+
+            m_texture_store.reset(new TextureStore(*m_scene));
+            m_texture_cache.reset(new TextureCache(*m_texture_store));
+            m_texture_system.reset(
+                OIIO::TextureSystem::create(),
+                boost::bind(&OIIO::TextureSystem::destroy, _1));
+            m_renderer_services.reset(new RendererServices(m_project.ref(), *m_texture_system));
+            m_shading_system.reset(new OSL::ShadingSystem(m_renderer_services.get(), m_texture_system.get()));
+
+            m_scene->on_render_begin(m_project.ref());
+
+            m_intersector.reset(new Intersector(m_project->get_trace_context(), *m_texture_cache));
+            m_sg_exec.reset(new OSLShaderGroupExec(*m_shading_system, m_arena));
+            m_tracer.reset(new Tracer(*m_scene, *m_intersector, *m_texture_cache, *m_sg_exec));
+            m_light_sampler.reset(new LightSampler(*m_scene));
+            m_lighting_engine_factory.reset(
+                new PTLightingEngineFactory(
+                    *m_light_sampler,
+                    ParamArray()
+                        .insert("next_event_estimation", NextEventEstimation)
+                        .insert("max_bounces", 4)));
+            m_lighting_engine = m_lighting_engine_factory->create();
+            m_shading_context.reset(
+                new ShadingContext(
+                    *m_intersector,
+                    *m_tracer,
+                    *m_texture_cache,
+                    *m_texture_system,
+                    *m_sg_exec,
+                    m_arena,
+                    0,
+                    m_lighting_engine));
+
+            m_scene->on_frame_begin(m_project.ref(), 0, m_recorder);
+
+            m_camera = m_scene->get_active_camera();
+        }
+
+        ~Fixture()
+        {
+            m_recorder.on_frame_end(m_project.ref());
+            m_lighting_engine->release();
+            m_scene->on_render_end(m_project.ref());
+        }
+
+        void render_block()
+        {
+            const CanvasProperties& props = m_project->get_frame()->image().properties();
+            const size_t origin_x = (props.m_canvas_width - BlockSize) / 2;
+            const size_t origin_y = (props.m_canvas_height - BlockSize) / 2;
+            const Vector2d ndc_dx(1.0 / props.m_canvas_width, 0.0);
+            const Vector2d ndc_dy(0.0, -1.0 / props.m_canvas_height);
+
+            SamplingContext::RNGType rng;
+
+            for (size_t y = 0; y < BlockSize; ++y)
+            {
+                for (size_t x = 0; x < BlockSize; ++x)
+                {
+                    const Vector2i pi(
+                        static_cast<int>(origin_x + x),
+                        static_cast<int>(origin_y + y));
+                    const Vector2d ndc(
+                        (pi.x + 0.5) * props.m_rcp_canvas_width,
+                        (pi.y + 0.5) * props.m_rcp_canvas_height);
+
+                    SamplingContext sampling_context(
+                        rng,
+                        SamplingContext::QMCMode,
+                        2,
+                        0,
+                        m_pass * BlockSize * BlockSize + y * BlockSize + x);
+
+                    ShadingRay ray;
+                    m_camera->spawn_ray(
+                        sampling_context,
+                        Dual2d(ndc, ndc_dx, ndc_dy),
+                        ray);
+
+                    ShadingPoint shading_point;
+                    m_intersector->trace(ray, shading_point);
+
+                    if (!shading_point.hit())
+                        continue;
+
+                    Spectrum radiance(0.0f, Spectrum::Illuminance);
+                    m_lighting_engine->compute_lighting(
+                        sampling_context,
+                        PixelContext(pi, ndc),
+                        *m_shading_context,
+                        shading_point,
+                        radiance);
+
+                    m_sum += radiance[0];
+                }
+            }
+
+            ++m_pass;
+        }
+    };
+
+    typedef Fixture<true> NextEventEstimationFixture;
+    typedef Fixture<false> BrdfSamplingOnlyFixture;
+
+    BENCHMARK_CASE_F(ComputeLighting_NextEventEstimation, NextEventEstimationFixture)
+    {
+        render_block();
+    }
+
+    BENCHMARK_CASE_F(ComputeLighting_BRDFSamplingOnly, BrdfSamplingOnlyFixture)
+    {
+        render_block();
+    }
+}
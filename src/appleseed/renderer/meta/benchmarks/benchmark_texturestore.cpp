@@ -0,0 +1,142 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/input/texturesource.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/modeling/scene/textureinstance.h"
+#include "renderer/modeling/texture/disktexture2d.h"
+#include "renderer/modeling/texture/texture.h"
+#include "renderer/utility/paramarray.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/benchmark.h"
+#include "foundation/utility/searchpaths.h"
+#include "foundation/utility/statistics.h"
+#include "foundation/utility/uid.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+BENCHMARK_SUITE(Renderer_Kernel_Texturing_TextureStore)
+{
+    template <bool Mipmaps>
+    struct Fixture
+      : public TestFixtureBase
+    {
+        auto_ptr<TextureStore>  m_texture_store;
+        auto_ptr<TextureCache>  m_texture_cache;
+        auto_ptr<TextureSource> m_texture_source;
+        Vector2f                m_duvdx;
+        Vector2f                m_duvdy;
+        Color3f                 m_sum;
+
+        Fixture()
+          : m_duvdx(1.0f / 32, 0.0f)        // footprint of a distant, minified surface
+          , m_duvdy(0.0f, 1.0f / 32)
+          , m_sum(0.0f)
+        {
+            m_scene.textures().insert(
+                DiskTexture2dFactory().create(
+                    "texture",
+                    ParamArray()
+                        .insert("filename", "unit benchmarks/inputs/test_mipmap_rgb.exr")
+                        .insert("color_space", "linear_rgb")
+                        .insert("mipmaps", Mipmaps ? "true" : "false"),
+                    SearchPaths()));
+
+            create_texture_instance("texture_instance", "texture");
+
+            bind_inputs();
+
+            m_texture_store.reset(new TextureStore(m_scene));
+            m_texture_cache.reset(new TextureCache(*m_texture_store));
+            m_texture_source.reset(
+                new TextureSource(
+                    ~UniqueID(0),
+                    *m_scene.texture_instances().get_by_name("texture_instance")));
+        }
+
+        ~Fixture()
+        {
+            // Report the amount of texture data loaded, including generated MIP tiles.
+            RENDERER_LOG_INFO("%s", m_texture_store->get_statistics().to_string().c_str());
+        }
+    };
+
+    template <bool Mipmaps>
+    void sample_texture(Fixture<Mipmaps>& fixture)
+    {
+        const size_t GridSize = 16;
+
+        for (size_t y = 0; y < GridSize; ++y)
+        {
+            for (size_t x = 0; x < GridSize; ++x)
+            {
+                const Vector2f uv(
+                    (x + 0.5f) / GridSize,
+                    (y + 0.5f) / GridSize);
+
+                Color3f color;
+                fixture.m_texture_source->evaluate(
+                    *fixture.m_texture_cache,
+                    uv,
+                    fixture.m_duvdx,
+                    fixture.m_duvdy,
+                    color);
+
+                fixture.m_sum += color;
+            }
+        }
+    }
+
+    BENCHMARK_CASE_F(SampleMinifiedTexture_WithoutMipmaps, Fixture<false>)
+    {
+        sample_texture(*this);
+    }
+
+    BENCHMARK_CASE_F(SampleMinifiedTexture_WithMipmaps, Fixture<true>)
+    {
+        sample_texture(*this);
+    }
+}
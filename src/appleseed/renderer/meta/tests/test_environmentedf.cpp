@@ -41,8 +41,11 @@
 #include "renderer/modeling/environmentedf/constantenvironmentedf.h"
 #include "renderer/modeling/environmentedf/environmentedf.h"
 #include "renderer/modeling/environmentedf/gradientenvironmentedf.h"
+#include "renderer/modeling/environmentedf/hosekenvironmentedf.h"
 #include "renderer/modeling/environmentedf/latlongmapenvironmentedf.h"
 #include "renderer/modeling/environmentedf/mirrorballmapenvironmentedf.h"
+#include "renderer/modeling/environmentedf/preethamenvironmentedf.h"
+#include "renderer/modeling/project/project.h"
 #include "renderer/modeling/scene/containers.h"
 #include "renderer/modeling/scene/scene.h"
 #include "renderer/modeling/texture/texture.h"
@@ -50,11 +53,14 @@
 #include "renderer/utility/testutils.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/image/canvasproperties.h"
 #include "foundation/image/color.h"
 #include "foundation/image/colorspace.h"
 #include "foundation/image/pixel.h"
+#include "foundation/image/regularspectrum.h"
 #include "foundation/image/tile.h"
+#include "foundation/math/sampling/mappings.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/arena.h"
@@ -79,6 +85,7 @@ END_OIIO_INCLUDES
 
 // Standard headers.
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <memory>
 
@@ -166,6 +173,51 @@ TEST_SUITE(Renderer_Modeling_EnvironmentEDF)
         }
     };
 
+    // All the objects needed to evaluate and sample environment EDFs.
+    class ShadingContextHolder
+      : public NonCopyable
+    {
+      public:
+        explicit ShadingContextHolder(Project& project)
+          : m_texture_store(*project.get_scene())
+          , m_texture_cache(m_texture_store)
+          , m_texture_system(
+                OIIO::TextureSystem::create(),
+                boost::bind(&OIIO::TextureSystem::destroy, _1))
+          , m_renderer_services(project, *m_texture_system)
+          , m_shading_system(new OSL::ShadingSystem(&m_renderer_services, m_texture_system.get()))
+          , m_intersector(project.get_trace_context(), m_texture_cache)
+          , m_sg_exec(*m_shading_system, m_arena)
+          , m_tracer(*project.get_scene(), m_intersector, m_texture_cache, m_sg_exec)
+          , m_shading_context(
+                m_intersector,
+                m_tracer,
+                m_texture_cache,
+                *m_texture_system,
+                m_sg_exec,
+                m_arena,
+                0)
+        {
+        }
+
+        const ShadingContext& get() const
+        {
+            return m_shading_context;
+        }
+
+      private:
+        TextureStore                                m_texture_store;
+        TextureCache                                m_texture_cache;
+        boost::shared_ptr<OIIO::TextureSystem>      m_texture_system;
+        RendererServices                            m_renderer_services;
+        boost::shared_ptr<OSL::ShadingSystem>       m_shading_system;
+        Intersector                                 m_intersector;
+        Arena                                       m_arena;
+        OSLShaderGroupExec                          m_sg_exec;
+        Tracer                                      m_tracer;
+        ShadingContext                              m_shading_context;
+    };
+
     struct Fixture
       : public TestFixtureBase
     {
@@ -176,13 +228,18 @@ TEST_SUITE(Renderer_Modeling_EnvironmentEDF)
                     new HorizontalGradientTexture(name)));
         }
 
-        bool check_consistency(EnvironmentEDF& env_edf)
+        void set_environment_edf(const EnvironmentEDF& env_edf)
         {
             auto_release_ptr<Environment> environment(
                 EnvironmentFactory().create(
                     "environment", ParamArray().insert("environment_edf", env_edf.get_name())));
 
             m_scene.set_environment(environment);
+        }
+
+        bool check_consistency(EnvironmentEDF& env_edf)
+        {
+            set_environment_edf(env_edf);
 
             bind_inputs();
 
@@ -190,41 +247,8 @@ TEST_SUITE(Renderer_Modeling_EnvironmentEDF)
             APPLESEED_UNUSED const bool success = env_edf.on_frame_begin(m_project, &m_scene, recorder);
             assert(success);
 
-            TextureStore texture_store(m_scene);
-            TextureCache texture_cache(texture_store);
-
-            boost::shared_ptr<OIIO::TextureSystem> texture_system(
-                OIIO::TextureSystem::create(),
-                boost::bind(&OIIO::TextureSystem::destroy, _1));
-
-            RendererServices renderer_services(
-                m_project,
-                *texture_system);
-
-            boost::shared_ptr<OSL::ShadingSystem> shading_system(
-                new OSL::ShadingSystem(&renderer_services, texture_system.get()));
-
-            Intersector intersector(
-                m_project.get_trace_context(),
-                texture_cache);
-
-            Arena arena;
-            OSLShaderGroupExec sg_exec(*shading_system, arena);
-
-            Tracer tracer(
-                m_scene,
-                intersector,
-                texture_cache,
-                sg_exec);
-
-            ShadingContext shading_context(
-                intersector,
-                tracer,
-                texture_cache,
-                *texture_system,
-                sg_exec,
-                arena,
-                0);
+            ShadingContextHolder shading_context_holder(m_project);
+            const ShadingContext& shading_context = shading_context_holder.get();
 
             Vector3f outgoing;
             Spectrum value1(Spectrum::Illuminance);
@@ -250,6 +274,70 @@ TEST_SUITE(Renderer_Modeling_EnvironmentEDF)
 
             return consistent;
         }
+
+        static ParamArray sky_params(const bool bake_radiance_table)
+        {
+            return
+                ParamArray()
+                    .insert("sun_theta", 40.0f)
+                    .insert("sun_phi", 30.0f)
+                    .insert("turbidity", 1.0f)
+                    .insert("bake_radiance_table", bake_radiance_table);
+        }
+
+        static float compute_luminance(const Spectrum& value)
+        {
+            return sum_value(value * Spectrum(XYZCMFCIE19312Deg[1]));
+        }
+
+        // Return the average relative error of the baked sky with respect to the analytic sky.
+        float compute_radiance_table_error(
+            EnvironmentEDF&     analytic_env_edf,
+            EnvironmentEDF&     baked_env_edf)
+        {
+            set_environment_edf(baked_env_edf);
+
+            bind_inputs();
+
+            OnFrameBeginRecorder recorder;
+            APPLESEED_UNUSED bool success;
+            success = analytic_env_edf.on_frame_begin(m_project, &m_scene, recorder);
+            assert(success);
+            success = baked_env_edf.on_frame_begin(m_project, &m_scene, recorder);
+            assert(success);
+
+            ShadingContextHolder shading_context_holder(m_project);
+            const ShadingContext& shading_context = shading_context_holder.get();
+
+            const size_t GridSize = 64;
+            float error = 0.0f;
+
+            for (size_t y = 0; y < GridSize; ++y)
+            {
+                for (size_t x = 0; x < GridSize; ++x)
+                {
+                    // Stay a few degrees above the horizon where the sky is discontinuous.
+                    const Vector2f s(
+                        (x + 0.5f) / GridSize,
+                        0.9f * (y + 0.5f) / GridSize);
+                    const Vector3f outgoing = sample_hemisphere_uniform(s);
+
+                    Spectrum analytic_value(Spectrum::Illuminance);
+                    analytic_env_edf.evaluate(shading_context, outgoing, analytic_value);
+
+                    Spectrum baked_value(Spectrum::Illuminance);
+                    baked_env_edf.evaluate(shading_context, outgoing, baked_value);
+
+                    const float analytic_luminance = compute_luminance(analytic_value);
+                    const float baked_luminance = compute_luminance(baked_value);
+                    error += abs(baked_luminance - analytic_luminance) / analytic_luminance;
+                }
+            }
+
+            recorder.on_frame_end(m_project);
+
+            return error / (GridSize * GridSize);
+        }
     };
 
     TEST_CASE_F(CheckConstantEnvironmentEDFConsistency, Fixture)
@@ -320,4 +408,60 @@ TEST_SUITE(Renderer_Modeling_EnvironmentEDF)
 
         EXPECT_TRUE(consistent);
     }
+
+    TEST_CASE_F(CheckHosekEnvironmentEDFConsistency_WithRadianceTable, Fixture)
+    {
+        auto_release_ptr<EnvironmentEDF> env_edf(
+            HosekEnvironmentEDFFactory().create("env_edf", sky_params(true)));
+        EnvironmentEDF& env_edf_ref = env_edf.ref();
+        m_scene.environment_edfs().insert(env_edf);
+
+        const bool consistent = check_consistency(env_edf_ref);
+
+        EXPECT_TRUE(consistent);
+    }
+
+    TEST_CASE_F(CheckPreethamEnvironmentEDFConsistency_WithRadianceTable, Fixture)
+    {
+        auto_release_ptr<EnvironmentEDF> env_edf(
+            PreethamEnvironmentEDFFactory().create("env_edf", sky_params(true)));
+        EnvironmentEDF& env_edf_ref = env_edf.ref();
+        m_scene.environment_edfs().insert(env_edf);
+
+        const bool consistent = check_consistency(env_edf_ref);
+
+        EXPECT_TRUE(consistent);
+    }
+
+    TEST_CASE_F(HosekEnvironmentEDFRadianceTable_MatchesAnalyticModel, Fixture)
+    {
+        auto_release_ptr<EnvironmentEDF> analytic_env_edf(
+            HosekEnvironmentEDFFactory().create("analytic_env_edf", sky_params(false)));
+        auto_release_ptr<EnvironmentEDF> baked_env_edf(
+            HosekEnvironmentEDFFactory().create("baked_env_edf", sky_params(true)));
+        EnvironmentEDF& analytic_env_edf_ref = analytic_env_edf.ref();
+        EnvironmentEDF& baked_env_edf_ref = baked_env_edf.ref();
+        m_scene.environment_edfs().insert(analytic_env_edf);
+        m_scene.environment_edfs().insert(baked_env_edf);
+
+        const float error = compute_radiance_table_error(analytic_env_edf_ref, baked_env_edf_ref);
+
+        EXPECT_LT(0.01f, error);
+    }
+
+    TEST_CASE_F(PreethamEnvironmentEDFRadianceTable_MatchesAnalyticModel, Fixture)
+    {
+        auto_release_ptr<EnvironmentEDF> analytic_env_edf(
+            PreethamEnvironmentEDFFactory().create("analytic_env_edf", sky_params(false)));
+        auto_release_ptr<EnvironmentEDF> baked_env_edf(
+            PreethamEnvironmentEDFFactory().create("baked_env_edf", sky_params(true)));
+        EnvironmentEDF& analytic_env_edf_ref = analytic_env_edf.ref();
+        EnvironmentEDF& baked_env_edf_ref = baked_env_edf.ref();
+        m_scene.environment_edfs().insert(analytic_env_edf);
+        m_scene.environment_edfs().insert(baked_env_edf);
+
+        const float error = compute_radiance_table_error(analytic_env_edf_ref, baked_env_edf_ref);
+
+        EXPECT_LT(0.01f, error);
+    }
 }
@@ -0,0 +1,174 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lightsampler.h"
+#include "renderer/kernel/lighting/lighttree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_LightTree)
+{
+    EmittingTriangle make_triangle(
+        const Vector3d&     center,
+        const Vector3d&     normal)
+    {
+        // An isosceles right triangle of unit area lying in the plane orthogonal to normal.
+        const Vector3d u = normalize(
+            std::abs(normal[0]) < 0.9
+                ? cross(normal, Vector3d(1.0, 0.0, 0.0))
+                : cross(normal, Vector3d(0.0, 1.0, 0.0)));
+        const Vector3d v = cross(normal, u);
+
+        EmittingTriangle triangle;
+        triangle.m_v0 = center;
+        triangle.m_v1 = center + 1.4142135623730951 * u;
+        triangle.m_v2 = center + 1.4142135623730951 * v;
+        triangle.m_n0 = triangle.m_n1 = triangle.m_n2 = normal;
+        triangle.m_geometric_normal = normal;
+        triangle.m_area = 1.0f;
+        triangle.m_rcp_area = 1.0f;
+        triangle.m_triangle_prob = 0.0f;
+        return triangle;
+    }
+
+    struct Fixture
+    {
+        vector<EmittingTriangle>    m_triangles;
+        vector<float>               m_importances;
+
+        Fixture()
+        {
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < 100; ++i)
+            {
+                const Vector3d center(
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0),
+                    rand_double1(rng, -10.0, 10.0));
+
+                const Vector3d normal =
+                    normalize(
+                        Vector3d(
+                            rand_double1(rng, -1.0, 1.0),
+                            rand_double1(rng, -1.0, 1.0),
+                            rand_double1(rng, -1.0, 1.0)));
+
+                m_triangles.push_back(make_triangle(center, normal));
+                m_importances.push_back(rand_float1(rng, 0.5f, 2.0f));
+            }
+        }
+    };
+
+    TEST_CASE(Constructor_GivenNoTriangles_BuildsEmptyTree)
+    {
+        const LightTree tree((vector<EmittingTriangle>()), vector<float>());
+
+        EXPECT_TRUE(tree.empty());
+    }
+
+    TEST_CASE_F(Constructor_BuildsOneLeafPerTriangle, Fixture)
+    {
+        const LightTree tree(m_triangles, m_importances);
+
+        EXPECT_EQ(2 * m_triangles.size() - 1, tree.get_node_count());
+    }
+
+    TEST_CASE_F(EvaluatePdf_SumsToOneOverAllTriangles, Fixture)
+    {
+        const LightTree tree(m_triangles, m_importances);
+        const Vector3d point(1.0, 2.0, 3.0);
+
+        float sum = 0.0f;
+
+        for (size_t i = 0; i < m_triangles.size(); ++i)
+            sum += tree.evaluate_pdf(point, i);
+
+        EXPECT_FEQ_EPS(1.0f, sum, 1.0e-4f);
+    }
+
+    TEST_CASE_F(Sample_ReturnsProbabilityMatchingEvaluatePdf, Fixture)
+    {
+        const LightTree tree(m_triangles, m_importances);
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const Vector3d point(
+                rand_double1(rng, -20.0, 20.0),
+                rand_double1(rng, -20.0, 20.0),
+                rand_double1(rng, -20.0, 20.0));
+
+            const LightTree::ItemProbabilityPair result = tree.sample(point, rand_float2(rng));
+
+            EXPECT_GT(0.0f, result.second);
+            EXPECT_FEQ_EPS(tree.evaluate_pdf(point, result.first), result.second, 1.0e-4f);
+        }
+    }
+
+    TEST_CASE(EvaluatePdf_GivenPointCloseToTriangle_FavorsThatTriangle)
+    {
+        vector<EmittingTriangle> triangles;
+        triangles.push_back(make_triangle(Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, 1.0, 0.0)));
+        triangles.push_back(make_triangle(Vector3d(100.0, 0.0, 0.0), Vector3d(0.0, 1.0, 0.0)));
+
+        const LightTree tree(triangles, vector<float>(2, 1.0f));
+        const Vector3d point(0.0, 1.0, 0.0);
+
+        EXPECT_GT(0.99f, tree.evaluate_pdf(point, 0));
+    }
+
+    TEST_CASE(EvaluatePdf_GivenTriangleFacingAwayFromPoint_ReturnsZero)
+    {
+        vector<EmittingTriangle> triangles;
+        triangles.push_back(make_triangle(Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, 1.0, 0.0)));
+        triangles.push_back(make_triangle(Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, -1.0, 0.0)));
+
+        const LightTree tree(triangles, vector<float>(2, 1.0f));
+        const Vector3d point(0.0, 10.0, 0.0);
+
+        EXPECT_EQ(1.0f, tree.evaluate_pdf(point, 0));
+        EXPECT_EQ(0.0f, tree.evaluate_pdf(point, 1));
+    }
+}
@@ -28,6 +28,9 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/rendering/localsampleaccumulationbuffer.h"
+#include "renderer/kernel/rendering/sample.h"
+#include "renderer/modeling/frame/frame.h"
+#include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
 #include "foundation/image/color.h"
@@ -38,11 +41,13 @@
 #include "foundation/math/rng/distribution.h"
 #include "foundation/math/rng/mersennetwister.h"
 #include "foundation/math/vector.h"
+#include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/job.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 using namespace foundation;
 using namespace renderer;
@@ -153,4 +158,108 @@ TEST_SUITE(Renderer_Kernel_Rendering_LocalSampleAccumulationBuffer)
             EXPECT_TRUE(honors_crop_window(crop_window, false));
         }
     }
+
+    bool develops_full_resolution_level(const bool undo_premultiplied_alpha)
+    {
+        const BoxFilter2<float> filter(0.5f, 0.5f);
+        FilteredTile level(32, 32, 4, filter);
+        level.clear();
+
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            const float values[4] =
+            {
+                rand_float1(rng),
+                rand_float1(rng),
+                rand_float1(rng),
+                rand_int1(rng, 0, 3) == 0 ? 0.0f : rand_float1(rng)
+            };
+
+            level.add(rand_float1(rng, 0.0f, 32.0f), rand_float1(rng, 0.0f, 32.0f), values);
+        }
+
+        Tile color_tile(32, 32, 4, PixelFormatFloat);
+        color_tile.clear(Color4f(0.0f));
+
+        const AABB2u rect(Vector2u(0, 0), Vector2u(31, 31));
+
+        if (undo_premultiplied_alpha)
+            LocalSampleAccumulationBuffer::develop_to_tile_undo_premult_alpha(color_tile, 32, 32, level, 0, 0, rect);
+        else LocalSampleAccumulationBuffer::develop_to_tile(color_tile, 32, 32, level, 0, 0, rect);
+
+        for (size_t y = 0; y < color_tile.get_height(); ++y)
+        {
+            for (size_t x = 0; x < color_tile.get_width(); ++x)
+            {
+                Color4f expected;
+                level.get_pixel(x, y, expected);
+
+                if (undo_premultiplied_alpha)
+                {
+                    const float rcp_alpha = expected.a == 0.0f ? 0.0f : 1.0f / expected.a;
+                    expected.r *= rcp_alpha;
+                    expected.g *= rcp_alpha;
+                    expected.b *= rcp_alpha;
+                }
+
+                Color4f color;
+                color_tile.get_pixel(x, y, color);
+
+                if (color != expected)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    TEST_CASE(DevelopToTile_FullResolutionLevel_MatchesNormalizedLevelPixels)
+    {
+        EXPECT_TRUE(develops_full_resolution_level(true));
+        EXPECT_TRUE(develops_full_resolution_level(false));
+    }
+
+    TEST_CASE(DevelopToFrame_DevelopsOnlyTilesTouchedSinceLastDevelopment)
+    {
+        auto_release_ptr<Frame> frame(
+            FrameFactory::create(
+                "frame",
+                ParamArray()
+                    .insert("resolution", "256 256")
+                    .insert("tile_size", "64 64")));
+
+        const BoxFilter2<float> filter(0.5f, 0.5f);
+        LocalSampleAccumulationBuffer buffer(256, 256, filter);
+        AbortSwitch abort_switch;
+
+        // Initially, all tiles are developed.
+        vector<size_t> developed_tiles;
+        buffer.develop_to_frame(frame.ref(), abort_switch, &developed_tiles);
+        EXPECT_EQ(16, developed_tiles.size());
+
+        // Without new samples, no tile is developed.
+        developed_tiles.clear();
+        buffer.develop_to_frame(frame.ref(), abort_switch, &developed_tiles);
+        EXPECT_TRUE(developed_tiles.empty());
+
+        // A sample in the middle of tile (1, 2) of the coarsest level (32x32 pixels) only touches that tile.
+        Sample sample;
+        sample.m_position = Vector2f(96.0f / 256.0f, 160.0f / 256.0f);
+        sample.m_color = Color4f(1.0f);
+        buffer.store_samples(1, &sample, abort_switch);
+
+        developed_tiles.clear();
+        buffer.develop_to_frame(frame.ref(), abort_switch, &developed_tiles);
+        ASSERT_EQ(1, developed_tiles.size());
+        EXPECT_EQ(2 * 4 + 1, developed_tiles[0]);
+
+        // Clearing the buffer causes all tiles to be developed again.
+        buffer.clear();
+
+        developed_tiles.clear();
+        buffer.develop_to_frame(frame.ref(), abort_switch, &developed_tiles);
+        EXPECT_EQ(16, developed_tiles.size());
+    }
 }
@@ -0,0 +1,167 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/utility/seexprprogram.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// OpenImageIO headers.
+#include "foundation/platform/oiioheaderguards.h"
+BEGIN_OIIO_INCLUDES
+#include "OpenImageIO/texture.h"
+END_OIIO_INCLUDES
+
+// Boost headers.
+#include "boost/bind.hpp"
+#include "boost/shared_ptr.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Utility_SeExprProgram)
+{
+    struct Fixture
+    {
+        boost::shared_ptr<OIIO::TextureSystem>  m_texture_system;
+        SeExprProgram                           m_program;
+        SeExprProgram::Registers                m_registers;
+
+        Fixture()
+          : m_texture_system(
+                OIIO::TextureSystem::create(),
+                boost::bind(&OIIO::TextureSystem::destroy, _1))
+        {
+        }
+
+        Color3f evaluate(const string& expression, const Vector2f& uv = Vector2f(0.0f))
+        {
+            // Expressions that fail to compile evaluate to an impossible color.
+            if (!m_program.add_output(expression))
+                return Color3f(-1.0f);
+
+            Color3f outputs[16];
+            m_program.evaluate(1, &uv, *m_texture_system, m_registers, outputs);
+
+            return outputs[m_program.get_output_count() - 1];
+        }
+    };
+
+    TEST_CASE_F(Evaluate_ScalarConstant_BroadcastsToAllComponents, Fixture)
+    {
+        EXPECT_EQ(Color3f(0.5f), evaluate("0.5"));
+    }
+
+    TEST_CASE_F(Evaluate_VectorConstant, Fixture)
+    {
+        EXPECT_EQ(Color3f(0.1f, 0.2f, 0.3f), evaluate("[0.1, 0.2, 0.3]"));
+    }
+
+    TEST_CASE_F(Evaluate_ArithmeticExpression_RespectsOperatorPrecedence, Fixture)
+    {
+        EXPECT_FEQ(Color3f(7.0f), evaluate("1 + 2 * 3"));
+        EXPECT_FEQ(Color3f(9.0f), evaluate("(1 + 2) * 3"));
+        EXPECT_FEQ(Color3f(-4.0f), evaluate("-2 ^ 2"));
+        EXPECT_FEQ(Color3f(512.0f), evaluate("2 ^ 3 ^ 2"));
+        EXPECT_FEQ(Color3f(0.5f), evaluate("2 ^ -1"));
+        EXPECT_FEQ(Color3f(1.0f), evaluate("8 / 4 / 2"));
+    }
+
+    TEST_CASE_F(Evaluate_ConstantExpression_FoldsToSingleInstruction, Fixture)
+    {
+        EXPECT_FEQ(Color3f(0.25f, 0.5f, 0.75f), evaluate("[1, 2, 3] / 4 * clamp(2, 0, 1)"));
+        EXPECT_EQ(1, m_program.get_instruction_count());
+    }
+
+    TEST_CASE_F(Evaluate_Functions, Fixture)
+    {
+        EXPECT_FEQ(Color3f(2.0f), evaluate("abs(-2)"));
+        EXPECT_FEQ(Color3f(1.0f), evaluate("floor(1.5)"));
+        EXPECT_FEQ(Color3f(2.0f), evaluate("ceil(1.5)"));
+        EXPECT_FEQ(Color3f(1.0f), evaluate("exp(0)"));
+        EXPECT_FEQ(Color3f(8.0f), evaluate("pow(2, 3)"));
+        EXPECT_FEQ(Color3f(1.0f, 2.0f, 2.0f), evaluate("min([1, 2, 3], 2)"));
+        EXPECT_FEQ(Color3f(2.0f, 2.0f, 3.0f), evaluate("max([1, 2, 3], 2)"));
+        EXPECT_FEQ(Color3f(0.25f), evaluate("mix(0, 1, 0.25)"));
+        EXPECT_FEQ(Color3f(0.5f), evaluate("smoothstep(0.5, 0, 1)"));
+        EXPECT_FEQ(Color3f(0.75f), evaluate("invert(0.25)"));
+    }
+
+    TEST_CASE_F(Evaluate_Variables, Fixture)
+    {
+        EXPECT_FEQ(Color3f(0.2f, 0.8f, 1.0f), evaluate("[$u, $v, $u + $v]", Vector2f(0.2f, 0.8f)));
+    }
+
+    TEST_CASE_F(Evaluate_BatchOfPoints, Fixture)
+    {
+        ASSERT_TRUE(m_program.add_output("$u * 2"));
+        ASSERT_TRUE(m_program.add_output("[$v, 0, 1]"));
+
+        const Vector2f uv[3] = { Vector2f(0.0f, 0.1f), Vector2f(0.5f, 0.2f), Vector2f(1.0f, 0.3f) };
+        Color3f outputs[6];
+        m_program.evaluate(3, uv, *m_texture_system, m_registers, outputs);
+
+        EXPECT_FEQ(Color3f(0.0f), outputs[0]);
+        EXPECT_FEQ(Color3f(0.1f, 0.0f, 1.0f), outputs[1]);
+        EXPECT_FEQ(Color3f(1.0f), outputs[2]);
+        EXPECT_FEQ(Color3f(0.2f, 0.0f, 1.0f), outputs[3]);
+        EXPECT_FEQ(Color3f(2.0f), outputs[4]);
+        EXPECT_FEQ(Color3f(0.3f, 0.0f, 1.0f), outputs[5]);
+    }
+
+    TEST_CASE_F(AddOutput_CommonSubexpressions_AreShared, Fixture)
+    {
+        ASSERT_TRUE(m_program.add_output("texture(\"wood.png\", $u, $v) * 0.5"));
+        ASSERT_TRUE(m_program.add_output("texture(\"wood.png\", $u, $v)"));
+        ASSERT_TRUE(m_program.add_output("$u * $v + 1"));
+        ASSERT_TRUE(m_program.add_output("1 + $v * $u"));
+
+        // $u, $v, texture, constant 0.5, multiplication, $u * $v, constant 1, addition.
+        EXPECT_EQ(4, m_program.get_output_count());
+        EXPECT_EQ(8, m_program.get_instruction_count());
+        EXPECT_EQ(1, m_program.get_texture_lookup_count());
+    }
+
+    TEST_CASE_F(AddOutput_UnsupportedExpression_ReturnsFalse, Fixture)
+    {
+        EXPECT_FALSE(m_program.add_output("$P"));
+        EXPECT_FALSE(m_program.add_output("noise($u)"));
+        EXPECT_FALSE(m_program.add_output("a = 1; a"));
+        EXPECT_FALSE(m_program.add_output("1 +"));
+        EXPECT_FALSE(m_program.add_output("texture(\"\", $u, $v)"));
+    }
+}
@@ -0,0 +1,219 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/modeling/environmentedf/skyradiancetable.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/regularspectrum.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Modeling_EnvironmentEDF_SkyRadianceTable)
+{
+    // A smooth sky with a bright circumsolar region, black below the horizon.
+    class SmoothSky
+      : public ISkyRadianceFunction
+    {
+      public:
+        SmoothSky()
+          : m_sun_dir(normalize(Vector3f(0.5f, 0.6f, -0.3f)))
+        {
+        }
+
+        virtual void evaluate(
+            TextureCache&       texture_cache,
+            const Vector3f&     local_outgoing,
+            Spectrum&           value) const APPLESEED_OVERRIDE
+        {
+            value = RegularSpectrum31f(compute_radiance(local_outgoing));
+        }
+
+        float compute_radiance(const Vector3f& local_outgoing) const
+        {
+            if (local_outgoing.y <= 0.0f)
+                return 0.0f;
+
+            const float cos_gamma = dot(local_outgoing, m_sun_dir);
+            return 1.0f + local_outgoing.y + 10.0f * exp(20.0f * (cos_gamma - 1.0f));
+        }
+
+      private:
+        const Vector3f m_sun_dir;
+    };
+
+    struct Fixture
+      : public TestFixtureBase
+    {
+        SmoothSky           m_sky;
+        SkyRadianceTable    m_table;
+
+        Fixture()
+          : m_table(512, 256)
+        {
+            m_table.bake(m_scene, m_sky, 2);
+        }
+    };
+
+    TEST_CASE_F(Evaluate_MatchesSkyModel, Fixture)
+    {
+        MersenneTwister rng;
+
+        float max_rel_error = 0.0f;
+        float sum_rel_error = 0.0f;
+
+        const size_t DirectionCount = 10000;
+
+        for (size_t i = 0; i < DirectionCount; ++i)
+        {
+            // Stay away from the discontinuity at the horizon.
+            Vector2f s;
+            s[0] = rand_float2(rng);
+            s[1] = rand_float2(rng) * 0.95f;
+            const Vector3f outgoing = sample_hemisphere_uniform(s);
+
+            Spectrum value(Spectrum::Illuminance);
+            m_table.evaluate(outgoing, value);
+
+            const float expected = m_sky.compute_radiance(outgoing);
+            const float rel_error = abs(value[0] - expected) / expected;
+
+            max_rel_error = max(max_rel_error, rel_error);
+            sum_rel_error += rel_error;
+        }
+
+        EXPECT_LT(0.005f, max_rel_error);
+        EXPECT_LT(0.0005f, sum_rel_error / DirectionCount);
+    }
+
+    TEST_CASE_F(Sample_ReturnsSameValueAndProbabilityAsEvaluate, Fixture)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            Vector2f s;
+            s[0] = rand_float2(rng);
+            s[1] = rand_float2(rng);
+
+            Vector3f outgoing;
+            Spectrum value1(Spectrum::Illuminance);
+            float probability1;
+            m_table.sample(s, outgoing, value1, probability1);
+
+            EXPECT_TRUE(is_normalized(outgoing));
+            EXPECT_GT(0.0f, outgoing.y);
+            EXPECT_GT(0.0f, probability1);
+
+            Spectrum value2(Spectrum::Illuminance);
+            m_table.evaluate(outgoing, value2);
+            const float probability2 = m_table.evaluate_pdf(outgoing);
+
+            EXPECT_FEQ_EPS(value1[0], value2[0], 1.0e-3f);
+            EXPECT_FEQ_EPS(probability1, probability2, 1.0e-3f);
+        }
+    }
+
+    TEST_CASE_F(EvaluatePdf_IntegratesToOne, Fixture)
+    {
+        MersenneTwister rng;
+
+        const size_t DirectionCount = 100000;
+        double integral = 0.0;
+
+        for (size_t i = 0; i < DirectionCount; ++i)
+        {
+            Vector2f s;
+            s[0] = rand_float2(rng);
+            s[1] = rand_float2(rng);
+            const Vector3f outgoing = sample_sphere_uniform(s);
+
+            integral += m_table.evaluate_pdf(outgoing) / RcpFourPi<float>();
+        }
+
+        integral /= DirectionCount;
+
+        EXPECT_FEQ_EPS(1.0, integral, 0.02);
+    }
+
+    TEST_CASE_F(Sample_FollowsSkyRadiance, Fixture)
+    {
+        // The ratio of radiance to probability density should be much more
+        // uniform than with cosine-weighted hemisphere sampling.
+        MersenneTwister rng;
+
+        const size_t SampleCount = 10000;
+        double table_sum = 0.0, table_sum_sq = 0.0;
+        double cosine_sum = 0.0, cosine_sum_sq = 0.0;
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            Vector2f s;
+            s[0] = rand_float2(rng);
+            s[1] = rand_float2(rng);
+
+            Vector3f outgoing;
+            Spectrum value(Spectrum::Illuminance);
+            float probability;
+            m_table.sample(s, outgoing, value, probability);
+
+            const double table_estimate = value[0] / probability;
+            table_sum += table_estimate;
+            table_sum_sq += table_estimate * table_estimate;
+
+            const Vector3f cosine_outgoing = sample_hemisphere_cosine(s);
+            const double cosine_estimate =
+                m_sky.compute_radiance(cosine_outgoing) / (cosine_outgoing.y * RcpPi<float>());
+            cosine_sum += cosine_estimate;
+            cosine_sum_sq += cosine_estimate * cosine_estimate;
+        }
+
+        const double table_mean = table_sum / SampleCount;
+        const double cosine_mean = cosine_sum / SampleCount;
+        const double table_variance = table_sum_sq / SampleCount - table_mean * table_mean;
+        const double cosine_variance = cosine_sum_sq / SampleCount - cosine_mean * cosine_mean;
+
+        EXPECT_FEQ_EPS(cosine_mean, table_mean, 0.05);
+        EXPECT_LT(cosine_variance, table_variance);
+    }
+}
@@ -0,0 +1,131 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sppm/sppmvisiblepointgrid.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_SPPM_SPPMVisiblePointGrid)
+{
+    struct CollectingVisitor
+    {
+        vector<size_t> m_indices;
+
+        void visit(const size_t index)
+        {
+            m_indices.push_back(index);
+        }
+    };
+
+    Vector3f rand_vector3f(MersenneTwister& rng)
+    {
+        Vector3f v;
+        v[0] = rand_float2(rng, -1.0f, 1.0f);
+        v[1] = rand_float2(rng, -1.0f, 1.0f);
+        v[2] = rand_float2(rng, -1.0f, 1.0f);
+        return v;
+    }
+
+    TEST_CASE(Query_GivenEmptyGrid_VisitsNothing)
+    {
+        SPPMVisiblePointGrid grid;
+
+        CollectingVisitor visitor;
+        grid.query(Vector3f(0.0f), visitor);
+
+        EXPECT_TRUE(visitor.m_indices.empty());
+    }
+
+    TEST_CASE(Query_GivenPointOutsideAllSpheres_VisitsNothing)
+    {
+        vector<Vector3f> positions(1, Vector3f(0.0f));
+        vector<float> square_radii(1, 1.0f);
+
+        SPPMVisiblePointGrid grid;
+        grid.build(positions, square_radii);
+
+        CollectingVisitor visitor;
+        grid.query(Vector3f(0.0f, 2.0f, 0.0f), visitor);
+
+        EXPECT_TRUE(visitor.m_indices.empty());
+    }
+
+    TEST_CASE(Query_GivenRandomSpheres_VisitsExactlyTheContainingSpheresOnce)
+    {
+        const size_t PointCount = 500;
+        const size_t QueryCount = 2000;
+
+        MersenneTwister rng;
+
+        vector<Vector3f> positions(PointCount);
+        vector<float> square_radii(PointCount);
+
+        for (size_t i = 0; i < PointCount; ++i)
+        {
+            positions[i] = rand_vector3f(rng);
+            square_radii[i] = square(rand_float2(rng, 0.01f, 0.2f));
+        }
+
+        SPPMVisiblePointGrid grid;
+        grid.build(positions, square_radii);
+
+        for (size_t q = 0; q < QueryCount; ++q)
+        {
+            const Vector3f point = rand_vector3f(rng);
+
+            vector<size_t> expected;
+            for (size_t i = 0; i < PointCount; ++i)
+            {
+                if (square_norm(positions[i] - point) <= square_radii[i])
+                    expected.push_back(i);
+            }
+
+            CollectingVisitor visitor;
+            grid.query(point, visitor);
+            sort(visitor.m_indices.begin(), visitor.m_indices.end());
+
+            ASSERT_EQ(expected, visitor.m_indices);
+        }
+    }
+}
@@ -29,10 +29,25 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/modeling/texture/texture.h"
+#include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/colorspace.h"
+#include "foundation/image/pixel.h"
+#include "foundation/image/tile.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/test.h"
 
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
 using namespace renderer;
 
 TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
@@ -45,5 +60,334 @@ TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
         EXPECT_EQ(12345, key.m_texture_uid);
         EXPECT_EQ(32323, key.get_tile_x());
         EXPECT_EQ(56565, key.get_tile_y());
+        EXPECT_EQ(0, key.get_level());
+    }
+
+    TEST_CASE(StoreAndRetrieveTileLevel)
+    {
+        const TextureStore::TileKey key(123, 12345, 32323, 56565, 7);
+
+        EXPECT_EQ(32323, key.get_tile_x());
+        EXPECT_EQ(56565, key.get_tile_y());
+        EXPECT_EQ(7, key.get_level());
+    }
+
+    TEST_CASE(KeysOfDifferentLevelsAreDifferent)
+    {
+        const TextureStore::TileKey key1(123, 12345, 3, 5, 0);
+        const TextureStore::TileKey key2(123, 12345, 3, 5, 1);
+
+        EXPECT_TRUE(key1 != key2);
+        EXPECT_TRUE(key1 < key2);
+        EXPECT_FALSE(key2 < key1);
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Texturing_TextureStore)
+{
+    class CountingTexture
+      : public Texture
+    {
+      public:
+        size_t  m_load_count;
+        size_t  m_unload_count;
+        bool    m_fail_loading;
+        uint64  m_content_stamp;
+
+        CountingTexture(
+            const char*     name,
+            const bool      detached,
+            const size_t    tile_size = 1,
+            const size_t    tile_count = 1)
+          : Texture(name, ParamArray())
+          , m_load_count(0)
+          , m_unload_count(0)
+          , m_fail_loading(false)
+          , m_content_stamp(0)
+          , m_detached(detached)
+          , m_props(tile_count * tile_size, tile_size, tile_size, tile_size, 3, PixelFormatFloat)
+          , m_tile(tile_size, tile_size, 3, PixelFormatFloat)
+        {
+        }
+
+        virtual void release() APPLESEED_OVERRIDE
+        {
+            delete this;
+        }
+
+        virtual const char* get_model() const APPLESEED_OVERRIDE
+        {
+            return "counting_texture";
+        }
+
+        virtual ColorSpace get_color_space() const APPLESEED_OVERRIDE
+        {
+            return ColorSpaceLinearRGB;
+        }
+
+        virtual bool has_detached_tiles() const APPLESEED_OVERRIDE
+        {
+            return m_detached;
+        }
+
+        virtual uint64 get_content_stamp() const APPLESEED_OVERRIDE
+        {
+            return m_content_stamp;
+        }
+
+        virtual const CanvasProperties& properties() APPLESEED_OVERRIDE
+        {
+            return m_props;
+        }
+
+        virtual Tile* load_tile(
+            const size_t    tile_x,
+            const size_t    tile_y) APPLESEED_OVERRIDE
+        {
+            ++m_load_count;
+
+            if (m_fail_loading)
+                throw ExceptionIOError();
+
+            return m_detached ? new Tile(m_tile) : &m_tile;
+        }
+
+        virtual void unload_tile(
+            const size_t    tile_x,
+            const size_t    tile_y,
+            const Tile*     tile) APPLESEED_OVERRIDE
+        {
+            ++m_unload_count;
+
+            if (m_detached)
+                delete tile;
+        }
+
+      private:
+        const bool              m_detached;
+        const CanvasProperties  m_props;
+        Tile                    m_tile;
+    };
+
+    struct Fixture
+    {
+        auto_release_ptr<Scene> m_scene;
+        CountingTexture*        m_texture;
+
+        explicit Fixture(const bool detached = true)
+          : m_scene(SceneFactory::create())
+          , m_texture(new CountingTexture("texture", detached))
+        {
+            m_scene->textures().insert(auto_release_ptr<Texture>(m_texture));
+        }
+
+        void acquire_and_release(TextureStore& texture_store) const
+        {
+            const TextureStore::TileKey key(~UniqueID(0), m_texture->get_uid(), 0, 0);
+            texture_store.release(texture_store.acquire(key));
+        }
+    };
+
+    TEST_CASE_F(DetachedTiles_AreKeptAcrossRenders, Fixture)
+    {
+        TextureStore texture_store(m_scene.ref());
+        acquire_and_release(texture_store);
+        texture_store.on_render_end();
+
+        texture_store.on_render_begin(m_scene.ref());
+        acquire_and_release(texture_store);
+
+        EXPECT_EQ(1, m_texture->m_load_count);
+    }
+
+    TEST_CASE_F(DetachedTiles_AreReloadedWhenTextureIsModified, Fixture)
+    {
+        TextureStore texture_store(m_scene.ref());
+        acquire_and_release(texture_store);
+        texture_store.on_render_end();
+
+        m_texture->bump_version_id();
+
+        texture_store.on_render_begin(m_scene.ref());
+        acquire_and_release(texture_store);
+
+        EXPECT_EQ(2, m_texture->m_load_count);
+    }
+
+    TEST_CASE_F(DetachedTiles_AreReloadedWhenTextureContentChanges, Fixture)
+    {
+        TextureStore texture_store(m_scene.ref());
+        acquire_and_release(texture_store);
+        texture_store.on_render_end();
+
+        ++m_texture->m_content_stamp;
+
+        texture_store.on_render_begin(m_scene.ref());
+        acquire_and_release(texture_store);
+
+        EXPECT_EQ(2, m_texture->m_load_count);
+    }
+
+    TEST_CASE(Acquire_GivenTileLargerThanShareOfBudget_KeepsTileWhileStoreHasRoom)
+    {
+        auto_release_ptr<Scene> scene(SceneFactory::create());
+
+        // A 300 KB tile, larger than the 256 KB share of each shard.
+        CountingTexture* large_texture = new CountingTexture("large_texture", true, 160);
+        scene->textures().insert(auto_release_ptr<Texture>(large_texture));
+
+        // 256 tiles of 768 bytes, spread over all shards.
+        const size_t SmallTileCount = 256;
+        CountingTexture* small_texture = new CountingTexture("small_texture", true, 8, SmallTileCount);
+        scene->textures().insert(auto_release_ptr<Texture>(small_texture));
+
+        TextureStore texture_store(
+            scene.ref(),
+            ParamArray()
+                .insert("max_size", 1024 * 1024)
+                .insert("shard_count", 4));
+
+        const TextureStore::TileKey large_key(~UniqueID(0), large_texture->get_uid(), 0, 0);
+        texture_store.release(texture_store.acquire(large_key));
+
+        for (size_t i = 0; i < SmallTileCount; ++i)
+        {
+            const TextureStore::TileKey small_key(~UniqueID(0), small_texture->get_uid(), i, 0);
+            texture_store.release(texture_store.acquire(small_key));
+        }
+
+        texture_store.release(texture_store.acquire(large_key));
+
+        EXPECT_EQ(1, large_texture->m_load_count);
+    }
+
+    struct AttachedTilesFixture
+      : public Fixture
+    {
+        AttachedTilesFixture()
+          : Fixture(false)
+        {
+        }
+    };
+
+    TEST_CASE_F(AttachedTiles_AreUnloadedAtRenderEnd, AttachedTilesFixture)
+    {
+        TextureStore texture_store(m_scene.ref());
+        acquire_and_release(texture_store);
+        texture_store.on_render_end();
+
+        EXPECT_EQ(1, m_texture->m_unload_count);
+
+        texture_store.on_render_begin(m_scene.ref());
+        acquire_and_release(texture_store);
+
+        EXPECT_EQ(2, m_texture->m_load_count);
+    }
+
+    TEST_CASE_F(Acquire_GivenTileFailingToLoad_ThrowsAndReloadsTileOnNextAcquisition, Fixture)
+    {
+        TextureStore texture_store(m_scene.ref());
+
+        m_texture->m_fail_loading = true;
+        EXPECT_EXCEPTION(ExceptionIOError, acquire_and_release(texture_store));
+
+        m_texture->m_fail_loading = false;
+        acquire_and_release(texture_store);
+
+        EXPECT_EQ(2, m_texture->m_load_count);
+    }
+
+    // A 3x1 texture made of 1x1 tiles whose value is their x coordinate, with a 1x1 MIP level.
+    class MIPTexture
+      : public Texture
+    {
+      public:
+        size_t  m_load_count;
+
+        MIPTexture()
+          : Texture("mip_texture", ParamArray())
+          , m_load_count(0)
+        {
+            m_level_props[0] = CanvasProperties(3, 1, 1, 1, 1, PixelFormatFloat);
+            m_level_props[1] = CanvasProperties(1, 1, 1, 1, 1, PixelFormatFloat);
+        }
+
+        virtual void release() APPLESEED_OVERRIDE
+        {
+            delete this;
+        }
+
+        virtual const char* get_model() const APPLESEED_OVERRIDE
+        {
+            return "mip_texture";
+        }
+
+        virtual ColorSpace get_color_space() const APPLESEED_OVERRIDE
+        {
+            return ColorSpaceLinearRGB;
+        }
+
+        virtual bool has_detached_tiles() const APPLESEED_OVERRIDE
+        {
+            return true;
+        }
+
+        virtual const CanvasProperties& properties() APPLESEED_OVERRIDE
+        {
+            return m_level_props[0];
+        }
+
+        virtual Tile* load_tile(
+            const size_t    tile_x,
+            const size_t    tile_y) APPLESEED_OVERRIDE
+        {
+            ++m_load_count;
+
+            Tile* tile = new Tile(1, 1, 1, PixelFormatFloat);
+            const float value = static_cast<float>(tile_x);
+            tile->set_pixel(0, &value);
+
+            return tile;
+        }
+
+        virtual void unload_tile(
+            const size_t    tile_x,
+            const size_t    tile_y,
+            const Tile*     tile) APPLESEED_OVERRIDE
+        {
+            delete tile;
+        }
+
+        virtual size_t get_mip_level_count() APPLESEED_OVERRIDE
+        {
+            return 2;
+        }
+
+        virtual const CanvasProperties& mip_properties(const size_t level) APPLESEED_OVERRIDE
+        {
+            return m_level_props[level];
+        }
+
+      private:
+        CanvasProperties        m_level_props[2];
+    };
+
+    TEST_CASE(Acquire_GivenTileOfCoarserLevel_GeneratesItFromTilesOfFinerLevel)
+    {
+        auto_release_ptr<Scene> scene(SceneFactory::create());
+        MIPTexture* texture = new MIPTexture();
+        scene->textures().insert(auto_release_ptr<Texture>(texture));
+
+        TextureStore texture_store(scene.ref());
+        const TextureStore::TileKey key(~UniqueID(0), texture->get_uid(), 0, 0, 1);
+        TextureStore::TileRecord& record = texture_store.acquire(key);
+
+        float value;
+        record.m_tile->get_pixel(0, &value);
+        texture_store.release(record);
+
+        // The last column of the finer level of odd width is folded into the last column.
+        EXPECT_FEQ((0.0f + 1.0f + 2.0f) / 3.0f, value);
+        EXPECT_EQ(3, texture->m_load_count);
     }
 }
@@ -0,0 +1,196 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014-2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// appleseed.renderer headers.
+#include "renderer/kernel/intersection/treecache.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/test.h"
+
+// Boost headers.
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace boost::filesystem;
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Intersection_TreeCache)
+{
+    const size_t NodeSize = 64;
+
+    struct Fixture
+    {
+        const path  m_cache_directory;
+        ParamArray  m_params;
+
+        Fixture()
+          : m_cache_directory(absolute("unit tests/outputs/test_treecache/"))
+        {
+            remove_all(m_cache_directory);
+
+            m_params.insert("cache_directory", m_cache_directory.string());
+            m_params.insert("algorithm", "bvh");
+        }
+
+        void store(const vector<uint32>& geometry, const vector<float>& nodes)
+        {
+            TreeCache cache("test tree", NodeSize, m_params);
+            cache.hash_vector(geometry);
+            cache.add_vector(nodes);
+            cache.add_vector(geometry);
+            cache.store(1.0);
+        }
+    };
+
+    vector<uint32> make_geometry()
+    {
+        vector<uint32> geometry;
+        for (uint32 i = 0; i < 100; ++i)
+            geometry.push_back(i * 3);
+        return geometry;
+    }
+
+    vector<float> make_nodes()
+    {
+        vector<float> nodes;
+        for (size_t i = 0; i < 37; ++i)
+            nodes.push_back(static_cast<float>(i) * 0.5f);
+        return nodes;
+    }
+
+    TEST_CASE(IsEnabled_GivenNoCacheDirectory_ReturnsFalse)
+    {
+        TreeCache cache("test tree", NodeSize, ParamArray());
+
+        EXPECT_FALSE(cache.is_enabled());
+    }
+
+    TEST_CASE_F(Load_GivenStoredTree_ReturnsStoredBlocks, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        const vector<float> nodes = make_nodes();
+        store(geometry, nodes);
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+        ASSERT_TRUE(cache.load());
+
+        vector<float> loaded_nodes;
+        vector<uint32> loaded_geometry;
+        ASSERT_TRUE(cache.read_vector(0, loaded_nodes));
+        ASSERT_TRUE(cache.read_vector(1, loaded_geometry));
+
+        EXPECT_EQ(1.0, cache.get_build_time());
+        EXPECT_SEQUENCE_EQ(nodes.size(), &nodes[0], &loaded_nodes[0]);
+        EXPECT_SEQUENCE_EQ(geometry.size(), &geometry[0], &loaded_geometry[0]);
+    }
+
+    TEST_CASE_F(Load_GivenModifiedGeometry_ReturnsFalse, Fixture)
+    {
+        vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        geometry[42] += 1;
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+
+        EXPECT_FALSE(cache.load());
+    }
+
+    TEST_CASE_F(Load_GivenModifiedBuildParameters_ReturnsFalse, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        m_params.insert("algorithm", "sbvh");
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+
+        EXPECT_FALSE(cache.load());
+    }
+
+    TEST_CASE_F(Load_GivenDifferentNodeSize_ReturnsFalse, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        TreeCache cache("test tree", NodeSize * 2, m_params);
+        cache.hash_vector(geometry);
+
+        EXPECT_FALSE(cache.load());
+    }
+
+    TEST_CASE_F(Load_GivenDifferentBuildThreadCount_ReturnsTrue, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        m_params.insert("build_threads", 3);
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+
+        EXPECT_TRUE(cache.load());
+    }
+
+    TEST_CASE_F(Load_GivenTruncatedFile_ReturnsFalse, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+        resize_file(cache.get_path(), file_size(cache.get_path()) - 16);
+
+        EXPECT_FALSE(cache.load());
+    }
+
+    TEST_CASE_F(ReadVector_GivenMismatchedItemSize_ReturnsFalse, Fixture)
+    {
+        const vector<uint32> geometry = make_geometry();
+        store(geometry, make_nodes());
+
+        TreeCache cache("test tree", NodeSize, m_params);
+        cache.hash_vector(geometry);
+        ASSERT_TRUE(cache.load());
+
+        vector<double> loaded_nodes;
+        EXPECT_FALSE(cache.read_vector(0, loaded_nodes));
+    }
+}
@@ -80,7 +80,7 @@ void* BSSRDF::evaluate_inputs(
 
     get_inputs().evaluate(
         shading_context.get_texture_cache(),
-        shading_point.get_uv(0),
+        shading_point,
         data);
 
     prepare_inputs(
@@ -31,12 +31,19 @@
 #include "hosekenvironmentedf.h"
 
 // appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/shading/shadingcontext.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/modeling/environment/environment.h"
 #include "renderer/modeling/environmentedf/environmentedf.h"
+#include "renderer/modeling/environmentedf/skyradiancetable.h"
 #include "renderer/modeling/environmentedf/sphericalcoordinates.h"
 #include "renderer/modeling/input/inputarray.h"
 #include "renderer/modeling/input/source.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
 #include "renderer/utility/transformsequence.h"
 
 // appleseed.foundation headers.
@@ -49,14 +56,21 @@
 #include "foundation/math/transform.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/system.h"
+#include "foundation/platform/timers.h"
+#include "foundation/utility/api/apistring.h"
 #include "foundation/utility/api/specializedapiarrays.h"
 #include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/job/abortswitch.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
 
 // Standard headers.
 #include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <memory>
 
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
@@ -155,6 +169,15 @@ namespace
                     m_uniform_master_Y);
             }
 
+            // Optionally bake the sky into a radiance table if this environment EDF is the active one.
+            m_radiance_table.reset();
+            if (m_params.get_optional<bool>("bake_radiance_table", false))
+            {
+                const Environment* environment = project.get_scene()->get_environment();
+                if (environment->get_uncached_environment_edf() == this)
+                    bake_radiance_table(*project.get_scene(), abort_switch);
+            }
+
             return true;
         }
 
@@ -165,15 +188,23 @@ namespace
             Spectrum&               value,
             float&                  probability) const APPLESEED_OVERRIDE
         {
-            const Vector3f local_outgoing = sample_hemisphere_cosine(s);
-
             Transformd scratch;
             const Transformd& transform = m_transform_sequence.evaluate(0.0f, scratch);
+
+            if (m_radiance_table.get())
+            {
+                Vector3f local_outgoing;
+                m_radiance_table->sample(s, local_outgoing, value, probability);
+                outgoing = transform.vector_to_parent(local_outgoing);
+                return;
+            }
+
+            const Vector3f local_outgoing = sample_hemisphere_cosine(s);
             outgoing = transform.vector_to_parent(local_outgoing);
             const Vector3f shifted_outgoing = shift(local_outgoing);
 
             if (shifted_outgoing.y > 0.0f)
-                compute_sky_radiance(shading_context, shifted_outgoing, value);
+                compute_sky_radiance(shading_context.get_texture_cache(), shifted_outgoing, value);
             else value.set(0.0f);
 
             probability = shifted_outgoing.y > 0.0f ? shifted_outgoing.y * RcpPi<float>() : 0.0f;
@@ -189,10 +220,17 @@ namespace
             Transformd scratch;
             const Transformd& transform = m_transform_sequence.evaluate(0.0f, scratch);
             const Vector3f local_outgoing = transform.vector_to_local(outgoing);
+
+            if (m_radiance_table.get())
+            {
+                m_radiance_table->evaluate(local_outgoing, value);
+                return;
+            }
+
             const Vector3f shifted_outgoing = shift(local_outgoing);
 
             if (shifted_outgoing.y > 0.0f)
-                compute_sky_radiance(shading_context, shifted_outgoing, value);
+                compute_sky_radiance(shading_context.get_texture_cache(), shifted_outgoing, value);
             else value.set(0.0f);
         }
 
@@ -207,10 +245,18 @@ namespace
             Transformd scratch;
             const Transformd& transform = m_transform_sequence.evaluate(0.0f, scratch);
             const Vector3f local_outgoing = transform.vector_to_local(outgoing);
+
+            if (m_radiance_table.get())
+            {
+                m_radiance_table->evaluate(local_outgoing, value);
+                probability = m_radiance_table->evaluate_pdf(local_outgoing);
+                return;
+            }
+
             const Vector3f shifted_outgoing = shift(local_outgoing);
 
             if (shifted_outgoing.y > 0.0f)
-                compute_sky_radiance(shading_context, shifted_outgoing, value);
+                compute_sky_radiance(shading_context.get_texture_cache(), shifted_outgoing, value);
             else value.set(0.0f);
 
             probability = shifted_outgoing.y > 0.0f ? shifted_outgoing.y * RcpPi<float>() : 0.0f;
@@ -224,6 +270,10 @@ namespace
             Transformd scratch;
             const Transformd& transform = m_transform_sequence.evaluate(0.0f, scratch);
             const Vector3f local_outgoing = transform.vector_to_local(outgoing);
+
+            if (m_radiance_table.get())
+                return m_radiance_table->evaluate_pdf(local_outgoing);
+
             const Vector3f shifted_outgoing = shift(local_outgoing);
 
             return shifted_outgoing.y > 0.0f ? shifted_outgoing.y * RcpPi<float>() : 0.0f;
@@ -255,6 +305,63 @@ namespace
         float                       m_uniform_coeffs[3 * 9];
         float                       m_uniform_master_Y[3];
 
+        // Adapter used to bake the sky model into the radiance table.
+        class SkyRadianceFunction
+          : public ISkyRadianceFunction
+        {
+          public:
+            explicit SkyRadianceFunction(const HosekEnvironmentEDF& edf)
+              : m_edf(edf)
+            {
+            }
+
+            virtual void evaluate(
+                TextureCache&       texture_cache,
+                const Vector3f&     local_outgoing,
+                Spectrum&           value) const APPLESEED_OVERRIDE
+            {
+                const Vector3f shifted_outgoing = m_edf.shift(local_outgoing);
+
+                if (shifted_outgoing.y > 0.0f)
+                    m_edf.compute_sky_radiance(texture_cache, shifted_outgoing, value);
+                else value.set(0.0f);
+            }
+
+          private:
+            const HosekEnvironmentEDF& m_edf;
+        };
+
+        auto_ptr<SkyRadianceTable>  m_radiance_table;
+
+        void bake_radiance_table(const Scene& scene, IAbortSwitch* abort_switch)
+        {
+            const size_t width = max<size_t>(m_params.get_optional<size_t>("radiance_table_resolution", 512), 2);
+            const size_t height = width / 2;
+
+            RENDERER_LOG_INFO(
+                "baking " FMT_SIZE_T "x" FMT_SIZE_T " radiance table for environment edf \"%s\"...",
+                width,
+                height,
+                get_path().c_str());
+
+            Stopwatch<DefaultWallclockTimer> stopwatch;
+            stopwatch.start();
+
+            const SkyRadianceFunction function(*this);
+            m_radiance_table.reset(new SkyRadianceTable(width, height));
+
+            if (m_radiance_table->bake(scene, function, System::get_logical_cpu_core_count(), abort_switch))
+            {
+                stopwatch.measure();
+
+                RENDERER_LOG_INFO(
+                    "baked radiance table for environment edf \"%s\" in %s.",
+                    get_path().c_str(),
+                    pretty_time(stopwatch.get_seconds()).c_str());
+            }
+            else m_radiance_table.reset();
+        }
+
         // Compute the coefficients of the radiance distribution function and the master luminance value.
         static void compute_coefficients(
             const float             turbidity,
@@ -370,7 +477,7 @@ namespace
 
         // Compute the sky radiance along a given direction.
         void compute_sky_radiance(
-            const ShadingContext&   shading_context,
+            TextureCache&           texture_cache,
             const Vector3f&         outgoing,
             Spectrum&               value) const
         {
@@ -401,7 +508,7 @@ namespace
                 unit_vector_to_angles(outgoing, theta, phi);
                 angles_to_unit_square(theta, phi, u, v);
                 InputValues values;
-                m_inputs.evaluate(shading_context.get_texture_cache(), Vector2f(u, v), &values);
+                m_inputs.evaluate(texture_cache, Vector2f(u, v), &values);
                 float turbidity = values.m_turbidity;
 
                 // Apply turbidity multiplier and bias.
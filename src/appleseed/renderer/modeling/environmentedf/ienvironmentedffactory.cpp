@@ -125,6 +125,24 @@ void IEnvironmentEDFFactory::add_common_sky_input_metadata(DictionaryArray& meta
             .insert("use", "optional")
             .insert("default", "0.0")
             .insert("help", "Rotate the sky horizontally by a given number of degrees"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "bake_radiance_table")
+            .insert("label", "Bake Radiance Table")
+            .insert("type", "boolean")
+            .insert("use", "optional")
+            .insert("default", "false")
+            .insert("help", "Bake the sky into a lat-long table at render start and importance sample it"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "radiance_table_resolution")
+            .insert("label", "Radiance Table Resolution")
+            .insert("type", "text")
+            .insert("use", "optional")
+            .insert("default", "512")
+            .insert("help", "Width in texels of the baked radiance table; its height is half its width"));
 }
 
 }   // namespace renderer
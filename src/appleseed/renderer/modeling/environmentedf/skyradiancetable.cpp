@@ -0,0 +1,360 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "skyradiancetable.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/environmentedf/sphericalcoordinates.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/colorspace.h"
+#include "foundation/math/scalar.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/job/abortswitch.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/memory.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    //
+    // A job that evaluates the sky model for a range of rows of the table.
+    //
+
+    class BakeRowsJob
+      : public IJob
+    {
+      public:
+        BakeRowsJob(
+            const ISkyRadianceFunction& function,
+            TextureStore&               texture_store,
+            const size_t                width,
+            const size_t                height,
+            const size_t                begin_y,
+            const size_t                end_y,
+            RegularSpectrum31f*         radiance,
+            float*                      importance,
+            IAbortSwitch*               abort_switch)
+          : m_function(function)
+          , m_texture_store(texture_store)
+          , m_width(width)
+          , m_height(height)
+          , m_begin_y(begin_y)
+          , m_end_y(end_y)
+          , m_radiance(radiance)
+          , m_importance(importance)
+          , m_abort_switch(abort_switch)
+        {
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            TextureCache texture_cache(m_texture_store);
+
+            const float rcp_width = 1.0f / m_width;
+            const float rcp_height = 1.0f / m_height;
+
+            for (size_t y = m_begin_y; y < m_end_y; ++y)
+            {
+                if (is_aborted(m_abort_switch))
+                    break;
+
+                const float v = (y + 0.5f) * rcp_height;
+
+                for (size_t x = 0; x < m_width; ++x)
+                {
+                    const float u = (x + 0.5f) * rcp_width;
+
+                    // Compute the direction going through the center of this texel.
+                    float theta, phi;
+                    unit_square_to_angles(u, v, theta, phi);
+                    const Vector3f local_outgoing = Vector3f::make_unit_vector(theta, phi);
+
+                    // Evaluate the sky model.
+                    Spectrum value(0.0f, Spectrum::Illuminance);
+                    m_function.evaluate(texture_cache, local_outgoing, value);
+                    if (value.is_rgb())
+                        Spectrum::upgrade(value, value);
+
+                    const size_t index = y * m_width + x;
+                    RegularSpectrum31f& texel = m_radiance[index];
+
+                    if (is_finite(value))
+                    {
+                        for (size_t i = 0; i < RegularSpectrum31f::Samples; ++i)
+                            texel[i] = value[i];
+                    }
+                    else texel.set(0.0f);
+
+                    // Texels near the poles subtend smaller solid angles.
+                    const float luminance = sum_value(texel * XYZCMFCIE19312Deg[1]);
+                    m_importance[index] = max(luminance, 0.0f) * sin(theta);
+                }
+            }
+        }
+
+      private:
+        const ISkyRadianceFunction& m_function;
+        TextureStore&               m_texture_store;
+        const size_t                m_width;
+        const size_t                m_height;
+        const size_t                m_begin_y;
+        const size_t                m_end_y;
+        RegularSpectrum31f*         m_radiance;
+        float*                      m_importance;
+        IAbortSwitch*               m_abort_switch;
+    };
+
+    class ImportanceMapSampler
+    {
+      public:
+        ImportanceMapSampler(
+            const vector<float>&        importance,
+            const size_t                width)
+          : m_importance(importance)
+          , m_width(width)
+        {
+        }
+
+        void sample(const size_t x, const size_t y, float& payload, float& importance)
+        {
+            importance = m_importance[y * m_width + x];
+            payload = importance;
+        }
+
+      private:
+        const vector<float>&    m_importance;
+        const size_t            m_width;
+    };
+}
+
+
+//
+// SkyRadianceTable class implementation.
+//
+
+SkyRadianceTable::SkyRadianceTable(
+    const size_t                width,
+    const size_t                height)
+  : m_width(width)
+  , m_height(height)
+  , m_rcp_width(1.0f / width)
+  , m_rcp_height(1.0f / height)
+  , m_probability_scale((width * height) / (2.0f * PiSquare<float>()))
+{
+    assert(width > 0);
+    assert(height > 0);
+}
+
+bool SkyRadianceTable::bake(
+    const Scene&                scene,
+    const ISkyRadianceFunction& function,
+    const size_t                thread_count,
+    IAbortSwitch*               abort_switch)
+{
+    assert(thread_count > 0);
+
+    const size_t texel_count = m_width * m_height;
+    m_radiance.resize(texel_count);
+    m_importance.resize(texel_count);
+
+    // Split the rows into contiguous ranges, several per thread for load balancing.
+    const size_t RowRangesPerThread = 8;
+    const size_t row_range_size =
+        max<size_t>((m_height + thread_count * RowRangesPerThread - 1) / (thread_count * RowRangesPerThread), 1);
+
+    // Evaluate the sky model for all texels.
+    {
+        TextureStore texture_store(scene);
+
+        JobQueue job_queue;
+        JobManager job_manager(global_logger(), job_queue, thread_count);
+
+        for (size_t begin_y = 0; begin_y < m_height; begin_y += row_range_size)
+        {
+            job_queue.schedule(
+                new BakeRowsJob(
+                    function,
+                    texture_store,
+                    m_width,
+                    m_height,
+                    begin_y,
+                    min(begin_y + row_range_size, m_height),
+                    &m_radiance[0],
+                    &m_importance[0],
+                    abort_switch));
+        }
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+    }
+
+    if (is_aborted(abort_switch))
+        return false;
+
+    // Build the importance map.
+    ImportanceMapSampler sampler(m_importance, m_width);
+    m_importance_sampler.reset(new ImportanceSamplerType(m_width, m_height));
+    m_importance_sampler->rebuild(sampler, abort_switch);
+
+    // The importance values are now stored in the importance sampler.
+    clear_release_memory(m_importance);
+
+    return !is_aborted(abort_switch);
+}
+
+void SkyRadianceTable::sample(
+    const Vector2f&             s,
+    Vector3f&                   local_outgoing,
+    Spectrum&                   value,
+    float&                      probability) const
+{
+    assert(m_importance_sampler.get());
+
+    // Sample the importance map.
+    size_t x, y;
+    float payload, prob_xy;
+    m_importance_sampler->sample(s, x, y, payload, prob_xy);
+
+    // Compute the coordinates in [0,1]^2 of the sample.
+    const float u = (x + 0.5f) * m_rcp_width;
+    const float v = (y + 0.5f) * m_rcp_height;
+
+    // Compute the local space emission direction.
+    float theta, phi;
+    unit_square_to_angles(u, v, theta, phi);
+    const float cos_theta = cos(theta);
+    const float sin_theta = sin(theta);
+    const float cos_phi = cos(phi);
+    const float sin_phi = sin(phi);
+    local_outgoing = Vector3f::make_unit_vector(cos_theta, sin_theta, cos_phi, sin_phi);
+
+    // The bilinear lookup at the center of a texel returns the value of that texel.
+    value = m_radiance[y * m_width + x];
+
+    // Compute the probability density of this direction.
+    probability = prob_xy * m_probability_scale / sin_theta;
+}
+
+void SkyRadianceTable::evaluate(
+    const Vector3f&             local_outgoing,
+    Spectrum&                   value) const
+{
+    assert(is_normalized(local_outgoing));
+
+    float theta, phi;
+    unit_vector_to_angles(local_outgoing, theta, phi);
+
+    float u, v;
+    angles_to_unit_square(theta, phi, u, v);
+
+    lookup(u, v, value);
+}
+
+float SkyRadianceTable::evaluate_pdf(
+    const Vector3f&             local_outgoing) const
+{
+    assert(is_normalized(local_outgoing));
+
+    float theta, phi;
+    unit_vector_to_angles(local_outgoing, theta, phi);
+
+    float u, v;
+    angles_to_unit_square(theta, phi, u, v);
+
+    return compute_pdf(u, v, theta);
+}
+
+void SkyRadianceTable::lookup(
+    const float                 u,
+    const float                 v,
+    Spectrum&                   value) const
+{
+    assert(!m_radiance.empty());
+
+    // Texel centers are at half-integer coordinates.
+    const float fx = u * m_width - 0.5f;
+    const float fy = clamp(v * m_height - 0.5f, 0.0f, m_height - 1.0f);
+
+    // Wrap around horizontally, clamp vertically.
+    const float floor_fx = floor(fx);
+    const float wx = fx - floor_fx;
+    const size_t x0 = floor_fx < 0.0f ? m_width - 1 : min(truncate<size_t>(floor_fx), m_width - 1);
+    const size_t x1 = x0 + 1 < m_width ? x0 + 1 : 0;
+    const size_t y0 = truncate<size_t>(fy);
+    const size_t y1 = min(y0 + 1, m_height - 1);
+    const float wy = fy - y0;
+
+    const RegularSpectrum31f* row0 = &m_radiance[y0 * m_width];
+    const RegularSpectrum31f* row1 = &m_radiance[y1 * m_width];
+
+    RegularSpectrum31f result = row0[x0] * ((1.0f - wx) * (1.0f - wy));
+    result += row0[x1] * (wx * (1.0f - wy));
+    result += row1[x0] * ((1.0f - wx) * wy);
+    result += row1[x1] * (wx * wy);
+
+    value = result;
+}
+
+float SkyRadianceTable::compute_pdf(
+    const float                 u,
+    const float                 v,
+    const float                 theta) const
+{
+    assert(m_importance_sampler.get());
+
+    const float sin_theta = sin(theta);
+    if (sin_theta == 0.0f)
+        return 0.0f;
+
+    // Compute the probability density of this sample in the importance map.
+    const size_t x = min(truncate<size_t>(m_width * u), m_width - 1);
+    const size_t y = min(truncate<size_t>(m_height * v), m_height - 1);
+    const float prob_xy = m_importance_sampler->get_pdf(x, y);
+
+    // Compute the probability density of the emission direction.
+    return prob_xy * m_probability_scale / sin_theta;
+}
+
+}   // namespace renderer
@@ -0,0 +1,161 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_RENDERER_MODELING_ENVIRONMENTEDF_SKYRADIANCETABLE_H
+#define APPLESEED_RENDERER_MODELING_ENVIRONMENTEDF_SKYRADIANCETABLE_H
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/regularspectrum.h"
+#include "foundation/math/sampling/imageimportancesampler.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class IAbortSwitch; }
+namespace renderer      { class Scene; }
+namespace renderer      { class TextureCache; }
+
+namespace renderer
+{
+
+//
+// Interface of the sky models that can be baked into a sky radiance table.
+//
+
+class ISkyRadianceFunction
+{
+  public:
+    // Destructor.
+    virtual ~ISkyRadianceFunction() {}
+
+    // Compute the sky radiance along a given local space direction.
+    // This method is called concurrently by multiple threads.
+    virtual void evaluate(
+        TextureCache&                   texture_cache,
+        const foundation::Vector3f&     local_outgoing,     // unit-length
+        Spectrum&                       value) const = 0;
+};
+
+
+//
+// A lat-long table of sky radiance values together with an importance map.
+//
+// Analytic sky models are baked into this table at the beginning of the frame,
+// then radiance lookups are bilinear interpolations in the table and emission
+// directions are chosen proportionally to the radiance of the sky.
+//
+// All directions are expressed in the local space of the environment EDF.
+// All probability densities are measured with respect to solid angle.
+//
+
+class SkyRadianceTable
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    SkyRadianceTable(
+        const size_t                    width,
+        const size_t                    height);
+
+    // Return the resolution of the table.
+    size_t get_width() const;
+    size_t get_height() const;
+
+    // Evaluate the sky model for every texel and build the importance map.
+    // Returns false if the operation was aborted.
+    bool bake(
+        const Scene&                    scene,
+        const ISkyRadianceFunction&     function,
+        const size_t                    thread_count,
+        foundation::IAbortSwitch*       abort_switch = 0);
+
+    // Choose an emission direction proportionally to the sky radiance.
+    void sample(
+        const foundation::Vector2f&     s,                  // sample in [0,1)^2
+        foundation::Vector3f&           local_outgoing,     // local space emission direction, unit-length
+        Spectrum&                       value,              // radiance along this direction
+        float&                          probability) const; // PDF value
+
+    // Look up the sky radiance along a given direction.
+    void evaluate(
+        const foundation::Vector3f&     local_outgoing,     // local space emission direction, unit-length
+        Spectrum&                       value) const;
+
+    // Evaluate the PDF of sample() for a given direction.
+    float evaluate_pdf(
+        const foundation::Vector3f&     local_outgoing) const;
+
+  private:
+    typedef foundation::ImageImportanceSampler<float, float> ImportanceSamplerType;
+
+    const size_t                                    m_width;
+    const size_t                                    m_height;
+    const float                                     m_rcp_width;
+    const float                                     m_rcp_height;
+    const float                                     m_probability_scale;
+    std::vector<foundation::RegularSpectrum31f>     m_radiance;
+    std::vector<float>                              m_importance;
+    std::auto_ptr<ImportanceSamplerType>            m_importance_sampler;
+
+    void lookup(
+        const float                     u,
+        const float                     v,
+        Spectrum&                       value) const;
+
+    float compute_pdf(
+        const float                     u,
+        const float                     v,
+        const float                     theta) const;
+};
+
+
+//
+// SkyRadianceTable class implementation.
+//
+
+inline size_t SkyRadianceTable::get_width() const
+{
+    return m_width;
+}
+
+inline size_t SkyRadianceTable::get_height() const
+{
+    return m_height;
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_MODELING_ENVIRONMENTEDF_SKYRADIANCETABLE_H
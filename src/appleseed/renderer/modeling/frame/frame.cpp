@@ -68,6 +68,7 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -588,6 +589,45 @@ bool Frame::write_aov_images(const char* file_path) const
     return result;
 }
 
+bool Frame::write_main_and_aov_images(const char* file_path) const
+{
+    assert(file_path);
+
+    const string extension = lower_case(bf::path(file_path).extension().string());
+
+    // Only OpenEXR files can hold multiple layers.
+    if (extension != ".exr" || impl->m_aov_images->empty())
+    {
+        const bool main_image_result = write_main_image(file_path);
+        const bool aov_images_result = write_aov_images(file_path);
+        return main_image_result && aov_images_result;
+    }
+
+    Image transformed_image(*impl->m_image);
+    transform_to_output_color_space(transformed_image);
+
+    vector<const char*> layer_names;
+    vector<const ICanvas*> layers;
+
+    layer_names.push_back("");
+    layers.push_back(&transformed_image);
+
+    // Note: AOVs are always in the linear color space.
+    for (size_t i = 0; i < impl->m_aov_images->size(); ++i)
+    {
+        layer_names.push_back(impl->m_aov_images->get_name(i));
+        layers.push_back(&impl->m_aov_images->get_image(i));
+    }
+
+    return
+        write_image(
+            file_path,
+            layers.size(),
+            &layer_names[0],
+            &layers[0],
+            ImageAttributes::create_default_attributes());
+}
+
 bool Frame::archive(
     const char*         directory,
     char**              output_path) const
@@ -763,30 +803,52 @@ bool Frame::write_image(
     const char*             file_path,
     const Image&            image,
     const ImageAttributes&  image_attributes) const
+{
+    const char* layer_name = "";
+    const ICanvas* layer = &image;
+
+    return write_image(file_path, 1, &layer_name, &layer, image_attributes);
+}
+
+bool Frame::write_image(
+    const char*             file_path,
+    const size_t            layer_count,
+    const char* const*      layer_names,
+    const ICanvas* const*   layers,
+    const ImageAttributes&  image_attributes) const
 {
     assert(file_path);
+    assert(layer_count > 0);
 
     Stopwatch<DefaultWallclockTimer> stopwatch;
     stopwatch.start();
 
     try
     {
-        try
+        if (layer_count == 1)
         {
-            GenericImageFileWriter writer;
-            writer.write(file_path, image, image_attributes);
-        }
-        catch (const ExceptionUnsupportedFileFormat&)
-        {
-            const string extension = lower_case(bf::path(file_path).extension().string());
+            try
+            {
+                GenericImageFileWriter writer;
+                writer.write(file_path, *layers[0], image_attributes);
+            }
+            catch (const ExceptionUnsupportedFileFormat&)
+            {
+                const string extension = lower_case(bf::path(file_path).extension().string());
 
-            RENDERER_LOG_ERROR(
-                "file format '%s' not supported, writing the image in OpenEXR format "
-                "(but keeping the filename unmodified).",
-                extension.c_str());
+                RENDERER_LOG_ERROR(
+                    "file format '%s' not supported, writing the image in OpenEXR format "
+                    "(but keeping the filename unmodified).",
+                    extension.c_str());
 
+                EXRImageFileWriter writer;
+                writer.write(file_path, *layers[0], image_attributes);
+            }
+        }
+        else
+        {
             EXRImageFileWriter writer;
-            writer.write(file_path, image, image_attributes);
+            writer.write(file_path, layer_count, layer_names, layers, image_attributes);
         }
     }
     catch (const ExceptionUnsupportedImageFormat&)
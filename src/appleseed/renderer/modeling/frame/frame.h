@@ -54,6 +54,7 @@
 
 // Forward declarations.
 namespace foundation    { class DictionaryArray; }
+namespace foundation    { class ICanvas; }
 namespace foundation    { class Image; }
 namespace foundation    { class ImageAttributes; }
 namespace foundation    { class LightingConditions; }
@@ -155,6 +156,12 @@ class APPLESEED_DLLSYMBOL Frame
     bool write_main_image(const char* file_path) const;
     bool write_aov_images(const char* file_path) const;
 
+    // Write the main image and the AOV images to disk. OpenEXR files store the AOV
+    // images as layers of the main image file; other formats get one file per image
+    // as with write_main_image() and write_aov_images().
+    // Return true if successful, false otherwise.
+    bool write_main_and_aov_images(const char* file_path) const;
+
     // Archive the frame to a given directory on disk. If output_path is provided,
     // the full path to the output file will be returned. The returned string must
     // be freed using foundation::free_string().
@@ -189,6 +196,15 @@ class APPLESEED_DLLSYMBOL Frame
         const char*                         file_path,
         const foundation::Image&            image,
         const foundation::ImageAttributes&  image_attributes) const;
+
+    // Write images as the layers of a single image file.
+    // Return true if successful, false otherwise.
+    bool write_image(
+        const char*                         file_path,
+        const size_t                        layer_count,
+        const char* const*                  layer_names,
+        const foundation::ICanvas* const*   layers,
+        const foundation::ImageAttributes&  image_attributes) const;
 };
 
 
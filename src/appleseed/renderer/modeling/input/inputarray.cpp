@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/modeling/input/source.h"
 
 // appleseed.foundation headers.
@@ -124,6 +125,8 @@ namespace
         uint8* evaluate(
             TextureCache&       texture_cache,
             const Vector2f&     uv,
+            const Vector2f&     duvdx,
+            const Vector2f&     duvdy,
             uint8*              ptr) const
         {
             switch (m_format)
@@ -134,7 +137,7 @@ namespace
                     float* out_scalar = reinterpret_cast<float*>(ptr);
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_scalar);
+                        m_source->evaluate(texture_cache, uv, duvdx, duvdy, *out_scalar);
                     else *out_scalar = 0.0f;
 
                     ptr += sizeof(float);
@@ -149,7 +152,7 @@ namespace
                     new (out_spectrum) Spectrum();
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum);
+                        m_source->evaluate(texture_cache, uv, duvdx, duvdy, *out_spectrum);
                     else out_spectrum->set(0.0f);
 
                     out_spectrum->set_intent(Spectrum::Reflectance);
@@ -166,7 +169,7 @@ namespace
                     new (out_spectrum) Spectrum();
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum);
+                        m_source->evaluate(texture_cache, uv, duvdx, duvdy, *out_spectrum);
                     else out_spectrum->set(0.0f);
 
                     out_spectrum->set_intent(Spectrum::Illuminance);
@@ -185,7 +188,7 @@ namespace
                     new (out_alpha) Alpha();
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum, *out_alpha);
+                        m_source->evaluate(texture_cache, uv, duvdx, duvdy, *out_spectrum, *out_alpha);
                     else
                     {
                         out_spectrum->set(0.0f);
@@ -209,7 +212,7 @@ namespace
                     new (out_alpha) Alpha();
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum, *out_alpha);
+                        m_source->evaluate(texture_cache, uv, duvdx, duvdy, *out_spectrum, *out_alpha);
                     else
                     {
                         out_spectrum->set(0.0f);
@@ -486,8 +489,41 @@ void InputArray::evaluate(
     assert(is_aligned(ptr, 16));
 #endif
 
+    const Vector2f zero(0.0f);
+
+    for (const_each<InputVector> i = impl->m_inputs; i; ++i)
+        ptr = i->evaluate(texture_cache, uv, zero, zero, ptr);
+}
+
+void InputArray::evaluate(
+    TextureCache&       texture_cache,
+    const ShadingPoint& shading_point,
+    void*               values) const
+{
+    assert(values);
+
+    uint8* ptr = static_cast<uint8*>(values);
+
+#ifdef APPLESEED_USE_SSE
+    assert(is_aligned(ptr, 16));
+#endif
+
+    const Vector2f& uv = shading_point.get_uv(0);
+
+    // Only compute the texture coordinates derivatives if they are needed.
+    Vector2f duvdx(0.0f), duvdy(0.0f);
+    for (const_each<InputVector> i = impl->m_inputs; i; ++i)
+    {
+        if (i->m_source && !i->m_source->is_uniform())
+        {
+            duvdx = shading_point.get_duvdx(0);
+            duvdy = shading_point.get_duvdy(0);
+            break;
+        }
+    }
+
     for (const_each<InputVector> i = impl->m_inputs; i; ++i)
-        ptr = i->evaluate(texture_cache, uv, ptr);
+        ptr = i->evaluate(texture_cache, uv, duvdx, duvdy, ptr);
 }
 
 void InputArray::evaluate_uniforms(
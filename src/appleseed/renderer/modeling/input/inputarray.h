@@ -43,6 +43,7 @@
 
 // Forward declarations.
 namespace renderer  { class Entity; }
+namespace renderer  { class ShadingPoint; }
 namespace renderer  { class Source; }
 namespace renderer  { class TextureCache; }
 
@@ -221,6 +222,14 @@ class APPLESEED_DLLSYMBOL InputArray
         const foundation::Vector2f& uv,
         void*                       values) const;
 
+    // Evaluate all inputs at a given shading point into a preallocated block of memory.
+    // Texture lookups are filtered according to the screen space footprint of the point.
+    // 'values' must be 16-byte aligned.
+    void evaluate(
+        TextureCache&               texture_cache,
+        const ShadingPoint&         shading_point,
+        void*                       values) const;
+
     // Evaluate all uniform inputs into a preallocated block of memory.
     // 'values' must be 16-byte aligned.
     void evaluate_uniforms(
@@ -37,11 +37,13 @@
 
 // appleseed.foundation headers.
 #include "foundation/image/tile.h"
+#include "foundation/math/fastmath.h"
 #include "foundation/math/hash.h"
 #include "foundation/math/scalar.h"
 #include "foundation/platform/types.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 
 using namespace foundation;
@@ -141,6 +143,7 @@ namespace
         TextureCache&               texture_cache,
         const UniqueID              assembly_uid,
         const UniqueID              texture_uid,
+        const size_t                level,
         const size_t                tile_x,
         const size_t                tile_y,
         const size_t                pixel_x,
@@ -153,7 +156,8 @@ namespace
                 assembly_uid,
                 texture_uid,
                 tile_x,
-                tile_y);
+                tile_y,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -176,12 +180,23 @@ TextureSource::TextureSource(
   , m_assembly_uid(assembly_uid)
   , m_texture_instance(texture_instance)
   , m_texture_uid(texture_instance.get_texture().get_uid())
-  , m_texture_props(texture_instance.get_texture().properties())
   , m_texture_transform(texture_instance.get_transform())
-  , m_scalar_canvas_width(static_cast<float>(m_texture_props.m_canvas_width))
-  , m_scalar_canvas_height(static_cast<float>(m_texture_props.m_canvas_height))
-  , m_max_x(static_cast<float>(m_texture_props.m_canvas_width - 1))
-  , m_max_y(static_cast<float>(m_texture_props.m_canvas_height - 1))
+{
+    Texture& texture = texture_instance.get_texture();
+
+    m_levels.push_back(Level(texture.properties()));
+
+    const size_t level_count = texture.get_mip_level_count();
+    for (size_t i = 1; i < level_count; ++i)
+        m_levels.push_back(Level(texture.mip_properties(i)));
+}
+
+TextureSource::Level::Level(const CanvasProperties& props)
+  : m_props(props)
+  , m_scalar_canvas_width(static_cast<float>(props.m_canvas_width))
+  , m_scalar_canvas_height(static_cast<float>(props.m_canvas_height))
+  , m_max_x(static_cast<float>(props.m_canvas_width - 1))
+  , m_max_y(static_cast<float>(props.m_canvas_height - 1))
 {
 }
 
@@ -204,17 +219,20 @@ Vector2f TextureSource::apply_transform(const Vector2f& uv) const
 
 Color4f TextureSource::get_texel(
     TextureCache&               texture_cache,
+    const size_t                level,
     const size_t                ix,
     const size_t                iy) const
 {
-    assert(ix < m_texture_props.m_canvas_width);
-    assert(iy < m_texture_props.m_canvas_height);
+    const CanvasProperties& props = m_levels[level].m_props;
+
+    assert(ix < props.m_canvas_width);
+    assert(iy < props.m_canvas_height);
 
     // Compute the coordinates of the tile containing the texel (x, y).
-    const size_t tile_x = truncate<size_t>(ix * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y = truncate<size_t>(iy * m_texture_props.m_rcp_tile_height);
-    assert(tile_x < m_texture_props.m_tile_count_x);
-    assert(tile_y < m_texture_props.m_tile_count_y);
+    const size_t tile_x = truncate<size_t>(ix * props.m_rcp_tile_width);
+    const size_t tile_y = truncate<size_t>(iy * props.m_rcp_tile_height);
+    assert(tile_x < props.m_tile_count_x);
+    assert(tile_y < props.m_tile_count_y);
 
 #ifdef DEBUG_DISPLAY_TEXTURE_TILES
 
@@ -229,10 +247,10 @@ Color4f TextureSource::get_texel(
 #endif
 
     // Compute the tile space coordinates of the texel (x, y).
-    const size_t pixel_x = ix - tile_x * m_texture_props.m_tile_width;
-    const size_t pixel_y = iy - tile_y * m_texture_props.m_tile_height;
-    assert(pixel_x < m_texture_props.m_tile_width);
-    assert(pixel_y < m_texture_props.m_tile_height);
+    const size_t pixel_x = ix - tile_x * props.m_tile_width;
+    const size_t pixel_y = iy - tile_y * props.m_tile_height;
+    assert(pixel_x < props.m_tile_width);
+    assert(pixel_y < props.m_tile_height);
 
     // Sample the tile.
     Color4f sample;
@@ -240,6 +258,7 @@ Color4f TextureSource::get_texel(
         texture_cache,
         m_assembly_uid,
         m_texture_uid,
+        level,
         tile_x,
         tile_y,
         pixel_x,
@@ -251,6 +270,7 @@ Color4f TextureSource::get_texel(
 
 void TextureSource::get_texels_2x2(
     TextureCache&               texture_cache,
+    const size_t                level,
     const int                   ix,
     const int                   iy,
     Color4f&                    t00,
@@ -258,19 +278,21 @@ void TextureSource::get_texels_2x2(
     Color4f&                    t01,
     Color4f&                    t11) const
 {
+    const CanvasProperties& props = m_levels[level].m_props;
+
     const Vector<size_t, 2> p00 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            props.m_canvas_width,
+            props.m_canvas_height,
             ix + 0,
             iy + 0);
 
     const Vector<size_t, 2> p11 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            props.m_canvas_width,
+            props.m_canvas_height,
             ix + 1,
             iy + 1);
 
@@ -278,10 +300,10 @@ void TextureSource::get_texels_2x2(
     const Vector<size_t, 2> p01(p00.x, p11.y);
 
     // Compute the coordinates of the tile containing each texel.
-    const size_t tile_x_00 = truncate<size_t>(p00.x * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y_00 = truncate<size_t>(p00.y * m_texture_props.m_rcp_tile_height);
-    const size_t tile_x_11 = truncate<size_t>(p11.x * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y_11 = truncate<size_t>(p11.y * m_texture_props.m_rcp_tile_height);
+    const size_t tile_x_00 = truncate<size_t>(p00.x * props.m_rcp_tile_width);
+    const size_t tile_y_00 = truncate<size_t>(p00.y * props.m_rcp_tile_height);
+    const size_t tile_x_11 = truncate<size_t>(p11.x * props.m_rcp_tile_width);
+    const size_t tile_y_11 = truncate<size_t>(p11.y * props.m_rcp_tile_height);
 
     // Check whether all four texels are part of the same tile.
     const size_t tile_x_mask = tile_x_00 ^ tile_x_11;
@@ -290,22 +312,22 @@ void TextureSource::get_texels_2x2(
     if (tile_x_mask | tile_y_mask)
     {
         // Compute the tile space coordinates of each texel.
-        const size_t pixel_x_00 = p00.x - tile_x_00 * m_texture_props.m_tile_width;
-        const size_t pixel_y_00 = p00.y - tile_y_00 * m_texture_props.m_tile_height;
-        const size_t pixel_x_11 = p11.x - tile_x_11 * m_texture_props.m_tile_width;
-        const size_t pixel_y_11 = p11.y - tile_y_11 * m_texture_props.m_tile_height;
+        const size_t pixel_x_00 = p00.x - tile_x_00 * props.m_tile_width;
+        const size_t pixel_y_00 = p00.y - tile_y_00 * props.m_tile_height;
+        const size_t pixel_x_11 = p11.x - tile_x_11 * props.m_tile_width;
+        const size_t pixel_y_11 = p11.y - tile_y_11 * props.m_tile_height;
 
         // Sample the tile.
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_00, pixel_x_00, pixel_y_00, t00);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_00, pixel_x_11, pixel_y_00, t10);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_11, pixel_x_00, pixel_y_11, t01);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_11, pixel_x_11, pixel_y_11, t11);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_00, tile_y_00, pixel_x_00, pixel_y_00, t00);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_11, tile_y_00, pixel_x_11, pixel_y_00, t10);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_00, tile_y_11, pixel_x_00, pixel_y_11, t01);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_11, tile_y_11, pixel_x_11, pixel_y_11, t11);
     }
     else
     {
         // Compute the tile space coordinates of each texel.
-        const size_t org_x = tile_x_00 * m_texture_props.m_tile_width;
-        const size_t org_y = tile_y_00 * m_texture_props.m_tile_height;
+        const size_t org_x = tile_x_00 * props.m_tile_width;
+        const size_t org_y = tile_y_00 * props.m_tile_height;
         const size_t pixel_x_00 = p00.x - org_x;
         const size_t pixel_y_00 = p00.y - org_y;
         const size_t pixel_x_11 = p11.x - org_x;
@@ -317,7 +339,8 @@ void TextureSource::get_texels_2x2(
                 m_assembly_uid,
                 m_texture_uid,
                 tile_x_00,
-                tile_y_00);
+                tile_y_00,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -369,37 +392,100 @@ Color4f TextureSource::sample_texture(
     // Apply the texture addressing mode.
     apply_addressing_mode(m_texture_instance.get_addressing_mode(), p);
 
+    return sample_level(texture_cache, 0, p);
+}
+
+Color4f TextureSource::sample_texture(
+    TextureCache&               texture_cache,
+    const Vector2f&             uv,
+    const Vector2f&             duvdx,
+    const Vector2f&             duvdy) const
+{
+    // Without MIP levels, there is nothing to choose from.
+    if (m_levels.size() == 1)
+        return sample_texture(texture_cache, uv);
+
+    // Start with the transformed input texture coordinates.
+    Vector2f p = apply_transform(uv);
+    p.y = 1.0f - p.y;
+
+    // Apply the texture addressing mode.
+    apply_addressing_mode(m_texture_instance.get_addressing_mode(), p);
+
+    // Transform the derivatives into texel space of level 0.
+    const Vector3f dpdx = m_texture_transform.vector_to_local(Vector3f(duvdx.x, duvdx.y, 0.0f));
+    const Vector3f dpdy = m_texture_transform.vector_to_local(Vector3f(duvdy.x, duvdy.y, 0.0f));
+    const Level& base = m_levels[0];
+    const float footprint_x = norm(Vector2f(dpdx.x * base.m_scalar_canvas_width, dpdx.y * base.m_scalar_canvas_height));
+    const float footprint_y = norm(Vector2f(dpdy.x * base.m_scalar_canvas_width, dpdy.y * base.m_scalar_canvas_height));
+    const float footprint = max(footprint_x, footprint_y);
+
+    // Texels of level 0 cover the footprint.
+    if (!(footprint > 1.0f))
+        return sample_level(texture_cache, 0, p);
+
+    // Select the level whose texels best match the footprint.
+    const float max_level = static_cast<float>(m_levels.size() - 1);
+    const float lod = min(fast_log2(footprint), max_level);
+
+    if (m_texture_instance.get_filtering_mode() == TextureFilteringNearest)
+        return sample_level(texture_cache, round<size_t>(lod), p);
+
+    // Blend the two nearest levels.
+    const size_t level = truncate<size_t>(lod);
+    const float t = lod - static_cast<float>(level);
+    Color4f color = sample_level(texture_cache, level, p);
+
+    if (t > 0.0f)
+    {
+        color *= 1.0f - t;
+        color += t * sample_level(texture_cache, level + 1, p);
+    }
+
+    return color;
+}
+
+Color4f TextureSource::sample_level(
+    TextureCache&               texture_cache,
+    const size_t                level,
+    const Vector2f&             p) const
+{
+    assert(level < m_levels.size());
+
+    const Level& l = m_levels[level];
+
     switch (m_texture_instance.get_filtering_mode())
     {
       case TextureFilteringNearest:
         {
-            p.x = clamp(p.x * m_scalar_canvas_width, 0.0f, m_max_x);
-            p.y = clamp(p.y * m_scalar_canvas_height, 0.0f, m_max_y);
+            const float x = clamp(p.x * l.m_scalar_canvas_width, 0.0f, l.m_max_x);
+            const float y = clamp(p.y * l.m_scalar_canvas_height, 0.0f, l.m_max_y);
 
-            const size_t ix = truncate<size_t>(p.x);
-            const size_t iy = truncate<size_t>(p.y);
+            const size_t ix = truncate<size_t>(x);
+            const size_t iy = truncate<size_t>(y);
 
-            return get_texel(texture_cache, ix, iy);
+            return get_texel(texture_cache, level, ix, iy);
         }
 
       case TextureFilteringBilinear:
         {
-            p.x *= m_max_x;
-            p.y *= m_max_y;
+            const float x = p.x * l.m_max_x;
+            const float y = p.y * l.m_max_y;
 
-            const int ix = truncate<int>(p.x);
-            const int iy = truncate<int>(p.y);
+            const int ix = truncate<int>(x);
+            const int iy = truncate<int>(y);
 
             // Retrieve the four surrounding texels.
             Color4f t00, t10, t01, t11;
             get_texels_2x2(
                 texture_cache,
+                level,
                 ix, iy,
                 t00, t10, t01, t11);
 
             // Compute weights.
-            const float wx1 = p.x - ix;
-            const float wy1 = p.y - iy;
+            const float wx1 = x - ix;
+            const float wy1 = y - iy;
             const float wx0 = 1.0f - wx1;
             const float wy0 = 1.0f - wy1;
 
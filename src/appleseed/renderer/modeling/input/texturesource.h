@@ -46,6 +46,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace renderer      { class TextureCache; }
@@ -100,16 +101,65 @@ class TextureSource
         Spectrum&                           spectrum,
         Alpha&                              alpha) const APPLESEED_OVERRIDE;
 
+    // Evaluate the source at a given shading point, selecting the MIP level
+    // of the texture from the screen space footprint of the shading point.
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        float&                              scalar) const APPLESEED_OVERRIDE;
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        foundation::Color3f&                linear_rgb) const APPLESEED_OVERRIDE;
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        Spectrum&                           spectrum) const APPLESEED_OVERRIDE;
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        Alpha&                              alpha) const APPLESEED_OVERRIDE;
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        foundation::Color3f&                linear_rgb,
+        Alpha&                              alpha) const APPLESEED_OVERRIDE;
+    virtual void evaluate(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy,
+        Spectrum&                           spectrum,
+        Alpha&                              alpha) const APPLESEED_OVERRIDE;
+
   private:
+    // Cached properties of one MIP level of the texture.
+    struct Level
+    {
+        foundation::CanvasProperties        m_props;
+        float                               m_scalar_canvas_width;
+        float                               m_scalar_canvas_height;
+        float                               m_max_x;
+        float                               m_max_y;
+
+        explicit Level(const foundation::CanvasProperties& props);
+    };
+
     const foundation::UniqueID              m_assembly_uid;
     const TextureInstance&                  m_texture_instance;
     const foundation::UniqueID              m_texture_uid;
-    const foundation::CanvasProperties      m_texture_props;
     const foundation::Transformf            m_texture_transform;
-    const float                             m_scalar_canvas_width;
-    const float                             m_scalar_canvas_height;
-    const float                             m_max_x;
-    const float                             m_max_y;
+    std::vector<Level>                      m_levels;
 
     // Apply the texture instance transform to UV coordinates.
     foundation::Vector2f apply_transform(
@@ -118,12 +168,14 @@ class TextureSource
     // Retrieve a given texel. Return a color in the linear RGB color space.
     foundation::Color4f get_texel(
         TextureCache&                       texture_cache,
+        const size_t                        level,
         const size_t                        ix,
         const size_t                        iy) const;
 
     // Retrieve a 2x2 block of texels. Texels are expressed in the linear RGB color space.
     void get_texels_2x2(
         TextureCache&                       texture_cache,
+        const size_t                        level,
         const int                           ix,
         const int                           iy,
         foundation::Color4f&                t00,
@@ -131,11 +183,25 @@ class TextureSource
         foundation::Color4f&                t01,
         foundation::Color4f&                t11) const;
 
+    // Sample a given MIP level of the texture at a point in [0,1]^2.
+    foundation::Color4f sample_level(
+        TextureCache&                       texture_cache,
+        const size_t                        level,
+        const foundation::Vector2f&         p) const;
+
     // Sample the texture. Return a color in the linear RGB color space.
     foundation::Color4f sample_texture(
         TextureCache&                       texture_cache,
         const foundation::Vector2f&         uv) const;
 
+    // Sample the texture with a filter footprint given by the screen space
+    // derivatives of the texture coordinates. Return a color in the linear RGB color space.
+    foundation::Color4f sample_texture(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2f&         uv,
+        const foundation::Vector2f&         duvdx,
+        const foundation::Vector2f&         duvdy) const;
+
     // Compute an alpha value given a linear RGBA color and the alpha mode of the texture instance.
     void evaluate_alpha(
         const foundation::Color4f&          color,
@@ -210,6 +276,76 @@ inline void TextureSource::evaluate(
     evaluate_alpha(color, alpha);
 }
 
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    float&                                  scalar) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    scalar = color[0];
+}
+
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    foundation::Color3f&                    linear_rgb) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    linear_rgb = color.rgb();
+}
+
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    Spectrum&                               spectrum) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    spectrum = color.rgb();
+}
+
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    Alpha&                                  alpha) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    evaluate_alpha(color, alpha);
+}
+
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    foundation::Color3f&                    linear_rgb,
+    Alpha&                                  alpha) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    linear_rgb = color.rgb();
+    evaluate_alpha(color, alpha);
+}
+
+inline void TextureSource::evaluate(
+    TextureCache&                           texture_cache,
+    const foundation::Vector2f&             uv,
+    const foundation::Vector2f&             duvdx,
+    const foundation::Vector2f&             duvdy,
+    Spectrum&                               spectrum,
+    Alpha&                                  alpha) const
+{
+    const foundation::Color4f color = sample_texture(texture_cache, uv, duvdx, duvdy);
+    spectrum = color.rgb();
+    evaluate_alpha(color, alpha);
+}
+
 inline void TextureSource::evaluate_alpha(
     const foundation::Color4f&              color,
     Alpha&                                  alpha) const
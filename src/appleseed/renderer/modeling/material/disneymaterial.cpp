@@ -35,6 +35,7 @@
 #include "renderer/modeling/bsdf/disneylayeredbrdf.h"
 #include "renderer/modeling/scene/containers.h"
 #include "renderer/utility/seexpr.h"
+#include "renderer/utility/seexprprogram.h"
 
 // appleseed.foundation headers.
 #include "foundation/image/colorspace.h"
@@ -48,6 +49,7 @@
 // Boost headers.
 #include "boost/algorithm/string.hpp"
 #include "boost/algorithm/string/split.hpp"
+#include "boost/shared_ptr.hpp"
 
 // Standard headers.
 #include <algorithm>
@@ -254,6 +256,8 @@ struct DisneyMaterialLayer::Impl
     {
     }
 
+    enum { ProgramOutputCount = 11 };
+
     const string            m_name;
     const int               m_layer_number;
     DisneyLayerParam        m_mask;
@@ -268,6 +272,44 @@ struct DisneyMaterialLayer::Impl
     DisneyLayerParam        m_sheen_tint;
     DisneyLayerParam        m_clearcoat;
     DisneyLayerParam        m_clearcoat_gloss;
+
+    // All parameters but the mask compiled into a single program, shared by the per-thread copies of the layer.
+    boost::shared_ptr<const SeExprProgram>  m_program;
+    mutable SeExprProgram::Registers        m_registers;
+
+    void compile_program()
+    {
+        const DisneyLayerParam* params[ProgramOutputCount] =
+        {
+            &m_base_color,
+            &m_subsurface,
+            &m_metallic,
+            &m_specular,
+            &m_specular_tint,
+            &m_anisotropic,
+            &m_roughness,
+            &m_sheen,
+            &m_sheen_tint,
+            &m_clearcoat,
+            &m_clearcoat_gloss
+        };
+
+        boost::shared_ptr<SeExprProgram> program(new SeExprProgram());
+
+        for (size_t i = 0; i < ProgramOutputCount; ++i)
+        {
+            if (!program->add_output(params[i]->expression()))
+            {
+                RENDERER_LOG_DEBUG(
+                    "layer \"%s\" will use the expression interpreter because the expression \"%s\" cannot be compiled.",
+                    m_name.c_str(),
+                    params[i]->expression().c_str());
+                return;
+            }
+        }
+
+        m_program = program;
+    }
 };
 
 DisneyMaterialLayer::DisneyMaterialLayer(
@@ -313,7 +355,7 @@ int DisneyMaterialLayer::get_layer_number() const
 
 bool DisneyMaterialLayer::prepare_expressions() const
 {
-    return
+    const bool success =
         impl->m_mask.prepare() &&
         impl->m_base_color.prepare() &&
         impl->m_subsurface.prepare() &&
@@ -326,6 +368,12 @@ bool DisneyMaterialLayer::prepare_expressions() const
         impl->m_sheen_tint.prepare() &&
         impl->m_clearcoat.prepare() &&
         impl->m_clearcoat_gloss.prepare();
+
+    // Per-thread copies of the layer inherit the program of the original layer.
+    if (success && !impl->m_program)
+        impl->compile_program();
+
+    return success;
 }
 
 void DisneyMaterialLayer::evaluate_expressions(
@@ -339,71 +387,43 @@ void DisneyMaterialLayer::evaluate_expressions(
     if (mask == 0.0f)
         return;
 
-    base_color =
-        lerp(
-            base_color,
-            impl->m_base_color.evaluate(shading_point, texture_system),
-            mask);
-
-    values.m_subsurface =
-        lerp(
-            values.m_subsurface,
-            saturate(impl->m_subsurface.evaluate(shading_point, texture_system)[0]),
-            mask);
-
-    values.m_metallic =
-        lerp(
-            values.m_metallic,
-            saturate(impl->m_metallic.evaluate(shading_point, texture_system)[0]),
-            mask);
-
-    values.m_specular =
-        lerp(
-            values.m_specular,
-            max(impl->m_specular.evaluate(shading_point, texture_system)[0], 0.0f),
-            mask);
-
-    values.m_specular_tint =
-        lerp(
-            values.m_specular_tint,
-            saturate(impl->m_specular_tint.evaluate(shading_point, texture_system)[0]),
-            mask);
-
-    values.m_anisotropic =
-        lerp(
-            values.m_anisotropic,
-            clamp(impl->m_anisotropic.evaluate(shading_point, texture_system)[0], -1.0f, 1.0f),
-            mask);
-
-    values.m_roughness =
-        lerp(
-            values.m_roughness,
-            clamp(impl->m_roughness.evaluate(shading_point, texture_system)[0], 0.001f, 1.0f),
-            mask);
-
-    values.m_sheen =
-        lerp(
-            values.m_sheen,
-            impl->m_sheen.evaluate(shading_point, texture_system)[0],
-            mask);
-
-    values.m_sheen_tint =
-        lerp(
-            values.m_sheen_tint,
-            saturate(impl->m_sheen_tint.evaluate(shading_point, texture_system)[0]),
-            mask);
-
-    values.m_clearcoat =
-        lerp(
-            values.m_clearcoat,
-            impl->m_clearcoat.evaluate(shading_point, texture_system)[0],
-            mask);
-
-    values.m_clearcoat_gloss =
-        lerp(
-            values.m_clearcoat_gloss,
-            saturate(impl->m_clearcoat_gloss.evaluate(shading_point, texture_system)[0]),
-            mask);
+    Color3f results[Impl::ProgramOutputCount];
+
+    if (impl->m_program)
+    {
+        impl->m_program->evaluate(
+            1,
+            &shading_point.get_uv(0),
+            texture_system,
+            impl->m_registers,
+            results);
+    }
+    else
+    {
+        results[0] = impl->m_base_color.evaluate(shading_point, texture_system);
+        results[1] = impl->m_subsurface.evaluate(shading_point, texture_system);
+        results[2] = impl->m_metallic.evaluate(shading_point, texture_system);
+        results[3] = impl->m_specular.evaluate(shading_point, texture_system);
+        results[4] = impl->m_specular_tint.evaluate(shading_point, texture_system);
+        results[5] = impl->m_anisotropic.evaluate(shading_point, texture_system);
+        results[6] = impl->m_roughness.evaluate(shading_point, texture_system);
+        results[7] = impl->m_sheen.evaluate(shading_point, texture_system);
+        results[8] = impl->m_sheen_tint.evaluate(shading_point, texture_system);
+        results[9] = impl->m_clearcoat.evaluate(shading_point, texture_system);
+        results[10] = impl->m_clearcoat_gloss.evaluate(shading_point, texture_system);
+    }
+
+    base_color = lerp(base_color, results[0], mask);
+    values.m_subsurface = lerp(values.m_subsurface, saturate(results[1][0]), mask);
+    values.m_metallic = lerp(values.m_metallic, saturate(results[2][0]), mask);
+    values.m_specular = lerp(values.m_specular, max(results[3][0], 0.0f), mask);
+    values.m_specular_tint = lerp(values.m_specular_tint, saturate(results[4][0]), mask);
+    values.m_anisotropic = lerp(values.m_anisotropic, clamp(results[5][0], -1.0f, 1.0f), mask);
+    values.m_roughness = lerp(values.m_roughness, clamp(results[6][0], 0.001f, 1.0f), mask);
+    values.m_sheen = lerp(values.m_sheen, results[7][0], mask);
+    values.m_sheen_tint = lerp(values.m_sheen_tint, saturate(results[8][0]), mask);
+    values.m_clearcoat = lerp(values.m_clearcoat, results[9][0], mask);
+    values.m_clearcoat_gloss = lerp(values.m_clearcoat_gloss, saturate(results[10][0]), mask);
 }
 
 DictionaryArray DisneyMaterialLayer::get_input_metadata()
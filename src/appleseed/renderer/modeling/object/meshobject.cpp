@@ -197,6 +197,11 @@ const GVector3& MeshObject::get_vertex(const size_t index) const
     return impl->m_tess.m_vertices[index];
 }
 
+void MeshObject::clear_vertices()
+{
+    impl->m_tess.m_vertices.clear();
+}
+
 void MeshObject::reserve_vertex_normals(const size_t count)
 {
     impl->m_tess.m_vertex_normals.reserve(count);
@@ -266,6 +271,11 @@ GVector2 MeshObject::get_tex_coords(const size_t index) const
     return impl->m_tess.get_tex_coords(index);
 }
 
+void MeshObject::clear_tex_coords()
+{
+    impl->m_tess.clear_tex_coords();
+}
+
 void MeshObject::reserve_triangles(const size_t count)
 {
     impl->m_tess.m_primitives.reserve(count);
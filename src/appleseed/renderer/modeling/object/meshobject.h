@@ -106,6 +106,7 @@ class APPLESEED_DLLSYMBOL MeshObject
     size_t push_vertex(const GVector3& vertex);
     size_t get_vertex_count() const;
     const GVector3& get_vertex(const size_t index) const;
+    void clear_vertices();
 
     // Insert and access vertex normals.
     void reserve_vertex_normals(const size_t count);
@@ -125,6 +126,7 @@ class APPLESEED_DLLSYMBOL MeshObject
     size_t push_tex_coords(const GVector2& tex_coords);
     size_t get_tex_coords_count() const;
     GVector2 get_tex_coords(const size_t index) const;
+    void clear_tex_coords();
 
     // Insert and access triangles.
     void reserve_triangles(const size_t count);
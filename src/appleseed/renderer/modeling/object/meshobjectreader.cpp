@@ -50,6 +50,7 @@
 #include "foundation/mesh/objmeshfilereader.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/defaulttimers.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/autoreleaseptr.h"
@@ -403,9 +404,11 @@ namespace
         const char*             filename,
         const char*             base_object_name,
         const ParamArray&       params,
+        const size_t            thread_count,
         MeshObjectArray&        objects)
     {
         GenericMeshFileReader reader(filename);
+        reader.set_thread_count(thread_count);
 
         const string obj_parsing_mode = params.get_optional<string>("obj_parsing_mode", "fast");
 
@@ -714,6 +717,7 @@ namespace
         const StringDictionary& filenames,
         const char*             base_object_name,
         const ParamArray&       params,
+        const size_t            thread_count,
         MeshObjectArray&        objects)
     {
         assert(filenames.size() >= 2);
@@ -734,6 +738,7 @@ namespace
                 search_paths.qualify(key_frames[0].m_filename).c_str(),
                 base_object_name,
                 params,
+                thread_count,
                 objects))
             return false;
 
@@ -756,6 +761,7 @@ namespace
                     search_paths.qualify(filename).c_str(),
                     base_object_name,
                     params,
+                    thread_count,
                     poses))
                 return false;
 
@@ -823,10 +829,14 @@ bool MeshObjectReader::read(
     const SearchPaths&  search_paths,
     const char*         base_object_name,
     const ParamArray&   params,
-    MeshObjectArray&    objects)
+    MeshObjectArray&    objects,
+    const size_t        thread_count)
 {
     assert(base_object_name);
 
+    const size_t reader_thread_count =
+        thread_count > 0 ? thread_count : System::get_logical_cpu_core_count();
+
     // Handle built-in primitives.
     if (params.strings().exist("primitive"))
     {
@@ -859,6 +869,7 @@ bool MeshObjectReader::read(
                 search_paths.qualify(params.strings().get<string>("filename")).c_str(),
                 base_object_name,
                 completed_params,
+                reader_thread_count,
                 objects))
             return false;
     }
@@ -884,6 +895,7 @@ bool MeshObjectReader::read(
                         search_paths.qualify(filenames.begin().value()).c_str(),
                         base_object_name,
                         completed_params,
+                        reader_thread_count,
                         objects))
                     return false;
             }
@@ -907,6 +919,7 @@ bool MeshObjectReader::read(
                         filenames,
                         base_object_name,
                         completed_params,
+                        reader_thread_count,
                         objects))
                     return false;
             }
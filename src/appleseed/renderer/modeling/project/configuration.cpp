@@ -31,6 +31,7 @@
 #include "configuration.h"
 
 // appleseed.renderer headers.
+#include "renderer/kernel/lighting/lightsampler.h"
 #include "renderer/kernel/lighting/pt/ptlightingengine.h"
 #include "renderer/kernel/lighting/sppm/sppmlightingengine.h"
 #include "renderer/kernel/rendering/final/adaptivepixelrenderer.h"
@@ -178,6 +179,10 @@ Dictionary Configuration::get_metadata()
         "progressive_frame_renderer",
         ProgressiveFrameRendererFactory::get_params_metadata());
 
+    metadata.dictionaries().insert(
+        "light_sampler",
+        LightSampler::get_params_metadata());
+
     metadata.dictionaries().insert("pt", PTLightingEngineFactory::get_params_metadata());
     metadata.dictionaries().insert("sppm", SPPMLightingEngineFactory::get_params_metadata());
 
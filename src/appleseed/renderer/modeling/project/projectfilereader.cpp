@@ -99,25 +99,33 @@
 #include "renderer/utility/transformsequence.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/core/exceptions/exceptionunsupportedfileformat.h"
 #include "foundation/math/aabb.h"
 #include "foundation/math/matrix.h"
+#include "foundation/math/population.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/transform.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/defaulttimers.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/foreach.h"
 #include "foundation/utility/iterators.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/log.h"
 #include "foundation/utility/memory.h"
 #include "foundation/utility/otherwise.h"
 #include "foundation/utility/searchpaths.h"
+#include "foundation/utility/statistics.h"
 #include "foundation/utility/stopwatch.h"
 #include "foundation/utility/string.h"
+#include "foundation/utility/uid.h"
 #include "foundation/utility/xercesc.h"
 #include "foundation/utility/zip.h"
 
@@ -203,6 +211,248 @@ namespace
     };
 
 
+    //
+    // Reads the geometry files referenced by <object> elements on a pool of
+    // worker threads while the rest of the project file is being parsed.
+    // The objects are inserted into their assemblies once parsing is done.
+    //
+
+    class ObjectLoader
+      : public NonCopyable
+    {
+      public:
+        typedef vector<Object*> ObjectVector;
+
+        struct Load
+        {
+            string                  m_name;
+            string                  m_model;
+            ParamArray              m_params;
+            SearchPaths             m_search_paths;
+            UniqueID                m_assembly_uid;     // assembly receiving the objects, set once it is created
+            ObjectVector            m_objects;
+            bool                    m_success;
+            double                  m_seconds;
+        };
+
+        ObjectLoader()
+          : m_cumulative_seconds(0.0)
+        {
+        }
+
+        ~ObjectLoader()
+        {
+            // Parsing may have been interrupted before all loads were collected.
+            if (m_job_manager.get())
+                m_job_queue.wait_until_completion();
+
+            for (each<vector<Load*> > i = m_loads; i; ++i)
+            {
+                for (const_each<ObjectVector> j = (*i)->m_objects; j; ++j)
+                    (*j)->release();
+
+                delete *i;
+            }
+        }
+
+        // Schedule the reading of an object. The returned load is owned by the loader.
+        Load* schedule(
+            const string&           name,
+            const string&           model,
+            const ParamArray&       params,
+            const SearchPaths&      search_paths)
+        {
+            if (m_job_manager.get() == 0)
+            {
+                m_job_manager.reset(
+                    new JobManager(
+                        global_logger(),
+                        m_job_queue,
+                        System::get_logical_cpu_core_count(),
+                        JobManager::KeepRunningOnEmptyQueue));
+                m_job_manager->start();
+                m_stopwatch.start();
+            }
+
+            Load* load = new Load();
+            load->m_name = name;
+            load->m_model = model;
+            load->m_params = params;
+            load->m_search_paths = search_paths;
+            load->m_assembly_uid = ~UniqueID(0);
+            load->m_success = false;
+            load->m_seconds = 0.0;
+            m_loads.push_back(load);
+
+            m_job_queue.schedule(new LoadingJob(*load));
+
+            return load;
+        }
+
+        // Wait until all scheduled loads are completed, then insert the objects into
+        // the assemblies of a scene, in the order in which the loads were scheduled.
+        void insert_objects(Scene* scene, EventCounters& event_counters)
+        {
+            if (m_job_manager.get() == 0)
+                return;
+
+            m_job_queue.wait_until_completion();
+            m_stopwatch.measure();
+
+            AssemblyMap assemblies;
+            if (scene)
+                gather_assemblies(scene->assemblies(), assemblies);
+
+            for (each<vector<Load*> > i = m_loads; i; ++i)
+            {
+                Load& load = **i;
+
+                m_load_times.insert(load.m_seconds);
+                m_cumulative_seconds += load.m_seconds;
+
+                if (!load.m_success)
+                {
+                    event_counters.signal_error();
+                    continue;
+                }
+
+                // Objects of assemblies that could not be created are released with the load.
+                const AssemblyMap::const_iterator assembly = assemblies.find(load.m_assembly_uid);
+                if (assembly == assemblies.end())
+                    continue;
+
+                ObjectContainer& objects = assembly->second->objects();
+
+                for (const_each<ObjectVector> j = load.m_objects; j; ++j)
+                {
+                    auto_release_ptr<Object> object(*j);
+
+                    if (objects.get_by_name(object->get_name()) != 0)
+                    {
+                        RENDERER_LOG_ERROR(
+                            "an entity with the path \"%s\" already exists.",
+                            object->get_path().c_str());
+                        event_counters.signal_error();
+                        continue;
+                    }
+
+                    objects.insert(object);
+                }
+
+                load.m_objects.clear();
+            }
+        }
+
+        void print_statistics() const
+        {
+            if (m_load_times.get_size() == 0)
+                return;
+
+            Statistics stats;
+            stats.insert<uint64>("objects", m_load_times.get_size());
+            stats.insert("load time", m_load_times, "s");
+            stats.insert_time("cumulative time", m_cumulative_seconds);
+            stats.insert_time("wall clock time", m_stopwatch.get_seconds());
+
+            RENDERER_LOG_INFO("%s",
+                StatisticsVector::make(
+                    "object loading statistics",
+                    stats).to_string().c_str());
+        }
+
+      private:
+        typedef map<UniqueID, Assembly*> AssemblyMap;
+
+        class LoadingJob
+          : public IJob
+        {
+          public:
+            explicit LoadingJob(Load& load)
+              : m_load(load)
+            {
+            }
+
+            virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+            {
+                Stopwatch<DefaultWallclockTimer> stopwatch;
+                stopwatch.start();
+
+                try
+                {
+                    if (m_load.m_model == MeshObjectFactory::get_model())
+                    {
+                        // Files are already read in parallel: parse each of them on a single thread.
+                        MeshObjectArray object_array;
+                        if (MeshObjectReader::read(
+                                m_load.m_search_paths,
+                                m_load.m_name.c_str(),
+                                m_load.m_params,
+                                object_array,
+                                1))
+                        {
+                            m_load.m_objects = array_vector<ObjectVector>(object_array);
+                            m_load.m_success = true;
+                        }
+                    }
+                    else
+                    {
+                        assert(m_load.m_model == CurveObjectFactory::get_model());
+
+                        m_load.m_objects.push_back(
+                            CurveObjectReader::read(
+                                m_load.m_search_paths,
+                                m_load.m_name.c_str(),
+                                m_load.m_params).release());
+                        m_load.m_success = true;
+                    }
+                }
+                catch (const ExceptionDictionaryKeyNotFound& e)
+                {
+                    RENDERER_LOG_ERROR(
+                        "while defining object \"%s\": required parameter \"%s\" missing.",
+                        m_load.m_name.c_str(),
+                        e.string());
+                }
+                catch (const ExceptionUnsupportedFileFormat& e)
+                {
+                    RENDERER_LOG_ERROR(
+                        "while defining object \"%s\": format of file %s is not supported.",
+                        m_load.m_name.c_str(),
+                        e.string());
+                }
+                catch (const exception& e)
+                {
+                    RENDERER_LOG_ERROR(
+                        "while defining object \"%s\": %s.",
+                        m_load.m_name.c_str(),
+                        e.what());
+                }
+
+                m_load.m_seconds = stopwatch.measure().get_seconds();
+            }
+
+          private:
+            Load& m_load;
+        };
+
+        static void gather_assemblies(AssemblyContainer& assemblies, AssemblyMap& map)
+        {
+            for (each<AssemblyContainer> i = assemblies; i; ++i)
+            {
+                map[i->get_uid()] = &*i;
+                gather_assemblies(i->assemblies(), map);
+            }
+        }
+
+        JobQueue                            m_job_queue;
+        auto_ptr<JobManager>                m_job_manager;
+        vector<Load*>                       m_loads;
+        Stopwatch<DefaultWallclockTimer>    m_stopwatch;
+        Population<double>                  m_load_times;
+        double                              m_cumulative_seconds;
+    };
+
+
     //
     // A set of objects that is passed to all element handlers.
     //
@@ -235,10 +485,16 @@ namespace
             return m_event_counters;
         }
 
+        ObjectLoader& get_object_loader()
+        {
+            return m_object_loader;
+        }
+
       private:
         Project&            m_project;
         const int           m_options;
         EventCounters&      m_event_counters;
+        ObjectLoader        m_object_loader;
     };
 
 
@@ -1566,10 +1822,11 @@ namespace
       : public ParametrizedElementHandler
     {
       public:
-        typedef vector<Object*> ObjectVector;
+        typedef ObjectLoader::ObjectVector ObjectVector;
 
         explicit ObjectElementHandler(ParseContext& context)
           : m_context(context)
+          , m_load(0)
         {
         }
 
@@ -1578,6 +1835,7 @@ namespace
             ParametrizedElementHandler::start_element(attrs);
 
             clear_keep_memory(m_objects);
+            m_load = 0;
 
             m_name = get_value(attrs, "name");
             m_model = get_value(attrs, "model");
@@ -1587,54 +1845,37 @@ namespace
         {
             ParametrizedElementHandler::end_element();
 
-            try
+            if (m_model != MeshObjectFactory::get_model() &&
+                m_model != CurveObjectFactory::get_model())
+            {
+                RENDERER_LOG_ERROR(
+                    "while defining object \"%s\": invalid model \"%s\".",
+                    m_name.c_str(),
+                    m_model.c_str());
+                m_context.get_event_counters().signal_error();
+                return;
+            }
+
+            if (m_context.get_options() & ProjectFileReader::OmitReadingMeshFiles)
             {
                 if (m_model == MeshObjectFactory::get_model())
-                {
-                    if (m_context.get_options() & ProjectFileReader::OmitReadingMeshFiles)
-                    {
-                        m_objects.push_back(
-                            MeshObjectFactory::create(
-                                m_name.c_str(),
-                                m_params).release());
-                    }
-                    else
-                    {
-                        MeshObjectArray object_array;
-                        if (MeshObjectReader::read(
-                                m_context.get_project().search_paths(),
-                                m_name.c_str(),
-                                m_params,
-                                object_array))
-                            m_objects = array_vector<ObjectVector>(object_array);
-                        else m_context.get_event_counters().signal_error();
-                    }
-                }
-                else if (m_model == CurveObjectFactory::get_model())
                 {
                     m_objects.push_back(
-                        CurveObjectReader::read(
-                            m_context.get_project().search_paths(),
+                        MeshObjectFactory::create(
                             m_name.c_str(),
                             m_params).release());
-                }
-                else
-                {
-                    RENDERER_LOG_ERROR(
-                        "while defining object \"%s\": invalid model \"%s\".",
-                        m_name.c_str(),
-                        m_model.c_str());
-                    m_context.get_event_counters().signal_error();
+                    return;
                 }
             }
-            catch (const ExceptionDictionaryKeyNotFound& e)
-            {
-                RENDERER_LOG_ERROR(
-                    "while defining object \"%s\": required parameter \"%s\" missing.",
-                    m_name.c_str(),
-                    e.string());
-                m_context.get_event_counters().signal_error();
-            }
+
+            // Geometry files are read in the background; the objects are inserted into
+            // the enclosing assembly once the whole project file is parsed.
+            m_load =
+                m_context.get_object_loader().schedule(
+                    m_name,
+                    m_model,
+                    m_params,
+                    m_context.get_project().search_paths());
         }
 
         const ObjectVector& get_objects() const
@@ -1642,11 +1883,17 @@ namespace
             return m_objects;
         }
 
+        ObjectLoader::Load* get_pending_load() const
+        {
+            return m_load;
+        }
+
       private:
-        ParseContext&   m_context;
-        ObjectVector    m_objects;
-        string          m_name;
-        string          m_model;
+        ParseContext&           m_context;
+        ObjectVector            m_objects;
+        ObjectLoader::Load*     m_load;
+        string                  m_name;
+        string                  m_model;
     };
 
 
@@ -2069,6 +2316,7 @@ namespace
             m_materials.clear();
             m_objects.clear();
             m_object_instances.clear();
+            m_pending_loads.clear();
             m_shader_groups.clear();
             m_surface_shaders.clear();
             m_textures.clear();
@@ -2103,6 +2351,10 @@ namespace
                 m_assembly->surface_shaders().swap(m_surface_shaders);
                 m_assembly->textures().swap(m_textures);
                 m_assembly->texture_instances().swap(m_texture_instances);
+
+                // Objects still being read are inserted into the assembly at the end of parsing.
+                for (const_each<vector<ObjectLoader::Load*> > i = m_pending_loads; i; ++i)
+                    (*i)->m_assembly_uid = m_assembly->get_uid();
             }
             else
             {
@@ -2169,9 +2421,13 @@ namespace
                 break;
 
               case ElementObject:
-                for (const_each<ObjectElementHandler::ObjectVector> i =
-                        static_cast<ObjectElementHandler*>(handler)->get_objects(); i; ++i)
-                    insert(m_objects, auto_release_ptr<Object>(*i));
+                {
+                    ObjectElementHandler* object_handler = static_cast<ObjectElementHandler*>(handler);
+                    for (const_each<ObjectElementHandler::ObjectVector> i = object_handler->get_objects(); i; ++i)
+                        insert(m_objects, auto_release_ptr<Object>(*i));
+                    if (object_handler->get_pending_load())
+                        m_pending_loads.push_back(object_handler->get_pending_load());
+                }
                 break;
 
               case ElementObjectInstance:
@@ -2217,6 +2473,7 @@ namespace
 
       private:
         auto_release_ptr<Assembly>  m_assembly;
+        vector<ObjectLoader::Load*> m_pending_loads;
         string                      m_name;
         string                      m_model;
         AssemblyContainer           m_assemblies;
@@ -3440,6 +3697,10 @@ auto_release_ptr<Project> ProjectFileReader::load_project_file(
         return auto_release_ptr<Project>(0);
     }
 
+    // Insert the objects read in the background into their assemblies.
+    context.get_object_loader().insert_objects(project->get_scene(), event_counters);
+    context.get_object_loader().print_statistics();
+
     // Report a failure in case of warnings or errors.
     if (error_handler->get_warning_count() > 0 ||
         error_handler->get_error_count() > 0 ||
@@ -31,6 +31,7 @@
 #include "basegroup.h"
 
 // appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
 #include "renderer/modeling/color/colorentity.h"
 #include "renderer/modeling/scene/assembly.h"
 #include "renderer/modeling/scene/assemblyinstance.h"
@@ -39,10 +40,19 @@
 #include "renderer/modeling/texture/texture.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/thread.h"
 #include "foundation/utility/foreach.h"
-#include "foundation/utility/job/abortswitch.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <algorithm>
+#include <vector>
 
 using namespace foundation;
+using namespace std;
 
 namespace renderer
 {
@@ -97,33 +107,167 @@ ShaderGroupContainer& BaseGroup::shader_groups() const
     return impl->m_shader_groups;
 }
 
+namespace
+{
+    // Create the OSL shader groups of a group and of its child assemblies,
+    // and collect the shader groups that still need to be optimized.
+    bool create_osl_shader_groups(
+        BaseGroup&              group,
+        OSL::ShadingSystem&     shading_system,
+        vector<ShaderGroup*>&   created_shader_groups,
+        IAbortSwitch*           abort_switch)
+    {
+        for (each<AssemblyContainer> i = group.assemblies(); i; ++i)
+        {
+            if (is_aborted(abort_switch))
+                return true;
+
+            if (!create_osl_shader_groups(*i, shading_system, created_shader_groups, abort_switch))
+                return false;
+        }
+
+        for (each<ShaderGroupContainer> i = group.shader_groups(); i; ++i)
+        {
+            if (is_aborted(abort_switch))
+                return true;
+
+            if (i->is_optimized())
+                continue;
+
+            // Shader groups whose optimization was aborted are already created.
+            if (!i->create_osl_shader_group(shading_system, abort_switch))
+                return false;
+
+            // The shader group is not created if setup was aborted.
+            if (i->is_valid())
+                created_shader_groups.push_back(&*i);
+        }
+
+        return true;
+    }
+
+    // Progress of the optimization of a set of shader groups, shared by all jobs.
+    class ShaderGroupOptimizationProgress
+      : public NonCopyable
+    {
+      public:
+        explicit ShaderGroupOptimizationProgress(const size_t shader_group_count)
+          : m_shader_group_count(shader_group_count)
+          , m_optimized_count(0)
+          , m_failure_count(0)
+        {
+        }
+
+        void report(const bool success)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            const size_t prev_percent = (100 * m_optimized_count) / m_shader_group_count;
+            ++m_optimized_count;
+            const size_t percent = (100 * m_optimized_count) / m_shader_group_count;
+
+            if (!success)
+                ++m_failure_count;
+
+            // Report progress every 10%.
+            if (percent / 10 != prev_percent / 10)
+            {
+                RENDERER_LOG_INFO(
+                    "optimized %s of %s shader groups (%s).",
+                    pretty_uint(m_optimized_count).c_str(),
+                    pretty_uint(m_shader_group_count).c_str(),
+                    pretty_percent(m_optimized_count, m_shader_group_count).c_str());
+            }
+        }
+
+        bool succeeded() const
+        {
+            return m_failure_count == 0;
+        }
+
+      private:
+        boost::mutex    m_mutex;
+        const size_t    m_shader_group_count;
+        size_t          m_optimized_count;
+        size_t          m_failure_count;
+    };
+
+    class OptimizeShaderGroupJob
+      : public IJob
+    {
+      public:
+        OptimizeShaderGroupJob(
+            OSL::ShadingSystem&                 shading_system,
+            ShaderGroup&                        shader_group,
+            ShaderGroupOptimizationProgress&    progress,
+            IAbortSwitch*                       abort_switch)
+          : m_shading_system(shading_system)
+          , m_shader_group(shader_group)
+          , m_progress(progress)
+          , m_abort_switch(abort_switch)
+        {
+        }
+
+        virtual void execute(const size_t thread_index) APPLESEED_OVERRIDE
+        {
+            // Shader groups left unoptimized are optimized when they are first executed.
+            if (is_aborted(m_abort_switch))
+                return;
+
+            m_progress.report(m_shader_group.optimize_osl_shader_group(m_shading_system));
+        }
+
+      private:
+        OSL::ShadingSystem&                 m_shading_system;
+        ShaderGroup&                        m_shader_group;
+        ShaderGroupOptimizationProgress&    m_progress;
+        IAbortSwitch*                       m_abort_switch;
+    };
+}
+
 bool BaseGroup::create_optimized_osl_shader_groups(
     OSL::ShadingSystem& shading_system,
+    const size_t        thread_count,
     IAbortSwitch*       abort_switch)
 {
-    bool success = true;
+    // OSL shader groups must be created sequentially.
+    vector<ShaderGroup*> shader_groups;
+    if (!create_osl_shader_groups(*this, shading_system, shader_groups, abort_switch))
+        return false;
 
-    for (each<AssemblyContainer> i = assemblies(); i; ++i)
-    {
-        if (is_aborted(abort_switch))
-            return true;
+    if (shader_groups.empty() || is_aborted(abort_switch))
+        return true;
 
-        success = success && i->create_optimized_osl_shader_groups(
-            shading_system,
-            abort_switch);
-    }
+    // Optimize and JIT-compile them in parallel, so that rendering threads
+    // don't have to wait for each other the first time they hit a shader group.
+    const size_t job_thread_count = max<size_t>(min(thread_count, shader_groups.size()), 1);
 
-    for (each<ShaderGroupContainer> i = shader_groups(); i; ++i)
-    {
-        if (is_aborted(abort_switch))
-            return true;
+    RENDERER_LOG_INFO(
+        "optimizing %s shader group%s using %s thread%s...",
+        pretty_uint(shader_groups.size()).c_str(),
+        shader_groups.size() > 1 ? "s" : "",
+        pretty_uint(job_thread_count).c_str(),
+        job_thread_count > 1 ? "s" : "");
 
-        success = success && i->create_optimized_osl_shader_group(
-            shading_system,
-            abort_switch);
+    ShaderGroupOptimizationProgress progress(shader_groups.size());
+
+    JobQueue job_queue;
+    JobManager job_manager(global_logger(), job_queue, job_thread_count);
+
+    for (size_t i = 0, e = shader_groups.size(); i < e; ++i)
+    {
+        job_queue.schedule(
+            new OptimizeShaderGroupJob(
+                shading_system,
+                *shader_groups[i],
+                progress,
+                abort_switch));
     }
 
-    return success;
+    job_manager.start();
+    job_queue.wait_until_completion();
+
+    return progress.succeeded();
 }
 
 void BaseGroup::release_optimized_osl_shader_groups()
@@ -42,6 +42,9 @@ BEGIN_OSL_INCLUDES
 #include "OSL/oslexec.h"
 END_OSL_INCLUDES
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
 namespace foundation    { class StringArray; }
@@ -76,9 +79,11 @@ class APPLESEED_DLLSYMBOL BaseGroup
     // Access the OSL shader groups.
     ShaderGroupContainer& shader_groups() const;
 
-    // Create OSL shader groups and optimize them.
+    // Create OSL shader groups and optimize them. Shader groups are created
+    // sequentially, then optimized and JIT-compiled using 'thread_count' threads.
     bool create_optimized_osl_shader_groups(
         OSL::ShadingSystem&         shading_system,
+        const size_t                thread_count = 1,
         foundation::IAbortSwitch*   abort_switch = 0);
 
     // Release internal OSL shader groups.
@@ -46,6 +46,8 @@
 #include "boost/unordered/unordered_map.hpp"
 
 // Standard headers.
+#include <cassert>
+#include <cstring>
 #include <exception>
 #include <utility>
 
@@ -79,6 +81,7 @@ struct ShaderGroup::Impl
     ShaderContainer             m_shaders;
     ShaderConnectionContainer   m_connections;
     mutable OSL::ShaderGroupRef m_shader_group_ref;
+    bool                        m_optimized;
     mutable SurfaceAreaMap      m_surface_areas;
     const OSL::ShaderSymbol*    m_surface_shader_color_sym;
     const OSL::ShaderSymbol*    m_surface_shader_alpha_sym;
@@ -112,6 +115,7 @@ void ShaderGroup::clear()
     impl->m_shaders.clear();
     impl->m_connections.clear();
     impl->m_shader_group_ref.reset();
+    impl->m_optimized = false;
     m_flags = 0;
     impl->m_surface_shader_color_sym = 0;
     impl->m_surface_shader_alpha_sym = 0;
@@ -161,6 +165,23 @@ void ShaderGroup::add_connection(
 bool ShaderGroup::create_optimized_osl_shader_group(
     OSL::ShadingSystem& shading_system,
     IAbortSwitch*       abort_switch)
+{
+    if (is_optimized())
+        return true;
+
+    if (!create_osl_shader_group(shading_system, abort_switch))
+        return false;
+
+    // The shader group is not created if setup was aborted.
+    if (!is_valid())
+        return true;
+
+    return optimize_osl_shader_group(shading_system);
+}
+
+bool ShaderGroup::create_osl_shader_group(
+    OSL::ShadingSystem& shading_system,
+    IAbortSwitch*       abort_switch)
 {
     if (is_valid())
         return true;
@@ -209,6 +230,26 @@ bool ShaderGroup::create_optimized_osl_shader_group(
 
         impl->m_shader_group_ref = shader_group_ref;
 
+        return true;
+    }
+    catch (const exception& e)
+    {
+        RENDERER_LOG_ERROR("failed to setup shader group \"%s\": %s.", get_path().c_str(), e.what());
+        return false;
+    }
+}
+
+bool ShaderGroup::optimize_osl_shader_group(OSL::ShadingSystem& shading_system)
+{
+    assert(is_valid());
+
+    RENDERER_LOG_DEBUG("optimizing shader group \"%s\"...", get_path().c_str());
+
+    try
+    {
+        // Optimize and JIT-compile the shader group now rather than when it is first executed.
+        shading_system.optimize_group(impl->m_shader_group_ref.get());
+
         // Set the shadergroup outputs and get symbols if needed.
         for (each<ShaderContainer> i = impl->m_shaders; i; ++i)
         {
@@ -247,6 +288,8 @@ bool ShaderGroup::create_optimized_osl_shader_group(
                                 *impl->m_shader_group_ref,
                                 OIIO::ustring("Aout"));
                     }
+
+                    shading_system.release_context(ctx);
                 }
                 break;
             }
@@ -263,11 +306,14 @@ bool ShaderGroup::create_optimized_osl_shader_group(
         get_shadergroup_globals_info(shading_system);
         report_uses_global("dPdtime", UsesdPdTime);
 
+        impl->m_optimized = true;
+
         return true;
     }
     catch (const exception& e)
     {
-        RENDERER_LOG_ERROR("failed to setup shader group \"%s\": %s.", get_path().c_str(), e.what());
+        RENDERER_LOG_ERROR("failed to optimize shader group \"%s\": %s.", get_path().c_str(), e.what());
+        impl->m_shader_group_ref.reset();
         return false;
     }
 }
@@ -275,6 +321,7 @@ bool ShaderGroup::create_optimized_osl_shader_group(
 void ShaderGroup::release_optimized_osl_shader_group()
 {
     impl->m_shader_group_ref.reset();
+    impl->m_optimized = false;
 }
 
 const ShaderContainer& ShaderGroup::shaders() const
@@ -292,6 +339,11 @@ bool ShaderGroup::is_valid() const
     return impl->m_shader_group_ref.get() != 0;
 }
 
+bool ShaderGroup::is_optimized() const
+{
+    return impl->m_optimized;
+}
+
 float ShaderGroup::get_surface_area(const AssemblyInstance* ass, const ObjectInstance* obj) const
 {
     assert(has_emission());
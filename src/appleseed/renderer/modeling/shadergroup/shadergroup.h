@@ -87,11 +87,20 @@ class APPLESEED_DLLSYMBOL ShaderGroup
         const char*                 dst_layer,
         const char*                 dst_param);
 
-    // Create OSL shader group.
+    // Create OSL shader group and optimize it.
     bool create_optimized_osl_shader_group(
         OSL::ShadingSystem&         shading_system,
         foundation::IAbortSwitch*   abort_switch = 0);
 
+    // Create OSL shader group without optimizing it. Not thread-safe.
+    bool create_osl_shader_group(
+        OSL::ShadingSystem&         shading_system,
+        foundation::IAbortSwitch*   abort_switch = 0);
+
+    // Optimize and JIT-compile the OSL shader group created by create_osl_shader_group(),
+    // then query its properties. May be called concurrently for different shader groups.
+    bool optimize_osl_shader_group(OSL::ShadingSystem& shading_system);
+
     // Release internal OSL shader group.
     void release_optimized_osl_shader_group();
 
@@ -104,6 +113,9 @@ class APPLESEED_DLLSYMBOL ShaderGroup
     // Return true if the shader group was setup correctly.
     bool is_valid() const;
 
+    // Return true if the shader group was setup and optimized correctly.
+    bool is_optimized() const;
+
     // Return true if the shader group contains at least one BSDF closure.
     bool has_bsdfs() const;
 
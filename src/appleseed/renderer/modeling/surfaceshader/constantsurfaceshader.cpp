@@ -113,7 +113,7 @@ namespace
             InputValues values;
             m_inputs.evaluate(
                 shading_context.get_texture_cache(),
-                shading_point.get_uv(0),
+                shading_point,
                 &values);
 
             // Initialize the shading result.
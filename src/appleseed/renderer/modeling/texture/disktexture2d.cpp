@@ -42,18 +42,29 @@
 #include "foundation/image/genericprogressiveimagefilereader.h"
 #include "foundation/image/tile.h"
 #include "foundation/platform/thread.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/api/specializedapiarrays.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/makevector.h"
 #include "foundation/utility/searchpaths.h"
 
+// Boost headers.
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+#include "boost/system/error_code.hpp"
+
 // Standard headers.
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <ctime>
 #include <string>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
+namespace bf = boost::filesystem;
 
 namespace renderer
 {
@@ -76,6 +87,7 @@ namespace
             const SearchPaths&  search_paths)
           : Texture(name, params)
           , m_reader(&global_logger())
+          , m_file_stamp(0)
         {
             const EntityDefMessageContext message_context("texture", this);
 
@@ -94,6 +106,9 @@ namespace
             else if (color_space == "srgb")
                 m_color_space = ColorSpaceSRGB;
             else m_color_space = ColorSpaceCIEXYZ;
+
+            // Retrieve whether a MIP pyramid should be generated.
+            m_generate_mip_levels = m_params.get_optional<bool>("mipmaps", false);
         }
 
         virtual void release() APPLESEED_OVERRIDE
@@ -119,6 +134,20 @@ namespace
             return m_color_space;
         }
 
+        virtual bool has_detached_tiles() const APPLESEED_OVERRIDE
+        {
+            // Tiles are allocated on load and deleted on unload.
+            return true;
+        }
+
+        virtual uint64 get_content_stamp() const APPLESEED_OVERRIDE
+        {
+            // Use the modification time of the texture file.
+            boost::system::error_code ec;
+            const time_t time = bf::last_write_time(bf::path(m_filepath), ec);
+            return ec ? 0 : static_cast<uint64>(time);
+        }
+
         virtual void collect_asset_paths(StringArray& paths) const APPLESEED_OVERRIDE
         {
             if (m_params.strings().exist("filename"))
@@ -154,6 +183,22 @@ namespace
             delete tile;
         }
 
+        virtual size_t get_mip_level_count() APPLESEED_OVERRIDE
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            open_image_file();
+            return m_level_props.size();
+        }
+
+        virtual const CanvasProperties& mip_properties(
+            const size_t        level) APPLESEED_OVERRIDE
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            open_image_file();
+            assert(level < m_level_props.size());
+            return m_level_props[level];
+        }
+
       private:
         string                              m_filepath;
         ColorSpace                          m_color_space;
@@ -161,6 +206,10 @@ namespace
         mutable boost::mutex                m_mutex;
         GenericProgressiveImageFileReader   m_reader;
         CanvasProperties                    m_props;
+        uint64                              m_file_stamp;       // content stamp of the file when it was last opened
+
+        bool                                m_generate_mip_levels;
+        vector<CanvasProperties>            m_level_props;      // properties of all levels, including level 0
 
         void open_image_file()
         {
@@ -170,8 +219,45 @@ namespace
                     "opening texture file %s and reading metadata...",
                     m_filepath.c_str());
 
+                // Forget everything derived from the file if it was modified since it was last opened.
+                const uint64 file_stamp = get_content_stamp();
+                if (file_stamp != m_file_stamp)
+                {
+                    m_file_stamp = file_stamp;
+                    m_level_props.clear();
+                }
+
                 m_reader.open(m_filepath.c_str());
                 m_reader.read_canvas_properties(m_props);
+
+                if (m_level_props.empty())
+                    compute_level_properties();
+            }
+        }
+
+        void compute_level_properties()
+        {
+            m_level_props.push_back(m_props);
+
+            if (!m_generate_mip_levels)
+                return;
+
+            size_t width = m_props.m_canvas_width;
+            size_t height = m_props.m_canvas_height;
+
+            while (width > 1 || height > 1)
+            {
+                width = max<size_t>(width / 2, 1);
+                height = max<size_t>(height / 2, 1);
+
+                m_level_props.push_back(
+                    CanvasProperties(
+                        width,
+                        height,
+                        m_props.m_tile_width,
+                        m_props.m_tile_height,
+                        m_props.m_channel_count,
+                        m_props.m_pixel_format));
             }
         }
     };
@@ -222,6 +308,14 @@ DictionaryArray DiskTexture2dFactory::get_input_metadata() const
             .insert("use", "required")
             .insert("default", "srgb"));
 
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "mipmaps")
+            .insert("label", "Generate Mipmaps")
+            .insert("type", "boolean")
+            .insert("use", "optional")
+            .insert("default", "false"));
+
     return metadata;
 }
 
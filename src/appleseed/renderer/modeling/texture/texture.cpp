@@ -30,6 +30,12 @@
 // Interface header.
 #include "texture.h"
 
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+
+// Standard headers.
+#include <cassert>
+
 using namespace foundation;
 
 namespace renderer
@@ -57,4 +63,25 @@ Texture::Texture(
     set_name(name);
 }
 
+bool Texture::has_detached_tiles() const
+{
+    return false;
+}
+
+uint64 Texture::get_content_stamp() const
+{
+    return 0;
+}
+
+size_t Texture::get_mip_level_count()
+{
+    return 1;
+}
+
+const CanvasProperties& Texture::mip_properties(const size_t level)
+{
+    assert(level == 0);
+    return properties();
+}
+
 }   // namespace renderer
@@ -35,6 +35,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/image/colorspace.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/uid.h"
 
 // appleseed.main headers.
@@ -86,6 +87,27 @@ class APPLESEED_DLLSYMBOL Texture
         const size_t                tile_x,
         const size_t                tile_y,
         const foundation::Tile*     tile) = 0;
+
+    // Return true if the tiles returned by this texture are owned by the caller.
+    // Such tiles are unloaded by deleting them and remain valid after the texture
+    // is destroyed, which allows the texture store to keep them across renders.
+    // The default implementation returns false.
+    virtual bool has_detached_tiles() const;
+
+    // Return a stamp that changes when the content of the texture is modified
+    // outside of appleseed, for instance when its file is overwritten on disk.
+    // The default implementation returns 0.
+    virtual foundation::uint64 get_content_stamp() const;
+
+    // Return the number of levels of the MIP pyramid of this texture.
+    // Textures without MIP levels only have the full resolution level 0.
+    // Textures only load the tiles of level 0: the tiles of the other levels
+    // are generated by the texture store from the tiles of the finer level.
+    virtual size_t get_mip_level_count();
+
+    // Access canvas properties of a given MIP level.
+    virtual const foundation::CanvasProperties& mip_properties(
+        const size_t                level);
 };
 
 }       // namespace renderer
@@ -32,6 +32,7 @@
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
 #include "renderer/kernel/shading/shadingpoint.h"
+#include "renderer/utility/seexprprogram.h"
 
 // appleseed.foundation headers.
 #include "foundation/image/color.h"
@@ -66,12 +67,6 @@ END_OIIO_INCLUDES
 namespace renderer
 {
 
-inline bool texture_is_srgb(const OIIO::ustring& filename)
-{
-   return filename.rfind(".exr") != filename.length() - 4;
-}
-
-
 //
 // TextureSeExprFunc class.
 //
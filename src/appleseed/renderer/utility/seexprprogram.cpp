@@ -0,0 +1,776 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "seexprprogram.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/colorspace.h"
+#include "foundation/utility/countof.h"
+#include "foundation/utility/otherwise.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// SeExprProgram::Compiler class implementation.
+//
+// A recursive descent parser that emits instructions as it goes.
+//
+
+class SeExprProgram::Compiler
+{
+  public:
+    Compiler(
+        SeExprProgram&          program,
+        const string&           expression)
+      : m_program(program)
+      , m_expression(expression)
+      , m_pos(0)
+    {
+    }
+
+    bool compile(uint32& output)
+    {
+        try
+        {
+            const Operand result = parse_additive();
+
+            skip_whitespace();
+            if (m_pos != m_expression.size())
+                return false;
+
+            output = materialize(result);
+            return true;
+        }
+        catch (const ParseError&)
+        {
+            return false;
+        }
+    }
+
+  private:
+    struct ParseError {};
+
+    struct Function
+    {
+        const char* m_name;
+        Opcode      m_opcode;
+        size_t      m_arity;
+    };
+
+    // A value known at compile time or held in a register.
+    struct Operand
+    {
+        bool        m_is_constant;
+        Vector3f    m_value;
+        uint32      m_register;
+
+        static Operand constant(const Vector3f& value)
+        {
+            Operand operand;
+            operand.m_is_constant = true;
+            operand.m_value = value;
+            operand.m_register = 0;
+            return operand;
+        }
+
+        static Operand reg(const uint32 index)
+        {
+            Operand operand;
+            operand.m_is_constant = false;
+            operand.m_value = Vector3f(0.0f);
+            operand.m_register = index;
+            return operand;
+        }
+    };
+
+    SeExprProgram&  m_program;
+    const string&   m_expression;
+    size_t          m_pos;
+
+    //
+    // Lexing.
+    //
+
+    void skip_whitespace()
+    {
+        while (m_pos < m_expression.size() && isspace(static_cast<unsigned char>(m_expression[m_pos])))
+            ++m_pos;
+    }
+
+    char peek()
+    {
+        skip_whitespace();
+        return m_pos < m_expression.size() ? m_expression[m_pos] : '\0';
+    }
+
+    bool accept(const char c)
+    {
+        if (peek() != c)
+            return false;
+
+        ++m_pos;
+        return true;
+    }
+
+    void expect(const char c)
+    {
+        if (!accept(c))
+            throw ParseError();
+    }
+
+    string parse_identifier()
+    {
+        skip_whitespace();
+
+        const size_t begin = m_pos;
+
+        while (m_pos < m_expression.size() &&
+               (isalnum(static_cast<unsigned char>(m_expression[m_pos])) || m_expression[m_pos] == '_'))
+            ++m_pos;
+
+        if (m_pos == begin)
+            throw ParseError();
+
+        return m_expression.substr(begin, m_pos - begin);
+    }
+
+    string parse_string()
+    {
+        expect('"');
+
+        const size_t end = m_expression.find('"', m_pos);
+        if (end == string::npos)
+            throw ParseError();
+
+        const string result = m_expression.substr(m_pos, end - m_pos);
+        m_pos = end + 1;
+
+        return result;
+    }
+
+    float parse_number()
+    {
+        skip_whitespace();
+
+        const char* begin = m_expression.c_str() + m_pos;
+        char* end;
+        const double value = strtod(begin, &end);
+
+        if (end == begin)
+            throw ParseError();
+
+        m_pos += end - begin;
+
+        return static_cast<float>(value);
+    }
+
+    //
+    // Parsing, following SeExpr's operator precedence.
+    //
+
+    Operand parse_additive()
+    {
+        Operand lhs = parse_multiplicative();
+
+        while (true)
+        {
+            if (accept('+'))
+                lhs = apply(OpAdd, lhs, parse_multiplicative());
+            else if (accept('-'))
+                lhs = apply(OpSub, lhs, parse_multiplicative());
+            else return lhs;
+        }
+    }
+
+    Operand parse_multiplicative()
+    {
+        Operand lhs = parse_unary();
+
+        while (true)
+        {
+            if (accept('*'))
+                lhs = apply(OpMul, lhs, parse_unary());
+            else if (accept('/'))
+                lhs = apply(OpDiv, lhs, parse_unary());
+            else return lhs;
+        }
+    }
+
+    Operand parse_unary()
+    {
+        if (accept('-'))
+            return apply(OpNeg, parse_unary());
+
+        if (accept('+'))
+            return parse_unary();
+
+        return parse_power();
+    }
+
+    Operand parse_power()
+    {
+        const Operand base = parse_primary();
+
+        // Right-associative, binds tighter than unary minus on its left.
+        if (accept('^'))
+            return apply(OpPow, base, parse_unary());
+
+        return base;
+    }
+
+    Operand parse_primary()
+    {
+        const char c = peek();
+
+        if (c == '(')
+        {
+            ++m_pos;
+            const Operand result = parse_additive();
+            expect(')');
+            return result;
+        }
+
+        if (c == '[')
+        {
+            ++m_pos;
+            const Operand x = parse_additive();
+            expect(',');
+            const Operand y = parse_additive();
+            expect(',');
+            const Operand z = parse_additive();
+            expect(']');
+            return make_vector(x, y, z);
+        }
+
+        if (c == '$')
+        {
+            ++m_pos;
+            const string name = parse_identifier();
+
+            Instruction instruction = make_instruction(OpU);
+            if (name == "u")
+                instruction.m_opcode = OpU;
+            else if (name == "v")
+                instruction.m_opcode = OpV;
+            else throw ParseError();
+
+            return Operand::reg(m_program.emit(instruction));
+        }
+
+        if (isdigit(static_cast<unsigned char>(c)) || c == '.')
+            return Operand::constant(Vector3f(parse_number()));
+
+        return parse_function_call(parse_identifier());
+    }
+
+    Operand parse_function_call(const string& name)
+    {
+        expect('(');
+
+        if (name == "texture")
+        {
+            const string filename = parse_string();
+            expect(',');
+            const Operand u = parse_additive();
+            expect(',');
+            const Operand v = parse_additive();
+            expect(')');
+            return texture(filename, u, v);
+        }
+
+        static const Function Functions[] =
+        {
+            { "abs",        OpAbs,          1 },
+            { "floor",      OpFloor,        1 },
+            { "ceil",       OpCeil,         1 },
+            { "sin",        OpSin,          1 },
+            { "cos",        OpCos,          1 },
+            { "exp",        OpExp,          1 },
+            { "invert",     OpInvert,       1 },
+            { "pow",        OpPow,          2 },
+            { "min",        OpMin,          2 },
+            { "max",        OpMax,          2 },
+            { "clamp",      OpClamp,        3 },
+            { "mix",        OpMix,          3 },
+            { "smoothstep", OpSmoothstep,   3 }
+        };
+
+        for (size_t i = 0; i < countof(Functions); ++i)
+        {
+            const Function& function = Functions[i];
+
+            if (name != function.m_name)
+                continue;
+
+            Operand args[3];
+
+            for (size_t j = 0; j < function.m_arity; ++j)
+            {
+                if (j > 0)
+                    expect(',');
+                args[j] = parse_additive();
+            }
+
+            expect(')');
+
+            return apply(function.m_opcode, function.m_arity, args);
+        }
+
+        throw ParseError();
+    }
+
+    //
+    // Code generation.
+    //
+
+    static Instruction make_instruction(const Opcode opcode)
+    {
+        Instruction instruction;
+        instruction.m_opcode = opcode;
+        instruction.m_args[0] = instruction.m_args[1] = instruction.m_args[2] = 0;
+        instruction.m_index = 0;
+        return instruction;
+    }
+
+    uint32 materialize(const Operand& operand)
+    {
+        if (!operand.m_is_constant)
+            return operand.m_register;
+
+        vector<Vector3f>& constants = m_program.m_constants;
+
+        Instruction instruction = make_instruction(OpConstant);
+        instruction.m_index =
+            static_cast<uint32>(find(constants.begin(), constants.end(), operand.m_value) - constants.begin());
+
+        if (instruction.m_index == constants.size())
+            constants.push_back(operand.m_value);
+
+        return m_program.emit(instruction);
+    }
+
+    Operand apply(const Opcode opcode, const Operand& a)
+    {
+        return apply(opcode, 1, &a);
+    }
+
+    Operand apply(const Opcode opcode, const Operand& a, const Operand& b)
+    {
+        const Operand args[2] = { a, b };
+        return apply(opcode, 2, args);
+    }
+
+    Operand apply(const Opcode opcode, const size_t arity, const Operand* args)
+    {
+        bool all_constant = true;
+
+        for (size_t i = 0; i < arity; ++i)
+            all_constant = all_constant && args[i].m_is_constant;
+
+        // Constant folding, sharing the evaluation code with the interpreter.
+        if (all_constant)
+        {
+            Vector3f result;
+            execute(
+                opcode,
+                3,
+                &args[0].m_value[0],
+                &args[arity > 1 ? 1 : 0].m_value[0],
+                &args[arity > 2 ? 2 : 0].m_value[0],
+                &result[0]);
+            return Operand::constant(result);
+        }
+
+        Instruction instruction = make_instruction(opcode);
+
+        for (size_t i = 0; i < arity; ++i)
+            instruction.m_args[i] = materialize(args[i]);
+
+        // Put the operands of commutative operators in a canonical order.
+        if (opcode == OpAdd || opcode == OpMul || opcode == OpMin || opcode == OpMax)
+        {
+            if (instruction.m_args[1] < instruction.m_args[0])
+                swap(instruction.m_args[0], instruction.m_args[1]);
+        }
+
+        return Operand::reg(m_program.emit(instruction));
+    }
+
+    Operand make_vector(const Operand& x, const Operand& y, const Operand& z)
+    {
+        if (x.m_is_constant && y.m_is_constant && z.m_is_constant)
+            return Operand::constant(Vector3f(x.m_value[0], y.m_value[0], z.m_value[0]));
+
+        Instruction instruction = make_instruction(OpVector);
+        instruction.m_args[0] = materialize(x);
+        instruction.m_args[1] = materialize(y);
+        instruction.m_args[2] = materialize(z);
+
+        return Operand::reg(m_program.emit(instruction));
+    }
+
+    Operand texture(const string& filename, const Operand& u, const Operand& v)
+    {
+        if (filename.empty())
+            throw ParseError();
+
+        vector<Texture>& textures = m_program.m_textures;
+
+        Instruction instruction = make_instruction(OpTexture);
+        instruction.m_args[0] = materialize(u);
+        instruction.m_args[1] = materialize(v);
+        instruction.m_index = static_cast<uint32>(textures.size());
+
+        for (size_t i = 0; i < textures.size(); ++i)
+        {
+            if (textures[i].m_filename == filename)
+                instruction.m_index = static_cast<uint32>(i);
+        }
+
+        if (instruction.m_index == textures.size())
+        {
+            Texture texture;
+            texture.m_filename = OIIO::ustring(filename);
+            texture.m_is_srgb = texture_is_srgb(texture.m_filename);
+            textures.push_back(texture);
+        }
+
+        return Operand::reg(m_program.emit(instruction));
+    }
+};
+
+
+//
+// SeExprProgram class implementation.
+//
+
+bool SeExprProgram::Instruction::operator<(const Instruction& rhs) const
+{
+    if (m_opcode != rhs.m_opcode)
+        return m_opcode < rhs.m_opcode;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (m_args[i] != rhs.m_args[i])
+            return m_args[i] < rhs.m_args[i];
+    }
+
+    return m_index < rhs.m_index;
+}
+
+bool SeExprProgram::add_output(const string& expression)
+{
+    Compiler compiler(*this, expression);
+
+    uint32 output;
+    if (!compiler.compile(output))
+        return false;
+
+    m_outputs.push_back(output);
+    return true;
+}
+
+uint32 SeExprProgram::emit(const Instruction& instruction)
+{
+    const InstructionMap::const_iterator i = m_instruction_map.find(instruction);
+
+    if (i != m_instruction_map.end())
+        return i->second;
+
+    const uint32 index = static_cast<uint32>(m_instructions.size());
+    m_instructions.push_back(instruction);
+    m_instruction_map.insert(make_pair(instruction, index));
+
+    return index;
+}
+
+namespace
+{
+    inline float smoothstep(const float x, const float a, const float b)
+    {
+        // Same conventions as SeExpr's smoothstep().
+        float t;
+
+        if (a < b)
+        {
+            if (x < a) return 0.0f;
+            if (x >= b) return 1.0f;
+            t = (x - a) / (b - a);
+        }
+        else if (a > b)
+        {
+            if (x <= b) return 1.0f;
+            if (x > a) return 0.0f;
+            t = 1.0f - (x - b) / (a - b);
+        }
+        else return x < a ? 0.0f : 1.0f;
+
+        return t * t * (3.0f - 2.0f * t);
+    }
+}
+
+void SeExprProgram::execute(
+    const uint32                opcode,
+    const size_t                size,
+    const float*                a,
+    const float*                b,
+    const float*                c,
+    float*                      dst)
+{
+    switch (opcode)
+    {
+      case OpNeg:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = -a[i];
+        break;
+
+      case OpAdd:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] + b[i];
+        break;
+
+      case OpSub:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] - b[i];
+        break;
+
+      case OpMul:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] * b[i];
+        break;
+
+      case OpDiv:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] / b[i];
+        break;
+
+      case OpPow:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = pow(a[i], b[i]);
+        break;
+
+      case OpAbs:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = abs(a[i]);
+        break;
+
+      case OpFloor:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = floor(a[i]);
+        break;
+
+      case OpCeil:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = ceil(a[i]);
+        break;
+
+      case OpSin:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = sin(a[i]);
+        break;
+
+      case OpCos:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = cos(a[i]);
+        break;
+
+      case OpExp:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = exp(a[i]);
+        break;
+
+      case OpMin:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = min(a[i], b[i]);
+        break;
+
+      case OpMax:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = max(a[i], b[i]);
+        break;
+
+      case OpClamp:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] < b[i] ? b[i] : a[i] > c[i] ? c[i] : a[i];
+        break;
+
+      case OpMix:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = a[i] * (1.0f - c[i]) + b[i] * c[i];
+        break;
+
+      case OpSmoothstep:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = smoothstep(a[i], b[i], c[i]);
+        break;
+
+      case OpInvert:
+        for (size_t i = 0; i < size; ++i)
+            dst[i] = 1.0f - a[i];
+        break;
+
+      assert_otherwise;
+    }
+}
+
+void SeExprProgram::evaluate(
+    const size_t                point_count,
+    const Vector2f*             uv,
+    OIIO::TextureSystem&        texture_system,
+    Registers&                  registers,
+    Color3f*                    outputs) const
+{
+    assert(!m_outputs.empty());
+
+    // Each register holds the x components of all points, then the y components, then the z components.
+    const size_t stride = 3 * point_count;
+    if (registers.size() < m_instructions.size() * stride)
+        registers.resize(m_instructions.size() * stride);
+    float* r = &registers[0];
+
+    OIIO::TextureOpt texture_options;
+    texture_options.swrap = OIIO::TextureOpt::WrapPeriodic;
+    texture_options.twrap = OIIO::TextureOpt::WrapPeriodic;
+
+    for (size_t i = 0, e = m_instructions.size(); i < e; ++i)
+    {
+        const Instruction& instruction = m_instructions[i];
+        const float* a = r + instruction.m_args[0] * stride;
+        const float* b = r + instruction.m_args[1] * stride;
+        const float* c = r + instruction.m_args[2] * stride;
+        float* dst = r + i * stride;
+
+        switch (instruction.m_opcode)
+        {
+          case OpConstant:
+            {
+                const Vector3f& value = m_constants[instruction.m_index];
+                for (size_t k = 0; k < 3; ++k)
+                    fill(dst + k * point_count, dst + (k + 1) * point_count, value[k]);
+            }
+            break;
+
+          case OpU:
+          case OpV:
+            {
+                const size_t component = instruction.m_opcode == OpU ? 0 : 1;
+                for (size_t p = 0; p < point_count; ++p)
+                    dst[p] = uv[p][component];
+                for (size_t k = 1; k < 3; ++k)
+                    memcpy(dst + k * point_count, dst, point_count * sizeof(float));
+            }
+            break;
+
+          case OpVector:
+            memcpy(dst, a, point_count * sizeof(float));
+            memcpy(dst + point_count, b, point_count * sizeof(float));
+            memcpy(dst + 2 * point_count, c, point_count * sizeof(float));
+            break;
+
+          case OpTexture:
+            {
+                const Texture& texture = m_textures[instruction.m_index];
+
+                for (size_t p = 0; p < point_count; ++p)
+                {
+                    Color3f color;
+                    if (!texture_system.texture(
+                            texture.m_filename,
+                            texture_options,
+                            a[p],
+                            b[p],
+                            0.0f,
+                            0.0f,
+                            0.0f,
+                            0.0f,
+                            3,
+                            &color[0]))
+                    {
+                        // Failed to find or open the texture.
+                        const string message = texture_system.geterror();
+                        if (!message.empty())
+                        {
+                            const string modified_message = prefix_all_lines(trim_both(message), "oiio: ");
+                            RENDERER_LOG_ERROR("%s", modified_message.c_str());
+                        }
+                        color = Color3f(1.0f, 0.0f, 1.0f);
+                    }
+                    else if (!texture.m_is_srgb)
+                    {
+                        // Colors in SeExpr are always in the sRGB color space.
+                        color = linear_rgb_to_srgb(color);
+                    }
+
+                    dst[p] = color[0];
+                    dst[point_count + p] = color[1];
+                    dst[2 * point_count + p] = color[2];
+                }
+            }
+            break;
+
+          default:
+            execute(instruction.m_opcode, stride, a, b, c, dst);
+            break;
+        }
+    }
+
+    const size_t output_count = m_outputs.size();
+
+    for (size_t o = 0; o < output_count; ++o)
+    {
+        const float* src = r + m_outputs[o] * stride;
+
+        for (size_t p = 0; p < point_count; ++p)
+        {
+            outputs[p * output_count + o] =
+                Color3f(
+                    src[p],
+                    src[point_count + p],
+                    src[2 * point_count + p]);
+        }
+    }
+}
+
+}   // namespace renderer
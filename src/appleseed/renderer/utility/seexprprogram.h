@@ -0,0 +1,201 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2017 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_RENDERER_UTILITY_SEEXPRPROGRAM_H
+#define APPLESEED_RENDERER_UTILITY_SEEXPRPROGRAM_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/color.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// OpenImageIO headers.
+#include "foundation/platform/oiioheaderguards.h"
+BEGIN_OIIO_INCLUDES
+#include "OpenImageIO/texture.h"
+#include "OpenImageIO/ustring.h"
+END_OIIO_INCLUDES
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace renderer
+{
+
+// Return true if the texture stores sRGB colors, i.e. if it is not an OpenEXR file.
+inline bool texture_is_srgb(const OIIO::ustring& filename)
+{
+   return filename.rfind(".exr") != filename.length() - 4;
+}
+
+
+//
+// A set of SeExpr expressions compiled to a compact register bytecode.
+//
+// Every output of the program is compiled from one expression. Instructions
+// operate on 3-component registers and each instruction writes its own register.
+// Constant subexpressions are folded at compile time, and identical subexpressions
+// (including texture lookups) are computed once for all outputs of the program.
+//
+// Only a subset of the SeExpr language is supported: numbers, [x, y, z] vectors,
+// the $u and $v variables, the unary and binary + - * / ^ operators, texture()
+// lookups and the abs, floor, ceil, sin, cos, exp, pow, min, max, clamp, mix,
+// smoothstep and invert functions. add_output() fails on anything else and the
+// caller is expected to fall back to SeExpr's interpreter.
+//
+// A compiled program is immutable and can be shared by multiple threads, each one
+// providing its own registers. Evaluation processes a batch of points at a time:
+// registers are stored component-major so that each instruction is a tight loop.
+//
+
+class SeExprProgram
+  : public foundation::NonCopyable
+{
+  public:
+    // Per-thread evaluation storage.
+    typedef std::vector<float> Registers;
+
+    // Compile an expression and append its result to the outputs of the program.
+    // Returns false if the expression cannot be compiled; the program should then be discarded.
+    bool add_output(const std::string& expression);
+
+    // Return the number of outputs of the program.
+    size_t get_output_count() const;
+
+    // Return the number of instructions and the number of texture lookups per point.
+    size_t get_instruction_count() const;
+    size_t get_texture_lookup_count() const;
+
+    // Evaluate all outputs for a batch of points. The outputs of point i are
+    // stored in outputs[i * get_output_count()] and following.
+    void evaluate(
+        const size_t                    point_count,
+        const foundation::Vector2f*     uv,
+        OIIO::TextureSystem&            texture_system,
+        Registers&                      registers,
+        foundation::Color3f*            outputs) const;
+
+  private:
+    class Compiler;
+
+    enum Opcode
+    {
+        OpConstant,                     // dst = constant
+        OpU,                            // dst = $u
+        OpV,                            // dst = $v
+        OpVector,                       // dst = [a[0], b[0], c[0]]
+        OpTexture,                      // dst = texture(file, a[0], b[0])
+        OpNeg,
+        OpAdd,
+        OpSub,
+        OpMul,
+        OpDiv,
+        OpPow,
+        OpAbs,
+        OpFloor,
+        OpCeil,
+        OpSin,
+        OpCos,
+        OpExp,
+        OpMin,
+        OpMax,
+        OpClamp,
+        OpMix,
+        OpSmoothstep,
+        OpInvert
+    };
+
+    struct Instruction
+    {
+        foundation::uint32  m_opcode;
+        foundation::uint32  m_args[3];  // source registers
+        foundation::uint32  m_index;    // constant or texture index
+
+        bool operator<(const Instruction& rhs) const;
+    };
+
+    struct Texture
+    {
+        OIIO::ustring       m_filename;
+        bool                m_is_srgb;
+    };
+
+    typedef std::map<Instruction, foundation::uint32> InstructionMap;
+
+    std::vector<Instruction>            m_instructions;     // the destination register of instruction i is i
+    std::vector<foundation::Vector3f>   m_constants;
+    std::vector<Texture>                m_textures;
+    std::vector<foundation::uint32>     m_outputs;
+    InstructionMap                      m_instruction_map;  // used to share subexpressions
+
+    foundation::uint32 emit(const Instruction& instruction);
+
+    static void execute(
+        const foundation::uint32        opcode,
+        const size_t                    size,
+        const float*                    a,
+        const float*                    b,
+        const float*                    c,
+        float*                          dst);
+};
+
+
+//
+// SeExprProgram class implementation.
+//
+
+inline size_t SeExprProgram::get_output_count() const
+{
+    return m_outputs.size();
+}
+
+inline size_t SeExprProgram::get_instruction_count() const
+{
+    return m_instructions.size();
+}
+
+inline size_t SeExprProgram::get_texture_lookup_count() const
+{
+    size_t count = 0;
+
+    for (size_t i = 0, e = m_instructions.size(); i < e; ++i)
+    {
+        if (m_instructions[i].m_opcode == OpTexture)
+            ++count;
+    }
+
+    return count;
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_UTILITY_SEEXPRPROGRAM_H
@@ -57,6 +57,14 @@ CommandLineHandler::CommandLineHandler()
             .add_name("--print-bounding-boxes")
             .add_name("-b")
             .set_description("print mesh bounding boxes"));
+
+    parser().add_option_handler(
+        &m_binarymesh_format
+            .add_name("--binarymesh-format")
+            .add_name("-f")
+            .set_description("set the format of output binarymesh files: stream (default), indexed or indexed-lz4")
+            .set_syntax("format")
+            .set_exact_value_count(1));
 }
 
 void CommandLineHandler::print_program_usage(
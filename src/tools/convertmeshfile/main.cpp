@@ -37,6 +37,7 @@
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilewriter.h"
 #include "foundation/mesh/genericmeshfilereader.h"
 #include "foundation/mesh/genericmeshfilewriter.h"
 #include "foundation/mesh/imeshbuilder.h"
@@ -330,8 +331,26 @@ int main(int argc, const char* argv[])
             print_bbox(logger, *i);
     }
 
+    // Select the format of output BinaryMesh files.
+    BinaryMeshFileWriter::Format binarymesh_format = BinaryMeshFileWriter::LZ4Stream;
+    if (cl.m_binarymesh_format.is_set())
+    {
+        const string& format = cl.m_binarymesh_format.values()[0];
+        if (format == "indexed")
+            binarymesh_format = BinaryMeshFileWriter::Indexed;
+        else if (format == "indexed-lz4")
+            binarymesh_format = BinaryMeshFileWriter::IndexedLZ4;
+        else if (format != "stream")
+        {
+            LOG_WARNING(
+                logger,
+                "invalid binarymesh format \"%s\", using default format \"stream\".",
+                format.c_str());
+        }
+    }
+
     // Write the output mesh file.
-    GenericMeshFileWriter writer(output_filepath.c_str());
+    GenericMeshFileWriter writer(output_filepath.c_str(), binarymesh_format);
     try
     {
         for (const_each<list<Mesh> > i = builder.get_meshes(); i; ++i)